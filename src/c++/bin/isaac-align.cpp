@@ -59,9 +59,12 @@ void align(const isaac::options::AlignOptions &options)
         options.cleanupIntermediary,
         options.ignoreMissingBcls,
         options.ignoreMissingFilters,
+        options.memoryMapInput,
         options.firstPassSeeds,
+        options.seedIterations,
         0, //TODO: have a command-line argument to override the estimation-based value
         options.referenceMetadataList,
+        options.referenceServerSocket,
         options.tempDirectory,
         options.outputDirectory,
         options.jobs,
@@ -92,6 +95,7 @@ void align(const isaac::options::AlignOptions &options)
         options.gapOpenScore,
         options.gapExtendScore,
         options.minGapExtendScore,
+        options.fixedPointScoring,
         options.semialignedGapLimit,
         options.dodgyAlignmentScore,
         options.inputLoadersMax,
@@ -107,19 +111,30 @@ void align(const isaac::options::AlignOptions &options)
         options.keepDuplicates,
         options.markDuplicates,
         options.binRegexString,
+        options.scatterBinLength,
+        options.tileCheckpoints,
         options.memoryControl,
         options.clusterIdList,
         options.userTemplateLengthStatistics,
         options.statsImageFormat,
+        options.statsSummaryOnly,
         options.bufferBins,
         options.qScoreBin,
         options.fullBclQScoreTable,
         options.optionalFeatures,
-        options.pessimisticMapQ);
+        options.pessimisticMapQ,
+        options.outputFormat,
+        options.bamStreamDestination,
+        options.coverageTileSize);
 
     const boost::filesystem::path stateFilePath = options.tempDirectory / "AlignerState.txt";
 
-    if (isaac::workflow::AlignWorkflow::Start != options.startFrom)
+    if (!options.gatherTempDirectoryList.empty())
+    {
+        workflow.gather(options.gatherTempDirectoryList, options.gatherOutputDirectoryList);
+        isaac::workflow::save(stateFilePath, workflow);
+    }
+    else if (isaac::workflow::AlignWorkflow::Start != options.startFrom)
     {
         isaac::workflow::load(stateFilePath, workflow);
     }
@@ -0,0 +1,39 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file isaac-reference-server.cpp
+ **
+ ** \brief User-facing executable that keeps the references loaded for the alignment jobs running on the node
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include "common/Debug.hh"
+#include "options/ReferenceServerOptions.hh"
+#include "reference/ReferenceServer.hh"
+
+void serveReferences(const isaac::options::ReferenceServerOptions &options)
+{
+    isaac::reference::ReferenceServer server(
+        options.socketPath_,
+        options.sortedReferenceMetadataList_,
+        options.jobs_,
+        options.referencesMax_,
+        options.clientTimeoutSeconds_);
+
+    server.run();
+}
+
+int main(int argc, char *argv[])
+{
+    isaac::common::run(serveReferences, argc, argv);
+}
@@ -20,6 +20,7 @@
 #ifndef iSAAC_ALIGNMENT_ALIGNMENT_HH
 #define iSAAC_ALIGNMENT_ALIGNMENT_HH
 
+#include <emmintrin.h>
 #include <string>
 #include <vector>
 #include <stdint.h>
@@ -46,6 +47,39 @@ inline bool isMatch(const char readBase, const char referenceBase)
     return readBase == 'n' || (readBase == referenceBase && referenceBase != 'N');
 }
 
+/**
+ * \brief Compares 16 bases at a time according to isMatch
+ *
+ * \param editMask receives bits set for the bases that differ, including the ones that isMatch considers matching
+ * \return bits set for the bases that are mismatches
+ */
+inline unsigned compareBases16(const char *sequence, const char *reference, unsigned &editMask)
+{
+    const __m128i sequenceBases = _mm_loadu_si128(reinterpret_cast<const __m128i *>(sequence));
+    const __m128i referenceBases = _mm_loadu_si128(reinterpret_cast<const __m128i *>(reference));
+    const __m128i equal = _mm_cmpeq_epi8(sequenceBases, referenceBases);
+    const __m128i sequenceN = _mm_cmpeq_epi8(sequenceBases, _mm_set1_epi8('n'));
+    const __m128i referenceN = _mm_cmpeq_epi8(referenceBases, _mm_set1_epi8('N'));
+    const __m128i match = _mm_or_si128(sequenceN, _mm_andnot_si128(referenceN, equal));
+    editMask = ~_mm_movemask_epi8(equal) & 0xffff;
+    return ~_mm_movemask_epi8(match) & 0xffff;
+}
+
+/**
+ * \brief Scalar version of compareBases16 for the tail of the operation
+ */
+inline unsigned compareBases(const char *sequence, const char *reference, const unsigned length, unsigned &editMask)
+{
+    unsigned mismatchMask = 0;
+    editMask = 0;
+    for (unsigned i = 0; length > i; ++i)
+    {
+        mismatchMask |= unsigned(!isMatch(sequence[i], reference[i])) << i;
+        editMask |= unsigned(sequence[i] != reference[i]) << i;
+    }
+    return mismatchMask;
+}
+
 /**
  * \brief moves sequenceBegin to the first position followed by CONSECUTIVE_MATCHES_MAX matches
  *
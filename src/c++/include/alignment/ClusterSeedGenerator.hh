@@ -81,6 +81,14 @@ public:
         return BaseT::nextTileSeedBegins_;
     }
 
+    /**
+     * \brief end of the seeds of known high-repeat k-mers which follow getReferenceSeedBounds().back()
+     */
+    typename std::vector<Seed<KmerT> >::iterator getRepeatSeedsEnd() const
+    {
+        return BaseT::getRepeatSeedsEnd();
+    }
+
 private:
     // The mutex guards acquisition of the next tile and the destination of the seeds
     boost::mutex mutex_;
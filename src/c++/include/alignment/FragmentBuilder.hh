@@ -57,6 +57,7 @@ public:
         const int gapOpenScore,
         const int gapExtendScore,
         const int minGapExtendScore,
+        const bool fixedPointScoring,
         const unsigned semialignedGapLimit);
 
     bool build(
@@ -61,6 +61,12 @@ public:
      **/
     void initialize(const isaac::reference::SortedReferenceMetadataList &sortedReferenceMetadataList);
 
+    /**
+     ** \brief Set the count of each bin to 1 so that the layouts derived from the distribution
+     ** depend on the reference only.
+     **/
+    void makeUniform();
+
     /**
      ** \brief Consolidate all the partial match distribution
      ** given as a parameter.
@@ -27,6 +27,7 @@
 #include <boost/lambda/lambda.hpp>
 #include <boost/lambda/bind.hpp>
 #include <boost/noncopyable.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
 #include <boost/thread/mutex.hpp>
 
 #include "alignment/SeedMetadata.hh"
@@ -41,6 +42,8 @@
 #include "io/FileBufCache.hh"
 #include "io/MatchWriter.hh"
 #include "oligo/Kmer.hh"
+#include "reference/CompressedMaskFile.hh"
+#include "reference/MaskPrefixIndex.hh"
 #include "reference/ReferenceKmer.hh"
 #include "statistics/MatchFinderTileStats.hh"
 
@@ -65,6 +68,7 @@ public:
         const flowcell::ReadMetadataList &readMetadataList,
         const SeedMetadataList &seedMetadataList,
         const unsigned iteration,
+        const bool closeRepeats,
         const bool ignoreNeighbors,
         const bool ignoreRepeats,
         const unsigned repeatThreshold,
@@ -78,6 +82,14 @@ public:
 
     void setTiles(const flowcell::TileMetadataList &tiles);
 
+    /**
+     ** \brief Stores TooManyMatch for the seeds of k-mers known to be high repeats in the reference without
+     **        looking them up in the mask files. The outcome is the same as if the seeds were matched.
+     **/
+    void storeRepeatMatches(
+        const typename std::vector<SeedT>::const_iterator repeatSeedsBegin,
+        const typename std::vector<SeedT>::const_iterator repeatSeedsEnd);
+
     /**
      ** \brief Find all the matches for the given list of seeds
      **
@@ -119,6 +131,10 @@ private:
         unsigned maskWidth_;
         unsigned mask_;
         boost::filesystem::path maskFilePath_;
+        // not loaded for references sorted before the prefix indexes were introduced
+        reference::MaskPrefixIndex prefixIndex_;
+        // not loaded for mask files stored in raw format
+        reference::CompressedMaskIndex compressedIndex_;
 
         std::size_t getPathSize() const {return maskFilePath_.string().size();}
     };
@@ -135,6 +151,8 @@ private:
 //    const std::map<std::string, std::vector<boost::filesystem::path> > maskFiles_;
     /// the current iteration
     const unsigned iteration_;
+    /// mark the reads which have seeds hitting repeats as complete
+    const bool closeRepeats_;
     const bool ignoreNeighbors_;
     // if set, repeat matches will not be reported to match selector, therefore it will try
     // to place fragmets into dodgy locations while boosting the % aligned
@@ -156,6 +174,8 @@ private:
 
     io::TileMatchWriter matchWriter_;
     std::vector<io::FileBufCache<io::FileBufWithReopen> > threadReferenceFileBuffers_;
+    /// decoders of compressed mask files, one per thread, preallocated to avoid allocations during matching
+    boost::ptr_vector<reference::CompressedMaskStreamBuf<KmerT> > threadMaskDecoders_;
 
 
     mutable boost::mutex mutex_;
@@ -175,6 +195,11 @@ private:
         typename KmerSourceMetadataList::const_iterator &kmerSourceIterator,
         const unsigned threadNumber);
 
+    void storeRepeatMatchesParallel(
+        const typename std::vector<SeedT>::const_iterator repeatSeedsBegin,
+        const typename std::vector<SeedT>::const_iterator repeatSeedsEnd,
+        const unsigned threadNumber);
+
     std::pair<typename std::vector<SeedT>::const_iterator, typename std::vector<SeedT>::const_iterator>
         skipToTheNextMask(
         const typename std::vector<SeedT>::const_iterator currentBegin,
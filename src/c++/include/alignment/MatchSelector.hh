@@ -39,12 +39,14 @@
 #include "alignment/TemplateLengthStatistics.hh"
 #include "alignment/matchSelector/BufferingFragmentStorage.hh"
 #include "alignment/matchSelector/MatchSelectorStats.hh"
+#include "alignment/matchSelector/MatchSelectorStatsXml.hh"
 #include "alignment/matchSelector/ParallelMatchLoader.hh"
 #include "alignment/matchSelector/SemialignedEndsClipper.hh"
 #include "alignment/matchSelector/OverlappingEndsClipper.hh"
 #include "common/Threads.hpp"
 #include "flowcell/BarcodeMetadata.hh"
 #include "reference/Contig.hh"
+#include "reference/SharedContigs.hh"
 #include "reference/SortedReferenceMetadata.hh"
 #include "io/FiltersMapper.hh"
 
@@ -65,6 +67,7 @@ public:
         matchSelector::FragmentStorage &fragmentStorage,
         const MatchDistribution &matchDistribution,
         const reference::SortedReferenceMetadataList &sortedReferenceMetadataList,
+        const reference::SharedContigsList &sharedContigsList,
         unsigned int maxThreadCount,
         const TileMetadataList &tileMetadataList,
         const flowcell::BarcodeMetadataList &barcodeMetadataList,
@@ -87,8 +90,10 @@ public:
         const int gapOpenScore,
         const int gapExtendScore,
         const int minGapExtendScore,
+        const bool fixedPointScoring,
         const unsigned semialignedGapLimit,
-        const TemplateBuilder::DodgyAlignmentScore dodgyAlignmentScore);
+        const TemplateBuilder::DodgyAlignmentScore dodgyAlignmentScore,
+        const boost::filesystem::path &tempDirectory);
 
     /**
      * \brief frees the major memory reservations to make it safe to use dynamic memory allocations again
@@ -104,6 +109,20 @@ public:
 
     void dumpStats(const boost::filesystem::path &statsXmlPath);
 
+    /**
+     * \brief Takes the statistics of the tile that has just been selected. Must be called before the next
+     *        parallelSelect and after the previous flushTileStats
+     */
+    void prepareFlushTileStats(const flowcell::TileMetadata &tileMetadata);
+    /// stores the statistics taken by prepareFlushTileStats so that they can be restored by the restarted run
+    void saveTileStats(const flowcell::TileMetadata &tileMetadata, const boost::filesystem::path &statsPath) const;
+    /**
+     * \brief Formats the statistics taken by prepareFlushTileStats into the stats xml spool. Can run concurrently
+     *        with the parallelSelect of the next tile.
+     */
+    void flushTileStats(const flowcell::TileMetadata &tileMetadata);
+    void loadTileStats(const flowcell::TileMetadata &tileMetadata, const boost::filesystem::path &statsPath);
+
     void parallelSelect(
         const MatchTally &matchTally,
         std::vector<alignment::TemplateLengthStatistics> &barcodeTemplateLengthStatistics,
@@ -136,8 +155,11 @@ private:
     const bool clipOverlapping_;
     const std::vector<matchSelector::SequencingAdapterList> barcodeSequencingAdapters_;
 
-    std::vector<matchSelector::MatchSelectorStats> allStats_;
     std::vector<matchSelector::MatchSelectorStats> threadStats_;
+    // statistics of the tile between prepareFlushTileStats and flushTileStats
+    matchSelector::MatchSelectorStats flushStats_;
+    unsigned flushStatsTileIndex_;
+    matchSelector::MatchSelectorStatsXml statsXml_;
 
     const MatchDistribution &matchDistribution_;
     /**
@@ -78,6 +78,9 @@ public:
     }
 
     void addTile(const flowcell::TileMetadata& tile);
+
+    /// replace the tally of a tile with the one recorded earlier, for example by the interrupted run
+    void restoreTile(const flowcell::TileMetadata &tileMetadata, const FileTallyList &fileTallyList);
     inline void swap(MatchTally &another)
     {
         allTallies_.swap(another.allTallies_);
@@ -80,6 +80,25 @@ public:
         return logMismatchLookup[quality];
     }
 
+    /// number of fraction bits in the fixed-point log probabilities
+    static const unsigned FIXED_LOG_PROBABILITY_FRACTION_BITS = 16;
+
+    /**
+     * \brief Fixed-point equivalent of getLogMatch (mismatch == false) or getLogMismatchFast (mismatch == true).
+     *        The two values of a quality are adjacent in the lookup so that the choice does not require a branch.
+     */
+    static int getFixedLogProbability(const unsigned int quality, const bool mismatch)
+    {
+        ISAAC_ASSERT_MSG(quality * 2 < fixedLogProbabilityLookup.size(),
+                         (boost::format("Incorrect quality %u ") % quality).str().c_str());
+        return fixedLogProbabilityLookup[quality * 2 + mismatch];
+    }
+
+    static double fixedToLogProbability(const long fixedLogProbability)
+    {
+        return double(fixedLogProbability) / double(1 << FIXED_LOG_PROBABILITY_FRACTION_BITS);
+    }
+
     /**
      ** \brief Return the 'rest of the genome' correction for uniquely aligned reads
      **
@@ -95,6 +114,8 @@ private:
     static const std::vector<double> logMatchLookup;
     /// lookup for log of probability of a mismatch for a given quality
     static const std::vector<double> logMismatchLookup;
+    /// interleaved fixed-point log probabilities of match and mismatch for a given quality
+    static const std::vector<int> fixedLogProbabilityLookup;
 };
 
 static const double LOG_MISMATCH_Q40 = Quality::getLogMismatch(40);
@@ -34,6 +34,7 @@
 #include "flowcell/TileMetadata.hh"
 #include "flowcell/ReadMetadata.hh"
 #include "oligo/Kmer.hh"
+#include "reference/RepeatKmerFilter.hh"
 #include "reference/SortedReferenceMetadata.hh"
 
 namespace isaac
@@ -71,6 +72,16 @@ public:
         return nextTileSeedBegins_;
     }
 
+    /**
+     * \brief Seeds of the k-mers that are known to have too many matches in the reference don't need to be
+     *        sorted or matched. They are stored unsorted between getReferenceSeedBounds().back() and
+     *        the returned iterator
+     */
+    typename std::vector<Seed<KmerT> >::iterator getRepeatSeedsEnd() const
+    {
+        return repeatSeedsEnd_;
+    }
+
 protected:
     const flowcell::BarcodeMetadataList &barcodeMetadataList_;
     const flowcell::Layout &flowcellLayout_;
@@ -85,6 +96,7 @@ protected:
      * \brief Geometry: [reference]
      */
     typename std::vector<typename std::vector<Seed<KmerT> >::iterator> nextTileSeedBegins_;
+    typename std::vector<Seed<KmerT> >::iterator repeatSeedsEnd_;
 
     void reset(const flowcell::TileMetadataList &tiles, std::vector<Seed<KmerT> > &seeds,
                const matchFinder::TileClusterInfo &tileClusterBarcode);
@@ -97,6 +109,30 @@ protected:
         const unsigned threadsMax);
 
 private:
+    /**
+     * \brief Geometry: [reference]. Filters are empty for references sorted by older versions
+     */
+    std::vector<reference::RepeatKmerFilter<KmerT> > referenceRepeatFilters_;
+    /**
+     * \brief Geometry: [thread]. End of non-repeat seeds in the part of the reference seeds processed by the thread
+     */
+    std::vector<typename std::vector<Seed<KmerT> >::iterator> threadRepeatSeedsBegins_;
+
+    static std::vector<reference::RepeatKmerFilter<KmerT> > loadRepeatFilters(
+        const reference::SortedReferenceMetadataList &sortedReferenceMetadataList);
+
+    void separateRepeatSeeds(
+        std::vector<Seed<KmerT> > &seeds,
+        isaac::common::ThreadVector &threads,
+        const unsigned threadsMax);
+
+    void partitionRepeatSeeds(
+        const typename std::vector<Seed<KmerT> >::iterator referenceSeedsBegin,
+        const typename std::vector<Seed<KmerT> >::iterator referenceSeedsEnd,
+        const reference::RepeatKmerFilter<KmerT> &repeatFilter,
+        const unsigned threadsMax,
+        const unsigned threadNumber);
+
     /// Return the count of seeds for each read
     std::vector<unsigned> getSeedCounts(
         const std::vector<flowcell::ReadMetadata> &readMetadataList,
@@ -113,6 +149,16 @@ private:
 
 };
 
+/**
+ * \brief Moves the repeat seeds stored between referenceSeedBounds.back() and repeatSeedsEnd back into the
+ *        ranges of their references and adjusts referenceSeedBounds so that each range contains all the seeds
+ *        of the reference again. The repeat seeds are not sorted. The ranges have to be sorted before matching.
+ */
+template <typename KmerT>
+void mergeRepeatSeeds(
+    const flowcell::BarcodeMetadataList &barcodeMetadataList,
+    const typename std::vector<Seed<KmerT> >::iterator repeatSeedsEnd,
+    std::vector<typename std::vector<Seed<KmerT> >::iterator> &referenceSeedBounds);
 
 } // namespace alignment
 } // namespace isaac
@@ -21,6 +21,7 @@
 #define iSAAC_ALIGNMENT_SEED_LOADER_HH
 
 #include <vector>
+#include <boost/cstdint.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/noncopyable.hpp>
 #include <boost/thread/mutex.hpp>
@@ -30,6 +31,7 @@
 #include "alignment/SeedMetadata.hh"
 #include "common/Threads.hpp"
 #include "alignment/matchFinder/TileClusterInfo.hh"
+#include "common/MemoryGovernor.hh"
 #include "flowcell/BarcodeMetadata.hh"
 #include "flowcell/TileMetadata.hh"
 #include "flowcell/ReadMetadata.hh"
@@ -57,11 +59,15 @@ public:
      ** Note: all parameters are kept as references and it is the
      ** responsibility of the caller to ensure appropriate life time for the
      ** referenced variables.
+     **
+     ** The number of loader threads is reduced below inputLoadersMax if memoryGovernor cannot fit
+     ** the per-thread cycle block buffers.
      **/
     ParallelSeedLoader(
         const bool ignoreMissingBcls,
         common::ThreadVector &threads,
         boost::ptr_vector<rta::SingleCycleBclMapper<ReaderT> > &threadBclMappers,
+        common::MemoryGovernor &memoryGovernor,
         const unsigned inputLoadersMax,
         const unsigned coresMax,
         const flowcell::BarcodeMetadataList &barcodeMetadataList,
@@ -83,7 +89,25 @@ public:
         return BaseT::nextTileSeedBegins_;
     }
 
+    /**
+     * \brief end of the seeds of known high-repeat k-mers which follow getReferenceSeedBounds().back()
+     */
+    typename std::vector<Seed<KmerT> >::iterator getRepeatSeedsEnd() const
+    {
+        return BaseT::getRepeatSeedsEnd();
+    }
+
 private:
+    /**
+     * \brief Bases of consecutive cycles of a cluster packed 2 bits per base with the first cycle in the
+     *        highest bits. The highest bit is set if any of the bases is an N.
+     */
+    typedef boost::uint16_t ClusterBases;
+    static const ClusterBases CLUSTER_BASES_N_FLAG = 0x8000;
+    /// maximum number of cycles accumulated in ClusterBases before the seeds get updated
+    static const unsigned CYCLE_BLOCK_MAX = 7;
+    static const ClusterBases CLUSTER_BASES_MASK = (1 << (CYCLE_BLOCK_MAX * oligo::BITS_PER_BASE)) - 1;
+
     // The mutex used to acquire the next tile and the destination of the seeds
     boost::mutex mutex_;
     const unsigned inputLoadersMax_;
@@ -96,6 +120,11 @@ private:
      */
     std::vector<std::vector<typename std::vector<Seed<KmerT> >::iterator> > threadDestinations_;
     std::vector<std::vector<typename std::vector<Seed<KmerT> >::iterator> > threadCycleDestinations_;
+    /**
+     * \brief Geometry: [thread][cluster]. Bases of the cycle block being loaded. Allows updating each seed
+     *        once per block of cycles instead of once per cycle.
+     */
+    std::vector<std::vector<ClusterBases> > threadClusterBases_;
 
     common::ThreadVector &threads_;
     boost::ptr_vector<rta::SingleCycleBclMapper<ReaderT> > &threadBclMappers_;
@@ -106,16 +135,32 @@ private:
         const std::vector<flowcell::TileMetadata>::const_iterator tilesEnd,
         const unsigned threadNumber);
 
-    void loadTileCycle(
+    bool allSeedsContainCycle(
+        const unsigned cycle,
+        std::vector<SeedMetadata>::const_iterator cycleSeedsBegin,
+        const std::vector<SeedMetadata>::const_iterator cycleSeedsEnd) const;
+
+    static void accumulateCycle(
+        const char *bcl,
+        const unsigned clusterCount,
+        const bool firstCycleInBlock,
+        std::vector<ClusterBases> &clusterBases);
+
+    void loadTileCycleBlock(
         const matchFinder::TileClusterInfo &tileClusterBarcode,
-        rta::SingleCycleBclMapper<ReaderT> &bclMapper,
+        const std::vector<ClusterBases> &clusterBases,
         std::vector<typename std::vector<Seed<KmerT> >::iterator> &destinationBegins,
         const flowcell::TileMetadata &tile,
-        const unsigned cycle,
+        const unsigned blockCycles,
         std::vector<SeedMetadata>::const_iterator cycleSeedsBegin,
         const std::vector<SeedMetadata>::const_iterator cycleSeedsEnd);
 
     std::vector<unsigned> discoverSeedCycles() const;
+
+    static unsigned getLoadersMax(
+        common::MemoryGovernor &memoryGovernor,
+        const unsigned inputLoadersMax,
+        const unsigned maxTileClusters);
 };
 
 } // namespace alignment
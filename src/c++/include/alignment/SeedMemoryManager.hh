@@ -25,6 +25,7 @@
 
 #include "alignment/Seed.hh"
 #include "alignment/SeedMetadata.hh"
+#include "common/MemoryGovernor.hh"
 #include "common/Threads.hpp"
 #include "alignment/matchFinder/TileClusterInfo.hh"
 #include "flowcell/BarcodeMetadata.hh"
@@ -46,6 +47,7 @@ public:
     typedef flowcell::ReadMetadataList ReadMetadataList;
 
     SeedMemoryManager(
+        common::MemoryGovernor &memoryGovernor,
         const flowcell::BarcodeMetadataList &barcodeMetadataList,
         const ReadMetadataList &readMetadataList,
         const SeedMetadataList &seedMetadataList,
@@ -60,6 +62,7 @@ public:
     void allocate(const TileMetadataList &tiles, std::vector<SeedT> &seeds) const;
 
 private:
+    common::MemoryGovernor &memoryGovernor_;
     const flowcell::BarcodeMetadataList &barcodeMetadataList_;
     const ReadMetadataList &readMetadataList_;
     const SeedMetadataList &seedMetadataList_;
@@ -26,6 +26,7 @@
 #include <utility>
 #include <iostream>
 
+#include <boost/bind.hpp>
 #include <boost/foreach.hpp>
 
 #include "common/Debug.hh"
@@ -128,6 +129,58 @@ inline std::vector<unsigned> getAllSeedCycles(
     return ret;
 }
 
+/**
+ ** \brief Return the list of seed indexes to use for each match finder iteration.
+ **
+ ** The schedule is computed per read. The first firstPassSeeds seeds of each read are used for the
+ ** first iteration. If the read has more seeds, its last seeds always go to the last iteration, which
+ ** is the one that performs the neighbor search, closes the reads hitting repeats and stores the
+ ** no-matches. The seeds in between are spread one per intermediate iteration. This way reads with
+ ** only a few seeds don't get stuck in the intermediate iterations.
+ **
+ ** The outer vector is for the successive iterations. The inner vector is the list of seed indexes
+ ** (in the seedMetadataList) to use for each iteration. Iterations other than the first one that
+ ** get no seeds are removed.
+ **/
+inline std::vector<std::vector<unsigned> > getSeedIndexListPerIteration(
+    const flowcell::ReadMetadataList &readMetadataList,
+    const SeedMetadataList &seedMetadataList,
+    const unsigned firstPassSeeds,
+    const unsigned seedIterations)
+{
+    ISAAC_ASSERT_MSG(2 <= seedIterations, "At least two iterations are required");
+    std::vector<unsigned> seedsPerRead(readMetadataList.size(), 0);
+    BOOST_FOREACH(const SeedMetadata &seedMetadata, seedMetadataList)
+    {
+        ISAAC_ASSERT_MSG(seedsPerRead.size() > seedMetadata.getReadIndex(), "Seed read index is out of range");
+        ++seedsPerRead[seedMetadata.getReadIndex()];
+    }
+
+    std::vector<std::vector<unsigned> >seedIndexListPerIteration(seedIterations);
+    std::vector<unsigned> countsPerRead(readMetadataList.size(), 0);
+    BOOST_FOREACH(const SeedMetadata &seedMetadata, seedMetadataList)
+    {
+        const unsigned readSeed = countsPerRead[seedMetadata.getReadIndex()]++;
+        const unsigned readSeeds = seedsPerRead[seedMetadata.getReadIndex()];
+        unsigned iteration = 0;
+        if (firstPassSeeds <= readSeed)
+        {
+            // keep at least one seed of the read for the last iteration
+            const unsigned intermediateIterations =
+                std::min(readSeeds - firstPassSeeds - 1, seedIterations - 2);
+            const unsigned intermediateSeed = readSeed - firstPassSeeds;
+            iteration = intermediateIterations > intermediateSeed ? intermediateSeed + 1 : seedIterations - 1;
+        }
+        seedIndexListPerIteration[iteration].push_back(seedMetadata.getIndex());
+    }
+
+    // remove iterations without any seeds
+    seedIndexListPerIteration.erase(
+        std::remove_if(seedIndexListPerIteration.begin() + 1, seedIndexListPerIteration.end(),
+                       boost::bind(&std::vector<unsigned>::empty, _1)),
+        seedIndexListPerIteration.end());
+    return seedIndexListPerIteration;
+}
 
 inline std::ostream &operator<<(std::ostream &os, const SeedMetadata &seedMetadata)
 {
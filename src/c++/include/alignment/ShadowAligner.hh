@@ -56,7 +56,8 @@ public:
                   const int gapMismatchScore,
                   const int gapOpenScore,
                   const int gapExtendScore,
-                  const int minGapExtendScore);
+                  const int minGapExtendScore,
+                  const bool fixedPointScoring);
     /**
      ** \brief Helper method to align the shadow of an orphan.
      **
@@ -87,8 +88,21 @@ public:
         const TemplateLengthStatistics &templateLengthStatistics,
         const long bestTemplateLength);
     const Cigar &getCigarBuffer() const {return shadowCigarBuffer_;}
+
+    /**
+     ** \brief Find all candidate positions for a shadow sequence on a given reference interval
+     **
+     ** \return sorted unique positions relative to referenceBegin. Valid until the next call
+     **/
+    const std::vector<long> &findShadowCandidatePositions(
+        const std::vector<char> &reference,
+        const long referenceBegin,
+        const long referenceEnd,
+        const std::vector<char> &shadowSequence);
 private:
     static const unsigned unreasonablyHighDifferenceBetweenMaxAndMinInsertSizePlusFlanks_ = 10000;
+    /// Widest reference range for which the k-mers are cached. Wider ones are scanned with oligo::KmerGenerator
+    static const long referenceKmersMax_ = unreasonablyHighDifferenceBetweenMaxAndMinInsertSizePlusFlanks_;
 
     /// Length of the k-mers used to rescue shadows and misaligned reads
     static const unsigned shadowKmerLength_ = 7;
@@ -102,14 +116,23 @@ private:
      ** Note that this is a really fast and cheap but imperfect to rescue
      ** shadows or mis-aligned reads. The index used to access elements in the
      ** vector is made from a k-mer of length shadowKmerLength_ (the vector has
-     ** 4 ^ shadowKmerLength_ positions). The values in the table at position i
-     ** is the first position in the read where the k-mer was found (-1 if not
-     ** found). Repeats are recorded only once in the table. This allows to
-     ** identify extremely quickly if a k-mer in the reference belongs to the
-     ** read. The shadowKmerLength_ should stay small enough to ensure that the
-     ** table stays in the L1 cache.
+     ** 4 ^ shadowKmerLength_ positions). The value in the table at position i
+     ** is the first position in the read where the k-mer was found. Repeats are
+     ** recorded only once in the table. This allows to identify extremely quickly
+     ** if a k-mer in the reference belongs to the read. The shadowKmerLength_
+     ** should stay small enough to ensure that the table stays in the L1 cache.
+     **
+     ** Entries are valid only when their epoch matches shadowKmerEpoch_. This
+     ** way the table does not need to be cleared for every shadow.
      **/
-    std::vector<short> shadowKmerPositions_;
+    struct ShadowKmerPosition
+    {
+        ShadowKmerPosition() : epoch_(0), position_(0){}
+        unsigned short epoch_;
+        short position_;
+    };
+    std::vector<ShadowKmerPosition> shadowKmerPositions_;
+    unsigned short shadowKmerEpoch_;
     Cigar shadowCigarBuffer_;
     /// Hash all the k-mers of length shadowKmerLength_ into shadowKmerPositions_
     unsigned hashShadowKmers(const std::vector<char> &sequence);
@@ -121,11 +144,27 @@ private:
      ** to the beginning of the reference).
      **/
     std::vector<long> shadowCandidatePositions_;
-    /// Find all candidate positions for a shadow sequence on a given reference interval
-    void findShadowCandidatePositions(
-        const std::vector<char>::const_iterator referenceBegin,
-        const std::vector<char>::const_iterator referenceEnd,
-        const std::vector<char> &shadowSequence);
+
+    /// k-mer value for the reference positions where the k-mer contains bases other than A, C, G or T
+    static const unsigned short INVALID_REFERENCE_KMER = 0xFFFF;
+    /**
+     ** \brief Cached k-mers of the reference region scanned by the last findShadowCandidatePositions.
+     **
+     ** Orphans of the same cluster often point at the same region. When the next region falls within
+     ** the cached one, the k-mers are not recomputed.
+     **/
+    const std::vector<char> *referenceKmersContig_;
+    long referenceKmersBegin_;
+    long referenceKmersEnd_;
+    /// k-mer starting at each position of the cached region, INVALID_REFERENCE_KMER if it contains an N
+    std::vector<unsigned short> referenceKmers_;
+    /// 2-bit codes of the bases of the cached region. Anything other than A, C, G, T has 0x80 set
+    std::vector<char> referenceCodes_;
+    void generateReferenceKmers(
+        const std::vector<char> &reference,
+        const long begin,
+        const long end);
+    bool storeShadowCandidatePosition(const long candidatePosition);
 };
 
 } // namespace alignment
@@ -78,6 +78,7 @@ public:
         const int gapOpenScore,
         const int gapExtendScore,
         const int minGapExtendScore,
+        const bool fixedPointScoring,
         const unsigned semialignedGapLimit,
         const DodgyAlignmentScore dodgyAlignmentScore);
 
@@ -150,6 +151,8 @@ private:
 
     const bool scatterRepeats_;
     const DodgyAlignmentScore dodgyAlignmentScore_;
+    // compute the probability of each fragment once when enumerating the pairs
+    const bool fixedPointScoring_;
 
     /// Helper component to align fragments individually
     FragmentBuilder fragmentBuilder_;
@@ -244,6 +247,9 @@ private:
 //    common::FiniteCapacityVector<PairProbability, TRACKED_REPEATS_MAX_ONE_READ * TRACKED_REPEATS_MAX_ONE_READ * readsMax_> allPairProbabilities_;
     std::vector<PairProbability> allPairProbabilities_;
 
+    /// exp(logProbability) of each fragment built by fragmentBuilder_
+    std::vector<double> fragmentProbabilities_[readsMax_];
+
 
 
     common::FiniteCapacityVector<FragmentMetadata, TRACKED_REPEATS_MAX_ONE_READ> bestOrphanShadows_[readsMax_];
@@ -333,7 +339,7 @@ private:
     void locateBestPair(
         const std::vector<std::vector<FragmentMetadata> > &fragments,
         const TemplateLengthStatistics &templateLengthStatistics,
-        TemplateBuilder::BestPairInfo &ret) const;
+        TemplateBuilder::BestPairInfo &ret);
     /// Helper method to build a paired-end template
     bool buildPairedEndTemplate(
         const RestOfGenomeCorrection &restOfGenomeCorrection,
@@ -45,13 +45,16 @@ public:
         const int gapMismatchScore,
         const int gapOpenScore,
         const int gapExtendScore,
-        const int minGapExtendScore);
+        const int minGapExtendScore,
+        const bool fixedPointScoring);
 
 protected:
     const unsigned normalizedMismatchScore_;
     const unsigned normalizedGapOpenScore_;
     const unsigned normalizedGapExtendScore_;
     const unsigned normalizedMaxGapExtendScore_;
+    // accumulate log probabilities in fixed point instead of summing up doubles
+    const bool fixedPointScoring_;
 
     unsigned updateFragmentCigar(
         const flowcell::ReadMetadataList &readMetadataList,
@@ -61,6 +64,22 @@ protected:
         const Cigar &cigarBuffer,
         const unsigned cigarOffset) const;
 
+    /**
+     * \brief fixed-point equivalent of scoring the bases of one ALIGN operation in updateFragmentCigar
+     *
+     * \return number of matching bases
+     */
+    unsigned scoreAlignedBasesFixedPoint(
+        const std::vector<char> &sequence,
+        const std::vector<char> &quality,
+        const unsigned firstBase,
+        std::vector<char>::const_iterator reference,
+        const unsigned length,
+        const unsigned firstCycle,
+        const unsigned lastCycle,
+        FragmentMetadata &fragmentMetadata,
+        long &fixedLogProbability) const;
+
     static void clipReference(
         const long referenceSize,
         FragmentMetadata &fragment,
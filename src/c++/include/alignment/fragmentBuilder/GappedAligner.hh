@@ -41,7 +41,8 @@ public:
         const int gapMismatchScore,
         const int gapOpenScore,
         const int gapExtendScore,
-        const int minGapExtendScore);
+        const int minGapExtendScore,
+        const bool fixedPointScoring);
 
     /**
      ** \brief Calculate the gapped alignment of a fragment
@@ -45,6 +45,7 @@ public:
         const int gapOpenScore,
         const int gapExtendScore,
         const int minGapExtendScore,
+        const bool fixedPointScoring,
         const unsigned semialignedGapLimit);
 
     void alignSimpleIndels(
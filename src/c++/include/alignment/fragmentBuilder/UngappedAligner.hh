@@ -45,7 +45,8 @@ public:
         const int gapMismatchScore,
         const int gapOpenScore,
         const int gapExtendScore,
-        const int minGapExtendScore);
+        const int minGapExtendScore,
+        const bool fixedPointScoring);
 
     /**
      ** \brief Calculate the ungapped alignment of a fragment
@@ -27,6 +27,7 @@
 #include "alignment/Seed.hh"
 #include "io/MatchWriter.hh"
 #include "oligo/Kmer.hh"
+#include "reference/MaskPrefixIndex.hh"
 #include "reference/ReferenceKmer.hh"
 namespace isaac
 {
@@ -71,6 +72,7 @@ public:
         MatchDistribution &matchDistribution,
         std::vector<ReferenceKmerT> &threadRepeatList,
         io::TileMatchWriter &matchWriter,
+        const reference::MaskPrefixIndex &prefixIndex,
         std::istream &reference);
 
     void generateTooManyMatches(
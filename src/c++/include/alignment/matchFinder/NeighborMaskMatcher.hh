@@ -27,6 +27,7 @@
 #include "alignment/Seed.hh"
 #include "io/MatchWriter.hh"
 #include "oligo/Kmer.hh"
+#include "reference/MaskPrefixIndex.hh"
 #include "reference/ReferenceKmer.hh"
 
 namespace isaac
@@ -62,6 +63,7 @@ public:
         std::vector<ReferenceKmerT> &threadRepeatList,
         std::vector<ReferenceKmerT> &threadNeighborsList,
         io::TileMatchWriter &matchWriter,
+        const reference::MaskPrefixIndex &prefixIndex,
         std::istream &reference);
 
 private:
@@ -12,8 +12,13 @@
  **
  ** \file BinningFragmentStorage.hh
  **
- ** \brief Stores fragments in bin files without buffering.
- ** 
+ ** \brief Stores fragments in bin files without buffering the whole tile.
+ **
+ ** Compute threads pack fragments into their own staging buffers without locking. Full buffers are queued for
+ ** writing. One thread at a time acts as the writer: the compute thread that queues a buffer while nobody is
+ ** writing drains the queue. The writer groups the fragments by bin, does the bin metadata accounting and
+ ** appends each group to its bin file with a single write.
+ **
  ** \author Roman Petrovski
  **/
 
@@ -26,8 +31,10 @@
 #include <boost/thread.hpp>
 
 #include "alignment/MatchDistribution.hh"
+#include "common/MemoryGovernor.hh"
 #include "common/Threads.hpp"
 #include "io/FileBufCache.hh"
+#include "io/Fragment.hh"
 
 #include "BinIndexMap.hh"
 #include "FragmentStorage.hh"
@@ -44,6 +51,15 @@ namespace bfs = boost::filesystem;
 class BinningFragmentStorage: boost::noncopyable, public FragmentStorage
 {
 public:
+    /// Large enough for the fragments of a bin to be appended in sizeable chunks
+    static const unsigned STAGING_BUFFER_BYTES_DEFAULT = 4 * 1024 * 1024;
+    /// number of reads a cluster can have. Unaligned reads are keyed by tile * maxTileClusters * READS_MAX
+    static const unsigned READS_MAX = 2;
+
+    /**
+     * \param stagingBufferBytes  size of each staging buffer. Buffers smaller than a template are rounded up,
+     *                            so 0 hands every template to the writer as soon as the next one is added
+     */
     BinningFragmentStorage(
         const bool keepUnaligned,
         const bool preSortBins,
@@ -55,18 +71,18 @@ public:
         const flowcell::FlowcellLayoutList &flowcellLayoutList,
         const flowcell::BarcodeMetadataList &barcodeMetadataList,
         const unsigned long maxTileClusters,
-        const unsigned long totalTiles);
+        const unsigned long totalTiles,
+        const unsigned stagingBufferBytes,
+        common::MemoryGovernor &memoryGovernor);
 
-    virtual void close(alignment::BinMetadataList &binPathList) {binPathList_.swap(binPathList);}
+    virtual void close(alignment::BinMetadataList &binPathList);
 
-    virtual void add(const BamTemplate &bamTemplate, const unsigned barcodeIdx);
+    virtual void add(const BamTemplate &bamTemplate, const unsigned barcodeIdx, const unsigned threadNumber);
 
-    virtual void prepareFlush()
-    {
-    }
-    virtual void flush()
-    {
-    }
+    /// hands the partially filled staging buffers over to the writer. Compute threads must be idle.
+    virtual void prepareFlush();
+    /// stores everything handed over before the last prepareFlush
+    virtual void flush();
     virtual void resize(const unsigned long clusters)
     {
     }
@@ -74,18 +90,68 @@ public:
     {
     }
 
+    /**
+     * \brief updates the binMetadata counters for the fragment stored in the bin
+     *
+     * \param maxTileReads  maxTileClusters * READS_MAX of the tile list the header tile_ indexes
+     */
+    static void accountFragment(
+        const io::FragmentHeader &header,
+        const unsigned long maxTileReads,
+        BinMetadata &binMetadata);
+
 private:
-    static const unsigned READS_MAX = 2;
     const bool keepUnaligned_;
     const unsigned long maxTileReads_;
+    const unsigned stagingBufferBytes_;
+    const unsigned stagingBufferFragmentsMax_;
 
     const BinIndexMap binIndexMap_;
 
     /// association of a bin index to a path
     alignment::BinMetadataList binPathList_;
-    boost::array<boost::mutex, 8> binMutex_;
     boost::ptr_vector<std::ofstream > binFiles_;
 
+    /// packed fragments of one compute thread in the order they were added
+    struct StagingBuffer
+    {
+        std::vector<char> data_;
+        /// storage bin and offset in data_ of each fragment
+        std::vector<std::pair<unsigned, unsigned> > fragments_;
+
+        bool empty() const {return fragments_.empty();}
+        void clear() {data_.clear(); fragments_.clear();}
+    };
+
+    /// staging buffers and writer scratch space
+    common::MemoryGovernor::Reservation stagingReservation_;
+    /// all staging buffers, allocated upfront so that nothing gets allocated under ScoopedMallocBlock
+    std::vector<StagingBuffer> stagingBuffers_;
+    /// buffer currently being filled by each compute thread
+    std::vector<StagingBuffer *> threadStaging_;
+    std::vector<StagingBuffer *> freeBuffers_;
+    /// fifo of buffers handed over to the writer. Ring of stagingBuffers_.size() elements
+    std::vector<StagingBuffer *> writeQueue_;
+    std::size_t writeQueueHead_;
+    std::size_t writeQueueSize_;
+    /// buffers handed over and buffers written since construction
+    unsigned long handedOver_;
+    unsigned long written_;
+    /// value of handedOver_ at the last prepareFlush
+    unsigned long flushTarget_;
+    /// true while some thread drains writeQueue_
+    bool writing_;
+    /// the writer has thrown. Whatever is still queued will never be written
+    bool writerFailed_;
+
+    boost::mutex mutex_;
+    boost::condition_variable bufferWritten_;
+
+    /// writer thread scratch space
+    std::vector<unsigned> binFragmentOffsets_;
+    std::vector<unsigned> sortedFragments_;
+    std::vector<char> binChunk_;
+
     friend std::ostream& operator << (std::ostream& os, const BinningFragmentStorage &storage);
 
     /// helper method to initialize the binPathList_
@@ -98,11 +164,6 @@ private:
         const unsigned long totalTiles,
         const bool preSortBins);
 
-    template <typename BufferT>
-    void storeFragment(
-        const BufferT &buffer,
-        const unsigned storageBin);
-
     template <typename BufferT>
     unsigned packFragment(
         const alignment::BamTemplate &bamTemplate,
@@ -110,8 +171,20 @@ private:
         const unsigned barcodeIdx,
         BufferT &buffer);
 
-    void storePaired(const BamTemplate &bamTemplate, const unsigned barcodeIdx);
-    void storeSingle(const BamTemplate &bamTemplate, const unsigned barcodeIdx);
+    template <typename BufferT>
+    void stageFragment(const BufferT &buffer, const unsigned storageBin, StagingBuffer &staging);
+
+    void stagePaired(const BamTemplate &bamTemplate, const unsigned barcodeIdx, StagingBuffer &staging);
+    void stageSingle(const BamTemplate &bamTemplate, const unsigned barcodeIdx, StagingBuffer &staging);
+
+    static unsigned getStagingBuffers(
+        const unsigned threadBuffers, const unsigned stagingBufferBytes, const common::MemoryGovernor &memoryGovernor);
+    static unsigned long getStagingBufferMemoryRequirements(const unsigned stagingBufferBytes);
+
+    void handOver(StagingBuffer *&staging, boost::unique_lock<boost::mutex> &lock);
+    void waitForWriter(boost::unique_lock<boost::mutex> &lock);
+    void drainWriteQueue(boost::unique_lock<boost::mutex> &lock);
+    void writeStagingBuffer(const StagingBuffer &staging);
 };
 
 } // namespace matchSelector
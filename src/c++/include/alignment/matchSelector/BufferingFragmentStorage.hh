@@ -61,7 +61,7 @@ public:
 
     virtual void close(alignment::BinMetadataList &binPathList) {binPathList_.swap(binPathList);}
 
-    virtual void add(const BamTemplate &bamTemplate, const unsigned barcodeIdx)
+    virtual void add(const BamTemplate &bamTemplate, const unsigned barcodeIdx, const unsigned threadNumber)
     {
         for (unsigned k = 0; k < bamTemplate.getFragmentCount(); ++k)
         {
@@ -82,6 +82,15 @@ public:
         flushBuffer_.unreserve();
     }
 
+    virtual bool checkpoint(alignment::BinMetadataList &binPathList, unsigned &storedTiles) const
+    {
+        binPathList = binPathList_;
+        storedTiles = storedTile_;
+        return true;
+    }
+
+    virtual bool resume(const alignment::BinMetadataList &binPathList, const unsigned storedTiles);
+
 private:
     const bool keepUnaligned_;
     const unsigned long maxTileReads_;
@@ -42,12 +42,31 @@ protected:
 public:
     virtual void close(alignment::BinMetadataList &binPathList)  = 0;
 
-    virtual void add(const BamTemplate &bamTemplate, const unsigned barcodeIdx) = 0;
+    /**
+     * \param threadNumber index of the calling compute thread. Storage implementations can use it to keep
+     *        per-thread state without locking
+     */
+    virtual void add(const BamTemplate &bamTemplate, const unsigned barcodeIdx, const unsigned threadNumber) = 0;
 
     virtual void prepareFlush() = 0;
     virtual void flush() = 0;
     virtual void resize(const unsigned long clusters) = 0;
     virtual void unreserve() = 0;
+
+    /**
+     * \brief Captures the metadata of the data flushed so far.
+     *
+     * \param storedTiles number of tiles flushed so far
+     * \return false if the storage does not support resuming from a checkpoint
+     */
+    virtual bool checkpoint(alignment::BinMetadataList &binPathList, unsigned &storedTiles) const {return false;}
+
+    /**
+     * \brief Discards the bin file data stored after the checkpoint and continues from it.
+     *
+     * \return false if the checkpoint does not match the bin layout of the storage
+     */
+    virtual bool resume(const alignment::BinMetadataList &binPathList, const unsigned storedTiles) {return false;}
 };
 
 } // namespace matchSelector
@@ -155,6 +155,21 @@ public:
         return tileStats_.at(tileIndex(read, passesFilter));
     }
 
+    /**
+     * \brief Stores the counters as they are in memory. Only meant to be loaded by the same binary.
+     */
+    bool save(std::ostream &os) const
+    {
+        return os.write(reinterpret_cast<const char *>(&tileStats_.front()), tileStats_.size() * sizeof(TileStats)) &&
+            os.write(reinterpret_cast<const char *>(&tileBarcodeStats_.front()), tileBarcodeStats_.size() * sizeof(TileBarcodeStats));
+    }
+
+    bool load(std::istream &is)
+    {
+        return is.read(reinterpret_cast<char *>(&tileStats_.front()), tileStats_.size() * sizeof(TileStats)) &&
+            is.read(reinterpret_cast<char *>(&tileBarcodeStats_.front()), tileBarcodeStats_.size() * sizeof(TileBarcodeStats));
+    }
+
     void finalize()
     {
         std::for_each(tileStats_.begin(), tileStats_.end(), boost::bind(&TileStats::finalize, _1));
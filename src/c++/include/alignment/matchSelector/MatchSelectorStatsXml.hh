@@ -20,6 +20,11 @@
 #ifndef ISAAC_ALIGNMENT_MATCH_SELECTOR_STATS_XML_H
 #define ISAAC_ALIGNMENT_MATCH_SELECTOR_STATS_XML_H
 
+#include <fstream>
+
+#include <boost/filesystem.hpp>
+#include <boost/noncopyable.hpp>
+
 #include "MatchSelectorStats.hh"
 #include "xml/XmlWriter.hh"
 
@@ -30,27 +35,61 @@ namespace alignment
 namespace matchSelector
 {
 
-class MatchSelectorStatsXml
+/**
+ * \brief Formats the xml elements of each tile as soon as the tile is complete and keeps them in a spool
+ *        file. This way the statistics of the complete tiles don't need to be kept in memory and
+ *        serialize only has to put the pieces together in the document order.
+ */
+class MatchSelectorStatsXml : boost::noncopyable
 {
     const flowcell::FlowcellLayoutList &flowcellLayoutList_;
     const flowcell::BarcodeMetadataList &barcodeMetadataList_;
     const flowcell::TileMetadataList &tileMetadataList_;
-    const std::vector<MatchSelectorStats> &stats_;
+    const boost::filesystem::path spoolPath_;
+    std::fstream spool_;
+    std::vector<char> buffer_;
+
+    struct SpoolExtent
+    {
+        SpoolExtent() : offset_(0), length_(0){}
+        std::streamoff offset_;
+        // 0 for tiles that have not been added
+        unsigned long length_;
+    };
+
+    // [tile index] Tile element of the Flowcell/Lane
+    std::vector<SpoolExtent> tileExtents_;
+
+    typedef std::map<unsigned, SpoolExtent> TileExtents;
+    typedef std::map<std::string, TileExtents> BarcodeTileExtents;
+    typedef std::map<std::string, BarcodeTileExtents> SampleBarcodeTileExtents;
+    typedef std::map<std::string, SampleBarcodeTileExtents> ProjectSampleBarcodeTileExtents;
+    typedef std::map<std::string, ProjectSampleBarcodeTileExtents> FlowcellProjectSampleBarcodeTileExtents;
+    // Tile elements of the Flowcell/Project/Sample/Barcode/Lane
+    FlowcellProjectSampleBarcodeTileExtents barcodeTileExtents_;
+
 public:
     MatchSelectorStatsXml(
         const flowcell::FlowcellLayoutList &flowcellLayoutList,
         const flowcell::BarcodeMetadataList &barcodeMetadataList,
         const flowcell::TileMetadataList &tileMetadataList,
-        const std::vector<MatchSelectorStats> &stats) :
-            flowcellLayoutList_(flowcellLayoutList),
-            barcodeMetadataList_(barcodeMetadataList),
-            tileMetadataList_(tileMetadataList),
-            stats_(stats)
-    {}
+        const boost::filesystem::path &spoolPath);
+    ~MatchSelectorStatsXml();
+
+    /**
+     * \brief Formats the elements of the tile and appends them to the spool. Finalizes tileStats.
+     */
+    void addTile(const flowcell::TileMetadata &tile, MatchSelectorStats &tileStats);
 
-    void serialize(std::ostream& os) const;
+    /**
+     * \brief Tiles that have not been added are serialized with zero counts
+     */
+    void serialize(std::ostream& os);
 
 private:
+    SpoolExtent spool(const std::string &xml);
+    void writeSpooled(xml::XmlWriter &xmlWriter, const SpoolExtent &extent);
+
     void serializeBarcodes(
         xml::XmlWriter &xmlWriter,
         const flowcell::Layout &flowcell) const;
@@ -61,7 +100,8 @@ private:
 
     void serlializeTile(
         xml::XmlWriter &xmlWriter,
-        const flowcell::TileMetadata &tile) const;
+        const flowcell::TileMetadata &tile,
+        const MatchSelectorStats &tileStats) const;
 
     void serlializeTileRead(
         xml::XmlWriter &xmlWriter,
@@ -80,16 +120,17 @@ private:
         const TileBarcodeStats& tileStats) const;
 
     typedef std::map<unsigned, boost::array<matchSelector::TileBarcodeStats, 2> > ReadBarcodeStats;
-    typedef std::map<unsigned, ReadBarcodeStats> TileReadBarcodeStats;
-    typedef std::map<std::string, TileReadBarcodeStats> BarcodeTileReadBarcodeStats;
-    typedef std::map<std::string, BarcodeTileReadBarcodeStats> SampleBarcodeTileReadBarcodeStats;
-    typedef std::map<std::string, SampleBarcodeTileReadBarcodeStats> ProjectSampleBarcodeTileReadBarcodeStats;
-    typedef std::map<std::string, ProjectSampleBarcodeTileReadBarcodeStats> FlowcellProjectSampleBarcodeTileReadBarcodeStats;
+    typedef std::map<std::string, ReadBarcodeStats> BarcodeReadBarcodeStats;
+    typedef std::map<std::string, BarcodeReadBarcodeStats> SampleBarcodeReadBarcodeStats;
+    typedef std::map<std::string, SampleBarcodeReadBarcodeStats> ProjectSampleBarcodeReadBarcodeStats;
+    typedef std::map<std::string, ProjectSampleBarcodeReadBarcodeStats> FlowcellProjectSampleBarcodeReadBarcodeStats;
+
+    void addTileBarcodes(const flowcell::TileMetadata &tile, const MatchSelectorStats &tileStats);
 
     void serializeFlowcellProjects(
         xml::XmlWriter &xmlWriter,
         const std::vector<unsigned> &allLanes,
-        const ProjectSampleBarcodeTileReadBarcodeStats &flowcellProjectSampleBarcodeStats) const;
+        const ProjectSampleBarcodeTileExtents &flowcellProjectSampleBarcodeTileExtents);
 };
 
 } //namespace matchSelector
@@ -151,21 +151,17 @@ void serialize(std::ostream &os, const std::pair<IteratorT, IteratorT> &pairBegi
 static const unsigned MAX_LANES_PER_FLOWCELL = 8;
 static const unsigned MAX_TILES_PER_LANE = 2048;
 
+/**
+ * \brief Produces the SAM header text shared by BAM and CRAM files
+ */
 template <typename THeader>
-void serializeHeader(
-    std::ostream &os,
+std::string makeHeaderText(
     const std::vector<std::string>& argv,
     const std::string &description,
     const std::vector<std::string>& headerTags,
     const std::string &bamPuFormat,
     const THeader &header)
 {
-    struct Header
-    {
-        char magic[4];
-        int l_text;
-    } __attribute__ ((packed));
-
     const std::string commandLine(boost::join(argv, " "));
 
     std::string headerText(
@@ -190,9 +186,7 @@ void serializeHeader(
         headerText += readGroup.getValue() + "\n";
     }
 
-    const typename THeader::RefSeqsType &refSeqs = header.getRefSequences();
-
-    BOOST_FOREACH(const typename THeader::RefSeqType &refSeq, refSeqs)
+    BOOST_FOREACH(const typename THeader::RefSeqType &refSeq, header.getRefSequences())
     {
         std::string sq = "@SQ\tSN:" + refSeq.name() + "\tLN:" + boost::lexical_cast<std::string>(refSeq.length());
 
@@ -213,6 +207,26 @@ void serializeHeader(
 
         headerText += sq + "\n";
     }
+    return headerText;
+}
+
+template <typename THeader>
+void serializeHeader(
+    std::ostream &os,
+    const std::vector<std::string>& argv,
+    const std::string &description,
+    const std::vector<std::string>& headerTags,
+    const std::string &bamPuFormat,
+    const THeader &header)
+{
+    struct Header
+    {
+        char magic[4];
+        int l_text;
+    } __attribute__ ((packed));
+
+    const std::string headerText = makeHeaderText(argv, description, headerTags, bamPuFormat, header);
+    const typename THeader::RefSeqsType &refSeqs = header.getRefSequences();
 
     Header bamHeader ={ {'B','A','M',1}, int(headerText.size())};
 
@@ -0,0 +1,370 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file Cram.hh
+ **
+ ** \brief Low-level primitives of the CRAM 3.0 format: integer encodings, blocks and containers.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifndef iSAAC_BAM_CRAM_HH
+#define iSAAC_BAM_CRAM_HH
+
+#include <zlib.h>
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include "common/Debug.hh"
+
+namespace isaac
+{
+namespace bam
+{
+
+enum CramBlockContentType
+{
+    CRAM_FILE_HEADER = 0,
+    CRAM_COMPRESSION_HEADER = 1,
+    CRAM_SLICE_HEADER = 2,
+    CRAM_EXTERNAL_DATA = 4,
+    CRAM_CORE_DATA = 5
+};
+
+enum CramCodec
+{
+    CRAM_CODEC_EXTERNAL = 1,
+    CRAM_CODEC_BYTE_ARRAY_LEN = 4,
+    CRAM_CODEC_BYTE_ARRAY_STOP = 5
+};
+
+/// magic, version and the 20-byte file id
+static const unsigned CRAM_FILE_DEFINITION_BYTES = 26;
+static const unsigned CRAM_ITF8_BYTES_MAX = 5;
+static const unsigned CRAM_LTF8_BYTES_MAX = 9;
+/// int32 length, 4 itf8, 2 ltf8, itf8 block count, single landmark array and the crc32
+static const unsigned CRAM_CONTAINER_HEADER_BYTES_MAX = 4 + 4 * CRAM_ITF8_BYTES_MAX + 2 * CRAM_LTF8_BYTES_MAX + 3 * CRAM_ITF8_BYTES_MAX + 4;
+/// method, content type, 3 itf8 and crc32
+static const unsigned CRAM_BLOCK_OVERHEAD_BYTES_MAX = 2 + 3 * CRAM_ITF8_BYTES_MAX + 4;
+
+/**
+ * \brief Appends a 32-bit value in the CRAM variable length encoding. Negative values take 5 bytes.
+ */
+template <typename BufferT>
+void appendItf8(BufferT &buffer, const int value)
+{
+    const unsigned v = value;
+    if (!(v & ~0x7FU))
+    {
+        buffer.push_back(v);
+    }
+    else if (!(v & ~0x3FFFU))
+    {
+        buffer.push_back((v >> 8) | 0x80);
+        buffer.push_back(v & 0xFF);
+    }
+    else if (!(v & ~0x1FFFFFU))
+    {
+        buffer.push_back((v >> 16) | 0xC0);
+        buffer.push_back((v >> 8) & 0xFF);
+        buffer.push_back(v & 0xFF);
+    }
+    else if (!(v & ~0x0FFFFFFFU))
+    {
+        buffer.push_back((v >> 24) | 0xE0);
+        buffer.push_back((v >> 16) & 0xFF);
+        buffer.push_back((v >> 8) & 0xFF);
+        buffer.push_back(v & 0xFF);
+    }
+    else
+    {
+        buffer.push_back(0xF0 | ((v >> 28) & 0x0F));
+        buffer.push_back((v >> 20) & 0xFF);
+        buffer.push_back((v >> 12) & 0xFF);
+        buffer.push_back((v >> 4) & 0xFF);
+        buffer.push_back(v & 0x0F);
+    }
+}
+
+/**
+ * \return number of bytes appendItf8 produces for the value
+ */
+inline unsigned getItf8Length(const int value)
+{
+    const unsigned v = value;
+    return !(v & ~0x7FU) ? 1 : !(v & ~0x3FFFU) ? 2 : !(v & ~0x1FFFFFU) ? 3 : !(v & ~0x0FFFFFFFU) ? 4 : 5;
+}
+
+/**
+ * \brief Appends a 64-bit value in the CRAM variable length encoding
+ */
+template <typename BufferT>
+void appendLtf8(BufferT &buffer, const unsigned long value)
+{
+    // number of bytes following the first one
+    unsigned extra = 0;
+    while (extra < 8 && (value >> (7 * (extra + 1))))
+    {
+        ++extra;
+    }
+    if (8 == extra)
+    {
+        buffer.push_back(0xFF);
+    }
+    else
+    {
+        buffer.push_back(((0xFF00 >> extra) & 0xFF) | (value >> (8 * extra)));
+    }
+    for (int shift = (int(extra) - 1) * 8; shift >= 0; shift -= 8)
+    {
+        buffer.push_back((value >> shift) & 0xFF);
+    }
+}
+
+/**
+ * \brief Appends a 64-bit value in the longest form of the CRAM variable length encoding, so that it can be
+ *        overwritten in place by writeFixedLtf8 once the final value is known
+ */
+template <typename BufferT>
+void appendFixedLtf8(BufferT &buffer, const unsigned long value)
+{
+    buffer.push_back(0xFF);
+    for (int shift = 56; shift >= 0; shift -= 8)
+    {
+        buffer.push_back((value >> shift) & 0xFF);
+    }
+}
+
+/**
+ * \brief Overwrites the value stored by appendFixedLtf8 at p
+ */
+inline void writeFixedLtf8(unsigned char *p, const unsigned long value)
+{
+    ISAAC_ASSERT_MSG(0xFF == *p, "Expected fixed length ltf8, got first byte " << int(*p));
+    for (int shift = 56; shift >= 0; shift -= 8)
+    {
+        *++p = (value >> shift) & 0xFF;
+    }
+}
+
+template <typename BufferT>
+void appendInt32(BufferT &buffer, const int value)
+{
+    const unsigned v = value;
+    buffer.push_back(v & 0xFF);
+    buffer.push_back((v >> 8) & 0xFF);
+    buffer.push_back((v >> 16) & 0xFF);
+    buffer.push_back((v >> 24) & 0xFF);
+}
+
+/**
+ * \brief Reads a value appended by appendItf8 and advances p past it
+ */
+inline int readItf8(const unsigned char *&p)
+{
+    if (!(p[0] & 0x80))
+    {
+        return *p++;
+    }
+    if (!(p[0] & 0x40))
+    {
+        const int ret = ((p[0] & 0x3F) << 8) | p[1];
+        p += 2;
+        return ret;
+    }
+    if (!(p[0] & 0x20))
+    {
+        const int ret = ((p[0] & 0x1F) << 16) | (p[1] << 8) | p[2];
+        p += 3;
+        return ret;
+    }
+    if (!(p[0] & 0x10))
+    {
+        const int ret = ((p[0] & 0x0F) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+        p += 4;
+        return ret;
+    }
+    const int ret = (unsigned(p[0] & 0x0F) << 28) | (p[1] << 20) | (p[2] << 12) | (p[3] << 4) | (p[4] & 0x0F);
+    p += 5;
+    return ret;
+}
+
+/**
+ * \brief Reads a value appended by appendLtf8 and advances p past it
+ */
+inline unsigned long readLtf8(const unsigned char *&p)
+{
+    unsigned extra = 0;
+    while (extra < 8 && (p[0] & (0x80 >> extra)))
+    {
+        ++extra;
+    }
+    unsigned long ret = 8 == extra ? 0 : (p[0] & (0x7F >> extra));
+    for (unsigned i = 1; extra >= i; ++i)
+    {
+        ret = (ret << 8) | p[i];
+    }
+    p += extra + 1;
+    return ret;
+}
+
+inline int readInt32(const unsigned char *&p)
+{
+    const int ret = p[0] | (p[1] << 8) | (p[2] << 16) | (unsigned(p[3]) << 24);
+    p += 4;
+    return ret;
+}
+
+/**
+ * \brief Byte buffer that never grows beyond the capacity reserved upfront, so it can be filled while
+ *        memory allocations are blocked. Appends that don't fit are dropped and the buffer is marked as
+ *        overflown, which allows the caller to roll back the incomplete record.
+ */
+class CramSeriesBuffer
+{
+public:
+    CramSeriesBuffer() : overflown_(false){}
+
+    void reserve(const std::size_t capacity) {data_.reserve(capacity);}
+    std::size_t capacity() const {return data_.capacity();}
+    std::size_t size() const {return data_.size();}
+    bool empty() const {return data_.empty();}
+    bool overflown() const {return overflown_;}
+    const char *begin() const {return empty() ? 0 : &data_.front();}
+    const char *end() const {return begin() + size();}
+
+    void push_back(const char c)
+    {
+        if (data_.capacity() == data_.size())
+        {
+            overflown_ = true;
+        }
+        else
+        {
+            data_.push_back(c);
+        }
+    }
+
+    void append(const char *begin, const char *end)
+    {
+        if (data_.capacity() - data_.size() < std::size_t(end - begin))
+        {
+            overflown_ = true;
+        }
+        else
+        {
+            data_.insert(data_.end(), begin, end);
+        }
+    }
+
+    /// drops everything appended after size bytes
+    void truncate(const std::size_t size)
+    {
+        ISAAC_ASSERT_MSG(size <= data_.size(), "Cannot truncate " << data_.size() << " bytes buffer to " << size);
+        data_.resize(size);
+        overflown_ = false;
+    }
+
+    void clear() {truncate(0);}
+
+private:
+    std::vector<char> data_;
+    bool overflown_;
+};
+
+/**
+ * \brief Produces CRAM blocks, gzip-compressing their content when that makes them smaller. The zlib state
+ *        and the compression buffer are allocated in the constructor and reused for every block.
+ */
+class CramBlockCompressor : boost::noncopyable
+{
+public:
+    /**
+     * \param gzipLevel       0 stores all blocks raw
+     * \param maxBlockBytes   largest amount of uncompressed data to be put in a single block
+     */
+    CramBlockCompressor(const int gzipLevel, const std::size_t maxBlockBytes);
+    ~CramBlockCompressor();
+
+    /**
+     * \brief Appends complete block including the header and the crc32 to out. out must have enough
+     *        capacity for CRAM_BLOCK_OVERHEAD_BYTES_MAX plus the uncompressed data size.
+     */
+    void appendBlock(
+        const CramBlockContentType contentType,
+        const int contentId,
+        const char *begin,
+        const char *end,
+        std::vector<char> &out);
+
+private:
+    const int gzipLevel_;
+    const std::size_t maxBlockBytes_;
+    z_stream zstream_;
+    std::vector<unsigned char> compressed_;
+};
+
+/**
+ * \brief Writes the 26-byte CRAM file definition. fileId is truncated or zero-padded to 20 bytes
+ */
+void serializeCramFileDefinition(std::ostream &os, const std::string &fileId);
+
+/**
+ * \brief Writes the container holding the SAM header text
+ *
+ * \return number of bytes written
+ */
+std::size_t serializeCramHeaderContainer(std::ostream &os, const std::string &headerText);
+
+/**
+ * \brief Writes the end-of-file container required at the end of CRAM 3.0 files
+ */
+void serializeCramEof(std::ostream &os);
+
+/**
+ * \brief Appends container header describing a single-slice container to out
+ *
+ * \param recordCounter number of records in the file before this container. Stored in the fixed length
+ *                      form, so that offsetCramRecordCounters can adjust it
+ * \param landmark      offset of the slice header block from the start of the container blocks
+ * \param blocksLength  total length of container blocks, including the compression header
+ */
+void appendCramContainerHeader(
+    const int refId,
+    const int alignmentStart,
+    const int alignmentSpan,
+    const int records,
+    const unsigned long recordCounter,
+    const unsigned long bases,
+    const int blocks,
+    const int landmark,
+    const std::size_t blocksLength,
+    std::vector<char> &out);
+
+/**
+ * \brief Adds recordCounter to the record counters of the single-slice containers found in [begin, end) and
+ *        advances it by the total number of records in them. The containers are expected to have been encoded
+ *        independently with record counters starting from 0. The crc32 of the container headers and of the
+ *        slice header blocks is updated accordingly.
+ *
+ *        The slice header blocks must be stored uncompressed.
+ */
+void offsetCramRecordCounters(char *begin, char *end, unsigned long &recordCounter);
+
+} // namespace bam
+} // namespace isaac
+
+#endif // #ifndef iSAAC_BAM_CRAM_HH
@@ -0,0 +1,76 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file CramIndex.hh
+ **
+ ** \brief Produces the gzip-compressed .crai index of a CRAM file
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifndef iSAAC_BAM_CRAM_INDEX_HH
+#define iSAAC_BAM_CRAM_INDEX_HH
+
+#include <zlib.h>
+
+#include <fstream>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/noncopyable.hpp>
+
+namespace isaac
+{
+namespace bam
+{
+
+/**
+ * \brief Collects one .crai line per slice of the containers appended to the CRAM file. The index is
+ *        compressed on the fly. No memory is allocated after construction.
+ */
+class CramIndex : boost::noncopyable
+{
+public:
+    // Creates invalid object which is not to be used
+    CramIndex();
+    // Creates proper object with output file attached
+    CramIndex(const boost::filesystem::path &cramPath, const unsigned long headerLength);
+    ~CramIndex();
+
+    /**
+     * \brief Indexes the containers that are about to be appended to the CRAM file
+     *
+     * \param containers  buffer consisting of complete single-slice containers
+     */
+    void processContainers(const std::vector<char> &containers);
+
+    void flush();
+
+private:
+    static const unsigned LINE_LENGTH_MAX = 128;
+    static const unsigned COMPRESSED_BUFFER_SIZE = 65536;
+
+    std::ofstream craiStream_;
+    bool deflating_;
+    z_stream zstream_;
+    std::vector<char> line_;
+    std::vector<unsigned char> compressed_;
+    unsigned long positionInCram_;
+
+    void appendNumber(const long number);
+    void deflateLine(const int flushMode);
+};
+
+} // namespace bam
+} // namespace isaac
+
+#endif // #ifndef iSAAC_BAM_CRAM_INDEX_HH
@@ -74,6 +74,9 @@ struct Footer
 } __attribute__ ((packed));
 BOOST_STATIC_ASSERT(8 == sizeof(Footer));
 
+/// BSIZE is 16 bits wide, so no complete bgzf block, header and footer included, is ever larger than this
+static const unsigned COMPRESSED_BLOCK_MAX = 0x10000;
+
 
 } // namespace bgzf
 } // namespace isaac
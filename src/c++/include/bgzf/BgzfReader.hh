@@ -67,6 +67,7 @@ public:
     }
     unsigned readNextBlock(std::istream &is);
     void uncompressCurrentBlock(char* p, const std::size_t size);
+    void uncompressBlock(const char *block, const std::size_t blockSize, char* p, const std::size_t size);
 
 private:
     void reset()
@@ -153,6 +154,110 @@ private:
     void releaseComputeSlot();
 };
 
+/**
+ * \brief Location of a complete bgzf block within a buffer of compressed data and the location of its
+ *        data within the uncompressed stream
+ */
+struct BlockLocation
+{
+    BlockLocation(
+        const char *compressed,
+        const unsigned compressedSize,
+        const unsigned long uncompressedOffset,
+        const unsigned uncompressedSize) :
+            compressed_(compressed), compressedSize_(compressedSize),
+            uncompressedOffset_(uncompressedOffset), uncompressedSize_(uncompressedSize)
+    {
+    }
+    const char *compressed_;
+    unsigned compressedSize_;
+    unsigned long uncompressedOffset_;
+    unsigned uncompressedSize_;
+};
+
+/**
+ * \brief Splits a buffer of consecutive bgzf blocks into individual blocks. Blocks with no data are skipped.
+ *
+ * \param begin              first byte of a bgzf block header
+ * \param end                end of the available compressed data
+ * \param uncompressedOffset offset of the first block data in the uncompressed stream
+ * \param blocks             the found blocks are appended here. Capacity must be sufficient to
+ *                           avoid memory allocation.
+ *
+ * \return pointer to the first byte that does not belong to a complete block
+ */
+const char *indexBlocks(
+    const char *begin, const char *end,
+    unsigned long &uncompressedOffset,
+    std::vector<BlockLocation> &blocks);
+
+/**
+ * \brief Inflates blocks that overlap the range [skipBytes, skipBytes + size) of the uncompressed stream.
+ *        Only each step-th block starting from firstBlock is processed. Blocks that are not entirely inside
+ *        the range go through boundaryBuffer
+ *
+ * \return number of bytes of the range produced by the processed blocks
+ */
+std::size_t inflateBlocks(
+    BgzfReader &reader,
+    char *boundaryBuffer,
+    const std::vector<BlockLocation> &blocks,
+    const unsigned firstBlock,
+    const unsigned step,
+    const unsigned long skipBytes,
+    char *destination,
+    const std::size_t size);
+
+/**
+ * \brief Inflates series of in-memory bgzf blocks by spreading them across a dedicated pool of threads.
+ *        Since bgzf blocks are independent, any block can be inflated into its final location without waiting
+ *        for the preceding ones.
+ *
+ *        An inflater serves one caller at a time. Threads that load data concurrently should each own one
+ *        with their share of the cores rather than queue up on a common one.
+ */
+class ParallelBgzfBlockInflater : boost::noncopyable
+{
+    common::ThreadVector threads_;
+    std::vector<BgzfReader> readers_;
+    /// one buffer per thread for blocks that cross the boundaries of the requested range
+    std::vector<std::vector<char> > boundaryBuffers_;
+    /// bytes of the requested range produced by each thread
+    std::vector<std::size_t> inflatedBytes_;
+
+public:
+    ParallelBgzfBlockInflater(const unsigned threadsMax) :
+        threads_(threadsMax),
+        readers_(threadsMax),
+        boundaryBuffers_(threadsMax, std::vector<char>(UNCOMPRESSED_BLOCK_MAX)),
+        inflatedBytes_(threadsMax, 0)
+    {
+    }
+
+    static const unsigned UNCOMPRESSED_BLOCK_MAX = 0x10000;
+
+    /**
+     * \brief Inflates the range [skipBytes, skipBytes + size) of the uncompressed stream into destination.
+     *        Must not be called concurrently on the same object.
+     *
+     * \return number of bytes of the range covered by the blocks. Less than size if blocks end before the range does.
+     */
+    std::size_t inflate(
+        const std::vector<BlockLocation> &blocks,
+        const unsigned long skipBytes,
+        char *destination,
+        const std::size_t size);
+
+private:
+    void inflateParallel(
+        const unsigned threadNumber,
+        const std::vector<BlockLocation> &blocks,
+        const unsigned threads,
+        const unsigned long skipBytes,
+        char *destination,
+        const std::size_t size);
+};
+
 } // namespace bgzf
 } // namespace isaac
 
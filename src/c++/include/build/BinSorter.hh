@@ -28,12 +28,15 @@
 
 #include "alignment/BinMetadata.hh"
 #include "build/BamSerializer.hh"
+#include "build/BuildMetrics.hh"
+#include "build/CramSerializer.hh"
 #include "build/DuplicatePairEndFilter.hh"
 #include "build/FragmentIndex.hh"
 #include "build/GapRealigner.hh"
 #include "build/NotAFilter.hh"
 #include "build/DuplicateFragmentIndexFiltering.hh"
 #include "build/PackedFragmentBuffer.hh"
+#include "common/Profiling.hh"
 #include "io/FileBufCache.hh"
 #include "flowcell/TileMetadata.hh"
 
@@ -54,6 +57,14 @@ enum GapRealignerMode
     REALIGN_ALL
 };
 
+enum OutputFormat
+{
+    /// bgzf-compressed BAM with .bai index
+    OUTPUT_BAM,
+    /// reference-based CRAM 3.0 with .crai index
+    OUTPUT_CRAM
+};
+
 class BinSorter : std::vector<PackedFragmentBuffer::Index>
 {
     typedef std::vector<PackedFragmentBuffer::Index> BaseType;
@@ -90,6 +101,9 @@ public:
             bamSerializer_(barcodeBamMapping_.getSampleIndexMap(), tileMetadataList, barcodeMetadataList,
                            contigMap,
                            maxReadLength, forcedDodgyAlignmentScore, flowCellLayoutList, includeTags, pessimisticMapQ),
+            cramSerializer_(barcodeBamMapping_.getSampleIndexMap(), tileMetadataList, barcodeMetadataList,
+                            contigMap, contigList,
+                            maxReadLength, forcedDodgyAlignmentScore, flowCellLayoutList, includeTags, pessimisticMapQ),
             fileBuf_(1, std::ios_base::binary|std::ios_base::in),
             realignGaps_(realignGaps),
             realignerGaps_(getGapGroupsCount()),
@@ -136,11 +150,11 @@ public:
     void load()
     {
         ISAAC_THREAD_CERR << "Loading unsorted data" << std::endl;
-        const clock_t startLoad = clock();
+        const unsigned long startLoadNs = common::getWallClockNs();
 
         loadData();
 
-        ISAAC_THREAD_CERR << "Loading unsorted data done in " << (clock() - startLoad) / 1000 << "ms" << std::endl;
+        ISAAC_THREAD_CERR << "Loading unsorted data done in " << (common::getWallClockNs() - startLoadNs) / 1000000 << "ms" << std::endl;
     }
 
     void reorderForBam()
@@ -155,15 +169,17 @@ public:
                 index.pos_ = fragment.fStrandPosition_;
             }
         }
-        const clock_t startSortOffsets = clock();
-        std::sort(begin(), end(), boost::bind(&PackedFragmentBuffer::orderForBam, boost::ref(data_), _1, _2));
-        ISAAC_THREAD_CERR << "Sorting offsets" << " done in " << (clock() - startSortOffsets) / 1000 << "ms" << std::endl;
+        const unsigned long startSortOffsetsNs = common::getWallClockNs();
+        sortByChunks();
+        ISAAC_THREAD_CERR << "Sorting offsets" << " done in " << (common::getWallClockNs() - startSortOffsetsNs) / 1000000 << "ms" << std::endl;
     }
 
     unsigned long process(
-        BuildStats &buildStats)
+        BuildStats &buildStats,
+        BinMetrics &binMetrics)
     {
-        resolveDuplicates(buildStats);
+        binMetrics.startBin(bin_);
+        resolveDuplicates(buildStats, binMetrics);
         unreserveIndexes();
         if (!isUnalignedBin() && REALIGN_NONE != realignGaps_)
         {
@@ -174,9 +190,30 @@ public:
         return getUniqueRecordsCount();
     }
 
+    /**
+     * \brief Feeds the records to binMetrics. Expects the index to be ordered by reorderForBam
+     */
+    void collectMetrics(BinMetrics &binMetrics)
+    {
+        if (isUnalignedBin())
+        {
+            return;
+        }
+        BOOST_FOREACH(const PackedFragmentBuffer::Index &index, std::make_pair(indexBegin(), indexEnd()))
+        {
+            binMetrics.addFragment(data_.getFragment(index));
+        }
+    }
+
     unsigned long serialize(boost::ptr_vector<boost::iostreams::filtering_ostream> &bgzfStreams,
                             boost::ptr_vector<bam::BamIndexPart> &bamIndexParts);
 
+    /**
+     * \brief Encodes the records into CRAM containers appended to the encoder output buffers. All
+     *        non-empty slices are flushed before returning so that the buffers contain complete containers.
+     */
+    unsigned long serialize(CramSerializer::CramSliceEncoders &cramEncoders);
+
     unsigned getBinIndex() const
     {
         return bin_.getIndex();
@@ -189,6 +226,7 @@ private:
     const unsigned binStatsIndex_;
     const BarcodeBamMapping &barcodeBamMapping_;
     BamSerializer bamSerializer_;
+    CramSerializer cramSerializer_;
     std::vector<SeFragmentIndex> seIdxFileContent_;
     std::vector<RStrandOrShadowFragmentIndex> rIdxFileContent_;
     std::vector<FStrandFragmentIndex> fIdxFileContent_;
@@ -198,6 +236,9 @@ private:
     std::vector<RealignerGaps> realignerGaps_;
     GapRealigner gapRealigner_;
     alignment::BinDataDistribution dataDistribution_;
+    /// scratch space for bucketing the index by the data distribution chunks
+    std::vector<std::size_t> chunkNext_;
+    std::vector<std::size_t> chunkEnds_;
 
     void loadData();
     void loadUnalignedData();
@@ -206,7 +247,10 @@ private:
     bool isUnalignedBin() const {return bin_.isUnalignedBin();}
     unsigned long getUniqueRecordsCount() const {return isUnalignedBin() ? bin_.getTotalElements() : size();}
 
-    void resolveDuplicates(BuildStats &buildStats);
+    void resolveDuplicates(BuildStats &buildStats, BinMetrics &binMetrics);
+    std::size_t getPositionChunk(const reference::ReferencePosition pos) const;
+    std::size_t getIndexChunk(const PackedFragmentBuffer::Index &index) const {return getPositionChunk(index.pos_);}
+    void sortByChunks();
     void collectGaps();
     void realignGaps();
 
@@ -27,15 +27,20 @@
 
 #include "alignment/BinMetadata.hh"
 #include "alignment/TemplateLengthStatistics.hh"
+#include "bam/CramIndex.hh"
 #include "build/BarcodeBamMapping.hh"
 #include "build/BinSorter.hh"
+#include "build/BuildMetrics.hh"
 #include "build/BuildStats.hh"
 #include "build/BuildContigMap.hh"
+#include "build/CramSliceEncoder.hh"
+#include "common/MemoryGovernor.hh"
 #include "common/Threads.hpp"
 #include "flowcell/BarcodeMetadata.hh"
 #include "flowcell/Layout.hh"
 #include "flowcell/TileMetadata.hh"
 #include "io/FileSinkWithMd5.hh"
+#include "reference/SharedContigs.hh"
 #include "reference/SortedReferenceMetadata.hh"
 
 
@@ -78,6 +83,11 @@ class Build
     const unsigned maxReadLength_;
     const IncludeTags includeTags_;
     const bool pessimisticMapQ_;
+    const OutputFormat outputFormat_;
+    // when not empty, the output file data goes there instead of the file. '-' means standard output
+    const std::string &bamStreamDestination_;
+    // bins get allocated only when their buffers fit in what the governor has left
+    common::MemoryGovernor &memoryGovernor_;
 
     boost::mutex stateMutex_;
     boost::condition_variable stateChangedCondition_;
@@ -90,9 +100,14 @@ class Build
     BarcodeBamMapping barcodeBamMapping_;
     //[output file], one stream per bam file path
     boost::ptr_vector<bam::BamIndex> bamIndexes_;
+    //[output file], only valid ones when producing cram
+    boost::ptr_vector<bam::CramIndex> cramIndexes_;
     std::vector<boost::shared_ptr<boost::iostreams::filtering_ostream> > bamFileStreams_;
+    //[output file], records saved so far when producing cram
+    std::vector<unsigned long> cramRecordCounters_;
 
     BuildStats stats_;
+    BuildMetrics metrics_;
 
     //[thread]
     std::vector<boost::shared_ptr<BinSorter> > threadBinSorters_;
@@ -101,6 +116,16 @@ class Build
     // Geometry: [thread][bam file]. Streams for compressing bam data into threadBgzfBuffers_
     boost::ptr_vector<boost::ptr_vector<boost::iostreams::filtering_ostream> > threadBgzfStreams_;
     boost::ptr_vector<boost::ptr_vector<bam::BamIndexPart> > threadBamIndexParts_;
+    // Geometry: [thread][output file]. Encoders producing cram containers into threadBgzfBuffers_
+    std::vector<CramSerializer::CramSliceEncoders> threadCramEncoders_;
+    // Geometry: [thread]. Metrics of the bin the thread works on. Merged into metrics_ when the bin is saved
+    boost::ptr_vector<BinMetrics> threadBinMetrics_;
+    // Geometry: [thread]. Memory reserved with memoryGovernor_ for the bin sorter and for the output buffers.
+    // The sorter part is returned as soon as the bin is processed, the buffers part once it is saved
+    boost::ptr_vector<common::MemoryGovernor::Reservation> threadSorterReservations_;
+    boost::ptr_vector<common::MemoryGovernor::Reservation> threadBufferReservations_;
+    // threadBinMetrics_ buffers. Held for the lifetime of the Build
+    common::MemoryGovernor::Reservation binMetricsReservation_;
 
 public:
     Build(const std::vector<std::string> &argv,
@@ -111,6 +136,7 @@ public:
           const alignment::BinMetadataList &bins,
           const std::vector<alignment::TemplateLengthStatistics> &barcodeTemplateLengthStatistics,
           const reference::SortedReferenceMetadataList &sortedReferenceMetadataList,
+          const reference::SharedContigsList &sharedContigsList,
           const boost::filesystem::path outputDirectory,
           const unsigned maxLoaders,
           const unsigned maxComputers,
@@ -132,12 +158,20 @@ public:
           const bool keepUnaligned,
           const bool putUnalignedInTheBack,
           const IncludeTags includeTags,
-          const bool pessimisticMapQ);
+          const bool pessimisticMapQ,
+          const OutputFormat outputFormat,
+          const std::string &bamStreamDestination,
+          const unsigned coverageTileSize,
+          common::MemoryGovernor &memoryGovernor);
 
     void run(common::ScoopedMallocBlock &mallocBlock);
 
     void dumpStats(const boost::filesystem::path &statsXmlPath);
 
+    void dumpMetrics(
+        const boost::filesystem::path &metricsXmlPath,
+        const boost::filesystem::path &coverageDirectory);
+
     static unsigned long estimateOptimumFragmentsPerBin(
         const flowcell::FlowcellLayoutList &flowcellLayoutList,
         const unsigned long availableMemory,
@@ -146,10 +180,15 @@ public:
 
     const BarcodeBamMapping &getBarcodeBamMapping() const {return barcodeBamMapping_;}
 private:
+    io::FileSinkWithMd5 createOutputFileSink(
+        const boost::filesystem::path &filePath,
+        bool &outputStreamUsed) const;
+
     std::vector<boost::shared_ptr<boost::iostreams::filtering_ostream> >  createOutputFileStreams(
         const flowcell::TileMetadataList &tileMetadataList,
         const flowcell::BarcodeMetadataList &barcodeMetadataList,
-        boost::ptr_vector<bam::BamIndex> &bamIndexes) const;
+        boost::ptr_vector<bam::BamIndex> &bamIndexes,
+        boost::ptr_vector<bam::CramIndex> &cramIndexes) const;
 
     unsigned long reserveBuffers(
         boost::unique_lock<boost::mutex> &lock,
@@ -208,7 +247,7 @@ private:
 
     void saveAndReleaseBuffers(
         boost::unique_lock<boost::mutex> &lock,
-        const boost::filesystem::path &filePath,
+        const alignment::BinMetadata &bin,
         const size_t threadNumber);
 
     void saveBuffer(
@@ -218,10 +257,26 @@ private:
         bam::BamIndex &bamIndex,
         const boost::filesystem::path &filePath);
 
+    void saveCramBuffer(
+        std::vector<char> &cramBuffer,
+        std::ostream &cramStream,
+        unsigned long &recordCounter,
+        bam::CramIndex &cramIndex,
+        const boost::filesystem::path &filePath);
+
+    unsigned long getOutputFileBinElements(
+        const alignment::BinMetadata & binMetadata,
+        const unsigned outputFileIndex) const;
+
     unsigned long estimateBinCompressedDataRequirements(
         const alignment::BinMetadata & binMetadata,
         const unsigned outputFileIndex) const;
 
+    /// memory for the output buffers of all files. Includes the cram encoders when producing cram
+    unsigned long estimateBinBuffersRequirements(const alignment::BinMetadata & binMetadata) const;
+
+
+    void allocateBinMetrics();
     void testBinsFitInRam();
 };
 
@@ -0,0 +1,199 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file BuildMetrics.hh
+ **
+ ** \brief Coverage, insert size and duplicate metrics collected while the bam files are built.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifndef ISAAC_BUILD_BUILD_METRICS_H
+#define ISAAC_BUILD_BUILD_METRICS_H
+
+#include <boost/filesystem.hpp>
+
+#include "alignment/BinMetadata.hh"
+#include "build/BarcodeBamMapping.hh"
+#include "build/BuildStats.hh"
+#include "flowcell/BarcodeMetadata.hh"
+#include "io/Fragment.hh"
+#include "reference/SortedReferenceMetadata.hh"
+#include "xml/XmlWriter.hh"
+
+namespace isaac
+{
+namespace build
+{
+
+class BinMetrics;
+
+/**
+ * \brief Per-sample metrics of the whole build. Bins are processed in parallel by BinMetrics and merged here
+ *        in the order in which they are saved, which is the coordinate order.
+ *
+ *        Depth of the first positions of a bin depends on the reads of the previous bin that overhang its end.
+ *        Such positions are kept raw by BinMetrics and folded here once both sides are known.
+ */
+class BuildMetrics
+{
+    friend class BinMetrics;
+public:
+    /// depths at or above this go into the last histogram bucket
+    static const unsigned DEPTH_MAX = 1000;
+    static const unsigned INSERT_SIZE_MAX = 2000;
+    static const unsigned DUPLICATE_SET_MAX = 100;
+
+    BuildMetrics(
+        const BarcodeBamMapping &barcodeBamMapping,
+        const flowcell::BarcodeMetadataList &barcodeMetadataList,
+        const reference::SortedReferenceMetadataList &sortedReferenceMetadataList,
+        const unsigned maxReadLength,
+        const unsigned coverageTileSize,
+        const bool collectDuplicateSets);
+
+    /// must be called for every bin in the order of the bins in the output files
+    void merge(const BinMetrics &binMetrics);
+
+    /**
+     * \brief Stores the xml with per-sample histograms and per-contig coverage. When coverage tiles
+     *        are enabled, also stores coverageDirectory/<project>/<sample>.wig with mean depth of each tile
+     */
+    void dump(
+        const boost::filesystem::path &metricsXmlPath,
+        const boost::filesystem::path &coverageDirectory,
+        const alignment::BinMetadataCRefList &bins,
+        const BuildStats &buildStats);
+
+private:
+    struct SampleMetrics
+    {
+        SampleMetrics() : barcodeIndex_(-1U), referenceIndex_(-1U),
+            pending_(false), pendingContigId_(0), pendingOffset_(0),
+            tileContigId_(0), tile_(0), tileDepths_(0){}
+        // first barcode of the sample
+        unsigned barcodeIndex_;
+        // -1U for samples that don't have a mapped reference
+        unsigned referenceIndex_;
+        std::vector<unsigned long> depthHistogram_;
+        std::vector<unsigned long> insertSizeHistogram_;
+        std::vector<unsigned long> duplicateSetHistogram_;
+        // [contig]
+        std::vector<unsigned long> alignedBases_;
+        std::vector<unsigned long> coveredBases_;
+        // [contig][tile] sum of depths of all positions of the tile
+        std::vector<std::vector<unsigned long> > tiles_;
+
+        // depths of the positions following the end of the last merged bin
+        bool pending_;
+        unsigned pendingContigId_;
+        unsigned long pendingOffset_;
+        std::vector<unsigned> pendingDepths_;
+
+        // tile being accumulated by merge
+        unsigned tileContigId_;
+        unsigned long tile_;
+        unsigned long tileDepths_;
+    };
+
+    const BarcodeBamMapping &barcodeBamMapping_;
+    const flowcell::BarcodeMetadataList &barcodeMetadataList_;
+    const reference::SortedReferenceMetadataList &sortedReferenceMetadataList_;
+    const unsigned ringSize_;
+    const unsigned coverageTileSize_;
+    // duplicate sets are only seen when duplicates get resolved. No histogram is produced otherwise
+    const bool collectDuplicateSets_;
+    std::vector<SampleMetrics> samples_;
+
+    bool isMapped(const unsigned sample) const {return -1U != samples_.at(sample).referenceIndex_;}
+    unsigned long getContigLength(const unsigned sample, const unsigned contigId) const;
+    void addTileDepths(
+        const unsigned sample, const unsigned contigId, const unsigned long tile, const unsigned long depths);
+    void foldDepth(const unsigned sample, const unsigned contigId, const unsigned long offset, const unsigned depth);
+    void foldPending(const unsigned sample);
+    void flushTile(const unsigned sample);
+    void dumpSample(
+        xml::XmlWriter &xmlWriter,
+        const unsigned sample,
+        const alignment::BinMetadataCRefList &bins,
+        const BuildStats &buildStats) const;
+    void dumpCoverage(const boost::filesystem::path &wigPath, const unsigned sample) const;
+};
+
+/**
+ * \brief Collects metrics of a single bin. One instance per thread, reused between bins. All memory is
+ *        allocated in the constructor.
+ *
+ *        Fragments are expected in coordinate order. Depth of the positions at or after the start of the
+ *        last fragment is kept in a ring buffer. Positions behind the start are final and get folded into
+ *        the histograms as the fragments advance. Reference span of a fragment is clipped at the ring size.
+ */
+class BinMetrics
+{
+    friend class BuildMetrics;
+public:
+    explicit BinMetrics(BuildMetrics &buildMetrics);
+
+    /// \return bytes allocated by the constructor of a BinMetrics for buildMetrics
+    static unsigned long getMemoryRequirements(const BuildMetrics &buildMetrics);
+
+    /// forgets everything about the previous bin
+    void startBin(const alignment::BinMetadata &bin);
+    void addDuplicateSet(const unsigned long barcode, const unsigned long fragments);
+    void addFragment(const io::FragmentAccessor &fragment);
+    /// folds everything up to the bin end. Depths past the bin end are left for BuildMetrics::merge
+    void finishBin();
+
+private:
+    struct SampleMetrics
+    {
+        SampleMetrics() : contigLength_(0), foldedEnd_(0), touchedEnd_(0), tailLength_(0),
+            alignedBases_(0), coveredBases_(0), tile_(0), tileDepths_(0){}
+        std::vector<unsigned> depthHistogram_;
+        std::vector<unsigned> insertSizeHistogram_;
+        std::vector<unsigned> duplicateSetHistogram_;
+        std::vector<unsigned> ring_;
+        // depths of the first ring size positions of the bin. These are affected by the previous bin
+        std::vector<unsigned> head_;
+        // depths of the positions following the bin end
+        std::vector<unsigned> tail_;
+        unsigned long contigLength_;
+        // first position not folded yet
+        unsigned long foldedEnd_;
+        // position past the last one that has received any depth
+        unsigned long touchedEnd_;
+        unsigned long tailLength_;
+        unsigned long alignedBases_;
+        unsigned long coveredBases_;
+        unsigned long tile_;
+        unsigned long tileDepths_;
+    };
+
+    BuildMetrics &buildMetrics_;
+    const unsigned ringSize_;
+    const unsigned ringMask_;
+    bool aligned_;
+    unsigned contigId_;
+    unsigned long binStart_;
+    unsigned long headEnd_;
+    unsigned long binEnd_;
+    std::vector<SampleMetrics> samples_;
+
+    void fold(const unsigned sample, const unsigned long end);
+    void addDepth(SampleMetrics &sampleMetrics, unsigned long begin, unsigned long end);
+    void flushTile(const unsigned sample);
+};
+
+} //namespace build
+} //namespace isaac
+
+#endif //ISAAC_BUILD_BUILD_METRICS_H
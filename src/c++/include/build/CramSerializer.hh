@@ -0,0 +1,99 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file CramSerializer.hh
+ **
+ ** \brief Routes sorted records to the CRAM slice encoders of their output files.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifndef iSAAC_BUILD_CRAM_SERIALIZER_HH
+#define iSAAC_BUILD_CRAM_SERIALIZER_HH
+
+#include <boost/shared_ptr.hpp>
+
+#include "build/BarcodeBamMapping.hh"
+#include "build/CramSliceEncoder.hh"
+#include "build/FragmentAccessorBamAdapter.hh"
+#include "build/PackedFragmentBuffer.hh"
+#include "flowcell/BarcodeMetadata.hh"
+#include "flowcell/TileMetadata.hh"
+#include "reference/Contig.hh"
+
+namespace isaac
+{
+namespace build
+{
+
+class CramSerializer
+{
+public:
+    typedef std::vector<boost::shared_ptr<CramSliceEncoder> > CramSliceEncoders;
+
+    CramSerializer(
+        const BarcodeBamMapping::BarcodeSampleIndexMap &barcodeOutputFileIndexMap,
+        const flowcell::TileMetadataList &tileMetadataList,
+        const flowcell::BarcodeMetadataList &barcodeMetadataList,
+        const BuildContigMap &contigMap,
+        const std::vector<std::vector<isaac::reference::Contig> > &contigList,
+        const unsigned maxReadLength,
+        const unsigned char forcedDodgyAlignmentScore,
+        const flowcell::FlowcellLayoutList &flowCellLayoutList,
+        const IncludeTags includeTags,
+        const bool pessimisticMapQ):
+            barcodeOutputFileIndexMap_(barcodeOutputFileIndexMap),
+            barcodeMetadataList_(barcodeMetadataList),
+            contigList_(contigList),
+            bamAdapter_(
+                maxReadLength, tileMetadataList, barcodeMetadataList,
+                contigMap, forcedDodgyAlignmentScore, flowCellLayoutList, includeTags, pessimisticMapQ)
+    {}
+
+    typedef void result_type;
+    void operator()(const PackedFragmentBuffer::Index& idx,
+                    CramSliceEncoders &encoders,
+                    const PackedFragmentBuffer &fragmentData)
+    {
+        const io::FragmentAccessor &fragment = fragmentData.getFragment(idx);
+        FragmentAccessorBamAdapter& adapter = bamAdapter_(idx, fragment);
+        const std::vector<char> *contig = idx.pos_.isNoMatch() ? 0 :
+            &contigList_.at(barcodeMetadataList_.at(fragment.barcode_).getReferenceIndex()).at(
+                idx.pos_.getContigId()).forward_;
+        getEncoder(encoders, fragment).encode(adapter, contig);
+    }
+
+    void operator()(const io::FragmentAccessor &fragment,
+                    CramSliceEncoders &encoders)
+    {
+        FragmentAccessorBamAdapter& adapter = bamAdapter_(fragment);
+        getEncoder(encoders, fragment).encode(adapter, 0);
+    }
+private:
+    const BarcodeBamMapping::BarcodeSampleIndexMap &barcodeOutputFileIndexMap_;
+    const flowcell::BarcodeMetadataList &barcodeMetadataList_;
+    const std::vector<std::vector<isaac::reference::Contig> > &contigList_;
+    FragmentAccessorBamAdapter bamAdapter_;
+
+    CramSliceEncoder &getEncoder(CramSliceEncoders &encoders, const io::FragmentAccessor &fragment) const
+    {
+        const boost::shared_ptr<CramSliceEncoder> &encoder =
+            encoders.at(barcodeOutputFileIndexMap_.at(fragment.barcode_));
+        ISAAC_ASSERT_MSG(encoder, "Missing CRAM encoder for barcode " << fragment.barcode_);
+        return *encoder;
+    }
+};
+
+} // namespace build
+} // namespace isaac
+
+#endif // #ifndef iSAAC_BUILD_CRAM_SERIALIZER_HH
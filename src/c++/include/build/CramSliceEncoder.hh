@@ -0,0 +1,129 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file CramSliceEncoder.hh
+ **
+ ** \brief Reference-based encoding of sorted records into CRAM 3.0 containers.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifndef iSAAC_BUILD_CRAM_SLICE_ENCODER_HH
+#define iSAAC_BUILD_CRAM_SLICE_ENCODER_HH
+
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include "bam/Cram.hh"
+#include "build/FragmentAccessorBamAdapter.hh"
+
+namespace isaac
+{
+namespace build
+{
+
+/**
+ * \brief Accumulates records of one output file into a slice and appends it as a single-slice container
+ *        to the output buffer once the slice is full or the reference sequence changes.
+ *
+ *        Every data series goes into its own external block. Bases of the aligned reads are stored as
+ *        differences against the reference, so the decoding requires the same reference sequence.
+ *        All memory is reserved in the constructor. The output buffer must have enough capacity
+ *        reserved for the encoded data.
+ */
+class CramSliceEncoder : boost::noncopyable
+{
+public:
+    CramSliceEncoder(
+        const int gzipLevel,
+        const unsigned maxReadLength,
+        std::vector<char> &output);
+
+    /**
+     * \param contig forward sequence of the contig the record is placed on. 0 for records without position
+     */
+    void encode(FragmentAccessorBamAdapter &adapter, const std::vector<char> *contig);
+
+    /// appends the accumulated slice to the output if there is anything in it
+    void flush();
+
+    static unsigned long getMemoryRequirements(const unsigned maxReadLength);
+
+    /// upper bound on the size of a single container produced by flush
+    static unsigned long getMaxContainerBytes(const unsigned maxReadLength);
+
+private:
+    enum Series
+    {
+        BF, CF, RL, AP, RG, RN, MF, NS, NP, TS, TL, FN, FC, FP, BS, IN, DL, RS, SC, HC, PD, MQ, BA, QS,
+        SERIES_COUNT
+    };
+
+    /// optional tags in the order in which they appear in BAM records
+    enum Tag
+    {
+        TAG_SM, TAG_AS, TAG_RG, TAG_NM, TAG_BC, TAG_OC, TAG_ZX, TAG_ZY,
+        TAGS_COUNT
+    };
+
+    static const unsigned SLICE_RECORDS_MAX = 10000;
+    /// each combination of tags present in a record gets a line in the tag dictionary
+    static const unsigned TAG_LINES_MAX = 1 << TAGS_COUNT;
+    static const unsigned COMPRESSION_HEADER_BYTES_MAX = 32768;
+
+    std::vector<char> &output_;
+    bam::CramSeriesBuffer series_[SERIES_COUNT];
+    bam::CramSeriesBuffer tagSeries_[TAGS_COUNT];
+    bam::CramBlockCompressor compressor_;
+    /// slice headers are kept uncompressed so that the record counters can be adjusted when the bin is saved
+    bam::CramBlockCompressor rawCompressor_;
+    std::vector<char> header_;
+    std::vector<char> map_;
+    std::vector<char> containerHeader_;
+
+    /// records in the containers flushed so far. Gets offset by the records of the preceding bins on save
+    unsigned long recordCounter_;
+    int sliceRefId_;
+    int sliceStart_;
+    int sliceEnd_;
+    int lastAlignmentStart_;
+    unsigned records_;
+    unsigned long bases_;
+    int tagLineIndex_[TAG_LINES_MAX];
+    unsigned char tagLineMasks_[TAG_LINES_MAX];
+    unsigned tagLinesCount_;
+    unsigned sliceTagsMask_;
+
+    static std::size_t getSeriesCapacity(const Series series, const unsigned maxReadLength);
+    static std::size_t getTagSeriesCapacity();
+    static int getTagKey(const Tag tag);
+    static std::size_t getMaxBlockBytes(const unsigned maxReadLength);
+
+    bool encodeRecord(FragmentAccessorBamAdapter &adapter, const std::vector<char> *contig);
+    void encodeTags(FragmentAccessorBamAdapter &adapter);
+    void encodeTag(const Tag tag, const bam::iTag &value, unsigned &mask);
+    void encodeTag(const Tag tag, const bam::zTag &value, unsigned &mask);
+    void encodeFeatures(FragmentAccessorBamAdapter &adapter, const std::vector<char> &contig);
+    void addFeature(const char code, const unsigned readPosition, unsigned &lastFeaturePosition, unsigned &features);
+    unsigned getTagLine(const unsigned mask);
+    bool overflown() const;
+
+    void makeCompressionHeader();
+    void makeSliceHeader();
+    void resetSlice();
+};
+
+} // namespace build
+} // namespace isaac
+
+#endif // #ifndef iSAAC_BUILD_CRAM_SLICE_ENCODER_HH
@@ -20,6 +20,7 @@
 #ifndef iSAAC_BUILD_DUPLICATE_PAIR_END_FILTER_HH
 #define iSAAC_BUILD_DUPLICATE_PAIR_END_FILTER_HH
 
+#include "build/BuildMetrics.hh"
 #include "build/BuildStats.hh"
 #include "build/FragmentIndex.hh"
 #include "build/PackedFragmentBuffer.hh"
@@ -40,7 +41,11 @@ namespace build
 class DuplicatePairEndFilter
 {
 public:
-    DuplicatePairEndFilter(const bool keepDuplicates) : keepDuplicates_(keepDuplicates){}
+    /**
+     * \param binMetrics when not 0, receives the size of each group of duplicates found
+     */
+    DuplicatePairEndFilter(const bool keepDuplicates, BinMetrics *binMetrics = 0) :
+        keepDuplicates_(keepDuplicates), binMetrics_(binMetrics){}
     template <typename FilterT, typename InputIteratorT, typename InsertIteratorT>
     void filterInput(
         const FilterT& filter,
@@ -70,6 +75,7 @@ public:
 
             // Range is guaranteed to be not empty
             unsigned long unique = 1;
+            unsigned long duplicateSetSize = 1;
             const io::FragmentAccessor &firstBestFragment = fragments.getFragment(*duplicatesBegin);
             results++ = PackedFragmentBuffer::Index(*duplicatesBegin, firstBestFragment);
             ISAAC_THREAD_CERR_DEV_TRACE_CLUSTER_ID(firstBestFragment.clusterId_, "Selected as the first duplicate best: " << *duplicatesBegin  << ":" << firstBestFragment);
@@ -80,6 +86,8 @@ public:
 
                 if (!filter.equal_to(fragments, *itLast, *it))
                 {
+                    addDuplicateSet(fragments.getFragment(*itLast).barcode_, duplicateSetSize);
+                    duplicateSetSize = 1;
                     ISAAC_THREAD_CERR_DEV_TRACE_CLUSTER_ID(fragment.clusterId_, "Selected as a duplicate best:         " << *it << ":" << fragment);
                     ISAAC_THREAD_CERR_DEV_TRACE_CLUSTER_ID(fragment.clusterId_, "Selected as a duplicate best prev:    " << *itLast << ":" << fragments.getFragment(*itLast));
                     results++ = PackedFragmentBuffer::Index(*it, fragment);
@@ -89,6 +97,7 @@ public:
                 }
                 else if (keepDuplicates_)
                 {
+                    ++duplicateSetSize;
                     fragment.flags_.duplicate_ = true;
                     results++ = PackedFragmentBuffer::Index(*it, fragment);
                     ISAAC_THREAD_CERR_DEV_TRACE_CLUSTER_ID(fragment.clusterId_, "Marked as a duplicate of:             " << lastFragment << ":" << *it << ":" << fragment);
@@ -96,11 +105,13 @@ public:
                 }
                 else
                 {
+                    ++duplicateSetSize;
                     ISAAC_THREAD_CERR_DEV_TRACE_CLUSTER_ID(fragment.clusterId_, "Discarded as a duplicate of:          " << lastFragment << ":" << *it << ":" << fragment);
                     ISAAC_THREAD_CERR_DEV_TRACE_CLUSTER_ID(lastFragment.clusterId_, "Discarded as a duplicate of:          " << lastFragment << ":" << *it << ":" << fragment);
                 }
                 buildStats.incrementTotalFragments(binIndex, fragments.getFragment(*it).barcode_);
             }
+            addDuplicateSet(fragments.getFragment(*(duplicatesEnd - 1)).barcode_, duplicateSetSize);
 
             ISAAC_THREAD_CERR << "Filtering duplicates"
                 << " done in " << (clock() - startFilter) / 1000 << "ms. found " << unique
@@ -109,6 +120,15 @@ public:
     }
 private:
     const bool keepDuplicates_;
+    BinMetrics *binMetrics_;
+
+    void addDuplicateSet(const unsigned long barcode, const unsigned long fragments)
+    {
+        if (binMetrics_)
+        {
+            binMetrics_->addDuplicateSet(barcode, fragments);
+        }
+    }
 };
 
 
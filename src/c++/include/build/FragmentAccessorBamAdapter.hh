@@ -374,6 +374,8 @@ public:
 
     int observedLength() const { return pFragment_->observedLength_; }
 
+    const io::FragmentAccessor &getFragment() const { return *pFragment_; }
+
 };
 
 } // namespace build
@@ -0,0 +1,91 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file BucketSort.hpp
+ **
+ ** In-place sort of data for which the bucket of each element is known upfront.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifndef iSAAC_COMMON_BUCKET_SORT_HPP
+#define iSAAC_COMMON_BUCKET_SORT_HPP
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+#include "common/Debug.hh"
+
+namespace isaac
+{
+namespace common
+{
+
+/**
+ * \brief Distributes the elements in place between the buckets (American flag sort), then sorts each bucket
+ *        on its own.
+ *
+ * \param bucketOf   returns the bucket of an element in [0, buckets). Must agree with comp: an element that
+ *                   compares less than another one cannot be placed in a later bucket.
+ * \param bucketNext scratch space, resized to buckets + 1
+ * \param bucketEnds scratch space, resized to buckets + 1
+ */
+template <typename IteratorT, typename BucketOfT, typename CompareT>
+void bucketSort(
+    const IteratorT begin, const IteratorT end, const std::size_t buckets,
+    BucketOfT bucketOf, CompareT comp,
+    std::vector<std::size_t> &bucketNext, std::vector<std::size_t> &bucketEnds)
+{
+    bucketNext.assign(buckets + 1, 0);
+    bucketEnds.resize(buckets + 1);
+
+    // bucketNext[b + 1] becomes the start of bucket b + 1
+    for (IteratorT it = begin; end != it; ++it)
+    {
+        const std::size_t bucket = bucketOf(*it);
+        ISAAC_ASSERT_MSG(buckets > bucket, "Bucket " << bucket << " is out of range " << buckets);
+        ++bucketNext[bucket + 1];
+    }
+    std::partial_sum(bucketNext.begin(), bucketNext.end(), bucketNext.begin());
+    std::copy(bucketNext.begin() + 1, bucketNext.end(), bucketEnds.begin());
+
+    // move each element into the next unplaced slot of its bucket
+    for (std::size_t bucket = 0; buckets != bucket; ++bucket)
+    {
+        while (bucketEnds[bucket] != bucketNext[bucket])
+        {
+            const std::size_t target = bucketOf(*(begin + bucketNext[bucket]));
+            if (target == bucket)
+            {
+                ++bucketNext[bucket];
+            }
+            else
+            {
+                std::iter_swap(begin + bucketNext[bucket], begin + bucketNext[target]++);
+            }
+        }
+    }
+
+    IteratorT bucketBegin = begin;
+    for (std::size_t bucket = 0; buckets != bucket; ++bucket)
+    {
+        const IteratorT bucketEnd = begin + bucketEnds[bucket];
+        std::sort(bucketBegin, bucketEnd, comp);
+        bucketBegin = bucketEnd;
+    }
+}
+
+} //namespace common
+} //namespace isaac
+
+#endif //#ifndef iSAAC_COMMON_BUCKET_SORT_HPP
@@ -0,0 +1,112 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file MemoryGovernor.hh
+ **
+ ** \brief Single account of the memory allowed to the process by --memory-limit.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifndef iSAAC_COMMON_MEMORY_GOVERNOR_HH
+#define iSAAC_COMMON_MEMORY_GOVERNOR_HH
+
+#include <boost/noncopyable.hpp>
+#include <boost/thread.hpp>
+
+namespace isaac
+{
+namespace common
+{
+
+/**
+ * \brief Stages size their batches from the memory that is still available and reserve the budgets for the
+ *        buffers they are about to allocate, so that the consumers running concurrently don't plan on the same
+ *        bytes and a request that can never be satisfied is detected before anything is allocated.
+ *
+ *        Memory that is not covered by reservations (reference, metadata, thread stacks, heap overhead) is
+ *        accounted for by measuring the virtual size of the process. measure() is expected to be called between
+ *        the stages, when no reservations are held.
+ */
+class MemoryGovernor : boost::noncopyable
+{
+public:
+    /**
+     * \param limit  bytes the process is allowed to use. 0 means no limit
+     */
+    explicit MemoryGovernor(const unsigned long limit);
+
+    /// takes a note of the memory the process uses outside of the reservations
+    void measure();
+
+    unsigned long getLimit() const {return limit_;}
+    /// bytes that can still be reserved
+    unsigned long getAvailable() const;
+    bool fits(const unsigned long bytes) const {return bytes <= getAvailable();}
+    /// \return largest number of items of itemBytes that fit in the available memory
+    unsigned long getCapacity(const unsigned long itemBytes) const;
+
+    /// \return false if the bytes don't fit. Nothing is reserved in this case
+    bool tryReserve(const unsigned long bytes);
+    void release(const unsigned long bytes);
+
+    unsigned long getReserved() const;
+    /// highest amount reserved since the last measure()
+    unsigned long getPeakReserved() const;
+
+    /**
+     * \brief Holds a reservation for the lifetime of the buffers allocated in a scope
+     */
+    class Reservation : boost::noncopyable
+    {
+    public:
+        explicit Reservation(MemoryGovernor &governor) : governor_(governor), bytes_(0){}
+        ~Reservation() {release();}
+
+        /// grows the reservation by bytes. \return false if that does not fit
+        bool tryReserve(const unsigned long bytes)
+        {
+            if (!governor_.tryReserve(bytes))
+            {
+                return false;
+            }
+            bytes_ += bytes;
+            return true;
+        }
+
+        void release()
+        {
+            governor_.release(bytes_);
+            bytes_ = 0;
+        }
+
+        unsigned long getBytes() const {return bytes_;}
+    private:
+        MemoryGovernor &governor_;
+        unsigned long bytes_;
+    };
+
+private:
+    const unsigned long limit_;
+    // process size at the last measure()
+    unsigned long baseline_;
+    unsigned long reserved_;
+    unsigned long peakReserved_;
+    mutable boost::mutex mutex_;
+
+    unsigned long getAvailable(boost::unique_lock<boost::mutex> &lock) const;
+};
+
+} // namespace common
+} // namespace isaac
+
+#endif // #ifndef iSAAC_COMMON_MEMORY_GOVERNOR_HH
@@ -0,0 +1,244 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file Profiling.hh
+ **
+ ** Lightweight wall and cpu time accounting for the processing stages of the aligner. Meant for coarse-grained
+ ** scopes such as per-tile or per-bin processing steps. Does not allocate memory once the units are reserved, so it
+ ** is safe to use under ScoopedMallocBlock.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifndef iSAAC_COMMON_PROFILING_HH
+#define iSAAC_COMMON_PROFILING_HH
+
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+namespace isaac
+{
+namespace common
+{
+
+/// monotonic wall clock in nanoseconds
+inline unsigned long getWallClockNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+
+/// cpu time consumed by the calling thread in nanoseconds
+inline unsigned long getThreadCpuClockNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+
+struct StageCounters
+{
+    StageCounters() : calls_(0), wallNs_(0), cpuNs_(0), bytes_(0), items_(0){}
+    unsigned long calls_;
+    unsigned long wallNs_;
+    unsigned long cpuNs_;
+    unsigned long bytes_;
+    unsigned long items_;
+
+    StageCounters &operator +=(const StageCounters &that)
+    {
+        calls_ += that.calls_;
+        wallNs_ += that.wallNs_;
+        cpuNs_ += that.cpuNs_;
+        bytes_ += that.bytes_;
+        items_ += that.items_;
+        return *this;
+    }
+};
+
+/**
+ * \brief Process-wide resource consumption. Sampled at the boundaries of the workflow steps, which run one at a
+ *        time, so that the counters of child threads are accounted for.
+ */
+struct ResourceUsage
+{
+    ResourceUsage() : wallNs_(0), userCpuNs_(0), systemCpuNs_(0), peakRssKb_(0), bytesRead_(0), bytesWritten_(0){}
+    unsigned long wallNs_;
+    unsigned long userCpuNs_;
+    unsigned long systemCpuNs_;
+    // high water mark of the resident set size since the last resetPeakRss
+    unsigned long peakRssKb_;
+    // bytes passed through read and write system calls, including the ones served by the page cache
+    unsigned long bytesRead_;
+    unsigned long bytesWritten_;
+
+    static ResourceUsage sample();
+
+    /**
+     * \brief Restarts the resident set size high water mark tracking.
+     *
+     * \return false if the kernel does not allow resetting. peakRssKb_ is then the process lifetime peak.
+     */
+    static bool resetPeakRss();
+};
+
+struct StepUsage
+{
+    StepUsage(const std::string &name, const ResourceUsage &usage) : name_(name), usage_(usage){}
+    std::string name_;
+    ResourceUsage usage_;
+};
+
+/**
+ * \brief Accumulates StageCounters per processing stage. Each thread adds into its own cache line-aligned slot,
+ *        so the counters don't get contended. Optionally, the counters are also accumulated per unit of work
+ *        (tile, bin) when the stage units have been reserved.
+ */
+class Profiler : boost::noncopyable
+{
+public:
+    enum Stage
+    {
+        FindMatchesGenerateSeeds,
+        FindMatchesSeparateRepeats,
+        FindMatchesMaskSeeds,
+        FindMatchesSortSeeds,
+        FindMatchesExactMask,
+        FindMatchesNeighborMask,
+        SelectMatchesLoadMatches,
+        SelectMatchesLoadClusters,
+        SelectMatchesSortMatches,
+        SelectMatchesSelectTile,
+        SelectMatchesFlushTile,
+        BuildLoadBin,
+        BuildProcessBin,
+        BuildSerializeBin,
+        BuildSaveBin,
+        STAGES_COUNT
+    };
+
+    enum UnitType
+    {
+        NoUnit,
+        Tile,
+        Bin
+    };
+
+    static const std::size_t NO_UNIT = std::size_t(-1);
+
+    /// Name of the workflow step the stage belongs to
+    static const char *getStepName(const Stage stage);
+    static const char *getStageName(const Stage stage);
+    static UnitType getUnitType(const Stage stage);
+
+    static Profiler &instance();
+
+    /**
+     * \brief Enables per-unit accounting for the stage. Must be called outside of the threaded code as
+     *        it allocates memory. Units outside the reserved range are accounted in stage totals only.
+     */
+    void reserveUnits(const Stage stage, const std::size_t units);
+
+    void record(const Stage stage, const std::size_t unit, const StageCounters &counters);
+
+    StageCounters getStageTotal(const Stage stage) const;
+    const std::vector<StageCounters> &getStageUnits(const Stage stage) const {return units_[stage];}
+
+    /// Stores resource consumption of a workflow step. Not thread-safe, steps are executed sequentially.
+    void recordStep(const std::string &name, const ResourceUsage &usage) {steps_.push_back(StepUsage(name, usage));}
+    const std::vector<StepUsage> &getSteps() const {return steps_;}
+
+private:
+    static const unsigned THREAD_SLOTS_MAX = 64;
+
+    struct ThreadSlot
+    {
+        StageCounters stages_[STAGES_COUNT];
+    } __attribute__ ((aligned (64)));
+
+    ThreadSlot threadSlots_[THREAD_SLOTS_MAX];
+    std::vector<StageCounters> units_[STAGES_COUNT];
+    std::vector<StepUsage> steps_;
+    unsigned nextThreadSlot_;
+
+    static Profiler instance_;
+
+    Profiler() : nextThreadSlot_(0){}
+    ThreadSlot &getThreadSlot();
+    static void add(StageCounters &to, const StageCounters &counters);
+};
+
+/**
+ * \brief Accounts the wall and cpu time spent by the calling thread between construction and destruction
+ *        of the object
+ */
+class ScopedStageTimer : boost::noncopyable
+{
+public:
+    explicit ScopedStageTimer(const Profiler::Stage stage, const std::size_t unit = Profiler::NO_UNIT) :
+        stage_(stage), unit_(unit), startWallNs_(getWallClockNs()), startCpuNs_(getThreadCpuClockNs())
+    {
+    }
+
+    ~ScopedStageTimer()
+    {
+        counters_.calls_ = 1;
+        counters_.wallNs_ = getWallClockNs() - startWallNs_;
+        counters_.cpuNs_ = getThreadCpuClockNs() - startCpuNs_;
+        Profiler::instance().record(stage_, unit_, counters_);
+    }
+
+    void addBytes(const unsigned long bytes) {counters_.bytes_ += bytes;}
+    void addItems(const unsigned long items) {counters_.items_ += items;}
+
+    /// wall time since construction, for logging
+    unsigned long getWallMs() const {return (getWallClockNs() - startWallNs_) / 1000000;}
+
+private:
+    const Profiler::Stage stage_;
+    const std::size_t unit_;
+    const unsigned long startWallNs_;
+    const unsigned long startCpuNs_;
+    StageCounters counters_;
+};
+
+/**
+ * \brief Accounts the resources consumed by the whole process between construction and the call to stop.
+ *        Intended for the top-level workflow steps, with stop bound to ISAAC_BLOCK_WITH_CLENAUP.
+ */
+class StepResourceMonitor : boost::noncopyable
+{
+public:
+    explicit StepResourceMonitor(const std::string &name) :
+        name_(name), stopped_(false)
+    {
+        ResourceUsage::resetPeakRss();
+        start_ = ResourceUsage::sample();
+    }
+
+    /// records the step in the Profiler. Steps that fail with an exception are not recorded.
+    void stop(const bool exceptionStackUnwinding);
+
+private:
+    const std::string name_;
+    bool stopped_;
+    ResourceUsage start_;
+};
+
+} //namespace common
+} //namespace isaac
+
+#endif // #ifndef iSAAC_COMMON_PROFILING_HH
@@ -74,6 +74,9 @@ void configureMemoryManagement(
 
 boost::filesystem::path getModuleFileName();
 
+/// Current virtual size of the process in bytes. This is what ulimit -v is checked against
+unsigned long getProcessVirtualSize();
+
 } // namespace common
 } // namespace isaac
 
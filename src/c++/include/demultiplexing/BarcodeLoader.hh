@@ -24,6 +24,7 @@
 #include <boost/mpl/equal_to.hpp>
 
 #include "common/Debug.hh"
+#include "common/MemoryGovernor.hh"
 #include "common/Threads.hpp"
 
 #include "demultiplexing/Barcode.hh"
@@ -45,13 +46,15 @@ class BarcodeMemoryManager: boost::noncopyable
 public:
     /// Determine how many tiles can have their barcoded loaded at the same time
     static bool selectTiles(
+        common::MemoryGovernor &memoryGovernor,
         flowcell::TileMetadataList &unprocessedPool,
         flowcell::TileMetadataList &selectedTiles)
     {
+        memoryGovernor.measure();
         selectedTiles.swap(unprocessedPool);
         {
             ISAAC_THREAD_CERR << "Barcode resolution: Determining the number of tiles that can be processed simultaneously..." << std::endl;
-            while(!selectedTiles.empty() && !seeIfFits(selectedTiles))
+            while(!selectedTiles.empty() && !seeIfFits(memoryGovernor, selectedTiles))
             {
                 unprocessedPool.push_back(selectedTiles.back());
                 selectedTiles.pop_back();
@@ -84,8 +87,13 @@ public:
     }
 
 private:
-    static bool seeIfFits(const flowcell::TileMetadataList &tiles)
+    static bool seeIfFits(const common::MemoryGovernor &memoryGovernor, const flowcell::TileMetadataList &tiles)
     {
+        if (!memoryGovernor.fits(getTotalBarcodeCount(tiles) * sizeof(Barcode)))
+        {
+            return false;
+        }
+        // the governor does not know about the address space fragmentation. Make sure the allocation succeeds
         try
         {
             std::vector<Barcode> test;
@@ -20,15 +20,21 @@
 #ifndef ISAAC_DEMULTIPLEXING_DEMULTIPLEXING_STATS_XML_H
 #define ISAAC_DEMULTIPLEXING_DEMULTIPLEXING_STATS_XML_H
 
-#include "io/PtreeXml.hh"
+#include <map>
+#include <ostream>
+
 #include "DemultiplexingStats.hh"
+#include "xml/XmlWriter.hh"
 
 namespace isaac
 {
 namespace demultiplexing
 {
 
-class DemultiplexingStatsXml : public boost::property_tree::ptree
+/**
+ * \brief Keeps the counters as they are added and streams them out with xml::XmlWriter
+ */
+class DemultiplexingStatsXml
 {
 public:
     DemultiplexingStatsXml();
@@ -44,11 +50,31 @@ public:
         const flowcell::Layout &flowcell,
         const unsigned lane,
         const LaneBarcodeStats& laneStats);
+
+    void serialize(std::ostream &os) const;
+
+private:
+    typedef std::map<unsigned, LaneBarcodeStats> LaneStats;
+    typedef std::map<std::string, LaneStats> BarcodeLaneStats;
+    typedef std::map<std::string, BarcodeLaneStats> SampleBarcodeLaneStats;
+    typedef std::map<std::string, SampleBarcodeLaneStats> ProjectSampleBarcodeLaneStats;
+    typedef std::map<std::string, ProjectSampleBarcodeLaneStats> FlowcellProjectSampleBarcodeLaneStats;
+    FlowcellProjectSampleBarcodeLaneStats flowcellProjectSampleBarcodeLaneStats_;
+
+    // sequence and count of the most frequent unknown barcodes, most frequent first
+    typedef std::vector<std::pair<std::string, unsigned long> > UnknownBarcodes;
+    typedef std::map<unsigned, UnknownBarcodes> LaneUnknownBarcodes;
+    typedef std::map<std::string, LaneUnknownBarcodes> FlowcellLaneUnknownBarcodes;
+    FlowcellLaneUnknownBarcodes flowcellLaneUnknownBarcodes_;
+
+    void serializeProjects(xml::XmlWriter &xmlWriter, const ProjectSampleBarcodeLaneStats &projectSampleBarcodeLaneStats) const;
+    void serializeUnknownBarcodes(xml::XmlWriter &xmlWriter, const LaneUnknownBarcodes &laneUnknownBarcodes) const;
 };
 
-inline std::ostream &operator << (std::ostream &os, const DemultiplexingStatsXml &tree)
+inline std::ostream &operator << (std::ostream &os, const DemultiplexingStatsXml &statsXml)
 {
-    return isaac::io::serializeAsXml(os, tree);
+    statsXml.serialize(os);
+    return os;
 }
 
 } //namespace demultiplexing
@@ -50,8 +50,19 @@ class BamLoader
     // overlap the buffer boundary
     std::vector<char> lastPassBam_;
     unsigned lastUnparsedBytes_;
-    boost::array<std::vector<char>, 2> decompressionBuffers_;
-    boost::array<unsigned, 2> unparsedBytes_;
+    // Ring of buffers. Each buffer is owned by one of decompressParseParallelizationThreads_. The threads take
+    // turns in decompressing and parsing. A thread gives up the load slot as soon as its buffer is inflated, so
+    // the next buffer is decompressed while the current one is parsed and up to DECOMPRESSION_BUFFERS - 1
+    // buffers can be ready ahead of the parser.
+    // Note that this is only a partial step towards a fully parallel bam ingest:
+    //  - only one buffer is inflated at a time. The inflate itself is spread over coresMax bgzf blocks by
+    //    bgzfReader_, but ParallelBgzfReader keeps a single stream position and uncompressed offset, so two
+    //    buffers cannot be filled concurrently.
+    //  - records are parsed and paired on one thread at a time, in file order. The cluster ids handed out by
+    //    the processor must come out the same in the match finding and match selection passes.
+    static const unsigned DECOMPRESSION_BUFFERS = 4;
+    boost::array<std::vector<char>, DECOMPRESSION_BUFFERS> decompressionBuffers_;
+    boost::array<unsigned, DECOMPRESSION_BUFFERS> unparsedBytes_;
 
     bam::BamParser bamParser_;
 
@@ -70,8 +81,7 @@ public:
     void open(const boost::filesystem::path &bamPath)
     {
         lastUnparsedBytes_ = 0;
-        unparsedBytes_[0] = 0;
-        unparsedBytes_[1] = 0;
+        std::fill(unparsedBytes_.begin(), unparsedBytes_.end(), 0);
         nextDecompressorThread_ = 0;
         nextParserThread_ = 0;
         bgzfReader_.open(bamPath);
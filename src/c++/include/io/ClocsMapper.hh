@@ -22,6 +22,7 @@
 
 #include "common/Debug.hh"
 #include "flowcell/TileMetadata.hh"
+#include "io/MappedFile.hh"
 
 namespace isaac
 {
@@ -31,8 +32,13 @@ namespace io
 class ClocsMapper
 {
 public:
-    ClocsMapper() :
-        fileBufCache_(1, std::ios_base::in | std::ios_base::binary), clusterCount_(0)
+    /**
+     * \param mapFiles when set, clocs files are memory-mapped instead of being copied into tileData_
+     */
+    ClocsMapper(const bool mapFiles) :
+        mapFiles_(mapFiles),
+        fileBufCache_(1, std::ios_base::in | std::ios_base::binary), clusterCount_(0),
+        tileDataBegin_(0), tileDataEnd_(0)
     {
     }
 
@@ -40,7 +46,14 @@ public:
     {
         clusterCount_ = clusterCount;
         tileData_.clear();
-        load(clocsFilePath, V1);
+        if (mapFiles_)
+        {
+            map(clocsFilePath, V1);
+        }
+        else
+        {
+            load(clocsFilePath, V1);
+        }
     }
 
     template <typename InsertIteratorT>
@@ -59,6 +72,7 @@ public:
     {
         std::vector<char>().swap(tileData_);
         fileBufCache_.unreserve();
+        mappedFile_.unmap();
     }
 private:
     // Bizarre format documented here http://ukch-confluence.illumina.com/display/SWD/RTA+clocs+file+format
@@ -91,9 +105,14 @@ private:
     static const int BLOCK_BYTES_MAX = 1 + 255 * 2;// count of clusters plus max number of clusters times two bytes
     static const std::size_t FILE_BYTES_MAX = sizeof(V0Header::Header) + BLOCKS_PER_LINE * BLOCKS_PER_COLUMN * BLOCK_BYTES_MAX;
 
+    const bool mapFiles_;
     io::FileBufCache<io::FileBufWithReopen> fileBufCache_;
     unsigned clusterCount_;
     std::vector<char> tileData_;
+    io::MappedFile mappedFile_;
+    // point either at tileData_ or at the mapped file content
+    const char *tileDataBegin_;
+    const char *tileDataEnd_;
     enum Version
     {
         V1 = 1,
@@ -102,14 +121,14 @@ private:
     template <typename InsertIteratorT>
     void getPositions(InsertIteratorT it, unsigned clusters) const
     {
-        const V0Header &header = reinterpret_cast<const V0Header &>(tileData_.front());
+        const V0Header &header = reinterpret_cast<const V0Header &>(*tileDataBegin_);
 
         const V0Header::Block *currentBlock = header.blocks_;
         int currentBlockX = 0;
         int currentBlockY = 0;
         while (clusters)
         {
-            ISAAC_ASSERT_MSG(reinterpret_cast<const char *>(currentBlock) <= &tileData_.back(), "Went outside the clocs file content.");
+            ISAAC_ASSERT_MSG(reinterpret_cast<const char *>(currentBlock) < tileDataEnd_, "Went outside the clocs file content.");
             unsigned char currentBlockClusters = currentBlock->clusters_;
             const V0Header::Block::BlockOffset *currentBlockCluster = currentBlock->xy_;
             while (currentBlockClusters--)
@@ -131,8 +150,32 @@ private:
         }
     }
 
+    void checkVersion(const boost::filesystem::path &clocsFilePath, Version assumedVersion) const
+    {
+        const V0Header &header = reinterpret_cast<const V0Header &>(*tileDataBegin_);
+        if (header.header_.version_ !=  assumedVersion)
+        {
+            BOOST_THROW_EXCEPTION(common::IoException(errno, (boost::format("Unsupported clocs file version %s: %d") % clocsFilePath % int(header.header_.version_)).str()));
+        }
+    }
+
+    void map(const boost::filesystem::path &clocsFilePath, Version assumedVersion)
+    {
+        mappedFile_.map(clocsFilePath, io::FileBufWithReopen::SequentialOnce);
+        if (mappedFile_.size() < sizeof(V0Header::Header))
+        {
+            BOOST_THROW_EXCEPTION(common::IoException(EINVAL, (boost::format("Clocs file is too short %s: %d") % clocsFilePath % mappedFile_.size()).str()));
+        }
+        tileDataBegin_ = mappedFile_.data();
+        tileDataEnd_ = mappedFile_.end();
+        checkVersion(clocsFilePath, assumedVersion);
+
+        ISAAC_THREAD_CERR << "Mapped " << clusterCount_ << " position values from clocs file version " << assumedVersion << ": " << clocsFilePath << std::endl;
+    }
+
     void load(const boost::filesystem::path &clocsFilePath, Version assumedVersion)
     {
+        mappedFile_.unmap();
         std::istream is(fileBufCache_.get(clocsFilePath));
         if (!is)
         {
@@ -152,11 +195,9 @@ private:
                 fileSize % clocsFilePath ).str()));
         }
 
-        const V0Header &header = reinterpret_cast<const V0Header &>(tileData_.front());
-        if (header.header_.version_ !=  assumedVersion)
-        {
-            BOOST_THROW_EXCEPTION(common::IoException(errno, (boost::format("Unsupported clocs file version %s: %d") % clocsFilePath % int(header.header_.version_)).str()));
-        }
+        tileDataBegin_ = &tileData_.front();
+        tileDataEnd_ = tileDataBegin_ + tileData_.size();
+        checkVersion(clocsFilePath, assumedVersion);
 
         ISAAC_THREAD_CERR << "Read " << clusterCount_ << " position values from clocs file version " << assumedVersion << ": " << clocsFilePath << std::endl;
     }
@@ -22,6 +22,7 @@
 #define iSAAC_IO_FILE_BUF_WITH_REOPEN_HH
 
 #include <fcntl.h>
+#include <unistd.h>
 #include <fstream>
 #include <vector>
 
@@ -35,6 +36,28 @@ namespace io
 
 extern const std::vector<const char*> iosBaseToStdioOpenModesTranslationTable;
 
+/**
+ * \brief posix_fadvise that warns about failures. Unlike most system calls, posix_fadvise returns the error
+ *        number and leaves errno unchanged.
+ *
+ * \param filePath used in the warning message only. Can be 0
+ *
+ * \return 0 or the error number returned by posix_fadvise
+ */
+inline int adviseFile(
+    const int fd, const off_t offset, const off_t length,
+    const int advice, const char *adviceName, const char *filePath)
+{
+    const int error = posix_fadvise(fd, offset, length, advice);
+    // pipes have no page cache to advise on
+    if (error && ESPIPE != error)
+    {
+        ISAAC_THREAD_CERR << "WARNING: posix_fadvise failed for " << adviceName << " with " << error << "(" <<
+            strerror(error) << ")" << " file: " << (filePath ? filePath : "") << std::endl;
+    }
+    return error;
+}
+
 template<typename _CharT, typename _Traits = std::char_traits<_CharT> >
 class basic_FileBufWithReopen : public std::basic_filebuf<_CharT, _Traits>
 {
@@ -81,26 +104,17 @@ public:
         }
 
 
-        if ((fadvise & noreuse) && posix_fadvise(fileno(this->_M_file.file()), 0, 0, POSIX_FADV_NOREUSE) &&
-            errno)
+        if (fadvise & noreuse)
         {
-            // && errno check above is reqired since POSIX_FADV_NOREUSE fails with errno 0 on /dev/null
-            ISAAC_THREAD_CERR << "WARNING: posix_fadvise failed for POSIX_FADV_NOREUSE with " << errno << "(" <<
-                strerror(errno) << ")" << " file: " << s << std::endl;
+            adviseFile(fileno(this->_M_file.file()), 0, 0, POSIX_FADV_NOREUSE, "POSIX_FADV_NOREUSE", s);
         }
-        if ((fadvise & willneed) && posix_fadvise(fileno(this->_M_file.file()), 0, 0, POSIX_FADV_WILLNEED) &&
-            errno)
+        if (fadvise & willneed)
         {
-            // && errno check above is reqired since POSIX_FADV_NOREUSE fails with errno 0 on /dev/null
-            ISAAC_THREAD_CERR << "WARNING: posix_fadvise failed for POSIX_FADV_WILLNEED with " << errno << "(" <<
-                strerror(errno) << ")" << " file: " << s << std::endl;
+            adviseFile(fileno(this->_M_file.file()), 0, 0, POSIX_FADV_WILLNEED, "POSIX_FADV_WILLNEED", s);
         }
-        if ((fadvise & dontneed) && posix_fadvise(fileno(this->_M_file.file()), 0, 0, POSIX_FADV_DONTNEED) &&
-            errno)
+        if (fadvise & dontneed)
         {
-            // && errno check above is reqired since POSIX_FADV_NOREUSE fails with errno 0 on /dev/null
-            ISAAC_THREAD_CERR << "WARNING: posix_fadvise failed for POSIX_FADV_DONTNEED with " << errno << "(" <<
-                strerror(errno) << ")" << " file: " << s << std::endl;
+            adviseFile(fileno(this->_M_file.file()), 0, 0, POSIX_FADV_DONTNEED, "POSIX_FADV_DONTNEED", s);
         }
 
 
@@ -120,13 +134,14 @@ public:
             }
 
 
-            if ((fadvise & sequential) && posix_fadvise(fileno(result), 0, 0, POSIX_FADV_SEQUENTIAL))
+            int error = 0;
+            if ((fadvise & sequential) && (error = posix_fadvise(fileno(result), 0, 0, POSIX_FADV_SEQUENTIAL)))
             {
-                BOOST_THROW_EXCEPTION(common::IoException(errno, s));
+                BOOST_THROW_EXCEPTION(common::IoException(error, s));
             }
-            if ((fadvise & random) && posix_fadvise(fileno(result), 0, 0, POSIX_FADV_RANDOM))
+            if ((fadvise & random) && (error = posix_fadvise(fileno(result), 0, 0, POSIX_FADV_RANDOM)))
             {
-                BOOST_THROW_EXCEPTION(common::IoException(errno, s));
+                BOOST_THROW_EXCEPTION(common::IoException(error, s));
             }
             return this;
         }
@@ -173,6 +188,22 @@ private:
 
 typedef basic_FileBufWithReopen<char> FileBufWithReopen;
 
+/**
+ * \brief Asks the kernel to start reading the range of the file into the page cache in background.
+ *        Failures are ignored as the data will be read anyway when actually needed.
+ *
+ * \param length number of bytes to prefetch. 0 means till the end of file
+ */
+inline void prefetchFileRange(const char *filePath, const off_t offset, const off_t length)
+{
+    const int fd = open(filePath, O_RDONLY);
+    if (-1 != fd)
+    {
+        adviseFile(fd, offset, length, POSIX_FADV_WILLNEED, "POSIX_FADV_WILLNEED", filePath);
+        close(fd);
+    }
+}
+
 } // namespace io
 } // namespace isaac
 
@@ -48,6 +48,15 @@ struct BasicFileSinkWithMd5 : private boost::iostreams::basic_file<Ch> {
         : boost::iostreams::basic_file<Ch>(path, mode & ~BOOST_IOS::in, BOOST_IOS::out),
           filePath_(path)
         { }
+    /**
+     * \brief Writes data into path, which can be a pipe, while the md5 file is produced for filePath
+     */
+    BasicFileSinkWithMd5( const std::string& path,
+                          const boost::filesystem::path &filePath,
+                          BOOST_IOS::openmode mode)
+        : boost::iostreams::basic_file<Ch>(path, mode & ~BOOST_IOS::in, BOOST_IOS::out),
+          filePath_(filePath)
+        { }
     ~BasicFileSinkWithMd5()
     {
     }
@@ -22,6 +22,7 @@
 
 #include "common/Debug.hh"
 #include "flowcell/TileMetadata.hh"
+#include "io/MappedFile.hh"
 
 namespace isaac
 {
@@ -31,10 +32,15 @@ namespace io
 class FiltersMapper
 {
 public:
-    FiltersMapper(const bool ignoreMissingFilterFiles) :
+    /**
+     * \param mapFiles when set, single-tile filter files are memory-mapped instead of being copied into tileData_
+     */
+    FiltersMapper(const bool ignoreMissingFilterFiles, const bool mapFiles) :
         ignoreMissingFilterFiles_(ignoreMissingFilterFiles),
+        mapFiles_(mapFiles),
         fileBufCache_(1, std::ios_base::in | std::ios_base::binary),
         clusterCount_(0),
+        tileDataBegin_(0),
         version_(FirstUnsupported)
     {
     }
@@ -50,13 +56,15 @@ public:
     {
         clusterCount_ = clusterCount;
         tileData_.clear();
-        version_ = load(filtersFilePath, clusterOffset, Autodetect);
+        tileDataBegin_ = 0;
+        version_ = (mapFiles_ && ONE_TILE_PER_FILE == clusterOffset && boost::filesystem::exists(filtersFilePath)) ?
+            map(filtersFilePath) : load(filtersFilePath, clusterOffset, Autodetect);
     }
 
     template <typename InsertIteratorT>
     void getPf(InsertIteratorT it) const
     {
-        versionSpecific<GetPfAction>(version_, boost::cref(tileData_), it, clusterCount_, UNUSED);
+        versionSpecific<GetPfAction>(version_, tileDataBegin_, it, clusterCount_, UNUSED);
     }
 
     void reserveBuffers(const size_t reservePathLength, const unsigned maxClusterCount)
@@ -69,9 +77,13 @@ private:
     typedef boost::error_info<struct tag_errmsg, std::string> errmsg_info;
     static const unsigned long ONE_TILE_PER_FILE = -1UL;
     const bool ignoreMissingFilterFiles_;
+    const bool mapFiles_;
     io::FileBufCache<io::FileBufWithReopen> fileBufCache_;
     unsigned clusterCount_;
     std::vector<char> tileData_;
+    io::MappedFile mappedFile_;
+    // points either at tileData_ or at the mapped file content
+    const char *tileDataBegin_;
     enum Version
     {
         Autodetect = -1,
@@ -246,9 +258,9 @@ private:
     {
         typedef void result_type;
         template<typename InsertIteratorT>
-        void operator()(const std::vector<char> &tileData, InsertIteratorT it, const unsigned clusters, UnusedT) const
+        void operator()(const char *tileData, InsertIteratorT it, const unsigned clusters, UnusedT) const
         {
-            const HeaderT &header = reinterpret_cast<const HeaderT&>(tileData.front());
+            const HeaderT &header = reinterpret_cast<const HeaderT&>(*tileData);
             ISAAC_ASSERT_MSG(header.header.clusters == clusters, "Requested number of pf values (" << clusters <<
                 ") does not match the loaded:" << unsigned(header.header.clusters));
             std::copy(header.values, header.values + clusters, it);
@@ -311,8 +323,63 @@ private:
     }
 
 
+    /**
+     * \brief Detects the version of the mapped filter file the same way detectVersion does for streams
+     */
+    Version detectMappedVersion(const boost::filesystem::path &filterFilePath) const
+    {
+        if (mappedFile_.size() < sizeof(V0Header::Header))
+        {
+            BOOST_THROW_EXCEPTION(common::IoException(EINVAL, (boost::format("Failed to read cluster count from filters file %s: file too short") % filterFilePath).str()));
+        }
+        const unsigned clusterCount = reinterpret_cast<const V0Header::Header &>(*mappedFile_.data()).clusters;
+        if (!clusterCount)
+        {
+            // V2 or V3
+            if (mappedFile_.size() < sizeof(V2Header::Header))
+            {
+                BOOST_THROW_EXCEPTION(common::IoException(EINVAL, (boost::format("Failed to read version from %s: file too short") % filterFilePath).str()));
+            }
+            const unsigned version = reinterpret_cast<const V2Header::Header &>(*mappedFile_.data()).version;
+            if (V2 != version && V3 != version)
+            {
+                BOOST_THROW_EXCEPTION(common::IoException(EINVAL, (boost::format("Unexpected filter file version (%d). from %s:") % version % filterFilePath ).str()));
+            }
+            return static_cast<Version>(version);
+        }
+
+        // V0 or V1
+        const unsigned long valueBytes = mappedFile_.size() - sizeof(V0Header::Header);
+        if (clusterCount_ == valueBytes)
+        {
+            return V0;
+        }
+        else if (clusterCount_ == valueBytes / 2)
+        {
+            return V1;
+        }
+        BOOST_THROW_EXCEPTION(common::IoException(EINVAL, (boost::format("Unexpected file length (%d) when detecting filter file format version for %d clusters. from %s:") %
+            mappedFile_.size() % clusterCount_ % filterFilePath ).str()));
+    }
+
+    Version map(const boost::filesystem::path &filterFilePath)
+    {
+        mappedFile_.map(filterFilePath, io::FileBufWithReopen::SequentialOnce);
+        const Version version = detectMappedVersion(filterFilePath);
+        const unsigned expectedFileSize = getVersionExpectedFileSize(version, clusterCount_);
+        if (mappedFile_.size() < expectedFileSize)
+        {
+            BOOST_THROW_EXCEPTION(common::IoException(EINVAL, (boost::format("Filter file is too short. Expected %d bytes, got %d: %s") %
+                expectedFileSize % mappedFile_.size() % filterFilePath).str()));
+        }
+        tileDataBegin_ = mappedFile_.data();
+        ISAAC_THREAD_CERR << "Mapped " << clusterCount_ << " filter values from filter file version " << version << ": " << filterFilePath << std::endl;
+        return version;
+    }
+
     Version load(const boost::filesystem::path &filterFilePath, const unsigned long clusterOffset, Version assumedVersion)
     {
+        mappedFile_.unmap();
         if (!boost::filesystem::exists(filterFilePath))
         {
             if (!ignoreMissingFilterFiles_)
@@ -359,6 +426,7 @@ private:
             }
             ISAAC_THREAD_CERR << "Read " << clusterCount_ << " filter values from filter file version " << assumedVersion << ": " << filterFilePath << std::endl;
         }
+        tileDataBegin_ = &tileData_.front();
         return assumedVersion;
     }
 
@@ -22,6 +22,7 @@
 
 #include "common/Debug.hh"
 #include "flowcell/TileMetadata.hh"
+#include "io/MappedFile.hh"
 
 namespace isaac
 {
@@ -31,8 +32,12 @@ namespace io
 class LocsMapper
 {
 public:
-    LocsMapper() :
-        fileBufCache_(1, std::ios_base::in | std::ios_base::binary), clusterCount_(0)
+    /**
+     * \param mapFiles when set, locs files are memory-mapped instead of being copied into tileData_
+     */
+    LocsMapper(const bool mapFiles) :
+        mapFiles_(mapFiles),
+        fileBufCache_(1, std::ios_base::in | std::ios_base::binary), clusterCount_(0), positions_(0)
     {
     }
 
@@ -42,7 +47,14 @@ public:
     {
         clusterCount_ = clusterCount;
         tileData_.clear();
-        load(clocsFilePath, clusterOffset, V1);
+        if (mapFiles_)
+        {
+            map(clocsFilePath, clusterOffset, V1);
+        }
+        else
+        {
+            load(clocsFilePath, clusterOffset, V1);
+        }
     }
 
     template <typename InsertIteratorT>
@@ -61,6 +73,7 @@ public:
     {
         std::vector<char>().swap(tileData_);
         fileBufCache_.unreserve();
+        mappedFile_.unmap();
     }
 private:
     static const unsigned long ONE_TILE_PER_FILE = -1UL;
@@ -78,9 +91,13 @@ private:
         float y_;
     }__attribute__ ((packed));
 
+    const bool mapFiles_;
     io::FileBufCache<io::FileBufWithReopen> fileBufCache_;
     unsigned clusterCount_;
     std::vector<char> tileData_;
+    io::MappedFile mappedFile_;
+    // points at the first position of the tile either in tileData_ or in the mapped file content
+    const Xy *positions_;
     enum Version
     {
         V1 = 1,
@@ -89,7 +106,7 @@ private:
     template <typename InsertIteratorT>
     void getPositions(InsertIteratorT it, unsigned clusters) const
     {
-        const Xy *currentBlockClusters = reinterpret_cast<const Xy *>(reinterpret_cast<const V0Header *>(&tileData_.front()) + 1);
+        const Xy *currentBlockClusters = positions_;
 
         while (clusters--)
         {
@@ -100,11 +117,54 @@ private:
         }
     }
 
+    /**
+     * \brief Maps the locs file and points positions_ at the first cluster of the tile. Unlike load, the
+     *        header cluster count is not patched for multi-tile files as the header is not used afterwards.
+     */
+    void map(
+        const boost::filesystem::path &locsFilePath,
+        const unsigned long clusterOffset,
+        Version assumedVersion)
+    {
+        mappedFile_.map(locsFilePath, io::FileBufWithReopen::SequentialOnce);
+        if (mappedFile_.size() < sizeof(V0Header))
+        {
+            BOOST_THROW_EXCEPTION(common::IoException(EINVAL, (boost::format("Failed to read %d header bytes from %s") %
+                sizeof(V0Header) % locsFilePath ).str()));
+        }
+
+        const V0Header &header = reinterpret_cast<const V0Header &>(*mappedFile_.data());
+        if (header.version_ != boost::uint32_t(assumedVersion))
+        {
+            BOOST_THROW_EXCEPTION(common::IoException(EINVAL, (boost::format("Unsupported locs file version %s: %d") % locsFilePath % int(header.version_)).str()));
+        }
+
+        const unsigned long firstCluster = ONE_TILE_PER_FILE == clusterOffset ? 0 : clusterOffset;
+        if (ONE_TILE_PER_FILE == clusterOffset && header.clusters_ !=  clusterCount_)
+        {
+            BOOST_THROW_EXCEPTION(common::IoException(
+                EINVAL, (boost::format("Unexpected locs file number of clusters %s: %d. Expected: %d") %
+                    locsFilePath % int(header.clusters_) % clusterCount_).str()));
+        }
+
+        const std::size_t dataEnd = sizeof(V0Header) + (firstCluster + clusterCount_) * sizeof(Xy);
+        if (mappedFile_.size() < dataEnd)
+        {
+            BOOST_THROW_EXCEPTION(common::IoException(EINVAL, (boost::format("Locs file is too short %s: %d. Expected at least %d") %
+                locsFilePath % mappedFile_.size() % dataEnd).str()));
+        }
+        positions_ = reinterpret_cast<const Xy *>(mappedFile_.data() + sizeof(V0Header)) + firstCluster;
+
+        ISAAC_THREAD_CERR << "Mapped " << clusterCount_ << " position values from locs file version " <<
+            assumedVersion << ": " << locsFilePath << " cluster offset:" << clusterOffset << std::endl;
+    }
+
     void load(
         const boost::filesystem::path &locsFilePath,
         const unsigned long clusterOffset,
         Version assumedVersion)
     {
+        mappedFile_.unmap();
         std::istream is(fileBufCache_.get(locsFilePath));
         if (!is)
         {
@@ -161,6 +221,8 @@ private:
                 (tileData_.size() - sizeof(V0Header)) % locsFilePath % is.gcount() ).str()));
         }
 
+        positions_ = reinterpret_cast<const Xy *>(&tileData_.front() + sizeof(V0Header));
+
         ISAAC_THREAD_CERR << "Read " << clusterCount_ << " position values from locs file version " <<
             assumedVersion << ": " << locsFilePath << " cluster offset:" << clusterOffset << std::endl;
     }
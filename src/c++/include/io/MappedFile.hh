@@ -0,0 +1,192 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file MappedFile.hh
+ **
+ ** Read-only memory mapping of an entire file. Allows parsers of the uncompressed input formats to work directly
+ ** from the page cache without copying the data through std::istream into private buffers.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifndef iSAAC_IO_MAPPED_FILE_HH
+#define iSAAC_IO_MAPPED_FILE_HH
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+
+#include "common/Debug.hh"
+#include "common/Exceptions.hh"
+#include "io/FileBufWithReopen.hh"
+
+namespace isaac
+{
+namespace io
+{
+
+class MappedFile
+{
+public:
+    typedef FileBufWithReopen::FadviseFlags FadviseFlags;
+
+    MappedFile() : fd_(-1), data_(0), size_(0), fadvise_(FileBufWithReopen::normal)
+    {
+    }
+
+    /**
+     * \brief This copy constructor is only useful for reservation during initialization. It does not
+     *        carry over the mapping
+     */
+    MappedFile(const MappedFile &that) : fd_(-1), data_(0), size_(0), fadvise_(FileBufWithReopen::normal)
+    {
+    }
+
+    /**
+     * \brief Same as copy constructor, the mapping is not carried over. Any existing mapping is released.
+     */
+    MappedFile &operator =(const MappedFile &that)
+    {
+        if (this != &that)
+        {
+            unmap();
+        }
+        return *this;
+    }
+
+    ~MappedFile()
+    {
+        unmap();
+    }
+
+    /**
+     * \brief Maps the whole file read-only. Any previously mapped file is released first.
+     *
+     * \param fadvise sequential, random and willneed are translated into corresponding madvise hints.
+     *                dontneed causes the file pages to be dropped from the page cache when the file is unmapped.
+     *
+     * \return pointer to the first byte of the file. 0 for empty files.
+     */
+    const char *map(const boost::filesystem::path &filePath, const FadviseFlags fadvise)
+    {
+        unmap();
+
+        fd_ = open(filePath.c_str(), O_RDONLY);
+        if (-1 == fd_)
+        {
+            BOOST_THROW_EXCEPTION(common::IoException(errno, (boost::format("Failed to open %s for mapping: %s") %
+                filePath.string() % strerror(errno)).str()));
+        }
+
+        struct stat fileStat;
+        if (-1 == fstat(fd_, &fileStat))
+        {
+            const int error = errno;
+            closeFd();
+            BOOST_THROW_EXCEPTION(common::IoException(error, (boost::format("Failed to stat %s: %s") %
+                filePath.string() % strerror(error)).str()));
+        }
+
+        fadvise_ = fadvise;
+        size_ = fileStat.st_size;
+        if (!size_)
+        {
+            // mmap does not accept 0 length. Nothing to map.
+            return data_;
+        }
+
+        void *address = mmap(0, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+        if (MAP_FAILED == address)
+        {
+            const int error = errno;
+            closeFd();
+            size_ = 0;
+            BOOST_THROW_EXCEPTION(common::IoException(error, (boost::format("Failed to map %d bytes of %s: %s") %
+                fileStat.st_size % filePath.string() % strerror(error)).str()));
+        }
+        data_ = static_cast<const char *>(address);
+
+        adviseMapping(filePath, FileBufWithReopen::sequential, MADV_SEQUENTIAL, "MADV_SEQUENTIAL");
+        adviseMapping(filePath, FileBufWithReopen::random, MADV_RANDOM, "MADV_RANDOM");
+        adviseMapping(filePath, FileBufWithReopen::willneed, MADV_WILLNEED, "MADV_WILLNEED");
+
+        return data_;
+    }
+
+    /**
+     * \brief Releases the mapping. If the file was mapped with dontneed flag, the file pages are
+     *        also dropped from the page cache.
+     */
+    void unmap()
+    {
+        if (data_)
+        {
+            if ((fadvise_ & FileBufWithReopen::dontneed) &&
+                madvise(const_cast<char *>(data_), size_, MADV_DONTNEED))
+            {
+                ISAAC_THREAD_CERR << "WARNING: madvise failed for MADV_DONTNEED with " << errno << "(" <<
+                    strerror(errno) << ")" << std::endl;
+            }
+            ISAAC_ASSERT_MSG(!munmap(const_cast<char *>(data_), size_),
+                             "munmap failed with errno: " << errno << " " << strerror(errno));
+            data_ = 0;
+        }
+
+        if (-1 != fd_)
+        {
+            if (fadvise_ & FileBufWithReopen::dontneed)
+            {
+                adviseFile(fd_, 0, 0, POSIX_FADV_DONTNEED, "POSIX_FADV_DONTNEED", 0);
+            }
+            closeFd();
+        }
+        size_ = 0;
+        fadvise_ = FileBufWithReopen::normal;
+    }
+
+    bool isMapped() const {return -1 != fd_;}
+    const char *data() const {return data_;}
+    const char *end() const {return data_ + size_;}
+    std::size_t size() const {return size_;}
+
+private:
+    int fd_;
+    const char *data_;
+    std::size_t size_;
+    FadviseFlags fadvise_;
+
+    void closeFd()
+    {
+        ISAAC_ASSERT_MSG(!close(fd_), "close failed with errno: " << errno << " " << strerror(errno));
+        fd_ = -1;
+    }
+
+    void adviseMapping(
+        const boost::filesystem::path &filePath,
+        const FadviseFlags flag, const int advice, const char *adviceName) const
+    {
+        if ((fadvise_ & flag) && madvise(const_cast<char *>(data_), size_, advice))
+        {
+            ISAAC_THREAD_CERR << "WARNING: madvise failed for " << adviceName << " with " << errno << "(" <<
+                strerror(errno) << ")" << " file: " << filePath << std::endl;
+        }
+    }
+};
+
+} // namespace io
+} // namespace isaac
+
+#endif // #ifndef iSAAC_IO_MAPPED_FILE_HH
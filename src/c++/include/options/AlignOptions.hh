@@ -51,7 +51,9 @@ private:
     void verifyMandatoryPaths(boost::program_options::variables_map &vm);
     void parseParallelization();
     build::GapRealignerMode parseGapRealignment();
+    build::OutputFormat parseOutputFormat();
     void parseExecutionTargets();
+    void parseScatterGather();
     void parseMemoryControl();
     void parseGapScoring();
     workflow::AlignWorkflow::OptionalFeatures parseBamExcludeTags(std::string strBamExcludeTags);
@@ -90,8 +92,13 @@ public:
     bool cleanupIntermediary;
     bool ignoreMissingBcls;
     bool ignoreMissingFilters;
+    bool memoryMapInput;
     // number of seeds to use on the first pass
     unsigned firstPassSeeds;
+    // Unix socket of isaac-reference-server. Empty if contigs are loaded from the fasta files
+    boost::filesystem::path referenceServerSocket;
+    // number of match finding iterations the seeds of each read are spread over
+    unsigned seedIterations;
     // the list of seed metadata
     unsigned jobs;
     unsigned repeatThreshold;
@@ -128,6 +135,7 @@ public:
     int gapOpenScore;
     int gapExtendScore;
     int minGapExtendScore;
+    bool fixedPointScoring;
     unsigned semialignedGapLimit;
     std::string dodgyAlignmentScoreString;
     alignment::TemplateBuilder::DodgyAlignmentScore dodgyAlignmentScore;
@@ -141,6 +149,10 @@ public:
     unsigned outputSaversMax;
     std::string realignGapsString;
     build::GapRealignerMode realignGaps;
+    std::string outputFormatString;
+    build::OutputFormat outputFormat;
+    std::string bamStreamDestination;
+    unsigned coverageTileSize;
     int bamGzipLevel;
     std::vector<std::string> bamHeaderTags;
     std::string bamPuFormat;
@@ -149,12 +161,19 @@ public:
     bool keepDuplicates;
     bool markDuplicates;
     std::string binRegexString;
+    // genomic length of the bins. 0 means that the bins are laid out according to the distribution of seed matches
+    unsigned long scatterBinLength;
+    // temp and output directories of the scatter runs to merge, matched by position
+    std::vector<boost::filesystem::path> gatherTempDirectoryList;
+    std::vector<boost::filesystem::path> gatherOutputDirectoryList;
+    bool tileCheckpoints;
     std::vector<std::size_t> clusterIdList;
     alignment::TemplateLengthStatistics userTemplateLengthStatistics;
     std::string tlsString;
     std::vector<std::string> defaultAdapters;
     std::string statsImageFormatString;
     reports::AlignmentReportGenerator::ImageFileFormat statsImageFormat;
+    bool statsSummaryOnly;
     bool bufferBins;
     bool qScoreBin;
     std::string qScoreBinValueString;
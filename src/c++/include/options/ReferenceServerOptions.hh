@@ -0,0 +1,53 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file ReferenceServerOptions.hh
+ **
+ ** Command line options for 'isaac-reference-server'
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifndef iSAAC_OPTIONS_REFERENCE_SERVER_OPTIONS_HH
+#define iSAAC_OPTIONS_REFERENCE_SERVER_OPTIONS_HH
+
+#include <vector>
+#include <boost/filesystem.hpp>
+
+#include "common/Program.hh"
+
+namespace isaac
+{
+namespace options
+{
+
+class ReferenceServerOptions : public common::Options
+{
+public:
+    boost::filesystem::path socketPath_;
+    std::vector<boost::filesystem::path> sortedReferenceMetadataList_;
+    unsigned jobs_;
+    unsigned referencesMax_;
+    unsigned clientTimeoutSeconds_;
+
+public:
+    ReferenceServerOptions();
+
+private:
+    std::string usagePrefix() const {return "isaac-reference-server";}
+    void postProcess(boost::program_options::variables_map &vm);
+};
+
+} // namespace options
+} // namespace isaac
+
+#endif // #ifndef iSAAC_OPTIONS_REFERENCE_SERVER_OPTIONS_HH
@@ -0,0 +1,62 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file SyntheticDataOptions.hh
+ **
+ ** Command line options for 'generateSyntheticData'
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifndef iSAAC_OPTIONS_SYNTHETIC_DATA_OPTIONS_HH
+#define iSAAC_OPTIONS_SYNTHETIC_DATA_OPTIONS_HH
+
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+
+#include "common/Program.hh"
+
+namespace isaac
+{
+namespace options
+{
+
+class SyntheticDataOptions : public common::Options
+{
+public:
+    SyntheticDataOptions();
+
+private:
+    std::string usagePrefix() const {return "generateSyntheticData";}
+    void postProcess(boost::program_options::variables_map &vm);
+
+public:
+    boost::filesystem::path outputDirectory_;
+    unsigned randomSeed_;
+    unsigned contigsCount_;
+    unsigned contigLength_;
+    unsigned clustersCount_;
+    unsigned tilesCount_;
+    unsigned readLength_;
+    unsigned fragmentLength_;
+    unsigned fragmentLengthDeviation_;
+    double errorRate_;
+    double indelRate_;
+    double duplicateRate_;
+    std::vector<std::string> outputFormats_;
+};
+
+} // namespace options
+} // namespace isaac
+
+#endif // #ifndef iSAAC_OPTIONS_SYNTHETIC_DATA_OPTIONS_HH
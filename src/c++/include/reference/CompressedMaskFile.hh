@@ -0,0 +1,258 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file CompressedMaskFile.hh
+ **
+ ** Block-compressed encoding of the sorted reference mask files.
+ **
+ ** The mask bits shared by all k-mers of the file are stripped. Each k-mer is stored as a varint delta
+ ** from the previous k-mer of the same block. The reference position is stored as a varint with the
+ ** contig id moved right above the highest position bit that occurs in the reference. Blocks
+ ** of BLOCK_RECORDS records are independently decodable and their offsets are stored at the end of the
+ ** file so that the readers can seek to any record.
+ **
+ ** Readers see the decoded file through CompressedMaskStreamBuf in the original layout: a sequence of
+ ** ReferenceKmer records. This allows the format to be detected once when the file is opened.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifndef iSAAC_REFERENCE_COMPRESSED_MASK_FILE_HH
+#define iSAAC_REFERENCE_COMPRESSED_MASK_FILE_HH
+
+#include <fstream>
+#include <streambuf>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/static_assert.hpp>
+
+#include "common/Debug.hh"
+#include "common/Exceptions.hh"
+#include "oligo/Kmer.hh"
+#include "reference/ReferenceKmer.hh"
+
+namespace isaac
+{
+namespace reference
+{
+
+struct CompressedMaskHeader
+{
+    char magic_[8];
+    unsigned formatVersion_;
+    unsigned kmerBits_;
+    unsigned maskWidth_;
+    unsigned mask_;
+    unsigned positionBits_;
+    unsigned blockRecords_;
+    unsigned long records_;
+    unsigned long blocks_;
+    // file offset of the table of block offsets
+    unsigned long blockTableOffset_;
+};
+// the fields are naturally aligned, the structure is stored as is
+BOOST_STATIC_ASSERT(56 == sizeof(CompressedMaskHeader));
+
+/**
+ * \brief Geometry and block offsets of a compressed mask file
+ */
+class CompressedMaskIndex
+{
+public:
+    static const unsigned FORMAT_VERSION = 1;
+    /// number of bits needed to store any ReferencePosition value except the contig
+    static const unsigned POSITION_BITS_MAX = ReferencePosition::POSITION_BITS + ReferencePosition::NEIGHBORS_BITS;
+
+    CompressedMaskIndex()
+    {
+        header_.records_ = 0;
+        header_.blocks_ = 0;
+    }
+
+    static bool isCompressed(const CompressedMaskHeader &header);
+
+    /**
+     * \brief Loads the header and the block offsets.
+     *
+     * \return false if the file is not in compressed format. Files produced by older versions store
+     *         raw ReferenceKmer records.
+     */
+    bool load(const boost::filesystem::path &maskFilePath);
+
+    bool isLoaded() const {return !blockOffsets_.empty();}
+
+    const CompressedMaskHeader &getHeader() const {return header_;}
+    unsigned long getRecords() const {return header_.records_;}
+    unsigned long getBlocks() const {return header_.blocks_;}
+    unsigned getBlockRecords() const {return header_.blockRecords_;}
+    /// offset of the block in the file. getBlockOffset(getBlocks()) is the end of the last block
+    unsigned long getBlockOffset(const std::size_t block) const {return blockOffsets_.at(block);}
+
+private:
+    CompressedMaskHeader header_;
+    // one extra element contains the end of the last block
+    std::vector<unsigned long> blockOffsets_;
+};
+
+namespace compressedMask
+{
+
+/// maximum number of bytes a varint of ValueT can take
+template <typename ValueT>
+struct VarintTraits
+{
+    static const unsigned BYTES_MAX = (sizeof(ValueT) * 8 + 6) / 7;
+};
+
+template <typename ValueT>
+inline char *encodeVarint(ValueT value, char *out)
+{
+    while (value >= 0x80)
+    {
+        *out++ = char(value & 0x7f) | char(0x80);
+        value >>= 7;
+    }
+    *out++ = char(value);
+    return out;
+}
+
+template <typename ValueT>
+inline const char *decodeVarint(const char *in, ValueT &value)
+{
+    value = 0;
+    unsigned shift = 0;
+    for (; *in & 0x80; shift += 7)
+    {
+        value |= ValueT(*in++ & 0x7f) << shift;
+    }
+    value |= ValueT(*in++) << shift;
+    return in;
+}
+
+} // namespace compressedMask
+
+/**
+ * \brief Encodes the stream of sorted ReferenceKmer records of one mask into a compressed mask file
+ */
+template <typename KmerT>
+class CompressedMaskWriter : boost::noncopyable
+{
+public:
+    static const unsigned BLOCK_RECORDS = 4096;
+    static const unsigned RECORD_BYTES_MAX =
+        compressedMask::VarintTraits<KmerT>::BYTES_MAX + compressedMask::VarintTraits<unsigned long>::BYTES_MAX;
+
+    /**
+     * \param positionBits number of low bits of ReferencePosition value that are needed to store the
+     *                     highest position and the neighbors flag. Contig id is stored right above.
+     */
+    CompressedMaskWriter(
+        const boost::filesystem::path &maskFilePath,
+        const unsigned maskWidth,
+        const unsigned mask,
+        const unsigned positionBits);
+
+    void write(const ReferenceKmer<KmerT> &referenceKmer);
+
+    /// stores the remaining block and the block offsets. The file is not valid until close is called.
+    void close();
+
+    unsigned long getRecords() const {return header_.records_;}
+
+    /// returns the number of bits needed to store positions not exceeding maxPosition
+    static unsigned getPositionBits(const unsigned long maxPosition);
+
+private:
+    const boost::filesystem::path maskFilePath_;
+    std::ofstream os_;
+    CompressedMaskHeader header_;
+    const KmerT maskBits_;
+    const KmerT strippedMask_;
+    std::vector<unsigned long> blockOffsets_;
+    std::vector<char> block_;
+    char *blockEnd_;
+    unsigned blockRecords_;
+    KmerT lastKmer_;
+
+    void flushBlock();
+    void writeOrThrow(const char *data, const std::size_t bytes);
+};
+
+/**
+ * \brief Presents the content of a compressed mask file as a sequence of ReferenceKmer<KmerT> records.
+ *        Supports seeking to any record. Does not allocate memory after construction.
+ */
+template <typename KmerT>
+class CompressedMaskStreamBuf : public std::streambuf, boost::noncopyable
+{
+public:
+    CompressedMaskStreamBuf();
+
+    /**
+     * \brief Starts decoding the file from the first record.
+     *
+     * \param source the compressed mask file
+     * \param index  the result of CompressedMaskIndex::load for the same file. Must stay valid while
+     *               the stream buffer is in use.
+     */
+    void open(std::streambuf &source, const CompressedMaskIndex &index);
+
+protected:
+    virtual int_type underflow();
+    virtual pos_type seekoff(off_type off, std::ios_base::seekdir way, std::ios_base::openmode which);
+    virtual pos_type seekpos(pos_type pos, std::ios_base::openmode which);
+
+private:
+    static const std::size_t NO_BLOCK = std::size_t(-1);
+    std::streambuf *source_;
+    const CompressedMaskIndex *index_;
+    KmerT maskBits_;
+    unsigned positionBits_;
+    // block currently in the get area
+    std::size_t currentBlock_;
+    // block at which the source is positioned
+    std::size_t sourceBlock_;
+    std::vector<char> compressed_;
+    std::vector<ReferenceKmer<KmerT> > decoded_;
+
+    bool loadBlock(const std::size_t block);
+    char *decodedBegin() {return reinterpret_cast<char *>(&decoded_.front());}
+    unsigned long getBlockBytesBegin(const std::size_t block) const
+    {
+        return block * index_->getBlockRecords() * sizeof(ReferenceKmer<KmerT>);
+    }
+};
+
+/**
+ * \brief Input stream of ReferenceKmer<KmerT> records of a mask file in either compressed or raw format.
+ */
+template <typename KmerT>
+class MaskFileInputStream : public std::istream, boost::noncopyable
+{
+public:
+    explicit MaskFileInputStream(const boost::filesystem::path &maskFilePath);
+
+    bool isCompressed() const {return index_.isLoaded();}
+    const CompressedMaskIndex &getIndex() const {return index_;}
+
+private:
+    std::filebuf fileBuf_;
+    CompressedMaskIndex index_;
+    CompressedMaskStreamBuf<KmerT> decoder_;
+};
+
+} // namespace reference
+} // namespace isaac
+
+#endif // #ifndef iSAAC_REFERENCE_COMPRESSED_MASK_FILE_HH
@@ -24,6 +24,7 @@
 
 #include "common/Threads.hpp"
 #include "reference/Contig.hh"
+#include "reference/SharedContigs.hh"
 #include "reference/SortedReferenceMetadata.hh"
 
 namespace isaac
@@ -44,6 +45,7 @@ template <typename ShouldLoadF> void loadContigsParallel(
     std::vector<reference::SortedReferenceMetadata::Contig>::const_iterator &nextContigToLoad,
     const std::vector<reference::SortedReferenceMetadata::Contig>::const_iterator contigsEnd,
     std::vector<reference::Contig> &contigList,
+    const SharedContigs *sharedContigs,
     boost::mutex &mutex)
 {
     const unsigned traceStep = pow(10, int(log10((contigList.size() + 99) / 100)));
@@ -57,7 +59,14 @@ template <typename ShouldLoadF> void loadContigsParallel(
             common::unlock_guard<boost::mutex> unlock(mutex);
             const reference::SortedReferenceMetadata::Contig &xmlContig = *ourContig;
             std::vector<char> &forward = contigList[ourContig->karyotypeIndex_].forward_;
-            loadContig(xmlContig, forward);
+            if (sharedContigs)
+            {
+                sharedContigs->copyContig(xmlContig.index_, forward);
+            }
+            else
+            {
+                loadContig(xmlContig, forward);
+            }
             if (!(xmlContig.index_ % traceStep))
             {
                 ISAAC_THREAD_CERR << (boost::format("Contig %s (%3d:%8d): %s\n") % xmlContig.name_ % xmlContig.index_ % xmlContig.totalBases_ % xmlContig.filePath_).str();
@@ -75,11 +84,14 @@ template <typename ShouldLoadF> void loadContigsParallel(
 
 /**
  * \brief loads the fasta file contigs into memory on multiple threads unless shouldLoad(contig->index_) returns false
+ *
+ * \param sharedContigs if not 0, the bases are copied from the shared memory segment instead of parsing the fasta files
  */
 template <typename ShouldLoadF> std::vector<reference::Contig> loadContigs(
     const reference::SortedReferenceMetadata::Contigs &xmlContigs,
     ShouldLoadF shouldLoad,
-    common::ThreadVector &loadThreads)
+    common::ThreadVector &loadThreads,
+    const SharedContigs *sharedContigs = 0)
 {
     std::vector<reference::Contig> ret;
     ret.reserve(xmlContigs.size());
@@ -97,6 +109,7 @@ template <typename ShouldLoadF> std::vector<reference::Contig> loadContigs(
                                     boost::ref(nextContigToLoad),
                                     xmlContigs.end(),
                                     boost::ref(ret),
+                                    sharedContigs,
                                     boost::ref(mutex)));
 
     return ret;
@@ -104,11 +117,14 @@ template <typename ShouldLoadF> std::vector<reference::Contig> loadContigs(
 
 /**
  * \brief loads the fasta file contigs into memory on multiple threads
+ *
+ * \param sharedContigsList if not 0, the references attached to shared memory segments are copied from there
  */
 template <typename FilterT> std::vector<std::vector<reference::Contig> > loadContigs(
     const reference::SortedReferenceMetadataList &SortedReferenceMetadataList,
     const FilterT &loadedContigFilter,
-    common::ThreadVector &loadThreads)
+    common::ThreadVector &loadThreads,
+    const SharedContigsList *sharedContigsList = 0)
 {
     ISAAC_TRACE_STAT("loadContigs ");
     std::vector<std::vector<reference::Contig> > ret(SortedReferenceMetadataList.size());
@@ -116,10 +132,13 @@ template <typename FilterT> std::vector<std::vector<reference::Contig> > loadCon
     BOOST_FOREACH(const reference::SortedReferenceMetadata &SortedReferenceMetadata, SortedReferenceMetadataList)
     {
         const unsigned referenceIndex = &SortedReferenceMetadata - &SortedReferenceMetadataList.front();
+        const SharedContigs *sharedContigs =
+            (sharedContigsList && sharedContigsList->size() > referenceIndex &&
+                sharedContigsList->at(referenceIndex).isAttached()) ? &sharedContigsList->at(referenceIndex) : 0;
         std::vector<reference::Contig> contigList =
             loadContigs(SortedReferenceMetadata.getContigs(),
                         boost::bind(&FilterT::isMapped, loadedContigFilter, referenceIndex, _1),
-                        loadThreads);
+                        loadThreads, sharedContigs);
         ret.at(referenceIndex).swap(contigList);
     }
 
@@ -0,0 +1,143 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file MaskPrefixIndex.hh
+ **
+ ** Table of record offsets in a sorted mask file, one entry per value of the k-mer bits that immediately
+ ** follow the mask bits. Allows the match finder to seek over the stretches of the mask file that no seed
+ ** can match instead of streaming through them.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifndef iSAAC_REFERENCE_MASK_PREFIX_INDEX_HH
+#define iSAAC_REFERENCE_MASK_PREFIX_INDEX_HH
+
+#include <istream>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+
+#include "common/Debug.hh"
+#include "common/Exceptions.hh"
+#include "reference/ReferenceKmer.hh"
+
+namespace isaac
+{
+namespace reference
+{
+
+class MaskPrefixIndex
+{
+public:
+    /// number of k-mer bits following the mask bits that are used to address the table
+    static const unsigned PREFIX_BITS = 12;
+
+    /// empty index. isLoaded() returns false.
+    MaskPrefixIndex() : kmerBits_(0), maskWidth_(0), prefixBits_(0), prefixShift_(0)
+    {
+    }
+
+    /// index with all buckets empty, ready to count the mask file records
+    MaskPrefixIndex(const unsigned kmerBits, const unsigned maskWidth);
+
+    static boost::filesystem::path getIndexPath(const boost::filesystem::path &maskFilePath)
+    {
+        return maskFilePath.string() + ".prefixes";
+    }
+
+    /**
+     * \brief Counts a record written into the mask file. Records must be added in the order in which they
+     *        are stored in the mask file.
+     */
+    template <typename KmerT>
+    void add(const KmerT kmer)
+    {
+        ++offsets_[getPrefix(kmer) + 1];
+    }
+
+    /// converts the counts collected by add into record offsets and stores them in the file
+    void save(const boost::filesystem::path &indexPath);
+
+    /**
+     * \brief Loads the index produced by save.
+     *
+     * \return false if the file does not exist. This is normal for references sorted by older versions.
+     */
+    bool load(const boost::filesystem::path &indexPath, const unsigned kmerBits, const unsigned maskWidth);
+
+    bool isLoaded() const {return !offsets_.empty();}
+
+    template <typename KmerT>
+    std::size_t getPrefix(const KmerT kmer) const
+    {
+        return std::size_t(kmer >> prefixShift_) & ((std::size_t(1) << prefixBits_) - 1);
+    }
+
+    /// index of the first mask file record which has the same prefix as kmer
+    template <typename KmerT>
+    std::size_t getPrefixBegin(const KmerT kmer) const
+    {
+        return offsets_[getPrefix(kmer)];
+    }
+
+    /**
+     * \brief Moves the reference stream forward to the first record of the bucket of kmer, if the bucket
+     *        of the currently loaded nextReference is not the same or immediately preceding one. Streaming
+     *        through the adjacent bucket is cheaper than discarding the stream buffer. Caller is expected to
+     *        discard the remaining smaller k-mers sequentially.
+     *
+     * \precondition nextReference.getKmer() < kmer
+     *
+     * \return lower bound of the number of records skipped over
+     */
+    template <typename KmerT>
+    std::size_t skipTo(const KmerT kmer, std::istream &reference, ReferenceKmer<KmerT> &nextReference) const
+    {
+        if (!isLoaded() || !reference)
+        {
+            return 0;
+        }
+        const std::size_t currentPrefix = getPrefix(nextReference.getKmer());
+        const std::size_t targetPrefix = getPrefix(kmer);
+        if (targetPrefix <= currentPrefix + 1)
+        {
+            return 0;
+        }
+
+        const std::size_t target = offsets_[targetPrefix];
+        if (!reference.seekg(target * sizeof(nextReference)))
+        {
+            BOOST_THROW_EXCEPTION(common::IoException(errno, (boost::format(
+                "Failed to seek to record %d of the mask file") % target).str()));
+        }
+        reference.read(reinterpret_cast<char *>(&nextReference), sizeof(nextReference));
+        return target - offsets_[currentPrefix + 1];
+    }
+
+private:
+    unsigned kmerBits_;
+    unsigned maskWidth_;
+    unsigned prefixBits_;
+    unsigned prefixShift_;
+    // offsets_[prefix] is the index of the first record with that prefix. The extra last element
+    // contains the total number of records in the mask file.
+    std::vector<unsigned long> offsets_;
+
+    void setGeometry(const unsigned kmerBits, const unsigned maskWidth);
+};
+
+} // namespace reference
+} // namespace isaac
+
+#endif // #ifndef iSAAC_REFERENCE_MASK_PREFIX_INDEX_HH
@@ -0,0 +1,119 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file ReferenceServer.hh
+ **
+ ** Local service that keeps the reference contigs loaded in shared memory for the alignment jobs
+ ** running on the same node.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifndef iSAAC_REFERENCE_REFERENCE_SERVER_HH
+#define iSAAC_REFERENCE_REFERENCE_SERVER_HH
+
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+
+#include "common/Threads.hpp"
+#include "reference/ReferenceMetadata.hh"
+#include "reference/SharedContigs.hh"
+#include "reference/SortedReferenceMetadata.hh"
+
+namespace isaac
+{
+namespace reference
+{
+
+/**
+ * \brief Publishes the contigs of the requested sorted references in shared memory segments and tells
+ *        the clients which segment to attach.
+ *
+ * The requests are served one at a time over a Unix domain socket. The protocol is a single line each way:
+ *   request:  "ATTACH <absolute path to sorted-reference.xml>\n"
+ *   response: "SEGMENT <shared memory segment name>\n" or "ERROR <message>\n"
+ * A client that does not complete its request within the client timeout is disconnected so that it cannot
+ * hold up the others.
+ *
+ * A reference is loaded when it is requested for the first time and reloaded if its xml file or any of its
+ * fasta files have been modified since. At most referencesMax references are kept. Loading another one
+ * removes the segment of the least recently requested reference first. Removing a segment only takes its
+ * name away: the jobs that have attached it keep their mapping until they detach, and the memory is freed
+ * when the last one does. The segments are removed when the server terminates.
+ */
+class ReferenceServer : boost::noncopyable
+{
+public:
+    ReferenceServer(
+        const boost::filesystem::path &socketPath,
+        const std::vector<boost::filesystem::path> &preloadXmlPaths,
+        const unsigned loadThreads,
+        const unsigned referencesMax,
+        const unsigned clientTimeoutSeconds);
+    ~ReferenceServer();
+
+    /// Serves the requests until SIGINT or SIGTERM
+    void run();
+
+    /**
+     * \brief Asks the server listening on socketPath for the segment holding the contigs of the reference
+     *
+     * \return segment name or empty string if the server is not available or failed to load the reference
+     */
+    static std::string requestSegment(
+        const boost::filesystem::path &socketPath,
+        const boost::filesystem::path &sortedReferenceXml);
+
+private:
+    struct PublishedReference
+    {
+        boost::filesystem::path xmlPath_;
+        std::time_t lastWriteTime_;
+        SortedReferenceMetadata::Contigs xmlContigs_;
+        SharedContigs contigs_;
+        /// value of requestsServed_ when the reference was last requested
+        unsigned long lastRequest_;
+    };
+
+    const boost::filesystem::path socketPath_;
+    common::ThreadVector loadThreads_;
+    const unsigned referencesMax_;
+    const unsigned clientTimeoutSeconds_;
+    boost::ptr_vector<PublishedReference> publishedReferences_;
+    unsigned segmentsCreated_;
+    unsigned long requestsServed_;
+    int listenFd_;
+
+    const SharedContigs &publish(const boost::filesystem::path &sortedReferenceXml);
+    void evictLeastRecentlyRequested();
+    void serve(const int clientFd);
+};
+
+/**
+ * \brief Attaches the contigs published by the reference server for each of the references. References the
+ *        server could not provide are left detached so that they get loaded from the fasta files.
+ */
+void attachSharedContigs(
+    const boost::filesystem::path &serverSocket,
+    const ReferenceMetadataList &referenceMetadataList,
+    const SortedReferenceMetadataList &sortedReferenceMetadataList,
+    SharedContigsList &sharedContigsList);
+
+} // namespace reference
+} // namespace isaac
+
+#endif // #ifndef iSAAC_REFERENCE_REFERENCE_SERVER_HH
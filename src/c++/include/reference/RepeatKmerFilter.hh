@@ -0,0 +1,123 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file RepeatKmerFilter.hh
+ **
+ ** Set of the k-mers that have TooManyMatch entries in the mask files. Built at reference sorting time and
+ ** stored next to each mask file. Allows the seed generators to recognize the seeds of high-repeat k-mers
+ ** before the seeds get sorted.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifndef iSAAC_REFERENCE_REPEAT_KMER_FILTER_HH
+#define iSAAC_REFERENCE_REPEAT_KMER_FILTER_HH
+
+#include <algorithm>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "oligo/Kmer.hh"
+
+namespace isaac
+{
+namespace reference
+{
+
+/**
+ * \brief Exact membership test for high-repeat k-mers. The sorted list of k-mers is fronted by a blocked
+ *        bloom filter so that the seeds that are not repeats, which is the vast majority, normally cost
+ *        one cache line access.
+ */
+template <typename KmerT>
+class RepeatKmerFilter
+{
+public:
+    RepeatKmerFilter() : bloomWordsMask_(0)
+    {
+    }
+
+    static boost::filesystem::path getFilterPath(const boost::filesystem::path &maskFilePath)
+    {
+        return maskFilePath.string() + ".repeats";
+    }
+
+    /// Adds high-repeat k-mer. Call buildLookup before using contains
+    void add(const KmerT kmer) {kmers_.push_back(kmer);}
+
+    /// stores the k-mers added so far
+    void save(const boost::filesystem::path &filterPath) const;
+
+    /**
+     * \brief Adds the k-mers stored by save. Call buildLookup before using contains
+     *
+     * \return false if the file does not exist. This is normal for references sorted by older versions.
+     */
+    bool load(const boost::filesystem::path &filterPath);
+
+    /// Prepares the filter for contains queries. Must be called outside the threaded code as it allocates memory
+    void buildLookup();
+
+    bool empty() const {return kmers_.empty();}
+    std::size_t size() const {return kmers_.size();}
+
+    bool contains(const KmerT kmer) const
+    {
+        if (!bloomWordsMask_)
+        {
+            return false;
+        }
+        const unsigned long hash = getHash(kmer);
+        const unsigned long probe = getProbe(hash);
+        if (probe != (bloom_[getWord(hash)] & probe))
+        {
+            return false;
+        }
+        return std::binary_search(kmers_.begin(), kmers_.end(), kmer);
+    }
+
+private:
+    // bloom filter bits per stored k-mer. Gives about 2% of false positives with 2 probes per word
+    static const unsigned BLOOM_BITS_PER_KMER = 16;
+
+    std::vector<KmerT> kmers_;
+    std::vector<unsigned long> bloom_;
+    unsigned long bloomWordsMask_;
+
+    static unsigned long getHash(const KmerT kmer)
+    {
+        unsigned long folded = 0;
+        for (unsigned shift = 0; oligo::KmerTraits<KmerT>::KMER_BITS > shift; shift += 32)
+        {
+            folded = (folded << 7 | folded >> 57) ^ static_cast<unsigned long>((kmer >> shift) & 0xffffffffUL);
+        }
+        return folded * 0x9E3779B97F4A7C15UL;
+    }
+
+    /// the low bits of a multiplicative hash are weak, use the middle ones
+    unsigned long getWord(const unsigned long hash) const
+    {
+        return (hash >> 20) & bloomWordsMask_;
+    }
+
+    /// two bits of the word addressed by getWord, taken from the highest bits of the hash
+    static unsigned long getProbe(const unsigned long hash)
+    {
+        return (1UL << (hash >> 58)) | (1UL << ((hash >> 52) & 63));
+    }
+};
+
+} // namespace reference
+} // namespace isaac
+
+#endif // #ifndef iSAAC_REFERENCE_REPEAT_KMER_FILTER_HH
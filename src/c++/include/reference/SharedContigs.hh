@@ -0,0 +1,126 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file SharedContigs.hh
+ **
+ ** Reference contigs kept decoded in a POSIX shared memory segment. The segment is published by
+ ** isaac-reference-server and attached read-only by the alignment jobs running on the same node so
+ ** that they don't have to parse the fasta files.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifndef iSAAC_REFERENCE_SHARED_CONTIGS_HH
+#define iSAAC_REFERENCE_SHARED_CONTIGS_HH
+
+#include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/static_assert.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "common/Threads.hpp"
+#include "reference/SortedReferenceMetadata.hh"
+
+namespace isaac
+{
+namespace reference
+{
+
+struct SharedContigsHeader
+{
+    char magic_[8];
+    unsigned formatVersion_;
+    unsigned contigs_;
+    // total size of the segment including the header
+    unsigned long bytes_;
+};
+BOOST_STATIC_ASSERT(24 == sizeof(SharedContigsHeader));
+
+struct SharedContigRecord
+{
+    // offset of the first base from the beginning of the segment
+    unsigned long offset_;
+    unsigned long length_;
+    // modification time and size of the fasta file at the time the contig was loaded
+    long fastaLastWriteTime_;
+    unsigned long fastaSize_;
+};
+BOOST_STATIC_ASSERT(32 == sizeof(SharedContigRecord));
+
+/**
+ * \brief Decoded bases of all contigs of one sorted reference in a shared memory segment. The contig records
+ *        follow the header in the order of SortedReferenceMetadata::Contig::index_.
+ */
+class SharedContigs : boost::noncopyable
+{
+public:
+    static const unsigned FORMAT_VERSION = 2;
+
+    SharedContigs();
+    /// Unmaps the segment. The segment is also removed if this object has published it.
+    ~SharedContigs();
+
+    /**
+     * \brief Loads the contigs from the fasta files and publishes them under segmentName.
+     */
+    void publish(
+        const std::string &segmentName,
+        const SortedReferenceMetadata::Contigs &xmlContigs,
+        common::ThreadVector &loadThreads);
+
+    /**
+     * \brief Maps an existing segment read-only
+     *
+     * \return false if the segment does not exist or has not been published by a compatible version
+     */
+    bool attach(const std::string &segmentName);
+
+    bool isAttached() const {return 0 != base_;}
+    const std::string &getSegmentName() const {return segmentName_;}
+
+    /**
+     * \brief true if the segment contains the contigs of the same lengths as xmlContigs and the fasta files
+     *        of xmlContigs have not been modified since the contigs were loaded from them
+     */
+    bool matches(const SortedReferenceMetadata::Contigs &xmlContigs) const;
+
+    /// copies the bases of the contig with SortedReferenceMetadata::Contig::index_ equal to index
+    void copyContig(const unsigned index, std::vector<char> &forward) const;
+
+private:
+    std::string segmentName_;
+    bool owner_;
+    char *base_;
+    std::size_t bytes_;
+
+    const SharedContigsHeader &getHeader() const {return *reinterpret_cast<const SharedContigsHeader*>(base_);}
+    const SharedContigRecord *getRecords() const
+    {
+        return reinterpret_cast<const SharedContigRecord*>(base_ + sizeof(SharedContigsHeader));
+    }
+    void release();
+    void publishParallel(
+        const SortedReferenceMetadata::Contigs &xmlContigs,
+        SortedReferenceMetadata::Contigs::const_iterator &nextContigToLoad,
+        boost::mutex &mutex);
+};
+
+/// shared contigs for each reference. References that could not be attached have isAttached() == false
+typedef boost::ptr_vector<SharedContigs> SharedContigsList;
+
+} // namespace reference
+} // namespace isaac
+
+#endif // #ifndef iSAAC_REFERENCE_SHARED_CONTIGS_HH
@@ -21,6 +21,9 @@
 #define iSAAC_REPORTS_ALIGNMENT_REPORT_GENERATOR_HH
 
 #include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
+
+#include <libxslt/xsltInternals.h>
 
 #include "flowcell/Layout.hh"
 
@@ -45,11 +48,16 @@ public:
     const std::vector<flowcell::Layout> &flowcellLayoutList_;
     const boost::filesystem::path alignmentStatsXmlPath_;
     const boost::filesystem::path demultiplexingStatsXmlPath_;
+    const boost::filesystem::path profilingStatsXmlPath_;
     const boost::filesystem::path tempDirectory_;
-    const boost::filesystem::path gnuplotScriptPath_;
+    const boost::filesystem::path gnuplotScriptDirectory_;
     const boost::filesystem::path outputDirectoryHtml_;
     const boost::filesystem::path outputDirectoryImages_;
     const ImageFileFormat imageFileFormat_;
+    const bool summaryOnly_;
+    const unsigned threads_;
+    // number of concurrent stylesheet transformations. Each one parses its own copy of the stats xml
+    const unsigned partitions_;
 
 public:
     AlignmentReportGenerator(
@@ -57,12 +65,28 @@ public:
         const flowcell::BarcodeMetadataList &barcodeMetadataList,
         const boost::filesystem::path &alignmentStatsXmlPath,
         const boost::filesystem::path &demultiplexingStatsXmlPath,
+        const boost::filesystem::path &profilingStatsXmlPath,
         const boost::filesystem::path &tempDirectory,
         const boost::filesystem::path &outputDirectory,
-        const ImageFileFormat imageFileFormat);
+        const ImageFileFormat imageFileFormat,
+        const bool summaryOnly,
+        const unsigned threads);
 
+    /**
+     * \brief Applies the report stylesheet in partitions_ concurrent partitions, then renders the images
+     *        by running the per-lane gnuplot scripts in parallel
+     */
     void run();
 
+private:
+    void applyStylesheet(
+        const unsigned partition,
+        const xsltStylesheetPtr stylesheet,
+        const boost::filesystem::path &isaacFullDataDir) const;
+    void renderImages(
+        const std::vector<boost::filesystem::path> &gnuplotScripts,
+        std::size_t &nextScript,
+        boost::mutex &mutex) const;
 };
 
 } // namespace reports
@@ -25,14 +25,16 @@
 #include <boost/iostreams/filtering_stream.hpp>
 #include <boost/iostreams/filter/gzip.hpp>
 
+#include "bgzf/BgzfReader.hh"
 #include "common/Debug.hh"
 #include "common/FileSystem.hh"
 #include "common/Memory.hh"
 #include "common/Threads.hpp"
 #include "flowcell/BclBgzfLayout.hh"
 #include "flowcell/TileMetadata.hh"
-#include "io/InflateGzipDecompressor.hh"
 #include "io/FileBufCache.hh"
+#include "io/FileBufWithReopen.hh"
+#include "io/MappedFile.hh"
 #include "rta/CycleBciMapper.hh"
 
 namespace isaac
@@ -46,31 +48,59 @@ class CycleTileOffsetMap
 };
 
 
+/**
+ * \brief Reads tile data from bcl.bgzf cycle files. The compressed region of the tile is read with a single
+ *        request, split into bgzf blocks and the blocks are inflated independently, either on the calling
+ *        thread or, when blockInflater is supplied, across the threads of the blockInflater. The blockInflater
+ *        must not be shared with readers that are used concurrently.
+ *
+ *        When mapBgzfBcls is set, the cycle file is memory-mapped instead and the blocks are indexed and inflated
+ *        straight from the mapping. The mapping is kept while consecutive tiles come from the same cycle file.
+ */
 class BclBgzfTileReader
 {
+    /// amount of compressed data requested from the file system at once
+    static const std::size_t COMPRESSED_READ_CHUNK = 1024 * 1024;
 public:
     BclBgzfTileReader(const BclBgzfTileReader &that) :
         ignoreMissingBcls_(that.ignoreMissingBcls_),
+        mapBgzfBcls_(that.mapBgzfBcls_),
         tileBciIndexMap_(that.tileBciIndexMap_),
         cycleBciMappers_(that.cycleBciMappers_),
-        decompressor_(that.decompressor_),
+        blockInflater_(that.blockInflater_),
+        blockReader_(),
+        boundaryBuffer_(bgzf::ParallelBgzfBlockInflater::UNCOMPRESSED_BLOCK_MAX),
+        compressedBytesMax_(0),
         bclFileBuffer_(std::ios_base::in | std::ios_base::binary)
     {
     }
 
+    /**
+     * \param mapBgzfBcls   when set, the compressed cycle files are memory-mapped rather than read
+     * \param blockInflater if not 0, the thread pool to inflate the bgzf blocks of a tile in parallel.
+     */
     BclBgzfTileReader(
         const bool ignoreMissingBcls,
+        const bool mapBgzfBcls,
         const unsigned maxClusters,
         const std::vector<unsigned> &tileBciIndexMap,
-        const std::vector<rta::CycleBciMapper> &cycleBciMappers):
+        const std::vector<rta::CycleBciMapper> &cycleBciMappers,
+        bgzf::ParallelBgzfBlockInflater *blockInflater):
         ignoreMissingBcls_(ignoreMissingBcls),
+        mapBgzfBcls_(mapBgzfBcls),
         tileBciIndexMap_(tileBciIndexMap),
         cycleBciMappers_(cycleBciMappers),
-        decompressor_(maxClusters),
+        blockInflater_(blockInflater),
+        blockReader_(),
+        boundaryBuffer_(bgzf::ParallelBgzfBlockInflater::UNCOMPRESSED_BLOCK_MAX),
+        compressedBytesMax_(0),
         bclFileBuffer_(std::ios_base::in | std::ios_base::binary)
     {
     }
 
+    /// \param blockInflater if not 0, the inflater this reader uses exclusively
+    void setBlockInflater(bgzf::ParallelBgzfBlockInflater *blockInflater) {blockInflater_ = blockInflater;}
+
     void reserveBuffers(
         const std::size_t reservePathLength,
         const std::size_t maxDecompressedBytes)
@@ -78,9 +108,21 @@ public:
         // ensure the cycleFilePath_ owns a buffer of maxFilePathLen capacity
         {cycleFilePath_ = std::string(reservePathLength, 'a');}
         cycleFilePath_.clear();
+        {prefetchFilePath_ = std::string(reservePathLength, 'a');}
+        prefetchFilePath_.clear();
 
         openFilePath_ = std::string(reservePathLength, 'a');
-        decompressor_.resize(maxDecompressedBytes);
+        mappedFilePath_ = std::string(reservePathLength, 'a');
+
+        // deflate never expands data by more than a few bytes per 64K block. Leave room for the block the tile starts
+        // in, the block it ends in and the data read past the end of the tile.
+        compressedBytesMax_ = maxDecompressedBytes + maxDecompressedBytes / 64 +
+            bgzf::ParallelBgzfBlockInflater::UNCOMPRESSED_BLOCK_MAX * 4 + COMPRESSED_READ_CHUNK;
+        if (!mapBgzfBcls_)
+        {
+            compressedBuffer_.resize(compressedBytesMax_);
+        }
+        blocks_.reserve(compressedBytesMax_ / sizeof(bgzf::Header) + 1);
     }
 
     unsigned readTileCycle(
@@ -100,6 +142,23 @@ public:
             std::fill(cycleBuffer, cycleBuffer + tile.getClusterCount(), 0);
             return tile.getClusterCount();
         }
+        else if (mapBgzfBcls_)
+        {
+            if (mappedFilePath_ != cycleFilePath_)
+            {
+                // keep the cycle file mapped as we're continuing to read the next tile from the same file
+                cycleMapping_.map(cycleFilePath_, io::FileBufWithReopen::SequentialOnce);
+                mappedFilePath_ = cycleFilePath_.c_str(); // avoid string buffer sharing on copy
+            }
+            *reinterpret_cast<boost::uint32_t*>(cycleBuffer) = tile.getClusterCount();
+
+            const unsigned tileBciIndex = tileBciIndexMap_.at(tile.getOriginalIndex());
+            const rta::CycleBciMapper &cycleBciMapper = cycleBciMappers_.at(cycle);
+            return loadMappedBcl(
+                cycleFilePath_, cycleBciMapper.getTileOffset(tileBciIndex),
+                cycleBciMapper.getTileCompressedBytesMax(tileBciIndex, bgzf::COMPRESSED_BLOCK_MAX),
+                cycleBuffer + sizeof(boost::uint32_t), tile.getClusterCount());
+        }
         else
         {
             std::istream source(
@@ -118,17 +177,94 @@ public:
         }
     }
 
+    /**
+     * \brief bcl.bgzf data is always compressed and cannot be handed out in place. readTileCycle must be used.
+     *        With mapBgzfBcls it inflates the tile from the memory-mapped cycle file.
+     *
+     * \return always 0
+     */
+    const char *mapTileCycle(
+        const flowcell::Layout &flowcellLayout,
+        const flowcell::TileMetadata &tile,
+        const unsigned cycle,
+        io::MappedFile &mapping)
+    {
+        mapping.unmap();
+        return 0;
+    }
+
+    /**
+     * \brief Tells the kernel to start reading the compressed region of the tile-cycle in background so that
+     *        it is readily available by the time readTileCycle needs it.
+     */
+    void prefetchTileCycle(
+        const flowcell::Layout &flowcellLayout,
+        const flowcell::TileMetadata &tile,
+        const unsigned cycle)
+    {
+        flowcellLayout.getLaneCycleAttribute<
+            flowcell::Layout::BclBgzf,flowcell::BclFilePathAttributeTag>(tile.getLane(), cycle, prefetchFilePath_);
+        const rta::CycleBciMapper &cycleBciMapper = cycleBciMappers_.at(cycle);
+        const unsigned tileBciIndex = tileBciIndexMap_.at(tile.getOriginalIndex());
+        const rta::CycleBciMapper::VirtualOffset tileOffset = cycleBciMapper.getTileOffset(tileBciIndex);
+        // the bci tells where the next tile starts. For the last tile in the file 0 makes the kernel read to the end.
+        io::prefetchFileRange(prefetchFilePath_.c_str(), tileOffset.compressedOffset,
+                              cycleBciMapper.getTileCompressedBytesMax(tileBciIndex, bgzf::COMPRESSED_BLOCK_MAX));
+    }
+
 private:
     const bool ignoreMissingBcls_;
+    const bool mapBgzfBcls_;
     const std::vector<unsigned> &tileBciIndexMap_;
     const std::vector<rta::CycleBciMapper> &cycleBciMappers_;
-    io::InflateGzipDecompressor<std::vector<char> > decompressor_;
+    bgzf::ParallelBgzfBlockInflater *blockInflater_;
+    bgzf::BgzfReader blockReader_;
+    std::vector<char> boundaryBuffer_;
+    /// most compressed bytes that can hold the data of a single tile
+    std::size_t compressedBytesMax_;
+    std::vector<char> compressedBuffer_;
+    std::vector<bgzf::BlockLocation> blocks_;
     boost::filesystem::path cycleFilePath_;
+    boost::filesystem::path prefetchFilePath_;
     io::FileBufWithReopen bclFileBuffer_;
     boost::filesystem::path openFilePath_;
+    io::MappedFile cycleMapping_;
+    boost::filesystem::path mappedFilePath_;
 
     typedef boost::error_info<struct tag_errmsg, std::string> errmsg_info;
 
+    /**
+     * \brief reads compressed data until the blocks cover uncompressedEnd bytes of the uncompressed stream
+     */
+    void readBlocks(std::istream &source, const boost::filesystem::path &filePath, const unsigned long uncompressedEnd)
+    {
+        blocks_.clear();
+        unsigned long uncompressedOffset = 0;
+        std::size_t compressedBytes = 0;
+        const char *unindexed = &compressedBuffer_.front();
+        while (uncompressedEnd > uncompressedOffset)
+        {
+            if (!source.good())
+            {
+                BOOST_THROW_EXCEPTION(common::IoException(EINVAL, (boost::format(
+                    "Unexpected end of %s. Uncompressed %d bytes out of %d required") %
+                    filePath % uncompressedOffset % uncompressedEnd).str()));
+            }
+
+            const std::size_t chunk = std::min(std::size_t(COMPRESSED_READ_CHUNK), compressedBuffer_.size() - compressedBytes);
+            ISAAC_ASSERT_MSG(chunk, "Compressed data for tile does not fit in " << compressedBuffer_.size() << " bytes " << filePath);
+            source.read(&compressedBuffer_.front() + compressedBytes, chunk);
+            if (!source.good() && !source.eof())
+            {
+                BOOST_THROW_EXCEPTION(common::IoException(errno, (boost::format("Failed to read %d bytes from %s: %s") %
+                    chunk % filePath % strerror(errno)).str()));
+            }
+            compressedBytes += source.gcount();
+            unindexed = bgzf::indexBlocks(
+                unindexed, &compressedBuffer_.front() + compressedBytes, uncompressedOffset, blocks_);
+        }
+    }
+
     unsigned loadCompressedBcl(std::istream &source,
                            const boost::filesystem::path &filePath,
                            const rta::CycleBciMapper::VirtualOffset &tileOffset,
@@ -137,15 +273,59 @@ private:
     {
         try
         {
-            decompressor_.reset();
+            source.clear();
             if (!source.seekg(tileOffset.compressedOffset))
             {
                 BOOST_THROW_EXCEPTION(common::IoException(errno, (boost::format("Failed to seek to position %d in %s: %s") %
                     boost::uint64_t(tileOffset.compressedOffset) % filePath % strerror(errno)).str()));
             }
-            const unsigned decompressedBytes = decompressor_.read(source, tileOffset.uncompressedOffset, bufferStart, bufferSize);
+            readBlocks(source, filePath, tileOffset.uncompressedOffset + bufferSize);
+            return inflateTile(filePath, tileOffset, bufferStart, bufferSize);
+        }
+        catch (boost::exception &e)
+        {
+            e << errmsg_info(" While reading from " + filePath.string());
+            throw;
+        }
+        return 0;
+    }
 
-            return decompressedBytes;
+    /**
+     * \param compressedBytesMax number of mapped bytes from tileOffset.compressedOffset that are known to contain
+     *                           the tile or 0 if unknown
+     */
+    unsigned loadMappedBcl(const boost::filesystem::path &filePath,
+                           const rta::CycleBciMapper::VirtualOffset tileOffset,
+                           const boost::uint64_t compressedBytesMax,
+                           char *bufferStart,
+                           const std::size_t bufferSize)
+    {
+        try
+        {
+            if (cycleMapping_.size() < tileOffset.compressedOffset)
+            {
+                BOOST_THROW_EXCEPTION(common::IoException(EINVAL, (boost::format(
+                    "Tile offset %d is past the end of %s, %d bytes") %
+                    boost::uint64_t(tileOffset.compressedOffset) % filePath % cycleMapping_.size()).str()));
+            }
+            const char *begin = cycleMapping_.data() + tileOffset.compressedOffset;
+            // never index more blocks than the read path would have buffered
+            std::size_t compressedBytes = std::min<std::size_t>(cycleMapping_.end() - begin, compressedBytesMax_);
+            if (compressedBytesMax)
+            {
+                compressedBytes = std::min<std::size_t>(compressedBytes, compressedBytesMax);
+            }
+
+            blocks_.clear();
+            unsigned long uncompressedOffset = 0;
+            bgzf::indexBlocks(begin, begin + compressedBytes, uncompressedOffset, blocks_);
+            if (tileOffset.uncompressedOffset + bufferSize > uncompressedOffset)
+            {
+                BOOST_THROW_EXCEPTION(common::IoException(EINVAL, (boost::format(
+                    "Unexpected end of %s. Uncompressed %d bytes out of %d required") %
+                    filePath % uncompressedOffset % (tileOffset.uncompressedOffset + bufferSize)).str()));
+            }
+            return inflateTile(filePath, tileOffset, bufferStart, bufferSize);
         }
         catch (boost::exception &e)
         {
@@ -154,6 +334,29 @@ private:
         }
         return 0;
     }
+
+    /**
+     * \brief inflates the tile data out of blocks_
+     */
+    unsigned inflateTile(const boost::filesystem::path &filePath,
+                         const rta::CycleBciMapper::VirtualOffset tileOffset,
+                         char *bufferStart,
+                         const std::size_t bufferSize)
+    {
+        const std::size_t inflatedBytes = blockInflater_ ?
+            blockInflater_->inflate(blocks_, tileOffset.uncompressedOffset, bufferStart, bufferSize) :
+            bgzf::inflateBlocks(blockReader_, &boundaryBuffer_.front(), blocks_, 0, 1,
+                                tileOffset.uncompressedOffset, bufferStart, bufferSize);
+
+        if (bufferSize != inflatedBytes)
+        {
+            BOOST_THROW_EXCEPTION(common::IoException(EINVAL, (boost::format(
+                "Inflated %d bytes instead of %d expected clusters from %s") %
+                inflatedBytes % bufferSize % filePath).str()));
+        }
+
+        return inflatedBytes;
+    }
 };
 
 } // namespace rta
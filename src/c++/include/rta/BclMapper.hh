@@ -34,6 +34,7 @@
 
 #include "io/InflateGzipDecompressor.hh"
 #include "io/FileBufCache.hh"
+#include "io/MappedFile.hh"
 
 namespace isaac
 {
@@ -56,28 +57,24 @@ public:
     void get(unsigned clusterIndex, InsertIteratorT insertIterator) const
     {
         ISAAC_ASSERT_MSG(clusterIndex < clusterCount_, "Requested cluster number is not in the data");
-        const char *clusterCycleEnd = getBclBufferStart(cycleNumbers_) + getClusterOffset(clusterIndex);
-        const char *clusterCyclePointer = getBclBufferStart(0) + getClusterOffset(clusterIndex);
-        const unsigned increment = getTileSize(1);
-        while(clusterCycleEnd != clusterCyclePointer)
+        const unsigned clusterOffset = getClusterOffset(clusterIndex);
+        for (std::vector<const char *>::const_iterator cycleData = cycleData_.begin();
+            cycleData_.end() != cycleData; ++cycleData)
         {
-            *insertIterator++ = *clusterCyclePointer;
-            clusterCyclePointer += increment;
+            *insertIterator++ = (*cycleData)[clusterOffset];
         }
     }
 
     template <typename InsertIteratorT>
     void transpose(InsertIteratorT insertIterator) const
     {
-        const unsigned increment = getTileSize(1);
         for (unsigned clusterIndex = 0; clusterCount_ > clusterIndex; ++ clusterIndex)
         {
-            const char *clusterCycleEnd = getBclBufferStart(cycleNumbers_) + getClusterOffset(clusterIndex);
-            const char *clusterCyclePointer = getBclBufferStart(0) + getClusterOffset(clusterIndex);
-            while(clusterCycleEnd != clusterCyclePointer)
+            const unsigned clusterOffset = getClusterOffset(clusterIndex);
+            for (std::vector<const char *>::const_iterator cycleData = cycleData_.begin();
+                cycleData_.end() != cycleData; ++cycleData)
             {
-                *insertIterator++ = *clusterCyclePointer;
-                clusterCyclePointer += increment;
+                *insertIterator++ = (*cycleData)[clusterOffset];
             }
         }
     }
@@ -108,10 +105,17 @@ public:
     void unreserve()
     {
         std::vector<char>().swap(tileData_);
+        std::vector<const char *>().swap(cycleData_);
     }
 
     unsigned getCyclesCount() const {return cycleNumbers_;}
 
+    /// bcl bytes of the cycle, one per cluster, in cluster order
+    const char *getCycleClusters(const unsigned cycleIndex) const
+    {
+        return cycleData_.at(cycleIndex) + getClusterOffset(0);
+    }
+
 protected:
     unsigned long getUnpaddedBclSize() const
     {
@@ -133,14 +137,14 @@ protected:
         return &tileData_.front() + getTileSize(cycleIndex);
     }
 
-    const char *getBclBufferStart(const unsigned cycleIndex) const
-    {
-        return &tileData_.front() + getTileSize(cycleIndex);
-    }
-
-    const char *getBclBufferEnd(const unsigned cycleIndex) const
+    /**
+     * \brief Points the cycle at the bcl data residing outside of the tile buffer such as memory-mapped
+     *        uncompressed bcl file. The data must have the same layout as the bcl file and stay valid until
+     *        the next setGeometry call.
+     */
+    void setCycleData(const unsigned cycleIndex, const char *bclData)
     {
-        return &tileData_.front() + getTileSize(cycleIndex + 1);
+        cycleData_.at(cycleIndex) = bclData;
     }
 
     unsigned getClusterOffset(const unsigned clusterNumber) const
@@ -153,6 +157,11 @@ protected:
         clusterCount_ = clusterCount;
         cycleNumbers_ = cycles;
         tileData_.resize(getTileSize(cycleNumbers_));
+        cycleData_.clear();
+        for (unsigned cycleIndex = 0; cycleNumbers_ > cycleIndex; ++cycleIndex)
+        {
+            cycleData_.push_back(getCycleBufferStart(cycleIndex));
+        }
     }
 
     /**
@@ -163,6 +172,7 @@ protected:
         cycleNumbers_(maxCycles)
     {
         tileData_.reserve(getTileSize(cycleNumbers_));
+        cycleData_.reserve(cycleNumbers_);
     }
 
     static unsigned int getClusterCount(std::istream &is, const boost::filesystem::path &bclFilePath)
@@ -183,6 +193,8 @@ private:
     unsigned clusterCount_;
     unsigned cycleNumbers_;
     std::vector<char> tileData_;
+    // points at the bcl data for each cycle either inside tileData_ or in the memory-mapped bcl file
+    std::vector<const char *> cycleData_;
 };
 
 /**
@@ -195,6 +207,8 @@ class ParallelBclMapper : BclMapper
     const unsigned maxInputLoaders_;
     std::vector<ReaderT> &threadReaders_;
     std::vector<unsigned> cycleNumbers_;
+    // keeps the memory-mapped bcl files of the current tile, one per cycle
+    std::vector<io::MappedFile> cycleMappings_;
 public:
     using BclMapper::transpose;
     using BclMapper::getCyclesCount;
@@ -209,7 +223,8 @@ public:
         threads_(threads),
         maxInputLoaders_(maxInputLoaders),
         threadReaders_(threadReaders),
-        cycleNumbers_(maxCycles)
+        cycleNumbers_(maxCycles),
+        cycleMappings_(maxCycles)
     {
         std::for_each(threadReaders_.begin(), threadReaders_.end(),
                       boost::bind(&ReaderT::reserveBuffers, _1, reservePathLength, getTileSize(1)));
@@ -251,9 +266,24 @@ private:
             thistThreadCycleOffset += threads_.size())
         {
             const unsigned cycle = *(threadCyclesBegin + thistThreadCycleOffset);
-            const unsigned readClusters = threadReaders_[threadNumber].readTileCycle(
-                flowcell, tileMetadata, cycle,
-                getCycleBufferStart(thistThreadCycleOffset), getTileSize(1));
+            ReaderT &reader = threadReaders_[threadNumber];
+            if (std::size_t(std::distance(threadCyclesBegin, threadCyclesEnd)) > thistThreadCycleOffset + threads_.size())
+            {
+                // get the file system busy with the next cycle of this thread while the current one is being decoded
+                reader.prefetchTileCycle(
+                    flowcell, tileMetadata, *(threadCyclesBegin + thistThreadCycleOffset + threads_.size()));
+            }
+            const char *mappedBcl = reader.mapTileCycle(
+                flowcell, tileMetadata, cycle, cycleMappings_.at(thistThreadCycleOffset));
+            if (mappedBcl)
+            {
+                setCycleData(thistThreadCycleOffset, mappedBcl);
+            }
+            const unsigned readClusters = mappedBcl ?
+                reinterpret_cast<const boost::uint32_t&>(*mappedBcl) :
+                reader.readTileCycle(
+                    flowcell, tileMetadata, cycle,
+                    getCycleBufferStart(thistThreadCycleOffset), getTileSize(1));
             ISAAC_ASSERT_MSG(readClusters == clusterCount, "Expected Bcl number of clusters(" << clusterCount <<
                              ") does not match the one read from file(readClusters:" << readClusters <<
                              "cycle:" << cycle << "): ");
@@ -271,6 +301,7 @@ class SingleCycleBclMapper : BclMapper
 {
 public:
     using BclMapper::get;
+    using BclMapper::getCycleClusters;
     SingleCycleBclMapper(
         const unsigned maxClusters,
         const std::size_t reservePathLength, const bool reserveCompressionBuffer,
@@ -285,16 +316,32 @@ public:
     {
         setGeometry(1, tile.getClusterCount());
 
-        const unsigned readClusters = reader_.readTileCycle(
-            flowcellLayout, tile, cycle, getCycleBufferStart(0), getTileSize(1));
+        const char *mappedBcl = reader_.mapTileCycle(flowcellLayout, tile, cycle, cycleMapping_);
+        if (mappedBcl)
+        {
+            setCycleData(0, mappedBcl);
+        }
+        const unsigned readClusters = mappedBcl ?
+            reinterpret_cast<const boost::uint32_t&>(*mappedBcl) :
+            reader_.readTileCycle(flowcellLayout, tile, cycle, getCycleBufferStart(0), getTileSize(1));
 
         ISAAC_ASSERT_MSG(readClusters == tile.getClusterCount(), "Expected Bcl number of clusters(" << tile.getClusterCount() <<
                          ") does not match the one read from file(" << readClusters <<
                          "): " << tile << " cycle:" << cycle);
     }
 
+    /**
+     * \brief Allows the data of a cycle that will be needed next to be read in background while the
+     *        current cycle is being processed
+     */
+    void prefetchTileCycle(const flowcell::Layout &flowcellLayout, const flowcell::TileMetadata &tile, const unsigned cycle)
+    {
+        reader_.prefetchTileCycle(flowcellLayout, tile, cycle);
+    }
+
 private:
     ReaderT &reader_;
+    io::MappedFile cycleMapping_;
 };
 
 
@@ -34,6 +34,7 @@
 
 #include "io/InflateGzipDecompressor.hh"
 #include "io/FileBufCache.hh"
+#include "io/MappedFile.hh"
 
 namespace isaac
 {
@@ -45,13 +46,19 @@ class BclReader
 public:
     BclReader(const BclReader &that) :
         ignoreMissingBcls_(that.ignoreMissingBcls_),
+        mapFlatBcls_(that.mapFlatBcls_),
         decompressor_(that.decompressor_),
         bclFileBuffer_(1, std::ios_base::in | std::ios_base::binary)
     {
     }
 
-    BclReader(const bool ignoreMissingBcls, const unsigned maxClusters):
+    /**
+     * \param mapFlatBcls  when set, mapTileCycle memory-maps uncompressed bcl files instead of requiring the
+     *                     caller to copy them with readTileCycle
+     */
+    BclReader(const bool ignoreMissingBcls, const bool mapFlatBcls, const unsigned maxClusters):
         ignoreMissingBcls_(ignoreMissingBcls),
+        mapFlatBcls_(mapFlatBcls),
         decompressor_(maxClusters),
         bclFileBuffer_(1, std::ios_base::in | std::ios_base::binary)
     {
@@ -64,6 +71,8 @@ public:
         // ensure the cycleFilePath_ owns a buffer of maxFilePathLen capacity
         {cycleFilePath_ = std::string(reservePathLength, 'a');}
         cycleFilePath_.clear();
+        {prefetchFilePath_ = std::string(reservePathLength, 'a');}
+        prefetchFilePath_.clear();
 
         bclFileBuffer_.reservePathBuffers(reservePathLength);
         if (maxDecompressedBytes)
@@ -98,9 +107,61 @@ public:
         }
     }
 
+    /**
+     * \brief Maps uncompressed bcl file into memory so that the tile cycle data can be accessed without copying.
+     *
+     * \return pointer to the bcl data (cluster count followed by base calls) inside the mapping or 0 if
+     *         the bcl cannot be mapped. In the latter case readTileCycle must be used
+     */
+    const char *mapTileCycle(
+        const flowcell::Layout &flowcellLayout,
+        const flowcell::TileMetadata &tile,
+        const unsigned cycle,
+        io::MappedFile &mapping)
+    {
+        if (mapFlatBcls_)
+        {
+            flowcellLayout.getLaneTileCycleAttribute<flowcell::Layout::Bcl, flowcell::BclFilePathAttributeTag>(
+                tile.getLane(), tile.getTile(), cycle, cycleFilePath_);
+
+            if (!common::isDotGzPath(cycleFilePath_) &&
+                (!ignoreMissingBcls_ || boost::filesystem::exists(cycleFilePath_)))
+            {
+                const char *bclData = mapping.map(cycleFilePath_, io::FileBufWithReopen::SequentialOnce);
+                const boost::uint32_t clusterCount = mapping.size() < sizeof(boost::uint32_t) ?
+                    0 : reinterpret_cast<const boost::uint32_t&>(*bclData);
+                if (mapping.size() < sizeof(clusterCount) + clusterCount)
+                {
+                    BOOST_THROW_EXCEPTION(common::IoException(EINVAL, (boost::format(
+                        "Bcl file is too short. Expected at least %d bytes, got %d: %s") %
+                        (sizeof(clusterCount) + clusterCount) % mapping.size() % cycleFilePath_.string()).str()));
+                }
+                return bclData;
+            }
+        }
+        mapping.unmap();
+        return 0;
+    }
+
+    /**
+     * \brief Tells the kernel to start reading the bcl file in background so that it is readily available
+     *        by the time readTileCycle or mapTileCycle needs it.
+     */
+    void prefetchTileCycle(
+        const flowcell::Layout &flowcellLayout,
+        const flowcell::TileMetadata &tile,
+        const unsigned cycle)
+    {
+        flowcellLayout.getLaneTileCycleAttribute<flowcell::Layout::Bcl, flowcell::BclFilePathAttributeTag>(
+            tile.getLane(), tile.getTile(), cycle, prefetchFilePath_);
+        io::prefetchFileRange(prefetchFilePath_.c_str(), 0, 0);
+    }
+
 private:
     const bool ignoreMissingBcls_;
+    const bool mapFlatBcls_;
     boost::filesystem::path cycleFilePath_;
+    boost::filesystem::path prefetchFilePath_;
     io::InflateGzipDecompressor<std::vector<char> > decompressor_;
 
     io::FileBufCache<io::FileBufWithReopen> bclFileBuffer_;
@@ -96,6 +96,29 @@ public:
         return tileOffsets_.at(tileIndex);
     }
 
+    /**
+     * \brief returns the number of bytes of the cycle bcl file, starting at the tile compressedOffset, that are
+     *        guaranteed to contain all of the tile data, or 0 if the tile data may extend to the end of the file.
+     *
+     *        Tiles are stored in the order of the bci records. A tile ends where the next one begins. If the next
+     *        tile begins part way into a bgzf block, that whole block is needed too.
+     */
+    boost::uint64_t getTileCompressedBytesMax(const unsigned tileIndex, const unsigned compressedBlockMax) const
+    {
+        if (tileOffsets_.size() <= tileIndex + 1)
+        {
+            return 0;
+        }
+        const VirtualOffset tileOffset = tileOffsets_.at(tileIndex);
+        const VirtualOffset nextOffset = tileOffsets_.at(tileIndex + 1);
+        if (nextOffset.compressedOffset < tileOffset.compressedOffset)
+        {
+            return 0;
+        }
+        return nextOffset.compressedOffset - tileOffset.compressedOffset +
+            (nextOffset.uncompressedOffset ? compressedBlockMax : 0);
+    }
+
 private:
     std::vector<VirtualOffset> tileOffsets_;
 };
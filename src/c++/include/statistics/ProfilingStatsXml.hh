@@ -0,0 +1,57 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file ProfilingStatsXml.hh
+ **
+ ** \brief Xml Serialization of the processing stage timings.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifndef ISAAC_STATISTICS_PROFILING_STATS_XML_H
+#define ISAAC_STATISTICS_PROFILING_STATS_XML_H
+
+#include <ostream>
+
+#include "common/Profiling.hh"
+#include "flowcell/TileMetadata.hh"
+#include "xml/XmlWriter.hh"
+
+namespace isaac
+{
+namespace statistics
+{
+
+class ProfilingStatsXml
+{
+    const common::Profiler &profiler_;
+    const flowcell::TileMetadataList &tileMetadataList_;
+
+    void dumpSteps(xml::XmlWriter &xmlWriter) const;
+    void dumpCounters(xml::XmlWriter &xmlWriter, const common::StageCounters &counters) const;
+    void dumpUnits(xml::XmlWriter &xmlWriter, const common::Profiler::Stage stage) const;
+
+public:
+    /**
+     * \param tileMetadataList used to annotate per-tile timings with flowcell, lane and tile number.
+     */
+    ProfilingStatsXml(
+        const common::Profiler &profiler,
+        const flowcell::TileMetadataList &tileMetadataList);
+
+    void serialize(std::ostream &os) const;
+};
+
+} //namespace statistics
+} //namespace isaac
+
+#endif //ISAAC_STATISTICS_PROFILING_STATS_XML_H
@@ -37,6 +37,7 @@
 #include "alignment/matchFinder/TileClusterInfo.hh"
 #include "build/BarcodeBamMapping.hh"
 #include "build/BinSorter.hh"
+#include "common/MemoryGovernor.hh"
 #include "common/Threads.hpp"
 #include "demultiplexing/BarcodeLoader.hh"
 #include "demultiplexing/BarcodeResolver.hh"
@@ -46,6 +47,7 @@
 #include "flowcell/TileMetadata.hh"
 #include "oligo/Kmer.hh"
 #include "reference/ReferenceMetadata.hh"
+#include "reference/SharedContigs.hh"
 #include "reference/SortedReferenceXml.hh"
 
 #include "workflow/alignWorkflow/FindMatchesTransition.hh"
@@ -90,9 +92,12 @@ public:
         const bool cleanupIntermediary,
         const bool ignoreMissingBcls,
         const bool ignoreMissingFilters,
+        const bool memoryMapInput,
         const unsigned firstPassSeeds,
+        const unsigned seedIterations,
         const unsigned long matchesPerBin,
         const reference::ReferenceMetadataList &referenceMetadataList,
+        const bfs::path &referenceServerSocket,
         const bfs::path &tempDirectory,
         const bfs::path &outputDirectory,
         const unsigned maxThreadCount,
@@ -123,6 +128,7 @@ public:
         const int gapOpenScore,
         const int gapExtendScore,
         const int minGapExtendScore,
+        const bool fixedPointScoring,
         const unsigned semialignedGapLimit,
         const alignment::TemplateBuilder::DodgyAlignmentScore dodgyAlignmentScore,
         const unsigned inputLoadersMax,
@@ -138,21 +144,35 @@ public:
         const bool keepDuplicates,
         const bool markDuplicates,
         const std::string &binRegexString,
+        const unsigned long scatterBinLength,
+        const bool tileCheckpoints,
         const common::ScoopedMallocBlock::Mode memoryControl,
         const std::vector<std::size_t> &clusterIdList,
         const alignment::TemplateLengthStatistics &userTemplateLengthStatistics,
         const reports::AlignmentReportGenerator::ImageFileFormat statsImageFormat,
+        const bool statsSummaryOnly,
         const bool bufferBins,
         const bool qScoreBin,
         const boost::array<char, 256> &fullBclQScoreTable,
         const OptionalFeatures optionalFeatures,
-        const bool pessimisticMapQ);
+        const bool pessimisticMapQ,
+        const build::OutputFormat outputFormat,
+        const std::string &bamStreamDestination,
+        const unsigned coverageTileSize);
 
     /**
      * \brief Runs end-to-end alignment from the beginning
      */
     void run();
 
+    /**
+     * \brief Merges the match selector results of the runs that have aligned disjoint sets of tiles
+     *        of the same data. Leaves the workflow in MatchSelectorDone state.
+     */
+    void gather(
+        const std::vector<bfs::path> &scatterTempDirectoryList,
+        const std::vector<bfs::path> &scatterOutputDirectoryList);
+
 
     enum State
     {
@@ -213,9 +233,13 @@ private:
     const bool cleanupIntermediary_;
     const bool ignoreMissingBcls_;
     const bool ignoreMissingFilters_;
+    const bool memoryMapInput_;
     const unsigned firstPassSeeds_;
+    const unsigned seedIterations_;
     const unsigned long matchesPerBin_;
     const unsigned long availableMemory_;
+    // stages plan their batches and buffers against the single --memory-limit account
+    mutable common::MemoryGovernor memoryGovernor_;
     const unsigned clustersAtATimeMax_;
     const unsigned mapqThreshold_;
     const bool perTileTls_;
@@ -237,6 +261,7 @@ private:
     const int gapOpenScore_;
     const int gapExtendScore_;
     const int minGapExtendScore_;
+    const bool fixedPointScoring_;
     const unsigned semialignedGapLimit_;
     const alignment::TemplateBuilder::DodgyAlignmentScore dodgyAlignmentScore_;
     const unsigned inputLoadersMax_;
@@ -256,13 +281,26 @@ private:
     const boost::array<char, 256> &fullBclQScoreTable_;
     const OptionalFeatures optionalFeatures_;
     const bool pessimisticMapQ_;
+    const build::OutputFormat outputFormat_;
+    const std::string &bamStreamDestination_;
+    // length of the reference tiles for the coverage wig files. 0 to disable
+    const unsigned coverageTileSize_;
     const std::string &binRegexString_;
+    // when not 0, bins are laid out at fixed genomic length so that the results of scatter runs can be gathered
+    const unsigned long scatterBinLength_;
+    // when set, match finding and selection save their progress after each tile so that a restart skips them
+    const bool tileCheckpoints_;
     const common::ScoopedMallocBlock::Mode memoryControl_;
     const alignment::TemplateLengthStatistics userTemplateLengthStatistics_;
     const bfs::path demultiplexingStatsXmlPath_;
+    const bfs::path profilingStatsXmlPath_;
     const reports::AlignmentReportGenerator::ImageFileFormat statsImageFormat_;
+    // when set, the html report consists of the summary pages only
+    const bool statsSummaryOnly_;
 
     const reference::SortedReferenceMetadataList sortedReferenceMetadataList_;
+    // contigs attached from the reference server. Empty if the server is not used
+    reference::SharedContigsList sharedContigsList_;
 
     State state_;
     alignWorkflow::FoundMatchesMetadata foundMatchesMetadata_;
@@ -285,6 +323,7 @@ private:
         SelectedMatchesMetadata &binPaths,
         std::vector<alignment::TemplateLengthStatistics> &barcodeTemplateLengthStatistics) const;
     void generateAlignmentReports() const;
+    void dumpProfilingStats() const;
     const build::BarcodeBamMapping generateBam(
         const SelectedMatchesMetadata &binPaths,
         std::vector<alignment::TemplateLengthStatistics> &barcodeTemplateLengthStatistics) const;
@@ -28,6 +28,8 @@
 #include "alignment/MatchTally.hh"
 #include "common/BoostArchiveHelpers.hh"
 #include "workflow/AlignWorkflow.hh"
+#include "workflow/alignWorkflow/GatherTransition.hh"
+#include "workflow/alignWorkflow/TileCheckpoint.hh"
 
 /**
  * \brief serialization implementation types that don't require private member access
@@ -190,29 +192,68 @@ void serialize(Archive &ar, FoundMatchesMetadata &fmm, const unsigned int versio
         boost::serialization::base_object<std::vector<std::vector<unsigned> > >(fmm.matchDistribution_));
 }
 
-} //namespace alignWorkflow
-
-template <class Archive>
-void serialize(Archive &ar, AlignWorkflow &a, const unsigned int version)
+/**
+ * \brief AlignerState.txt layout. Shared between AlignWorkflow and the scatter run states loaded by gather
+ */
+template <class Archive, typename StateT>
+void serializeState(
+    Archive &ar,
+    StateT &state,
+    FoundMatchesMetadata &foundMatchesMetadata,
+    alignment::BinMetadataList &selectedMatchesMetadata,
+    std::vector<alignment::TemplateLengthStatistics> &barcodeTemplateLengthStatistics,
+    build::BarcodeBamMapping &barcodeBamMapping)
 {
-//    ar & BOOST_SERIALIZATION_NVP(a.repeatThreshold_);
-    ar & BOOST_SERIALIZATION_NVP(a.state_);
-    if (AlignWorkflow::MatchFinderDone <= a.state_)
+    ar & boost::serialization::make_nvp("a.state_", state);
+    if (AlignWorkflow::MatchFinderDone <= state)
     {
-        ar & BOOST_SERIALIZATION_NVP(a.foundMatchesMetadata_);
+        ar & boost::serialization::make_nvp("a.foundMatchesMetadata_", foundMatchesMetadata);
 
-        if (AlignWorkflow::MatchSelectorDone <= a.state_)
+        if (AlignWorkflow::MatchSelectorDone <= state)
         {
-            ar & BOOST_SERIALIZATION_NVP(a.selectedMatchesMetadata_);
-            ar & BOOST_SERIALIZATION_NVP(a.barcodeTemplateLengthStatistics_);
-            if (AlignWorkflow::BamDone <= a.state_)
+            ar & boost::serialization::make_nvp("a.selectedMatchesMetadata_", selectedMatchesMetadata);
+            ar & boost::serialization::make_nvp("a.barcodeTemplateLengthStatistics_", barcodeTemplateLengthStatistics);
+            if (AlignWorkflow::BamDone <= state)
             {
-                ar & BOOST_SERIALIZATION_NVP(a.barcodeBamMapping_);
+                ar & boost::serialization::make_nvp("a.barcodeBamMapping_", barcodeBamMapping);
             }
         }
     }
 }
 
+template <class Archive>
+void serialize(Archive &ar, ScatterRun &s, const unsigned int version)
+{
+    serializeState(ar, s.state_, s.foundMatchesMetadata_, s.selectedMatchesMetadata_,
+                   s.barcodeTemplateLengthStatistics_, s.barcodeBamMapping_);
+}
+
+template <class Archive>
+void serialize(Archive &ar, MatchFinderCheckpoint &c, const unsigned int version)
+{
+    ar & BOOST_SERIALIZATION_NVP(c.completeTiles_);
+    ar & BOOST_SERIALIZATION_NVP(c.foundMatches_);
+}
+
+template <class Archive>
+void serialize(Archive &ar, MatchSelectorCheckpoint &c, const unsigned int version)
+{
+    ar & BOOST_SERIALIZATION_NVP(c.completeTiles_);
+    ar & BOOST_SERIALIZATION_NVP(c.storedTiles_);
+    ar & BOOST_SERIALIZATION_NVP(c.binMetadataList_);
+    ar & BOOST_SERIALIZATION_NVP(c.barcodeTemplateLengthStatistics_);
+}
+
+} //namespace alignWorkflow
+
+template <class Archive>
+void serialize(Archive &ar, AlignWorkflow &a, const unsigned int version)
+{
+//    ar & BOOST_SERIALIZATION_NVP(a.repeatThreshold_);
+    alignWorkflow::serializeState(ar, a.state_, a.foundMatchesMetadata_, a.selectedMatchesMetadata_,
+                                  a.barcodeTemplateLengthStatistics_, a.barcodeBamMapping_);
+}
+
 inline void save(const boost::filesystem::path &stateFilePath, const AlignWorkflow &aligner)
 {
     const boost::filesystem::path tmp = stateFilePath.string() + ".tmp";
@@ -229,7 +270,11 @@ inline void save(const boost::filesystem::path &stateFilePath, const AlignWorkfl
     ISAAC_THREAD_CERR << "Saving workflow state done to " << stateFilePath << std::endl;
 }
 
-inline void load(const boost::filesystem::path &stateFilePath, AlignWorkflow &aligner)
+/**
+ * \brief Loads AlignerState.txt into AlignWorkflow or alignWorkflow::ScatterRun
+ */
+template <typename StateT>
+void load(const boost::filesystem::path &stateFilePath, StateT &aligner)
 {
     ISAAC_THREAD_CERR << "Loading workflow state from " << stateFilePath << std::endl;
     std::ifstream ifs(stateFilePath.string().c_str());
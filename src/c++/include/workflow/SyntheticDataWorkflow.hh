@@ -0,0 +1,118 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file SyntheticDataWorkflow.hh
+ **
+ ** \brief Generates a random reference and the paired reads sampled from it in the input formats supported
+ **        by the aligner. Used for benchmarking without real sequencing data.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifndef iSAAC_WORKFLOW_SYNTHETIC_DATA_WORKFLOW_HH
+#define iSAAC_WORKFLOW_SYNTHETIC_DATA_WORKFLOW_HH
+
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/random/mersenne_twister.hpp>
+
+namespace isaac
+{
+namespace workflow
+{
+
+namespace bfs = boost::filesystem;
+
+class SyntheticDataWorkflow: boost::noncopyable
+{
+public:
+    SyntheticDataWorkflow(
+        const bfs::path &outputDirectory,
+        const unsigned randomSeed,
+        const unsigned contigsCount,
+        const unsigned contigLength,
+        const unsigned clustersCount,
+        const unsigned tilesCount,
+        const unsigned readLength,
+        const unsigned fragmentLength,
+        const unsigned fragmentLengthDeviation,
+        const double errorRate,
+        const double indelRate,
+        const double duplicateRate,
+        const std::vector<std::string> &outputFormats);
+
+    void run();
+
+private:
+    struct Fragment
+    {
+        Fragment() : contig_(0), begin_(0), length_(0), reverse_(false){}
+        unsigned contig_;
+        unsigned begin_;
+        unsigned length_;
+        bool reverse_;
+    };
+
+    /// bases as ACGTN characters and phred qualities of both reads of a cluster
+    struct Cluster
+    {
+        std::string bases_[2];
+        std::string qualities_[2];
+    };
+
+    const bfs::path outputDirectory_;
+    const unsigned contigsCount_;
+    const unsigned contigLength_;
+    const unsigned clustersCount_;
+    const unsigned tilesCount_;
+    const unsigned readLength_;
+    const unsigned fragmentLength_;
+    const unsigned fragmentLengthDeviation_;
+    const double errorRate_;
+    const double indelRate_;
+    const double duplicateRate_;
+    const std::vector<std::string> outputFormats_;
+
+    boost::mt19937 randomGenerator_;
+    std::vector<std::string> contigs_;
+    std::vector<Cluster> clusters_;
+
+    bool isFormatRequested(const std::string &format) const;
+    double randomProbability();
+    unsigned randomNumber(const unsigned max);
+    char randomBase();
+    Fragment randomFragment();
+
+    void generateReference();
+    void generateClusters();
+    void generateRead(
+        const Fragment &fragment,
+        const bool fromFragmentEnd,
+        std::string &bases,
+        std::string &qualities);
+
+    unsigned getClusterTile(const std::size_t cluster) const;
+    std::string getClusterName(const std::size_t cluster) const;
+
+    void storeFasta() const;
+    void storeFastq() const;
+    void storeBam() const;
+    void storeBcl() const;
+};
+
+} // namespace workflow
+} // namespace isaac
+
+#endif // #ifndef iSAAC_WORKFLOW_SYNTHETIC_DATA_WORKFLOW_HH
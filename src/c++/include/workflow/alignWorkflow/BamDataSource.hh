@@ -129,6 +129,7 @@ public:
         std::vector<SeedT> &seeds,
         common::ScoopedMallocBlock  &mallocBlock);
     const std::vector<SeedIterator> &getReferenceSeedBounds() const;
+    SeedIterator getRepeatSeedsEnd() const;
 
 private:
     static unsigned determineMemoryCapacity(
@@ -58,12 +58,14 @@ class BclBgzfSeedSource : public TileSource, public BarcodeSource, public SeedSo
     typedef typename std::vector<SeedT>::iterator SeedIterator;
 
     const bool ignoreMissingBcls_;
+    const bool memoryMapInput_;
     const unsigned inputLoadersMax_;
     const unsigned coresMax_;
     const flowcell::BarcodeMetadataList &barcodeMetadataList_;
     const flowcell::Layout &bclFlowcellLayout_;
     common::ThreadVector &threads_;
     const reference::SortedReferenceMetadataList &sortedReferenceMetadataList_;
+    common::MemoryGovernor &memoryGovernor_;
     /// mapping from tile index to the index of the tile in bci.
     std::vector<unsigned> tileBciIndexMap_;
     const flowcell::TileMetadataList flowcellTiles_;
@@ -71,6 +73,8 @@ class BclBgzfSeedSource : public TileSource, public BarcodeSource, public SeedSo
     boost::scoped_ptr<alignment::ParallelSeedLoader<rta::BclBgzfTileReader, KmerT> > seedLoader_;
     // holds the state across multiple discoverTiles calls
     flowcell::TileMetadataList::const_iterator undiscoveredTiles_;
+    // each loader thread inflates the bgzf blocks of its tile-cycle on its own share of the cores
+    boost::ptr_vector<bgzf::ParallelBgzfBlockInflater> threadBlockInflaters_;
     std::vector<rta::BclBgzfTileReader> threadBclReaders_;
     demultiplexing::BarcodeLoader<rta::BclBgzfTileReader> barcodeLoader_;
 
@@ -80,11 +84,13 @@ class BclBgzfSeedSource : public TileSource, public BarcodeSource, public SeedSo
 public:
     BclBgzfSeedSource(
         const bool ignoreMissingBcls,
+        const bool memoryMapInput,
         const unsigned inputLoadersMax,
         const unsigned coresMax,
         const flowcell::BarcodeMetadataList &barcodeMetadataList,
         const reference::SortedReferenceMetadataList &sortedReferenceMetadataList,
         const flowcell::Layout &bclFlowcellLayout,
+        common::MemoryGovernor &memoryGovernor,
         common::ThreadVector &threads);
 
     // TileSource implementation
@@ -106,6 +112,7 @@ public:
         std::vector<SeedT > &seeds,
         common::ScoopedMallocBlock  &mallocBlock);
     const std::vector<SeedIterator> &getReferenceSeedBounds() const;
+    SeedIterator getRepeatSeedsEnd() const;
 private:
     /**
      * \return vector of tiles ordered by: flowcellId_, lane_, tile_
@@ -159,6 +166,7 @@ public:
         const flowcell::TileMetadataList &tileMetadataList,
         const bool ignoreMissingBcls,
         const bool ignoreMissingFilters,
+        const bool memoryMapInput,
         common::ThreadVector &bclLoadThreads,
         const unsigned inputLoadersMax,
         const bool extractClusterXy);
@@ -47,11 +47,13 @@ class BclSeedSource : public TileSource, public BarcodeSource, public SeedSource
     typedef typename std::vector<SeedT>::iterator SeedIterator;
 
     const bool ignoreMissingBcls_;
+    const bool memoryMapInput_;
     const unsigned inputLoadersMax_;
     const unsigned coresMax_;
     const flowcell::BarcodeMetadataList &barcodeMetadataList_;
     const flowcell::Layout &bclFlowcellLayout_;
     const reference::SortedReferenceMetadataList &sortedReferenceMetadataList_;
+    common::MemoryGovernor &memoryGovernor_;
     const flowcell::TileMetadataList flowcellTiles_;
     const unsigned maxTileClusterCount_;
     boost::scoped_ptr<alignment::ParallelSeedLoader<rta::BclReader, KmerT> > seedLoader_;
@@ -66,11 +68,13 @@ class BclSeedSource : public TileSource, public BarcodeSource, public SeedSource
 public:
     BclSeedSource(
         const bool ignoreMissingBcls,
+        const bool memoryMapInput,
         const unsigned inputLoadersMax,
         const unsigned coresMax,
         const flowcell::BarcodeMetadataList &barcodeMetadataList,
         const reference::SortedReferenceMetadataList &sortedReferenceMetadataList,
         const flowcell::Layout &bclFlowcellLayout,
+        common::MemoryGovernor &memoryGovernor,
         common::ThreadVector &threads);
 
     // TileSource implementation
@@ -92,6 +96,7 @@ public:
         std::vector<SeedT > &seeds,
         common::ScoopedMallocBlock  &mallocBlock);
     const std::vector<SeedIterator> &getReferenceSeedBounds() const;
+    SeedIterator getRepeatSeedsEnd() const;
 private:
     /**
      * \return vector of tiles ordered by: flowcellId_, lane_, tile_
@@ -119,6 +124,7 @@ public:
         const flowcell::TileMetadataList &tileMetadataList,
         const bool ignoreMissingBcls,
         const bool ignoreMissingFilters,
+        const bool memoryMapInput,
         common::ThreadVector &bclLoadThreads,
         const unsigned inputLoadersMax,
         const bool extractClusterXy);
@@ -82,6 +82,12 @@ struct SeedSource : boost::noncopyable
      */
     virtual const std::vector<SeedIterator> &getReferenceSeedBounds() const = 0;
 
+    /**
+     * \brief Returns the end of the seeds that are known to produce too many matches. These seeds follow
+     *        getReferenceSeedBounds().back() and are not sorted.
+     */
+    virtual SeedIterator getRepeatSeedsEnd() const = 0;
+
     virtual ~SeedSource(){}
 };
 
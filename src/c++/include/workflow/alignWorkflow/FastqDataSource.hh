@@ -92,6 +92,7 @@ public:
         std::vector<SeedT> &seeds,
         common::ScoopedMallocBlock  &mallocBlock);
     const std::vector<SeedIterator> &getReferenceSeedBounds() const;
+    SeedIterator getRepeatSeedsEnd() const;
 
 private:
     static unsigned determineMemoryCapacity(
@@ -24,6 +24,7 @@
 #include "alignment/MatchDistribution.hh"
 #include "alignment/SeedMetadata.hh"
 #include "alignment/matchFinder/TileClusterInfo.hh"
+#include "common/MemoryGovernor.hh"
 #include "common/Threads.hpp"
 #include "demultiplexing/BarcodeLoader.hh"
 #include "demultiplexing/BarcodeResolver.hh"
@@ -38,6 +39,7 @@
 
 #include "workflow/alignWorkflow/DataSource.hh"
 #include "workflow/alignWorkflow/FoundMatchesMetadata.hh"
+#include "workflow/alignWorkflow/TileCheckpoint.hh"
 
 namespace isaac
 {
@@ -61,8 +63,10 @@ public:
         const bool allowVariableFastqLength,
         const bool cleanupIntermediary,
         const bool ignoreMissingBcls,
+        const bool memoryMapInput,
         const unsigned firstPassSeeds,
-        const unsigned long availableMemory,
+        const unsigned seedIterations,
+        common::MemoryGovernor &memoryGovernor,
         const unsigned clustersAtATimeMax,
         const bfs::path &tempDirectory,
         const bfs::path &demultiplexingStatsXmlPath,
@@ -75,7 +79,8 @@ public:
         const unsigned tempSaversMax,
         const common::ScoopedMallocBlock::Mode memoryControl,
         const std::vector<size_t> &clusterIdList,
-        const reference::SortedReferenceMetadataList &sortedReferenceMetadataList);
+        const reference::SortedReferenceMetadataList &sortedReferenceMetadataList,
+        const bool tileCheckpoints);
 
     template <typename KmerT>
     void perform(FoundMatchesMetadata &foundMatches);
@@ -93,8 +98,10 @@ private:
     const bool allowVariableFastqLength_;
     const bool cleanupIntermediary_;
     const bool ignoreMissingBcls_;
+    const bool memoryMapInput_;
     const unsigned firstPassSeeds_;
-    const unsigned long availableMemory_;
+    const unsigned seedIterations_;
+    common::MemoryGovernor &memoryGovernor_;
     const unsigned clustersAtATimeMax_;
     const bool ignoreNeighbors_;
     const bool ignoreRepeats_;
@@ -104,19 +111,12 @@ private:
     const std::vector<size_t> &clusterIdList_;
 
     const reference::SortedReferenceMetadataList &sortedReferenceMetadataList_;
+    // save the progress after each group of tiles so that a restarted run can skip them
+    const bool tileCheckpoints_;
     common::ThreadVector threads_;
 
-    static const unsigned maxIterations_ = 2;
-
     /**
-     ** \brief Return the list of seed indexes to use for each iteration.
-     **
-     ** The first seed of each read is always used for the first iteration. All
-     ** subsequent seeds, if any, are used for the second iteration. The outer
-     ** vector is for the successive iterations. The inner vector is the list of
-     ** seed indexes (in the seedMetadataList_) to use for each iteration.
-     **
-     ** TODO: implement a more flexible multi-seed management
+     ** \brief Return the list of seed indexes to use for each iteration. See alignment::getSeedIndexListPerIteration
      **/
     std::vector<std::vector<unsigned> > getSeedIndexListPerIteration(const flowcell::Layout &flowcell) const;
 
@@ -151,6 +151,8 @@ private:
     template <typename KmerT>
     void findMultiSeedMatches(
         const flowcell::Layout &flowcell,
+        const unsigned iteration,
+        const bool lastIteration,
         const std::vector<unsigned> &seedIndexList,
         flowcell::TileMetadataList &unprocessedTiles,
         alignment::matchFinder::TileClusterInfo &tileClusterInfo,
@@ -165,6 +167,7 @@ private:
         flowcell::TileMetadataList &unprocessedTiles,
         DataSourceT &dataSource,
         demultiplexing::DemultiplexingStats &demultiplexingStats,
+        MatchFinderCheckpoint &checkpoint,
         FoundMatchesMetadata &foundMatches);
 
     template <typename DataSourceT>
@@ -172,8 +175,16 @@ private:
         const flowcell::Layout& flowcell,
         DataSourceT &dataSource,
         demultiplexing::DemultiplexingStats &demultiplexingStats,
+        MatchFinderCheckpoint &checkpoint,
         FoundMatchesMetadata &foundMatches);
 
+    void resumeFromCheckpoint(MatchFinderCheckpoint &checkpoint, FoundMatchesMetadata &foundMatches) const;
+
+    void saveTileCheckpoint(
+        const flowcell::TileMetadataList &completeTiles,
+        const FoundMatchesMetadata &foundMatches,
+        MatchFinderCheckpoint &checkpoint) const;
+
     void dumpStats(
         const demultiplexing::DemultiplexingStats &demultiplexingStats,
         const flowcell::TileMetadataList &tileMetadataList) const;
@@ -0,0 +1,135 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file GatherTransition.hh
+ **
+ ** \brief Merges the results of several runs that have aligned disjoint subsets of tiles into the state
+ **        required to produce the alignment reports and bam files in one go.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifndef iSAAC_WORKFLOW_ALIGN_WORKFLOW_GATHER_TRANSITION_HH
+#define iSAAC_WORKFLOW_ALIGN_WORKFLOW_GATHER_TRANSITION_HH
+
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+
+#include "alignment/BinMetadata.hh"
+#include "alignment/TemplateLengthStatistics.hh"
+#include "build/BarcodeBamMapping.hh"
+#include "flowcell/BarcodeMetadata.hh"
+#include "reference/SortedReferenceMetadata.hh"
+#include "workflow/alignWorkflow/FoundMatchesMetadata.hh"
+
+namespace isaac
+{
+namespace workflow
+{
+namespace alignWorkflow
+{
+
+/**
+ * \brief Content of AlignerState.txt of a scatter run. The fields are serialized in the same way as the ones
+ *        of AlignWorkflow.
+ */
+struct ScatterRun
+{
+    ScatterRun(
+        const boost::filesystem::path &tempDirectory,
+        const flowcell::BarcodeMetadataList &barcodeMetadataList,
+        const unsigned seedIterations,
+        const reference::SortedReferenceMetadataList &sortedReferenceMetadataList) :
+            state_(0),
+            foundMatchesMetadata_(tempDirectory, barcodeMetadataList, seedIterations, sortedReferenceMetadataList),
+            barcodeTemplateLengthStatistics_(barcodeMetadataList.size())
+    {
+    }
+
+    // AlignWorkflow::State value
+    int state_;
+    FoundMatchesMetadata foundMatchesMetadata_;
+    alignment::BinMetadataList selectedMatchesMetadata_;
+    std::vector<alignment::TemplateLengthStatistics> barcodeTemplateLengthStatistics_;
+    build::BarcodeBamMapping barcodeBamMapping_;
+};
+
+class GatherTransition: boost::noncopyable
+{
+public:
+    GatherTransition(
+        const flowcell::BarcodeMetadataList &barcodeMetadataList,
+        const reference::SortedReferenceMetadataList &sortedReferenceMetadataList,
+        const unsigned seedIterations,
+        const bool preSortBins,
+        const unsigned threads,
+        const boost::filesystem::path &tempDirectory);
+
+    /**
+     * \brief Loads the states of the scatter runs and merges them. The bins are copied into tempDirectory
+     *        with the fragment tile indexes adjusted to the merged tile list.
+     *
+     * \param scatterTempDirectoryList   --temp-directory of each scatter run
+     * \param scatterOutputDirectoryList --output-directory of each scatter run
+     */
+    void perform(
+        const std::vector<boost::filesystem::path> &scatterTempDirectoryList,
+        const std::vector<boost::filesystem::path> &scatterOutputDirectoryList,
+        const boost::filesystem::path &matchSelectorStatsXmlPath,
+        const boost::filesystem::path &demultiplexingStatsXmlPath,
+        FoundMatchesMetadata &foundMatches,
+        alignment::BinMetadataList &selectedMatches,
+        std::vector<alignment::TemplateLengthStatistics> &barcodeTemplateLengthStatistics) const;
+
+private:
+    const flowcell::BarcodeMetadataList &barcodeMetadataList_;
+    const reference::SortedReferenceMetadataList &sortedReferenceMetadataList_;
+    const unsigned seedIterations_;
+    const bool preSortBins_;
+    const unsigned threads_;
+    const boost::filesystem::path tempDirectory_;
+
+    void gatherTiles(
+        const boost::ptr_vector<ScatterRun> &scatterRuns,
+        FoundMatchesMetadata &foundMatches,
+        std::vector<unsigned> &tileIndexOffsets) const;
+
+    void gatherTemplateLengthStatistics(
+        const boost::ptr_vector<ScatterRun> &scatterRuns,
+        std::vector<alignment::TemplateLengthStatistics> &barcodeTemplateLengthStatistics) const;
+
+    alignment::BinMetadataList makeGatheredBins(
+        const boost::ptr_vector<ScatterRun> &scatterRuns,
+        const flowcell::TileMetadataList &tileMetadataList) const;
+
+    void gatherBinsThread(
+        const boost::ptr_vector<ScatterRun> &scatterRuns,
+        const std::vector<unsigned> &tileIndexOffsets,
+        const unsigned long maxTileReads,
+        std::size_t &nextBin,
+        alignment::BinMetadataList &bins) const;
+
+    void gatherBin(
+        const boost::ptr_vector<ScatterRun> &scatterRuns,
+        const std::vector<unsigned> &tileIndexOffsets,
+        const unsigned long maxTileReads,
+        alignment::BinMetadata &bin) const;
+};
+
+} // namespace alignWorkflow
+} // namespace workflow
+} // namespace isaac
+
+#endif // #ifndef iSAAC_WORKFLOW_ALIGN_WORKFLOW_GATHER_TRANSITION_HH
@@ -45,12 +45,14 @@
 #include "flowcell/BarcodeMetadata.hh"
 #include "io/FastqLoader.hh"
 #include "reference/Contig.hh"
+#include "reference/SharedContigs.hh"
 #include "reference/SortedReferenceMetadata.hh"
 #include "rta/BclReader.hh"
 #include "workflow/alignWorkflow/BamDataSource.hh"
 #include "workflow/alignWorkflow/BclBgzfDataSource.hh"
 #include "workflow/alignWorkflow/BclDataSource.hh"
 #include "workflow/alignWorkflow/FastqDataSource.hh"
+#include "workflow/alignWorkflow/TileCheckpoint.hh"
 
 namespace isaac
 {
@@ -70,6 +72,7 @@ public:
         alignment::matchSelector::FragmentStorage &fragmentStorage,
         const alignment::MatchDistribution &matchDistribution,
         const reference::SortedReferenceMetadataList &sortedReferenceMetadataList,
+        const reference::SharedContigsList &sharedContigsList,
         const boost::filesystem::path &tempDirectory,
         unsigned int maxThreadCount,
         const TileMetadataList &tileMetadataList,
@@ -81,6 +84,7 @@ public:
         const bool cleanupIntermediary,
         const bool ignoreMissingBcls,
         const bool ignoreMissingFilters,
+        const bool memoryMapInput,
         const unsigned inputLoadersMax,
         const unsigned tempLoadersMax,
         const unsigned tempSaversMax,
@@ -101,11 +105,13 @@ public:
         const int gapOpenScore,
         const int gapExtendScore,
         const int minGapExtendScore,
+        const bool fixedPointScoring,
         const unsigned semialignedGapLimit,
         const alignment::TemplateBuilder::DodgyAlignmentScore dodgyAlignmentScore,
         const bool qScoreBin,
         const boost::array<char, 256> &fullBclQScoreTable,
-        const bool extractClusterXy);
+        const bool extractClusterXy,
+        const bool tileCheckpoints);
 
     /**
      ** \brief Select the best match for each of the cluster in the given tile
@@ -160,6 +166,16 @@ private:
     const boost::array<char, 256> &fullBclQScoreTable_;
     bool forceTermination_;
 
+    const boost::filesystem::path tempDirectory_;
+    const bool tileCheckpoints_;
+    // cleared if the fragment storage turns out not to support checkpoints
+    bool saveCheckpoints_;
+    // tiles restored from the checkpoint, indexed by tile index
+    std::vector<bool> checkpointedTiles_;
+    // template length statistics as they were right after the thread's tile got selected
+    std::vector<std::vector<alignment::TemplateLengthStatistics> > threadTemplateLengthStatistics_;
+    MatchSelectorCheckpoint checkpoint_;
+
     void acquireSlot(bool &slotAvailable) const
     {
         boost::unique_lock<boost::mutex> lock(slotMutex_);
@@ -209,6 +225,17 @@ private:
 
     void loadClusters(const unsigned threadNumber, const flowcell::TileMetadata &tileMetadata);
 
+    /**
+     * \brief Restores the bins, statistics and template length statistics of the tiles completed by
+     *        the previous run if there is a usable checkpoint in the temporary directory
+     */
+    void resumeFromCheckpoint(std::vector<alignment::TemplateLengthStatistics> &barcodeTemplateLengthStatistics);
+
+    /**
+     * \brief Records the tile as complete. Must be called right after the tile data is flushed
+     **/
+    void saveTileCheckpoint(const unsigned threadNumber, const flowcell::TileMetadata &tileMetadata);
+
     /**
      * \brief Processes a single tile
      **/
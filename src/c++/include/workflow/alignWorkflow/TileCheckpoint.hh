@@ -0,0 +1,125 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file TileCheckpoint.hh
+ **
+ ** \brief Progress of the match finding and match selection saved after each group of tiles so that an
+ **        interrupted run can skip the tiles that have been completed.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifndef iSAAC_WORKFLOW_ALIGN_WORKFLOW_TILE_CHECKPOINT_HH
+#define iSAAC_WORKFLOW_ALIGN_WORKFLOW_TILE_CHECKPOINT_HH
+
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "alignment/BinMetadata.hh"
+#include "alignment/TemplateLengthStatistics.hh"
+#include "flowcell/BarcodeMetadata.hh"
+#include "flowcell/TileMetadata.hh"
+#include "reference/SortedReferenceMetadata.hh"
+#include "workflow/alignWorkflow/FoundMatchesMetadata.hh"
+
+namespace isaac
+{
+namespace workflow
+{
+namespace alignWorkflow
+{
+
+/**
+ * \return true if the list contains the tile under the same index and with the same identity and cluster count
+ */
+bool isCheckpointedTile(const flowcell::TileMetadataList &completeTiles, const flowcell::TileMetadata &tile);
+
+/**
+ * \brief Saved after each group of tiles has gone through all the seed iterations. Match files of
+ *        completeTiles_ are final and so are their tallies in foundMatches_. The match distribution
+ *        contains only the matches of completeTiles_.
+ */
+struct MatchFinderCheckpoint
+{
+    MatchFinderCheckpoint(
+        const boost::filesystem::path &tempDirectory,
+        const flowcell::BarcodeMetadataList &barcodeMetadataList,
+        const unsigned seedIterations,
+        const reference::SortedReferenceMetadataList &sortedReferenceMetadataList) :
+            foundMatches_(tempDirectory, barcodeMetadataList, seedIterations, sortedReferenceMetadataList)
+    {
+    }
+
+    flowcell::TileMetadataList completeTiles_;
+    FoundMatchesMetadata foundMatches_;
+
+    static boost::filesystem::path getPath(const boost::filesystem::path &tempDirectory)
+    {
+        return tempDirectory / "MatchFinderCheckpoint.txt";
+    }
+};
+
+/**
+ * \brief Saved after each tile flushed by the match selector. The bin files contain exactly the data
+ *        described by binMetadataList_. The statistics of each tile in completeTiles_ are stored separately
+ *        in getTileStatsPath.
+ */
+struct MatchSelectorCheckpoint
+{
+    MatchSelectorCheckpoint() : storedTiles_(0)
+    {
+    }
+
+    flowcell::TileMetadataList completeTiles_;
+    // fragment storage counter of the flushed tiles
+    unsigned storedTiles_;
+    alignment::BinMetadataList binMetadataList_;
+    std::vector<alignment::TemplateLengthStatistics> barcodeTemplateLengthStatistics_;
+
+    static boost::filesystem::path getPath(const boost::filesystem::path &tempDirectory)
+    {
+        return tempDirectory / "MatchSelectorCheckpoint.txt";
+    }
+
+    static boost::filesystem::path getTileStatsPath(
+        const boost::filesystem::path &tempDirectory,
+        const flowcell::TileMetadata &tile);
+};
+
+/**
+ * \brief Replaces the checkpoint file atomically so that a failure during the save leaves the previous one valid
+ */
+void saveCheckpoint(const boost::filesystem::path &checkpointPath, const MatchFinderCheckpoint &checkpoint);
+void saveCheckpoint(const boost::filesystem::path &checkpointPath, const MatchSelectorCheckpoint &checkpoint);
+
+/**
+ * \return false if there is no checkpoint to resume from
+ */
+bool loadCheckpoint(const boost::filesystem::path &checkpointPath, MatchFinderCheckpoint &checkpoint);
+bool loadCheckpoint(const boost::filesystem::path &checkpointPath, MatchSelectorCheckpoint &checkpoint);
+
+/**
+ * \brief Removes the checkpoint once the step is complete. The tile statistics files of the match selector
+ *        checkpoint are removed as well.
+ */
+void removeCheckpoint(const boost::filesystem::path &checkpointPath);
+void removeCheckpoint(
+    const boost::filesystem::path &checkpointPath,
+    const boost::filesystem::path &tempDirectory,
+    const flowcell::TileMetadataList &tileMetadataList);
+
+} // namespace alignWorkflow
+} // namespace workflow
+} // namespace isaac
+
+#endif // #ifndef iSAAC_WORKFLOW_ALIGN_WORKFLOW_TILE_CHECKPOINT_HH
@@ -85,30 +85,97 @@ struct IndexRecord
     {
         return os << "BamBufferIndexRecord(" << idx.nameHash_ << ", " << idx.getBlock() << ")";
     }
+};
+
+inline bool readNamesMatch(const IndexRecord &left, const IndexRecord &right)
+{
+    const bam::BamBlockHeader &leftBlock = left.getBlock();
+    const bam::BamBlockHeader &rightBlock = right.getBlock();
+
+    return (leftBlock.getReadNameLength() == rightBlock.getReadNameLength() &&
+        leftBlock.nameEnd() ==
+            std::mismatch(leftBlock.nameBegin(), leftBlock.nameEnd(), rightBlock.nameBegin()).first);
+}
+
+/**
+ * \brief Open-addressing hash table of positions of the index records that are waiting for their mates.
+ *        Keyed on the read name. Does not allocate memory after construction.
+ */
+class MateTable
+{
+    static const unsigned EMPTY = -1U;
+    static const unsigned REMOVED = -2U;
+    std::vector<unsigned> slots_;
+    const std::size_t mask_;
+
+public:
+    static const unsigned NO_MATE = EMPTY;
 
-    friend bool operator <(const IndexRecord &left, const IndexRecord &right)
+    /**
+     * \param recordsMax maximum number of records that can be inserted between two clear calls
+     */
+    MateTable(const std::size_t recordsMax) :
+        slots_(getTableSize(recordsMax), EMPTY), mask_(slots_.size() - 1)
     {
-        // comparing by name is enough, comparing by r1 position is much faster
-        if (left.nameHash_ < right.nameHash_)
-        {
-            return true;
-        }
-        else if (left.nameHash_ == right.nameHash_)
+    }
+
+    void clear()
+    {
+        std::fill(slots_.begin(), slots_.end(), EMPTY);
+    }
+
+    /**
+     * \brief Looks up the mate of the record in the table.
+     *
+     * \return position of the mate in the index. The mate is removed from the table. If the mate is not found,
+     *         NO_MATE is returned and the record is stored in the table.
+     */
+    template <typename IndexT>
+    unsigned pairOrInsert(const IndexT &index, const unsigned recordPosition)
+    {
+        const IndexRecord &record = index[recordPosition];
+        std::size_t insertSlot = slots_.size();
+        for (std::size_t slot = hash(record.nameHash_) & mask_;; slot = (slot + 1) & mask_)
         {
-            const bam::BamBlockHeader &leftBlock = left.getBlock();
-            const bam::BamBlockHeader &rightBlock = right.getBlock();
-            const int namecmp = strcmp(leftBlock.nameBegin(), rightBlock.nameBegin());
-            if (0 > namecmp)
+            const unsigned value = slots_[slot];
+            if (EMPTY == value)
+            {
+                slots_[slots_.size() == insertSlot ? slot : insertSlot] = recordPosition;
+                return NO_MATE;
+            }
+            if (REMOVED == value)
             {
-                return true;
+                // reuse the first removed slot on the probing sequence if the mate is not there
+                if (slots_.size() == insertSlot)
+                {
+                    insertSlot = slot;
+                }
             }
-            else if (0 == namecmp)
+            else if (index[value].nameHash_ == record.nameHash_ && readNamesMatch(index[value], record))
             {
-                // put read one on top so that it's simpler to extract data
-                return leftBlock.isReadOne();
+                slots_[slot] = REMOVED;
+                return value;
             }
         }
-        return false;
+    }
+
+private:
+    static std::size_t getTableSize(const std::size_t recordsMax)
+    {
+        // keep load factor under 0.5 to make the probing sequences short
+        std::size_t ret = 1;
+        while (ret < recordsMax * 2)
+        {
+            ret <<= 1;
+        }
+        return ret;
+    }
+
+    static std::size_t hash(const IndexRecord::NameHashType nameHash)
+    {
+        // name suffixes mostly differ in a few low digits. Mix them into the high bits.
+        const IndexRecord::NameHashType mixed = nameHash * 0x9E3779B97F4A7C15UL;
+        return mixed ^ (mixed >> 29);
     }
 };
 
@@ -480,7 +547,13 @@ class PairedEndClusterExtractor :
     common::FiniteCapacityVector<IndexRecord, 65535*2>
 {
     typedef common::FiniteCapacityVector<IndexRecord, 65535*2> BaseT;
-    iterator firstUnextracted_;
+    typedef std::pair<unsigned, unsigned> MatePair;
+    /// records that have not been looked up in mateTable_ yet start here
+    unsigned firstUnpaired_;
+    /// pairs of positions of read 1 and read 2 records in the order in which the pairs were completed
+    common::FiniteCapacityVector<MatePair, 65535> pairs_;
+    unsigned firstUnextracted_;
+    MateTable mateTable_;
 
     UnpairedReadsCache unpairedReadCache_;
 public:
@@ -491,7 +564,9 @@ public:
         const std::size_t maxFlowcellIdLength,
         const std::size_t minClusterLength,
         const bool cleanupIntermediary) :
-            firstUnextracted_(end()),
+            firstUnpaired_(0),
+            firstUnextracted_(0),
+            mateTable_(BaseT::capacity()),
             unpairedReadCache_(
                 tempDirectoryPath,
                 maxBamFileLength,
@@ -503,12 +578,13 @@ public:
 
     void open(const std::string &flowcellId)
     {
+        clear();
         reset();
         unpairedReadCache_.open(flowcellId);
     }
 
     bool extractingUnpaired() const {return unpairedReadCache_.extractingUnpaired();}
-    bool isEmpty() const {return end() == firstUnextracted_;}
+    bool isEmpty() const {return pairs_.size() == firstUnextracted_;}
 
 
     template <typename ClusterInsertIt, typename PfInserIt>
@@ -526,9 +602,7 @@ public:
 
         if (lastBlock)
         {
-    //  ISAAC_THREAD_CERR << "parsed " << index_.size() << " entries, unparsedBytes_:" << unparsedBytes_ << std::endl;
-            sort();
-    //  ISAAC_THREAD_CERR << "sorted " << index_.size() << " entries" << std::endl;
+            pairMates();
             //                     unsigned before = clusterCount;
             clusterCount = extractPairedReads(clusterCount, clustersIt, pfIt, readMetadataList);
     //                    ISAAC_THREAD_CERR << "extracted " << before - clusterCount << " clusters" << std::endl;
@@ -556,7 +630,8 @@ public:
 
 
     /**
-     * \brief For index entries that have all the reads needed, copies bcl data into the output and removes the index entry
+     * \brief For pairs that have both reads available, copies bcl data into the output and marks the index entries
+     *        extracted. Once all pairs are extracted, the extracted entries are removed from the index.
      *
      * \return number of clusters not extracted
      */
@@ -567,64 +642,41 @@ public:
         PfInsertIt &pfIt,
         const flowcell::ReadMetadataList &readMetadataList)
     {
-        if (1 > std::distance(firstUnextracted_, end()))
-        {
-            return clusterCount;
-        }
-        iterator it = firstUnextracted_ + 1;
-        for (; clusterCount && end() != it;)
+        for (; clusterCount && pairs_.size() != firstUnextracted_; ++firstUnextracted_)
         {
-    //            ISAAC_THREAD_CERR << *(it-1) << " " << clusterCount << std::endl;
-    //            ISAAC_THREAD_CERR << *it << " " << clusterCount << std::endl;
-            if (readNamesMatch(*(it - 1), *it))
-            {
-                const bam::BamBlockHeader &r1Block = (it - 1)->getBlock();
-                const bam::BamBlockHeader &r2Block = it->getBlock();
-                ISAAC_ASSERT_MSG(r1Block.isReadOne(), "Sort order must put r1 block before r2 block " << r1Block  << " " << r2Block);
-                ISAAC_ASSERT_MSG(!r2Block.isReadOne(), "Sort order must put r1 block before r2 block " << r1Block  << " " << r2Block);
-                ISAAC_ASSERT_MSG(r2Block.isPf() == r1Block.isPf(), "Pf flag must be the same for both reads of the cluster " << r2Block << " " << r1Block);
+            IndexRecord &r1 = (*this)[pairs_[firstUnextracted_].first];
+            IndexRecord &r2 = (*this)[pairs_[firstUnextracted_].second];
+            const bam::BamBlockHeader &r1Block = r1.getBlock();
+            const bam::BamBlockHeader &r2Block = r2.getBlock();
+            ISAAC_ASSERT_MSG(r1Block.isReadOne(), "Out of two reads, first one was expected to be read 1 " << r1Block  << " " << r2Block);
+            ISAAC_ASSERT_MSG(!r2Block.isReadOne(), "Out of two reads, second one was expected to be read 2 " << r1Block  << " " << r2Block);
+            ISAAC_ASSERT_MSG(r2Block.isPf() == r1Block.isPf(), "Pf flag must be the same for both reads of the cluster " << r2Block << " " << r1Block);
 
-                const flowcell::ReadMetadata &r1Metadata = readMetadataList.at(!r1Block.isReadOne());
-                clusterIt = extractBcl(r1Block, clusterIt, r1Metadata);
-                (it - 1)->markExtracted();
+            const flowcell::ReadMetadata &r1Metadata = readMetadataList.at(!r1Block.isReadOne());
+            clusterIt = extractBcl(r1Block, clusterIt, r1Metadata);
+            r1.markExtracted();
 
-                const flowcell::ReadMetadata &r2Metadata = readMetadataList.at(!r2Block.isReadOne());
-                clusterIt = extractBcl(r2Block, clusterIt, r2Metadata);
-                it->markExtracted();
+            const flowcell::ReadMetadata &r2Metadata = readMetadataList.at(!r2Block.isReadOne());
+            clusterIt = extractBcl(r2Block, clusterIt, r2Metadata);
+            r2.markExtracted();
 
-                *pfIt++ = r2Block.isPf();
+            *pfIt++ = r2Block.isPf();
 
-                --clusterCount;
-                ++it;
-                if (end() != it)
-                {
-                    ++it;
-                    if (end() == it)
-                    {
-                        // this is the case when the last line in the index has its mate in the next buffer and this is
-                        // the first unpaired entry in the current buffer.
-                        break;
-                    }
-                }
-            }
-            else
-            {
-    //                ISAAC_THREAD_CERR << "unpaired " << " " << *it << std::endl;
-                ++it;
-            }
+            --clusterCount;
         }
-        if (clusterCount)
+
+        if (pairs_.size() == firstUnextracted_)
         {
+            // Compact even if the output filled up with the last pair. Otherwise the extracted records stay
+            // in the index and removeOld would store them as unpaired.
             erase(std::remove_if(begin(), end(), boost::bind(&IndexRecord::isExtracted, _1)), end());
             reset();
         }
         else
         {
-            firstUnextracted_ = it - 1;
             ISAAC_THREAD_CERR << "Out of clusters: " <<
-                std::distance(begin(), firstUnextracted_) << " " <<
-                std::distance(begin(), it) << " " <<
-                std::distance(it, end()) << " " <<
+                firstUnextracted_ << " " <<
+                pairs_.size() - firstUnextracted_ << " " <<
                 std::endl;
         }
         return clusterCount;
@@ -636,17 +688,7 @@ public:
     }
 
 private:
-    void sort();
-
-    static bool readNamesMatch(const IndexRecord &left, const IndexRecord &right)
-    {
-        const bam::BamBlockHeader &leftBlock = left.getBlock();
-        const bam::BamBlockHeader &rightBlock = right.getBlock();
-
-        return (leftBlock.getReadNameLength() == rightBlock.getReadNameLength() &&
-            leftBlock.nameEnd() ==
-                std::mismatch(leftBlock.nameBegin(), leftBlock.nameEnd(), rightBlock.nameBegin()).first);
-    }
+    void pairMates();
 
     void storeUnpaired(
         BaseT::const_iterator unpairedBegin,
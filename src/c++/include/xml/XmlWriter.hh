@@ -48,14 +48,22 @@ class XmlWriter: boost::noncopyable
     xmlTextWriterPtr xmlWriter_;
     static int xmlOutputWriteCallback(void * context, const char * buffer, int len);
 public:
-    explicit XmlWriter(std::ostream &os);
+    /**
+     * \param fragment  when set, no xml declaration is written and the output is not indented. Used to
+     *                  produce pieces of a document that get inserted into it later with writeRaw
+     */
+    explicit XmlWriter(std::ostream &os, const bool fragment = false);
     ~XmlWriter();
 
     void close();
+    /// pushes everything written so far into the stream
+    void flush();
     XmlWriter &startElement(const char *name);
     XmlWriter &startElement(const std::string &name) {return startElement(name.c_str());}
     XmlWriter &endElement();
     XmlWriter &writeText(const char *text);
+    /// inserts length bytes of already formatted xml. length must fit into what libxml takes (int)
+    XmlWriter &writeRaw(const char *xml, const std::size_t length);
 
     template <typename T> XmlWriter &writeElement(const char *name, const T& value)
     {
@@ -45,6 +45,7 @@ FragmentBuilder::FragmentBuilder(
     const int gapOpenScore,
     const int gapExtendScore,
     const int minGapExtendScore,
+    const bool fixedPointScoring,
     const unsigned gapLimit)
     : repeatThreshold_(repeatThreshold)
     , semialignedGapLimit_(gapLimit)
@@ -55,9 +56,9 @@ FragmentBuilder::FragmentBuilder(
     , cigarBuffer_(Cigar::getMaxOperationsForReads(flowcellLayoutList) *
                    // one seed generates up to repeat threshold matches for each strand
                    repeatThreshold_ * maxSeedsPerRead * 2)
-    , ungappedAligner_(gapMatchScore, gapMismatchScore, gapOpenScore, gapExtendScore, minGapExtendScore)
-    , gappedAligner_(flowcellLayoutList, avoidSmithWaterman, gapMatchScore, gapMismatchScore, gapOpenScore, gapExtendScore, minGapExtendScore)
-    , simpleIndelAligner_(gapMatchScore, gapMismatchScore, gapOpenScore, gapExtendScore, minGapExtendScore, semialignedGapLimit_)
+    , ungappedAligner_(gapMatchScore, gapMismatchScore, gapOpenScore, gapExtendScore, minGapExtendScore, fixedPointScoring)
+    , gappedAligner_(flowcellLayoutList, avoidSmithWaterman, gapMatchScore, gapMismatchScore, gapOpenScore, gapExtendScore, minGapExtendScore, fixedPointScoring)
+    , simpleIndelAligner_(gapMatchScore, gapMismatchScore, gapOpenScore, gapExtendScore, minGapExtendScore, fixedPointScoring, semialignedGapLimit_)
 {
     std::for_each(fragments_.begin(), fragments_.end(),
                   boost::bind(&std::vector<FragmentMetadata>::reserve, _1,
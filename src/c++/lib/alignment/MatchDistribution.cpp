@@ -18,6 +18,7 @@
  ** \author Come Raczy
  **/
 
+#include <algorithm>
 #include <functional>
 #include <boost/foreach.hpp>
 
@@ -44,6 +45,14 @@ void MatchDistribution::initialize(const isaac::reference::SortedReferenceMetada
     }
 }
 
+void MatchDistribution::makeUniform()
+{
+    BOOST_FOREACH(std::vector<unsigned> &contigBins, *this)
+    {
+        std::fill(contigBins.begin(), contigBins.end(), 1);
+    }
+}
+
 /**
  * \brief Sum up contents of two MatchDistribution objects
  */
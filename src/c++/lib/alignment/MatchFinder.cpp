@@ -37,6 +37,7 @@
 #include "alignment/matchFinder/NeighborMaskMatcher.hh"
 #include "common/Debug.hh"
 #include "common/Exceptions.hh"
+#include "common/Profiling.hh"
 #include "common/SystemCompatibility.hh"
 #include "common/Threads.hpp"
 #include "flowcell/Layout.hh"
@@ -77,6 +78,7 @@ MatchFinder<KmerT>::MatchFinder(
     const flowcell::ReadMetadataList &readMetadataList,
     const SeedMetadataList &seedMetadataList,
     const unsigned iteration,
+    const bool closeRepeats,
     const bool ignoreNeighbors,
     const bool ignoreRepeats,
     const unsigned repeatThreshold,
@@ -91,6 +93,7 @@ MatchFinder<KmerT>::MatchFinder(
     , referenceContigKaryotypes_(getReferenceContigKaryotypes(sortedReferenceList))
     , seedMetadataList_(seedMetadataList)
     , iteration_(iteration)
+    , closeRepeats_(closeRepeats)
     , ignoreNeighbors_(ignoreNeighbors)
     , ignoreRepeats_(ignoreRepeats)
     , repeatThreshold_(repeatThreshold)
@@ -112,6 +115,11 @@ MatchFinder<KmerT>::MatchFinder(
 {
     ISAAC_THREAD_CERR << "Constructing the match finder" << std::endl;
 
+    while (threadMaskDecoders_.size() < threadsMax_)
+    {
+        threadMaskDecoders_.push_back(new reference::CompressedMaskStreamBuf<KmerT>());
+    }
+
     ISAAC_THREAD_CERR << "Constructing the match finder done" << std::endl;
 }
 
@@ -160,6 +168,13 @@ const std::vector<typename MatchFinder<KmerT>::KmerSourceMetadata> MatchFinder<K
         {
             ret.push_back(KmerSourceMetadata(&sortedReference - &sortedReferenceList.front(),
                                              mask.maskWidth, mask.mask_, mask.path));
+            if (!ret.back().prefixIndex_.load(reference::MaskPrefixIndex::getIndexPath(mask.path),
+                                              oligo::KmerTraits<KmerT>::KMER_BITS, mask.maskWidth))
+            {
+                ISAAC_THREAD_CERR << "WARNING: no prefix index found for " << mask.path <<
+                    ". Mask file will be read sequentially" << std::endl;
+            }
+            ret.back().compressedIndex_.load(mask.path);
         }
     }
     return ret;
@@ -208,6 +223,40 @@ const std::vector<MatchDistribution> & MatchFinder<KmerT>::match(
     return threadMatchDistributions_;
 }
 
+template <typename KmerT>
+void MatchFinder<KmerT>::storeRepeatMatches(
+    const typename std::vector<SeedT>::const_iterator repeatSeedsBegin,
+    const typename std::vector<SeedT>::const_iterator repeatSeedsEnd)
+{
+    if (repeatSeedsBegin != repeatSeedsEnd)
+    {
+        ISAAC_THREAD_CERR << "Storing repeat matches for " << std::distance(repeatSeedsBegin, repeatSeedsEnd) << " seeds" << std::endl;
+        threads_.execute(boost::bind(&MatchFinder::storeRepeatMatchesParallel, this,
+                                     repeatSeedsBegin, repeatSeedsEnd, _1),
+                         threadsMax_);
+        ISAAC_THREAD_CERR << "Storing repeat matches done for " << std::distance(repeatSeedsBegin, repeatSeedsEnd) << " seeds" << std::endl;
+    }
+}
+
+template <typename KmerT>
+void MatchFinder<KmerT>::storeRepeatMatchesParallel(
+    const typename std::vector<SeedT>::const_iterator repeatSeedsBegin,
+    const typename std::vector<SeedT>::const_iterator repeatSeedsEnd,
+    const unsigned threadNumber)
+{
+    const std::size_t seedsCount = std::distance(repeatSeedsBegin, repeatSeedsEnd);
+    // same treatment as for the seeds that hit a TooManyMatch entry in the mask file
+    matchFinder::ExactMaskMatcher<KmerT>(
+        closeRepeats_, false,
+        repeatThreshold_,
+        ignoreNeighbors_, seedMetadataList_,
+        referenceContigKaryotypes_.front(),
+        foundExactMatchesOnly_).generateTooManyMatches(
+            repeatSeedsBegin + seedsCount * threadNumber / threadsMax_,
+            repeatSeedsBegin + seedsCount * (threadNumber + 1) / threadsMax_,
+            matchWriter_);
+}
+
 template <typename KmerT>
 std::pair<typename std::vector<typename MatchFinder<KmerT>::SeedT>::const_iterator, typename std::vector<typename MatchFinder<KmerT>::SeedT>::const_iterator>
 MatchFinder<KmerT>::skipToTheNextMask(
@@ -272,11 +321,27 @@ void MatchFinder<KmerT>::matchMaskParallel(
             skipToTheNextMask(ourBegin, seedsEnd, currentMask, ourKmerSource->maskWidth_, finalPass);
         seedsBegin = ourEndNextBegin.second;
 
+        if (ourBegin == ourEndNextBegin.first)
+        {
+            // no seeds for this mask, don't touch the mask file
+            continue;
+        }
+
         const boost::filesystem::path &sortedReferencePath = ourKmerSource->maskFilePath_;
-        std::istream threadReferenceFile(threadReferenceFileBuffers_.at(threadNumber).get(sortedReferencePath, io::FileBufWithReopen::SequentialOften));
+        std::streambuf *maskFileBuf = threadReferenceFileBuffers_.at(threadNumber).get(sortedReferencePath, io::FileBufWithReopen::SequentialOften);
+        if (ourKmerSource->compressedIndex_.isLoaded())
+        {
+            // the matchers see the decoded ReferenceKmer records and seek in their units
+            threadMaskDecoders_.at(threadNumber).open(*maskFileBuf, ourKmerSource->compressedIndex_);
+            maskFileBuf = &threadMaskDecoders_.at(threadNumber);
+        }
+        std::istream threadReferenceFile(maskFileBuf);
 
         {
             common::unlock_guard<boost::mutex> unlock(mutex_);
+            common::ScopedStageTimer timer(findNeighbors ?
+                common::Profiler::FindMatchesNeighborMask : common::Profiler::FindMatchesExactMask);
+            timer.addItems(std::distance(ourBegin, ourEndNextBegin.first));
 
             if (findNeighbors)
             {
@@ -291,12 +356,13 @@ void MatchFinder<KmerT>::matchMaskParallel(
                         threadRepeatLists_[threadNumber],
                         threadNeighborsLists_[threadNumber],
                         matchWriter_,
+                        ourKmerSource->prefixIndex_,
                         threadReferenceFile);
             }
             else
             {
                 matchFinder::ExactMaskMatcher<KmerT>(
-                    1 == iteration_, finalPass,
+                    closeRepeats_, finalPass,
                     repeatThreshold_,
                     ignoreNeighbors_, seedMetadataList_,
                     referenceContigKaryotypes_.at(ourKmerSource->referenceIndex_),
@@ -305,6 +371,7 @@ void MatchFinder<KmerT>::matchMaskParallel(
                         threadMatchDistributions_[threadNumber],
                         threadRepeatLists_[threadNumber],
                         matchWriter_,
+                        ourKmerSource->prefixIndex_,
                         threadReferenceFile);
             }
             if(!threadReferenceFile && !threadReferenceFile.eof())
@@ -93,6 +93,7 @@ MatchSelector::MatchSelector(
         matchSelector::FragmentStorage &fragmentStorage,
         const MatchDistribution &matchDistribution,
         const reference::SortedReferenceMetadataList &sortedReferenceMetadataList,
+        const reference::SharedContigsList &sharedContigsList,
         const unsigned int maxThreadCount,
         const TileMetadataList &tileMetadataList,
         const flowcell::BarcodeMetadataList &barcodeMetadataList,
@@ -115,8 +116,10 @@ MatchSelector::MatchSelector(
         const int gapOpenScore,
         const int gapExtendScore,
         const int minGapExtendScore,
+        const bool fixedPointScoring,
         const unsigned semialignedGapLimit,
-        const TemplateBuilder::DodgyAlignmentScore dodgyAlignmentScore
+        const TemplateBuilder::DodgyAlignmentScore dodgyAlignmentScore,
+        const boost::filesystem::path &tempDirectory
     )
     : computeThreads_(maxThreadCount),
       tileMetadataList_(tileMetadataList),
@@ -132,10 +135,12 @@ MatchSelector::MatchSelector(
       clipSemialigned_(clipSemialigned),
       clipOverlapping_(clipOverlapping),
       barcodeSequencingAdapters_(generateSequencingAdapters(barcodeMetadataList_)),
-      allStats_(tileMetadataList_.size(), matchSelector::MatchSelectorStats(barcodeMetadataList_)),
       threadStats_(computeThreads_.size(), matchSelector::MatchSelectorStats(barcodeMetadataList_)),
+      flushStats_(barcodeMetadataList_),
+      flushStatsTileIndex_(-1U),
+      statsXml_(flowcellLayoutList_, barcodeMetadataList_, tileMetadataList_, tempDirectory / "MatchSelectorStats.spool"),
       matchDistribution_(matchDistribution),
-      contigList_(reference::loadContigs(sortedReferenceMetadataList, MatchDistributionContigFilter(matchDistribution_), computeThreads_)),
+      contigList_(reference::loadContigs(sortedReferenceMetadataList, MatchDistributionContigFilter(matchDistribution_), computeThreads_, &sharedContigsList)),
       fragmentStorage_(fragmentStorage),
       threadCluster_(computeThreads_.size(),
                      Cluster(flowcell::getMaxReadLength(flowcellLayoutList_) +
@@ -158,6 +163,7 @@ MatchSelector::MatchSelector(
                                                               gapOpenScore,
                                                               gapExtendScore,
                                                               minGapExtendScore,
+                                                              fixedPointScoring,
                                                               semialignedGapLimit,
                                                               dodgyAlignmentScore));
     }
@@ -169,8 +175,6 @@ MatchSelector::MatchSelector(
 
 void MatchSelector::dumpStats(const boost::filesystem::path &statsXmlPath)
 {
-    std::for_each(allStats_.begin(), allStats_.end(), boost::bind(&matchSelector::MatchSelectorStats::finalize, _1));
-
     // xml tree serialization used to take quite a bit of ram (now it does not). make sure it's available anyway
     {
         std::vector<matchSelector::MatchSelectorStats>().swap(threadStats_);
@@ -181,8 +185,49 @@ void MatchSelector::dumpStats(const boost::filesystem::path &statsXmlPath)
         BOOST_THROW_EXCEPTION(common::IoException(errno, "ERROR: Unable to open file for writing: " + statsXmlPath.string()));
     }
 
-    matchSelector::MatchSelectorStatsXml statsXml(flowcellLayoutList_, barcodeMetadataList_, tileMetadataList_, allStats_);
-    statsXml.serialize(os);
+    statsXml_.serialize(os);
+}
+
+void MatchSelector::prepareFlushTileStats(const flowcell::TileMetadata &tileMetadata)
+{
+    flushStats_.reset();
+    BOOST_FOREACH(const matchSelector::MatchSelectorStats &threadStats, threadStats_)
+    {
+        flushStats_ += threadStats;
+    }
+    flushStatsTileIndex_ = tileMetadata.getIndex();
+}
+
+void MatchSelector::saveTileStats(
+    const flowcell::TileMetadata &tileMetadata,
+    const boost::filesystem::path &statsPath) const
+{
+    ISAAC_ASSERT_MSG(tileMetadata.getIndex() == flushStatsTileIndex_, "Statistics of " << tileMetadata << " are not prepared");
+    std::ofstream os(statsPath.string().c_str(), std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+    if (!os || !flushStats_.save(os))
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "ERROR: failed to store tile statistics in : " + statsPath.string()));
+    }
+}
+
+void MatchSelector::flushTileStats(const flowcell::TileMetadata &tileMetadata)
+{
+    ISAAC_ASSERT_MSG(tileMetadata.getIndex() == flushStatsTileIndex_, "Statistics of " << tileMetadata << " are not prepared");
+    statsXml_.addTile(tileMetadata, flushStats_);
+    flushStatsTileIndex_ = -1U;
+}
+
+void MatchSelector::loadTileStats(
+    const flowcell::TileMetadata &tileMetadata,
+    const boost::filesystem::path &statsPath)
+{
+    std::ifstream is(statsPath.string().c_str(), std::ios_base::in | std::ios_base::binary);
+    if (!is || !flushStats_.load(is))
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "ERROR: failed to load tile statistics from : " + statsPath.string()));
+    }
+    flushStatsTileIndex_ = tileMetadata.getIndex();
+    flushTileStats(tileMetadata);
 }
 
 TemplateLengthStatistics MatchSelector::determineTemplateLength(
@@ -314,7 +359,7 @@ void MatchSelector::processMatchList(
                                                   matchSelector::Filtered);
                 if (keepUnaligned_ && (!pfOnly_ || bclData.pf(clusterId)))
                 {
-                    fragmentStorage_.add(ourThreadBamTemplate, matchBegin->getBarcode());
+                    fragmentStorage_.add(ourThreadBamTemplate, matchBegin->getBarcode(), threadNumber);
                 }
             }
             else //if the cluster has matches and is not filtered-out by pf filtering
@@ -344,7 +389,7 @@ void MatchSelector::processMatchList(
                             threadOverlappingEndsClippers_[threadNumber].reset();
                             threadOverlappingEndsClippers_[threadNumber].clip(barcodeContigList, ourThreadBamTemplate);
                         }
-                        fragmentStorage_.add(ourThreadBamTemplate, matchBegin->getBarcode());
+                        fragmentStorage_.add(ourThreadBamTemplate, matchBegin->getBarcode(), threadNumber);
                     }
 
                     ourThreadStats.recordTemplate(tileReads, templateLengthStatistics, ourThreadBamTemplate,
@@ -357,7 +402,7 @@ void MatchSelector::processMatchList(
                                                   matchBegin->getBarcode(), matchSelector::Rm);
                     if (keepUnaligned_)
                     {
-                        fragmentStorage_.add(ourThreadBamTemplate, matchBegin->getBarcode());
+                        fragmentStorage_.add(ourThreadBamTemplate, matchBegin->getBarcode(), threadNumber);
                     }
                 }
                 // save some cluster counting
@@ -435,11 +480,6 @@ void MatchSelector::parallelSelect(
         barcodeMatchListBegin += tileBarcodeMatchCount;
     }
     ISAAC_ASSERT_MSG(matchList.end() == barcodeMatchListBegin, "Expected to reach the end of the tile match list");
-
-    BOOST_FOREACH(const matchSelector::MatchSelectorStats &threadStats, threadStats_)
-    {
-        allStats_.at(tileMetadata.getIndex()) += threadStats;
-    }
 }
 
 } // namespace alignemnt
@@ -50,6 +50,12 @@ void MatchTally::addTile(const flowcell::TileMetadata& tileMetadata)
     }
 }
 
+void MatchTally::restoreTile(const flowcell::TileMetadata &tileMetadata, const FileTallyList &fileTallyList)
+{
+    ISAAC_ASSERT_MSG(maxIterations_ == fileTallyList.size(), "Iteration count mismatch for " << tileMetadata);
+    allTallies_.at(tileMetadata.getIndex()) = fileTallyList;
+}
+
 size_t MatchTally::getMaxFilePathLength() const
 {
     std::size_t ret = 0;
@@ -65,8 +65,29 @@ std::vector<double> getLogMismatchLookup()
     return lookup;
 }
 
+/**
+ ** \brief Create the lookup table of rounded fixed-point values of logMatchLookup and logMismatchLookup
+ ** interleaved by quality.
+ **/
+std::vector<int> getFixedLogProbabilityLookup(
+    const std::vector<double> &logMatchLookup,
+    const std::vector<double> &logMismatchLookup)
+{
+    const double scale = double(1 << Quality::FIXED_LOG_PROBABILITY_FRACTION_BITS);
+    std::vector<int> lookup;
+    for(unsigned quality = 0; logMatchLookup.size() > quality; ++quality)
+    {
+        lookup.push_back(int(floor(logMatchLookup.at(quality) * scale + 0.5)));
+        lookup.push_back(int(floor(logMismatchLookup.at(quality) * scale + 0.5)));
+    }
+    return lookup;
+}
+
 const std::vector<double> Quality::logMatchLookup = getLogMatchLookup();
 const std::vector<double> Quality::logMismatchLookup = getLogMismatchLookup();
+const std::vector<int> Quality::fixedLogProbabilityLookup =
+    getFixedLogProbabilityLookup(Quality::logMatchLookup, Quality::logMismatchLookup);
+const unsigned Quality::FIXED_LOG_PROBABILITY_FRACTION_BITS;
 
 const unsigned MASK_READ_LENGTH_MIN = 35;
 void trimLowQualityEnd(Read &read, const unsigned baseQualityCutoff)
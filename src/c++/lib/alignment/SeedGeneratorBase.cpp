@@ -30,6 +30,7 @@
 #include "alignment/SeedGeneratorBase.hh"
 #include "common/Debug.hh"
 #include "common/ParallelSort.hpp"
+#include "common/Profiling.hh"
 #include "common/SystemCompatibility.hh"
 
 namespace isaac
@@ -59,6 +60,7 @@ SeedGeneratorBase<KmerT>::SeedGeneratorBase(
                                                                            std::vector<unsigned>(flowcellLayout_.getReadMetadataList().size())))
     , seedMetadataOrderedByFirstCycle_(orderSeedMetadataByFirstCycle(seedMetadataList))
     , nextTileSeedBegins_(sortedReferenceMetadataList.size())
+    , referenceRepeatFilters_(loadRepeatFilters(sortedReferenceMetadataList))
 {
     ISAAC_ASSERT_MSG(!seedMetadataList.empty(), "Empty seedMetadataList is not allowed");
 
@@ -67,6 +69,126 @@ SeedGeneratorBase<KmerT>::SeedGeneratorBase(
                      "Expected tiles ordered by index");
 }
 
+template <typename KmerT>
+std::vector<reference::RepeatKmerFilter<KmerT> > SeedGeneratorBase<KmerT>::loadRepeatFilters(
+    const reference::SortedReferenceMetadataList &sortedReferenceMetadataList)
+{
+    std::vector<reference::RepeatKmerFilter<KmerT> > ret(sortedReferenceMetadataList.size());
+    BOOST_FOREACH(const reference::SortedReferenceMetadata &sortedReference, sortedReferenceMetadataList)
+    {
+        reference::RepeatKmerFilter<KmerT> &filter = ret.at(&sortedReference - &sortedReferenceMetadataList.front());
+        bool allFound = true;
+        BOOST_FOREACH(const reference::SortedReferenceMetadata::MaskFile &mask,
+                      sortedReference.getMaskFileList(oligo::KmerTraits<KmerT>::KMER_BASES))
+        {
+            allFound &= filter.load(reference::RepeatKmerFilter<KmerT>::getFilterPath(mask.path));
+        }
+        if (!allFound)
+        {
+            ISAAC_THREAD_CERR << "WARNING: repeat k-mers are not available for all masks of reference " <<
+                (&sortedReference - &sortedReferenceMetadataList.front()) <<
+                ". High-repeat seeds will be sorted and matched" << std::endl;
+            filter = reference::RepeatKmerFilter<KmerT>();
+        }
+        filter.buildLookup();
+        ISAAC_THREAD_CERR << "Loaded " << filter.size() << " repeat k-mers for reference " <<
+            (&sortedReference - &sortedReferenceMetadataList.front()) << std::endl;
+    }
+    return ret;
+}
+
+/**
+ * \brief Partitions the thread's share of the reference seeds so that the seeds of the repeat k-mers
+ *        are moved to the end of the share.
+ */
+template <typename KmerT>
+void SeedGeneratorBase<KmerT>::partitionRepeatSeeds(
+    const typename std::vector<Seed<KmerT> >::iterator referenceSeedsBegin,
+    const typename std::vector<Seed<KmerT> >::iterator referenceSeedsEnd,
+    const reference::RepeatKmerFilter<KmerT> &repeatFilter,
+    const unsigned threadsMax,
+    const unsigned threadNumber)
+{
+    const std::size_t seedsCount = std::distance(referenceSeedsBegin, referenceSeedsEnd);
+    const typename std::vector<Seed<KmerT> >::iterator begin = referenceSeedsBegin + seedsCount * threadNumber / threadsMax;
+    const typename std::vector<Seed<KmerT> >::iterator end = referenceSeedsBegin + seedsCount * (threadNumber + 1) / threadsMax;
+    typename std::vector<Seed<KmerT> >::iterator repeatsBegin = end;
+    typename std::vector<Seed<KmerT> >::iterator current = begin;
+    // same as std::partition, moves the repeat seeds to the end of the share
+    while (current != repeatsBegin)
+    {
+        // N-seeds are poly-T and must not be mistaken for poly-T repeats
+        if (!current->isNSeed() && repeatFilter.contains(current->getKmer()))
+        {
+            std::iter_swap(current, --repeatsBegin);
+        }
+        else
+        {
+            ++current;
+        }
+    }
+    threadRepeatSeedsBegins_.at(threadNumber) = repeatsBegin;
+}
+
+/**
+ * \brief Moves the seeds of the repeat k-mers past the end of the last reference so that they don't get sorted.
+ *        Adjusts the reference seed bounds accordingly. The relative order of seeds does not matter as the
+ *        seeds are sorted afterwards.
+ */
+template <typename KmerT>
+void SeedGeneratorBase<KmerT>::separateRepeatSeeds(
+    std::vector<Seed<KmerT> > &seeds,
+    isaac::common::ThreadVector &threads,
+    const unsigned threadsMax)
+{
+    typedef typename std::vector<Seed<KmerT> >::iterator SeedIterator;
+    repeatSeedsEnd_ = nextTileSeedBegins_.back();
+
+    // [repeatsBegin, referenceSeedsBegin) contains the repeat seeds of the references processed so far
+    SeedIterator repeatsBegin = seeds.begin();
+    SeedIterator referenceSeedsBegin = seeds.begin();
+    BOOST_FOREACH(SeedIterator &referenceSeedsEnd, nextTileSeedBegins_)
+    {
+        const reference::RepeatKmerFilter<KmerT> &repeatFilter =
+            referenceRepeatFilters_.at(&referenceSeedsEnd - &nextTileSeedBegins_.front());
+        const SeedIterator nextReferenceSeedsBegin = referenceSeedsEnd;
+        if (!repeatFilter.empty())
+        {
+            threads.execute(boost::bind(&SeedGeneratorBase::partitionRepeatSeeds, this,
+                                        referenceSeedsBegin, referenceSeedsEnd,
+                                        boost::cref(repeatFilter), threadsMax, _1),
+                            threadsMax);
+        }
+
+        // gather the non-repeat parts of all thread shares at the beginning.
+        const std::size_t seedsCount = std::distance(referenceSeedsBegin, referenceSeedsEnd);
+        for (unsigned threadNumber = 0; threadsMax != threadNumber; ++threadNumber)
+        {
+            const SeedIterator shareBegin = referenceSeedsBegin + seedsCount * threadNumber / threadsMax;
+            const SeedIterator shareRepeatsBegin = repeatFilter.empty() ?
+                referenceSeedsBegin + seedsCount * (threadNumber + 1) / threadsMax :
+                threadRepeatSeedsBegins_.at(threadNumber);
+            const std::size_t repeats = std::distance(repeatsBegin, shareBegin);
+            const std::size_t nonRepeats = std::distance(shareBegin, shareRepeatsBegin);
+            // swap the smaller of the two ranges. Seed order within the non-repeats does not matter.
+            if (repeats <= nonRepeats)
+            {
+                std::swap_ranges(repeatsBegin, shareBegin, shareRepeatsBegin - repeats);
+            }
+            else
+            {
+                std::swap_ranges(shareBegin, shareRepeatsBegin, repeatsBegin);
+            }
+            repeatsBegin += nonRepeats;
+        }
+        referenceSeedsEnd = repeatsBegin;
+        referenceSeedsBegin = nextReferenceSeedsBegin;
+    }
+
+    ISAAC_THREAD_CERR << "Separated " << std::distance(nextTileSeedBegins_.back(), repeatSeedsEnd_) <<
+        " repeat seeds from " << std::distance(seeds.begin(), repeatSeedsEnd_) << " seeds" << std::endl;
+}
+
 template <typename KmerT>
 void SeedGeneratorBase<KmerT>::sortSeeds(
     std::vector<Seed<KmerT> > &seeds,
@@ -78,17 +200,26 @@ void SeedGeneratorBase<KmerT>::sortSeeds(
     // have unmapped references. This is not perceived to be the major scenario, so, some unused memory is acceptable
     ISAAC_ASSERT_MSG(seeds.end() >= getReferenceSeedBounds().back(), "Computed end is past the end of the reserved buffer");
 
+    {
+        common::ScopedStageTimer timer(common::Profiler::FindMatchesSeparateRepeats);
+        timer.addItems(getReferenceSeedBounds().back() - seeds.begin());
+        common::ScoopedMallocBlockUnblock unblock(mallocBlock);
+        threadRepeatSeedsBegins_.resize(threadsMax);
+        separateRepeatSeeds(seeds, threads, threadsMax);
+    }
+
     typename std::vector<Seed<KmerT> >::iterator referenceSeedsBegin = seeds.begin();
     BOOST_FOREACH(typename std::vector<Seed<KmerT> >::iterator referenceSeedsEnd, getReferenceSeedBounds())
     {
         ISAAC_THREAD_CERR << "Sorting " << referenceSeedsEnd - referenceSeedsBegin << " seeds" << std::endl;
-        const clock_t startSort = clock();
+        common::ScopedStageTimer timer(common::Profiler::FindMatchesSortSeeds);
+        timer.addItems(referenceSeedsEnd - referenceSeedsBegin);
         {
             common::ScoopedMallocBlockUnblock unblock(mallocBlock);
             // comparing the full kmer is required to push the N-seeds off to the very end.
             common::parallelSort(referenceSeedsBegin, referenceSeedsEnd, &alignment::orderByKmerSeedIndex<KmerT>, threads, threadsMax);
         }
-        ISAAC_THREAD_CERR << "Sorting " << referenceSeedsEnd - referenceSeedsBegin << " seeds done in " << (clock() - startSort) / 1000 << "ms" << std::endl;
+        ISAAC_THREAD_CERR << "Sorting " << referenceSeedsEnd - referenceSeedsBegin << " seeds done in " << timer.getWallMs() << "ms" << std::endl;
         referenceSeedsBegin = referenceSeedsEnd;
     }
 }
@@ -205,6 +336,57 @@ void SeedGeneratorBase<KmerT>::reset(
 
 }
 
+template <typename KmerT>
+static bool isReferenceSeed(
+    const flowcell::BarcodeMetadataList &barcodeMetadataList,
+    const unsigned referenceIndex,
+    const Seed<KmerT> &seed)
+{
+    return barcodeMetadataList.at(seed.getBarcode()).getReferenceIndex() == referenceIndex;
+}
+
+template <typename KmerT>
+void mergeRepeatSeeds(
+    const flowcell::BarcodeMetadataList &barcodeMetadataList,
+    const typename std::vector<Seed<KmerT> >::iterator repeatSeedsEnd,
+    std::vector<typename std::vector<Seed<KmerT> >::iterator> &referenceSeedBounds)
+{
+    typedef typename std::vector<Seed<KmerT> >::iterator SeedIterator;
+    // Going from the last reference, the repeats that are not yet in place are always right after the
+    // seeds of the current reference. The repeats of the current reference are partitioned to the end and
+    // the seeds of the reference are rotated in front of them. The rest goes on to the previous reference.
+    SeedIterator pendingRepeatsEnd = repeatSeedsEnd;
+    for (std::size_t referenceIndex = referenceSeedBounds.size(); referenceIndex--;)
+    {
+        const SeedIterator referenceSeedsEnd = referenceSeedBounds.at(referenceIndex);
+        const SeedIterator otherRepeatsEnd = std::partition(
+            referenceSeedsEnd, pendingRepeatsEnd,
+            !boost::bind(&isReferenceSeed<KmerT>, boost::cref(barcodeMetadataList), referenceIndex, _1));
+        referenceSeedBounds.at(referenceIndex) = pendingRepeatsEnd;
+        if (!referenceIndex)
+        {
+            ISAAC_ASSERT_MSG(otherRepeatsEnd == referenceSeedsEnd, "Repeat seeds of unknown reference found");
+            break;
+        }
+        const SeedIterator referenceSeedsBegin = referenceSeedBounds.at(referenceIndex - 1);
+        std::rotate(referenceSeedsBegin, referenceSeedsEnd, otherRepeatsEnd);
+        pendingRepeatsEnd = referenceSeedsBegin + std::distance(referenceSeedsEnd, otherRepeatsEnd);
+    }
+}
+
+template void mergeRepeatSeeds<oligo::ShortKmerType>(
+    const flowcell::BarcodeMetadataList &barcodeMetadataList,
+    const std::vector<Seed<oligo::ShortKmerType> >::iterator repeatSeedsEnd,
+    std::vector<std::vector<Seed<oligo::ShortKmerType> >::iterator> &referenceSeedBounds);
+template void mergeRepeatSeeds<oligo::KmerType>(
+    const flowcell::BarcodeMetadataList &barcodeMetadataList,
+    const std::vector<Seed<oligo::KmerType> >::iterator repeatSeedsEnd,
+    std::vector<std::vector<Seed<oligo::KmerType> >::iterator> &referenceSeedBounds);
+template void mergeRepeatSeeds<oligo::LongKmerType>(
+    const flowcell::BarcodeMetadataList &barcodeMetadataList,
+    const std::vector<Seed<oligo::LongKmerType> >::iterator repeatSeedsEnd,
+    std::vector<std::vector<Seed<oligo::LongKmerType> >::iterator> &referenceSeedBounds);
+
 template class SeedGeneratorBase<oligo::ShortKmerType>;
 template class SeedGeneratorBase<oligo::KmerType>;
 template class SeedGeneratorBase<oligo::LongKmerType>;
@@ -26,9 +26,11 @@
 #include <boost/lambda/bind.hpp>
 #include <boost/thread.hpp>
 #include <boost/foreach.hpp>
+#include <boost/format.hpp>
 
 #include "alignment/SeedLoader.hh"
 #include "common/Debug.hh"
+#include "common/Exceptions.hh"
 #include "common/SystemCompatibility.hh"
 
 namespace isaac
@@ -36,12 +38,20 @@ namespace isaac
 namespace alignment
 {
 
+template <typename ReaderT, typename KmerT>
+const typename ParallelSeedLoader<ReaderT, KmerT>::ClusterBases ParallelSeedLoader<ReaderT, KmerT>::CLUSTER_BASES_N_FLAG;
+template <typename ReaderT, typename KmerT>
+const unsigned ParallelSeedLoader<ReaderT, KmerT>::CYCLE_BLOCK_MAX;
+template <typename ReaderT, typename KmerT>
+const typename ParallelSeedLoader<ReaderT, KmerT>::ClusterBases ParallelSeedLoader<ReaderT, KmerT>::CLUSTER_BASES_MASK;
+
 
 template <typename ReaderT, typename KmerT>
 ParallelSeedLoader<ReaderT, KmerT>::ParallelSeedLoader(
     const bool ignoreMissingBcls,
     common::ThreadVector &threads,
     boost::ptr_vector<rta::SingleCycleBclMapper<ReaderT> > &threadBclMappers,
+    common::MemoryGovernor &memoryGovernor,
     const unsigned inputLoadersMax,
     const unsigned coresMax,
     const flowcell::BarcodeMetadataList &barcodeMetadataList,
@@ -50,16 +60,48 @@ ParallelSeedLoader<ReaderT, KmerT>::ParallelSeedLoader(
     const reference::SortedReferenceMetadataList &sortedReferenceMetadataList,
     const flowcell::TileMetadataList &tileMetadataList)
     : SeedGeneratorBase<KmerT>(barcodeMetadataList, flowcellLayout, seedMetadataList, sortedReferenceMetadataList, tileMetadataList)
-    , inputLoadersMax_(inputLoadersMax)
+    , inputLoadersMax_(getLoadersMax(memoryGovernor, inputLoadersMax, flowcell::getMaxTileClusters(tileMetadataList)))
     , coresMax_(coresMax)
     , seedCycles_(alignment::getAllSeedCycles(BaseT::flowcellLayout_.getReadMetadataList(), seedMetadataList))
-    , threadDestinations_(inputLoadersMax, std::vector<typename std::vector<Seed<KmerT> >::iterator>(sortedReferenceMetadataList.size()))
-    , threadCycleDestinations_(inputLoadersMax, std::vector<typename std::vector<Seed<KmerT> >::iterator>(sortedReferenceMetadataList.size()))
+    , threadDestinations_(inputLoadersMax_, std::vector<typename std::vector<Seed<KmerT> >::iterator>(sortedReferenceMetadataList.size()))
+    , threadCycleDestinations_(inputLoadersMax_, std::vector<typename std::vector<Seed<KmerT> >::iterator>(sortedReferenceMetadataList.size()))
+    , threadClusterBases_(inputLoadersMax_, std::vector<ClusterBases>(flowcell::getMaxTileClusters(tileMetadataList)))
     , threads_(threads)
     , threadBclMappers_(threadBclMappers)
 {
 }
 
+/**
+ * \brief Limits the number of loader threads to the number of cycle block buffers that fit in memory.
+ *
+ * \postcondition The buffers get allocated right after this and are in the process size that the seed
+ *                tile selection measures.
+ */
+template <typename ReaderT, typename KmerT>
+unsigned ParallelSeedLoader<ReaderT, KmerT>::getLoadersMax(
+    common::MemoryGovernor &memoryGovernor,
+    const unsigned inputLoadersMax,
+    const unsigned maxTileClusters)
+{
+    const unsigned long bufferBytes = std::max(1U, maxTileClusters) * sizeof(ClusterBases);
+    memoryGovernor.measure();
+    const unsigned long buffersMax = memoryGovernor.getCapacity(bufferBytes);
+    if (!buffersMax)
+    {
+        BOOST_THROW_EXCEPTION(common::MemoryException((
+            boost::format("Insufficient memory for seed loader cycle block buffer of %d bytes. Available: %d") %
+                bufferBytes % memoryGovernor.getAvailable()).str()));
+    }
+
+    if (buffersMax < inputLoadersMax)
+    {
+        ISAAC_THREAD_CERR << "WARNING: loading seeds on " << buffersMax << " threads instead of " <<
+            inputLoadersMax << " due to the memory limit" << std::endl;
+        return buffersMax;
+    }
+    return inputLoadersMax;
+}
+
 /**
  * \brief fills seeds with sorted ABCD permutation,
  *        N-containing seeds masked as poly-T with seed id ~0UL and moved to the back of each range.
@@ -117,8 +159,9 @@ void ParallelSeedLoader<ReaderT, KmerT>::load(
             common::unlock_guard<boost::mutex> unlock(mutex_);
             std::vector<SeedMetadata>::const_iterator cycleSeedsBegin = BaseT::seedMetadataOrderedByFirstCycle_.begin();
             // cycles are guaranteed to belong to at least one of the seeds
-            BOOST_FOREACH(const unsigned cycle, seedCycles_)
+            for (std::vector<unsigned>::const_iterator blockBegin = seedCycles_.begin(); seedCycles_.end() != blockBegin;)
             {
+                const unsigned cycle = *blockBegin;
                 // find the first seed containing the cycle
                 while (
                     cycleSeedsBegin->getOffset() +
@@ -146,10 +189,32 @@ void ParallelSeedLoader<ReaderT, KmerT>::load(
                     ++cycleSeedsEnd;
                 }
 
+                // extend the block over the following cycles that belong to exactly the same seeds
+                std::vector<unsigned>::const_iterator blockEnd = blockBegin + 1;
+                while (seedCycles_.end() != blockEnd && CYCLE_BLOCK_MAX > std::size_t(blockEnd - blockBegin) &&
+                    *(blockEnd - 1) + 1 == *blockEnd && allSeedsContainCycle(*blockEnd, cycleSeedsBegin, cycleSeedsEnd))
+                {
+                    ++blockEnd;
+                }
+
+                rta::SingleCycleBclMapper<ReaderT> &threadBclMapper = threadBclMappers_.at(threadNumber);
+                for (std::vector<unsigned>::const_iterator blockCycle = blockBegin; blockEnd != blockCycle; ++blockCycle)
+                {
+                    if (seedCycles_.end() != blockCycle + 1)
+                    {
+                        threadBclMapper.prefetchTileCycle(BaseT::flowcellLayout_, *currentTile, *(blockCycle + 1));
+                    }
+                    threadBclMapper.mapTileCycle(BaseT::flowcellLayout_, *currentTile, *blockCycle);
+                    accumulateCycle(threadBclMapper.getCycleClusters(0), currentTile->getClusterCount(),
+                                    blockBegin == blockCycle, threadClusterBases_.at(threadNumber));
+                }
+
                 // this call messes up thisThreadCycleDestinationBegins so, save it.
                 thisThreadCycleDestinationBegins = thisThreadDestinationBegins;
-                loadTileCycle(tileClusterBarcode, threadBclMappers_.at(threadNumber),
-                              thisThreadCycleDestinationBegins, *currentTile, cycle, cycleSeedsBegin, cycleSeedsEnd);
+                loadTileCycleBlock(tileClusterBarcode, threadClusterBases_.at(threadNumber),
+                                   thisThreadCycleDestinationBegins, *currentTile, blockEnd - blockBegin,
+                                   cycleSeedsBegin, cycleSeedsEnd);
+                blockBegin = blockEnd;
             }
             ISAAC_THREAD_CERR << "Loading tile seeds done for " << *currentTile << std::endl;
         }
@@ -157,63 +222,123 @@ void ParallelSeedLoader<ReaderT, KmerT>::load(
 }
 
 template <typename ReaderT, typename KmerT>
-void ParallelSeedLoader<ReaderT, KmerT>::loadTileCycle(
+bool ParallelSeedLoader<ReaderT, KmerT>::allSeedsContainCycle(
+    const unsigned cycle,
+    std::vector<SeedMetadata>::const_iterator cycleSeedsBegin,
+    const std::vector<SeedMetadata>::const_iterator cycleSeedsEnd) const
+{
+    if (BaseT::seedMetadataOrderedByFirstCycle_.end() != cycleSeedsEnd &&
+        cycleSeedsEnd->getOffset() +
+        BaseT::flowcellLayout_.getReadMetadataList().at(cycleSeedsEnd->getReadIndex()).getFirstCycle() <= cycle)
+    {
+        // one more seed starts at cycle
+        return false;
+    }
+    for (; cycleSeedsEnd != cycleSeedsBegin; ++cycleSeedsBegin)
+    {
+        const unsigned seedFirstCycle = cycleSeedsBegin->getOffset() +
+            BaseT::flowcellLayout_.getReadMetadataList().at(cycleSeedsBegin->getReadIndex()).getFirstCycle();
+        if (seedFirstCycle > cycle || seedFirstCycle + cycleSeedsBegin->getLength() <= cycle)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * \brief Shifts the bases of the cycle into clusterBases. Streams sequentially through the bcl data and
+ *        clusterBases without touching the seeds.
+ */
+template <typename ReaderT, typename KmerT>
+void ParallelSeedLoader<ReaderT, KmerT>::accumulateCycle(
+    const char *bcl,
+    const unsigned clusterCount,
+    const bool firstCycleInBlock,
+    std::vector<ClusterBases> &clusterBases)
+{
+    ISAAC_ASSERT_MSG(clusterBases.size() >= clusterCount, "Insufficient cluster bases buffer " << clusterBases.size() << " need " << clusterCount);
+    // forget the bases from the previous block when starting a new one
+    const ClusterBases keepMask = firstCycleInBlock ? 0 : ClusterBases(~0);
+    ClusterBases *bases = &clusterBases.front();
+    for (const char *const bclEnd = bcl + clusterCount; bclEnd != bcl; ++bcl, ++bases)
+    {
+        const ClusterBases previous = *bases & keepMask;
+        *bases = ((previous << oligo::BITS_PER_BASE) & CLUSTER_BASES_MASK) |
+            (previous & CLUSTER_BASES_N_FLAG) |
+            (*bcl & oligo::BITS_PER_BASE_MASK) |
+            (oligo::isBclN(*bcl) ? CLUSTER_BASES_N_FLAG : 0);
+    }
+}
+
+/**
+ * \brief Appends the block of bases accumulated in clusterBases to forward and reverse-complement kmers of
+ *        the seeds that contain all the cycles of the block.
+ */
+template <typename ReaderT, typename KmerT>
+void ParallelSeedLoader<ReaderT, KmerT>::loadTileCycleBlock(
     const matchFinder::TileClusterInfo &tileClusterBarcode,
-    rta::SingleCycleBclMapper<ReaderT> &threadBclMapper,
+    const std::vector<ClusterBases> &clusterBases,
     std::vector<typename std::vector<Seed<KmerT> >::iterator> &destinationBegins,
     const flowcell::TileMetadata &tile,
-    const unsigned cycle,
+    const unsigned blockCycles,
     std::vector<SeedMetadata>::const_iterator cycleSeedsBegin,
     const std::vector<SeedMetadata>::const_iterator cycleSeedsEnd)
 {
     ISAAC_ASSERT_MSG(cycleSeedsEnd > cycleSeedsBegin, "Seed list cannot be empty");
     ISAAC_ASSERT_MSG((cycleSeedsEnd -1)->getReadIndex() == cycleSeedsBegin->getReadIndex(), "All seeds must belong to the same read");
+    ISAAC_ASSERT_MSG(blockCycles && CYCLE_BLOCK_MAX >= blockCycles, "Invalid cycle block length " << blockCycles);
     const unsigned readIndex = cycleSeedsBegin->getReadIndex();
 
     const std::vector<matchFinder::ClusterInfo> &clustersToDiscard = tileClusterBarcode.at(tile.getIndex());
     ISAAC_ASSERT_MSG(tile.getClusterCount() == clustersToDiscard.size(), "Found matches from a wrong tile/read");
 
-    threadBclMapper.mapTileCycle(BaseT::flowcellLayout_, tile, cycle);
+    const unsigned blockBits = blockCycles * oligo::BITS_PER_BASE;
+    const ClusterBases blockMask = (1 << blockBits) - 1;
 
     while (cycleSeedsEnd != cycleSeedsBegin)
     {
         for (unsigned int clusterId = 0; tile.getClusterCount() > clusterId; ++clusterId)
         {
-            const unsigned barcodeIndex = clustersToDiscard.at(clusterId).getBarcodeIndex();
-            const unsigned referenceIndex = BaseT::barcodeMetadataList_.at(barcodeIndex).getReferenceIndex();
-            char base = 0;
-            threadBclMapper.get(clusterId, &base);
-            if (flowcell::BarcodeMetadata::UNMAPPED_REFERENCE_INDEX != referenceIndex)
+            const unsigned barcodeIndex = clustersToDiscard[clusterId].getBarcodeIndex();
+            const unsigned referenceIndex = BaseT::barcodeMetadataList_[barcodeIndex].getReferenceIndex();
+            if (flowcell::BarcodeMetadata::UNMAPPED_REFERENCE_INDEX != referenceIndex &&
+                !clustersToDiscard[clusterId].isReadComplete(readIndex))
             {
-                if (!clustersToDiscard.at(clusterId).isReadComplete(readIndex))
+                Seed<KmerT> & forwardSeed = *destinationBegins[referenceIndex]++;
+                Seed<KmerT> & reverseSeed = *destinationBegins[referenceIndex]++;
+                // skip those previously found to contain Ns
+                if (!forwardSeed.isNSeed())
                 {
-                    Seed<KmerT> & forwardSeed = *destinationBegins[referenceIndex]++;
-                    Seed<KmerT> & reverseSeed = *destinationBegins[referenceIndex]++;
-                    // skip those previously found to contain Ns
-                    if (!forwardSeed.isNSeed())
+                    const ClusterBases bases = clusterBases[clusterId];
+                    if (!(bases & CLUSTER_BASES_N_FLAG))
                     {
-                        if (!oligo::isBclN(base))
+                        // reverse complement has the bases of the block in the opposite order
+                        ClusterBases complement = ~bases;
+                        KmerT reverseBases = 0;
+                        for (unsigned i = 0; blockCycles != i; ++i)
                         {
-                            KmerT forward = forwardSeed.getKmer();
-                            KmerT reverse = reverseSeed.getKmer();
-                            const KmerT forwardBaseValue = base & oligo::BITS_PER_BASE_MASK;
-                            const KmerT reverseBaseValue = (~forwardBaseValue) & oligo::BITS_PER_BASE_MASK;
-
-                            forward <<= oligo::BITS_PER_BASE;
-                            forward |= forwardBaseValue;
-                            reverse >>= oligo::BITS_PER_BASE;
-                            reverse |= (reverseBaseValue << (oligo::BITS_PER_BASE * oligo::KmerTraits<KmerT>::KMER_BASES - oligo::BITS_PER_BASE));
-
-                            forwardSeed = Seed<KmerT>(forward, SeedId(tile.getIndex(), barcodeIndex, clusterId, cycleSeedsBegin->getIndex(), 0));
-                            reverseSeed = Seed<KmerT>(reverse, SeedId(tile.getIndex(), barcodeIndex, clusterId, cycleSeedsBegin->getIndex(), 1));
-                        }
-                        else
-                        {
-                            // we can't have holes. The Ns must be stored in such a way that
-                            // they will be easy to remove later (after sorting)
-                            forwardSeed = makeNSeed<KmerT>(tile.getIndex(), barcodeIndex, clusterId, 0 == cycleSeedsBegin->getIndex());
-                            reverseSeed = makeNSeed<KmerT>(tile.getIndex(), barcodeIndex, clusterId, 0 == cycleSeedsBegin->getIndex());
+                            reverseBases <<= oligo::BITS_PER_BASE;
+                            reverseBases |= complement & oligo::BITS_PER_BASE_MASK;
+                            complement >>= oligo::BITS_PER_BASE;
                         }
+
+                        KmerT forward = forwardSeed.getKmer();
+                        KmerT reverse = reverseSeed.getKmer();
+                        forward <<= blockBits;
+                        forward |= KmerT(bases & blockMask);
+                        reverse >>= blockBits;
+                        reverse |= (reverseBases << (oligo::BITS_PER_BASE * oligo::KmerTraits<KmerT>::KMER_BASES - blockBits));
+
+                        forwardSeed = Seed<KmerT>(forward, SeedId(tile.getIndex(), barcodeIndex, clusterId, cycleSeedsBegin->getIndex(), 0));
+                        reverseSeed = Seed<KmerT>(reverse, SeedId(tile.getIndex(), barcodeIndex, clusterId, cycleSeedsBegin->getIndex(), 1));
+                    }
+                    else
+                    {
+                        // we can't have holes. The Ns must be stored in such a way that
+                        // they will be easy to remove later (after sorting)
+                        forwardSeed = makeNSeed<KmerT>(tile.getIndex(), barcodeIndex, clusterId, 0 == cycleSeedsBegin->getIndex());
+                        reverseSeed = makeNSeed<KmerT>(tile.getIndex(), barcodeIndex, clusterId, 0 == cycleSeedsBegin->getIndex());
                     }
                 }
             }
@@ -31,12 +31,14 @@ namespace alignment
 
 template <typename KmerT>
 SeedMemoryManager<KmerT>::SeedMemoryManager(
+    common::MemoryGovernor &memoryGovernor,
     const flowcell::BarcodeMetadataList &barcodeMetadataList,
     const ReadMetadataList &readMetadataList,
     const SeedMetadataList &seedMetadataList,
     const flowcell::TileMetadataList &allTiles
     )
-    : barcodeMetadataList_(barcodeMetadataList)
+    : memoryGovernor_(memoryGovernor)
+    , barcodeMetadataList_(barcodeMetadataList)
     , readMetadataList_(readMetadataList)
     , seedMetadataList_(seedMetadataList)
     , notFoundMatchesCount_()
@@ -49,6 +51,11 @@ SeedMemoryManager<KmerT>::SeedMemoryManager(
 template <typename KmerT>
 bool SeedMemoryManager<KmerT>::seeIfFits(const TileMetadataList &tiles) const
 {
+    if (!memoryGovernor_.fits(getTotalSeedCount(tiles) * sizeof(SeedT)))
+    {
+        return false;
+    }
+    // the governor does not know about the address space fragmentation. Make sure the allocation succeeds
     try
     {
         std::vector<SeedT> test;
@@ -72,6 +79,8 @@ bool SeedMemoryManager<KmerT>::selectTiles(TileMetadataList &unprocessedPool,
 {
 
     notFoundMatchesCount_ = getNotFoundMatchesCount(unprocessedPool, barcodeMetadataList_, readMetadataList_, fragmentsToSkip);
+    // whatever the previous pass allocated is either freed or stays. Either way it is not ours to plan
+    memoryGovernor_.measure();
     selectedTiles.swap(unprocessedPool);
     {
         ISAAC_THREAD_CERR << "Determining the number of tiles that can be processed simultaneously..." << std::endl;
@@ -18,6 +18,7 @@
  **/
 
 #include <algorithm>
+#include <emmintrin.h>
 #include <boost/format.hpp>
 
 #include "alignment/Quality.hh"
@@ -39,64 +40,194 @@ ShadowAligner::ShadowAligner(const flowcell::FlowcellLayoutList &flowcellLayoutL
                              const int gapMismatchScore,
                              const int gapOpenScore,
                              const int gapExtendScore,
-                             const int minGapExtendScore)
+                             const int minGapExtendScore,
+                             const bool fixedPointScoring)
     : gappedMismatchesMax_(gappedMismatchesMax),
-      ungappedAligner_(gapMatchScore, gapMismatchScore, gapOpenScore, gapExtendScore, minGapExtendScore),
-      gappedAligner_(flowcellLayoutList, avoidSmithWaterman, gapMatchScore, gapMismatchScore, gapOpenScore, gapExtendScore, minGapExtendScore),
+      ungappedAligner_(gapMatchScore, gapMismatchScore, gapOpenScore, gapExtendScore, minGapExtendScore, fixedPointScoring),
+      gappedAligner_(flowcellLayoutList, avoidSmithWaterman, gapMatchScore, gapMismatchScore, gapOpenScore, gapExtendScore, minGapExtendScore, fixedPointScoring),
+      shadowKmerPositions_(shadowKmerCount_),
+      shadowKmerEpoch_(0),
       shadowCigarBuffer_(Cigar::getMaxOperationsForReads(flowcellLayoutList) *
-                         unreasonablyHighDifferenceBetweenMaxAndMinInsertSizePlusFlanks_)
+                         unreasonablyHighDifferenceBetweenMaxAndMinInsertSizePlusFlanks_),
+      referenceKmersContig_(0),
+      referenceKmersBegin_(0),
+      referenceKmersEnd_(0)
 {
     shadowCandidatePositions_.reserve(unreasonablyHighDifferenceBetweenMaxAndMinInsertSizePlusFlanks_);
-    shadowKmerPositions_.reserve(shadowKmerCount_);
+    // generateReferenceKmers rounds up to whole blocks of 16 and needs one extra block of codes.
+    // Wider ranges go through oligo::KmerGenerator, so nothing gets allocated while rescuing shadows
+    referenceKmers_.reserve(referenceKmersMax_ + 16);
+    referenceCodes_.reserve(referenceKmersMax_ + 32);
 }
 
 unsigned ShadowAligner::hashShadowKmers(const std::vector<char> &sequence)
 {
-    shadowKmerPositions_.clear();
-    // initialize all k-mers to the magic value -1 (NOT_FOUND)
-    shadowKmerPositions_.resize(shadowKmerCount_, -1);
-    // 
+    // entries of the previous shadows become invalid as soon as the epoch changes
+    if (!++shadowKmerEpoch_)
+    {
+        std::fill(shadowKmerPositions_.begin(), shadowKmerPositions_.end(), ShadowKmerPosition());
+        shadowKmerEpoch_ = 1;
+    }
+
     oligo::KmerGenerator<unsigned> kmerGenerator(sequence.begin(), sequence.end(), shadowKmerLength_);
     unsigned positionsCount = 0;
     unsigned kmer;
     std::vector<char>::const_iterator position;
     while (kmerGenerator.next(kmer, position))
     {
-        if (-1 == shadowKmerPositions_[kmer])
+        ShadowKmerPosition &kmerPosition = shadowKmerPositions_[kmer];
+        if (shadowKmerEpoch_ != kmerPosition.epoch_)
         {
-            shadowKmerPositions_[kmer] = (position - sequence.begin());
+            kmerPosition.epoch_ = shadowKmerEpoch_;
+            kmerPosition.position_ = (position - sequence.begin());
             ++positionsCount;
         }
     }
     return positionsCount;
 }
 
-void ShadowAligner::findShadowCandidatePositions(
-    const std::vector<char>::const_iterator referenceBegin,
-    const std::vector<char>::const_iterator referenceEnd,
+/**
+ * \brief Produces the same k-mers as oligo::KmerGenerator would for [begin, end) except that the k-mers
+ *        containing Ns are stored as INVALID_REFERENCE_KMER instead of being skipped. 16 k-mers are
+ *        computed at a time.
+ */
+void ShadowAligner::generateReferenceKmers(
+    const std::vector<char> &reference,
+    const long begin,
+    const long end)
+{
+    static const oligo::Translator translator = oligo::getTranslator();
+    static const char INVALID_CODE = char(0x80);
+
+    const long length = end - begin;
+    ISAAC_ASSERT_MSG(referenceKmersMax_ >= length, "Reference range too long for cached k-mers: " << length);
+    const long kmerCount = length - shadowKmerLength_ + 1;
+    const long kmerBlocksEnd = (kmerCount + 15) & ~15L;
+
+    // the last block of k-mers reads up to shadowKmerLength_ - 1 codes past its end
+    referenceCodes_.resize(((length + 15) & ~15L) + 16);
+    const char *bases = &reference.front() + begin;
+    long i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bases + i));
+        const __m128i a = _mm_or_si128(_mm_cmpeq_epi8(b, _mm_set1_epi8('A')), _mm_cmpeq_epi8(b, _mm_set1_epi8('a')));
+        const __m128i c = _mm_or_si128(_mm_cmpeq_epi8(b, _mm_set1_epi8('C')), _mm_cmpeq_epi8(b, _mm_set1_epi8('c')));
+        const __m128i g = _mm_or_si128(_mm_cmpeq_epi8(b, _mm_set1_epi8('G')), _mm_cmpeq_epi8(b, _mm_set1_epi8('g')));
+        const __m128i t = _mm_or_si128(_mm_cmpeq_epi8(b, _mm_set1_epi8('T')), _mm_cmpeq_epi8(b, _mm_set1_epi8('t')));
+        const __m128i valid = _mm_or_si128(_mm_or_si128(a, c), _mm_or_si128(g, t));
+        const __m128i codes = _mm_or_si128(
+            _mm_or_si128(_mm_and_si128(c, _mm_set1_epi8(1)), _mm_and_si128(g, _mm_set1_epi8(2))),
+            _mm_or_si128(_mm_and_si128(t, _mm_set1_epi8(3)), _mm_andnot_si128(valid, _mm_set1_epi8(INVALID_CODE))));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(&referenceCodes_[i]), codes);
+    }
+    for (; i < length; ++i)
+    {
+        const unsigned value = translator[static_cast<unsigned char>(bases[i])];
+        referenceCodes_[i] = 4 > value ? char(value) : INVALID_CODE;
+    }
+    std::fill(referenceCodes_.begin() + i, referenceCodes_.end(), INVALID_CODE);
+
+    referenceKmers_.resize(std::max(0L, kmerBlocksEnd));
+    const __m128i zero = _mm_setzero_si128();
+    for (long position = 0; position < kmerCount; position += 16)
+    {
+        __m128i invalid = zero;
+        __m128i lowKmers = zero;
+        __m128i highKmers = zero;
+        for (unsigned j = 0; shadowKmerLength_ > j; ++j)
+        {
+            const __m128i codes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&referenceCodes_[position + j]));
+            invalid = _mm_or_si128(invalid, codes);
+            const __m128i baseValues = _mm_and_si128(codes, _mm_set1_epi8(3));
+            lowKmers = _mm_or_si128(_mm_slli_epi16(lowKmers, 2), _mm_unpacklo_epi8(baseValues, zero));
+            highKmers = _mm_or_si128(_mm_slli_epi16(highKmers, 2), _mm_unpackhi_epi8(baseValues, zero));
+        }
+        // any k-mer that has seen INVALID_CODE becomes INVALID_REFERENCE_KMER
+        invalid = _mm_cmplt_epi8(invalid, zero);
+        lowKmers = _mm_or_si128(lowKmers, _mm_unpacklo_epi8(invalid, invalid));
+        highKmers = _mm_or_si128(highKmers, _mm_unpackhi_epi8(invalid, invalid));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(&referenceKmers_[position]), lowKmers);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(&referenceKmers_[position + 8]), highKmers);
+    }
+
+    referenceKmersContig_ = &reference;
+    referenceKmersBegin_ = begin;
+    referenceKmersEnd_ = end;
+}
+
+/**
+ * \return false if there is no room for more candidate positions
+ */
+bool ShadowAligner::storeShadowCandidatePosition(const long candidatePosition)
+{
+    // avoid spurious repetitions of start positions
+    if (shadowCandidatePositions_.empty() || shadowCandidatePositions_.back() != candidatePosition)
+    {
+        if (shadowCandidatePositions_.size() == shadowCandidatePositions_.capacity())
+        {
+            // too many candidate positions. Just stop here. The alignment score will be miserable anyway.
+            return false;
+        }
+        shadowCandidatePositions_.push_back(candidatePosition);
+    }
+    return true;
+}
+
+const std::vector<long> &ShadowAligner::findShadowCandidatePositions(
+    const std::vector<char> &reference,
+    const long referenceBegin,
+    const long referenceEnd,
     const std::vector<char> &shadowSequence)
 {
+    shadowCandidatePositions_.clear();
+    if (referenceEnd - referenceBegin < long(shadowKmerLength_))
+    {
+        return shadowCandidatePositions_;
+    }
+
     hashShadowKmers(shadowSequence);
 
-    // find matching positions in the reference by k-mer comparison
-    oligo::KmerGenerator<unsigned> kmerGenerator(referenceBegin, referenceEnd, shadowKmerLength_);
-    unsigned kmer;
-    std::vector<char>::const_iterator position;
-    while(kmerGenerator.next(kmer, position))
+    if (referenceEnd - referenceBegin > referenceKmersMax_)
     {
-        if (-1 != shadowKmerPositions_[kmer])
+        // too wide for the cache. Find matching positions in the reference by k-mer comparison
+        const std::vector<char>::const_iterator rangeBegin = reference.begin() + referenceBegin;
+        oligo::KmerGenerator<unsigned> kmerGenerator(rangeBegin, reference.begin() + referenceEnd, shadowKmerLength_);
+        unsigned kmer;
+        std::vector<char>::const_iterator position;
+        while(kmerGenerator.next(kmer, position))
         {
-            const long candidatePosition = position - referenceBegin - shadowKmerPositions_[kmer];
-            // avoid spurious repetitions of start positions
-            if (shadowCandidatePositions_.empty() || shadowCandidatePositions_.back() != candidatePosition)
+            const ShadowKmerPosition &kmerPosition = shadowKmerPositions_[kmer];
+            if (shadowKmerEpoch_ == kmerPosition.epoch_ &&
+                !storeShadowCandidatePosition(position - rangeBegin - kmerPosition.position_))
             {
-                if (shadowCandidatePositions_.size() == shadowCandidatePositions_.capacity())
-                {
-                    // too many candidate positions. Just stop here. The alignment score will be miserable anyway.
-                    break;
-                }
-                shadowCandidatePositions_.push_back(candidatePosition);
-//                ISAAC_THREAD_CERR << "kmer: " << oligo::Bases<2, oligo::Kmer>(kmer, shadowKmerLength_) << " " << candidatePosition << std::endl;
+                break;
+            }
+        }
+    }
+    else
+    {
+        if (&reference != referenceKmersContig_ || referenceBegin < referenceKmersBegin_ || referenceEnd > referenceKmersEnd_)
+        {
+            generateReferenceKmers(reference, referenceBegin, referenceEnd);
+        }
+
+        // find matching positions in the reference by k-mer comparison
+        const std::vector<unsigned short>::const_iterator kmersBegin =
+            referenceKmers_.begin() + (referenceBegin - referenceKmersBegin_);
+        const std::vector<unsigned short>::const_iterator kmersEnd =
+            kmersBegin + (referenceEnd - referenceBegin - shadowKmerLength_ + 1);
+        for (std::vector<unsigned short>::const_iterator kmer = kmersBegin; kmersEnd != kmer; ++kmer)
+        {
+            if (INVALID_REFERENCE_KMER == *kmer)
+            {
+                continue;
+            }
+            const ShadowKmerPosition &kmerPosition = shadowKmerPositions_[*kmer];
+            if (shadowKmerEpoch_ == kmerPosition.epoch_ &&
+                !storeShadowCandidatePosition(kmer - kmersBegin - kmerPosition.position_))
+            {
+                break;
             }
         }
     }
@@ -109,6 +240,7 @@ void ShadowAligner::findShadowCandidatePositions(
                                                     shadowCandidatePositions_.end()),
                                         shadowCandidatePositions_.end());
     }
+    return shadowCandidatePositions_;
 }
 
 /**
@@ -189,12 +321,11 @@ bool ShadowAligner::rescueShadow(
         return false;
     }
     // find all the candidate positions for the shadow on the identified reference region
-    shadowCandidatePositions_.clear();
     const std::vector<char> &shadowSequence = shadowReverse ? shadowRead.getReverseSequence() : shadowRead.getForwardSequence();
     const long candidatePositionOffset = std::max(0L, shadowRescueRange.first);
     findShadowCandidatePositions(
-        reference.begin() + candidatePositionOffset,
-        reference.begin() + std::min((long)reference.size(), shadowRescueRange.second + 1),
+        reference, candidatePositionOffset,
+        std::min((long)reference.size(), shadowRescueRange.second + 1),
         shadowSequence);
 
     ISAAC_THREAD_CERR_DEV_TRACE("findShadowCandidatePositions found " << shadowCandidatePositions_.size() << " positions in range [" <<
@@ -69,15 +69,17 @@ TemplateBuilder::TemplateBuilder(
     const int gapOpenScore,
     const int gapExtendScore,
     const int minGapExtendScore,
+    const bool fixedPointScoring,
     const unsigned semialignedGapLimit,
     const DodgyAlignmentScore dodgyAlignmentScore)
     : scatterRepeats_(scatterRepeats)
     , dodgyAlignmentScore_(dodgyAlignmentScore)
+    , fixedPointScoring_(fixedPointScoring)
     , fragmentBuilder_(flowcellLayoutList, repeatThreshold, maxSeedsPerRead, gappedMismatchesMax,
-                       avoidSmithWaterman, gapMatchScore, gapMismatchScore, gapOpenScore, gapExtendScore, minGapExtendScore, semialignedGapLimit)
+                       avoidSmithWaterman, gapMatchScore, gapMismatchScore, gapOpenScore, gapExtendScore, minGapExtendScore, fixedPointScoring, semialignedGapLimit)
     , bamTemplate_(fragmentBuilder_.getCigarBuffer())
     , shadowAligner_(flowcellLayoutList,
-                     gappedMismatchesMax, avoidSmithWaterman, gapMatchScore, gapMismatchScore, gapOpenScore, gapExtendScore, minGapExtendScore)
+                     gappedMismatchesMax, avoidSmithWaterman, gapMatchScore, gapMismatchScore, gapOpenScore, gapExtendScore, minGapExtendScore, fixedPointScoring)
     , cigarBuffer_(10000)
     , shadowList_(TRACKED_REPEATS_MAX_ONE_READ)
 {
@@ -92,6 +94,8 @@ TemplateBuilder::TemplateBuilder(
         allShadowProbabilities_[r].reserve(maxSeedsPerRead *
                                            repeatThreshold * TRACKED_REPEATS_MAX_ONE_READ +
                                            TRACKED_REPEATS_MAX_ONE_READ);
+        // same as FragmentBuilder reserves for the fragments
+        fragmentProbabilities_[r].reserve(repeatThreshold * maxSeedsPerRead * 2);
     }
 }
 bool TemplateBuilder::buildTemplate(
@@ -287,9 +291,21 @@ bool TemplateBuilder::updateMappingScore(
 void TemplateBuilder::locateBestPair(
     const std::vector<std::vector<FragmentMetadata> > &fragments,
     const TemplateLengthStatistics &templateLengthStatistics,
-    TemplateBuilder::BestPairInfo &ret) const
+    TemplateBuilder::BestPairInfo &ret)
 {
     ret.init(fragments[0].begin(), fragments[1].begin());
+    if (fixedPointScoring_)
+    {
+        // exp is the most expensive part of the pair enumeration below. Compute it once per fragment.
+        for (std::size_t i = 0; 2 > i; ++i)
+        {
+            fragmentProbabilities_[i].clear();
+            BOOST_FOREACH(const FragmentMetadata &fragment, fragments[i])
+            {
+                fragmentProbabilities_[i].push_back(exp(fragment.logProbability));
+            }
+        }
+    }
     typedef std::vector<FragmentMetadata>::const_iterator FragmentIterator;
     FragmentIterator contigBegin[2] = {fragments[0].begin(), fragments[1].begin()};
     FragmentIterator contigEnd[2];
@@ -326,7 +342,10 @@ void TemplateBuilder::locateBestPair(
                     if (templateLengthStatistics.matchModel(*currentFragment[0], *currentFragment[1]))
                     {
                         const double currentLogProbability = currentFragment[0]->logProbability + currentFragment[1]->logProbability;
-                        const double currentProbability = exp(currentLogProbability);
+                        const double currentProbability = fixedPointScoring_ ?
+                            fragmentProbabilities_[0][currentFragment[0] - fragments[0].begin()] *
+                            fragmentProbabilities_[1][currentFragment[1] - fragments[1].begin()] :
+                            exp(currentLogProbability);
                         const unsigned long templateScore = currentFragment[0]->smithWatermanScore + currentFragment[1]->smithWatermanScore;
                         ISAAC_THREAD_CERR_DEV_TRACE_CLUSTER_ID(fragments[0].front().getCluster().getId(), "locateBestPair pair: " <<
                             *currentFragment[0] << "-" << *currentFragment[1] << " (" <<
@@ -0,0 +1,165 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <boost/assign.hpp>
+
+#include "RegistryName.hh"
+#include "testBinningFragmentStorage.hh"
+#include "BuilderInit.hh"
+
+#include "alignment/BamTemplate.hh"
+#include "alignment/Cluster.hh"
+#include "alignment/matchSelector/BinningFragmentStorage.hh"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( TestBinningFragmentStorage, registryName("BinningFragmentStorage"));
+
+using namespace isaac;
+
+void TestBinningFragmentStorage::setUp()
+{
+    tempDirectory_ = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("testBinningFragmentStorage-%%%%%%%%");
+}
+
+void TestBinningFragmentStorage::tearDown()
+{
+    boost::filesystem::remove_all(tempDirectory_);
+}
+
+namespace
+{
+
+static const unsigned READ_LENGTH = 50;
+static const unsigned CONTIG_LENGTH = 10000;
+static const unsigned CLUSTERS = 300;
+
+std::vector<char> readFile(const boost::filesystem::path &path)
+{
+    std::ifstream is(path.c_str(), std::ios_base::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+}
+
+void alignFragment(
+    alignment::FragmentMetadata &fragment,
+    alignment::Cigar &cigarBuffer,
+    const long position,
+    const bool reverse)
+{
+    fragment.reverse = reverse;
+    fragment.cigarBuffer = &cigarBuffer;
+    fragment.cigarOffset = cigarBuffer.size();
+    cigarBuffer.push_back(alignment::Cigar::encode(READ_LENGTH, alignment::Cigar::ALIGN));
+    fragment.cigarLength = cigarBuffer.size() - fragment.cigarOffset;
+    fragment.contigId = 0;
+    fragment.position = position;
+    fragment.observedLength = READ_LENGTH;
+}
+
+/**
+ * \brief Stores the same pairs into storage. Pairs are spread over several bins, some have their mates in
+ *        different bins, some are unaligned. A tile boundary is simulated half way through.
+ */
+void storeClusters(alignment::matchSelector::BinningFragmentStorage &storage)
+{
+    const flowcell::ReadMetadataList readMetadataList = getReadMetadataList(READ_LENGTH, READ_LENGTH);
+    std::vector<char> bcl(READ_LENGTH * 2);
+    alignment::Cluster cluster(READ_LENGTH);
+    alignment::Cigar cigarBuffer;
+    alignment::BamTemplate bamTemplate(cigarBuffer);
+    for (unsigned clusterId = 0; CLUSTERS != clusterId; ++clusterId)
+    {
+        for (unsigned i = 0; bcl.size() != i; ++i)
+        {
+            bcl[i] = (((clusterId * 7 + i * 13) % 40 + 2) << 2) | ((clusterId + i) % 4);
+        }
+        cluster.init(readMetadataList, bcl.begin(), 0, clusterId, alignment::ClusterXy(), true, 0);
+        bamTemplate.initialize(readMetadataList, cluster);
+        cigarBuffer.clear();
+        if (clusterId % 10)
+        {
+            const long position = (clusterId * 997) % (CONTIG_LENGTH - 3000);
+            // every third pair spans more than a bin
+            const long matePosition = position + (clusterId % 3 ? 300 : 2500);
+            alignFragment(bamTemplate.getFragmentMetadata(0), cigarBuffer, position, false);
+            alignFragment(bamTemplate.getFragmentMetadata(1), cigarBuffer, matePosition, true);
+        }
+
+        storage.add(bamTemplate, 0, 0);
+
+        if (CLUSTERS / 2 == clusterId)
+        {
+            storage.prepareFlush();
+            storage.flush();
+        }
+    }
+}
+
+} // namespace
+
+void TestBinningFragmentStorage::testStagingOnOff()
+{
+    reference::SortedReferenceMetadataList sortedReferenceMetadataList(1);
+    sortedReferenceMetadataList.front().putContig(
+        0, "chr1", "chr1.fa", 0, CONTIG_LENGTH, CONTIG_LENGTH, CONTIG_LENGTH, 0, 0, "", "", "");
+    alignment::MatchDistribution matchDistribution(sortedReferenceMetadataList);
+    matchDistribution.makeUniform();
+    flowcell::BarcodeMetadataList barcodeMetadataList(
+        1, flowcell::BarcodeMetadata("FC1", 0, 1, 0, false, flowcell::SequencingAdapterMetadataList()));
+    barcodeMetadataList.front().setIndex(0);
+    const flowcell::FlowcellLayoutList flowcellLayoutList;
+    common::MemoryGovernor memoryGovernor(0);
+
+    const std::string modes[] = {"staged", "unstaged"};
+    const unsigned stagingBufferBytes[] =
+        {alignment::matchSelector::BinningFragmentStorage::STAGING_BUFFER_BYTES_DEFAULT, 0};
+    alignment::BinMetadataList bins[2];
+    for (unsigned mode = 0; 2 != mode; ++mode)
+    {
+        const boost::filesystem::path binDirectory = tempDirectory_ / modes[mode];
+        boost::filesystem::create_directories(binDirectory);
+        alignment::matchSelector::BinningFragmentStorage storage(
+            true, false, 1, 1, matchDistribution, 1, binDirectory,
+            flowcellLayoutList, barcodeMetadataList, CLUSTERS, 1,
+            stagingBufferBytes[mode], memoryGovernor);
+        storeClusters(storage);
+        storage.close(bins[mode]);
+        // staging buffers are held until the storage goes away
+        CPPUNIT_ASSERT(memoryGovernor.getReserved());
+    }
+    CPPUNIT_ASSERT_EQUAL(0UL, memoryGovernor.getReserved());
+
+    CPPUNIT_ASSERT(2 < bins[0].size());
+    CPPUNIT_ASSERT_EQUAL(bins[0].size(), bins[1].size());
+    unsigned long totalElements = 0;
+    for (std::size_t bin = 0; bins[0].size() != bin; ++bin)
+    {
+        const alignment::BinMetadata &staged = bins[0].at(bin);
+        const alignment::BinMetadata &unstaged = bins[1].at(bin);
+        CPPUNIT_ASSERT_EQUAL(staged.getDataSize(), unstaged.getDataSize());
+        CPPUNIT_ASSERT_EQUAL(staged.getSeIdxElements(), unstaged.getSeIdxElements());
+        CPPUNIT_ASSERT_EQUAL(staged.getRIdxElements(), unstaged.getRIdxElements());
+        CPPUNIT_ASSERT_EQUAL(staged.getFIdxElements(), unstaged.getFIdxElements());
+        CPPUNIT_ASSERT_EQUAL(staged.getNmElements(), unstaged.getNmElements());
+        CPPUNIT_ASSERT_EQUAL(staged.getTotalCigarLength(), unstaged.getTotalCigarLength());
+        totalElements += staged.getTotalElements();
+
+        const std::vector<char> stagedData = readFile(staged.getPath());
+        CPPUNIT_ASSERT_EQUAL(staged.getDataSize(), (unsigned long)stagedData.size());
+        CPPUNIT_ASSERT(stagedData == readFile(unstaged.getPath()));
+    }
+    CPPUNIT_ASSERT_EQUAL((unsigned long)CLUSTERS * 2, totalElements);
+}
@@ -0,0 +1,34 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#ifndef iSAAC_ALIGNMENT_TEST_BINNING_FRAGMENT_STORAGE_HH
+#define iSAAC_ALIGNMENT_TEST_BINNING_FRAGMENT_STORAGE_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <boost/filesystem.hpp>
+
+class TestBinningFragmentStorage : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( TestBinningFragmentStorage );
+    CPPUNIT_TEST( testStagingOnOff );
+    CPPUNIT_TEST_SUITE_END();
+private:
+    boost::filesystem::path tempDirectory_;
+public:
+    void setUp();
+    void tearDown();
+    void testStagingOnOff();
+};
+
+#endif // #ifndef iSAAC_ALIGNMENT_TEST_BINNING_FRAGMENT_STORAGE_HH
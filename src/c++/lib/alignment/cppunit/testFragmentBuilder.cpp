@@ -92,7 +92,7 @@ void TestFragmentBuilder::testEmptyMatchList()
     using isaac::alignment::FragmentBuilder;
     FragmentBuilder fragmentBuilder(flowcells, 123, seedMetadataList.size()/2, 8, false,
                                     ELAND_MATCH_SCORE, ELAND_MISMATCH_SCORE, ELAND_GAP_OPEN_SCORE, ELAND_GAP_EXTEND_SCORE,
-                                    ELAND_MIN_GAP_EXTEND_SCORE, 20000);
+                                    ELAND_MIN_GAP_EXTEND_SCORE, false, 20000);
     // check the emptyness after creation
     CPPUNIT_ASSERT_EQUAL((size_t)2, fragmentBuilder.getFragments().size());
     CPPUNIT_ASSERT(fragmentBuilder.getFragments()[0].empty());
@@ -130,7 +130,7 @@ void TestFragmentBuilder::auxSingleSeed(const unsigned s0, const unsigned s1)
     using isaac::alignment::Cigar;
     FragmentBuilder fragmentBuilder(flowcells, 456, seedMetadataList.size()/2, 8, false,
                                     ELAND_MATCH_SCORE, ELAND_MISMATCH_SCORE, ELAND_GAP_OPEN_SCORE, ELAND_GAP_EXTEND_SCORE,
-                                    ELAND_MIN_GAP_EXTEND_SCORE, 20000);
+                                    ELAND_MIN_GAP_EXTEND_SCORE, false, 20000);
     // build the fragments
     fragmentBuilder.build(contigList, readMetadataList, seedMetadataList, testAdapters, matchList.begin(), matchList.end(), cluster0, true);
     // check buffer geometry
@@ -227,7 +227,7 @@ void TestFragmentBuilder::testMultiSeed()
     using isaac::alignment::Cigar;
     FragmentBuilder fragmentBuilder(flowcells, 123, seedMetadataList.size()/2, 8, false,
                                     ELAND_MATCH_SCORE, ELAND_MISMATCH_SCORE, ELAND_GAP_OPEN_SCORE, ELAND_GAP_EXTEND_SCORE,
-                                    ELAND_MIN_GAP_EXTEND_SCORE, 20000);
+                                    ELAND_MIN_GAP_EXTEND_SCORE, false, 20000);
     // build the fragments
     fragmentBuilder.build(contigList, readMetadataList, seedMetadataList, testAdapters, matchList.begin(), matchList.end(), cluster0, true);
     // check buffer geometry
@@ -308,7 +308,7 @@ void TestFragmentBuilder::testRepeats()
     using isaac::alignment::Cigar;
     FragmentBuilder fragmentBuilder(flowcells, 123, seedMetadataList.size()/2, 8, false,
                                     ELAND_MATCH_SCORE, ELAND_MISMATCH_SCORE, ELAND_GAP_OPEN_SCORE, ELAND_GAP_EXTEND_SCORE,
-                                    ELAND_MIN_GAP_EXTEND_SCORE, 20000);
+                                    ELAND_MIN_GAP_EXTEND_SCORE, false, 20000);
     // build the fragments
     fragmentBuilder.build(contigList, readMetadataList, seedMetadataList, testAdapters, matchList.begin(), matchList.end(), cluster2, true);
     // check buffer geometry
@@ -404,7 +404,7 @@ void TestFragmentBuilder::testMismatches()
     using isaac::alignment::Cigar;
     FragmentBuilder fragmentBuilder(flowcells, 123, seedMetadataList.size()/2, 8, false,
                                     ELAND_MATCH_SCORE, ELAND_MISMATCH_SCORE, ELAND_GAP_OPEN_SCORE, ELAND_GAP_EXTEND_SCORE,
-                                    ELAND_MIN_GAP_EXTEND_SCORE, 20000);
+                                    ELAND_MIN_GAP_EXTEND_SCORE, false, 20000);
     // build the fragments
     fragmentBuilder.build(contigList, readMetadataList, seedMetadataList, testAdapters, matchList.begin(), matchList.end(), cluster3, true);
     // check buffer geometry
@@ -475,7 +475,7 @@ void TestFragmentBuilder::testLeadingSoftClips()
     using isaac::alignment::Cigar;
     FragmentBuilder fragmentBuilder(flowcells, 123, seedMetadataList.size()/2, 8, false,
                                     ELAND_MATCH_SCORE, ELAND_MISMATCH_SCORE, ELAND_GAP_OPEN_SCORE, ELAND_GAP_EXTEND_SCORE,
-                                    ELAND_MIN_GAP_EXTEND_SCORE, 20000);
+                                    ELAND_MIN_GAP_EXTEND_SCORE, false, 20000);
     // build the fragments
     fragmentBuilder.build(contigList, readMetadataList, seedMetadataList, testAdapters, matchList.begin(), matchList.end(), cluster4l, true);
     // Fragment for the first read (forward)
@@ -520,7 +520,7 @@ void TestFragmentBuilder::testTrailingSoftClips()
     using isaac::alignment::Cigar;
     FragmentBuilder fragmentBuilder(flowcells, 123, seedMetadataList.size()/2, 8, false,
                                     ELAND_MATCH_SCORE, ELAND_MISMATCH_SCORE, ELAND_GAP_OPEN_SCORE, ELAND_GAP_EXTEND_SCORE,
-                                    ELAND_MIN_GAP_EXTEND_SCORE, 20000);
+                                    ELAND_MIN_GAP_EXTEND_SCORE, false, 20000);
     // build the fragments
     fragmentBuilder.build(contigList, readMetadataList, seedMetadataList, testAdapters, matchList.begin(), matchList.end(), cluster4t, true);
     // Fragment for the first read (forward)
@@ -565,7 +565,7 @@ void TestFragmentBuilder::testLeadingAndTrailingSoftClips()
     using isaac::alignment::Cigar;
     FragmentBuilder fragmentBuilder(flowcells, 123, seedMetadataList.size()/2, 8, false,
                                     ELAND_MATCH_SCORE, ELAND_MISMATCH_SCORE, ELAND_GAP_OPEN_SCORE, ELAND_GAP_EXTEND_SCORE,
-                                    ELAND_MIN_GAP_EXTEND_SCORE, 20000);
+                                    ELAND_MIN_GAP_EXTEND_SCORE, false, 20000);
     // build the fragments
     fragmentBuilder.build(contigList, readMetadataList, seedMetadataList, testAdapters, matchList.begin(), matchList.end(), cluster4lt, true);
     // Fragment for the first read (forward)
@@ -596,3 +596,52 @@ void TestFragmentBuilder::testLeadingAndTrailingSoftClips()
 //    CPPUNIT_ASSERT_EQUAL((unsigned)40, fragmentBuilder.getFragments()[1][0].mismatchCount);
 }
 
+
+void TestFragmentBuilder::auxFixedPointScoring(const isaac::alignment::Cluster &cluster)
+{
+    using isaac::alignment::FragmentBuilder;
+    using isaac::alignment::FragmentMetadata;
+    FragmentBuilder doubleBuilder(flowcells, 123, seedMetadataList.size()/2, 8, false,
+                                  ELAND_MATCH_SCORE, ELAND_MISMATCH_SCORE, ELAND_GAP_OPEN_SCORE, ELAND_GAP_EXTEND_SCORE,
+                                  ELAND_MIN_GAP_EXTEND_SCORE, false, 20000);
+    FragmentBuilder fixedBuilder(flowcells, 123, seedMetadataList.size()/2, 8, false,
+                                 ELAND_MATCH_SCORE, ELAND_MISMATCH_SCORE, ELAND_GAP_OPEN_SCORE, ELAND_GAP_EXTEND_SCORE,
+                                 ELAND_MIN_GAP_EXTEND_SCORE, true, 20000);
+    doubleBuilder.build(contigList, readMetadataList, seedMetadataList, testAdapters, matchList.begin(), matchList.end(), cluster, true);
+    fixedBuilder.build(contigList, readMetadataList, seedMetadataList, testAdapters, matchList.begin(), matchList.end(), cluster, true);
+    CPPUNIT_ASSERT_EQUAL(doubleBuilder.getCigarBuffer().size(), fixedBuilder.getCigarBuffer().size());
+    for (std::size_t readIndex = 0; 2 > readIndex; ++readIndex)
+    {
+        const std::vector<FragmentMetadata> &doubleFragments = doubleBuilder.getFragments()[readIndex];
+        const std::vector<FragmentMetadata> &fixedFragments = fixedBuilder.getFragments()[readIndex];
+        CPPUNIT_ASSERT_EQUAL(doubleFragments.size(), fixedFragments.size());
+        for (std::size_t i = 0; doubleFragments.size() > i; ++i)
+        {
+            CPPUNIT_ASSERT_EQUAL(doubleFragments[i].position, fixedFragments[i].position);
+            CPPUNIT_ASSERT_EQUAL(doubleFragments[i].mismatchCount, fixedFragments[i].mismatchCount);
+            CPPUNIT_ASSERT_EQUAL(doubleFragments[i].editDistance, fixedFragments[i].editDistance);
+            CPPUNIT_ASSERT_EQUAL(doubleFragments[i].matchesInARow, fixedFragments[i].matchesInARow);
+            CPPUNIT_ASSERT_EQUAL(doubleFragments[i].smithWatermanScore, fixedFragments[i].smithWatermanScore);
+            // rounding error of each base is below 2^-17
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(doubleFragments[i].logProbability, fixedFragments[i].logProbability,
+                                         fixedFragments[i].getReadLength() / double(1 << 17));
+        }
+    }
+}
+
+void TestFragmentBuilder::testFixedPointScoring()
+{
+    using isaac::alignment::SeedId;
+    using isaac::reference::ReferencePosition;
+    using isaac::alignment::Match;
+    // mismatches on both strands
+    matchList.push_back(Match(Match(SeedId(tile0, 0, clusterId0, 0, false), ReferencePosition(0, 2 + seedMetadataList[0].getOffset()))));
+    matchList.push_back(Match(Match(SeedId(tile0, 0, clusterId0, 3, true ), ReferencePosition(0, 175 - seedMetadataList[3].getOffset()))));
+    auxFixedPointScoring(cluster3);
+
+    // soft clips
+    matchList.clear();
+    matchList.push_back(Match(Match(SeedId(tile0, 0, clusterId0, 0, false), ReferencePosition(4, 20))));
+    matchList.push_back(Match(Match(SeedId(tile0, 0, clusterId0, 3, true ), ReferencePosition(4, 6))));
+    auxFixedPointScoring(cluster4l);
+}
@@ -35,6 +35,7 @@ class TestFragmentBuilder : public CppUnit::TestFixture
     CPPUNIT_TEST( testLeadingSoftClips );
     CPPUNIT_TEST( testTrailingSoftClips );
     CPPUNIT_TEST( testLeadingAndTrailingSoftClips );
+    CPPUNIT_TEST( testFixedPointScoring );
     CPPUNIT_TEST_SUITE_END();
 private:
     const isaac::flowcell::ReadMetadataList readMetadataList;
@@ -60,6 +61,8 @@ private:
     std::vector<isaac::alignment::Match> matchList;
     // auxiliary method for tests dedicated to a single seed on each read
     void auxSingleSeed(const unsigned s0, const unsigned s1);
+    // builds the fragments with double and fixed-point scoring and compares the results
+    void auxFixedPointScoring(const isaac::alignment::Cluster &cluster);
 public:
     TestFragmentBuilder();
     void setUp();
@@ -73,6 +76,7 @@ public:
     void testLeadingSoftClips();
     void testTrailingSoftClips();
     void testLeadingAndTrailingSoftClips();
+    void testFixedPointScoring();
 };
 
 #endif // #ifndef iSAAC_ALIGNMENT_TEST_FRAGMENT_BUILDER_HH
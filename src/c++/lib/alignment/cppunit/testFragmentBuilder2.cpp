@@ -189,12 +189,12 @@ void TestFragmentBuilder2::align(
     isaac::alignment::matchSelector::FragmentSequencingAdapterClipper adapterClipper(adapters);
     adapterClipper.checkInitStrand(fragmentMetadata, referenceContig);
 
-    isaac::alignment::fragmentBuilder::UngappedAligner ungappedAligner(ELAND_MATCH_SCORE, ELAND_MISMATCH_SCORE, ELAND_GAP_OPEN_SCORE, ELAND_GAP_EXTEND_SCORE, ELAND_MIN_GAP_EXTEND_SCORE);
+    isaac::alignment::fragmentBuilder::UngappedAligner ungappedAligner(ELAND_MATCH_SCORE, ELAND_MISMATCH_SCORE, ELAND_GAP_OPEN_SCORE, ELAND_GAP_EXTEND_SCORE, ELAND_MIN_GAP_EXTEND_SCORE, false);
 
     ungappedAligner.alignUngapped(fragmentMetadata, cigarBuffer_, readMetadataList, adapterClipper, referenceContig);
     if (gapped)
     {
-        isaac::alignment::fragmentBuilder::GappedAligner gappedAligner(flowcells, false, ELAND_MATCH_SCORE, ELAND_MISMATCH_SCORE, ELAND_GAP_OPEN_SCORE, ELAND_GAP_EXTEND_SCORE, ELAND_MIN_GAP_EXTEND_SCORE);
+        isaac::alignment::fragmentBuilder::GappedAligner gappedAligner(flowcells, false, ELAND_MATCH_SCORE, ELAND_MISMATCH_SCORE, ELAND_GAP_OPEN_SCORE, ELAND_GAP_EXTEND_SCORE, ELAND_MIN_GAP_EXTEND_SCORE, false);
         isaac::alignment::FragmentMetadata tmp = fragmentMetadata;
         const unsigned matchCount = gappedAligner.alignGapped(tmp, cigarBuffer_, readMetadataList, adapterClipper, referenceContig);
         if (matchCount + isaac::alignment::BandedSmithWaterman::WIDEST_GAP_SIZE > fragmentMetadata.getObservedLength() &&
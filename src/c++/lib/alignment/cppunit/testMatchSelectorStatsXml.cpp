@@ -0,0 +1,296 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/assign.hpp>
+#include <boost/foreach.hpp>
+#include <boost/property_tree/xml_parser.hpp>
+
+#include "RegistryName.hh"
+#include "testMatchSelectorStatsXml.hh"
+
+#include "alignment/BamTemplate.hh"
+#include "alignment/Cluster.hh"
+#include "alignment/matchSelector/MatchSelectorStats.hh"
+#include "alignment/matchSelector/MatchSelectorStatsXml.hh"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( TestMatchSelectorStatsXml, registryName("MatchSelectorStatsXml"));
+
+using namespace isaac;
+namespace bpt = boost::property_tree;
+
+namespace
+{
+
+static const unsigned READ_LENGTH = 10;
+static const unsigned MISMATCH_CYCLE = 3;
+static const unsigned TILES = 3;
+static const unsigned BARCODES = 4;
+// [tile][barcode] clusters recorded for the tile. The last tile is never added
+static const unsigned TILE_BARCODE_CLUSTERS[TILES - 1][BARCODES] = {{0, 3, 2, 0}, {1, 4, 2, 0}};
+
+flowcell::ReadMetadataList getReadMetadataList()
+{
+    const std::vector<flowcell::ReadMetadata> reads = boost::assign::list_of
+        (flowcell::ReadMetadata(1, READ_LENGTH, 0, 0))
+        (flowcell::ReadMetadata(READ_LENGTH + 1, READ_LENGTH * 2, 1, READ_LENGTH));
+    return flowcell::ReadMetadataList(reads);
+}
+
+flowcell::BarcodeMetadata makeBarcode(
+    const unsigned lane,
+    const std::string &sampleName,
+    const std::string &sequence,
+    const unsigned index)
+{
+    flowcell::BarcodeMetadata ret = sampleName.empty() ?
+        flowcell::BarcodeMetadata::constructUnknownBarcode("FC1", 0, lane, 0, flowcell::SequencingAdapterMetadataList()) :
+        flowcell::BarcodeMetadata("FC1", 0, lane, 0, false, flowcell::SequencingAdapterMetadataList());
+    if (!sampleName.empty())
+    {
+        ret.setSampleName(sampleName);
+        ret.setSequence(sequence);
+        ret.setProject("P1");
+    }
+    ret.setReference("ref");
+    ret.setIndex(index);
+    return ret;
+}
+
+/**
+ * \brief Records clusters of which the first read is uniquely aligned with one mismatch at MISMATCH_CYCLE
+ *        and the second read is not aligned.
+ */
+void recordTile(
+    alignment::matchSelector::MatchSelectorStats &stats,
+    const flowcell::ReadMetadataList &readMetadataList,
+    const unsigned tileIndex)
+{
+    const std::vector<char> bcl(READ_LENGTH * 2, (30 << 2) | 1);
+    const alignment::TemplateLengthStatistics templateLengthStatistics;
+    alignment::Cluster cluster(READ_LENGTH);
+    alignment::Cigar cigarBuffer;
+    alignment::BamTemplate bamTemplate(cigarBuffer);
+    unsigned long clusterId = 0;
+    for (unsigned barcode = 0; BARCODES != barcode; ++barcode)
+    {
+        for (unsigned i = 0; TILE_BARCODE_CLUSTERS[tileIndex][barcode] != i; ++i)
+        {
+            cluster.init(readMetadataList, bcl.begin(), tileIndex, clusterId++, alignment::ClusterXy(), true, 0);
+            bamTemplate.initialize(readMetadataList, cluster);
+            cigarBuffer.clear();
+            alignment::FragmentMetadata &fragment = bamTemplate.getFragmentMetadata(0);
+            fragment.cigarBuffer = &cigarBuffer;
+            fragment.cigarOffset = cigarBuffer.size();
+            cigarBuffer.push_back(alignment::Cigar::encode(READ_LENGTH, alignment::Cigar::ALIGN));
+            fragment.cigarLength = cigarBuffer.size() - fragment.cigarOffset;
+            fragment.contigId = 0;
+            fragment.position = 100;
+            fragment.observedLength = READ_LENGTH;
+            fragment.setAlignmentScore(60);
+            fragment.addMismatchCycle(MISMATCH_CYCLE);
+            stats.recordTemplate(readMetadataList, templateLengthStatistics, bamTemplate, barcode,
+                                 alignment::matchSelector::Normal);
+        }
+    }
+}
+
+const bpt::ptree &getChild(
+    const bpt::ptree &parent,
+    const std::string &name,
+    const std::string &attribute,
+    const std::string &value)
+{
+    BOOST_FOREACH(const bpt::ptree::value_type &child, parent)
+    {
+        if (name == child.first && value == child.second.get<std::string>("<xmlattr>." + attribute, ""))
+        {
+            return child.second;
+        }
+    }
+    CPPUNIT_FAIL("Missing " + name + " " + attribute + "=" + value);
+    return parent;
+}
+
+const bpt::ptree &getBarcodeLane(
+    const bpt::ptree &stats,
+    const std::string &flowcellId,
+    const std::string &project,
+    const std::string &sample,
+    const std::string &barcode,
+    const std::string &lane)
+{
+    return getChild(getChild(getChild(getChild(getChild(stats.get_child("Stats"),
+        "Flowcell", "flowcell-id", flowcellId), "Project", "name", project), "Sample", "name", sample),
+        "Barcode", "name", barcode), "Lane", "number", lane);
+}
+
+/// Barcode Tile elements come one per read, the read-independent counters are in the first one
+unsigned long getClusterCount(const bpt::ptree &lane, const std::string &tile)
+{
+    return getChild(lane, "Tile", "number", tile).get<unsigned long>("Pf.ClusterCount");
+}
+
+unsigned long getUniquelyAlignedCount(const bpt::ptree &tile, const std::string &read)
+{
+    return getChild(tile.get_child("Raw"), "Read", "number", read).get<unsigned long>("UniquelyAlignedFragments.Count");
+}
+
+unsigned long getOneMismatchFragments(const bpt::ptree &tile, const std::string &cycle)
+{
+    return getChild(getChild(tile.get_child("Raw"), "Read", "number", "1").get_child("AllFragments.FragmentMismatchesByCycle"),
+                    "Cycle", "number", cycle).get<unsigned long>("<xmlattr>.one");
+}
+
+bpt::ptree parse(const std::string &xml)
+{
+    std::istringstream is(xml);
+    bpt::ptree ret;
+    bpt::read_xml(is, ret);
+    return ret;
+}
+
+} // namespace
+
+TestMatchSelectorStatsXml::TestMatchSelectorStatsXml()
+{
+    flowcellLayoutList_.push_back(flowcell::Layout("", flowcell::Layout::Fastq, false, 8, std::vector<unsigned>(4),
+                                                   getReadMetadataList(), alignment::SeedMetadataList(), "FC1"));
+    flowcellLayoutList_.front().addTile(1, 1101);
+    flowcellLayoutList_.front().addTile(1, 1102);
+    flowcellLayoutList_.front().addTile(2, 1101);
+
+    barcodeMetadataList_.push_back(makeBarcode(1, "", "", 0));
+    barcodeMetadataList_.push_back(makeBarcode(1, "S1", "AAAA", 1));
+    barcodeMetadataList_.push_back(makeBarcode(1, "S2", "CCCC", 2));
+    barcodeMetadataList_.push_back(makeBarcode(2, "S1", "AAAA", 3));
+
+    tileMetadataList_.push_back(flowcell::TileMetadata("FC1", 0, 1101, 1, 100, 0));
+    tileMetadataList_.push_back(flowcell::TileMetadata("FC1", 0, 1102, 1, 100, 1));
+    tileMetadataList_.push_back(flowcell::TileMetadata("FC1", 0, 1101, 2, 100, 2));
+}
+
+void TestMatchSelectorStatsXml::setUp()
+{
+    tempDirectory_ = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("testMatchSelectorStatsXml-%%%%%%%%");
+    boost::filesystem::create_directories(tempDirectory_);
+}
+
+void TestMatchSelectorStatsXml::tearDown()
+{
+    boost::filesystem::remove_all(tempDirectory_);
+}
+
+std::string TestMatchSelectorStatsXml::serialize(const bool resumeSecondTile)
+{
+    const flowcell::ReadMetadataList &readMetadataList = flowcellLayoutList_.front().getReadMetadataList();
+    std::ostringstream os;
+    {
+        alignment::matchSelector::MatchSelectorStatsXml statsXml(
+            flowcellLayoutList_, barcodeMetadataList_, tileMetadataList_, tempDirectory_ / "MatchSelectorStats.spool");
+        for (unsigned tile = 0; TILES - 1 != tile; ++tile)
+        {
+            alignment::matchSelector::MatchSelectorStats stats(barcodeMetadataList_);
+            recordTile(stats, readMetadataList, tile);
+            if (resumeSecondTile && 1 == tile)
+            {
+                // same as what the tile checkpoint stores and loads back on resume
+                std::stringstream checkpoint;
+                CPPUNIT_ASSERT(stats.save(checkpoint));
+                alignment::matchSelector::MatchSelectorStats resumed(barcodeMetadataList_);
+                CPPUNIT_ASSERT(resumed.load(checkpoint));
+                statsXml.addTile(tileMetadataList_.at(tile), resumed);
+            }
+            else
+            {
+                statsXml.addTile(tileMetadataList_.at(tile), stats);
+            }
+        }
+        statsXml.serialize(os);
+    }
+    CPPUNIT_ASSERT(!boost::filesystem::exists(tempDirectory_ / "MatchSelectorStats.spool"));
+    return os.str();
+}
+
+void TestMatchSelectorStatsXml::testTiles()
+{
+    const bpt::ptree stats = parse(serialize(false));
+    const bpt::ptree &flowcell = getChild(stats.get_child("Stats"), "Flowcell", "flowcell-id", "FC1");
+    CPPUNIT_ASSERT_EQUAL(2UL, (unsigned long)flowcell.count("Lane"));
+    CPPUNIT_ASSERT_EQUAL(2UL, (unsigned long)flowcell.count("Read"));
+
+    const bpt::ptree &lane1 = getChild(flowcell, "Lane", "number", "1");
+    CPPUNIT_ASSERT_EQUAL(2UL, (unsigned long)lane1.count("Tile"));
+    const bpt::ptree &tile1101 = getChild(lane1, "Tile", "number", "1101");
+    const bpt::ptree &tile1102 = getChild(lane1, "Tile", "number", "1102");
+    CPPUNIT_ASSERT_EQUAL(5UL, getUniquelyAlignedCount(tile1101, "1"));
+    CPPUNIT_ASSERT_EQUAL(0UL, getUniquelyAlignedCount(tile1101, "2"));
+    CPPUNIT_ASSERT_EQUAL(7UL, getUniquelyAlignedCount(tile1102, "1"));
+
+    // mismatch counts accumulate towards the end of the read exactly once
+    CPPUNIT_ASSERT_EQUAL(0UL, getOneMismatchFragments(tile1101, "2"));
+    CPPUNIT_ASSERT_EQUAL(5UL, getOneMismatchFragments(tile1101, "3"));
+    CPPUNIT_ASSERT_EQUAL(5UL, getOneMismatchFragments(tile1101, "10"));
+    CPPUNIT_ASSERT_EQUAL(7UL, getOneMismatchFragments(tile1102, "10"));
+
+    // the tile that has never been added is still there with zero counts
+    const bpt::ptree &lane2 = getChild(flowcell, "Lane", "number", "2");
+    CPPUNIT_ASSERT_EQUAL(1UL, (unsigned long)lane2.count("Tile"));
+    CPPUNIT_ASSERT_EQUAL(0UL, getUniquelyAlignedCount(getChild(lane2, "Tile", "number", "1101"), "1"));
+    CPPUNIT_ASSERT_EQUAL(0UL, getOneMismatchFragments(getChild(lane2, "Tile", "number", "1101"), "10"));
+}
+
+void TestMatchSelectorStatsXml::testBarcodes()
+{
+    const bpt::ptree stats = parse(serialize(false));
+
+    const bpt::ptree &s1Lane1 = getBarcodeLane(stats, "FC1", "P1", "S1", "AAAA", "1");
+    CPPUNIT_ASSERT_EQUAL(3UL, getClusterCount(s1Lane1, "1101"));
+    CPPUNIT_ASSERT_EQUAL(4UL, getClusterCount(s1Lane1, "1102"));
+    // one Tile element per read
+    CPPUNIT_ASSERT_EQUAL(4UL, (unsigned long)s1Lane1.count("Tile"));
+    const bpt::ptree &s1Lane2 = getBarcodeLane(stats, "FC1", "P1", "S1", "AAAA", "2");
+    CPPUNIT_ASSERT_EQUAL(0UL, getClusterCount(s1Lane2, "1101"));
+
+    const bpt::ptree &s2Lane1 = getBarcodeLane(stats, "FC1", "P1", "S2", "CCCC", "1");
+    CPPUNIT_ASSERT_EQUAL(2UL, getClusterCount(s2Lane1, "1101"));
+    CPPUNIT_ASSERT_EQUAL(2UL, getClusterCount(s2Lane1, "1102"));
+    // CCCC is only in lane 1
+    CPPUNIT_ASSERT_EQUAL(1UL, (unsigned long)getChild(getChild(getChild(getChild(stats.get_child("Stats"),
+        "Flowcell", "flowcell-id", "FC1"), "Project", "name", "P1"), "Sample", "name", "S2"),
+        "Barcode", "name", "CCCC").count("Lane"));
+
+    const bpt::ptree &allLane1 = getBarcodeLane(stats, "FC1", "all", "all", "all", "1");
+    CPPUNIT_ASSERT_EQUAL(5UL, getClusterCount(allLane1, "1101"));
+    CPPUNIT_ASSERT_EQUAL(7UL, getClusterCount(allLane1, "1102"));
+
+    const bpt::ptree &allFlowcellsS1 = getBarcodeLane(stats, "all", "P1", "S1", "all", "1");
+    CPPUNIT_ASSERT_EQUAL(3UL, getClusterCount(allFlowcellsS1, "1101"));
+    CPPUNIT_ASSERT_EQUAL(4UL, getClusterCount(allFlowcellsS1, "1102"));
+}
+
+void TestMatchSelectorStatsXml::testCheckpointResume()
+{
+    // a tile resumed from the checkpoint must produce exactly the same document
+    const std::string direct = serialize(false);
+    const std::string resumed = serialize(true);
+    CPPUNIT_ASSERT_EQUAL(direct, resumed);
+
+    const bpt::ptree stats = parse(resumed);
+    const bpt::ptree &lane1 = getChild(getChild(stats.get_child("Stats"), "Flowcell", "flowcell-id", "FC1"), "Lane", "number", "1");
+    CPPUNIT_ASSERT_EQUAL(7UL, getOneMismatchFragments(getChild(lane1, "Tile", "number", "1102"), "10"));
+    CPPUNIT_ASSERT_EQUAL(4UL, getClusterCount(getBarcodeLane(stats, "FC1", "P1", "S1", "AAAA", "1"), "1102"));
+}
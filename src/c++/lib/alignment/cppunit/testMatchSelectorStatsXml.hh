@@ -0,0 +1,49 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#ifndef iSAAC_ALIGNMENT_TEST_MATCH_SELECTOR_STATS_XML_HH
+#define iSAAC_ALIGNMENT_TEST_MATCH_SELECTOR_STATS_XML_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <boost/filesystem.hpp>
+
+#include "flowcell/BarcodeMetadata.hh"
+#include "flowcell/Layout.hh"
+#include "flowcell/TileMetadata.hh"
+
+class TestMatchSelectorStatsXml : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( TestMatchSelectorStatsXml );
+    CPPUNIT_TEST( testTiles );
+    CPPUNIT_TEST( testBarcodes );
+    CPPUNIT_TEST( testCheckpointResume );
+    CPPUNIT_TEST_SUITE_END();
+private:
+    boost::filesystem::path tempDirectory_;
+    isaac::flowcell::FlowcellLayoutList flowcellLayoutList_;
+    isaac::flowcell::BarcodeMetadataList barcodeMetadataList_;
+    isaac::flowcell::TileMetadataList tileMetadataList_;
+
+    /// adds all tiles but the last one, the second tile goes through a checkpoint
+    std::string serialize(const bool resumeSecondTile);
+public:
+    TestMatchSelectorStatsXml();
+    void setUp();
+    void tearDown();
+    void testTiles();
+    void testBarcodes();
+    void testCheckpointResume();
+};
+
+#endif // #ifndef iSAAC_ALIGNMENT_TEST_MATCH_SELECTOR_STATS_XML_HH
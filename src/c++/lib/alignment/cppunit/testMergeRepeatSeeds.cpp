@@ -0,0 +1,169 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+
+#include "RegistryName.hh"
+#include "testMergeRepeatSeeds.hh"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( TestMergeRepeatSeeds, registryName("MergeRepeatSeeds"));
+
+typedef isaac::alignment::Seed<isaac::oligo::KmerType> SeedT;
+typedef vector<SeedT>::iterator SeedIterator;
+typedef vector<pair<isaac::oligo::KmerType, unsigned long> > SeedValues;
+
+void TestMergeRepeatSeeds::setUp()
+{
+    // barcode b maps to reference b
+    barcodeMetadataList.clear();
+    for (unsigned barcode = 0; 3 != barcode; ++barcode)
+    {
+        barcodeMetadataList.push_back(isaac::flowcell::BarcodeMetadata::constructNoIndexBarcode(
+            "FC", 0, 1, barcode, isaac::flowcell::SequencingAdapterMetadataList()));
+        barcodeMetadataList.back().setIndex(barcode);
+    }
+}
+
+void TestMergeRepeatSeeds::tearDown()
+{
+}
+
+static SeedT makeSeed(const isaac::oligo::KmerType kmer, const unsigned barcode, const unsigned cluster)
+{
+    return SeedT(kmer, isaac::alignment::SeedId(1, barcode, cluster, 0, 0));
+}
+
+template <typename IteratorT>
+static SeedValues getSortedValues(const IteratorT begin, const IteratorT end)
+{
+    SeedValues ret;
+    for (IteratorT it = begin; end != it; ++it)
+    {
+        ret.push_back(std::make_pair(it->getKmer(), static_cast<unsigned long>(it->getSeedId())));
+    }
+    std::sort(ret.begin(), ret.end());
+    return ret;
+}
+
+/**
+ * \brief Lays the seeds out the way the seed generator leaves them after separating the repeats: the
+ *        non-repeat seeds of each reference in its range followed by the repeat seeds of all references.
+ *
+ * \param referenceSeeds    [reference][seed]
+ * \param referenceRepeats  [reference]. Number of seeds at the end of each reference list that are repeats
+ */
+static void separate(
+    const vector<vector<SeedT> > &referenceSeeds,
+    const vector<unsigned> &referenceRepeats,
+    vector<SeedT> &seeds,
+    vector<SeedIterator> &referenceSeedBounds,
+    SeedIterator &repeatSeedsEnd)
+{
+    vector<SeedT> repeats;
+    seeds.clear();
+    seeds.reserve(1000);
+    vector<std::size_t> bounds;
+    for (unsigned reference = 0; referenceSeeds.size() != reference; ++reference)
+    {
+        const vector<SeedT> &all = referenceSeeds.at(reference);
+        seeds.insert(seeds.end(), all.begin(), all.end() - referenceRepeats.at(reference));
+        repeats.insert(repeats.begin(), all.end() - referenceRepeats.at(reference), all.end());
+        bounds.push_back(seeds.size());
+    }
+    seeds.insert(seeds.end(), repeats.begin(), repeats.end());
+    referenceSeedBounds.clear();
+    for (unsigned reference = 0; bounds.size() != reference; ++reference)
+    {
+        referenceSeedBounds.push_back(seeds.begin() + bounds.at(reference));
+    }
+    repeatSeedsEnd = seeds.end();
+}
+
+static void checkMerged(
+    const vector<vector<SeedT> > &referenceSeeds,
+    vector<SeedT> &seeds,
+    const vector<SeedIterator> &referenceSeedBounds)
+{
+    CPPUNIT_ASSERT_EQUAL(referenceSeeds.size(), referenceSeedBounds.size());
+    CPPUNIT_ASSERT(seeds.end() == referenceSeedBounds.back());
+    SeedIterator referenceSeedsBegin = seeds.begin();
+    for (unsigned reference = 0; referenceSeeds.size() != reference; ++reference)
+    {
+        const vector<SeedT> &expected = referenceSeeds.at(reference);
+        // every seed of the reference, including the repeat ones, is back in the reference range
+        CPPUNIT_ASSERT(getSortedValues(expected.begin(), expected.end()) ==
+                       getSortedValues(referenceSeedsBegin, referenceSeedBounds.at(reference)));
+        referenceSeedsBegin = referenceSeedBounds.at(reference);
+    }
+}
+
+void TestMergeRepeatSeeds::testSingleReference()
+{
+    vector<vector<SeedT> > referenceSeeds(1);
+    for (unsigned cluster = 0; 10 != cluster; ++cluster)
+    {
+        referenceSeeds.at(0).push_back(makeSeed(cluster * 7, 0, cluster));
+    }
+    vector<SeedT> seeds;
+    vector<SeedIterator> referenceSeedBounds;
+    SeedIterator repeatSeedsEnd;
+    separate(referenceSeeds, vector<unsigned>(1, 4), seeds, referenceSeedBounds, repeatSeedsEnd);
+    CPPUNIT_ASSERT_EQUAL(6L, referenceSeedBounds.back() - seeds.begin());
+
+    isaac::alignment::mergeRepeatSeeds<isaac::oligo::KmerType>(barcodeMetadataList, repeatSeedsEnd, referenceSeedBounds);
+    checkMerged(referenceSeeds, seeds, referenceSeedBounds);
+}
+
+void TestMergeRepeatSeeds::testMultipleReferences()
+{
+    vector<vector<SeedT> > referenceSeeds(3);
+    const unsigned referenceSeedCounts[] = {5, 4, 3};
+    for (unsigned reference = 0; referenceSeeds.size() != reference; ++reference)
+    {
+        for (unsigned cluster = 0; referenceSeedCounts[reference] != cluster; ++cluster)
+        {
+            referenceSeeds.at(reference).push_back(makeSeed(1000 - cluster * 3 - reference, reference, cluster));
+        }
+    }
+    const unsigned repeats[] = {2, 3, 1};
+    vector<SeedT> seeds;
+    vector<SeedIterator> referenceSeedBounds;
+    SeedIterator repeatSeedsEnd;
+    separate(referenceSeeds, vector<unsigned>(repeats, repeats + 3), seeds, referenceSeedBounds, repeatSeedsEnd);
+
+    isaac::alignment::mergeRepeatSeeds<isaac::oligo::KmerType>(barcodeMetadataList, repeatSeedsEnd, referenceSeedBounds);
+    checkMerged(referenceSeeds, seeds, referenceSeedBounds);
+}
+
+void TestMergeRepeatSeeds::testNoRepeats()
+{
+    vector<vector<SeedT> > referenceSeeds(3);
+    for (unsigned reference = 0; referenceSeeds.size() != reference; ++reference)
+    {
+        referenceSeeds.at(reference).push_back(makeSeed(reference, reference, 0));
+    }
+    // reference 1 has no seeds at all
+    referenceSeeds.at(1).clear();
+    vector<SeedT> seeds;
+    vector<SeedIterator> referenceSeedBounds;
+    SeedIterator repeatSeedsEnd;
+    separate(referenceSeeds, vector<unsigned>(3, 0), seeds, referenceSeedBounds, repeatSeedsEnd);
+    const vector<SeedT> before = seeds;
+
+    isaac::alignment::mergeRepeatSeeds<isaac::oligo::KmerType>(barcodeMetadataList, repeatSeedsEnd, referenceSeedBounds);
+    checkMerged(referenceSeeds, seeds, referenceSeedBounds);
+    CPPUNIT_ASSERT(getSortedValues(seeds.begin(), seeds.end()) == getSortedValues(before.begin(), before.end()));
+}
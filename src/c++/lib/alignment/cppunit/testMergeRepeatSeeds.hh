@@ -0,0 +1,38 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#ifndef iSAAC_ALIGNMENT_TEST_MERGE_REPEAT_SEEDS_HH
+#define iSAAC_ALIGNMENT_TEST_MERGE_REPEAT_SEEDS_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "alignment/SeedGeneratorBase.hh"
+
+class TestMergeRepeatSeeds : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( TestMergeRepeatSeeds );
+    CPPUNIT_TEST( testSingleReference );
+    CPPUNIT_TEST( testMultipleReferences );
+    CPPUNIT_TEST( testNoRepeats );
+    CPPUNIT_TEST_SUITE_END();
+private:
+    isaac::flowcell::BarcodeMetadataList barcodeMetadataList;
+public:
+    void setUp();
+    void tearDown();
+    void testSingleReference();
+    void testMultipleReferences();
+    void testNoRepeats();
+};
+
+#endif // #ifndef iSAAC_ALIGNMENT_TEST_MERGE_REPEAT_SEEDS_HH
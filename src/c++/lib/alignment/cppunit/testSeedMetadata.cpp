@@ -0,0 +1,98 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#include <vector>
+#include <boost/assign.hpp>
+
+using namespace std;
+
+#include "RegistryName.hh"
+#include "testSeedMetadata.hh"
+#include "BuilderInit.hh"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( TestSeedMetadata, registryName("SeedMetadata"));
+
+using isaac::alignment::SeedMetadata;
+
+TestSeedMetadata::TestSeedMetadata() :
+    // read 0 has few seeds, read 1 has many
+    readMetadataList(getReadMetadataList(100, 150)),
+    seedMetadataList(boost::assign::list_of
+        (SeedMetadata(0, 32, 0, 0))
+        (SeedMetadata(32, 32, 0, 1))
+        (SeedMetadata(0, 32, 1, 2))
+        (SeedMetadata(16, 32, 1, 3))
+        (SeedMetadata(32, 32, 1, 4))
+        (SeedMetadata(48, 32, 1, 5))
+        (SeedMetadata(64, 32, 1, 6))
+        (SeedMetadata(96, 32, 1, 7)).convert_to_container<isaac::alignment::SeedMetadataList>())
+{
+}
+
+void TestSeedMetadata::setUp()
+{
+}
+
+void TestSeedMetadata::tearDown()
+{
+}
+
+void TestSeedMetadata::testTwoIterations()
+{
+    // the first seed of each read goes to the first iteration, all the rest to the second
+    const vector<vector<unsigned> > iterations =
+        isaac::alignment::getSeedIndexListPerIteration(readMetadataList, seedMetadataList, 1, 2);
+    CPPUNIT_ASSERT_EQUAL(size_t(2), iterations.size());
+    CPPUNIT_ASSERT(iterations.at(0) == boost::assign::list_of(0)(2).convert_to_container<vector<unsigned> >());
+    CPPUNIT_ASSERT(iterations.at(1) == boost::assign::list_of(1)(3)(4)(5)(6)(7).convert_to_container<vector<unsigned> >());
+}
+
+void TestSeedMetadata::testFewAndManySeeds()
+{
+    const vector<vector<unsigned> > iterations =
+        isaac::alignment::getSeedIndexListPerIteration(readMetadataList, seedMetadataList, 1, 4);
+    CPPUNIT_ASSERT_EQUAL(size_t(4), iterations.size());
+    CPPUNIT_ASSERT(iterations.at(0) == boost::assign::list_of(0)(2).convert_to_container<vector<unsigned> >());
+    // the read with many seeds gets one seed in each intermediate iteration
+    CPPUNIT_ASSERT(iterations.at(1) == boost::assign::list_of(3).convert_to_container<vector<unsigned> >());
+    CPPUNIT_ASSERT(iterations.at(2) == boost::assign::list_of(4).convert_to_container<vector<unsigned> >());
+    // the read with few seeds skips the intermediate iterations and gets the neighbor and no-match pass
+    // with its second seed. The read with many seeds gets its remaining seeds there
+    CPPUNIT_ASSERT(iterations.at(3) == boost::assign::list_of(1)(5)(6)(7).convert_to_container<vector<unsigned> >());
+
+    // with two first-pass seeds the read with few seeds is complete after the first iteration
+    const vector<vector<unsigned> > twoFirstPass =
+        isaac::alignment::getSeedIndexListPerIteration(readMetadataList, seedMetadataList, 2, 4);
+    CPPUNIT_ASSERT_EQUAL(size_t(4), twoFirstPass.size());
+    CPPUNIT_ASSERT(twoFirstPass.at(0) == boost::assign::list_of(0)(1)(2)(3).convert_to_container<vector<unsigned> >());
+    CPPUNIT_ASSERT(twoFirstPass.at(1) == boost::assign::list_of(4).convert_to_container<vector<unsigned> >());
+    CPPUNIT_ASSERT(twoFirstPass.at(2) == boost::assign::list_of(5).convert_to_container<vector<unsigned> >());
+    CPPUNIT_ASSERT(twoFirstPass.at(3) == boost::assign::list_of(6)(7).convert_to_container<vector<unsigned> >());
+}
+
+void TestSeedMetadata::testEmptyIterations()
+{
+    // only the read with few seeds. The intermediate iterations get nothing and are removed
+    const isaac::alignment::SeedMetadataList fewSeeds(seedMetadataList.begin(), seedMetadataList.begin() + 2);
+    const vector<vector<unsigned> > iterations =
+        isaac::alignment::getSeedIndexListPerIteration(readMetadataList, fewSeeds, 1, 4);
+    CPPUNIT_ASSERT_EQUAL(size_t(2), iterations.size());
+    CPPUNIT_ASSERT(iterations.at(0) == boost::assign::list_of(0).convert_to_container<vector<unsigned> >());
+    CPPUNIT_ASSERT(iterations.at(1) == boost::assign::list_of(1).convert_to_container<vector<unsigned> >());
+
+    // all seeds fit in the first pass
+    const vector<vector<unsigned> > single =
+        isaac::alignment::getSeedIndexListPerIteration(readMetadataList, fewSeeds, 2, 4);
+    CPPUNIT_ASSERT_EQUAL(size_t(1), single.size());
+    CPPUNIT_ASSERT(single.at(0) == boost::assign::list_of(0)(1).convert_to_container<vector<unsigned> >());
+}
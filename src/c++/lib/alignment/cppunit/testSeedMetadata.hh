@@ -0,0 +1,40 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#ifndef iSAAC_ALIGNMENT_TEST_SEED_METADATA_HH
+#define iSAAC_ALIGNMENT_TEST_SEED_METADATA_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "alignment/SeedMetadata.hh"
+
+class TestSeedMetadata : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( TestSeedMetadata );
+    CPPUNIT_TEST( testTwoIterations );
+    CPPUNIT_TEST( testFewAndManySeeds );
+    CPPUNIT_TEST( testEmptyIterations );
+    CPPUNIT_TEST_SUITE_END();
+private:
+    const isaac::flowcell::ReadMetadataList readMetadataList;
+    const isaac::alignment::SeedMetadataList seedMetadataList;
+public:
+    TestSeedMetadata();
+    void setUp();
+    void tearDown();
+    void testTwoIterations();
+    void testFewAndManySeeds();
+    void testEmptyIterations();
+};
+
+#endif // #ifndef iSAAC_ALIGNMENT_TEST_SEED_METADATA_HH
@@ -72,7 +72,7 @@ TestSemialignedClipper::TestSemialignedClipper() :
     seedMetadataList(getSeedMetadataList()),
     flowcells(1, isaac::flowcell::Layout("", isaac::flowcell::Layout::Fastq, false, 8, std::vector<unsigned>(),
                                          readMetadataList, seedMetadataList, "blah")),
-    ungappedAligner_(ELAND_MATCH_SCORE, ELAND_MISMATCH_SCORE, ELAND_GAP_OPEN_SCORE, ELAND_GAP_EXTEND_SCORE, ELAND_MIN_GAP_EXTEND_SCORE)
+    ungappedAligner_(ELAND_MATCH_SCORE, ELAND_MISMATCH_SCORE, ELAND_GAP_OPEN_SCORE, ELAND_GAP_EXTEND_SCORE, ELAND_MIN_GAP_EXTEND_SCORE, false)
 {
 
 }
@@ -26,6 +26,7 @@ using namespace std;
 #include "testShadowAligner.hh"
 #include "BuilderInit.hh"
 #include "alignment/TemplateLengthStatistics.hh"
+#include "oligo/KmerGenerator.hpp"
 
 CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( TestShadowAligner, registryName("ShadowAligner"));
 
@@ -61,7 +62,7 @@ void TestShadowAligner::testRescueShadowShortest()
     using isaac::alignment::FragmentMetadata;
     using isaac::alignment::BandedSmithWaterman;
 
-    ShadowAligner shadowAligner(flowcells, 8, false, ELAND_MATCH_SCORE, ELAND_MISMATCH_SCORE, ELAND_GAP_OPEN_SCORE, ELAND_GAP_EXTEND_SCORE, ELAND_MIN_GAP_EXTEND_SCORE);
+    ShadowAligner shadowAligner(flowcells, 8, false, ELAND_MATCH_SCORE, ELAND_MISMATCH_SCORE, ELAND_GAP_OPEN_SCORE, ELAND_GAP_EXTEND_SCORE, ELAND_MIN_GAP_EXTEND_SCORE, false);
     {
         const TemplateLengthStatistics tls(200, 400, 312, 38, 26, TemplateLengthStatistics::FRp, TemplateLengthStatistics::RFm, -1);
         const std::vector<char> bcl0(getBcl(readMetadataList, contigList, 0, 0, 0, false, true));
@@ -160,7 +161,7 @@ void TestShadowAligner::testRescueShadowLongest()
     using isaac::alignment::FragmentMetadata;
     using isaac::alignment::BandedSmithWaterman;
 
-    ShadowAligner shadowAligner(flowcells, 8, false, ELAND_MATCH_SCORE, ELAND_MISMATCH_SCORE, ELAND_GAP_OPEN_SCORE, ELAND_GAP_EXTEND_SCORE, ELAND_MIN_GAP_EXTEND_SCORE);
+    ShadowAligner shadowAligner(flowcells, 8, false, ELAND_MATCH_SCORE, ELAND_MISMATCH_SCORE, ELAND_GAP_OPEN_SCORE, ELAND_GAP_EXTEND_SCORE, ELAND_MIN_GAP_EXTEND_SCORE, false);
     {
         const TemplateLengthStatistics tls(200, 400, 312, 38, 26, TemplateLengthStatistics::FRp, TemplateLengthStatistics::RFm, -1);
         const std::vector<char> bcl0(getBcl(readMetadataList, contigList, 4, 0, 12, false, true));
@@ -250,3 +251,96 @@ void TestShadowAligner::testRescueShadowLongest()
         // check the position, mismatches and log probability
     }
 }
+
+/**
+ * \brief Straightforward candidate search with oligo::KmerGenerator, the way it was done before the
+ *        reference k-mers were cached.
+ */
+static std::vector<long> findCandidatePositions(
+    const std::vector<char> &reference,
+    const long referenceBegin,
+    const long referenceEnd,
+    const std::vector<char> &shadowSequence)
+{
+    static const unsigned kmerLength = 7;
+    static const std::size_t candidatesMax = 10000;
+    std::vector<long> ret;
+    if (referenceEnd - referenceBegin < long(kmerLength))
+    {
+        return ret;
+    }
+    std::vector<int> shadowKmerPositions(1 << (2 * kmerLength), -1);
+    isaac::oligo::KmerGenerator<unsigned> shadowKmers(shadowSequence.begin(), shadowSequence.end(), kmerLength);
+    unsigned kmer = 0;
+    std::vector<char>::const_iterator position;
+    while (shadowKmers.next(kmer, position))
+    {
+        if (-1 == shadowKmerPositions[kmer])
+        {
+            shadowKmerPositions[kmer] = position - shadowSequence.begin();
+        }
+    }
+
+    const std::vector<char>::const_iterator rangeBegin = reference.begin() + referenceBegin;
+    isaac::oligo::KmerGenerator<unsigned> referenceKmers(rangeBegin, reference.begin() + referenceEnd, kmerLength);
+    while (referenceKmers.next(kmer, position))
+    {
+        if (-1 != shadowKmerPositions[kmer])
+        {
+            const long candidatePosition = position - rangeBegin - shadowKmerPositions[kmer];
+            if (ret.empty() || ret.back() != candidatePosition)
+            {
+                if (candidatesMax == ret.size())
+                {
+                    break;
+                }
+                ret.push_back(candidatePosition);
+            }
+        }
+    }
+    std::sort(ret.begin(), ret.end());
+    ret.erase(std::unique(ret.begin(), ret.end()), ret.end());
+    return ret;
+}
+
+void TestShadowAligner::testCandidatePositions()
+{
+    using isaac::alignment::ShadowAligner;
+    ShadowAligner shadowAligner(flowcells, 8, false, ELAND_MATCH_SCORE, ELAND_MISMATCH_SCORE, ELAND_GAP_OPEN_SCORE, ELAND_GAP_EXTEND_SCORE, ELAND_MIN_GAP_EXTEND_SCORE, false);
+
+    // low complexity reference with N stretches, IUPAC codes and soft-masked bases
+    static const char bases[] = "ACGTACGTACGTacgtNRYKMSWN";
+    std::srand(7);
+    std::vector<char> reference(30000);
+    BOOST_FOREACH(char &base, reference)
+    {
+        base = bases[std::rand() % (std::rand() % 5 ? 12 : sizeof(bases) - 1)];
+    }
+    std::fill(reference.begin() + 1000, reference.begin() + 1100, 'N');
+
+    for (unsigned test = 0; 200 != test; ++test)
+    {
+        // shadows come from the reference, including the N and IUPAC bases
+        const long shadowBegin = std::rand() % (reference.size() - 100);
+        std::vector<char> shadow(reference.begin() + shadowBegin, reference.begin() + shadowBegin + 92);
+        shadow.at(std::rand() % shadow.size()) = 'A';
+
+        const long widths[] = {3, 7, 8, 15, 16, 17, 400, 1234, 10000, 10001, 25000};
+        const long width = widths[test % (sizeof(widths) / sizeof(widths[0]))];
+        const long begin = std::rand() % (reference.size() - width);
+        const long end = begin + width;
+        CPPUNIT_ASSERT(findCandidatePositions(reference, begin, end, shadow) ==
+                       shadowAligner.findShadowCandidatePositions(reference, begin, end, shadow));
+
+        // sub-range of the cached one
+        const long subBegin = begin + width / 3;
+        const long subEnd = end - width / 4;
+        CPPUNIT_ASSERT(findCandidatePositions(reference, subBegin, subEnd, shadow) ==
+                       shadowAligner.findShadowCandidatePositions(reference, subBegin, subEnd, shadow));
+    }
+
+    // the whole reference region of N
+    const std::vector<char> shadow(reference.begin() + 2000, reference.begin() + 2092);
+    CPPUNIT_ASSERT(shadowAligner.findShadowCandidatePositions(reference, 1000, 1100, shadow).empty());
+    CPPUNIT_ASSERT(!shadowAligner.findShadowCandidatePositions(reference, 1950, 2150, shadow).empty());
+}
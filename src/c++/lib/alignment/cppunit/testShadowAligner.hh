@@ -26,6 +26,7 @@ class TestShadowAligner : public CppUnit::TestFixture
     CPPUNIT_TEST_SUITE( TestShadowAligner );
     CPPUNIT_TEST( testRescueShadowShortest );
     CPPUNIT_TEST( testRescueShadowLongest );
+    CPPUNIT_TEST( testCandidatePositions );
     CPPUNIT_TEST_SUITE_END();
 private:
     const std::vector<isaac::flowcell::ReadMetadata> readMetadataList;
@@ -37,6 +38,7 @@ public:
     void tearDown();
     void testRescueShadowShortest();
     void testRescueShadowLongest();
+    void testCandidatePositions();
 };
 
 #endif // #ifndef iSAAC_ALIGNMENT_TEST_SHADOW_ALIGNER_HH
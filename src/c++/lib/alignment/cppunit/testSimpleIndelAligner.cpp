@@ -156,7 +156,7 @@ class TestAligner : public isaac::alignment::fragmentBuilder::SimpleIndelAligner
 {
 public:
     TestAligner() : isaac::alignment::fragmentBuilder::SimpleIndelAligner(
-        MATCH_SCORE, MISMATCH_SCORE, GAP_OPEN_SCORE, GAP_EXTEND_SCORE, MIN_GAP_EXTEND_SCORE, 20000){}
+        MATCH_SCORE, MISMATCH_SCORE, GAP_OPEN_SCORE, GAP_EXTEND_SCORE, MIN_GAP_EXTEND_SCORE, false, 20000){}
 
 
     unsigned updateFragmentCigar(
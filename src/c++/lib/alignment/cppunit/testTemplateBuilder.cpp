@@ -154,7 +154,7 @@ void TestTemplateBuilder::testEmptyMatchList()
     using isaac::alignment::BandedSmithWaterman;
     std::auto_ptr<TemplateBuilder> templateBuilder(new TemplateBuilder(flowcells, 10, 4, false, 8, false,
                                                                        ELAND_MATCH_SCORE, ELAND_MISMATCH_SCORE, ELAND_GAP_OPEN_SCORE, ELAND_GAP_EXTEND_SCORE,
-                                                                       ELAND_MIN_GAP_EXTEND_SCORE, 20000,
+                                                                       ELAND_MIN_GAP_EXTEND_SCORE, false, 20000,
                                                                        TemplateBuilder::DODGY_ALIGNMENT_SCORE_UNALIGNED));
     const BamTemplate &bamTemplate = templateBuilder->getBamTemplate();
     CPPUNIT_ASSERT_EQUAL(0U, bamTemplate.getFragmentCount());
@@ -184,7 +184,7 @@ void TestTemplateBuilder::testOrphan()
     using isaac::alignment::BandedSmithWaterman;
     std::auto_ptr<TemplateBuilder> templateBuilder(new TemplateBuilder(flowcells, 10, 4, false, 8, false,
                                                                        ELAND_MATCH_SCORE, ELAND_MISMATCH_SCORE, ELAND_GAP_OPEN_SCORE, ELAND_GAP_EXTEND_SCORE,
-                                                                       ELAND_MIN_GAP_EXTEND_SCORE, 20000,
+                                                                       ELAND_MIN_GAP_EXTEND_SCORE, false, 20000,
                                                                        TemplateBuilder::DODGY_ALIGNMENT_SCORE_UNALIGNED));
     const BamTemplate &bamTemplate = templateBuilder->getBamTemplate();
     std::vector<std::vector<FragmentMetadata> > fragments(2);
@@ -235,7 +235,7 @@ void TestTemplateBuilder::testUnique()
     using isaac::alignment::BandedSmithWaterman;
     std::auto_ptr<TemplateBuilder> templateBuilder(new TemplateBuilder(flowcells, 10, 4, false, 8, false,
                                                                        ELAND_MATCH_SCORE, ELAND_MISMATCH_SCORE, ELAND_GAP_OPEN_SCORE, ELAND_GAP_EXTEND_SCORE,
-                                                                       ELAND_MIN_GAP_EXTEND_SCORE, 20000,
+                                                                       ELAND_MIN_GAP_EXTEND_SCORE, false, 20000,
                                                                        TemplateBuilder::DODGY_ALIGNMENT_SCORE_UNALIGNED));
     const BamTemplate &bamTemplate = templateBuilder->getBamTemplate();
     std::vector<std::vector<FragmentMetadata> > fragments(2);
@@ -288,7 +288,7 @@ void TestTemplateBuilder::testMultiple()
     using isaac::alignment::BandedSmithWaterman;
     std::auto_ptr<TemplateBuilder> templateBuilder(new TemplateBuilder(flowcells, 10, 4, false, 8, false,
                                                                        ELAND_MATCH_SCORE, ELAND_MISMATCH_SCORE, ELAND_GAP_OPEN_SCORE, ELAND_GAP_EXTEND_SCORE,
-                                                                       ELAND_MIN_GAP_EXTEND_SCORE, 20000,
+                                                                       ELAND_MIN_GAP_EXTEND_SCORE, false, 20000,
                                                                        TemplateBuilder::DODGY_ALIGNMENT_SCORE_UNALIGNED));
     const BamTemplate &bamTemplate = templateBuilder->getBamTemplate();
 
@@ -21,6 +21,7 @@
 
 #include "alignment/fragmentBuilder/AlignerBase.hh"
 #include "alignment/Alignment.hh"
+#include "alignment/Quality.hh"
 
 namespace isaac
 {
@@ -34,14 +35,68 @@ AlignerBase::AlignerBase(
     const int gapMismatchScore,
     const int gapOpenScore,
     const int gapExtendScore,
-    const int minGapExtendScore)
+    const int minGapExtendScore,
+    const bool fixedPointScoring)
     : normalizedMismatchScore_(gapMatchScore - gapMismatchScore)
     , normalizedGapOpenScore_(gapMatchScore - gapOpenScore)
     , normalizedGapExtendScore_(gapMatchScore - gapExtendScore)
     , normalizedMaxGapExtendScore_(-minGapExtendScore)
+    , fixedPointScoring_(fixedPointScoring)
 {
 }
 
+unsigned AlignerBase::scoreAlignedBasesFixedPoint(
+    const std::vector<char> &sequence,
+    const std::vector<char> &quality,
+    const unsigned firstBase,
+    std::vector<char>::const_iterator reference,
+    const unsigned length,
+    const unsigned firstCycle,
+    const unsigned lastCycle,
+    FragmentMetadata &fragmentMetadata,
+    long &fixedLogProbability) const
+{
+    static const unsigned BASES_AT_A_TIME = 16;
+    const bool reverse = fragmentMetadata.reverse;
+    unsigned matchCount = 0;
+    // offset of the first base after the last mismatch
+    unsigned matchesBegin = 0;
+    for (unsigned offset = 0; length > offset; offset += BASES_AT_A_TIME)
+    {
+        const unsigned chunk = std::min(BASES_AT_A_TIME, length - offset);
+        const char *chunkSequence = &sequence[firstBase + offset];
+        const char *chunkQuality = &quality[firstBase + offset];
+        unsigned editMask = 0;
+        unsigned mismatchMask = BASES_AT_A_TIME == chunk ?
+            compareBases16(chunkSequence, &*reference + offset, editMask) :
+            compareBases(chunkSequence, &*reference + offset, chunk, editMask);
+
+        // the quality lookups don't vectorize with SSE2. Keep them branchless.
+        int chunkLogProbability = 0;
+        for (unsigned i = 0; chunk > i; ++i)
+        {
+            chunkLogProbability += Quality::getFixedLogProbability(chunkQuality[i], (mismatchMask >> i) & 1);
+        }
+        fixedLogProbability += chunkLogProbability;
+        fragmentMetadata.editDistance += __builtin_popcount(editMask);
+        matchCount += chunk - __builtin_popcount(mismatchMask);
+
+        // mismatches are rare. Visit them only.
+        while (mismatchMask)
+        {
+            const unsigned mismatchOffset = offset + __builtin_ctz(mismatchMask);
+            mismatchMask &= mismatchMask - 1;
+            fragmentMetadata.matchesInARow = std::max(fragmentMetadata.matchesInARow, mismatchOffset - matchesBegin);
+            matchesBegin = mismatchOffset + 1;
+            const unsigned currentBase = firstBase + mismatchOffset;
+            fragmentMetadata.addMismatchCycle(reverse ? lastCycle - currentBase : firstCycle + currentBase);
+            fragmentMetadata.smithWatermanScore += normalizedMismatchScore_;
+        }
+    }
+    fragmentMetadata.matchesInARow = std::max(fragmentMetadata.matchesInARow, length - matchesBegin);
+    return matchCount;
+}
+
 /**
  * \brief Adjusts the sequence iterators to stay within the reference. Adjusts sequenceBeginReferencePosition
  *        to point at the first not clipped base.
@@ -148,12 +203,21 @@ unsigned AlignerBase::updateFragmentCigar(
 
     unsigned currentBase = 0;
     unsigned matchCount = 0;
+    long fixedLogProbability = 0;
     for (unsigned i = 0; fragmentMetadata.cigarLength > i; ++i)
     {
         const std::pair<unsigned, Cigar::OpCode> cigar = Cigar::decode(cigarBuffer[fragmentMetadata.cigarOffset + i]);
         const unsigned length = cigar.first;
         const Cigar::OpCode opCode = cigar.second;
-        if (opCode == Cigar::ALIGN)
+        if (opCode == Cigar::ALIGN && fixedPointScoring_)
+        {
+            matchCount += scoreAlignedBasesFixedPoint(
+                sequence, quality, currentBase, currentReference, length, firstCycle, lastCycle,
+                fragmentMetadata, fixedLogProbability);
+            currentReference += length;
+            currentBase += length;
+        }
+        else if (opCode == Cigar::ALIGN)
         {
             unsigned matchesInARow = 0;
             for (unsigned j = 0; length > j; ++j)
@@ -200,13 +264,23 @@ unsigned AlignerBase::updateFragmentCigar(
         {
             ISAAC_ASSERT_MSG(0 == i || i + 1 == fragmentMetadata.cigarLength, "Soft clippings are expected to be "
                 "found only at the ends of cigar string");
-            using boost::lambda::bind;
-            using boost::lambda::_1;
-            using boost::lambda::_2;
-            fragmentMetadata.logProbability =
-                std::accumulate(quality.begin() + currentBase, quality.begin() + currentBase + length,
-                                fragmentMetadata.logProbability,
-                                bind(std::plus<double>(), _1, bind(Quality::getLogMatch, _2)));
+            if (fixedPointScoring_)
+            {
+                for (unsigned j = 0; length > j; ++j)
+                {
+                    fixedLogProbability += Quality::getFixedLogProbability(quality[currentBase + j], false);
+                }
+            }
+            else
+            {
+                using boost::lambda::bind;
+                using boost::lambda::_1;
+                using boost::lambda::_2;
+                fragmentMetadata.logProbability =
+                    std::accumulate(quality.begin() + currentBase, quality.begin() + currentBase + length,
+                                    fragmentMetadata.logProbability,
+                                    bind(std::plus<double>(), _1, bind(Quality::getLogMatch, _2)));
+            }
 
             // NOTE! Not advancing the reference for soft clips
             currentBase += length;
@@ -218,6 +292,10 @@ unsigned AlignerBase::updateFragmentCigar(
             BOOST_THROW_EXCEPTION(common::PostConditionException(message.str()));
         }
     }
+    if (fixedPointScoring_)
+    {
+        fragmentMetadata.logProbability += Quality::fixedToLogProbability(fixedLogProbability);
+    }
     fragmentMetadata.observedLength = currentReference - reference.begin() - strandPosition;
     fragmentMetadata.position = strandPosition;
     ISAAC_ASSERT_MSG(currentBase == sequence.size(),
@@ -35,8 +35,9 @@ GappedAligner::GappedAligner(
     const int gapMismatchScore,
     const int gapOpenScore,
     const int gapExtendScore,
-    const int minGapExtendScore)
-    : AlignerBase(gapMatchScore, gapMismatchScore, gapOpenScore, gapExtendScore, minGapExtendScore)
+    const int minGapExtendScore,
+    const bool fixedPointScoring)
+    : AlignerBase(gapMatchScore, gapMismatchScore, gapOpenScore, gapExtendScore, minGapExtendScore, fixedPointScoring)
     , avoidSmithWaterman_(avoidSmithWaterman)
     , bandedSmithWaterman_(gapMatchScore, gapMismatchScore, -gapOpenScore, -gapExtendScore,
                            flowcell::getMaxTotalReadLength(flowcellLayoutList))
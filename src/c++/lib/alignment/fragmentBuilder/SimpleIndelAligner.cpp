@@ -34,8 +34,9 @@ SimpleIndelAligner::SimpleIndelAligner(
     const int gapOpenScore,
     const int gapExtendScore,
     const int minGapExtendScore,
+    const bool fixedPointScoring,
     const unsigned semialignedGapLimit)
-    : AlignerBase(gapMatchScore, gapMismatchScore, gapOpenScore, gapExtendScore, minGapExtendScore)
+    : AlignerBase(gapMatchScore, gapMismatchScore, gapOpenScore, gapExtendScore, minGapExtendScore, fixedPointScoring)
     , semialignedGapLimit_(semialignedGapLimit)
 {
 }
@@ -31,8 +31,9 @@ UngappedAligner::UngappedAligner(
     const int gapMismatchScore,
     const int gapOpenScore,
     const int gapExtendScore,
-    const int minGapExtendScore)
-    : AlignerBase(gapMatchScore, gapMismatchScore, gapOpenScore, gapExtendScore, minGapExtendScore)
+    const int minGapExtendScore,
+    const bool fixedPointScoring)
+    : AlignerBase(gapMatchScore, gapMismatchScore, gapOpenScore, gapExtendScore, minGapExtendScore, fixedPointScoring)
 {
 }
 
@@ -87,6 +87,7 @@ void ExactMaskMatcher<KmerT>::matchMask(
     MatchDistribution &matchDistribution,
     std::vector<ReferenceKmerT> &threadRepeatList,
     io::TileMatchWriter &matchWriter,
+    const reference::MaskPrefixIndex &prefixIndex,
     std::istream &reference)
 {
     const clock_t start = clock();
@@ -94,6 +95,7 @@ void ExactMaskMatcher<KmerT>::matchMask(
     unsigned matchCounters[] = {0, 0};
     unsigned repeatCounters[] = {0, 0};
     unsigned highRepeatCounters[] = {0, 0};
+    std::size_t skippedRecords = 0;
     // all memory reservation must have been done outside the threaded code
     assert(threadRepeatList.capacity() >= repeatThreshold_ + 1);
     SeedIterator nextSeed = beginSeeds;
@@ -109,6 +111,10 @@ void ExactMaskMatcher<KmerT>::matchMask(
             ++nextSeed;
         }
         // discard reference positions with smaller k-mer
+        if (reference && currentSeed->getKmer() > nextReference.getKmer())
+        {
+            skippedRecords += prefixIndex.skipTo(currentSeed->getKmer(), reference, nextReference);
+        }
         while (reference && currentSeed->getKmer() > nextReference.getKmer())
         {
             reference.read(readBuffer, sizeof(nextReference));
@@ -193,6 +199,7 @@ void ExactMaskMatcher<KmerT>::matchMask(
         " high repeats (" << highRepeatCounters[0] << " forward, " << highRepeatCounters[1] << " reverse)"
         " for mask " << mask <<
         " and " << (endSeeds - beginSeeds) << " kmers"
+        " skipped at least " << skippedRecords << " reference records"
         " in range [" << oligo::Bases<oligo::BITS_PER_BASE, KmerT>(beginSeeds->getKmer(), oligo::KmerTraits<KmerT>::KMER_BASES) <<
         "," << (beginSeeds == endSeeds ?
             oligo::Bases<oligo::BITS_PER_BASE, KmerT>(beginSeeds->getKmer(), oligo::KmerTraits<KmerT>::KMER_BASES) :
@@ -116,11 +116,13 @@ void NeighborMaskMatcher<KmerT>::matchNeighborsMask(
     std::vector<ReferenceKmerT> &threadRepeatList,
     std::vector<ReferenceKmerT> &threadNeighborsList,
     io::TileMatchWriter &matchWriter,
+    const reference::MaskPrefixIndex &prefixIndex,
     std::istream &reference)
 {
     const clock_t start = clock();
     ISAAC_THREAD_CERR << "Finding neighbors matches for mask " << mask << std::endl;
     unsigned matchCounters[] = {0, 0};
+    std::size_t skippedRecords = 0;
     // all memory reservation must have been done outside the threaded code
     assert(threadNeighborsList.capacity() >= repeatThreshold_ + 1);
     threadNeighborsList.clear();
@@ -146,6 +148,10 @@ void NeighborMaskMatcher<KmerT>::matchNeighborsMask(
                 threadNeighborsList.clear();
                 currentPrefix = nextSeed->getKmer() >> suffixBits;
                 // skip the reference position where the prefix is too small
+                if (currentPrefix > (nextReference.getKmer() >> suffixBits))
+                {
+                    skippedRecords += prefixIndex.skipTo(KmerT(currentPrefix << suffixBits), reference, nextReference);
+                }
                 while (reference && (currentPrefix > (nextReference.getKmer() >> suffixBits)))
                 {
                     reference.read(readBuffer, sizeof(nextReference));
@@ -252,6 +258,7 @@ void NeighborMaskMatcher<KmerT>::matchNeighborsMask(
         " matches (" << matchCounters[0] << " forward, " << matchCounters[1] << " reverse)"
         " for mask " << mask <<
         " and " << (endSeeds - beginSeeds) << " kmers"
+        " skipped at least " << skippedRecords << " reference records"
         " in range [" << oligo::Bases<oligo::BITS_PER_BASE, KmerT>(beginSeeds->getKmer(), oligo::KmerTraits<KmerT>::KMER_BASES) <<
         "," << std::setbase(16) << (beginSeeds == endSeeds ?
             oligo::Bases<oligo::BITS_PER_BASE, KmerT>(beginSeeds->getKmer(), oligo::KmerTraits<KmerT>::KMER_BASES) :
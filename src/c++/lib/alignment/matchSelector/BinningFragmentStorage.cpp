@@ -17,6 +17,8 @@
 
 #include <cerrno>
 #include <fstream>
+#include <numeric>
+#include <boost/bind.hpp>
 #include <boost/foreach.hpp>
 #include <boost/format.hpp>
 
@@ -33,6 +35,37 @@ namespace alignment
 namespace matchSelector
 {
 
+static const unsigned FRAGMENT_BYTES_MAX = 10*1024;
+static const unsigned TEMPLATE_BYTES_MAX = 2 * (sizeof(io::FragmentHeader) + FRAGMENT_BYTES_MAX);
+
+const unsigned BinningFragmentStorage::READS_MAX;
+const unsigned BinningFragmentStorage::STAGING_BUFFER_BYTES_DEFAULT;
+
+/**
+ * \brief Memory taken by one staging buffer. The writer scratch space takes as much as one more buffer
+ */
+unsigned long BinningFragmentStorage::getStagingBufferMemoryRequirements(const unsigned stagingBufferBytes)
+{
+    return stagingBufferBytes +
+        stagingBufferBytes / sizeof(io::FragmentHeader) * sizeof(std::pair<unsigned, unsigned>);
+}
+
+/**
+ * \return number of staging buffers to allocate. One being filled and one being written for each thread if
+ *         that fits in what the governor has left. Each thread needs at least the one it fills.
+ */
+unsigned BinningFragmentStorage::getStagingBuffers(
+    const unsigned threadBuffers,
+    const unsigned stagingBufferBytes,
+    const common::MemoryGovernor &memoryGovernor)
+{
+    const unsigned long bufferBytes = getStagingBufferMemoryRequirements(stagingBufferBytes);
+    const unsigned long capacity = memoryGovernor.getCapacity(bufferBytes);
+    // one buffer worth goes to the writer scratch space
+    const unsigned long fitting = capacity ? capacity - 1 : 0;
+    return std::min<unsigned long>(threadBuffers * 2, std::max<unsigned long>(threadBuffers, fitting));
+}
+
 BinningFragmentStorage::BinningFragmentStorage(
     const bool keepUnaligned,
     const bool preSortBins,
@@ -44,15 +77,40 @@ BinningFragmentStorage::BinningFragmentStorage(
     const flowcell::FlowcellLayoutList &flowcellLayoutList,
     const flowcell::BarcodeMetadataList &barcodeMetadataList,
     const unsigned long maxTileClusters,
-    const unsigned long totalTiles)
+    const unsigned long totalTiles,
+    const unsigned stagingBufferBytes,
+    common::MemoryGovernor &memoryGovernor)
     : keepUnaligned_(keepUnaligned)
     , maxTileReads_(maxTileClusters * READS_MAX)
+    , stagingBufferBytes_(std::max(stagingBufferBytes, TEMPLATE_BYTES_MAX))
+    , stagingBufferFragmentsMax_(std::max<unsigned>(READS_MAX, stagingBufferBytes_ / sizeof(io::FragmentHeader)))
     , binIndexMap_(matchDistribution, outputBinSize, false)
     , binPathList_(buildBinPathList(binIndexMap_, matchDistribution.getBinSize(), binDirectory,
                                     barcodeMetadataList, maxTileReads_, totalTiles, preSortBins))
     , binFiles_(binPathList_.size())
-
+    , stagingReservation_(memoryGovernor)
+    , stagingBuffers_(getStagingBuffers(threadBuffers, stagingBufferBytes_, memoryGovernor))
+    , writeQueue_(stagingBuffers_.size())
+    , writeQueueHead_(0)
+    , writeQueueSize_(0)
+    , handedOver_(0)
+    , written_(0)
+    , flushTarget_(0)
+    , writing_(false)
+    , writerFailed_(false)
+    , binFragmentOffsets_(binPathList_.size() + 1)
 {
+    ISAAC_ASSERT_MSG(threadBuffers, "At least one thread buffer is required");
+    const unsigned long stagingBytes =
+        getStagingBufferMemoryRequirements(stagingBufferBytes_) * (stagingBuffers_.size() + 1);
+    if (!stagingReservation_.tryReserve(stagingBytes))
+    {
+        BOOST_THROW_EXCEPTION(common::MemoryException((
+            boost::format("Bin staging requires %d bytes of memory for %d buffers. %d bytes available") %
+                stagingBytes % stagingBuffers_.size() % memoryGovernor.getAvailable()).str()));
+    }
+    ISAAC_THREAD_CERR << "Using " << stagingBuffers_.size() << " bin staging buffers of " <<
+        stagingBufferBytes_ << " bytes for " << threadBuffers << " threads" << std::endl;
     ISAAC_THREAD_CERR << "Resetting output files for " << binPathList_.size() << " bins" << std::endl;
 
     BOOST_FOREACH(const BinMetadata &binMetadata, binPathList_)
@@ -66,6 +124,39 @@ BinningFragmentStorage::BinningFragmentStorage(
     }
 
     ISAAC_THREAD_CERR << "Resetting output files done for " << binPathList_.size() << " bins" << std::endl;
+
+    BOOST_FOREACH(StagingBuffer &staging, stagingBuffers_)
+    {
+        staging.data_.reserve(stagingBufferBytes_);
+        staging.fragments_.reserve(stagingBufferFragmentsMax_);
+        if (threadStaging_.size() < threadBuffers)
+        {
+            threadStaging_.push_back(&staging);
+        }
+        else
+        {
+            freeBuffers_.push_back(&staging);
+        }
+    }
+    sortedFragments_.reserve(stagingBufferFragmentsMax_);
+    binChunk_.reserve(stagingBufferBytes_);
+}
+
+void BinningFragmentStorage::close(alignment::BinMetadataList &binPathList)
+{
+    prepareFlush();
+    flush();
+
+    for (std::size_t storageBin = 0; binFiles_.size() != storageBin; ++storageBin)
+    {
+        binFiles_.at(storageBin).close();
+        if (!binFiles_.at(storageBin))
+        {
+            BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to close bin file " + binPathList_.at(storageBin).getPathString()));
+        }
+    }
+
+    binPathList_.swap(binPathList);
 }
 
 alignment::BinMetadataList BinningFragmentStorage::buildBinPathList(
@@ -143,7 +234,17 @@ void storeBclAndCigar(
     }
 }
 
-static const unsigned FRAGMENT_BYTES_MAX = 10*1024;
+/**
+ * \brief Constructs the header over zeroed bytes so that the padding and the unused flag bits that go into the
+ *        bin files don't depend on what was on the stack.
+ */
+template <typename BufferT>
+static void *appendHeaderPlaceholder(BufferT &buffer)
+{
+    ISAAC_ASSERT_MSG(buffer.empty(), "Header must be the first thing in the fragment buffer");
+    buffer.resize(sizeof(io::FragmentHeader), 0);
+    return &buffer.front();
+}
 
 template <typename BufferT>
 unsigned BinningFragmentStorage::packFragment(
@@ -162,18 +263,15 @@ unsigned BinningFragmentStorage::packFragment(
     if (mate.isNoMatch() && fragment.isNoMatch())
     {
         storageBin = 0;
-        const io::FragmentHeader header(bamTemplate, fragment, mate, barcodeIdx, 0);
-        std::copy(header.bytesBegin(), header.bytesEnd(), std::back_inserter(buffer));
+        new (appendHeaderPlaceholder(buffer)) io::FragmentHeader(bamTemplate, fragment, mate, barcodeIdx, 0);
     }
     else
     {
         const unsigned mateStorageBin = binIndexMap_.getBinIndex(mate.getFStrandReferencePosition());
-        const io::FragmentHeader header(bamTemplate, fragment, mate, barcodeIdx,
-                                                          mateStorageBin);
+        const io::FragmentHeader &header = *new (appendHeaderPlaceholder(buffer)) io::FragmentHeader(
+            bamTemplate, fragment, mate, barcodeIdx, mateStorageBin);
 
         storageBin = binIndexMap_.getBinIndex(header.fStrandPosition_);
-
-        std::copy(header.bytesBegin(), header.bytesEnd(), std::back_inserter(buffer));
     }
 
 
@@ -183,18 +281,30 @@ unsigned BinningFragmentStorage::packFragment(
     return storageBin;
 }
 
-template <typename BufferT>
-void BinningFragmentStorage::storeFragment(
-    const BufferT &buffer,
-    const unsigned storageBin)
+void BinningFragmentStorage::accountFragment(
+    const io::FragmentHeader &header,
+    const unsigned long maxTileReads,
+    BinMetadata &binMetadata)
 {
-    const io::FragmentHeader &header = reinterpret_cast<const io::FragmentHeader &>(buffer.front());
-    ISAAC_ASSERT_MSG(buffer.size() == header.getTotalLength(), "buffer.size()=" << buffer.size() << " " << header);
-
-    BinMetadata &binMetadata = binPathList_.at(storageBin);
-    if (!header.isAligned() && !header.isMateAligned())
+    if (!header.flags_.paired_)
     {
-        const unsigned long globalReadId = maxTileReads_ * header.tile_ +
+        if (header.fStrandPosition_.isNoMatch())
+        {
+            const unsigned long globalReadId = maxTileReads * header.tile_ + header.clusterId_;
+            binMetadata.incrementDataSize(globalReadId, header.getTotalLength());
+            binMetadata.incrementNmElements(globalReadId, 1, header.barcode_);
+        }
+        else
+        {
+            binMetadata.incrementDataSize(header.fStrandPosition_, header.getTotalLength());
+            binMetadata.incrementSeIdxElements(header.fStrandPosition_, 1, header.barcode_);
+            binMetadata.incrementGapCount(header.fStrandPosition_, header.gapCount_, header.barcode_);
+            binMetadata.incrementCigarLength(header.fStrandPosition_, header.cigarLength_, header.barcode_);
+        }
+    }
+    else if (!header.isAligned() && !header.isMateAligned())
+    {
+        const unsigned long globalReadId = maxTileReads * header.tile_ +
             header.clusterId_ * 2 + header.flags_.secondRead_;
         binMetadata.incrementDataSize(globalReadId, header.getTotalLength());
         binMetadata.incrementNmElements(globalReadId, 1, header.barcode_);
@@ -214,86 +324,200 @@ void BinningFragmentStorage::storeFragment(
         binMetadata.incrementCigarLength(header.fStrandPosition_, header.cigarLength_, header.barcode_);
         ISAAC_ASSERT_MSG(binMetadata.getBinStart().getContigId() == header.fStrandPosition_.getContigId(), "tada: " << binMetadata << header);
     }
+}
 
-    std::ostream &osData = binFiles_.at(storageBin);
-    if (!osData.write(&buffer.front(), buffer.size())) {
-        BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to write into " + binMetadata.getPathString()));
-    }
+template <typename BufferT>
+void BinningFragmentStorage::stageFragment(
+    const BufferT &buffer,
+    const unsigned storageBin,
+    StagingBuffer &staging)
+{
+    ISAAC_ASSERT_MSG(buffer.size() == reinterpret_cast<const io::FragmentHeader &>(buffer.front()).getTotalLength(),
+                     "buffer.size()=" << buffer.size() << " " << reinterpret_cast<const io::FragmentHeader &>(buffer.front()));
+    staging.fragments_.push_back(std::make_pair(storageBin, unsigned(staging.data_.size())));
+    staging.data_.insert(staging.data_.end(), buffer.begin(), buffer.end());
 }
 
-void BinningFragmentStorage::add(const BamTemplate &bamTemplate, const unsigned barcodeIdx)
+void BinningFragmentStorage::add(const BamTemplate &bamTemplate, const unsigned barcodeIdx, const unsigned threadNumber)
 {
+    StagingBuffer *&staging = threadStaging_.at(threadNumber);
+    if (staging->data_.capacity() - staging->data_.size() < TEMPLATE_BYTES_MAX ||
+        staging->fragments_.capacity() - staging->fragments_.size() < READS_MAX)
+    {
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        handOver(staging, lock);
+    }
+
     if (2 == bamTemplate.getFragmentCount())
     {
-        storePaired(bamTemplate, barcodeIdx);
+        stagePaired(bamTemplate, barcodeIdx, *staging);
     }
     else
     {
-        storeSingle(bamTemplate, barcodeIdx);
+        stageSingle(bamTemplate, barcodeIdx, *staging);
     }
 }
 
-void BinningFragmentStorage::storeSingle(const BamTemplate &bamTemplate, const unsigned barcodeIdx)
+void BinningFragmentStorage::stageSingle(const BamTemplate &bamTemplate, const unsigned barcodeIdx, StagingBuffer &staging)
 {
     common::FiniteCapacityVector<char, sizeof(io::FragmentHeader) + FRAGMENT_BYTES_MAX> buffer;
     const alignment::FragmentMetadata &fragment = bamTemplate.getFragmentMetadata(0);
     const unsigned storageBin = fragment.isNoMatch() ? 0 : binIndexMap_.getBinIndex(fragment.getFStrandReferencePosition());
 
-    const io::FragmentHeader header(bamTemplate, fragment, barcodeIdx);
-    std::copy(header.bytesBegin(), header.bytesEnd(), std::back_inserter(buffer));
+    new (appendHeaderPlaceholder(buffer)) io::FragmentHeader(bamTemplate, fragment, barcodeIdx);
+    storeBclAndCigar(fragment, buffer);
+
+    stageFragment(buffer, storageBin, staging);
+}
+
+void BinningFragmentStorage::stagePaired(const BamTemplate &bamTemplate, const unsigned barcodeIdx, StagingBuffer &staging)
+{
+    common::FiniteCapacityVector<char, sizeof(io::FragmentHeader) + FRAGMENT_BYTES_MAX> buffer;
 
-    boost::unique_lock<boost::mutex> lock(binMutex_[storageBin % binMutex_.size()]);
+    // BinSorter requires that records follow each other if they are in the same bin. The writer
+    // keeps the staging order of the fragments within each bin.
+    const unsigned binA = packFragment(bamTemplate, 0, barcodeIdx, buffer);
+    stageFragment(buffer, binA, staging);
+    buffer.clear();
+    const unsigned binB = packFragment(bamTemplate, 1, barcodeIdx, buffer);
+    stageFragment(buffer, binB, staging);
+}
 
-    if (fragment.isNoMatch())
+/**
+ * \brief Queues the staging buffer for writing and replaces it with a free one. Drains the queue if nobody
+ *        else is writing. Blocks if the writer is behind by more than the number of spare buffers.
+ */
+void BinningFragmentStorage::handOver(StagingBuffer *&staging, boost::unique_lock<boost::mutex> &lock)
+{
+    ISAAC_ASSERT_MSG(writeQueue_.size() > writeQueueSize_, "Write queue overflow");
+    writeQueue_[(writeQueueHead_ + writeQueueSize_) % writeQueue_.size()] = staging;
+    ++writeQueueSize_;
+    ++handedOver_;
+
+    while (freeBuffers_.empty())
     {
-        BinMetadata &binMetadata = binPathList_.at(storageBin);
-        const unsigned long globalReadId = maxTileReads_ * fragment.getCluster().getTile() +
-            fragment.getCluster().getId();
-        binMetadata.incrementDataSize(globalReadId, header.getTotalLength());
-        binMetadata.incrementNmElements(globalReadId, 1, header.barcode_);
+        waitForWriter(lock);
     }
-    else
+    staging = freeBuffers_.back();
+    freeBuffers_.pop_back();
+}
+
+void BinningFragmentStorage::prepareFlush()
+{
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    BOOST_FOREACH(StagingBuffer *&staging, threadStaging_)
     {
-        BinMetadata &binMetadata = binPathList_.at(storageBin);
-        binMetadata.incrementDataSize(header.fStrandPosition_, header.getTotalLength());
-        binMetadata.incrementSeIdxElements(header.fStrandPosition_, 1, header.barcode_);
-        binMetadata.incrementGapCount(header.fStrandPosition_, header.gapCount_, header.barcode_);
-        binMetadata.incrementCigarLength(header.fStrandPosition_, header.cigarLength_, header.barcode_);
+        if (!staging->empty())
+        {
+            handOver(staging, lock);
+        }
     }
+    flushTarget_ = handedOver_;
+}
 
-    storeBclAndCigar(fragment, buffer);
-    ISAAC_ASSERT_MSG(buffer.size() == reinterpret_cast<io::FragmentHeader&>(buffer.front()).getTotalLength(),
-                     "buffer.size()=" << buffer.size() << " " << reinterpret_cast<io::FragmentHeader&>(buffer.front()));
-
-    std::ostream &osData = binFiles_.at(storageBin);
-    if (!osData.write(&buffer.front(), buffer.size())) {
-        BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to write into " + binPathList_.at(storageBin).getPathString()));
+void BinningFragmentStorage::flush()
+{
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    while (flushTarget_ > written_)
+    {
+        waitForWriter(lock);
     }
 }
 
-void BinningFragmentStorage::storePaired(const BamTemplate &bamTemplate, const unsigned barcodeIdx)
+/**
+ * \brief Becomes the writer if there is something to write and nobody is writing, otherwise waits for the
+ *        writer to make progress.
+ */
+void BinningFragmentStorage::waitForWriter(boost::unique_lock<boost::mutex> &lock)
 {
-    common::FiniteCapacityVector<char, sizeof(io::FragmentHeader) + FRAGMENT_BYTES_MAX> bufferA;
-    common::FiniteCapacityVector<char, sizeof(io::FragmentHeader) + FRAGMENT_BYTES_MAX> bufferB;
-
-    const unsigned binA = packFragment(bamTemplate, 0, barcodeIdx, bufferA);
-    const unsigned binB = packFragment(bamTemplate, 1, barcodeIdx, bufferB);
+    if (writerFailed_)
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(EIO, "Bin writer failed, fragments can't be stored"));
+    }
+    if (!writing_ && writeQueueSize_)
+    {
+        drainWriteQueue(lock);
+    }
+    else
+    {
+        bufferWritten_.wait(lock);
+    }
+}
 
+/**
+ * \brief Writes the queued buffers in the order they were handed over. Buffers queued by other threads
+ *        while this one writes get written too.
+ */
+void BinningFragmentStorage::drainWriteQueue(boost::unique_lock<boost::mutex> &lock)
+{
+    writing_ = true;
+    try
     {
-        boost::unique_lock<boost::mutex> lock(binMutex_[binA % binMutex_.size()]);
-        storeFragment(bufferA, binA);
-        if (binB == binA)
+        while (writeQueueSize_)
         {
-            // BinSorter requires that records follow each other if they are in the same bin.
-            // ensure lock does not get released in between the two!
-            storeFragment(bufferB, binB);
+            StagingBuffer *staging = writeQueue_[writeQueueHead_];
+            writeQueueHead_ = (writeQueueHead_ + 1) % writeQueue_.size();
+            --writeQueueSize_;
+            {
+                common::unlock_guard<boost::unique_lock<boost::mutex> > unlock(lock);
+                writeStagingBuffer(*staging);
+                staging->clear();
+            }
+            ++written_;
+            freeBuffers_.push_back(staging);
+            bufferWritten_.notify_all();
         }
     }
+    catch (...)
+    {
+        // the threads waiting for buffers must not wait forever. The exception itself goes up the
+        // ThreadVector of the thread that caught it
+        writing_ = false;
+        writerFailed_ = true;
+        bufferWritten_.notify_all();
+        throw;
+    }
+    writing_ = false;
+}
+
+/**
+ * \brief Groups the staged fragments by bin without changing their relative order, accounts them in the bin
+ *        metadata and appends each group to its bin file.
+ */
+void BinningFragmentStorage::writeStagingBuffer(const StagingBuffer &staging)
+{
+    typedef std::pair<unsigned, unsigned> BinOffset;
+
+    std::fill(binFragmentOffsets_.begin(), binFragmentOffsets_.end(), 0);
+    BOOST_FOREACH(const BinOffset &fragment, staging.fragments_)
+    {
+        ++binFragmentOffsets_.at(fragment.first + 1);
+    }
+    std::partial_sum(binFragmentOffsets_.begin(), binFragmentOffsets_.end(), binFragmentOffsets_.begin());
 
-    if (binB != binA)
+    sortedFragments_.resize(staging.fragments_.size());
+    for (unsigned i = 0; staging.fragments_.size() != i; ++i)
     {
-        boost::unique_lock<boost::mutex> lock(binMutex_[binB % binMutex_.size()]);
-        storeFragment(bufferB, binB);
+        sortedFragments_[binFragmentOffsets_[staging.fragments_[i].first]++] = i;
+    }
+
+    std::vector<unsigned>::const_iterator it = sortedFragments_.begin();
+    while (sortedFragments_.end() != it)
+    {
+        const unsigned storageBin = staging.fragments_[*it].first;
+        binChunk_.clear();
+        for (; sortedFragments_.end() != it && storageBin == staging.fragments_[*it].first; ++it)
+        {
+            const char *fragmentBegin = &staging.data_.front() + staging.fragments_[*it].second;
+            const io::FragmentHeader &header = reinterpret_cast<const io::FragmentHeader &>(*fragmentBegin);
+            accountFragment(header, maxTileReads_, binPathList_.at(storageBin));
+            binChunk_.insert(binChunk_.end(), fragmentBegin, fragmentBegin + header.getTotalLength());
+        }
+
+        std::ostream &osData = binFiles_.at(storageBin);
+        if (!osData.write(&binChunk_.front(), binChunk_.size())) {
+            BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to write into " + binPathList_.at(storageBin).getPathString()));
+        }
     }
 }
 
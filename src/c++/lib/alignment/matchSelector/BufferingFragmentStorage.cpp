@@ -17,6 +17,7 @@
 
 #include <cerrno>
 #include <fstream>
+#include <unistd.h>
 #include <boost/foreach.hpp>
 #include <boost/format.hpp>
 
@@ -248,6 +249,42 @@ void BufferingFragmentStorage::flush()
     ISAAC_THREAD_CERR << "Flushing buffer done for " << nextUnflushedBin << " bins" << std::endl;
 }
 
+bool BufferingFragmentStorage::resume(const alignment::BinMetadataList &binPathList, const unsigned storedTiles)
+{
+    if (binPathList_.size() != binPathList.size())
+    {
+        return false;
+    }
+    for (std::size_t i = 0; binPathList.size() > i; ++i)
+    {
+        if (binPathList_[i].getPath() != binPathList[i].getPath() ||
+            binPathList_[i].getBinStart() != binPathList[i].getBinStart() ||
+            binPathList_[i].getLength() != binPathList[i].getLength())
+        {
+            return false;
+        }
+    }
+
+    BOOST_FOREACH(const BinMetadata &binMetadata, binPathList)
+    {
+        if (binMetadata.isEmpty())
+        {
+            // flushBin will start the file from scratch
+            unlink(binMetadata.getPath().c_str());
+        }
+        else if (-1 == truncate(binMetadata.getPath().c_str(), binMetadata.getDataSize()))
+        {
+            BOOST_THROW_EXCEPTION(common::IoException(
+                errno, (boost::format("Failed to truncate %s to %d bytes") %
+                    binMetadata.getPathString() % binMetadata.getDataSize()).str()));
+        }
+    }
+
+    binPathList_ = binPathList;
+    storedTile_ = storedTiles;
+    return true;
+}
+
 alignment::BinMetadataList BufferingFragmentStorage::buildBinPathList(
     const BinIndexMap &binIndexMap,
     const MatchDistribution &matchDistribution,
@@ -72,6 +72,13 @@ unsigned percentMismatches(
 }
 
 
+/**
+ * \brief Tries the adapter at each base that does not match the reference. The mismatches are located
+ *        16 bases at a time, so that the reads with few mismatches don't pay for a per-base loop.
+ *
+ * \param referenceBegin reference base against the sequenceBegin. The reference must be at least as
+ *        long as the sequence
+ */
 const std::pair<std::vector<char>::const_iterator, std::vector<char>::const_iterator>
 findSequencingAdapter(
     std::vector<char>::const_iterator sequenceBegin,
@@ -80,11 +87,22 @@ findSequencingAdapter(
     const std::vector<char>::const_iterator referenceEnd,
     const matchSelector::SequencingAdapter &adapter)
 {
-    for (std::vector<char>::const_iterator currentBase(sequenceBegin), currentReference(referenceBegin);
-        sequenceEnd != currentBase; ++currentReference, ++currentBase)
+    static const unsigned BASES_AT_A_TIME = 16;
+    const unsigned length = std::distance(sequenceBegin, sequenceEnd);
+    for (unsigned offset = 0; length > offset; offset += BASES_AT_A_TIME)
     {
-        if (!isMatch(*currentBase, *currentReference))
+        const unsigned chunk = std::min(BASES_AT_A_TIME, length - offset);
+        const char *chunkSequence = &*sequenceBegin + offset;
+        const char *chunkReference = &*referenceBegin + offset;
+        unsigned editMask = 0;
+        unsigned mismatchMask = BASES_AT_A_TIME == chunk ?
+            compareBases16(chunkSequence, chunkReference, editMask) :
+            compareBases(chunkSequence, chunkReference, chunk, editMask);
+
+        while (mismatchMask)
         {
+            const std::vector<char>::const_iterator currentBase = sequenceBegin + offset + __builtin_ctz(mismatchMask);
+            mismatchMask &= mismatchMask - 1;
             const std::pair<std::vector<char>::const_iterator, std::vector<char>::const_iterator> adapterMatchRange =
                 adapter.getMatchRange(sequenceBegin, sequenceEnd, currentBase);
             if (adapterMatchRange.first != adapterMatchRange.second)
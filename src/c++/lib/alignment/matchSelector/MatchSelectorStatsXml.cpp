@@ -17,6 +17,9 @@
  ** \author Roman Petrovski
  **/
 
+#include <cerrno>
+#include <sstream>
+
 #include <boost/lexical_cast.hpp>
 
 #include "alignment/matchSelector/MatchSelectorStatsXml.hh"
@@ -48,6 +51,131 @@ const std::string &alignmentClassName(const TemplateLengthStatistics::AlignmentM
     return classNames[alignmentModel];
 }
 
+MatchSelectorStatsXml::MatchSelectorStatsXml(
+    const flowcell::FlowcellLayoutList &flowcellLayoutList,
+    const flowcell::BarcodeMetadataList &barcodeMetadataList,
+    const flowcell::TileMetadataList &tileMetadataList,
+    const boost::filesystem::path &spoolPath) :
+        flowcellLayoutList_(flowcellLayoutList),
+        barcodeMetadataList_(barcodeMetadataList),
+        tileMetadataList_(tileMetadataList),
+        spoolPath_(spoolPath),
+        spool_(spoolPath.string().c_str(), std::ios_base::in | std::ios_base::out | std::ios_base::trunc | std::ios_base::binary),
+        tileExtents_(tileMetadataList.size())
+{
+    if (!spool_)
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "ERROR: Unable to open file for writing: " + spoolPath_.string()));
+    }
+}
+
+MatchSelectorStatsXml::~MatchSelectorStatsXml()
+{
+    spool_.close();
+    boost::system::error_code error;
+    boost::filesystem::remove(spoolPath_, error);
+}
+
+MatchSelectorStatsXml::SpoolExtent MatchSelectorStatsXml::spool(const std::string &xml)
+{
+    SpoolExtent ret;
+    ret.offset_ = spool_.seekp(0, std::ios_base::end).tellp();
+    ret.length_ = xml.size();
+    if (!spool_.write(xml.data(), xml.size()))
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "ERROR: Failed to write into " + spoolPath_.string()));
+    }
+    return ret;
+}
+
+void MatchSelectorStatsXml::writeSpooled(xml::XmlWriter &xmlWriter, const SpoolExtent &extent)
+{
+    buffer_.resize(extent.length_);
+    if (!spool_.seekg(extent.offset_).read(&buffer_.front(), extent.length_))
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "ERROR: Failed to read from " + spoolPath_.string()));
+    }
+    xmlWriter.writeRaw(&buffer_.front(), extent.length_);
+}
+
+void MatchSelectorStatsXml::addTile(const flowcell::TileMetadata &tile, MatchSelectorStats &tileStats)
+{
+    ISAAC_ASSERT_MSG(!tileExtents_.at(tile.getIndex()).length_, "Statistics of " << tile << " are already added");
+    tileStats.finalize();
+
+    std::ostringstream os;
+    {
+        xml::XmlWriter xmlWriter(os, true);
+        serlializeTile(xmlWriter, tile, tileStats);
+        xmlWriter.flush();
+    }
+    tileExtents_.at(tile.getIndex()) = spool(os.str());
+
+    addTileBarcodes(tile, tileStats);
+}
+
+void MatchSelectorStatsXml::addTileBarcodes(const flowcell::TileMetadata &tile, const MatchSelectorStats &tileStats)
+{
+    FlowcellProjectSampleBarcodeReadBarcodeStats flowcellProjectSampleBarcodeStats;
+    BOOST_FOREACH(const flowcell::ReadMetadata& read, flowcellLayoutList_.at(tile.getFlowcellIndex()).getReadMetadataList())
+    {
+        BOOST_FOREACH(const flowcell::BarcodeMetadata& barcode, barcodeMetadataList_)
+        {
+            if (barcode.getFlowcellId() == tile.getFlowcellId() && barcode.getLane() == tile.getLane())
+            {
+                const matchSelector::TileBarcodeStats &pfStat = tileStats.getReadBarcodeTileStat(read, barcode, true);
+                flowcellProjectSampleBarcodeStats[barcode.getFlowcellId()][barcode.getProject()][barcode.getSampleName()][barcode.getName()][read.getNumber()][0] += pfStat;
+                flowcellProjectSampleBarcodeStats[barcode.getFlowcellId()][barcode.getProject()][barcode.getSampleName()]["all"][read.getNumber()][0] += pfStat;
+                flowcellProjectSampleBarcodeStats[barcode.getFlowcellId()][barcode.getProject()]["all"]["all"][read.getNumber()][0] += pfStat;
+                flowcellProjectSampleBarcodeStats[barcode.getFlowcellId()]["all"]["all"]["all"][read.getNumber()][0] += pfStat;
+                flowcellProjectSampleBarcodeStats["all"][barcode.getProject()][barcode.getSampleName()]["all"][read.getNumber()][0] += pfStat;
+                flowcellProjectSampleBarcodeStats["all"][barcode.getProject()]["all"]["all"][read.getNumber()][0] += pfStat;
+                flowcellProjectSampleBarcodeStats["all"]["all"]["all"]["all"][read.getNumber()][0] += pfStat;
+
+                const matchSelector::TileBarcodeStats &rawStat = tileStats.getReadBarcodeTileStat(read, barcode, false);
+                flowcellProjectSampleBarcodeStats[barcode.getFlowcellId()][barcode.getProject()][barcode.getSampleName()][barcode.getName()][read.getNumber()][1] += rawStat;
+                flowcellProjectSampleBarcodeStats[barcode.getFlowcellId()][barcode.getProject()][barcode.getSampleName()]["all"][read.getNumber()][1] += rawStat;
+                flowcellProjectSampleBarcodeStats[barcode.getFlowcellId()][barcode.getProject()]["all"]["all"][read.getNumber()][1] += rawStat;
+                flowcellProjectSampleBarcodeStats[barcode.getFlowcellId()]["all"]["all"]["all"][read.getNumber()][1] += rawStat;
+                flowcellProjectSampleBarcodeStats["all"][barcode.getProject()][barcode.getSampleName()]["all"][read.getNumber()][1] += rawStat;
+                flowcellProjectSampleBarcodeStats["all"][barcode.getProject()]["all"]["all"][read.getNumber()][1] += rawStat;
+                flowcellProjectSampleBarcodeStats["all"]["all"]["all"]["all"][read.getNumber()][1] += rawStat;
+            }
+        }
+    }
+
+    BOOST_FOREACH(const FlowcellProjectSampleBarcodeReadBarcodeStats::value_type &flowcellStats, flowcellProjectSampleBarcodeStats)
+    {
+        BOOST_FOREACH(const ProjectSampleBarcodeReadBarcodeStats::value_type &projectStats, flowcellStats.second)
+        {
+            BOOST_FOREACH(const SampleBarcodeReadBarcodeStats::value_type &sampleStats, projectStats.second)
+            {
+                BOOST_FOREACH(const BarcodeReadBarcodeStats::value_type &barcodeStats, sampleStats.second)
+                {
+                    std::ostringstream os;
+                    {
+                        xml::XmlWriter xmlWriter(os, true);
+                        bool dumpReadIndependentStats = true;
+                        BOOST_FOREACH(const ReadBarcodeStats::value_type &readStats, barcodeStats.second)
+                        {
+                            ISAAC_XML_WRITER_ELEMENT_BLOCK(xmlWriter, "Tile")
+                            {
+                                xmlWriter.writeAttribute("number", tile.getTile());
+                                serializeTileBarcode(xmlWriter, readStats.first, dumpReadIndependentStats, true, readStats.second[0]);
+                                serializeTileBarcode(xmlWriter, readStats.first, dumpReadIndependentStats, false, readStats.second[1]);
+                                dumpReadIndependentStats = false;
+                            }
+                        }
+                        xmlWriter.flush();
+                    }
+                    barcodeTileExtents_[flowcellStats.first][projectStats.first][sampleStats.first][barcodeStats.first][tile.getIndex()] =
+                        spool(os.str());
+                }
+            }
+        }
+    }
+}
+
 void MatchSelectorStatsXml::serializeBarcodes(
     xml::XmlWriter &xmlWriter, const flowcell::Layout &flowcell) const
 {
@@ -98,48 +226,38 @@ void MatchSelectorStatsXml::serializeReads(
 void MatchSelectorStatsXml::serializeFlowcellProjects(
     xml::XmlWriter &xmlWriter,
     const std::vector<unsigned> &allLanes,
-    const ProjectSampleBarcodeTileReadBarcodeStats &flowcellProjectSampleBarcodeStats) const
+    const ProjectSampleBarcodeTileExtents &flowcellProjectSampleBarcodeTileExtents)
 {
-    BOOST_FOREACH(const ProjectSampleBarcodeTileReadBarcodeStats::value_type &projectStats, flowcellProjectSampleBarcodeStats)
+    BOOST_FOREACH(const ProjectSampleBarcodeTileExtents::value_type &projectExtents, flowcellProjectSampleBarcodeTileExtents)
     {
         ISAAC_XML_WRITER_ELEMENT_BLOCK(xmlWriter, "Project")
         {
-            xmlWriter.writeAttribute("name", projectStats.first);
-            BOOST_FOREACH(const SampleBarcodeTileReadBarcodeStats::value_type &sampleStats, projectStats.second)
+            xmlWriter.writeAttribute("name", projectExtents.first);
+            BOOST_FOREACH(const SampleBarcodeTileExtents::value_type &sampleExtents, projectExtents.second)
             {
                 ISAAC_XML_WRITER_ELEMENT_BLOCK(xmlWriter, "Sample")
                 {
-                    xmlWriter.writeAttribute("name", sampleStats.first);
-                    BOOST_FOREACH(const BarcodeTileReadBarcodeStats::value_type &barcodeStats, sampleStats.second)
+                    xmlWriter.writeAttribute("name", sampleExtents.first);
+                    BOOST_FOREACH(const BarcodeTileExtents::value_type &barcodeExtents, sampleExtents.second)
                     {
                         ISAAC_XML_WRITER_ELEMENT_BLOCK(xmlWriter, "Barcode")
                         {
-                            xmlWriter.writeAttribute("name", barcodeStats.first);
+                            xmlWriter.writeAttribute("name", barcodeExtents.first);
                             unsigned lastCreatedLane = 0;
                             BOOST_FOREACH(const unsigned lane, allLanes)
                             {
-                                BOOST_FOREACH(const TileReadBarcodeStats::value_type &tileStats, barcodeStats.second)
+                                BOOST_FOREACH(const TileExtents::value_type &tileExtent, barcodeExtents.second)
                                 {
-                                    if (tileMetadataList_.at(tileStats.first).getLane() == lane)
+                                    if (tileMetadataList_.at(tileExtent.first).getLane() == lane)
                                     {
-                                        bool dumpReadIndependentStats = true;
-                                        BOOST_FOREACH(const ReadBarcodeStats::value_type &readStats, tileStats.second)
+                                        if (lastCreatedLane != lane)
                                         {
-                                            if (lastCreatedLane != lane)
-                                            {
-                                                // avoid creating empty Lane elements as they screw up html reports
-                                                xmlWriter.startElement("Lane");
-                                                xmlWriter.writeAttribute("number", lane);
-                                                lastCreatedLane = lane;
-                                            }
-                                            ISAAC_XML_WRITER_ELEMENT_BLOCK(xmlWriter, "Tile")
-                                            {
-                                                xmlWriter.writeAttribute("number", tileMetadataList_.at(tileStats.first).getTile());
-                                                serializeTileBarcode(xmlWriter, readStats.first, dumpReadIndependentStats, true, readStats.second[0]);
-                                                serializeTileBarcode(xmlWriter, readStats.first, dumpReadIndependentStats, false, readStats.second[1]);
-                                                dumpReadIndependentStats = false;
-                                            }
+                                            // avoid creating empty Lane elements as they screw up html reports
+                                            xmlWriter.startElement("Lane");
+                                            xmlWriter.writeAttribute("number", lane);
+                                            lastCreatedLane = lane;
                                         }
+                                        writeSpooled(xmlWriter, tileExtent.second);
                                     }
                                 }
                                 if (lastCreatedLane == lane)
@@ -156,11 +274,25 @@ void MatchSelectorStatsXml::serializeFlowcellProjects(
 }
 
 
-void MatchSelectorStatsXml::serialize(std::ostream& os) const
+void MatchSelectorStatsXml::serialize(std::ostream& os)
 {
+    // tiles without any matches don't get processed
+    MatchSelectorStats emptyStats(barcodeMetadataList_);
+    BOOST_FOREACH(const flowcell::TileMetadata& tile, tileMetadataList_)
+    {
+        if (!tileExtents_.at(tile.getIndex()).length_)
+        {
+            addTile(tile, emptyStats);
+        }
+    }
+
+    if (!spool_.flush())
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "ERROR: Failed to write into " + spoolPath_.string()));
+    }
+
     xml::XmlWriter xmlWriter(os);
 
-    FlowcellProjectSampleBarcodeTileReadBarcodeStats flowcellProjectSampleBarcodeStats;
     std::vector<unsigned> allLanes;
 
     ISAAC_XML_WRITER_ELEMENT_BLOCK(xmlWriter, "Stats")
@@ -190,7 +322,7 @@ void MatchSelectorStatsXml::serialize(std::ostream& os) const
                                 xmlWriter.writeAttribute("number", lane);
                                 lastCreatedLane = lane;
                             }
-                            serlializeTile(xmlWriter, tile);
+                            writeSpooled(xmlWriter, tileExtents_.at(tile.getIndex()));
                         }
                     }
                     if (lastCreatedLane == lane)
@@ -199,40 +331,7 @@ void MatchSelectorStatsXml::serialize(std::ostream& os) const
                     }
                 }
 
-                BOOST_FOREACH(const flowcell::TileMetadata& tile, tileMetadataList_)
-                {
-                    if (flowcell.getIndex() == tile.getFlowcellIndex())
-                    {
-                        BOOST_FOREACH(const flowcell::ReadMetadata& read, flowcellLayoutList_.at(tile.getFlowcellIndex()).getReadMetadataList())
-                        {
-                            BOOST_FOREACH(const flowcell::BarcodeMetadata& barcode, barcodeMetadataList_)
-                            {
-                                if (barcode.getFlowcellId() == tile.getFlowcellId() && barcode.getLane() == tile.getLane())
-                                {
-                                    const matchSelector::TileBarcodeStats &pfStat = stats_.at(tile.getIndex()).getReadBarcodeTileStat(read, barcode, true);
-                                    flowcellProjectSampleBarcodeStats[barcode.getFlowcellId()][barcode.getProject()][barcode.getSampleName()][barcode.getName()][tile.getIndex()][read.getNumber()][0] += pfStat;
-                                    flowcellProjectSampleBarcodeStats[barcode.getFlowcellId()][barcode.getProject()][barcode.getSampleName()]["all"][tile.getIndex()][read.getNumber()][0] += pfStat;
-                                    flowcellProjectSampleBarcodeStats[barcode.getFlowcellId()][barcode.getProject()]["all"]["all"][tile.getIndex()][read.getNumber()][0] += pfStat;
-                                    flowcellProjectSampleBarcodeStats[barcode.getFlowcellId()]["all"]["all"]["all"][tile.getIndex()][read.getNumber()][0] += pfStat;
-                                    flowcellProjectSampleBarcodeStats["all"][barcode.getProject()][barcode.getSampleName()]["all"][tile.getIndex()][read.getNumber()][0] += pfStat;
-                                    flowcellProjectSampleBarcodeStats["all"][barcode.getProject()]["all"]["all"][tile.getIndex()][read.getNumber()][0] += pfStat;
-                                    flowcellProjectSampleBarcodeStats["all"]["all"]["all"]["all"][tile.getIndex()][read.getNumber()][0] += pfStat;
-
-                                    const matchSelector::TileBarcodeStats &rawStat = stats_.at(tile.getIndex()).getReadBarcodeTileStat(read, barcode, false);
-                                    flowcellProjectSampleBarcodeStats[barcode.getFlowcellId()][barcode.getProject()][barcode.getSampleName()][barcode.getName()][tile.getIndex()][read.getNumber()][1] += rawStat;
-                                    flowcellProjectSampleBarcodeStats[barcode.getFlowcellId()][barcode.getProject()][barcode.getSampleName()]["all"][tile.getIndex()][read.getNumber()][1] += rawStat;
-                                    flowcellProjectSampleBarcodeStats[barcode.getFlowcellId()][barcode.getProject()]["all"]["all"][tile.getIndex()][read.getNumber()][1] += rawStat;
-                                    flowcellProjectSampleBarcodeStats[barcode.getFlowcellId()]["all"]["all"]["all"][tile.getIndex()][read.getNumber()][1] += rawStat;
-                                    flowcellProjectSampleBarcodeStats["all"][barcode.getProject()][barcode.getSampleName()]["all"][tile.getIndex()][read.getNumber()][1] += rawStat;
-                                    flowcellProjectSampleBarcodeStats["all"][barcode.getProject()]["all"]["all"][tile.getIndex()][read.getNumber()][1] += rawStat;
-                                    flowcellProjectSampleBarcodeStats["all"]["all"]["all"]["all"][tile.getIndex()][read.getNumber()][1] += rawStat;
-                                }
-                            }
-                        }
-                    }
-                }
-
-                serializeFlowcellProjects(xmlWriter, flowcell.getLaneIds(), flowcellProjectSampleBarcodeStats.at(flowcell.getFlowcellId()));
+                serializeFlowcellProjects(xmlWriter, flowcell.getLaneIds(), barcodeTileExtents_.at(flowcell.getFlowcellId()));
             }
         }
 
@@ -241,7 +340,7 @@ void MatchSelectorStatsXml::serialize(std::ostream& os) const
         ISAAC_XML_WRITER_ELEMENT_BLOCK(xmlWriter, "Flowcell")
         {
             xmlWriter.writeAttribute("flowcell-id", "all");
-            serializeFlowcellProjects(xmlWriter, allLanes, flowcellProjectSampleBarcodeStats.at("all"));
+            serializeFlowcellProjects(xmlWriter, allLanes, barcodeTileExtents_.at("all"));
         }
     }
 }
@@ -249,7 +348,8 @@ void MatchSelectorStatsXml::serialize(std::ostream& os) const
 
 void MatchSelectorStatsXml::serlializeTile(
     xml::XmlWriter &xmlWriter,
-    const flowcell::TileMetadata &tile) const
+    const flowcell::TileMetadata &tile,
+    const MatchSelectorStats &tileStats) const
 {
     ISAAC_XML_WRITER_ELEMENT_BLOCK(xmlWriter, "Tile")
     {
@@ -258,14 +358,14 @@ void MatchSelectorStatsXml::serlializeTile(
         {
             BOOST_FOREACH(const flowcell::ReadMetadata& read, flowcellLayoutList_.at(tile.getFlowcellIndex()).getReadMetadataList())
             {
-                serlializeTileRead(xmlWriter, read, stats_.at(tile.getIndex()).getReadTileStat(read, true));
+                serlializeTileRead(xmlWriter, read, tileStats.getReadTileStat(read, true));
             }
         }
         ISAAC_XML_WRITER_ELEMENT_BLOCK(xmlWriter, "Raw")
         {
             BOOST_FOREACH(const flowcell::ReadMetadata& read, flowcellLayoutList_.at(tile.getFlowcellIndex()).getReadMetadataList())
             {
-                serlializeTileRead(xmlWriter, read, stats_.at(tile.getIndex()).getReadTileStat(read, false));
+                serlializeTileRead(xmlWriter, read, tileStats.getReadTileStat(read, false));
             }
         }
     }
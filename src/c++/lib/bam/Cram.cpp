@@ -0,0 +1,269 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file Cram.cpp
+ **
+ ** \brief CRAM 3.0 blocks and containers.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include <new>
+
+#include <boost/format.hpp>
+
+#include "bam/Cram.hh"
+#include "common/Exceptions.hh"
+
+namespace isaac
+{
+namespace bam
+{
+
+namespace
+{
+
+void appendCramContainerHeader(
+    const int refId,
+    const int alignmentStart,
+    const int alignmentSpan,
+    const int records,
+    const unsigned long recordCounter,
+    const unsigned long bases,
+    const int blocks,
+    const int *landmarksBegin,
+    const int *landmarksEnd,
+    const std::size_t blocksLength,
+    std::vector<char> &out)
+{
+    const std::size_t headerBegin = out.size();
+    appendInt32(out, blocksLength);
+    appendItf8(out, refId);
+    appendItf8(out, alignmentStart);
+    appendItf8(out, alignmentSpan);
+    appendItf8(out, records);
+    appendFixedLtf8(out, recordCounter);
+    appendLtf8(out, bases);
+    appendItf8(out, blocks);
+    appendItf8(out, landmarksEnd - landmarksBegin);
+    for (const int *landmark = landmarksBegin; landmarksEnd != landmark; ++landmark)
+    {
+        appendItf8(out, *landmark);
+    }
+    appendInt32(out, crc32(0, reinterpret_cast<const Bytef*>(&out[headerBegin]), out.size() - headerBegin));
+}
+
+void writeInt32(unsigned char *p, const int value)
+{
+    const unsigned v = value;
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = (v >> 24) & 0xFF;
+}
+
+void serialize(std::ostream &os, const std::vector<char> &bytes)
+{
+    if (!os.write(&bytes.front(), bytes.size()))
+    {
+        BOOST_THROW_EXCEPTION(
+            common::IoException(errno, (boost::format("Failed to write %d bytes into cram stream") % bytes.size()).str()));
+    }
+}
+
+} // namespace
+
+CramBlockCompressor::CramBlockCompressor(const int gzipLevel, const std::size_t maxBlockBytes) :
+    gzipLevel_(gzipLevel),
+    maxBlockBytes_(maxBlockBytes)
+{
+    zstream_.zalloc = Z_NULL;
+    zstream_.zfree = Z_NULL;
+    zstream_.opaque = Z_NULL;
+    if (gzipLevel_)
+    {
+        // windowBits over 15 produce gzip wrapper which is what CRAM expects for method 1
+        const int ret = deflateInit2(&zstream_, gzipLevel_, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+        if (Z_MEM_ERROR == ret)
+        {
+            throw std::bad_alloc();
+        }
+        ISAAC_ASSERT_MSG(Z_OK == ret, "deflateInit2 failed with " << ret << " for gzip level " << gzipLevel_);
+        compressed_.resize(deflateBound(&zstream_, maxBlockBytes_));
+    }
+}
+
+CramBlockCompressor::~CramBlockCompressor()
+{
+    if (gzipLevel_)
+    {
+        deflateEnd(&zstream_);
+    }
+}
+
+void CramBlockCompressor::appendBlock(
+    const CramBlockContentType contentType,
+    const int contentId,
+    const char *begin,
+    const char *end,
+    std::vector<char> &out)
+{
+    const std::size_t rawSize = std::distance(begin, end);
+    ISAAC_ASSERT_MSG(maxBlockBytes_ >= rawSize, "Block of " << rawSize << " bytes exceeds the limit of " << maxBlockBytes_);
+
+    std::size_t compressedSize = rawSize;
+    if (gzipLevel_ && rawSize)
+    {
+        zstream_.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(begin));
+        zstream_.avail_in = rawSize;
+        zstream_.next_out = &compressed_.front();
+        zstream_.avail_out = compressed_.size();
+        const int ret = deflate(&zstream_, Z_FINISH);
+        ISAAC_ASSERT_MSG(Z_STREAM_END == ret, "deflate failed with " << ret << " for block of " << rawSize << " bytes");
+        compressedSize = zstream_.total_out;
+        const int resetRet = deflateReset(&zstream_);
+        ISAAC_ASSERT_MSG(Z_OK == resetRet, "deflateReset failed with " << resetRet);
+    }
+    // store raw if compression did not help
+    const bool compressed = compressedSize < rawSize;
+
+    const std::size_t blockBegin = out.size();
+    out.push_back(compressed ? 1 : 0);
+    out.push_back(contentType);
+    appendItf8(out, contentId);
+    appendItf8(out, compressed ? compressedSize : rawSize);
+    appendItf8(out, rawSize);
+    if (compressed)
+    {
+        out.insert(out.end(), compressed_.begin(), compressed_.begin() + compressedSize);
+    }
+    else
+    {
+        out.insert(out.end(), begin, end);
+    }
+    appendInt32(out, crc32(0, reinterpret_cast<const Bytef*>(&out[blockBegin]), out.size() - blockBegin));
+}
+
+void serializeCramFileDefinition(std::ostream &os, const std::string &fileId)
+{
+    std::vector<char> definition;
+    definition.push_back('C');
+    definition.push_back('R');
+    definition.push_back('A');
+    definition.push_back('M');
+    definition.push_back(3);
+    definition.push_back(0);
+    definition.insert(definition.end(), fileId.begin(), fileId.begin() + std::min<std::size_t>(fileId.size(), CRAM_FILE_DEFINITION_BYTES - 6));
+    definition.resize(CRAM_FILE_DEFINITION_BYTES, 0);
+    serialize(os, definition);
+}
+
+std::size_t serializeCramHeaderContainer(std::ostream &os, const std::string &headerText)
+{
+    std::vector<char> data;
+    appendInt32(data, headerText.size());
+    data.insert(data.end(), headerText.begin(), headerText.end());
+
+    std::vector<char> block;
+    CramBlockCompressor rawBlocks(0, data.size());
+    rawBlocks.appendBlock(CRAM_FILE_HEADER, 0, &data.front(), &data.front() + data.size(), block);
+
+    std::vector<char> container;
+    appendCramContainerHeader(0, 0, 0, 0, 0, 0, 1, 0, 0, block.size(), container);
+    container.insert(container.end(), block.begin(), block.end());
+    serialize(os, container);
+    return container.size();
+}
+
+void serializeCramEof(std::ostream &os)
+{
+    // fixed container with empty compression header that terminates CRAM 3.0 files
+    static const unsigned char eof[38] =
+    {
+        0x0f, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff, 0x0f, 0xe0, 0x45, 0x4f, 0x46, 0x00, 0x00, 0x00,
+        0x00, 0x01, 0x00, 0x05, 0xbd, 0xd9, 0x4f, 0x00, 0x01, 0x00, 0x06, 0x06, 0x01, 0x00, 0x01, 0x00,
+        0x01, 0x00, 0xee, 0x63, 0x01, 0x4b
+    };
+    if (!os.write(reinterpret_cast<const char *>(eof), sizeof(eof)))
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to write CRAM EOF container"));
+    }
+}
+
+void appendCramContainerHeader(
+    const int refId,
+    const int alignmentStart,
+    const int alignmentSpan,
+    const int records,
+    const unsigned long recordCounter,
+    const unsigned long bases,
+    const int blocks,
+    const int landmark,
+    const std::size_t blocksLength,
+    std::vector<char> &out)
+{
+    appendCramContainerHeader(
+        refId, alignmentStart, alignmentSpan, records, recordCounter, bases, blocks,
+        &landmark, &landmark + 1, blocksLength, out);
+}
+
+void offsetCramRecordCounters(char *begin, char *end, unsigned long &recordCounter)
+{
+    // counters in the buffer start from 0
+    const unsigned long offset = recordCounter;
+    unsigned char *const buffer = reinterpret_cast<unsigned char *>(begin);
+    const unsigned char *p = buffer;
+    while (reinterpret_cast<unsigned char *>(end) != p)
+    {
+        unsigned char *const header = buffer + (p - buffer);
+        const int blocksLength = readInt32(p);
+        readItf8(p);
+        readItf8(p);
+        readItf8(p);
+        const int records = readItf8(p);
+        unsigned char *const containerCounter = buffer + (p - buffer);
+        writeFixedLtf8(containerCounter, readLtf8(p) + offset);
+        readLtf8(p);
+        readItf8(p);
+        const int landmarks = readItf8(p);
+        ISAAC_ASSERT_MSG(1 == landmarks, "Expected single-slice container, got " << landmarks << " landmarks");
+        const int landmark = readItf8(p);
+        writeInt32(buffer + (p - buffer), crc32(0, header, p - header));
+        p += 4;
+
+        const unsigned char *const container = p;
+        unsigned char *const block = buffer + (container - buffer) + landmark;
+        p = block;
+        ISAAC_ASSERT_MSG(0 == p[0], "Expected uncompressed slice header block, got method " << int(p[0]));
+        ISAAC_ASSERT_MSG(CRAM_SLICE_HEADER == p[1], "Expected slice header block, got content type " << int(p[1]));
+        p += 2;
+        readItf8(p);
+        const int blockLength = readItf8(p);
+        readItf8(p);
+        const unsigned char *const data = p;
+        readItf8(p);
+        readItf8(p);
+        readItf8(p);
+        const int sliceRecords = readItf8(p);
+        ISAAC_ASSERT_MSG(records == sliceRecords, "Slice has " << sliceRecords << " records, container " << records);
+        unsigned char *const sliceCounter = buffer + (p - buffer);
+        writeFixedLtf8(sliceCounter, readLtf8(p) + offset);
+        p = data + blockLength;
+        writeInt32(buffer + (p - buffer), crc32(0, block, p - block));
+
+        recordCounter += records;
+        p = container + blocksLength;
+    }
+}
+
+} // namespace bam
+} // namespace isaac
@@ -0,0 +1,154 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file CramIndex.cpp
+ **
+ ** \brief Implementation of CRAM indexing
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include <new>
+
+#include "bam/Cram.hh"
+#include "bam/CramIndex.hh"
+#include "common/Exceptions.hh"
+#include "common/FastIo.hh"
+
+namespace isaac
+{
+namespace bam
+{
+
+CramIndex::CramIndex() :
+    deflating_(false),
+    positionInCram_(0)
+{
+}
+
+CramIndex::CramIndex(const boost::filesystem::path &cramPath, const unsigned long headerLength) :
+    craiStream_((cramPath.string() + ".crai").c_str()),
+    deflating_(false),
+    compressed_(COMPRESSED_BUFFER_SIZE),
+    positionInCram_(headerLength)
+{
+    if (!craiStream_)
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "Error opening cram index file for writing"));
+    }
+    zstream_.zalloc = Z_NULL;
+    zstream_.zfree = Z_NULL;
+    zstream_.opaque = Z_NULL;
+    const int ret = deflateInit2(&zstream_, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+    if (Z_MEM_ERROR == ret)
+    {
+        throw std::bad_alloc();
+    }
+    ISAAC_ASSERT_MSG(Z_OK == ret, "deflateInit2 failed with " << ret);
+    deflating_ = true;
+    line_.reserve(LINE_LENGTH_MAX);
+}
+
+CramIndex::~CramIndex()
+{
+    if (deflating_)
+    {
+        deflateEnd(&zstream_);
+    }
+}
+
+void CramIndex::appendNumber(const long number)
+{
+    if (0 > number)
+    {
+        line_.push_back('-');
+    }
+    common::appendUnsignedNumber(line_, static_cast<unsigned long>(0 > number ? -number : number));
+}
+
+void CramIndex::processContainers(const std::vector<char> &containers)
+{
+    ISAAC_ASSERT_MSG(deflating_, "Attempt to use invalid CramIndex");
+    const unsigned char *const begin = reinterpret_cast<const unsigned char *>(containers.empty() ? 0 : &containers.front());
+    const unsigned char *const end = begin + containers.size();
+    for (const unsigned char *p = begin; end != p;)
+    {
+        const unsigned long containerOffset = positionInCram_ + (p - begin);
+        const int blocksLength = readInt32(p);
+        const int refId = readItf8(p);
+        const int alignmentStart = readItf8(p);
+        const int alignmentSpan = readItf8(p);
+        // records
+        readItf8(p);
+        // record counter and bases
+        readLtf8(p);
+        readLtf8(p);
+        // blocks
+        readItf8(p);
+        const int landmarks = readItf8(p);
+        ISAAC_ASSERT_MSG(1 == landmarks, "Expected single slice per container, got " << landmarks);
+        const int landmark = readItf8(p);
+        // crc32
+        readInt32(p);
+
+        line_.clear();
+        appendNumber(refId);
+        line_.push_back('\t');
+        appendNumber(alignmentStart);
+        line_.push_back('\t');
+        appendNumber(alignmentSpan);
+        line_.push_back('\t');
+        appendNumber(containerOffset);
+        line_.push_back('\t');
+        appendNumber(landmark);
+        line_.push_back('\t');
+        appendNumber(blocksLength - landmark);
+        line_.push_back('\n');
+        deflateLine(Z_NO_FLUSH);
+
+        ISAAC_ASSERT_MSG(end - p >= blocksLength, "Container is truncated");
+        p += blocksLength;
+    }
+    positionInCram_ += containers.size();
+}
+
+void CramIndex::flush()
+{
+    line_.clear();
+    deflateLine(Z_FINISH);
+    if (!craiStream_.flush())
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "Error writing cram index"));
+    }
+}
+
+void CramIndex::deflateLine(const int flushMode)
+{
+    zstream_.next_in = line_.empty() ? 0 : reinterpret_cast<Bytef*>(&line_.front());
+    zstream_.avail_in = line_.size();
+    // keep going while deflate fills the whole buffer
+    do
+    {
+        zstream_.next_out = &compressed_.front();
+        zstream_.avail_out = compressed_.size();
+        const int ret = deflate(&zstream_, flushMode);
+        ISAAC_ASSERT_MSG(Z_STREAM_ERROR != ret, "deflate failed for cram index");
+        const std::size_t have = compressed_.size() - zstream_.avail_out;
+        if (have && !craiStream_.write(reinterpret_cast<const char *>(&compressed_.front()), have))
+        {
+            BOOST_THROW_EXCEPTION(common::IoException(errno, "Error writing cram index"));
+        }
+    } while (!zstream_.avail_out);
+}
+
+} // namespace bam
+} // namespace isaac
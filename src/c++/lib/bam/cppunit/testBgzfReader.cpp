@@ -0,0 +1,237 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+
+#include "RegistryName.hh"
+#include "testBgzfReader.hh"
+
+#include "bgzf/BgzfReader.hh"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( TestBgzfReader, registryName("BgzfReader"));
+
+using namespace isaac;
+
+namespace
+{
+
+void appendLittleEndian(std::vector<char> &buffer, const unsigned value, const unsigned bytes)
+{
+    for (unsigned i = 0; bytes > i; ++i)
+    {
+        buffer.push_back(char((value >> (i * 8)) & 0xFF));
+    }
+}
+
+/// appends a complete bgzf block containing [begin, end)
+void appendBlock(std::vector<char> &buffer, const char *begin, const char *end)
+{
+    std::vector<char> cdata(compressBound(end - begin) + 16);
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    CPPUNIT_ASSERT_EQUAL(Z_OK, deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY));
+    strm.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(begin));
+    strm.avail_in = end - begin;
+    strm.next_out = reinterpret_cast<Bytef *>(&cdata.front());
+    strm.avail_out = cdata.size();
+    CPPUNIT_ASSERT_EQUAL(Z_STREAM_END, deflate(&strm, Z_FINISH));
+    cdata.resize(cdata.size() - strm.avail_out);
+    deflateEnd(&strm);
+
+    const unsigned blockSize = sizeof(bgzf::Header) + cdata.size() + sizeof(bgzf::Footer);
+    const char header[] = {31, char(139), 8, 4, 0, 0, 0, 0, 0, char(255), 6, 0, 'B', 'C', 2, 0};
+    buffer.insert(buffer.end(), header, header + sizeof(header));
+    appendLittleEndian(buffer, blockSize - 1, 2);
+    buffer.insert(buffer.end(), cdata.begin(), cdata.end());
+    appendLittleEndian(buffer, crc32(0, reinterpret_cast<const Bytef *>(begin), end - begin), 4);
+    appendLittleEndian(buffer, end - begin, 4);
+}
+
+} // namespace
+
+void TestBgzfReader::setUp()
+{
+    data_.clear();
+    for (unsigned i = 0; 3200 > i; ++i)
+    {
+        data_.push_back(char(i * 7 + i / 13));
+    }
+    compressed_.clear();
+    blockOffsets_.clear();
+    const unsigned blockSizes[] = {1000, 0, 1500, 700};
+    const char *begin = &data_.front();
+    for (unsigned i = 0; sizeof(blockSizes) / sizeof(blockSizes[0]) > i; ++i)
+    {
+        blockOffsets_.push_back(compressed_.size());
+        appendBlock(compressed_, begin, begin + blockSizes[i]);
+        begin += blockSizes[i];
+    }
+    CPPUNIT_ASSERT_EQUAL(static_cast<const char*>(&data_.back() + 1), begin);
+}
+
+void TestBgzfReader::tearDown()
+{
+}
+
+void TestBgzfReader::testIndexBlocks()
+{
+    std::vector<bgzf::BlockLocation> blocks;
+    blocks.reserve(4);
+    unsigned long uncompressedOffset = 0;
+    const char *end = &compressed_.front() + compressed_.size();
+    CPPUNIT_ASSERT_EQUAL(end, bgzf::indexBlocks(&compressed_.front(), end, uncompressedOffset, blocks));
+
+    // the empty block is skipped
+    CPPUNIT_ASSERT_EQUAL(3UL, blocks.size());
+    CPPUNIT_ASSERT_EQUAL(3200UL, uncompressedOffset);
+    CPPUNIT_ASSERT_EQUAL(static_cast<const char*>(&compressed_.front()), blocks[0].compressed_);
+    CPPUNIT_ASSERT_EQUAL(unsigned(blockOffsets_[1]), blocks[0].compressedSize_);
+    CPPUNIT_ASSERT_EQUAL(0UL, blocks[0].uncompressedOffset_);
+    CPPUNIT_ASSERT_EQUAL(1000U, blocks[0].uncompressedSize_);
+    CPPUNIT_ASSERT_EQUAL(static_cast<const char*>(&compressed_.front() + blockOffsets_[2]), blocks[1].compressed_);
+    CPPUNIT_ASSERT_EQUAL(1000UL, blocks[1].uncompressedOffset_);
+    CPPUNIT_ASSERT_EQUAL(1500U, blocks[1].uncompressedSize_);
+    CPPUNIT_ASSERT_EQUAL(static_cast<const char*>(&compressed_.front() + blockOffsets_[3]), blocks[2].compressed_);
+    CPPUNIT_ASSERT_EQUAL(unsigned(compressed_.size() - blockOffsets_[3]), blocks[2].compressedSize_);
+    CPPUNIT_ASSERT_EQUAL(2500UL, blocks[2].uncompressedOffset_);
+    CPPUNIT_ASSERT_EQUAL(700U, blocks[2].uncompressedSize_);
+}
+
+void TestBgzfReader::testIndexTruncated()
+{
+    std::vector<bgzf::BlockLocation> blocks;
+    blocks.reserve(4);
+    unsigned long uncompressedOffset = 0;
+    const char *begin = &compressed_.front();
+
+    // cut in the middle of the third block data
+    const char *unindexed = bgzf::indexBlocks(
+        begin, begin + blockOffsets_[2] + sizeof(bgzf::Header) + 10, uncompressedOffset, blocks);
+    CPPUNIT_ASSERT_EQUAL(begin + blockOffsets_[2], unindexed);
+    CPPUNIT_ASSERT_EQUAL(1UL, blocks.size());
+    CPPUNIT_ASSERT_EQUAL(1000UL, uncompressedOffset);
+
+    // cut in the middle of the last block header
+    unindexed = bgzf::indexBlocks(unindexed, begin + blockOffsets_[3] + 5, uncompressedOffset, blocks);
+    CPPUNIT_ASSERT_EQUAL(begin + blockOffsets_[3], unindexed);
+    CPPUNIT_ASSERT_EQUAL(2UL, blocks.size());
+    CPPUNIT_ASSERT_EQUAL(2500UL, uncompressedOffset);
+
+    // the rest arrives
+    unindexed = bgzf::indexBlocks(unindexed, begin + compressed_.size(), uncompressedOffset, blocks);
+    CPPUNIT_ASSERT_EQUAL(begin + compressed_.size(), unindexed);
+    CPPUNIT_ASSERT_EQUAL(3UL, blocks.size());
+    CPPUNIT_ASSERT_EQUAL(3200UL, uncompressedOffset);
+    CPPUNIT_ASSERT_EQUAL(2500UL, blocks.back().uncompressedOffset_);
+}
+
+void TestBgzfReader::testInflateMultiBlock()
+{
+    std::vector<bgzf::BlockLocation> blocks;
+    blocks.reserve(4);
+    unsigned long uncompressedOffset = 0;
+    bgzf::indexBlocks(&compressed_.front(), &compressed_.front() + compressed_.size(), uncompressedOffset, blocks);
+
+    bgzf::BgzfReader reader;
+    std::vector<char> boundaryBuffer(bgzf::ParallelBgzfBlockInflater::UNCOMPRESSED_BLOCK_MAX);
+    std::vector<char> result(data_.size(), 0);
+    CPPUNIT_ASSERT_EQUAL(data_.size(), bgzf::inflateBlocks(
+        reader, &boundaryBuffer.front(), blocks, 0, 1, 0, &result.front(), result.size()));
+    CPPUNIT_ASSERT(data_ == result);
+
+    // every other block, the way the threads of ParallelBgzfBlockInflater split the work
+    std::fill(result.begin(), result.end(), 0);
+    CPPUNIT_ASSERT_EQUAL(std::size_t(1000 + 700), bgzf::inflateBlocks(
+        reader, &boundaryBuffer.front(), blocks, 0, 2, 0, &result.front(), result.size()));
+    CPPUNIT_ASSERT_EQUAL(std::size_t(1500), bgzf::inflateBlocks(
+        reader, &boundaryBuffer.front(), blocks, 1, 2, 0, &result.front(), result.size()));
+    CPPUNIT_ASSERT(data_ == result);
+
+    bgzf::ParallelBgzfBlockInflater inflater(2);
+    std::fill(result.begin(), result.end(), 0);
+    CPPUNIT_ASSERT_EQUAL(data_.size(), inflater.inflate(blocks, 0, &result.front(), result.size()));
+    CPPUNIT_ASSERT(data_ == result);
+}
+
+void TestBgzfReader::testInflateAcrossBlockBoundaries()
+{
+    std::vector<bgzf::BlockLocation> blocks;
+    blocks.reserve(4);
+    unsigned long uncompressedOffset = 0;
+    bgzf::indexBlocks(&compressed_.front(), &compressed_.front() + compressed_.size(), uncompressedOffset, blocks);
+
+    bgzf::BgzfReader reader;
+    std::vector<char> boundaryBuffer(bgzf::ParallelBgzfBlockInflater::UNCOMPRESSED_BLOCK_MAX);
+
+    // starts inside the first block and ends inside the last one
+    const std::size_t skipBytes = 900;
+    const std::size_t size = 2000;
+    // guard bytes on each side catch writes outside the range
+    std::vector<char> result(size + 2, '#');
+    CPPUNIT_ASSERT_EQUAL(size, bgzf::inflateBlocks(
+        reader, &boundaryBuffer.front(), blocks, 0, 1, skipBytes, &result.front() + 1, size));
+    CPPUNIT_ASSERT_EQUAL('#', result.front());
+    CPPUNIT_ASSERT_EQUAL('#', result.back());
+    CPPUNIT_ASSERT(std::equal(result.begin() + 1, result.end() - 1, data_.begin() + skipBytes));
+
+    // entirely inside the middle block
+    result.assign(12, '#');
+    CPPUNIT_ASSERT_EQUAL(std::size_t(10), bgzf::inflateBlocks(
+        reader, &boundaryBuffer.front(), blocks, 0, 1, 1200, &result.front() + 1, 10));
+    CPPUNIT_ASSERT_EQUAL('#', result.front());
+    CPPUNIT_ASSERT_EQUAL('#', result.back());
+    CPPUNIT_ASSERT(std::equal(result.begin() + 1, result.end() - 1, data_.begin() + 1200));
+
+    // ends exactly at a block boundary
+    result.assign(1502, '#');
+    bgzf::ParallelBgzfBlockInflater inflater(3);
+    CPPUNIT_ASSERT_EQUAL(std::size_t(1500), inflater.inflate(blocks, 1000, &result.front() + 1, 1500));
+    CPPUNIT_ASSERT_EQUAL('#', result.front());
+    CPPUNIT_ASSERT_EQUAL('#', result.back());
+    CPPUNIT_ASSERT(std::equal(result.begin() + 1, result.end() - 1, data_.begin() + 1000));
+}
+
+void TestBgzfReader::testInflateTruncated()
+{
+    // only the first two non-empty blocks are available
+    std::vector<bgzf::BlockLocation> blocks;
+    blocks.reserve(4);
+    unsigned long uncompressedOffset = 0;
+    bgzf::indexBlocks(&compressed_.front(), &compressed_.front() + blockOffsets_[3] + 20, uncompressedOffset, blocks);
+    CPPUNIT_ASSERT_EQUAL(2UL, blocks.size());
+
+    bgzf::BgzfReader reader;
+    std::vector<char> boundaryBuffer(bgzf::ParallelBgzfBlockInflater::UNCOMPRESSED_BLOCK_MAX);
+    std::vector<char> result(1000);
+    // the range extends 500 bytes past the data the blocks have
+    CPPUNIT_ASSERT_EQUAL(std::size_t(500), bgzf::inflateBlocks(
+        reader, &boundaryBuffer.front(), blocks, 0, 1, 2000, &result.front(), result.size()));
+    CPPUNIT_ASSERT(std::equal(result.begin(), result.begin() + 500, data_.begin() + 2000));
+
+    bgzf::ParallelBgzfBlockInflater inflater(2);
+    CPPUNIT_ASSERT_EQUAL(std::size_t(500), inflater.inflate(blocks, 2000, &result.front(), result.size()));
+    CPPUNIT_ASSERT_EQUAL(std::size_t(0), inflater.inflate(blocks, 2500, &result.front(), result.size()));
+
+    // a corrupt block is reported rather than silently producing fewer bytes
+    std::vector<char> corrupt(compressed_.begin(), compressed_.begin() + blockOffsets_[1]);
+    corrupt[sizeof(bgzf::Header) + 3] ^= 0x55;
+    blocks.clear();
+    uncompressedOffset = 0;
+    bgzf::indexBlocks(&corrupt.front(), &corrupt.front() + corrupt.size(), uncompressedOffset, blocks);
+    CPPUNIT_ASSERT_EQUAL(1UL, blocks.size());
+    CPPUNIT_ASSERT_THROW(bgzf::inflateBlocks(
+        reader, &boundaryBuffer.front(), blocks, 0, 1, 0, &result.front(), result.size()), common::IsaacException);
+}
@@ -0,0 +1,47 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#ifndef iSAAC_BAM_TEST_BGZF_READER_HH
+#define iSAAC_BAM_TEST_BGZF_READER_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <vector>
+
+class TestBgzfReader : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( TestBgzfReader );
+    CPPUNIT_TEST( testIndexBlocks );
+    CPPUNIT_TEST( testIndexTruncated );
+    CPPUNIT_TEST( testInflateMultiBlock );
+    CPPUNIT_TEST( testInflateAcrossBlockBoundaries );
+    CPPUNIT_TEST( testInflateTruncated );
+    CPPUNIT_TEST_SUITE_END();
+private:
+    /// uncompressed stream the blocks are made of
+    std::vector<char> data_;
+    /// bgzf blocks of 1000, 0, 1500 and 700 bytes of data_
+    std::vector<char> compressed_;
+    /// offset of each block in compressed_
+    std::vector<std::size_t> blockOffsets_;
+public:
+    void setUp();
+    void tearDown();
+    void testIndexBlocks();
+    void testIndexTruncated();
+    void testInflateMultiBlock();
+    void testInflateAcrossBlockBoundaries();
+    void testInflateTruncated();
+};
+
+#endif // #ifndef iSAAC_BAM_TEST_BGZF_READER_HH
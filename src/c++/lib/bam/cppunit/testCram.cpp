@@ -0,0 +1,401 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#include <climits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+
+#include <boost/filesystem.hpp>
+#include <boost/iostreams/device/file.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+
+#include "RegistryName.hh"
+#include "testCram.hh"
+
+#include "bam/Cram.hh"
+#include "bam/CramIndex.hh"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( TestCram, registryName("Cram"));
+
+using namespace isaac::bam;
+
+void TestCram::setUp()
+{
+}
+
+void TestCram::tearDown()
+{
+}
+
+namespace
+{
+
+struct ContainerHeader
+{
+    int length_;
+    int refId_;
+    int alignmentStart_;
+    int alignmentSpan_;
+    int records_;
+    unsigned long recordCounter_;
+    unsigned long bases_;
+    int blocks_;
+    int landmarks_;
+    int landmark_;
+    bool crcMatches_;
+};
+
+/// parses the container header at p and leaves p pointing at the first block
+ContainerHeader readContainerHeader(const unsigned char *&p)
+{
+    const unsigned char *const begin = p;
+    ContainerHeader ret;
+    ret.length_ = readInt32(p);
+    ret.refId_ = readItf8(p);
+    ret.alignmentStart_ = readItf8(p);
+    ret.alignmentSpan_ = readItf8(p);
+    ret.records_ = readItf8(p);
+    ret.recordCounter_ = readLtf8(p);
+    ret.bases_ = readLtf8(p);
+    ret.blocks_ = readItf8(p);
+    ret.landmarks_ = readItf8(p);
+    ret.landmark_ = ret.landmarks_ ? readItf8(p) : -1;
+    const unsigned crc = crc32(0, begin, p - begin);
+    ret.crcMatches_ = int(crc) == readInt32(p);
+    return ret;
+}
+
+struct Block
+{
+    int method_;
+    int contentType_;
+    int contentId_;
+    int size_;
+    int rawSize_;
+    const unsigned char *data_;
+    bool crcMatches_;
+};
+
+/// parses the block at p and leaves p pointing past its crc32
+Block readBlock(const unsigned char *&p)
+{
+    const unsigned char *const begin = p;
+    Block ret;
+    ret.method_ = *p++;
+    ret.contentType_ = *p++;
+    ret.contentId_ = readItf8(p);
+    ret.size_ = readItf8(p);
+    ret.rawSize_ = readItf8(p);
+    ret.data_ = p;
+    p += ret.size_;
+    const unsigned crc = crc32(0, begin, p - begin);
+    ret.crcMatches_ = int(crc) == readInt32(p);
+    return ret;
+}
+
+/// single-slice container with a dummy compression header and an empty core block
+void appendContainer(
+    const int refId,
+    const int alignmentStart,
+    const int alignmentSpan,
+    const int records,
+    const unsigned long recordCounter,
+    std::vector<char> &out)
+{
+    CramBlockCompressor rawBlocks(0, 1024);
+    std::vector<char> blocks;
+    const std::string compressionHeader("compression header");
+    rawBlocks.appendBlock(
+        CRAM_COMPRESSION_HEADER, 0, compressionHeader.data(), compressionHeader.data() + compressionHeader.size(), blocks);
+    const int landmark = blocks.size();
+
+    std::vector<char> sliceHeader;
+    appendItf8(sliceHeader, refId);
+    appendItf8(sliceHeader, alignmentStart);
+    appendItf8(sliceHeader, alignmentSpan);
+    appendItf8(sliceHeader, records);
+    appendFixedLtf8(sliceHeader, recordCounter);
+    appendItf8(sliceHeader, 1);
+    appendItf8(sliceHeader, 0);
+    appendItf8(sliceHeader, -1);
+    sliceHeader.insert(sliceHeader.end(), 16, 0);
+    rawBlocks.appendBlock(CRAM_SLICE_HEADER, 0, &sliceHeader.front(), &sliceHeader.front() + sliceHeader.size(), blocks);
+    rawBlocks.appendBlock(CRAM_CORE_DATA, 0, 0, 0, blocks);
+
+    appendCramContainerHeader(
+        refId, alignmentStart, alignmentSpan, records, recordCounter, records * 100UL, 3, landmark, blocks.size(), out);
+    out.insert(out.end(), blocks.begin(), blocks.end());
+}
+
+/// record counter stored in the slice header of the container at p. Advances p past the container
+unsigned long readSliceRecordCounter(const unsigned char *&p, bool &crcMatches)
+{
+    const ContainerHeader header = readContainerHeader(p);
+    const unsigned char *const blocksBegin = p;
+    const unsigned char *block = blocksBegin + header.landmark_;
+    const Block sliceHeader = readBlock(block);
+    CPPUNIT_ASSERT_EQUAL(int(CRAM_SLICE_HEADER), sliceHeader.contentType_);
+    crcMatches = header.crcMatches_ && sliceHeader.crcMatches_;
+    const unsigned char *data = sliceHeader.data_;
+    readItf8(data);
+    readItf8(data);
+    readItf8(data);
+    CPPUNIT_ASSERT_EQUAL(header.records_, readItf8(data));
+    p = blocksBegin + header.length_;
+    return readLtf8(data);
+}
+
+} // namespace
+
+void TestCram::testItf8()
+{
+    const int values[] = {0, 0x7F, 0x80, 0x3FFF, 0x4000, 0x1FFFFF, 0x200000, 0xFFFFFFF, 0x10000000, INT_MAX, -1, INT_MIN};
+    const unsigned lengths[] = {1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 5, 5};
+    for (unsigned i = 0; sizeof(values) / sizeof(values[0]) != i; ++i)
+    {
+        std::vector<char> buffer;
+        appendItf8(buffer, values[i]);
+        CPPUNIT_ASSERT_EQUAL(lengths[i], unsigned(buffer.size()));
+        CPPUNIT_ASSERT_EQUAL(lengths[i], getItf8Length(values[i]));
+        const unsigned char *p = reinterpret_cast<const unsigned char *>(&buffer.front());
+        CPPUNIT_ASSERT_EQUAL(values[i], readItf8(p));
+        CPPUNIT_ASSERT_EQUAL(long(lengths[i]), long(p - reinterpret_cast<const unsigned char *>(&buffer.front())));
+    }
+
+    std::vector<char> buffer;
+    appendItf8(buffer, 0x80);
+    appendItf8(buffer, 0x4000);
+    appendItf8(buffer, -1);
+    const char expected[] = {char(0x80), char(0x80), char(0xC0), 0x40, 0x00, char(0xFF), char(0xFF), char(0xFF), char(0xFF), 0x0F};
+    CPPUNIT_ASSERT(std::vector<char>(expected, expected + sizeof(expected)) == buffer);
+}
+
+void TestCram::testLtf8()
+{
+    for (unsigned bytes = 1; 8 >= bytes; ++bytes)
+    {
+        // largest value that fits and the smallest one that does not
+        const unsigned long limit = 1UL << (7 * bytes);
+        const unsigned long values[] = {limit - 1, limit};
+        for (unsigned i = 0; 2 != i; ++i)
+        {
+            std::vector<char> buffer;
+            appendLtf8(buffer, values[i]);
+            CPPUNIT_ASSERT_EQUAL(bytes + i, unsigned(buffer.size()));
+            const unsigned char *p = reinterpret_cast<const unsigned char *>(&buffer.front());
+            CPPUNIT_ASSERT_EQUAL(values[i], readLtf8(p));
+            CPPUNIT_ASSERT_EQUAL(long(bytes + i), long(p - reinterpret_cast<const unsigned char *>(&buffer.front())));
+        }
+    }
+
+    std::vector<char> buffer;
+    appendLtf8(buffer, 0);
+    appendLtf8(buffer, 0x80);
+    appendLtf8(buffer, ~0UL);
+    const char expected[] = {0x00, char(0x80), char(0x80), char(0xFF),
+        char(0xFF), char(0xFF), char(0xFF), char(0xFF), char(0xFF), char(0xFF), char(0xFF), char(0xFF)};
+    CPPUNIT_ASSERT(std::vector<char>(expected, expected + sizeof(expected)) == buffer);
+
+    buffer.clear();
+    appendFixedLtf8(buffer, 5);
+    CPPUNIT_ASSERT_EQUAL(CRAM_LTF8_BYTES_MAX, unsigned(buffer.size()));
+    unsigned char *p = reinterpret_cast<unsigned char *>(&buffer.front());
+    const unsigned char *read = p;
+    CPPUNIT_ASSERT_EQUAL(5UL, readLtf8(read));
+    writeFixedLtf8(p, 1234567890123UL);
+    read = p;
+    CPPUNIT_ASSERT_EQUAL(1234567890123UL, readLtf8(read));
+    CPPUNIT_ASSERT_EQUAL(long(CRAM_LTF8_BYTES_MAX), long(read - p));
+}
+
+void TestCram::testContainerHeader()
+{
+    std::vector<char> buffer;
+    appendCramContainerHeader(2, 100000, 300, 10000, 123456, 1500000, 27, 45, 200000, buffer);
+    CPPUNIT_ASSERT(CRAM_CONTAINER_HEADER_BYTES_MAX >= buffer.size());
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(&buffer.front());
+    const ContainerHeader header = readContainerHeader(p);
+    CPPUNIT_ASSERT_EQUAL(long(buffer.size()), long(p - reinterpret_cast<const unsigned char *>(&buffer.front())));
+    CPPUNIT_ASSERT_EQUAL(200000, header.length_);
+    CPPUNIT_ASSERT_EQUAL(2, header.refId_);
+    CPPUNIT_ASSERT_EQUAL(100000, header.alignmentStart_);
+    CPPUNIT_ASSERT_EQUAL(300, header.alignmentSpan_);
+    CPPUNIT_ASSERT_EQUAL(10000, header.records_);
+    CPPUNIT_ASSERT_EQUAL(123456UL, header.recordCounter_);
+    CPPUNIT_ASSERT_EQUAL(1500000UL, header.bases_);
+    CPPUNIT_ASSERT_EQUAL(27, header.blocks_);
+    CPPUNIT_ASSERT_EQUAL(1, header.landmarks_);
+    CPPUNIT_ASSERT_EQUAL(45, header.landmark_);
+    CPPUNIT_ASSERT(header.crcMatches_);
+
+    // any change to the header bytes must break the crc
+    buffer[5] ^= 1;
+    p = reinterpret_cast<const unsigned char *>(&buffer.front());
+    CPPUNIT_ASSERT(!readContainerHeader(p).crcMatches_);
+}
+
+void TestCram::testBlock()
+{
+    const std::string compressible(1000, 'A');
+    const std::string incompressible("ACGT");
+    std::vector<char> buffer;
+    CramBlockCompressor compressor(6, compressible.size());
+    compressor.appendBlock(CRAM_EXTERNAL_DATA, 7, compressible.data(), compressible.data() + compressible.size(), buffer);
+    compressor.appendBlock(CRAM_EXTERNAL_DATA, 0x42430A, incompressible.data(), incompressible.data() + incompressible.size(), buffer);
+    compressor.appendBlock(CRAM_CORE_DATA, 0, 0, 0, buffer);
+
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(&buffer.front());
+    const Block gzipped = readBlock(p);
+    CPPUNIT_ASSERT_EQUAL(1, gzipped.method_);
+    CPPUNIT_ASSERT_EQUAL(int(CRAM_EXTERNAL_DATA), gzipped.contentType_);
+    CPPUNIT_ASSERT_EQUAL(7, gzipped.contentId_);
+    CPPUNIT_ASSERT_EQUAL(int(compressible.size()), gzipped.rawSize_);
+    CPPUNIT_ASSERT(gzipped.size_ < gzipped.rawSize_);
+    CPPUNIT_ASSERT(gzipped.crcMatches_);
+    std::vector<char> inflated(gzipped.rawSize_);
+    uLongf inflatedSize = inflated.size();
+    z_stream zstream = z_stream();
+    CPPUNIT_ASSERT_EQUAL(Z_OK, inflateInit2(&zstream, 15 + 16));
+    zstream.next_in = const_cast<Bytef*>(gzipped.data_);
+    zstream.avail_in = gzipped.size_;
+    zstream.next_out = reinterpret_cast<Bytef*>(&inflated.front());
+    zstream.avail_out = inflatedSize;
+    CPPUNIT_ASSERT_EQUAL(Z_STREAM_END, inflate(&zstream, Z_FINISH));
+    CPPUNIT_ASSERT_EQUAL(inflatedSize, uLongf(zstream.total_out));
+    inflateEnd(&zstream);
+    CPPUNIT_ASSERT_EQUAL(compressible, std::string(inflated.begin(), inflated.end()));
+
+    const Block raw = readBlock(p);
+    CPPUNIT_ASSERT_EQUAL(0, raw.method_);
+    CPPUNIT_ASSERT_EQUAL(0x42430A, raw.contentId_);
+    CPPUNIT_ASSERT_EQUAL(int(incompressible.size()), raw.size_);
+    CPPUNIT_ASSERT_EQUAL(int(incompressible.size()), raw.rawSize_);
+    CPPUNIT_ASSERT_EQUAL(incompressible, std::string(raw.data_, raw.data_ + raw.size_));
+    CPPUNIT_ASSERT(raw.crcMatches_);
+
+    const Block empty = readBlock(p);
+    CPPUNIT_ASSERT_EQUAL(0, empty.method_);
+    CPPUNIT_ASSERT_EQUAL(int(CRAM_CORE_DATA), empty.contentType_);
+    CPPUNIT_ASSERT_EQUAL(0, empty.rawSize_);
+    CPPUNIT_ASSERT(empty.crcMatches_);
+    CPPUNIT_ASSERT_EQUAL(long(buffer.size()), long(p - reinterpret_cast<const unsigned char *>(&buffer.front())));
+}
+
+void TestCram::testEof()
+{
+    std::ostringstream os;
+    serializeCramEof(os);
+    const std::string eof = os.str();
+    CPPUNIT_ASSERT_EQUAL(38UL, eof.size());
+
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(eof.data());
+    const ContainerHeader header = readContainerHeader(p);
+    CPPUNIT_ASSERT_EQUAL(15, header.length_);
+    CPPUNIT_ASSERT_EQUAL(-1, header.refId_);
+    // 'EOF' spelled in the alignment start
+    CPPUNIT_ASSERT_EQUAL(0x454F46, header.alignmentStart_);
+    CPPUNIT_ASSERT_EQUAL(0, header.records_);
+    CPPUNIT_ASSERT_EQUAL(1, header.blocks_);
+    CPPUNIT_ASSERT_EQUAL(0, header.landmarks_);
+    CPPUNIT_ASSERT(header.crcMatches_);
+
+    const unsigned char *const blocksBegin = p;
+    const Block compressionHeader = readBlock(p);
+    CPPUNIT_ASSERT_EQUAL(int(CRAM_COMPRESSION_HEADER), compressionHeader.contentType_);
+    CPPUNIT_ASSERT_EQUAL(6, compressionHeader.rawSize_);
+    CPPUNIT_ASSERT(compressionHeader.crcMatches_);
+    CPPUNIT_ASSERT_EQUAL(long(header.length_), long(p - blocksBegin));
+    CPPUNIT_ASSERT_EQUAL(long(eof.size()), long(p - reinterpret_cast<const unsigned char *>(eof.data())));
+}
+
+void TestCram::testRecordCounters()
+{
+    std::vector<char> containers;
+    appendContainer(0, 1, 100, 3, 0, containers);
+    appendContainer(0, 101, 100, 2, 3, containers);
+    appendContainer(-1, 0, 0, 4, 5, containers);
+
+    unsigned long recordCounter = 1000;
+    offsetCramRecordCounters(&containers.front(), &containers.front() + containers.size(), recordCounter);
+    CPPUNIT_ASSERT_EQUAL(1009UL, recordCounter);
+
+    const unsigned long expected[] = {1000, 1003, 1005};
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(&containers.front());
+    for (unsigned i = 0; 3 != i; ++i)
+    {
+        const unsigned char *container = p;
+        CPPUNIT_ASSERT_EQUAL(expected[i], readContainerHeader(container).recordCounter_);
+        bool crcMatches = false;
+        CPPUNIT_ASSERT_EQUAL(expected[i], readSliceRecordCounter(p, crcMatches));
+        CPPUNIT_ASSERT(crcMatches);
+    }
+    CPPUNIT_ASSERT_EQUAL(long(containers.size()), long(p - reinterpret_cast<const unsigned char *>(&containers.front())));
+}
+
+void TestCram::testIndex()
+{
+    const boost::filesystem::path cramPath =
+        boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("testCram-%%%%-%%%%.cram");
+    const unsigned long headerLength = 1234;
+
+    std::vector<char> first;
+    appendContainer(0, 1, 100, 3, 0, first);
+    const std::size_t secondOffset = first.size();
+    appendContainer(1, 70000, 250, 2, 3, first);
+    std::vector<char> unaligned;
+    appendContainer(-1, 0, 0, 4, 5, unaligned);
+
+    {
+        CramIndex index(cramPath, headerLength);
+        index.processContainers(first);
+        index.processContainers(unaligned);
+        index.flush();
+    }
+
+    std::vector<std::string> rows;
+    {
+        boost::iostreams::filtering_istream is;
+        is.push(boost::iostreams::gzip_decompressor());
+        is.push(boost::iostreams::file_source(cramPath.string() + ".crai", std::ios_base::binary));
+        std::string row;
+        while (std::getline(is, row))
+        {
+            rows.push_back(row);
+        }
+    }
+    boost::filesystem::remove(cramPath.string() + ".crai");
+
+    CPPUNIT_ASSERT_EQUAL(3UL, rows.size());
+    // every container has the same compression header block in front of the slice
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(&first.front());
+    const ContainerHeader firstHeader = readContainerHeader(p);
+    const int landmark = firstHeader.landmark_;
+    p = reinterpret_cast<const unsigned char *>(&first.front()) + secondOffset;
+    const ContainerHeader secondHeader = readContainerHeader(p);
+    p = reinterpret_cast<const unsigned char *>(&unaligned.front());
+    const ContainerHeader unalignedHeader = readContainerHeader(p);
+
+    std::ostringstream expected;
+    expected << "0\t1\t100\t" << headerLength << "\t" << landmark << "\t" << firstHeader.length_ - landmark;
+    CPPUNIT_ASSERT_EQUAL(expected.str(), rows.at(0));
+    expected.str("");
+    expected << "1\t70000\t250\t" << headerLength + secondOffset << "\t" << landmark << "\t" << secondHeader.length_ - landmark;
+    CPPUNIT_ASSERT_EQUAL(expected.str(), rows.at(1));
+    expected.str("");
+    expected << "-1\t0\t0\t" << headerLength + first.size() << "\t" << landmark << "\t" << unalignedHeader.length_ - landmark;
+    CPPUNIT_ASSERT_EQUAL(expected.str(), rows.at(2));
+}
@@ -0,0 +1,42 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#ifndef iSAAC_BAM_TEST_CRAM_HH
+#define iSAAC_BAM_TEST_CRAM_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class TestCram : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( TestCram );
+    CPPUNIT_TEST( testItf8 );
+    CPPUNIT_TEST( testLtf8 );
+    CPPUNIT_TEST( testContainerHeader );
+    CPPUNIT_TEST( testBlock );
+    CPPUNIT_TEST( testEof );
+    CPPUNIT_TEST( testRecordCounters );
+    CPPUNIT_TEST( testIndex );
+    CPPUNIT_TEST_SUITE_END();
+public:
+    void setUp();
+    void tearDown();
+    void testItf8();
+    void testLtf8();
+    void testContainerHeader();
+    void testBlock();
+    void testEof();
+    void testRecordCounters();
+    void testIndex();
+};
+
+#endif // #ifndef iSAAC_BAM_TEST_CRAM_HH
@@ -17,6 +17,8 @@
  ** \author Roman Petrovski
  **/
 
+#include <numeric>
+
 #include <boost/format.hpp>
 #include <boost/iostreams/filtering_stream.hpp>
 #include <boost/iostreams/filter/gzip.hpp>
@@ -83,13 +85,18 @@ unsigned BgzfReader::readNextBlock(std::istream &is)
 }
 
 void BgzfReader::uncompressCurrentBlock(char* p, const std::size_t size)
+{
+    uncompressBlock(&compressedBlockBuffer_.front(), compressedBlockBuffer_.size(), p, size);
+}
+
+void BgzfReader::uncompressBlock(const char *block, const std::size_t blockSize, char* p, const std::size_t size)
 {
     reset();
     strm_.next_out = reinterpret_cast<Bytef *>(p);
     strm_.avail_out = size;
 
-    strm_.next_in = reinterpret_cast<Bytef *>(&compressedBlockBuffer_.front());
-    strm_.avail_in = compressedBlockBuffer_.size();
+    strm_.next_in = reinterpret_cast<Bytef *>(const_cast<char*>(block));
+    strm_.avail_in = blockSize;
     int err = inflate(&strm_, Z_SYNC_FLUSH);
     if (Z_OK != err && Z_STREAM_END != err)
     {
@@ -97,8 +104,6 @@ void BgzfReader::uncompressCurrentBlock(char* p, const std::size_t size)
     }
     const std::size_t decompressedBytes = size - strm_.avail_out;
 
-    boost::iostreams::basic_array_source<char> src(&compressedBlockBuffer_.front(), compressedBlockBuffer_.size());
-
     if (decompressedBytes != size)
     {
         BOOST_THROW_EXCEPTION(common::IoException(EINVAL, (boost::format("Unexpected number of BGZF bytes uncompressed. "
@@ -106,6 +111,102 @@ void BgzfReader::uncompressCurrentBlock(char* p, const std::size_t size)
     }
 }
 
+const char *indexBlocks(
+    const char *begin, const char *end,
+    unsigned long &uncompressedOffset,
+    std::vector<BlockLocation> &blocks)
+{
+    while (std::size_t(end - begin) >= sizeof(bgzf::Header))
+    {
+        const bgzf::Header &header = *reinterpret_cast<const bgzf::Header *>(begin);
+        validateHeader(header);
+        const std::size_t blockSize = header.xfield.getBSIZE() + 1;
+        if (std::size_t(end - begin) < blockSize)
+        {
+            break;
+        }
+
+        const bgzf::Footer &footer = *reinterpret_cast<const bgzf::Footer*>(begin + blockSize - sizeof(bgzf::Footer));
+        if (footer.getISIZE())
+        {
+            ISAAC_ASSERT_MSG(blocks.capacity() > blocks.size(), "Insufficient capacity to index bgzf blocks " << blocks.capacity());
+            blocks.push_back(BlockLocation(begin, blockSize, uncompressedOffset, footer.getISIZE()));
+            uncompressedOffset += footer.getISIZE();
+        }
+        begin += blockSize;
+    }
+    return begin;
+}
+
+std::size_t inflateBlocks(
+    BgzfReader &reader,
+    char *boundaryBuffer,
+    const std::vector<BlockLocation> &blocks,
+    const unsigned firstBlock,
+    const unsigned step,
+    const unsigned long skipBytes,
+    char *destination,
+    const std::size_t size)
+{
+    const unsigned long rangeEnd = skipBytes + size;
+    std::size_t ret = 0;
+    for (unsigned i = firstBlock; blocks.size() > i; i += step)
+    {
+        const BlockLocation &block = blocks[i];
+        const unsigned long blockEnd = block.uncompressedOffset_ + block.uncompressedSize_;
+        if (blockEnd <= skipBytes || block.uncompressedOffset_ >= rangeEnd)
+        {
+            continue;
+        }
+
+        if (block.uncompressedOffset_ >= skipBytes && blockEnd <= rangeEnd)
+        {
+            reader.uncompressBlock(block.compressed_, block.compressedSize_,
+                                   destination + block.uncompressedOffset_ - skipBytes, block.uncompressedSize_);
+            ret += block.uncompressedSize_;
+        }
+        else
+        {
+            ISAAC_ASSERT_MSG(ParallelBgzfBlockInflater::UNCOMPRESSED_BLOCK_MAX >= block.uncompressedSize_,
+                             "Unexpectedly large bgzf block " << block.uncompressedSize_);
+            reader.uncompressBlock(block.compressed_, block.compressedSize_, boundaryBuffer, block.uncompressedSize_);
+            const unsigned long copyBegin = std::max(block.uncompressedOffset_, skipBytes);
+            const unsigned long copyEnd = std::min(blockEnd, rangeEnd);
+            std::copy(boundaryBuffer + copyBegin - block.uncompressedOffset_,
+                      boundaryBuffer + copyEnd - block.uncompressedOffset_,
+                      destination + copyBegin - skipBytes);
+            ret += copyEnd - copyBegin;
+        }
+    }
+    return ret;
+}
+
+std::size_t ParallelBgzfBlockInflater::inflate(
+    const std::vector<BlockLocation> &blocks,
+    const unsigned long skipBytes,
+    char *destination,
+    const std::size_t size)
+{
+    const unsigned threads = std::max<unsigned>(1, std::min<std::size_t>(threads_.size(), blocks.size()));
+    std::fill(inflatedBytes_.begin(), inflatedBytes_.end(), 0);
+    threads_.execute(boost::bind(&ParallelBgzfBlockInflater::inflateParallel, this, _1,
+                                 boost::ref(blocks), threads, skipBytes, destination, size), threads);
+    return std::accumulate(inflatedBytes_.begin(), inflatedBytes_.end(), std::size_t(0));
+}
+
+void ParallelBgzfBlockInflater::inflateParallel(
+    const unsigned threadNumber,
+    const std::vector<BlockLocation> &blocks,
+    const unsigned threads,
+    const unsigned long skipBytes,
+    char *destination,
+    const std::size_t size)
+{
+    inflatedBytes_.at(threadNumber) = inflateBlocks(
+        readers_.at(threadNumber), &boundaryBuffers_.at(threadNumber).front(),
+        blocks, threadNumber, threads, skipBytes, destination, size);
+}
+
 void ParallelBgzfReader::open(const boost::filesystem::path &bamPath)
 {
     fileBuffer_.reopen(bamPath.c_str(), io::FileBufWithReopen::SequentialOnce);
@@ -26,6 +26,7 @@
 #include "bam/Bam.hh"
 
 #include "build/BinSorter.hh"
+#include "common/BucketSort.hpp"
 #include "common/Memory.hh"
 
 namespace isaac
@@ -73,6 +74,47 @@ unsigned long BinSorter::serialize(
     return size();
 }
 
+unsigned long BinSorter::serialize(CramSerializer::CramSliceEncoders &cramEncoders)
+{
+    ISAAC_THREAD_CERR << "Encoding cram records: " << getUniqueRecordsCount() <<  " of them for bin " << bin_ << std::endl;
+
+    common::TimeSpec serTimeStart;
+    ISAAC_ASSERT_MSG(-1 != clock_gettime(CLOCK_REALTIME, &serTimeStart), "clock_gettime failed, errno: " << errno << strerror(errno));
+
+    if (isUnalignedBin())
+    {
+        unsigned long offset = 0;
+        while(data_.size() != offset)
+        {
+            const io::FragmentAccessor &fragment = data_.getFragment(offset);
+            cramSerializer_(fragment, cramEncoders);
+            offset += fragment.getTotalLength();
+        }
+    }
+    else
+    {
+        const BaseType &v(*this);
+        BOOST_FOREACH(const PackedFragmentBuffer::Index& idx, v)
+        {
+            cramSerializer_(idx, cramEncoders, data_);
+        }
+    }
+
+    BOOST_FOREACH(const boost::shared_ptr<CramSliceEncoder> &encoder, cramEncoders)
+    {
+        if (encoder)
+        {
+            encoder->flush();
+        }
+    }
+
+    common::TimeSpec serTimeEnd;
+    ISAAC_ASSERT_MSG(-1 != clock_gettime(CLOCK_REALTIME, &serTimeEnd), "clock_gettime failed, errno: " << errno << strerror(errno));
+
+    ISAAC_THREAD_CERR << "Encoding cram records done: " << getUniqueRecordsCount() <<  " of them for bin " << bin_ << " in " << common::tsdiff(serTimeStart, serTimeEnd) << "seconds." << std::endl;
+    return size();
+}
+
 void verifyFragmentIntegrity(const io::FragmentAccessor &fragment)
 {
 /*
@@ -291,7 +333,8 @@ void BinSorter::loadAlignedData()
 
 
 void BinSorter::resolveDuplicates(
-    BuildStats &buildStats)
+    BuildStats &buildStats,
+    BinMetrics &binMetrics)
 {
     NotAFilter().filterInput(data_, seIdxFileContent_.begin(), seIdxFileContent_.end(), buildStats, binStatsIndex_, std::back_inserter<BaseType>(*this));
     if (keepDuplicates_ && !markDuplicates_)
@@ -307,7 +350,8 @@ void BinSorter::resolveDuplicates(
                 RSDuplicateFilter<true>(barcodeBamMapping_.getSampleIndexMap()),
                 data_, rIdxFileContent_.begin(), rIdxFileContent_.end(),
                 buildStats, binStatsIndex_, std::back_inserter<BaseType>(*this));
-            DuplicatePairEndFilter(keepDuplicates_).filterInput(
+            // forward strand reads are enough to count each pair once
+            DuplicatePairEndFilter(keepDuplicates_, &binMetrics).filterInput(
                 FDuplicateFilter<true>(barcodeBamMapping_.getSampleIndexMap()),
                 data_, fIdxFileContent_.begin(), fIdxFileContent_.end(),
                 buildStats, binStatsIndex_, std::back_inserter<BaseType>(*this));
@@ -318,7 +362,8 @@ void BinSorter::resolveDuplicates(
                 RSDuplicateFilter<false>(barcodeBamMapping_.getSampleIndexMap()),
                 data_, rIdxFileContent_.begin(), rIdxFileContent_.end(),
                 buildStats, binStatsIndex_, std::back_inserter<BaseType>(*this));
-            DuplicatePairEndFilter(keepDuplicates_).filterInput(
+            // forward strand reads are enough to count each pair once
+            DuplicatePairEndFilter(keepDuplicates_, &binMetrics).filterInput(
                 FDuplicateFilter<false>(barcodeBamMapping_.getSampleIndexMap()),
                 data_, fIdxFileContent_.begin(), fIdxFileContent_.end(),
                 buildStats, binStatsIndex_, std::back_inserter<BaseType>(*this));
@@ -326,6 +371,43 @@ void BinSorter::resolveDuplicates(
     }
 }
 
+/**
+ * \brief Data distribution chunk of the position. Positions outside the bin are assigned to the first or the
+ *        last chunk so that the chunk order agrees with orderForBam.
+ */
+inline std::size_t BinSorter::getPositionChunk(const reference::ReferencePosition pos) const
+{
+    if (pos < bin_.getBinStart())
+    {
+        return 0;
+    }
+    if (!(pos < bin_.getBinEnd()))
+    {
+        return dataDistribution_.size() - 1;
+    }
+    return std::min<std::size_t>((pos - bin_.getBinStart()) / dataDistribution_.getChunkSize(), dataDistribution_.size() - 1);
+}
+
+/**
+ * \brief Orders the index for bam. With pre-sorted bins, the index is first distributed in place between the
+ *        data distribution chunks (American flag sort), then each chunk is sorted on its own. Chunks are small
+ *        and their fragments occupy a contiguous range of data_, so the comparisons stay in cache. The chunk is
+ *        computed from the current position, so fragments moved by gap realignment end up in the right place.
+ */
+void BinSorter::sortByChunks()
+{
+    const std::size_t chunks = dataDistribution_.size();
+    if (isUnalignedBin() || 2 >= chunks || empty())
+    {
+        std::sort(begin(), end(), boost::bind(&PackedFragmentBuffer::orderForBam, boost::ref(data_), _1, _2));
+        return;
+    }
+
+    common::bucketSort(begin(), end(), chunks, boost::bind(&BinSorter::getIndexChunk, this, _1),
+                       boost::bind(&PackedFragmentBuffer::orderForBam, boost::ref(data_), _1, _2),
+                       chunkNext_, chunkEnds_);
+}
+
 inline size_t getTotalGapsCount(const std::vector<RealignerGaps> &allGaps)
 {
     return std::accumulate(allGaps.begin(), allGaps.end(), 0,
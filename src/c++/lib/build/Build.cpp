@@ -31,10 +31,12 @@
 
 #include "bam/Bam.hh"
 #include "bam/BamIndexer.hh"
+#include "bam/Cram.hh"
 #include "bgzf/BgzfCompressor.hh"
 #include "build/Build.hh"
 #include "common/Debug.hh"
 #include "common/FileSystem.hh"
+#include "common/Profiling.hh"
 #include "common/Threads.hpp"
 #include "io/Fragment.hh"
 #include "reference/ContigLoader.hh"
@@ -60,17 +62,13 @@ static unsigned long getBinTotalSize(const alignment::BinMetadata & binMetadata)
         binMetadata.getSeIdxElements() * sizeof(SeFragmentIndex);
 }
 
-unsigned long Build::estimateBinCompressedDataRequirements(
+/**
+ * \return number of bin fragments that go into the output file
+ */
+unsigned long Build::getOutputFileBinElements(
     const alignment::BinMetadata & binMetadata,
     const unsigned outputFileIndex) const
 {
-    // TODO: puth the real number in here.
-    static const unsigned long EMPTY_BGZF_BLOCK_SIZE = 1234UL;
-    if (!binMetadata.getTotalElements())
-    {
-        return EMPTY_BGZF_BLOCK_SIZE;
-    }
-
     unsigned long thisOutputFileBarcodeElements = 0;
     // accumulate size required to store all barcodes that map to the same output file
     BOOST_FOREACH(const flowcell::BarcodeMetadata& barcode, barcodeMetadataList_)
@@ -84,18 +82,37 @@ unsigned long Build::estimateBinCompressedDataRequirements(
             thisOutputFileBarcodeElements += binMetadata.getBarcodeElements(barcodeIndex);
         }
     }
+    return thisOutputFileBarcodeElements;
+}
+
+unsigned long Build::estimateBinCompressedDataRequirements(
+    const alignment::BinMetadata & binMetadata,
+    const unsigned outputFileIndex) const
+{
+    // TODO: puth the real number in here.
+    static const unsigned long EMPTY_BGZF_BLOCK_SIZE = 1234UL;
+    if (!binMetadata.getTotalElements())
+    {
+        return EMPTY_BGZF_BLOCK_SIZE;
+    }
+
+    const unsigned long thisOutputFileBarcodeElements = getOutputFileBinElements(binMetadata, outputFileIndex);
+    // cram containers are produced in place, so there must be enough room for a whole uncompressed one on top
+    const unsigned long cramContainerBytes = OUTPUT_CRAM == outputFormat_ && thisOutputFileBarcodeElements ?
+        CramSliceEncoder::getMaxContainerBytes(maxReadLength_) : 0;
 
     // assume all data will take the same fraction or less than the number derived from demultiplexed fragments.
-    return EMPTY_BGZF_BLOCK_SIZE +
+    return EMPTY_BGZF_BLOCK_SIZE + cramContainerBytes +
         ((getBinTotalSize(binMetadata) * thisOutputFileBarcodeElements +
             binMetadata.getTotalElements() - 1) / binMetadata.getTotalElements()) * expectedBgzfCompressionRatio_;
 }
 
 inline boost::filesystem::path getSampleBamPath(
     const boost::filesystem::path &outputDirectory,
+    const std::string &fileName,
     const flowcell::BarcodeMetadata &barcode)
 {
-    return outputDirectory / barcode.getProject() / barcode.getSampleName() / "sorted.bam";
+    return outputDirectory / barcode.getProject() / barcode.getSampleName() / fileName;
 }
 /**
  * \brief Produces mapping so that all barcodes having the same sample name go into the same output file.
@@ -106,6 +123,7 @@ inline boost::filesystem::path getSampleBamPath(
  */
 BarcodeBamMapping mapBarcodesToFiles(
     const boost::filesystem::path &outputDirectory,
+    const std::string &fileName,
     const flowcell::BarcodeMetadataList &barcodeMetadataList)
 {
     // Map barcodes to projects
@@ -125,7 +143,7 @@ BarcodeBamMapping mapBarcodesToFiles(
     // Map barcodes to sample paths
     std::vector<boost::filesystem::path> samples;
     std::transform(barcodeMetadataList.begin(), barcodeMetadataList.end(), std::back_inserter(samples),
-                   boost::bind(&getSampleBamPath, outputDirectory, _1));
+                   boost::bind(&getSampleBamPath, outputDirectory, boost::cref(fileName), _1));
     std::sort(samples.begin(), samples.end());
     samples.erase(std::unique(samples.begin(), samples.end()), samples.end());
 
@@ -134,7 +152,7 @@ BarcodeBamMapping mapBarcodesToFiles(
     {
         barcodeSample.at(barcode.getIndex()) =
             std::distance(samples.begin(), std::lower_bound(samples.begin(), samples.end(),
-                                                            getSampleBamPath(outputDirectory, barcode)));
+                                                            getSampleBamPath(outputDirectory, fileName, barcode)));
     }
 
     return BarcodeBamMapping(barcodeProject, barcodeSample, samples);
@@ -175,12 +193,40 @@ inline bool orderBySampleIndex(
     return barcodeBamMapping.getSampleIndex(left.getIndex()) < barcodeBamMapping.getSampleIndex(right.getIndex());
 }
 
+/**
+ * \brief Opens the sink for the output file data. When streaming is requested, the data goes into the stream
+ *        destination while the index and md5 files are still produced next to filePath.
+ *
+ * \param outputStreamUsed  set to true once the stream destination is taken. Only one file can be streamed.
+ */
+io::FileSinkWithMd5 Build::createOutputFileSink(
+    const boost::filesystem::path &filePath,
+    bool &outputStreamUsed) const
+{
+    if (bamStreamDestination_.empty())
+    {
+        return io::FileSinkWithMd5(filePath.c_str(), std::ios_base::binary);
+    }
+
+    // AlignOptions ensures there is a single sample with mapped reference when streaming
+    ISAAC_ASSERT_MSG(!outputStreamUsed, "Only one output file can be streamed to " << bamStreamDestination_ <<
+                     ". Unable to stream " << filePath << " as well");
+    outputStreamUsed = true;
+
+    const std::string sinkPath = "-" == bamStreamDestination_ ? "/dev/stdout" : bamStreamDestination_;
+    // opening a named pipe blocks until the reader appears
+    ISAAC_THREAD_CERR << "Streaming " << filePath << " into " << sinkPath << std::endl;
+    return io::FileSinkWithMd5(sinkPath, filePath, std::ios_base::binary);
+}
+
 std::vector<boost::shared_ptr<boost::iostreams::filtering_ostream> > Build::createOutputFileStreams(
     const flowcell::TileMetadataList &tileMetadataList,
     const flowcell::BarcodeMetadataList &barcodeMetadataList,
-    boost::ptr_vector<bam::BamIndex> &bamIndexes) const
+    boost::ptr_vector<bam::BamIndex> &bamIndexes,
+    boost::ptr_vector<bam::CramIndex> &cramIndexes) const
 {
     unsigned sinkIndexToCreate = 0;
+    bool outputStreamUsed = false;
     std::vector<boost::shared_ptr<boost::iostreams::filtering_ostream> > ret;
     ret.reserve(barcodeBamMapping_.getTotalSamples());
 
@@ -201,7 +247,42 @@ std::vector<boost::shared_ptr<boost::iostreams::filtering_ostream> > Build::crea
         if (sinkIndexToCreate == barcodeBamMapping_.getSampleIndex(barcode.getIndex()))
         {
             const boost::filesystem::path &bamPath = barcodeBamMapping_.getFilePath(barcode);
-            if (!barcode.isUnmappedReference())
+            if (barcode.isUnmappedReference())
+            {
+                ret.push_back(boost::shared_ptr<boost::iostreams::filtering_ostream>());
+                bamIndexes.push_back(new bam::BamIndex());
+                cramIndexes.push_back(new bam::CramIndex());
+                ISAAC_THREAD_CERR << "Skipped BAM file due to unmapped barcode reference: " << bamPath << " " << barcode << std::endl;
+            }
+            else if (OUTPUT_CRAM == outputFormat_)
+            {
+                ISAAC_THREAD_CERR << "Created CRAM file: " << bamPath << std::endl;
+
+                const reference::SortedReferenceMetadata &sampleReference =
+                    sortedReferenceMetadataList_.at(barcode.getReferenceIndex());
+                const std::string headerText = bam::makeHeaderText(
+                    argv_, description_, bamHeaderTags_, bamPuFormat_,
+                    makeSortedReferenceXmlBamHeaderAdapter(
+                        sampleReference,
+                        boost::bind(&BuildContigMap::isMapped, &contigMap_, barcode.getReferenceIndex(), _1),
+                        tileMetadataList, barcodeMetadataList,
+                        barcode.getSampleName()));
+
+                ret.push_back(boost::shared_ptr<boost::iostreams::filtering_ostream>(new boost::iostreams::filtering_ostream()));
+                boost::iostreams::filtering_ostream &cramStream = *ret.back();
+                cramStream.push(createOutputFileSink(bamPath, outputStreamUsed));
+                if (!cramStream) {
+                    BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to open output CRAM file " + bamPath.string()));
+                }
+
+                bam::serializeCramFileDefinition(cramStream, barcode.getSampleName());
+                const std::size_t headerContainerLength = bam::serializeCramHeaderContainer(cramStream, headerText);
+
+                bamIndexes.push_back(new bam::BamIndex());
+                cramIndexes.push_back(
+                    new bam::CramIndex(bamPath, bam::CRAM_FILE_DEFINITION_BYTES + headerContainerLength));
+            }
+            else
             {
                 ISAAC_THREAD_CERR << "Created BAM file: " << bamPath << std::endl;
 
@@ -230,7 +311,7 @@ std::vector<boost::shared_ptr<boost::iostreams::filtering_ostream> > Build::crea
 
                 ret.push_back(boost::shared_ptr<boost::iostreams::filtering_ostream>(new boost::iostreams::filtering_ostream()));
                 boost::iostreams::filtering_ostream &bamStream = *ret.back();
-                bamStream.push(io::FileSinkWithMd5(bamPath.c_str(), std::ios_base::binary));
+                bamStream.push(createOutputFileSink(bamPath, outputStreamUsed));
                 if (!bamStream) {
                     BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to open output BAM file " + bamPath.string()));
                 }
@@ -247,12 +328,7 @@ std::vector<boost::shared_ptr<boost::iostreams::filtering_ostream> > Build::crea
                 unsigned contigCount = sampleReference.getContigsCount(
                     boost::bind(&BuildContigMap::isMapped, &contigMap_, barcode.getReferenceIndex(), _1));
                 bamIndexes.push_back(new bam::BamIndex(bamPath, contigCount, headerCompressedLength));
-            }
-            else
-            {
-                ret.push_back(boost::shared_ptr<boost::iostreams::filtering_ostream>());
-                bamIndexes.push_back(new bam::BamIndex());
-                ISAAC_THREAD_CERR << "Skipped BAM file due to unmapped barcode reference: " << bamPath << " " << barcode << std::endl;
+                cramIndexes.push_back(new bam::CramIndex());
             }
             ++sinkIndexToCreate;
         }
@@ -367,6 +443,7 @@ Build::Build(const std::vector<std::string> &argv,
              const alignment::BinMetadataList &bins,
              const std::vector<alignment::TemplateLengthStatistics> &barcodeTemplateLengthStatistics,
              const reference::SortedReferenceMetadataList &sortedReferenceMetadataList,
+             const reference::SharedContigsList &sharedContigsList,
              const boost::filesystem::path outputDirectory,
              const unsigned maxLoaders,
              const unsigned maxComputers,
@@ -388,7 +465,11 @@ Build::Build(const std::vector<std::string> &argv,
              const bool keepUnaligned,
              const bool putUnalignedInTheBack,
              const IncludeTags includeTags,
-             const bool pessimisticMapQ)
+             const bool pessimisticMapQ,
+             const OutputFormat outputFormat,
+             const std::string &bamStreamDestination,
+             const unsigned coverageTileSize,
+             common::MemoryGovernor &memoryGovernor)
     :argv_(argv),
      description_(description),
      flowcellLayoutList_(flowcellLayoutList),
@@ -420,17 +501,29 @@ Build::Build(const std::vector<std::string> &argv,
      maxReadLength_(getMaxReadLength(flowcellLayoutList_)),
      includeTags_(includeTags),
      pessimisticMapQ_(pessimisticMapQ),
+     outputFormat_(outputFormat),
+     bamStreamDestination_(bamStreamDestination),
+     memoryGovernor_(memoryGovernor),
      forceTermination_(false),
      threads_(maxComputers_ + maxLoaders_ + maxSavers_),
-     contigList_(reference::loadContigs(sortedReferenceMetadataList, contigMap_, threads_)),
-     barcodeBamMapping_(mapBarcodesToFiles(outputDirectory_, barcodeMetadataList_)),
+     contigList_(reference::loadContigs(sortedReferenceMetadataList, contigMap_, threads_, &sharedContigsList)),
+     barcodeBamMapping_(mapBarcodesToFiles(
+         outputDirectory_, OUTPUT_CRAM == outputFormat_ ? "sorted.cram" : "sorted.bam", barcodeMetadataList_)),
      bamIndexes_(),
-     bamFileStreams_(createOutputFileStreams(tileMetadataList_, barcodeMetadataList_, bamIndexes_)),
+     cramIndexes_(),
+     bamFileStreams_(createOutputFileStreams(tileMetadataList_, barcodeMetadataList_, bamIndexes_, cramIndexes_)),
+     cramRecordCounters_(bamFileStreams_.size(), 0),
      stats_(bins_, barcodeMetadataList_),
+     metrics_(barcodeBamMapping_, barcodeMetadataList_, sortedReferenceMetadataList_, maxReadLength_, coverageTileSize,
+              !keepDuplicates_ || markDuplicates_),
      threadBinSorters_(threads_.size()),
      threadBgzfBuffers_(threads_.size(), std::vector<std::vector<char> >(bamFileStreams_.size())),
      threadBgzfStreams_(threads_.size()),
-     threadBamIndexParts_(threads_.size())
+     threadBamIndexParts_(threads_.size()),
+     threadCramEncoders_(threads_.size()),
+     threadSorterReservations_(threads_.size()),
+     threadBufferReservations_(threads_.size()),
+     binMetricsReservation_(memoryGovernor_)
 {
     computeSlotWaitingBins_.reserve(threads_.size());
     while(threadBgzfStreams_.size() < threads_.size())
@@ -441,10 +534,44 @@ Build::Build(const std::vector<std::string> &argv,
     {
         threadBamIndexParts_.push_back(new boost::ptr_vector<bam::BamIndexPart>(bamFileStreams_.size()));
     }
+    while(threadSorterReservations_.size() < threads_.size())
+    {
+        threadSorterReservations_.push_back(new common::MemoryGovernor::Reservation(memoryGovernor_));
+        threadBufferReservations_.push_back(new common::MemoryGovernor::Reservation(memoryGovernor_));
+    }
     threads_.execute(boost::bind(&Build::allocateThreadData, this, _1));
 
+    // reference and thread data are in. Everything else must come from reservations
+    memoryGovernor_.measure();
+    allocateBinMetrics();
     testBinsFitInRam();
 
+    // bin indexes refer to the original list of bins produced by match selector
+    common::Profiler::instance().reserveUnits(common::Profiler::BuildLoadBin, bins.size());
+    common::Profiler::instance().reserveUnits(common::Profiler::BuildProcessBin, bins.size());
+    common::Profiler::instance().reserveUnits(common::Profiler::BuildSerializeBin, bins.size());
+    common::Profiler::instance().reserveUnits(common::Profiler::BuildSaveBin, bins.size());
+
+}
+
+/**
+ * \brief Per-thread metrics buffers grow with the number of samples and the read length. They are
+ *        reserved before the bins so that the bins plan against what is left.
+ */
+void Build::allocateBinMetrics()
+{
+    const unsigned long binMetricsBytes = BinMetrics::getMemoryRequirements(metrics_) * threads_.size();
+    if (!binMetricsReservation_.tryReserve(binMetricsBytes))
+    {
+        BOOST_THROW_EXCEPTION(
+            common::MemoryException((
+                boost::format("Build metrics require %d bytes of memory for %d threads. %d bytes available") %
+                    binMetricsBytes % threads_.size() % memoryGovernor_.getAvailable()).str()));
+    }
+    while(threadBinMetrics_.size() < threads_.size())
+    {
+        threadBinMetrics_.push_back(new BinMetrics(metrics_));
+    }
 }
 
 /**
@@ -476,6 +603,9 @@ void Build::testBinsFitInRam()
             threadBinSorters_.at(0).reset();
             threadBgzfStreams_.at(0).clear();
             threadBamIndexParts_.at(0).clear();
+            threadCramEncoders_.at(0).clear();
+            threadSorterReservations_.at(0).release();
+            threadBufferReservations_.at(0).release();
         }
     }
     ISAAC_THREAD_CERR << "Making sure all bins fit in memory done" << std::endl;
@@ -522,6 +652,8 @@ void Build::run(common::ScoopedMallocBlock &mallocBlock)
                                 boost::ref(nextUnsavedBinIt),
                                 boost::ref(mallocBlock),
                                 _1));
+    ISAAC_THREAD_CERR << "Memory governor: peak reserved by bam generation " << memoryGovernor_.getPeakReserved() <<
+        " bytes of " << memoryGovernor_.getLimit() << std::endl;
 
     unsigned fileIndex = 0;
     BOOST_FOREACH(const boost::filesystem::path &bamFilePath, barcodeBamMapping_.getPaths())
@@ -529,7 +661,15 @@ void Build::run(common::ScoopedMallocBlock &mallocBlock)
         // some of the streams are null_sink (that's when reference is unmapped for the sample).
         // this is the simplest way to ignore them...
         std::ostream *stm = bamFileStreams_.at(fileIndex).get();
-        if (stm)
+        if (stm && OUTPUT_CRAM == outputFormat_)
+        {
+            bam::serializeCramEof(*stm);
+            stm->flush();
+            ISAAC_THREAD_CERR << "CRAM file generated: " << bamFilePath << "\n";
+            cramIndexes_.at(fileIndex).flush();
+            ISAAC_THREAD_CERR << "CRAM index generated for " << bamFilePath << "\n";
+        }
+        else if (stm)
         {
             bam::serializeBgzfFooter(*stm);
             stm->flush();
@@ -551,6 +691,13 @@ void Build::dumpStats(const boost::filesystem::path &statsXmlPath)
     statsXml.serialize(os);
 }
 
+void Build::dumpMetrics(
+    const boost::filesystem::path &metricsXmlPath,
+    const boost::filesystem::path &coverageDirectory)
+{
+    metrics_.dump(metricsXmlPath, coverageDirectory, bins_, stats_);
+}
+
 unsigned long Build::estimateOptimumFragmentsPerBin(
     const flowcell::FlowcellLayoutList &flowcellLayoutList,
     const unsigned long availableMemory,
@@ -598,6 +745,21 @@ unsigned long Build::reserveBuffers(
     const alignment::BinMetadata &bin = *thisThreadBinIt;
     // bin stats have an entry per filtered bin reference.
     const unsigned binStatsIndex = std::distance(bins_.begin(), thisThreadBinIt);
+
+    const unsigned long sorterBytes = BinSorter::getMemoryRequirements(bin);
+    const unsigned long bufferBytes = estimateBinBuffersRequirements(bin);
+    common::MemoryGovernor::Reservation &sorterReservation = threadSorterReservations_.at(threadNumber);
+    common::MemoryGovernor::Reservation &bufferReservation = threadBufferReservations_.at(threadNumber);
+    if (!sorterReservation.tryReserve(sorterBytes))
+    {
+        return sorterBytes + bufferBytes;
+    }
+    if (!bufferReservation.tryReserve(bufferBytes))
+    {
+        sorterReservation.release();
+        return sorterBytes + bufferBytes;
+    }
+
     common::ScoopedMallocBlockUnblock unblockMalloc(mallocBlock);
     try
     {
@@ -617,20 +779,38 @@ unsigned long Build::reserveBuffers(
             bgzfBuffer.reserve(estimateBinCompressedDataRequirements(bin, outputFileIndex++));
         }
 
-        ISAAC_ASSERT_MSG(!bgzfStreams.size(), "Expecting empty pool of streams");
-        while(bgzfStreams.size() < bamFileStreams_.size())
+        if (OUTPUT_CRAM == outputFormat_)
         {
-            bgzfStreams.push_back(new boost::iostreams::filtering_ostream);
-            bgzfStreams.back().push(bgzf::BgzfCompressor(bamGzipLevel_));
-            bgzfStreams.back().push(
-                boost::iostreams::back_insert_device<std::vector<char> >(
-                    threadBgzfBuffers_.at(threadNumber).at(bgzfStreams.size()-1)));
+            CramSerializer::CramSliceEncoders &cramEncoders = threadCramEncoders_.at(threadNumber);
+            ISAAC_ASSERT_MSG(cramEncoders.empty(), "Expecting empty pool of cram encoders");
+            cramEncoders.resize(bamFileStreams_.size());
+            for (unsigned fileIndex = 0; cramEncoders.size() != fileIndex; ++fileIndex)
+            {
+                // encoders hold a whole slice worth of buffers. Don't waste memory on files that get no data
+                if (bamFileStreams_.at(fileIndex) && getOutputFileBinElements(bin, fileIndex))
+                {
+                    cramEncoders.at(fileIndex).reset(
+                        new CramSliceEncoder(bamGzipLevel_, maxReadLength_, threadBgzfBuffers_.at(threadNumber).at(fileIndex)));
+                }
+            }
         }
-
-        ISAAC_ASSERT_MSG(!bamIndexParts.size(), "Expecting empty pool of bam index parts");
-        while(bamIndexParts.size() < bamFileStreams_.size())
+        else
         {
-            bamIndexParts.push_back(new bam::BamIndexPart);
+            ISAAC_ASSERT_MSG(!bgzfStreams.size(), "Expecting empty pool of streams");
+            while(bgzfStreams.size() < bamFileStreams_.size())
+            {
+                bgzfStreams.push_back(new boost::iostreams::filtering_ostream);
+                bgzfStreams.back().push(bgzf::BgzfCompressor(bamGzipLevel_));
+                bgzfStreams.back().push(
+                    boost::iostreams::back_insert_device<std::vector<char> >(
+                        threadBgzfBuffers_.at(threadNumber).at(bgzfStreams.size()-1)));
+            }
+
+            ISAAC_ASSERT_MSG(!bamIndexParts.size(), "Expecting empty pool of bam index parts");
+            while(bamIndexParts.size() < bamFileStreams_.size())
+            {
+                bamIndexParts.push_back(new bam::BamIndexPart);
+            }
         }
     }
     catch(std::bad_alloc &e)
@@ -638,22 +818,37 @@ unsigned long Build::reserveBuffers(
         errno = 0;
         bgzfStreams.clear();
         bamIndexParts.clear();
+        threadCramEncoders_.at(threadNumber).clear();
         // give a chance other threads to allocate what they need... TODO: this is not required anymore as allocation happens orderly
         threadBinSorters_.at(threadNumber).reset();
-        unsigned long totalBuffersNeeded = 0UL;
-        unsigned outputFileIndex = 0;
         BOOST_FOREACH(std::vector<char> &bgzfBuffer, threadBgzfBuffers_.at(threadNumber))
         {
             std::vector<char>().swap(bgzfBuffer);
-            totalBuffersNeeded += estimateBinCompressedDataRequirements(bin, outputFileIndex++);
         }
+        // the estimates did not cover everything. Keep waiting until other bins return their memory
+        sorterReservation.release();
+        bufferReservation.release();
         // reset errno, to prevent misleading error messages when failing code does not set errno
         errno = 0;
-        return BinSorter::getMemoryRequirements(bin) + totalBuffersNeeded;
+        return sorterBytes + bufferBytes;
     }
     return 0;
 }
 
+unsigned long Build::estimateBinBuffersRequirements(const alignment::BinMetadata &bin) const
+{
+    unsigned long ret = 0UL;
+    for (unsigned outputFileIndex = 0; bamFileStreams_.size() != outputFileIndex; ++outputFileIndex)
+    {
+        if (OUTPUT_CRAM == outputFormat_ && getOutputFileBinElements(bin, outputFileIndex))
+        {
+            ret += CramSliceEncoder::getMemoryRequirements(maxReadLength_);
+        }
+        ret += estimateBinCompressedDataRequirements(bin, outputFileIndex);
+    }
+    return ret;
+}
+
 
 void Build::allocateBin(
     boost::unique_lock<boost::mutex> &lock,
@@ -810,6 +1005,8 @@ void Build::sortBinParallel(alignment::BinMetadataCRefList::const_iterator &next
         {
             {
                 common::unlock_guard<boost::unique_lock<boost::mutex> > unlock(lock);
+                common::ScopedStageTimer timer(common::Profiler::BuildLoadBin, thisThreadBinIt->get().getIndex());
+                timer.addBytes(thisThreadBinIt->get().getDataSize());
                 threadBinSorters_.at(threadNumber)->load();
             }
         }
@@ -821,17 +1018,19 @@ void Build::sortBinParallel(alignment::BinMetadataCRefList::const_iterator &next
                 common::unlock_guard<boost::unique_lock<boost::mutex> > unlock(lock);
                 processBin(*threadBinSorters_.at(threadNumber), threadNumber);
                 threadBgzfStreams_.at(threadNumber).clear();
+                threadCramEncoders_.at(threadNumber).clear();
             }
             // give back some memory to allow other threads to load
             // data while we're waiting for our turn to save
             threadBinSorters_.at(threadNumber).reset();
+            threadSorterReservations_.at(threadNumber).release();
         }
 
         // wait for our turn to store bam data
         waitForSaveSlot(lock, thisThreadBinIt, nextUnsavedBinIt);
         ISAAC_BLOCK_WITH_CLENAUP(boost::bind(&Build::returnSaveSlot, this, boost::ref(nextUnsavedBinIt), _1))
         {
-            saveAndReleaseBuffers(lock, thisThreadBinIt->get().getPath(), threadNumber);
+            saveAndReleaseBuffers(lock, thisThreadBinIt->get(), threadNumber);
         }
     }
 }
@@ -840,13 +1039,29 @@ unsigned long Build::processBin(
     BinSorter &indexedBin,
     const unsigned threadNumber)
 {
-    const unsigned long unique = indexedBin.process(stats_);
+    unsigned long unique = 0;
+    {
+        common::ScopedStageTimer timer(common::Profiler::BuildProcessBin, indexedBin.getBinIndex());
+        unique = indexedBin.process(stats_, threadBinMetrics_.at(threadNumber));
+        timer.addItems(unique);
+    }
     if (unique)
     {
+        common::ScopedStageTimer timer(common::Profiler::BuildSerializeBin, indexedBin.getBinIndex());
+        timer.addItems(unique);
         indexedBin.reorderForBam();
-        indexedBin.serialize(threadBgzfStreams_.at(threadNumber),
-                             threadBamIndexParts_.at(threadNumber));
+        indexedBin.collectMetrics(threadBinMetrics_.at(threadNumber));
+        if (OUTPUT_CRAM == outputFormat_)
+        {
+            indexedBin.serialize(threadCramEncoders_.at(threadNumber));
+        }
+        else
+        {
+            indexedBin.serialize(threadBgzfStreams_.at(threadNumber),
+                                 threadBamIndexParts_.at(threadNumber));
+        }
     }
+    threadBinMetrics_.at(threadNumber).finishBin();
     return unique;
 }
 
@@ -855,9 +1070,15 @@ unsigned long Build::processBin(
  */
 void Build::saveAndReleaseBuffers(
     boost::unique_lock<boost::mutex> &lock,
-    const boost::filesystem::path &filePath,
+    const alignment::BinMetadata &bin,
     const size_t threadNumber)
 {
+    common::ScopedStageTimer timer(common::Profiler::BuildSaveBin, bin.getIndex());
+    {
+        common::unlock_guard<boost::unique_lock<boost::mutex> > unlock(lock);
+        // bins are saved in order, which is what the merge needs to join the coverage across bin boundaries
+        metrics_.merge(threadBinMetrics_.at(threadNumber));
+    }
     unsigned index = 0;
     BOOST_FOREACH(std::vector<char> &bgzfBuffer, threadBgzfBuffers_.at(threadNumber))
     {
@@ -868,9 +1089,15 @@ void Build::saveAndReleaseBuffers(
             {
                 ISAAC_ASSERT_MSG(bgzfBuffer.empty(), "Unexpected data for bam file belonging to a sample with unmapped reference");
             }
+            else if (OUTPUT_CRAM == outputFormat_)
+            {
+                timer.addBytes(bgzfBuffer.size());
+                saveCramBuffer(bgzfBuffer, *stm, cramRecordCounters_.at(index), cramIndexes_.at(index), bin.getPath());
+            }
             else
             {
-                saveBuffer(bgzfBuffer, *stm, threadBamIndexParts_.at(threadNumber).at(index), bamIndexes_.at(index), filePath);
+                timer.addBytes(bgzfBuffer.size());
+                saveBuffer(bgzfBuffer, *stm, threadBamIndexParts_.at(threadNumber).at(index), bamIndexes_.at(index), bin.getPath());
             }
         }
         // release rest of the memory that was reserved for this bin
@@ -878,6 +1105,7 @@ void Build::saveAndReleaseBuffers(
         ++index;
     }
     threadBamIndexParts_.at(threadNumber).clear();
+    threadBufferReservations_.at(threadNumber).release();
 }
 
 void Build::saveBuffer(
@@ -888,7 +1116,7 @@ void Build::saveBuffer(
     const boost::filesystem::path &filePath)
 {
     ISAAC_THREAD_CERR << "Saving " << bgzfBuffer.size() << " bytes of sorted data for bin " << filePath << std::endl;
-    const clock_t start = clock();
+    const unsigned long startNs = common::getWallClockNs();
     if(!bgzfBuffer.empty() && !bamStream.write(&bgzfBuffer.front(), bgzfBuffer.size())/* ||
         !bamStream.strict_sync()*/){
         BOOST_THROW_EXCEPTION(common::IoException(
@@ -896,7 +1124,31 @@ void Build::saveBuffer(
     }
     bamIndex.processIndexPart( bamIndexPart, bgzfBuffer );
 
-    ISAAC_THREAD_CERR << "Saving " << bgzfBuffer.size() << " bytes of sorted data for bin " << filePath << " done in " << (clock() - start) / 1000 << "ms\n";
+    ISAAC_THREAD_CERR << "Saving " << bgzfBuffer.size() << " bytes of sorted data for bin " << filePath << " done in " << (common::getWallClockNs() - startNs) / 1000000 << "ms\n";
+}
+
+void Build::saveCramBuffer(
+    std::vector<char> &cramBuffer,
+    std::ostream &cramStream,
+    unsigned long &recordCounter,
+    bam::CramIndex &cramIndex,
+    const boost::filesystem::path &filePath)
+{
+    ISAAC_THREAD_CERR << "Saving " << cramBuffer.size() << " bytes of cram containers for bin " << filePath << std::endl;
+    const unsigned long startNs = common::getWallClockNs();
+    // bins are encoded independently, the record counters become known only when they are saved in order
+    if (!cramBuffer.empty())
+    {
+        bam::offsetCramRecordCounters(&cramBuffer.front(), &cramBuffer.front() + cramBuffer.size(), recordCounter);
+    }
+    if(!cramBuffer.empty() && !cramStream.write(&cramBuffer.front(), cramBuffer.size()))
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(
+            errno, (boost::format("Failed to write %d bytes of cram containers into cram stream") % cramBuffer.size()).str()));
+    }
+    cramIndex.processContainers(cramBuffer);
+
+    ISAAC_THREAD_CERR << "Saving " << cramBuffer.size() << " bytes of cram containers for bin " << filePath << " done in " << (common::getWallClockNs() - startNs) / 1000000 << "ms\n";
 }
 
 } // namespace build
@@ -0,0 +1,666 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file BuildMetrics.cpp
+ **
+ ** \brief Coverage, insert size and duplicate metrics collected while the bam files are built.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include <fstream>
+#include <iomanip>
+
+#include <boost/foreach.hpp>
+
+#include "alignment/Cigar.hh"
+#include "build/BuildMetrics.hh"
+#include "common/Exceptions.hh"
+#include "common/FileSystem.hh"
+
+namespace isaac
+{
+namespace build
+{
+
+const unsigned BuildMetrics::DEPTH_MAX;
+const unsigned BuildMetrics::INSERT_SIZE_MAX;
+const unsigned BuildMetrics::DUPLICATE_SET_MAX;
+
+static const unsigned RING_SIZE_MIN = 1024;
+
+/**
+ * \return power of two large enough to keep the depth of the reference span of any read
+ */
+static unsigned getRingSize(const unsigned maxReadLength)
+{
+    unsigned ret = RING_SIZE_MIN;
+    while (ret < maxReadLength * 4)
+    {
+        ret <<= 1;
+    }
+    return ret;
+}
+
+template <typename T>
+static void addHistogram(std::vector<unsigned long> &to, const std::vector<T> &from)
+{
+    ISAAC_ASSERT_MSG(to.size() == from.size(), "Histogram geometry mismatch " << to.size() << " vs " << from.size());
+    for (std::size_t i = 0; to.size() != i; ++i)
+    {
+        to[i] += from[i];
+    }
+}
+
+BuildMetrics::BuildMetrics(
+    const BarcodeBamMapping &barcodeBamMapping,
+    const flowcell::BarcodeMetadataList &barcodeMetadataList,
+    const reference::SortedReferenceMetadataList &sortedReferenceMetadataList,
+    const unsigned maxReadLength,
+    const unsigned coverageTileSize,
+    const bool collectDuplicateSets) :
+    barcodeBamMapping_(barcodeBamMapping),
+    barcodeMetadataList_(barcodeMetadataList),
+    sortedReferenceMetadataList_(sortedReferenceMetadataList),
+    ringSize_(getRingSize(maxReadLength)),
+    coverageTileSize_(coverageTileSize),
+    collectDuplicateSets_(collectDuplicateSets),
+    samples_(barcodeBamMapping_.getTotalSamples())
+{
+    BOOST_FOREACH(const flowcell::BarcodeMetadata &barcode, barcodeMetadataList_)
+    {
+        SampleMetrics &sampleMetrics = samples_.at(barcodeBamMapping_.getSampleIndex(barcode.getIndex()));
+        if (-1U == sampleMetrics.barcodeIndex_)
+        {
+            sampleMetrics.barcodeIndex_ = barcode.getIndex();
+        }
+        if (barcode.isUnmappedReference() || -1U != sampleMetrics.referenceIndex_)
+        {
+            continue;
+        }
+        sampleMetrics.referenceIndex_ = barcode.getReferenceIndex();
+        const reference::SortedReferenceMetadata::Contigs &contigs =
+            sortedReferenceMetadataList_.at(sampleMetrics.referenceIndex_).getContigs();
+
+        sampleMetrics.depthHistogram_.resize(DEPTH_MAX + 1);
+        sampleMetrics.insertSizeHistogram_.resize(INSERT_SIZE_MAX + 1);
+        if (collectDuplicateSets_)
+        {
+            sampleMetrics.duplicateSetHistogram_.resize(DUPLICATE_SET_MAX + 1);
+        }
+        sampleMetrics.alignedBases_.resize(contigs.size());
+        sampleMetrics.coveredBases_.resize(contigs.size());
+        if (coverageTileSize_)
+        {
+            sampleMetrics.tiles_.reserve(contigs.size());
+            BOOST_FOREACH(const reference::SortedReferenceMetadata::Contig &contig, contigs)
+            {
+                sampleMetrics.tiles_.push_back(
+                    std::vector<unsigned long>((contig.totalBases_ + coverageTileSize_ - 1) / coverageTileSize_));
+            }
+        }
+        sampleMetrics.pendingDepths_.reserve(ringSize_);
+    }
+}
+
+unsigned long BuildMetrics::getContigLength(const unsigned sample, const unsigned contigId) const
+{
+    const reference::SortedReferenceMetadata::Contigs &contigs =
+        sortedReferenceMetadataList_.at(samples_.at(sample).referenceIndex_).getContigs();
+    return contigs.size() > contigId ? contigs.at(contigId).totalBases_ : 0;
+}
+
+/**
+ * \brief Tiles near the bin boundaries receive depths from the threads processing the neighbor bins
+ *        and from merge, so the update has to be atomic.
+ */
+void BuildMetrics::addTileDepths(
+    const unsigned sample, const unsigned contigId, const unsigned long tile, const unsigned long depths)
+{
+    if (depths)
+    {
+        __sync_fetch_and_add(&samples_[sample].tiles_.at(contigId).at(tile), depths);
+    }
+}
+
+void BuildMetrics::flushTile(const unsigned sample)
+{
+    SampleMetrics &sampleMetrics = samples_[sample];
+    addTileDepths(sample, sampleMetrics.tileContigId_, sampleMetrics.tile_, sampleMetrics.tileDepths_);
+    sampleMetrics.tileDepths_ = 0;
+}
+
+void BuildMetrics::foldDepth(
+    const unsigned sample, const unsigned contigId, const unsigned long offset, const unsigned depth)
+{
+    SampleMetrics &sampleMetrics = samples_[sample];
+    if (!depth || sampleMetrics.coveredBases_.size() <= contigId || getContigLength(sample, contigId) <= offset)
+    {
+        return;
+    }
+    ++sampleMetrics.depthHistogram_[std::min(depth, DEPTH_MAX)];
+    ++sampleMetrics.coveredBases_[contigId];
+    if (coverageTileSize_)
+    {
+        const unsigned long tile = offset / coverageTileSize_;
+        if (sampleMetrics.tileContigId_ != contigId || sampleMetrics.tile_ != tile)
+        {
+            flushTile(sample);
+            sampleMetrics.tileContigId_ = contigId;
+            sampleMetrics.tile_ = tile;
+        }
+        sampleMetrics.tileDepths_ += depth;
+    }
+}
+
+void BuildMetrics::foldPending(const unsigned sample)
+{
+    SampleMetrics &sampleMetrics = samples_[sample];
+    if (sampleMetrics.pending_)
+    {
+        for (std::size_t i = 0; sampleMetrics.pendingDepths_.size() != i; ++i)
+        {
+            foldDepth(sample, sampleMetrics.pendingContigId_,
+                      sampleMetrics.pendingOffset_ + i, sampleMetrics.pendingDepths_[i]);
+        }
+        sampleMetrics.pendingDepths_.clear();
+        sampleMetrics.pending_ = false;
+    }
+}
+
+void BuildMetrics::merge(const BinMetrics &binMetrics)
+{
+    for (unsigned sample = 0; samples_.size() != sample; ++sample)
+    {
+        if (!isMapped(sample))
+        {
+            continue;
+        }
+        SampleMetrics &sampleMetrics = samples_[sample];
+        const BinMetrics::SampleMetrics &binSampleMetrics = binMetrics.samples_.at(sample);
+        addHistogram(sampleMetrics.insertSizeHistogram_, binSampleMetrics.insertSizeHistogram_);
+        addHistogram(sampleMetrics.duplicateSetHistogram_, binSampleMetrics.duplicateSetHistogram_);
+        if (!binMetrics.aligned_ || sampleMetrics.alignedBases_.size() <= binMetrics.contigId_)
+        {
+            continue;
+        }
+        const unsigned contigId = binMetrics.contigId_;
+        addHistogram(sampleMetrics.depthHistogram_, binSampleMetrics.depthHistogram_);
+        sampleMetrics.alignedBases_[contigId] += binSampleMetrics.alignedBases_;
+        sampleMetrics.coveredBases_[contigId] += binSampleMetrics.coveredBases_;
+
+        // tail of the previous bin is only relevant if it overlaps the head of this one
+        if (sampleMetrics.pending_ &&
+            (sampleMetrics.pendingContigId_ != contigId ||
+                sampleMetrics.pendingOffset_ > binMetrics.binStart_ ||
+                sampleMetrics.pendingOffset_ + sampleMetrics.pendingDepths_.size() <= binMetrics.binStart_))
+        {
+            foldPending(sample);
+        }
+
+        std::size_t pendingIndex = 0;
+        for (; sampleMetrics.pendingDepths_.size() != pendingIndex &&
+            sampleMetrics.pendingOffset_ + pendingIndex < binMetrics.binStart_; ++pendingIndex)
+        {
+            foldDepth(sample, contigId, sampleMetrics.pendingOffset_ + pendingIndex,
+                      sampleMetrics.pendingDepths_[pendingIndex]);
+        }
+        for (unsigned long offset = binMetrics.binStart_; binMetrics.headEnd_ != offset; ++offset)
+        {
+            unsigned depth = binSampleMetrics.head_[offset - binMetrics.binStart_];
+            if (sampleMetrics.pendingDepths_.size() != pendingIndex)
+            {
+                depth += sampleMetrics.pendingDepths_[pendingIndex++];
+            }
+            foldDepth(sample, contigId, offset, depth);
+        }
+        // previous bin tail is longer than this bin. Such bins are not expected to be produced by the aligner.
+        for (; sampleMetrics.pendingDepths_.size() != pendingIndex; ++pendingIndex)
+        {
+            foldDepth(sample, contigId, sampleMetrics.pendingOffset_ + pendingIndex,
+                      sampleMetrics.pendingDepths_[pendingIndex]);
+        }
+
+        // capacity is reserved in constructor
+        sampleMetrics.pendingDepths_.assign(
+            binSampleMetrics.tail_.begin(), binSampleMetrics.tail_.begin() + binSampleMetrics.tailLength_);
+        sampleMetrics.pendingContigId_ = contigId;
+        sampleMetrics.pendingOffset_ = binMetrics.binEnd_;
+        sampleMetrics.pending_ = true;
+    }
+}
+
+static void dumpHistogram(
+    xml::XmlWriter &xmlWriter,
+    const char *name,
+    const char *bucketAttribute,
+    const std::vector<unsigned long> &histogram)
+{
+    ISAAC_XML_WRITER_ELEMENT_BLOCK(xmlWriter, name)
+    {
+        for (std::size_t bucket = 0; histogram.size() != bucket; ++bucket)
+        {
+            if (histogram[bucket])
+            {
+                ISAAC_XML_WRITER_ELEMENT_BLOCK(xmlWriter, "Bucket")
+                {
+                    xmlWriter.writeAttribute(bucketAttribute, bucket);
+                    xmlWriter << histogram[bucket];
+                }
+            }
+        }
+    }
+}
+
+void BuildMetrics::dumpSample(
+    xml::XmlWriter &xmlWriter,
+    const unsigned sample,
+    const alignment::BinMetadataCRefList &bins,
+    const BuildStats &buildStats) const
+{
+    const SampleMetrics &sampleMetrics = samples_.at(sample);
+    const flowcell::BarcodeMetadata &sampleBarcode = barcodeMetadataList_.at(sampleMetrics.barcodeIndex_);
+
+    unsigned long totalFragments = 0;
+    unsigned long uniqueFragments = 0;
+    for (unsigned binStatsIndex = 0; bins.size() != binStatsIndex; ++binStatsIndex)
+    {
+        BOOST_FOREACH(const flowcell::BarcodeMetadata &barcode, barcodeMetadataList_)
+        {
+            if (sample == barcodeBamMapping_.getSampleIndex(barcode.getIndex()))
+            {
+                totalFragments += buildStats.getTotalFragments(binStatsIndex, barcode.getIndex());
+                uniqueFragments += buildStats.getUniqueFragments(binStatsIndex, barcode.getIndex());
+            }
+        }
+    }
+
+    const reference::SortedReferenceMetadata::Contigs contigs =
+        sortedReferenceMetadataList_.at(sampleMetrics.referenceIndex_).getKaryotypeOrderedContigs();
+    unsigned long referenceBases = 0;
+    unsigned long alignedBases = 0;
+    unsigned long coveredBases = 0;
+    BOOST_FOREACH(const reference::SortedReferenceMetadata::Contig &contig, contigs)
+    {
+        referenceBases += contig.totalBases_;
+        alignedBases += sampleMetrics.alignedBases_.at(contig.index_);
+        coveredBases += sampleMetrics.coveredBases_.at(contig.index_);
+    }
+
+    ISAAC_XML_WRITER_ELEMENT_BLOCK(xmlWriter, "Sample")
+    {
+        xmlWriter.writeAttribute("name", sampleBarcode.getSampleName());
+        xmlWriter.writeElement("TotalFragments", totalFragments);
+        xmlWriter.writeElement("UniqueFragments", uniqueFragments);
+        xmlWriter.writeElement("ReferenceTotalBases", referenceBases);
+        xmlWriter.writeElement("AlignedBases", alignedBases);
+        xmlWriter.writeElement("CoveredBases", coveredBases);
+        xmlWriter.writeElement("MeanDepth", referenceBases ? double(alignedBases) / referenceBases : 0.0);
+
+        dumpHistogram(xmlWriter, "DepthHistogram", "depth", sampleMetrics.depthHistogram_);
+        dumpHistogram(xmlWriter, "InsertSizeHistogram", "size", sampleMetrics.insertSizeHistogram_);
+        if (collectDuplicateSets_)
+        {
+            dumpHistogram(xmlWriter, "DuplicateSetHistogram", "size", sampleMetrics.duplicateSetHistogram_);
+        }
+
+        BOOST_FOREACH(const reference::SortedReferenceMetadata::Contig &contig, contigs)
+        {
+            if (sampleMetrics.alignedBases_.at(contig.index_))
+            {
+                ISAAC_XML_WRITER_ELEMENT_BLOCK(xmlWriter, "Contig")
+                {
+                    xmlWriter.writeAttribute("name", contig.name_);
+                    xmlWriter.writeElement("ReferenceTotalBases", contig.totalBases_);
+                    xmlWriter.writeElement("AlignedBases", sampleMetrics.alignedBases_.at(contig.index_));
+                    xmlWriter.writeElement("CoveredBases", sampleMetrics.coveredBases_.at(contig.index_));
+                }
+            }
+        }
+    }
+}
+
+void BuildMetrics::dumpCoverage(const boost::filesystem::path &wigPath, const unsigned sample) const
+{
+    const SampleMetrics &sampleMetrics = samples_.at(sample);
+    const flowcell::BarcodeMetadata &sampleBarcode = barcodeMetadataList_.at(sampleMetrics.barcodeIndex_);
+    std::ofstream os(wigPath.string().c_str());
+    if (!os)
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "Unable to open file for writing: " + wigPath.string()));
+    }
+
+    os << "track type=wiggle_0 name=\"" << sampleBarcode.getSampleName() <<
+        "\" description=\"Mean depth in " << coverageTileSize_ << "bp tiles\"\n";
+    os << std::fixed << std::setprecision(2);
+    BOOST_FOREACH(const reference::SortedReferenceMetadata::Contig &contig,
+                  sortedReferenceMetadataList_.at(sampleMetrics.referenceIndex_).getKaryotypeOrderedContigs())
+    {
+        if (!sampleMetrics.alignedBases_.at(contig.index_))
+        {
+            continue;
+        }
+        os << "fixedStep chrom=" << contig.name_ << " start=1 step=" << coverageTileSize_ <<
+            " span=" << coverageTileSize_ << "\n";
+        const std::vector<unsigned long> &tiles = sampleMetrics.tiles_.at(contig.index_);
+        for (std::size_t tile = 0; tiles.size() != tile; ++tile)
+        {
+            const unsigned long tileStart = tile * coverageTileSize_;
+            const unsigned long tileLength = std::min<unsigned long>(coverageTileSize_, contig.totalBases_ - tileStart);
+            os << double(tiles[tile]) / tileLength << "\n";
+        }
+    }
+    if (!os.flush())
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to write coverage into " + wigPath.string()));
+    }
+}
+
+void BuildMetrics::dump(
+    const boost::filesystem::path &metricsXmlPath,
+    const boost::filesystem::path &coverageDirectory,
+    const alignment::BinMetadataCRefList &bins,
+    const BuildStats &buildStats)
+{
+    ISAAC_THREAD_CERR << "Generating Build metrics" << std::endl;
+    std::vector<boost::filesystem::path> directories;
+    for (unsigned sample = 0; samples_.size() != sample; ++sample)
+    {
+        if (isMapped(sample))
+        {
+            foldPending(sample);
+            flushTile(sample);
+            SampleMetrics &sampleMetrics = samples_[sample];
+            // positions without depth are not visited during the build
+            sampleMetrics.depthHistogram_[0] = 0;
+            BOOST_FOREACH(const reference::SortedReferenceMetadata::Contig &contig,
+                          sortedReferenceMetadataList_.at(sampleMetrics.referenceIndex_).getContigs())
+            {
+                sampleMetrics.depthHistogram_[0] += contig.totalBases_ - sampleMetrics.coveredBases_.at(contig.index_);
+            }
+            directories.push_back(coverageDirectory / barcodeMetadataList_.at(sampleMetrics.barcodeIndex_).getProject());
+        }
+    }
+
+    std::ofstream os(metricsXmlPath.string().c_str());
+    if (!os)
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "ERROR: Unable to open file for writing: " + metricsXmlPath.string()));
+    }
+    {
+        xml::XmlWriter xmlWriter(os);
+        ISAAC_XML_WRITER_ELEMENT_BLOCK(xmlWriter, "Metrics")
+        {
+            std::string lastProject;
+            for (unsigned sample = 0; samples_.size() != sample; ++sample)
+            {
+                if (!isMapped(sample))
+                {
+                    continue;
+                }
+                const flowcell::BarcodeMetadata &barcode = barcodeMetadataList_.at(samples_[sample].barcodeIndex_);
+                if (lastProject != barcode.getProject())
+                {
+                    if (!lastProject.empty())
+                    {
+                        xmlWriter.endElement(); //close Project
+                    }
+                    xmlWriter.startElement("Project");
+                    xmlWriter.writeAttribute("name", barcode.getProject());
+                    lastProject = barcode.getProject();
+                }
+                dumpSample(xmlWriter, sample, bins, buildStats);
+            }
+            if (!lastProject.empty())
+            {
+                xmlWriter.endElement(); //close Project
+            }
+        }
+    }
+    if (!os.flush())
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to write " + metricsXmlPath.string()));
+    }
+
+    if (coverageTileSize_)
+    {
+        common::createDirectories(directories);
+        for (unsigned sample = 0; samples_.size() != sample; ++sample)
+        {
+            if (isMapped(sample))
+            {
+                const flowcell::BarcodeMetadata &barcode = barcodeMetadataList_.at(samples_[sample].barcodeIndex_);
+                dumpCoverage(coverageDirectory / barcode.getProject() / (barcode.getSampleName() + ".wig"), sample);
+            }
+        }
+    }
+    ISAAC_THREAD_CERR << "Generating Build metrics done" << std::endl;
+}
+
+BinMetrics::BinMetrics(BuildMetrics &buildMetrics) :
+    buildMetrics_(buildMetrics),
+    ringSize_(buildMetrics.ringSize_),
+    ringMask_(buildMetrics.ringSize_ - 1),
+    aligned_(false),
+    contigId_(0),
+    binStart_(0),
+    headEnd_(0),
+    binEnd_(0),
+    samples_(buildMetrics.samples_.size())
+{
+    for (unsigned sample = 0; samples_.size() != sample; ++sample)
+    {
+        // samples with unmapped reference don't produce any metrics
+        if (buildMetrics_.isMapped(sample))
+        {
+            SampleMetrics &sampleMetrics = samples_[sample];
+            sampleMetrics.depthHistogram_.resize(BuildMetrics::DEPTH_MAX + 1);
+            sampleMetrics.insertSizeHistogram_.resize(BuildMetrics::INSERT_SIZE_MAX + 1);
+            if (buildMetrics_.collectDuplicateSets_)
+            {
+                sampleMetrics.duplicateSetHistogram_.resize(BuildMetrics::DUPLICATE_SET_MAX + 1);
+            }
+            sampleMetrics.ring_.resize(ringSize_);
+            sampleMetrics.head_.resize(ringSize_);
+            sampleMetrics.tail_.resize(ringSize_);
+        }
+    }
+}
+
+unsigned long BinMetrics::getMemoryRequirements(const BuildMetrics &buildMetrics)
+{
+    const unsigned long sampleBytes = sizeof(unsigned) * (
+        BuildMetrics::DEPTH_MAX + 1 +
+        BuildMetrics::INSERT_SIZE_MAX + 1 +
+        (buildMetrics.collectDuplicateSets_ ? BuildMetrics::DUPLICATE_SET_MAX + 1 : 0) +
+        // ring, head and tail
+        buildMetrics.ringSize_ * 3);
+
+    unsigned long ret = sizeof(SampleMetrics) * buildMetrics.samples_.size();
+    for (unsigned sample = 0; buildMetrics.samples_.size() != sample; ++sample)
+    {
+        if (buildMetrics.isMapped(sample))
+        {
+            ret += sampleBytes;
+        }
+    }
+    return ret;
+}
+
+void BinMetrics::startBin(const alignment::BinMetadata &bin)
+{
+    aligned_ = !bin.isUnalignedBin();
+    contigId_ = aligned_ ? bin.getBinStart().getContigId() : 0;
+    binStart_ = aligned_ ? bin.getBinStart().getPosition() : 0;
+    binEnd_ = binStart_ + (aligned_ ? bin.getLength() : 0);
+    headEnd_ = std::min<unsigned long>(binEnd_, binStart_ + ringSize_);
+
+    for (unsigned sample = 0; samples_.size() != sample; ++sample)
+    {
+        SampleMetrics &sampleMetrics = samples_[sample];
+        if (sampleMetrics.ring_.empty())
+        {
+            continue;
+        }
+        std::fill(sampleMetrics.depthHistogram_.begin(), sampleMetrics.depthHistogram_.end(), 0);
+        std::fill(sampleMetrics.insertSizeHistogram_.begin(), sampleMetrics.insertSizeHistogram_.end(), 0);
+        std::fill(sampleMetrics.duplicateSetHistogram_.begin(), sampleMetrics.duplicateSetHistogram_.end(), 0);
+        // ring is normally clean after finishBin, unless the previous bin failed half way
+        std::fill(sampleMetrics.ring_.begin(), sampleMetrics.ring_.end(), 0);
+        std::fill(sampleMetrics.head_.begin(), sampleMetrics.head_.end(), 0);
+        sampleMetrics.contigLength_ = aligned_ ? buildMetrics_.getContigLength(sample, contigId_) : 0;
+        sampleMetrics.foldedEnd_ = binStart_;
+        sampleMetrics.touchedEnd_ = binStart_;
+        sampleMetrics.tailLength_ = 0;
+        sampleMetrics.alignedBases_ = 0;
+        sampleMetrics.coveredBases_ = 0;
+        sampleMetrics.tile_ = 0;
+        sampleMetrics.tileDepths_ = 0;
+    }
+}
+
+void BinMetrics::addDuplicateSet(const unsigned long barcode, const unsigned long fragments)
+{
+    SampleMetrics &sampleMetrics = samples_.at(buildMetrics_.barcodeBamMapping_.getSampleIndex(barcode));
+    if (!sampleMetrics.duplicateSetHistogram_.empty())
+    {
+        ++sampleMetrics.duplicateSetHistogram_[std::min<unsigned long>(fragments, BuildMetrics::DUPLICATE_SET_MAX)];
+    }
+}
+
+void BinMetrics::addFragment(const io::FragmentAccessor &fragment)
+{
+    if (!aligned_ || fragment.flags_.unmapped_ || fragment.flags_.duplicate_ || fragment.flags_.failFilter_)
+    {
+        return;
+    }
+    const unsigned sample = buildMetrics_.barcodeBamMapping_.getSampleIndex(fragment.barcode_);
+    SampleMetrics &sampleMetrics = samples_.at(sample);
+    if (sampleMetrics.ring_.empty())
+    {
+        return;
+    }
+
+    // only the leftmost read of the pair has positive template length
+    if (fragment.flags_.paired_ && fragment.flags_.properPair_ && 0 < fragment.bamTlen_)
+    {
+        ++sampleMetrics.insertSizeHistogram_[std::min<unsigned>(fragment.bamTlen_, BuildMetrics::INSERT_SIZE_MAX)];
+    }
+
+    if (fragment.fStrandPosition_.getContigId() != contigId_)
+    {
+        return;
+    }
+
+    unsigned long position = fragment.fStrandPosition_.getPosition();
+    fold(sample, position);
+    for (const unsigned *it = fragment.cigarBegin(); fragment.cigarEnd() != it; ++it)
+    {
+        const alignment::Cigar::Component decoded = alignment::Cigar::decode(*it);
+        switch (decoded.second)
+        {
+        case alignment::Cigar::ALIGN:
+        case alignment::Cigar::MATCH:
+        case alignment::Cigar::MISMATCH:
+            addDepth(sampleMetrics, position, position + decoded.first);
+            sampleMetrics.alignedBases_ += decoded.first;
+            position += decoded.first;
+            break;
+        case alignment::Cigar::DELETE:
+        case alignment::Cigar::SKIP:
+            position += decoded.first;
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void BinMetrics::addDepth(SampleMetrics &sampleMetrics, unsigned long begin, unsigned long end)
+{
+    begin = std::max(begin, sampleMetrics.foldedEnd_);
+    end = std::min(end, std::min(sampleMetrics.foldedEnd_ + ringSize_, binEnd_ + ringSize_));
+    end = std::min(end, sampleMetrics.contigLength_);
+    if (begin < end)
+    {
+        for (unsigned long position = begin; end != position; ++position)
+        {
+            ++sampleMetrics.ring_[position & ringMask_];
+        }
+        sampleMetrics.touchedEnd_ = std::max(sampleMetrics.touchedEnd_, end);
+    }
+}
+
+void BinMetrics::flushTile(const unsigned sample)
+{
+    SampleMetrics &sampleMetrics = samples_[sample];
+    buildMetrics_.addTileDepths(sample, contigId_, sampleMetrics.tile_, sampleMetrics.tileDepths_);
+    sampleMetrics.tileDepths_ = 0;
+}
+
+void BinMetrics::fold(const unsigned sample, const unsigned long end)
+{
+    SampleMetrics &sampleMetrics = samples_[sample];
+    const unsigned long touchedEnd = std::min(end, sampleMetrics.touchedEnd_);
+    for (unsigned long position = sampleMetrics.foldedEnd_; touchedEnd > position; ++position)
+    {
+        unsigned &ringDepth = sampleMetrics.ring_[position & ringMask_];
+        const unsigned depth = ringDepth;
+        ringDepth = 0;
+        if (headEnd_ > position)
+        {
+            sampleMetrics.head_[position - binStart_] = depth;
+        }
+        else if (binEnd_ <= position)
+        {
+            sampleMetrics.tail_[position - binEnd_] = depth;
+        }
+        else if (depth)
+        {
+            ++sampleMetrics.depthHistogram_[std::min(depth, BuildMetrics::DEPTH_MAX)];
+            ++sampleMetrics.coveredBases_;
+            if (buildMetrics_.coverageTileSize_)
+            {
+                const unsigned long tile = position / buildMetrics_.coverageTileSize_;
+                if (sampleMetrics.tile_ != tile)
+                {
+                    flushTile(sample);
+                    sampleMetrics.tile_ = tile;
+                }
+                sampleMetrics.tileDepths_ += depth;
+            }
+        }
+    }
+    sampleMetrics.foldedEnd_ = std::max(sampleMetrics.foldedEnd_, end);
+}
+
+void BinMetrics::finishBin()
+{
+    if (!aligned_)
+    {
+        return;
+    }
+    for (unsigned sample = 0; samples_.size() != sample; ++sample)
+    {
+        SampleMetrics &sampleMetrics = samples_[sample];
+        if (!sampleMetrics.ring_.empty())
+        {
+            fold(sample, sampleMetrics.touchedEnd_);
+            flushTile(sample);
+            sampleMetrics.tailLength_ =
+                sampleMetrics.touchedEnd_ > binEnd_ ? sampleMetrics.touchedEnd_ - binEnd_ : 0;
+        }
+    }
+}
+
+} //namespace build
+} //namespace isaac
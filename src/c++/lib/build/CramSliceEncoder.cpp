@@ -0,0 +1,659 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file CramSliceEncoder.cpp
+ **
+ ** \brief Reference-based encoding of sorted records into CRAM 3.0 containers.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include <cstring>
+
+#include "alignment/Cigar.hh"
+#include "build/CramSliceEncoder.hh"
+#include "oligo/Nucleotides.hh"
+
+namespace isaac
+{
+namespace build
+{
+
+namespace
+{
+
+const char SERIES_NAMES[] = "BFCFRLAPRGRNMFNSNPTSTLFNFCFPBSINDLRSSCHCPDMQBAQS";
+
+struct TagDescription
+{
+    char name_[2];
+    char type_;
+};
+
+// must match the order of CramSliceEncoder::Tag
+const TagDescription TAG_DESCRIPTIONS[] =
+{
+    {{'S', 'M'}, bam::iTag::val_type_},
+    {{'A', 'S'}, bam::iTag::val_type_},
+    {{'R', 'G'}, bam::zTag::val_type_},
+    {{'N', 'M'}, bam::iTag::val_type_},
+    {{'B', 'C'}, bam::zTag::val_type_},
+    {{'O', 'C'}, bam::zTag::val_type_},
+    {{'Z', 'X'}, bam::iTag::val_type_},
+    {{'Z', 'Y'}, bam::iTag::val_type_},
+};
+
+const unsigned READ_NAME_BYTES_TYPICAL = 64;
+const unsigned TAG_BYTES_TYPICAL = 16;
+
+// compression bit flags
+const int CF_QUALITY_AS_ARRAY = 0x1;
+const int CF_DETACHED = 0x2;
+
+// mate bit flags
+const int MF_MATE_REVERSE = 0x1;
+const int MF_MATE_UNMAPPED = 0x2;
+
+const unsigned BAM_FLAG_UNMAPPED = 0x4;
+const unsigned BAM_FLAG_MATE_UNMAPPED = 0x8;
+const unsigned BAM_FLAG_MATE_REVERSE = 0x20;
+
+/// all rows of the substitution matrix list the alternative bases in ACGTN order
+const char SUBSTITUTION_MATRIX_ROW = 0x1B;
+
+inline unsigned getBaseIndex(const char base)
+{
+    switch (base)
+    {
+    case 'A': return 0;
+    case 'C': return 1;
+    case 'G': return 2;
+    case 'T': return 3;
+    default: return 4;
+    }
+}
+
+inline char getSubstitutionCode(const char refBase, const char readBase)
+{
+    const unsigned refIndex = getBaseIndex(refBase);
+    const unsigned readIndex = getBaseIndex(readBase);
+    return readIndex - (readIndex > refIndex);
+}
+
+void appendExternalEncoding(std::vector<char> &buffer, const int blockId)
+{
+    bam::appendItf8(buffer, bam::CRAM_CODEC_EXTERNAL);
+    bam::appendItf8(buffer, bam::getItf8Length(blockId));
+    bam::appendItf8(buffer, blockId);
+}
+
+void appendByteArrayStopEncoding(std::vector<char> &buffer, const int blockId)
+{
+    bam::appendItf8(buffer, bam::CRAM_CODEC_BYTE_ARRAY_STOP);
+    bam::appendItf8(buffer, 1 + bam::getItf8Length(blockId));
+    buffer.push_back(0);
+    bam::appendItf8(buffer, blockId);
+}
+
+void appendByteArrayLenEncoding(std::vector<char> &buffer, const int blockId)
+{
+    const unsigned externalEncodingLength = 2 + bam::getItf8Length(blockId);
+    bam::appendItf8(buffer, bam::CRAM_CODEC_BYTE_ARRAY_LEN);
+    bam::appendItf8(buffer, externalEncodingLength * 2);
+    // lengths and values go into the same block
+    appendExternalEncoding(buffer, blockId);
+    appendExternalEncoding(buffer, blockId);
+}
+
+/// appends map_ prefixed with its size to header
+void appendMap(const std::vector<char> &map, const unsigned entries, std::vector<char> &header)
+{
+    bam::appendItf8(header, map.size() + bam::getItf8Length(entries));
+    bam::appendItf8(header, entries);
+    header.insert(header.end(), map.begin(), map.end());
+}
+
+inline int getSeriesBlockId(const unsigned series)
+{
+    // block content id 0 is used by the core block
+    return series + 1;
+}
+
+} // namespace
+
+CramSliceEncoder::CramSliceEncoder(
+    const int gzipLevel,
+    const unsigned maxReadLength,
+    std::vector<char> &output) :
+    output_(output),
+    compressor_(gzipLevel, getMaxBlockBytes(maxReadLength)),
+    rawCompressor_(0, COMPRESSION_HEADER_BYTES_MAX),
+    recordCounter_(0),
+    sliceRefId_(0),
+    sliceStart_(0),
+    sliceEnd_(0),
+    lastAlignmentStart_(0),
+    records_(0),
+    bases_(0),
+    tagLinesCount_(0),
+    sliceTagsMask_(0)
+{
+    for (unsigned series = 0; SERIES_COUNT != series; ++series)
+    {
+        series_[series].reserve(getSeriesCapacity(Series(series), maxReadLength));
+    }
+    for (unsigned tag = 0; TAGS_COUNT != tag; ++tag)
+    {
+        tagSeries_[tag].reserve(getTagSeriesCapacity());
+    }
+    header_.reserve(COMPRESSION_HEADER_BYTES_MAX);
+    map_.reserve(COMPRESSION_HEADER_BYTES_MAX);
+    containerHeader_.reserve(bam::CRAM_CONTAINER_HEADER_BYTES_MAX);
+    std::fill(tagLineIndex_, tagLineIndex_ + TAG_LINES_MAX, -1);
+}
+
+std::size_t CramSliceEncoder::getSeriesCapacity(const Series series, const unsigned maxReadLength)
+{
+    switch (series)
+    {
+    case RN:
+        return SLICE_RECORDS_MAX * READ_NAME_BYTES_TYPICAL;
+    case BA:
+    case QS:
+        return SLICE_RECORDS_MAX * maxReadLength;
+    case FC:
+    case FP:
+    case BS:
+    case IN:
+    case SC:
+        // Plenty for the usual number of mismatches. Slices holding poorly aligned data will just be smaller
+        return SLICE_RECORDS_MAX * maxReadLength / 4;
+    default:
+        return SLICE_RECORDS_MAX * bam::CRAM_ITF8_BYTES_MAX;
+    }
+}
+
+std::size_t CramSliceEncoder::getTagSeriesCapacity()
+{
+    return SLICE_RECORDS_MAX * TAG_BYTES_TYPICAL;
+}
+
+std::size_t CramSliceEncoder::getMaxBlockBytes(const unsigned maxReadLength)
+{
+    std::size_t ret = std::max<std::size_t>(getTagSeriesCapacity(), COMPRESSION_HEADER_BYTES_MAX);
+    for (unsigned series = 0; SERIES_COUNT != series; ++series)
+    {
+        ret = std::max(ret, getSeriesCapacity(Series(series), maxReadLength));
+    }
+    return ret;
+}
+
+unsigned long CramSliceEncoder::getMemoryRequirements(const unsigned maxReadLength)
+{
+    unsigned long ret = TAGS_COUNT * getTagSeriesCapacity() + 2 * COMPRESSION_HEADER_BYTES_MAX;
+    for (unsigned series = 0; SERIES_COUNT != series; ++series)
+    {
+        ret += getSeriesCapacity(Series(series), maxReadLength);
+    }
+    // compression buffer and the deflate state
+    return ret + getMaxBlockBytes(maxReadLength) + 512 * 1024;
+}
+
+unsigned long CramSliceEncoder::getMaxContainerBytes(const unsigned maxReadLength)
+{
+    // blocks are stored raw when compression does not help
+    unsigned long ret = bam::CRAM_CONTAINER_HEADER_BYTES_MAX + TAGS_COUNT * getTagSeriesCapacity() +
+        2 * COMPRESSION_HEADER_BYTES_MAX + (SERIES_COUNT + TAGS_COUNT + 3) * bam::CRAM_BLOCK_OVERHEAD_BYTES_MAX;
+    for (unsigned series = 0; SERIES_COUNT != series; ++series)
+    {
+        ret += getSeriesCapacity(Series(series), maxReadLength);
+    }
+    return ret;
+}
+
+int CramSliceEncoder::getTagKey(const Tag tag)
+{
+    const TagDescription &description = TAG_DESCRIPTIONS[tag];
+    return description.name_[0] << 16 | description.name_[1] << 8 | description.type_;
+}
+
+void CramSliceEncoder::encode(FragmentAccessorBamAdapter &adapter, const std::vector<char> *contig)
+{
+    if (records_ && (sliceRefId_ != adapter.refId() || SLICE_RECORDS_MAX == records_))
+    {
+        flush();
+    }
+
+    if (!encodeRecord(adapter, contig))
+    {
+        ISAAC_ASSERT_MSG(records_, "Record does not fit into an empty CRAM slice " << adapter.getFragment());
+        flush();
+        const bool encoded = encodeRecord(adapter, contig);
+        ISAAC_ASSERT_MSG(encoded, "Record does not fit into an empty CRAM slice " << adapter.getFragment());
+    }
+}
+
+bool CramSliceEncoder::overflown() const
+{
+    for (unsigned series = 0; SERIES_COUNT != series; ++series)
+    {
+        if (series_[series].overflown())
+        {
+            return true;
+        }
+    }
+    for (unsigned tag = 0; TAGS_COUNT != tag; ++tag)
+    {
+        if (tagSeries_[tag].overflown())
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * \return false if the record does not fit in the current slice. The slice is left unchanged in this case.
+ */
+bool CramSliceEncoder::encodeRecord(FragmentAccessorBamAdapter &adapter, const std::vector<char> *contig)
+{
+    const io::FragmentAccessor &fragment = adapter.getFragment();
+    const unsigned flag = adapter.flag();
+    const int pos = adapter.pos();
+    // one-based, 0 for records without position
+    const int alignmentStart = pos + 1;
+    if (!records_)
+    {
+        sliceRefId_ = adapter.refId();
+        sliceStart_ = alignmentStart;
+        sliceEnd_ = alignmentStart;
+        lastAlignmentStart_ = alignmentStart;
+    }
+
+    std::size_t seriesSizes[SERIES_COUNT];
+    for (unsigned series = 0; SERIES_COUNT != series; ++series)
+    {
+        seriesSizes[series] = series_[series].size();
+    }
+    std::size_t tagSeriesSizes[TAGS_COUNT];
+    for (unsigned tag = 0; TAGS_COUNT != tag; ++tag)
+    {
+        tagSeriesSizes[tag] = tagSeries_[tag].size();
+    }
+    const unsigned tagLinesCount = tagLinesCount_;
+    const unsigned sliceTagsMask = sliceTagsMask_;
+
+    bam::appendItf8(series_[BF], flag);
+    bam::appendItf8(series_[CF], CF_QUALITY_AS_ARRAY | CF_DETACHED);
+    bam::appendItf8(series_[RL], adapter.seqLen());
+    bam::appendItf8(series_[AP], alignmentStart - lastAlignmentStart_);
+    // read groups are stored in RG tag same way as in BAM
+    bam::appendItf8(series_[RG], -1);
+    const char *readName = adapter.readName();
+    // terminating zero is the stop byte
+    series_[RN].append(readName, readName + strlen(readName) + 1);
+
+    bam::appendItf8(series_[MF],
+               ((flag & BAM_FLAG_MATE_REVERSE) ? MF_MATE_REVERSE : 0) |
+               ((flag & BAM_FLAG_MATE_UNMAPPED) ? MF_MATE_UNMAPPED : 0));
+    bam::appendItf8(series_[NS], adapter.nextRefId());
+    bam::appendItf8(series_[NP], adapter.nextPos() + 1);
+    bam::appendItf8(series_[TS], adapter.tlen());
+
+    encodeTags(adapter);
+
+    if (flag & BAM_FLAG_UNMAPPED)
+    {
+        for (const unsigned char *base = fragment.basesBegin(); fragment.basesEnd() != base; ++base)
+        {
+            series_[BA].push_back(oligo::getUppercaseBaseFromBcl(*base));
+        }
+    }
+    else
+    {
+        ISAAC_ASSERT_MSG(contig, "Reference is required for aligned records " << fragment);
+        encodeFeatures(adapter, *contig);
+        bam::appendItf8(series_[MQ], adapter.mapq());
+    }
+
+    for (const unsigned char *base = fragment.basesBegin(); fragment.basesEnd() != base; ++base)
+    {
+        series_[QS].push_back(FragmentAccessorBamAdapter::bamQualFromBclByte(*base));
+    }
+
+    if (overflown())
+    {
+        for (unsigned series = 0; SERIES_COUNT != series; ++series)
+        {
+            series_[series].truncate(seriesSizes[series]);
+        }
+        for (unsigned tag = 0; TAGS_COUNT != tag; ++tag)
+        {
+            tagSeries_[tag].truncate(tagSeriesSizes[tag]);
+        }
+        while (tagLinesCount_ != tagLinesCount)
+        {
+            tagLineIndex_[tagLineMasks_[--tagLinesCount_]] = -1;
+        }
+        sliceTagsMask_ = sliceTagsMask;
+        return false;
+    }
+
+    ++records_;
+    bases_ += adapter.seqLen();
+    lastAlignmentStart_ = alignmentStart;
+    sliceEnd_ = std::max(sliceEnd_, pos + std::max(adapter.observedLength(), 1));
+    return true;
+}
+
+void CramSliceEncoder::encodeTag(const Tag tag, const bam::iTag &value, unsigned &mask)
+{
+    if (!value.empty())
+    {
+        mask |= 1 << tag;
+        bam::appendItf8(tagSeries_[tag], sizeof(value.value_));
+        bam::appendInt32(tagSeries_[tag], value.value_);
+    }
+}
+
+void CramSliceEncoder::encodeTag(const Tag tag, const bam::zTag &value, unsigned &mask)
+{
+    if (!value.empty() && value.value_)
+    {
+        mask |= 1 << tag;
+        bam::appendItf8(tagSeries_[tag], std::distance(value.value_, value.valueEnd_));
+        tagSeries_[tag].append(value.value_, value.valueEnd_);
+    }
+}
+
+void CramSliceEncoder::encodeTags(FragmentAccessorBamAdapter &adapter)
+{
+    unsigned mask = 0;
+    encodeTag(TAG_SM, adapter.getFragmentSM(), mask);
+    encodeTag(TAG_AS, adapter.getFragmentAS(), mask);
+    encodeTag(TAG_RG, adapter.getFragmentRG(), mask);
+    encodeTag(TAG_NM, adapter.getFragmentNM(), mask);
+    encodeTag(TAG_BC, adapter.getFragmentBC(), mask);
+    encodeTag(TAG_OC, adapter.getFragmentOC(), mask);
+    encodeTag(TAG_ZX, adapter.getFragmentZX(), mask);
+    encodeTag(TAG_ZY, adapter.getFragmentZY(), mask);
+    bam::appendItf8(series_[TL], getTagLine(mask));
+    sliceTagsMask_ |= mask;
+}
+
+unsigned CramSliceEncoder::getTagLine(const unsigned mask)
+{
+    if (-1 == tagLineIndex_[mask])
+    {
+        tagLineIndex_[mask] = tagLinesCount_;
+        tagLineMasks_[tagLinesCount_++] = mask;
+    }
+    return tagLineIndex_[mask];
+}
+
+void CramSliceEncoder::addFeature(
+    const char code,
+    const unsigned readPosition,
+    unsigned &lastFeaturePosition,
+    unsigned &features)
+{
+    series_[FC].push_back(code);
+    // feature positions are one-based and delta-encoded within the record
+    bam::appendItf8(series_[FP], readPosition + 1 - lastFeaturePosition);
+    lastFeaturePosition = readPosition + 1;
+    ++features;
+}
+
+/**
+ * \brief Stores the differences between the read and the reference. The decoder takes the rest of the read
+ *        bases from the reference.
+ */
+void CramSliceEncoder::encodeFeatures(FragmentAccessorBamAdapter &adapter, const std::vector<char> &contig)
+{
+    const io::FragmentAccessor &fragment = adapter.getFragment();
+    const unsigned char *const bases = fragment.basesBegin();
+    unsigned features = 0;
+    unsigned lastFeaturePosition = 0;
+    unsigned readPosition = 0;
+    unsigned long referencePosition = adapter.pos();
+
+    const FragmentAccessorBamAdapter::CigarBeginEnd cigar = adapter.cigar();
+    for (const unsigned *it = cigar.first; cigar.second != it; ++it)
+    {
+        const alignment::Cigar::Component component = alignment::Cigar::decode(*it);
+        const unsigned length = component.first;
+        switch (component.second)
+        {
+        case alignment::Cigar::ALIGN:
+        case alignment::Cigar::MATCH:
+        case alignment::Cigar::MISMATCH:
+            for (const unsigned end = readPosition + length; end != readPosition; ++readPosition, ++referencePosition)
+            {
+                const char base = oligo::getUppercaseBaseFromBcl(bases[readPosition]);
+                const char refBase = contig.size() > referencePosition ? contig[referencePosition] : 'N';
+                if (base != refBase)
+                {
+                    addFeature('X', readPosition, lastFeaturePosition, features);
+                    series_[BS].push_back(getSubstitutionCode(refBase, base));
+                }
+                else if ('N' == refBase)
+                {
+                    // reference N can be any IUPAC code in the original fasta. Store the base explicitly
+                    addFeature('B', readPosition, lastFeaturePosition, features);
+                    series_[BA].push_back(base);
+                    series_[QS].push_back(FragmentAccessorBamAdapter::bamQualFromBclByte(bases[readPosition]));
+                }
+            }
+            break;
+        case alignment::Cigar::INSERT:
+        case alignment::Cigar::SOFT_CLIP:
+        {
+            const Series series = alignment::Cigar::INSERT == component.second ? IN : SC;
+            addFeature(alignment::Cigar::INSERT == component.second ? 'I' : 'S', readPosition, lastFeaturePosition, features);
+            for (const unsigned end = readPosition + length; end != readPosition; ++readPosition)
+            {
+                series_[series].push_back(oligo::getUppercaseBaseFromBcl(bases[readPosition]));
+            }
+            series_[series].push_back(0);
+            break;
+        }
+        case alignment::Cigar::DELETE:
+            addFeature('D', readPosition, lastFeaturePosition, features);
+            bam::appendItf8(series_[DL], length);
+            referencePosition += length;
+            break;
+        case alignment::Cigar::SKIP:
+            addFeature('N', readPosition, lastFeaturePosition, features);
+            bam::appendItf8(series_[RS], length);
+            referencePosition += length;
+            break;
+        case alignment::Cigar::HARD_CLIP:
+            addFeature('H', readPosition, lastFeaturePosition, features);
+            bam::appendItf8(series_[HC], length);
+            break;
+        case alignment::Cigar::PAD:
+            addFeature('P', readPosition, lastFeaturePosition, features);
+            bam::appendItf8(series_[PD], length);
+            break;
+        default:
+            ISAAC_ASSERT_MSG(false, "Unexpected CIGAR operation " << component.second << " in " << fragment);
+            break;
+        }
+    }
+    bam::appendItf8(series_[FN], features);
+}
+
+void CramSliceEncoder::makeCompressionHeader()
+{
+    header_.clear();
+
+    // preservation map. Read names are kept, positions are delta-encoded and the reference is required
+    map_.clear();
+    map_.push_back('R'); map_.push_back('N'); map_.push_back(1);
+    map_.push_back('A'); map_.push_back('P'); map_.push_back(1);
+    map_.push_back('R'); map_.push_back('R'); map_.push_back(1);
+    map_.push_back('S'); map_.push_back('M');
+    map_.insert(map_.end(), 5, SUBSTITUTION_MATRIX_ROW);
+    map_.push_back('T'); map_.push_back('D');
+    unsigned tagDictionaryLength = 0;
+    for (unsigned line = 0; tagLinesCount_ != line; ++line)
+    {
+        tagDictionaryLength += 3 * __builtin_popcount(tagLineMasks_[line]) + 1;
+    }
+    bam::appendItf8(map_, tagDictionaryLength);
+    for (unsigned line = 0; tagLinesCount_ != line; ++line)
+    {
+        for (unsigned tag = 0; TAGS_COUNT != tag; ++tag)
+        {
+            if (tagLineMasks_[line] & (1 << tag))
+            {
+                map_.push_back(TAG_DESCRIPTIONS[tag].name_[0]);
+                map_.push_back(TAG_DESCRIPTIONS[tag].name_[1]);
+                map_.push_back(TAG_DESCRIPTIONS[tag].type_);
+            }
+        }
+        map_.push_back(0);
+    }
+    appendMap(map_, 5, header_);
+
+    // data series encodings. Every series goes into its own external block
+    map_.clear();
+    for (unsigned series = 0; SERIES_COUNT != series; ++series)
+    {
+        map_.push_back(SERIES_NAMES[series * 2]);
+        map_.push_back(SERIES_NAMES[series * 2 + 1]);
+        if (RN == series || IN == series || SC == series)
+        {
+            appendByteArrayStopEncoding(map_, getSeriesBlockId(series));
+        }
+        else
+        {
+            appendExternalEncoding(map_, getSeriesBlockId(series));
+        }
+    }
+    appendMap(map_, SERIES_COUNT, header_);
+
+    // tag encodings. Block content id is the tag key
+    map_.clear();
+    unsigned tags = 0;
+    for (unsigned tag = 0; TAGS_COUNT != tag; ++tag)
+    {
+        if (sliceTagsMask_ & (1 << tag))
+        {
+            bam::appendItf8(map_, getTagKey(Tag(tag)));
+            appendByteArrayLenEncoding(map_, getTagKey(Tag(tag)));
+            ++tags;
+        }
+    }
+    appendMap(map_, tags, header_);
+}
+
+void CramSliceEncoder::makeSliceHeader()
+{
+    header_.clear();
+    const unsigned tags = __builtin_popcount(sliceTagsMask_);
+    bam::appendItf8(header_, sliceRefId_);
+    bam::appendItf8(header_, sliceStart_);
+    bam::appendItf8(header_, -1 == sliceRefId_ ? 0 : sliceEnd_ - sliceStart_ + 1);
+    bam::appendItf8(header_, records_);
+    bam::appendFixedLtf8(header_, recordCounter_);
+    // core block followed by the external ones
+    bam::appendItf8(header_, 1 + SERIES_COUNT + tags);
+    bam::appendItf8(header_, SERIES_COUNT + tags);
+    for (unsigned series = 0; SERIES_COUNT != series; ++series)
+    {
+        bam::appendItf8(header_, getSeriesBlockId(series));
+    }
+    for (unsigned tag = 0; TAGS_COUNT != tag; ++tag)
+    {
+        if (sliceTagsMask_ & (1 << tag))
+        {
+            bam::appendItf8(header_, getTagKey(Tag(tag)));
+        }
+    }
+    // no embedded reference
+    bam::appendItf8(header_, -1);
+    // zero md5 tells decoders to not verify the reference. The loaded contigs have IUPAC codes replaced with N,
+    // so their md5 would not match the fasta for slices that cover such bases
+    header_.insert(header_.end(), 16, 0);
+}
+
+void CramSliceEncoder::flush()
+{
+    if (!records_)
+    {
+        return;
+    }
+
+    // leave room for the container header, which can only be produced once the blocks are in place
+    const std::size_t containerBegin = output_.size();
+    output_.resize(containerBegin + bam::CRAM_CONTAINER_HEADER_BYTES_MAX);
+    const std::size_t blocksBegin = output_.size();
+
+    makeCompressionHeader();
+    compressor_.appendBlock(bam::CRAM_COMPRESSION_HEADER, 0, &header_.front(), &header_.front() + header_.size(), output_);
+    const int landmark = output_.size() - blocksBegin;
+
+    makeSliceHeader();
+    rawCompressor_.appendBlock(bam::CRAM_SLICE_HEADER, 0, &header_.front(), &header_.front() + header_.size(), output_);
+    compressor_.appendBlock(bam::CRAM_CORE_DATA, 0, 0, 0, output_);
+    unsigned blocks = 3;
+    for (unsigned series = 0; SERIES_COUNT != series; ++series, ++blocks)
+    {
+        compressor_.appendBlock(
+            bam::CRAM_EXTERNAL_DATA, getSeriesBlockId(series), series_[series].begin(), series_[series].end(), output_);
+    }
+    for (unsigned tag = 0; TAGS_COUNT != tag; ++tag)
+    {
+        if (sliceTagsMask_ & (1 << tag))
+        {
+            compressor_.appendBlock(
+                bam::CRAM_EXTERNAL_DATA, getTagKey(Tag(tag)), tagSeries_[tag].begin(), tagSeries_[tag].end(), output_);
+            ++blocks;
+        }
+    }
+
+    const std::size_t blocksLength = output_.size() - blocksBegin;
+    containerHeader_.clear();
+    bam::appendCramContainerHeader(
+        sliceRefId_, sliceStart_, -1 == sliceRefId_ ? 0 : sliceEnd_ - sliceStart_ + 1,
+        records_, recordCounter_, bases_, blocks, landmark, blocksLength, containerHeader_);
+
+    std::copy(containerHeader_.begin(), containerHeader_.end(), output_.begin() + containerBegin);
+    std::memmove(&output_[containerBegin + containerHeader_.size()], &output_[blocksBegin], blocksLength);
+    output_.resize(containerBegin + containerHeader_.size() + blocksLength);
+
+    recordCounter_ += records_;
+    resetSlice();
+}
+
+void CramSliceEncoder::resetSlice()
+{
+    for (unsigned series = 0; SERIES_COUNT != series; ++series)
+    {
+        series_[series].clear();
+    }
+    for (unsigned tag = 0; TAGS_COUNT != tag; ++tag)
+    {
+        tagSeries_[tag].clear();
+    }
+    while (tagLinesCount_)
+    {
+        tagLineIndex_[tagLineMasks_[--tagLinesCount_]] = -1;
+    }
+    sliceTagsMask_ = 0;
+    records_ = 0;
+    bases_ = 0;
+}
+
+} // namespace build
+} // namespace isaac
@@ -0,0 +1,225 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/foreach.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/xml_parser.hpp>
+#include <boost/ref.hpp>
+
+#include "RegistryName.hh"
+#include "testBuildMetrics.hh"
+
+#include "alignment/Cigar.hh"
+#include "build/BuildMetrics.hh"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( TestBuildMetrics, registryName("TestBuildMetrics"));
+
+using namespace isaac;
+
+void TestBuildMetrics::setUp()
+{
+    tempDirectory_ = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("testBuildMetrics-%%%%%%%%");
+    boost::filesystem::create_directories(tempDirectory_);
+}
+
+void TestBuildMetrics::tearDown()
+{
+    boost::filesystem::remove_all(tempDirectory_);
+}
+
+namespace
+{
+
+static const unsigned READ_LENGTH = 10;
+static const unsigned CONTIG_LENGTH = 200;
+static const unsigned BIN_LENGTH = 100;
+
+/// single read aligned without gaps at the given position
+class AlignedRead
+{
+public:
+    explicit AlignedRead(const unsigned position) :
+        data_(io::FragmentHeader::getTotalLength(READ_LENGTH, 1))
+    {
+        io::FragmentHeader &header = *new (&data_.front()) io::FragmentHeader();
+        header.readLength_ = READ_LENGTH;
+        header.cigarLength_ = 1;
+        header.observedLength_ = READ_LENGTH;
+        header.fStrandPosition_ = reference::ReferencePosition(0, position);
+
+        io::FragmentAccessor &fragment = getFragment();
+        *reinterpret_cast<unsigned *>(fragment.basesBegin() + READ_LENGTH) =
+            alignment::Cigar::encode(READ_LENGTH, alignment::Cigar::ALIGN);
+    }
+
+    const io::FragmentAccessor &getFragment() const
+    {
+        return *reinterpret_cast<const io::FragmentAccessor *>(&data_.front());
+    }
+
+    io::FragmentAccessor &getFragment()
+    {
+        return *reinterpret_cast<io::FragmentAccessor *>(&data_.front());
+    }
+
+private:
+    std::vector<char> data_;
+};
+
+/// single sample, single barcode, one contig split into two bins
+struct Layout
+{
+    Layout() :
+        sortedReferenceMetadataList(1),
+        barcodeMetadataList(
+            1, flowcell::BarcodeMetadata("FC1", 0, 1, 0, false, flowcell::SequencingAdapterMetadataList())),
+        barcodeBamMapping(
+            build::BarcodeBamMapping::BarcodeProjectIndexMap(1, 0),
+            build::BarcodeBamMapping::BarcodeSampleIndexMap(1, 0),
+            std::vector<boost::filesystem::path>(1, "sample.bam"))
+    {
+        sortedReferenceMetadataList.front().putContig(
+            0, "chr1", "chr1.fa", 0, CONTIG_LENGTH, CONTIG_LENGTH, CONTIG_LENGTH, 0, 0, "", "", "");
+        barcodeMetadataList.front().setIndex(0);
+        bins.resize(2);
+        bins.at(0) = alignment::BinMetadata(1, 0, reference::ReferencePosition(0, 0), BIN_LENGTH, "", 0);
+        bins.at(1) = alignment::BinMetadata(1, 1, reference::ReferencePosition(0, BIN_LENGTH), BIN_LENGTH, "", 0);
+        BOOST_FOREACH(const alignment::BinMetadata &bin, bins)
+        {
+            binRefs.push_back(boost::cref(bin));
+        }
+    }
+
+    reference::SortedReferenceMetadataList sortedReferenceMetadataList;
+    flowcell::BarcodeMetadataList barcodeMetadataList;
+    build::BarcodeBamMapping barcodeBamMapping;
+    alignment::BinMetadataList bins;
+    alignment::BinMetadataCRefList binRefs;
+};
+
+/// \return [bucket] = count of the histogram element of the only sample in the metrics xml
+std::map<unsigned, unsigned long> readHistogram(
+    const boost::property_tree::ptree &metrics, const std::string &histogram, const std::string &bucketAttribute)
+{
+    std::map<unsigned, unsigned long> ret;
+    BOOST_FOREACH(const boost::property_tree::ptree::value_type &bucket,
+                  metrics.get_child("Metrics.Project.Sample." + histogram))
+    {
+        ret[bucket.second.get<unsigned>("<xmlattr>." + bucketAttribute)] = bucket.second.get_value<unsigned long>();
+    }
+    return ret;
+}
+
+} // namespace
+
+void TestBuildMetrics::testBinBoundary()
+{
+    Layout layout;
+    build::BuildMetrics buildMetrics(
+        layout.barcodeBamMapping, layout.barcodeMetadataList, layout.sortedReferenceMetadataList, READ_LENGTH, 0, true);
+
+    // reads of the first bin hang over into the second one. Depths:
+    // 95-97:1 98-99:2 100-101:3 102-104:4 105-107:3 108-109:2 110-111:1
+    std::vector<AlignedRead> firstBinReads;
+    firstBinReads.push_back(AlignedRead(95));
+    firstBinReads.push_back(AlignedRead(98));
+    std::vector<AlignedRead> secondBinReads;
+    secondBinReads.push_back(AlignedRead(100));
+    secondBinReads.push_back(AlignedRead(102));
+
+    // bins are processed by different threads and merged in order
+    build::BinMetrics firstBinMetrics(buildMetrics);
+    build::BinMetrics secondBinMetrics(buildMetrics);
+    secondBinMetrics.startBin(layout.bins.at(1));
+    BOOST_FOREACH(const AlignedRead &read, secondBinReads)
+    {
+        secondBinMetrics.addFragment(read.getFragment());
+    }
+    secondBinMetrics.finishBin();
+    firstBinMetrics.startBin(layout.bins.at(0));
+    BOOST_FOREACH(const AlignedRead &read, firstBinReads)
+    {
+        firstBinMetrics.addFragment(read.getFragment());
+    }
+    firstBinMetrics.finishBin();
+
+    buildMetrics.merge(firstBinMetrics);
+    buildMetrics.merge(secondBinMetrics);
+
+    const build::BuildStats buildStats(layout.binRefs, layout.barcodeMetadataList);
+    const boost::filesystem::path metricsXmlPath = tempDirectory_ / "BuildMetrics.xml";
+    buildMetrics.dump(metricsXmlPath, tempDirectory_ / "Coverage", layout.binRefs, buildStats);
+
+    boost::property_tree::ptree metrics;
+    boost::property_tree::read_xml(metricsXmlPath.string(), metrics);
+    CPPUNIT_ASSERT_EQUAL(40UL, metrics.get<unsigned long>("Metrics.Project.Sample.AlignedBases"));
+    CPPUNIT_ASSERT_EQUAL(17UL, metrics.get<unsigned long>("Metrics.Project.Sample.CoveredBases"));
+
+    std::map<unsigned, unsigned long> expected;
+    expected[0] = CONTIG_LENGTH - 17;
+    expected[1] = 5;
+    expected[2] = 4;
+    expected[3] = 5;
+    expected[4] = 3;
+    const std::map<unsigned, unsigned long> depthHistogram = readHistogram(metrics, "DepthHistogram", "depth");
+    CPPUNIT_ASSERT_EQUAL(expected.size(), depthHistogram.size());
+    CPPUNIT_ASSERT(expected == depthHistogram);
+}
+
+void TestBuildMetrics::testDuplicateSets()
+{
+    Layout layout;
+    const build::BuildStats buildStats(layout.binRefs, layout.barcodeMetadataList);
+    {
+        build::BuildMetrics buildMetrics(
+            layout.barcodeBamMapping, layout.barcodeMetadataList, layout.sortedReferenceMetadataList, READ_LENGTH, 0, true);
+        build::BinMetrics binMetrics(buildMetrics);
+        binMetrics.startBin(layout.bins.at(0));
+        binMetrics.addDuplicateSet(0, 1);
+        binMetrics.addDuplicateSet(0, 3);
+        binMetrics.addDuplicateSet(0, 3);
+        binMetrics.finishBin();
+        buildMetrics.merge(binMetrics);
+
+        const boost::filesystem::path metricsXmlPath = tempDirectory_ / "Dedup.xml";
+        buildMetrics.dump(metricsXmlPath, tempDirectory_ / "Coverage", layout.binRefs, buildStats);
+        boost::property_tree::ptree metrics;
+        boost::property_tree::read_xml(metricsXmlPath.string(), metrics);
+        const std::map<unsigned, unsigned long> duplicateSetHistogram =
+            readHistogram(metrics, "DuplicateSetHistogram", "size");
+        CPPUNIT_ASSERT_EQUAL(2UL, duplicateSetHistogram.size());
+        CPPUNIT_ASSERT_EQUAL(1UL, duplicateSetHistogram.at(1));
+        CPPUNIT_ASSERT_EQUAL(2UL, duplicateSetHistogram.at(3));
+    }
+    {
+        // duplicates are not resolved, so the histogram would be empty
+        build::BuildMetrics buildMetrics(
+            layout.barcodeBamMapping, layout.barcodeMetadataList, layout.sortedReferenceMetadataList, READ_LENGTH, 0, false);
+        build::BinMetrics binMetrics(buildMetrics);
+        binMetrics.startBin(layout.bins.at(0));
+        binMetrics.addDuplicateSet(0, 3);
+        binMetrics.finishBin();
+        buildMetrics.merge(binMetrics);
+
+        const boost::filesystem::path metricsXmlPath = tempDirectory_ / "NoDedup.xml";
+        buildMetrics.dump(metricsXmlPath, tempDirectory_ / "Coverage", layout.binRefs, buildStats);
+        boost::property_tree::ptree metrics;
+        boost::property_tree::read_xml(metricsXmlPath.string(), metrics);
+        CPPUNIT_ASSERT(!metrics.get_child_optional("Metrics.Project.Sample.DuplicateSetHistogram"));
+        CPPUNIT_ASSERT(metrics.get_child_optional("Metrics.Project.Sample.DepthHistogram"));
+    }
+}
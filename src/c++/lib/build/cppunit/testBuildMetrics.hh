@@ -0,0 +1,36 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#ifndef iSAAC_BUILD_TEST_BUILD_METRICS_HH
+#define iSAAC_BUILD_TEST_BUILD_METRICS_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <boost/filesystem.hpp>
+
+class TestBuildMetrics : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( TestBuildMetrics );
+    CPPUNIT_TEST( testBinBoundary );
+    CPPUNIT_TEST( testDuplicateSets );
+    CPPUNIT_TEST_SUITE_END();
+private:
+    boost::filesystem::path tempDirectory_;
+public:
+    void setUp();
+    void tearDown();
+    void testBinBoundary();
+    void testDuplicateSets();
+};
+
+#endif // #ifndef iSAAC_BUILD_TEST_BUILD_METRICS_HH
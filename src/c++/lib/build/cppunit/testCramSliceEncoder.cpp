@@ -0,0 +1,225 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#include <string>
+#include <vector>
+
+#include <boost/foreach.hpp>
+#include <boost/ref.hpp>
+
+#include "RegistryName.hh"
+#include "testCramSliceEncoder.hh"
+
+#include "bam/Cram.hh"
+#include "build/BuildContigMap.hh"
+#include "build/CramSliceEncoder.hh"
+#include "common/MD5Sum.hh"
+#include "oligo/Nucleotides.hh"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( TestCramSliceEncoder, registryName("TestCramSliceEncoder"));
+
+using namespace isaac;
+
+void TestCramSliceEncoder::setUp()
+{
+}
+
+void TestCramSliceEncoder::tearDown()
+{
+}
+
+namespace
+{
+
+static const unsigned READ_LENGTH = 10;
+static const unsigned CONTIG_LENGTH = 200;
+
+/// single read aligned without gaps at the given position with bases taken from the contig
+class AlignedRead
+{
+public:
+    AlignedRead(const std::vector<char> &contig, const unsigned position, const unsigned long clusterId) :
+        data_(io::FragmentHeader::getTotalLength(READ_LENGTH, 1))
+    {
+        io::FragmentHeader &header = *new (&data_.front()) io::FragmentHeader();
+        header.readLength_ = READ_LENGTH;
+        header.cigarLength_ = 1;
+        header.observedLength_ = READ_LENGTH;
+        header.fStrandPosition_ = reference::ReferencePosition(0, position);
+        header.alignmentScore_ = 60;
+        header.clusterId_ = clusterId;
+
+        io::FragmentAccessor &fragment = getFragment();
+        unsigned char *base = fragment.basesBegin();
+        for (unsigned i = 0; READ_LENGTH != i; ++i, ++base)
+        {
+            const char referenceBase = contig.size() > position + i ? contig.at(position + i) : 'A';
+            *base = (30 << 2) | oligo::getValue(referenceBase);
+        }
+        *reinterpret_cast<unsigned *>(base) = alignment::Cigar::encode(READ_LENGTH, alignment::Cigar::ALIGN);
+    }
+
+    io::FragmentAccessor &getFragment()
+    {
+        return *reinterpret_cast<io::FragmentAccessor *>(&data_.front());
+    }
+
+    build::PackedFragmentBuffer::Index getIndex()
+    {
+        const io::FragmentAccessor &fragment = getFragment();
+        return build::PackedFragmentBuffer::Index(
+            fragment.fStrandPosition_, 0, 0, fragment.cigarBegin(), fragment.cigarEnd());
+    }
+
+private:
+    std::vector<char> data_;
+};
+
+struct Slice
+{
+    int refId_;
+    int alignmentStart_;
+    int alignmentSpan_;
+    int records_;
+    unsigned long containerRecordCounter_;
+    unsigned long sliceRecordCounter_;
+    std::string md5_;
+};
+
+/// parses the container at p and leaves p pointing at the next one
+Slice readSlice(const unsigned char *&p)
+{
+    Slice ret;
+    const int blocksLength = bam::readInt32(p);
+    ret.refId_ = bam::readItf8(p);
+    ret.alignmentStart_ = bam::readItf8(p);
+    ret.alignmentSpan_ = bam::readItf8(p);
+    ret.records_ = bam::readItf8(p);
+    ret.containerRecordCounter_ = bam::readLtf8(p);
+    bam::readLtf8(p);
+    bam::readItf8(p);
+    CPPUNIT_ASSERT_EQUAL(1, bam::readItf8(p));
+    const int landmark = bam::readItf8(p);
+    bam::readInt32(p);
+    const unsigned char *const blocksBegin = p;
+
+    const unsigned char *block = blocksBegin + landmark;
+    CPPUNIT_ASSERT_EQUAL(0, int(block[0]));
+    CPPUNIT_ASSERT_EQUAL(int(bam::CRAM_SLICE_HEADER), int(block[1]));
+    block += 2;
+    bam::readItf8(block);
+    bam::readItf8(block);
+    bam::readItf8(block);
+    CPPUNIT_ASSERT_EQUAL(ret.refId_, bam::readItf8(block));
+    CPPUNIT_ASSERT_EQUAL(ret.alignmentStart_, bam::readItf8(block));
+    CPPUNIT_ASSERT_EQUAL(ret.alignmentSpan_, bam::readItf8(block));
+    CPPUNIT_ASSERT_EQUAL(ret.records_, bam::readItf8(block));
+    ret.sliceRecordCounter_ = bam::readLtf8(block);
+    const int blocks = bam::readItf8(block);
+    const int contentIds = bam::readItf8(block);
+    CPPUNIT_ASSERT_EQUAL(blocks - 1, contentIds);
+    for (int i = 0; contentIds != i; ++i)
+    {
+        bam::readItf8(block);
+    }
+    // embedded reference
+    CPPUNIT_ASSERT_EQUAL(-1, bam::readItf8(block));
+    ret.md5_ = common::MD5Sum::toHexString(block, 16);
+
+    p = blocksBegin + blocksLength;
+    return ret;
+}
+
+/// slices carry zero reference md5 so that decoders skip the check
+static const std::string ZERO_MD5(32, '0');
+
+} // namespace
+
+void TestCramSliceEncoder::testSliceHeaders()
+{
+    std::vector<char> contig;
+    for (unsigned i = 0; CONTIG_LENGTH != i; ++i)
+    {
+        contig.push_back("ACGTTGCAAC"[(i * 7 + i / 3) % 10]);
+    }
+
+    reference::SortedReferenceMetadataList sortedReferenceMetadataList(1);
+    sortedReferenceMetadataList.front().putContig(
+        0, "chr1", "chr1.fa", 0, CONTIG_LENGTH, CONTIG_LENGTH, CONTIG_LENGTH, 0, 0, "", "", "");
+    flowcell::BarcodeMetadataList barcodeMetadataList(
+        1, flowcell::BarcodeMetadata("FC1", 0, 1, 0, false, flowcell::SequencingAdapterMetadataList()));
+    barcodeMetadataList.front().setIndex(0);
+    alignment::BinMetadataList bins(1);
+    bins.front() = alignment::BinMetadata(1, 0, reference::ReferencePosition(0, 0), CONTIG_LENGTH, "", 0);
+    const alignment::BinMetadataCRefList binRefs(1, boost::cref(bins.front()));
+    const build::BuildContigMap contigMap(barcodeMetadataList, binRefs, sortedReferenceMetadataList, false);
+    flowcell::TileMetadataList tileMetadataList;
+    tileMetadataList.push_back(flowcell::TileMetadata("FC1", 0, 1101, 1, 1000, 0));
+    const flowcell::FlowcellLayoutList flowcellLayoutList;
+    build::FragmentAccessorBamAdapter adapter(
+        READ_LENGTH, tileMetadataList, barcodeMetadataList, contigMap, 0, flowcellLayoutList,
+        build::IncludeTags(false, false, false, false, false, false, false, false), false);
+
+    std::vector<char> output;
+    output.reserve(3 * build::CramSliceEncoder::getMaxContainerBytes(READ_LENGTH));
+    build::CramSliceEncoder encoder(1, READ_LENGTH, output);
+
+    // two slices in the middle of the contig and one hanging off its end
+    const unsigned positions[] = {10, 20, 30, 50, 60, 195};
+    std::vector<AlignedRead> reads;
+    for (unsigned i = 0; sizeof(positions) / sizeof(positions[0]) != i; ++i)
+    {
+        reads.push_back(AlignedRead(contig, positions[i], i));
+    }
+    for (unsigned i = 0; reads.size() != i; ++i)
+    {
+        encoder.encode(adapter(reads.at(i).getIndex(), reads.at(i).getFragment()), &contig);
+        if (2 == i || 4 == i)
+        {
+            encoder.flush();
+        }
+    }
+    encoder.flush();
+
+    // the records of preceding bins are added when the bin gets saved
+    unsigned long recordCounter = 100;
+    bam::offsetCramRecordCounters(&output.front(), &output.front() + output.size(), recordCounter);
+    CPPUNIT_ASSERT_EQUAL(106UL, recordCounter);
+
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(&output.front());
+    const Slice first = readSlice(p);
+    CPPUNIT_ASSERT_EQUAL(0, first.refId_);
+    CPPUNIT_ASSERT_EQUAL(11, first.alignmentStart_);
+    CPPUNIT_ASSERT_EQUAL(30, first.alignmentSpan_);
+    CPPUNIT_ASSERT_EQUAL(3, first.records_);
+    CPPUNIT_ASSERT_EQUAL(100UL, first.containerRecordCounter_);
+    CPPUNIT_ASSERT_EQUAL(100UL, first.sliceRecordCounter_);
+    CPPUNIT_ASSERT_EQUAL(ZERO_MD5, first.md5_);
+
+    const Slice second = readSlice(p);
+    CPPUNIT_ASSERT_EQUAL(51, second.alignmentStart_);
+    CPPUNIT_ASSERT_EQUAL(20, second.alignmentSpan_);
+    CPPUNIT_ASSERT_EQUAL(2, second.records_);
+    CPPUNIT_ASSERT_EQUAL(103UL, second.containerRecordCounter_);
+    CPPUNIT_ASSERT_EQUAL(103UL, second.sliceRecordCounter_);
+    CPPUNIT_ASSERT_EQUAL(ZERO_MD5, second.md5_);
+
+    const Slice third = readSlice(p);
+    CPPUNIT_ASSERT_EQUAL(196, third.alignmentStart_);
+    CPPUNIT_ASSERT_EQUAL(1, third.records_);
+    CPPUNIT_ASSERT_EQUAL(105UL, third.containerRecordCounter_);
+    CPPUNIT_ASSERT_EQUAL(105UL, third.sliceRecordCounter_);
+    CPPUNIT_ASSERT_EQUAL(ZERO_MD5, third.md5_);
+
+    CPPUNIT_ASSERT_EQUAL(long(output.size()), long(p - reinterpret_cast<const unsigned char *>(&output.front())));
+}
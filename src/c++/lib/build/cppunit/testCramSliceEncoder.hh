@@ -0,0 +1,30 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#ifndef iSAAC_BUILD_TEST_CRAM_SLICE_ENCODER_HH
+#define iSAAC_BUILD_TEST_CRAM_SLICE_ENCODER_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class TestCramSliceEncoder : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( TestCramSliceEncoder );
+    CPPUNIT_TEST( testSliceHeaders );
+    CPPUNIT_TEST_SUITE_END();
+public:
+    void setUp();
+    void tearDown();
+    void testSliceHeaders();
+};
+
+#endif // #ifndef iSAAC_BUILD_TEST_CRAM_SLICE_ENCODER_HH
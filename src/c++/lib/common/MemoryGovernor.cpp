@@ -0,0 +1,100 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file MemoryGovernor.cpp
+ **
+ ** \brief Single account of the memory allowed to the process by --memory-limit.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include <limits>
+
+#include "common/Debug.hh"
+#include "common/MemoryGovernor.hh"
+#include "common/SystemCompatibility.hh"
+
+namespace isaac
+{
+namespace common
+{
+
+MemoryGovernor::MemoryGovernor(const unsigned long limit) :
+    limit_(limit ? limit : std::numeric_limits<unsigned long>::max()),
+    baseline_(0),
+    reserved_(0),
+    peakReserved_(0)
+{
+}
+
+void MemoryGovernor::measure()
+{
+    const unsigned long processSize = getProcessVirtualSize();
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    ISAAC_ASSERT_MSG(!reserved_, "Process size must not be measured while " << reserved_ << " bytes are reserved");
+    baseline_ = processSize;
+    peakReserved_ = 0;
+    ISAAC_THREAD_CERR << "Memory governor: process uses " << baseline_ << " bytes, " <<
+        getAvailable(lock) << " available" << std::endl;
+}
+
+unsigned long MemoryGovernor::getAvailable(boost::unique_lock<boost::mutex> &lock) const
+{
+    const unsigned long used = baseline_ + reserved_;
+    return used < limit_ ? limit_ - used : 0;
+}
+
+unsigned long MemoryGovernor::getAvailable() const
+{
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    return getAvailable(lock);
+}
+
+unsigned long MemoryGovernor::getCapacity(const unsigned long itemBytes) const
+{
+    ISAAC_ASSERT_MSG(itemBytes, "Item size must be non-zero");
+    return getAvailable() / itemBytes;
+}
+
+bool MemoryGovernor::tryReserve(const unsigned long bytes)
+{
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    if (bytes > getAvailable(lock))
+    {
+        return false;
+    }
+    reserved_ += bytes;
+    peakReserved_ = std::max(peakReserved_, reserved_);
+    return true;
+}
+
+void MemoryGovernor::release(const unsigned long bytes)
+{
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    ISAAC_ASSERT_MSG(bytes <= reserved_, "Releasing " << bytes << " bytes while only " << reserved_ << " are reserved");
+    reserved_ -= bytes;
+}
+
+unsigned long MemoryGovernor::getReserved() const
+{
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    return reserved_;
+}
+
+unsigned long MemoryGovernor::getPeakReserved() const
+{
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    return peakReserved_;
+}
+
+} // namespace common
+} // namespace isaac
@@ -0,0 +1,214 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file Profiling.cpp
+ **
+ ** Lightweight wall and cpu time accounting for the processing stages of the aligner.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include <sys/resource.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+#include "common/Debug.hh"
+#include "common/Profiling.hh"
+
+namespace isaac
+{
+namespace common
+{
+
+namespace
+{
+
+struct StageDescription
+{
+    const char *step_;
+    const char *name_;
+    Profiler::UnitType unitType_;
+};
+
+const StageDescription stageDescriptions[Profiler::STAGES_COUNT] =
+{
+    {"FindMatches", "GenerateSeeds", Profiler::NoUnit},
+    {"FindMatches", "SeparateRepeats", Profiler::NoUnit},
+    {"FindMatches", "MaskSeeds", Profiler::NoUnit},
+    {"FindMatches", "SortSeeds", Profiler::NoUnit},
+    {"FindMatches", "ExactMask", Profiler::NoUnit},
+    {"FindMatches", "NeighborMask", Profiler::NoUnit},
+    {"SelectMatches", "LoadMatches", Profiler::Tile},
+    {"SelectMatches", "LoadClusters", Profiler::Tile},
+    {"SelectMatches", "SortMatches", Profiler::Tile},
+    {"SelectMatches", "SelectTile", Profiler::Tile},
+    {"SelectMatches", "FlushTile", Profiler::Tile},
+    {"Build", "LoadBin", Profiler::Bin},
+    {"Build", "ProcessBin", Profiler::Bin},
+    {"Build", "SerializeBin", Profiler::Bin},
+    {"Build", "SaveBin", Profiler::Bin},
+};
+
+/// slot of the current thread in Profiler::threadSlots_. -1 until the thread records anything
+__thread int threadSlotIndex = -1;
+
+inline unsigned long timevalToNs(const struct timeval &tv)
+{
+    return tv.tv_sec * 1000000000UL + tv.tv_usec * 1000UL;
+}
+
+/**
+ * \brief Finds the "<key> <value>" line in a /proc file and returns the value.
+ *
+ * \return false if the file or the key are not available. Some containers don't expose /proc/self/io
+ */
+bool readProcValue(const char *procFilePath, const char *key, unsigned long &value)
+{
+    std::ifstream is(procFilePath);
+    const std::size_t keyLength = strlen(key);
+    std::string line;
+    while (std::getline(is, line))
+    {
+        if (!line.compare(0, keyLength, key))
+        {
+            value = strtoul(line.c_str() + keyLength, 0, 10);
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+ResourceUsage ResourceUsage::sample()
+{
+    ResourceUsage ret;
+    ret.wallNs_ = getWallClockNs();
+
+    struct rusage usage;
+    if (!getrusage(RUSAGE_SELF, &usage))
+    {
+        ret.userCpuNs_ = timevalToNs(usage.ru_utime);
+        ret.systemCpuNs_ = timevalToNs(usage.ru_stime);
+        // kilobytes on linux
+        ret.peakRssKb_ = usage.ru_maxrss;
+    }
+    // unlike ru_maxrss, VmHWM is affected by resetPeakRss
+    readProcValue("/proc/self/status", "VmHWM:", ret.peakRssKb_);
+    readProcValue("/proc/self/io", "rchar:", ret.bytesRead_);
+    readProcValue("/proc/self/io", "wchar:", ret.bytesWritten_);
+    return ret;
+}
+
+bool ResourceUsage::resetPeakRss()
+{
+    // supported since linux 4.0
+    std::ofstream os("/proc/self/clear_refs");
+    os << "5";
+    // the kernel reports the error when the buffer is flushed
+    os.close();
+    return !os.fail();
+}
+
+void StepResourceMonitor::stop(const bool exceptionStackUnwinding)
+{
+    ISAAC_ASSERT_MSG(!stopped_, "Step " << name_ << " already stopped");
+    stopped_ = true;
+    if (exceptionStackUnwinding)
+    {
+        return;
+    }
+    const ResourceUsage end = ResourceUsage::sample();
+    ResourceUsage usage;
+    usage.wallNs_ = end.wallNs_ - start_.wallNs_;
+    usage.userCpuNs_ = end.userCpuNs_ - start_.userCpuNs_;
+    usage.systemCpuNs_ = end.systemCpuNs_ - start_.systemCpuNs_;
+    usage.peakRssKb_ = end.peakRssKb_;
+    usage.bytesRead_ = end.bytesRead_ - start_.bytesRead_;
+    usage.bytesWritten_ = end.bytesWritten_ - start_.bytesWritten_;
+    Profiler::instance().recordStep(name_, usage);
+}
+
+const std::size_t Profiler::NO_UNIT;
+Profiler Profiler::instance_;
+
+const char *Profiler::getStepName(const Stage stage)
+{
+    return stageDescriptions[stage].step_;
+}
+
+const char *Profiler::getStageName(const Stage stage)
+{
+    return stageDescriptions[stage].name_;
+}
+
+Profiler::UnitType Profiler::getUnitType(const Stage stage)
+{
+    return stageDescriptions[stage].unitType_;
+}
+
+Profiler &Profiler::instance()
+{
+    return instance_;
+}
+
+void Profiler::reserveUnits(const Stage stage, const std::size_t units)
+{
+    units_[stage].clear();
+    units_[stage].resize(units);
+}
+
+Profiler::ThreadSlot &Profiler::getThreadSlot()
+{
+    if (-1 == threadSlotIndex)
+    {
+        // threads beyond THREAD_SLOTS_MAX share slots. The counters are updated atomically, so that is
+        // only a matter of cache line contention.
+        threadSlotIndex = __sync_fetch_and_add(&nextThreadSlot_, 1) % THREAD_SLOTS_MAX;
+    }
+    return threadSlots_[threadSlotIndex];
+}
+
+void Profiler::add(StageCounters &to, const StageCounters &counters)
+{
+    __sync_fetch_and_add(&to.calls_, counters.calls_);
+    __sync_fetch_and_add(&to.wallNs_, counters.wallNs_);
+    __sync_fetch_and_add(&to.cpuNs_, counters.cpuNs_);
+    __sync_fetch_and_add(&to.bytes_, counters.bytes_);
+    __sync_fetch_and_add(&to.items_, counters.items_);
+}
+
+void Profiler::record(const Stage stage, const std::size_t unit, const StageCounters &counters)
+{
+    ISAAC_ASSERT_MSG(STAGES_COUNT > stage, "Invalid profiling stage " << stage);
+    add(getThreadSlot().stages_[stage], counters);
+    if (units_[stage].size() > unit)
+    {
+        // different threads can work on the same unit. For example, all compute threads select matches for a tile.
+        add(units_[stage][unit], counters);
+    }
+}
+
+StageCounters Profiler::getStageTotal(const Stage stage) const
+{
+    StageCounters ret;
+    for (const ThreadSlot *slot = threadSlots_; threadSlots_ + THREAD_SLOTS_MAX != slot; ++slot)
+    {
+        ret += slot->stages_[stage];
+    }
+    return ret;
+}
+
+} // namespace common
+} // namespace isaac
@@ -19,6 +19,7 @@
 #include <stdio.h>
 
 #include <new>
+#include <fstream>
 #include <iostream>
 
 #include <boost/format.hpp>
@@ -135,6 +136,17 @@ boost::filesystem::path getModuleFileName()
     return boost::filesystem::path(szBuffer);
 }
 
+unsigned long getProcessVirtualSize()
+{
+    std::ifstream statm("/proc/self/statm");
+    unsigned long pages = 0;
+    if (!(statm >> pages))
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to read the process size from /proc/self/statm"));
+    }
+    return pages * sysconf(_SC_PAGESIZE);
+}
+
 } // namespace common
 } // namespace isaac
 
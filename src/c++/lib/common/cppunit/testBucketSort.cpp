@@ -0,0 +1,136 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ **
+ ** \file testBucketSort.cpp
+ **
+ ** Unit tests for BucketSort.hpp
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+#include "RegistryName.hh"
+#include "testBucketSort.hh"
+
+#include "common/BucketSort.hpp"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( TestBucketSort, registryName("BucketSort"));
+
+namespace
+{
+
+static const unsigned BUCKETS = 10;
+static const unsigned BUCKET_SIZE = 100;
+
+struct Element
+{
+    Element(const unsigned pos, const unsigned id) : pos_(pos), id_(id){}
+    unsigned pos_;
+    unsigned id_;
+    bool operator <(const Element &that) const
+    {
+        return pos_ < that.pos_ || (pos_ == that.pos_ && id_ < that.id_);
+    }
+};
+
+/// positions past the last bucket go into the last bucket the same way BinSorter treats positions outside the bin
+std::size_t getBucket(const Element &element)
+{
+    return std::min<std::size_t>(element.pos_ / BUCKET_SIZE, BUCKETS - 1);
+}
+
+void checkSort(std::vector<Element> v)
+{
+    std::vector<Element> expected(v);
+    std::sort(expected.begin(), expected.end());
+
+    std::vector<std::size_t> bucketNext;
+    std::vector<std::size_t> bucketEnds;
+    isaac::common::bucketSort(v.begin(), v.end(), BUCKETS, &getBucket, std::less<Element>(), bucketNext, bucketEnds);
+
+    CPPUNIT_ASSERT_EQUAL(expected.size(), v.size());
+    for (std::size_t i = 0; v.size() > i; ++i)
+    {
+        CPPUNIT_ASSERT_EQUAL(expected[i].pos_, v[i].pos_);
+        CPPUNIT_ASSERT_EQUAL(expected[i].id_, v[i].id_);
+    }
+
+    // bucket ends point past the last element of each bucket
+    CPPUNIT_ASSERT_EQUAL(std::size_t(BUCKETS + 1), bucketEnds.size());
+    std::size_t bucketBegin = 0;
+    for (unsigned bucket = 0; BUCKETS != bucket; ++bucket)
+    {
+        CPPUNIT_ASSERT(bucketBegin <= bucketEnds[bucket]);
+        for (std::size_t i = bucketBegin; bucketEnds[bucket] != i; ++i)
+        {
+            CPPUNIT_ASSERT_EQUAL(std::size_t(bucket), getBucket(v[i]));
+        }
+        bucketBegin = bucketEnds[bucket];
+    }
+    CPPUNIT_ASSERT_EQUAL(v.size(), bucketBegin);
+}
+
+} // namespace
+
+void TestBucketSort::setUp()
+{
+}
+
+void TestBucketSort::tearDown()
+{
+}
+
+void TestBucketSort::testSort()
+{
+    std::vector<Element> v;
+    for (unsigned int i = 0; 10001 > i; ++i)
+    {
+        // some positions fall past the last bucket
+        v.push_back(Element(rand() % (BUCKETS * BUCKET_SIZE + BUCKET_SIZE / 2), i));
+    }
+    checkSort(v);
+}
+
+void TestBucketSort::testReverseOrder()
+{
+    std::vector<Element> v;
+    for (unsigned int i = 0; BUCKETS * BUCKET_SIZE > i; ++i)
+    {
+        v.push_back(Element(BUCKETS * BUCKET_SIZE - i - 1, i % 3));
+    }
+    checkSort(v);
+}
+
+void TestBucketSort::testEmptyBuckets()
+{
+    checkSort(std::vector<Element>());
+
+    // everything in one bucket in the middle
+    std::vector<Element> v;
+    for (unsigned int i = 0; 101 > i; ++i)
+    {
+        v.push_back(Element(BUCKET_SIZE * 5 + rand() % BUCKET_SIZE, i));
+    }
+    checkSort(v);
+
+    // only the first and the last bucket
+    v.clear();
+    for (unsigned int i = 0; 101 > i; ++i)
+    {
+        v.push_back(Element(i % 2 ? rand() % BUCKET_SIZE : BUCKETS * BUCKET_SIZE + rand() % BUCKET_SIZE, i));
+    }
+    checkSort(v);
+}
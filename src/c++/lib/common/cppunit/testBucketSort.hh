@@ -0,0 +1,41 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ **
+ ** \file testBucketSort.hh
+ **
+ ** Unit tests for BucketSort.hpp
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifndef iSAAC_COMMON_CPPUNIT_TEST_BUCKET_SORT
+#define iSAAC_COMMON_CPPUNIT_TEST_BUCKET_SORT
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class TestBucketSort : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( TestBucketSort );
+    CPPUNIT_TEST( testSort );
+    CPPUNIT_TEST( testReverseOrder );
+    CPPUNIT_TEST( testEmptyBuckets );
+    CPPUNIT_TEST_SUITE_END();
+public:
+    void setUp();
+    void tearDown();
+    void testSort();
+    void testReverseOrder();
+    void testEmptyBuckets();
+};
+
+#endif // #ifndef iSAAC_COMMON_CPPUNIT_TEST_BUCKET_SORT
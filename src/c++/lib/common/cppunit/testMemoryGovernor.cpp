@@ -0,0 +1,82 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#include <string>
+
+using namespace std;
+
+#include "RegistryName.hh"
+#include "testMemoryGovernor.hh"
+
+#include "common/MemoryGovernor.hh"
+#include "common/SystemCompatibility.hh"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( TestMemoryGovernor, registryName("MemoryGovernor"));
+
+void TestMemoryGovernor::setUp()
+{
+}
+
+void TestMemoryGovernor::tearDown()
+{
+}
+
+void TestMemoryGovernor::testReserveRelease()
+{
+    isaac::common::MemoryGovernor governor(1000);
+    CPPUNIT_ASSERT_EQUAL(1000UL, governor.getAvailable());
+    CPPUNIT_ASSERT_EQUAL(10UL, governor.getCapacity(100));
+
+    CPPUNIT_ASSERT(governor.tryReserve(600));
+    CPPUNIT_ASSERT_EQUAL(400UL, governor.getAvailable());
+    CPPUNIT_ASSERT(!governor.fits(401));
+    CPPUNIT_ASSERT(!governor.tryReserve(401));
+    CPPUNIT_ASSERT_EQUAL(600UL, governor.getReserved());
+
+    CPPUNIT_ASSERT(governor.tryReserve(400));
+    CPPUNIT_ASSERT_EQUAL(0UL, governor.getAvailable());
+    governor.release(1000);
+    CPPUNIT_ASSERT_EQUAL(1000UL, governor.getAvailable());
+    CPPUNIT_ASSERT_EQUAL(1000UL, governor.getPeakReserved());
+}
+
+void TestMemoryGovernor::testReservation()
+{
+    isaac::common::MemoryGovernor governor(1000);
+    {
+        isaac::common::MemoryGovernor::Reservation reservation(governor);
+        CPPUNIT_ASSERT(reservation.tryReserve(300));
+        CPPUNIT_ASSERT(reservation.tryReserve(300));
+        CPPUNIT_ASSERT(!reservation.tryReserve(500));
+        CPPUNIT_ASSERT_EQUAL(600UL, reservation.getBytes());
+        CPPUNIT_ASSERT_EQUAL(400UL, governor.getAvailable());
+    }
+    CPPUNIT_ASSERT_EQUAL(0UL, governor.getReserved());
+}
+
+void TestMemoryGovernor::testMeasure()
+{
+    const unsigned long processSize = isaac::common::getProcessVirtualSize();
+    CPPUNIT_ASSERT(processSize);
+
+    // the process itself takes all the memory
+    isaac::common::MemoryGovernor tightGovernor(processSize / 2);
+    tightGovernor.measure();
+    CPPUNIT_ASSERT_EQUAL(0UL, tightGovernor.getAvailable());
+    CPPUNIT_ASSERT(!tightGovernor.tryReserve(1));
+
+    // 0 means no limit
+    isaac::common::MemoryGovernor unlimitedGovernor(0);
+    unlimitedGovernor.measure();
+    CPPUNIT_ASSERT(unlimitedGovernor.fits(processSize));
+}
@@ -0,0 +1,35 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#ifndef iSAAC_COMMON_TEST_MEMORY_GOVERNOR_HH
+#define iSAAC_COMMON_TEST_MEMORY_GOVERNOR_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class TestMemoryGovernor : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( TestMemoryGovernor );
+    CPPUNIT_TEST( testReserveRelease );
+    CPPUNIT_TEST( testReservation );
+    CPPUNIT_TEST( testMeasure );
+    CPPUNIT_TEST_SUITE_END();
+private:
+public:
+    void setUp();
+    void tearDown();
+    void testReserveRelease();
+    void testReservation();
+    void testMeasure();
+};
+
+#endif // #ifndef iSAAC_COMMON_TEST_MEMORY_GOVERNOR_HH
@@ -17,7 +17,9 @@
  ** \author Roman Petrovski
  **/
 
-#include <boost/lexical_cast.hpp>
+#include <set>
+
+#include <boost/foreach.hpp>
 
 #include "demultiplexing/DemultiplexingStatsXml.hh"
 
@@ -37,17 +39,7 @@ void DemultiplexingStatsXml::addLaneBarcode(
     const unsigned lane,
     const LaneBarcodeStats& laneStats)
 {
-    const boost::property_tree::path tileValuePrefix("Stats"
-                                      "/<indexed>Flowcell/<flowcell-id>" + flowcellId
-                                      +"/<indexed>Project/<name>" + projectName
-                                      +"/<indexed>Sample/<name>" + sampleName
-                                      +"/<indexed>Barcode/<name>" + barcodeName
-                                      +"/<indexed>Lane/<number>" + boost::lexical_cast<std::string>(lane)
-                                      , '/');
-
-    add(tileValuePrefix / "BarcodeCount", laneStats.barcodeCount_);
-    add(tileValuePrefix / "PerfectBarcodeCount", laneStats.perfectBarcodeCount_);
-    add(tileValuePrefix / "OneMismatchBarcodeCount", laneStats.oneMismatchBarcodeCount_);
+    flowcellProjectSampleBarcodeLaneStats_[flowcellId][projectName][sampleName][barcodeName][lane] += laneStats;
 }
 
 
@@ -56,19 +48,112 @@ void DemultiplexingStatsXml::addFlowcellLane(
     const unsigned lane,
     const LaneBarcodeStats& laneStats)
 {
-    const boost::property_tree::path laneValuePrefix("Stats"
-                                      "/<indexed>Flowcell/<flowcell-id>" + flowcell.getFlowcellId()
-                                      +"/<indexed>Lane/<number>" + boost::lexical_cast<std::string>(lane)
-                                      +"/TopUnknownBarcodes", '/');
-
+    UnknownBarcodes &unknownBarcodes = flowcellLaneUnknownBarcodes_[flowcell.getFlowcellId()][lane];
     BOOST_FOREACH(const UnknownBarcodeHits::value_type &unknownBarcode,
                   laneStats.topUnknownBarcodes_)
     {
-        add(laneValuePrefix / ("<indexed>Barcode/<sequence>" + bases(unknownBarcode.first, flowcell.getBarcodeLength())).c_str()
-            / "<xmlattr>" / "count", unknownBarcode.second);
+        unknownBarcodes.push_back(std::make_pair(bases(unknownBarcode.first, flowcell.getBarcodeLength()), unknownBarcode.second));
+    }
+}
+
+void DemultiplexingStatsXml::serializeProjects(
+    xml::XmlWriter &xmlWriter,
+    const ProjectSampleBarcodeLaneStats &projectSampleBarcodeLaneStats) const
+{
+    BOOST_FOREACH(const ProjectSampleBarcodeLaneStats::value_type &projectStats, projectSampleBarcodeLaneStats)
+    {
+        ISAAC_XML_WRITER_ELEMENT_BLOCK(xmlWriter, "Project")
+        {
+            xmlWriter.writeAttribute("name", projectStats.first);
+            BOOST_FOREACH(const SampleBarcodeLaneStats::value_type &sampleStats, projectStats.second)
+            {
+                ISAAC_XML_WRITER_ELEMENT_BLOCK(xmlWriter, "Sample")
+                {
+                    xmlWriter.writeAttribute("name", sampleStats.first);
+                    BOOST_FOREACH(const BarcodeLaneStats::value_type &barcodeStats, sampleStats.second)
+                    {
+                        ISAAC_XML_WRITER_ELEMENT_BLOCK(xmlWriter, "Barcode")
+                        {
+                            xmlWriter.writeAttribute("name", barcodeStats.first);
+                            BOOST_FOREACH(const LaneStats::value_type &laneStats, barcodeStats.second)
+                            {
+                                ISAAC_XML_WRITER_ELEMENT_BLOCK(xmlWriter, "Lane")
+                                {
+                                    xmlWriter.writeAttribute("number", laneStats.first);
+                                    xmlWriter.writeElement("BarcodeCount", laneStats.second.barcodeCount_);
+                                    xmlWriter.writeElement("PerfectBarcodeCount", laneStats.second.perfectBarcodeCount_);
+                                    xmlWriter.writeElement("OneMismatchBarcodeCount", laneStats.second.oneMismatchBarcodeCount_);
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+void DemultiplexingStatsXml::serializeUnknownBarcodes(
+    xml::XmlWriter &xmlWriter,
+    const LaneUnknownBarcodes &laneUnknownBarcodes) const
+{
+    BOOST_FOREACH(const LaneUnknownBarcodes::value_type &laneBarcodes, laneUnknownBarcodes)
+    {
+        ISAAC_XML_WRITER_ELEMENT_BLOCK(xmlWriter, "Lane")
+        {
+            xmlWriter.writeAttribute("number", laneBarcodes.first);
+            ISAAC_XML_WRITER_ELEMENT_BLOCK(xmlWriter, "TopUnknownBarcodes")
+            {
+                typedef std::pair<std::string, unsigned long> SequenceCount;
+                BOOST_FOREACH(const SequenceCount &unknownBarcode, laneBarcodes.second)
+                {
+                    ISAAC_XML_WRITER_ELEMENT_BLOCK(xmlWriter, "Barcode")
+                    {
+                        xmlWriter.writeAttribute("sequence", unknownBarcode.first);
+                        xmlWriter.writeAttribute("count", unknownBarcode.second);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void DemultiplexingStatsXml::serialize(std::ostream &os) const
+{
+    std::set<std::string> flowcellIds;
+    BOOST_FOREACH(const FlowcellProjectSampleBarcodeLaneStats::value_type &flowcellStats, flowcellProjectSampleBarcodeLaneStats_)
+    {
+        flowcellIds.insert(flowcellStats.first);
+    }
+    BOOST_FOREACH(const FlowcellLaneUnknownBarcodes::value_type &flowcellBarcodes, flowcellLaneUnknownBarcodes_)
+    {
+        flowcellIds.insert(flowcellBarcodes.first);
+    }
+
+    xml::XmlWriter xmlWriter(os);
+    ISAAC_XML_WRITER_ELEMENT_BLOCK(xmlWriter, "Stats")
+    {
+        BOOST_FOREACH(const std::string &flowcellId, flowcellIds)
+        {
+            ISAAC_XML_WRITER_ELEMENT_BLOCK(xmlWriter, "Flowcell")
+            {
+                xmlWriter.writeAttribute("flowcell-id", flowcellId);
+                const FlowcellProjectSampleBarcodeLaneStats::const_iterator projects =
+                    flowcellProjectSampleBarcodeLaneStats_.find(flowcellId);
+                if (flowcellProjectSampleBarcodeLaneStats_.end() != projects)
+                {
+                    serializeProjects(xmlWriter, projects->second);
+                }
+                const FlowcellLaneUnknownBarcodes::const_iterator unknownBarcodes =
+                    flowcellLaneUnknownBarcodes_.find(flowcellId);
+                if (flowcellLaneUnknownBarcodes_.end() != unknownBarcodes)
+                {
+                    serializeUnknownBarcodes(xmlWriter, unknownBarcodes->second);
+                }
+            }
+        }
     }
 }
 
 } //namespace demultiplexing
 } //namespace isaac
-
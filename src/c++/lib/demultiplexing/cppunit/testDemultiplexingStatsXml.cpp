@@ -0,0 +1,141 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/foreach.hpp>
+#include <boost/property_tree/xml_parser.hpp>
+
+#include "RegistryName.hh"
+#include "testDemultiplexingStatsXml.hh"
+
+#include "demultiplexing/DemultiplexingStatsXml.hh"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( TestDemultiplexingStatsXml, registryName("DemultiplexingStatsXml"));
+
+using namespace isaac;
+namespace bpt = boost::property_tree;
+
+namespace
+{
+
+static const unsigned BARCODE_LENGTH = 4;
+
+demultiplexing::LaneBarcodeStats makeLaneBarcodeStats(
+    const unsigned long barcodeCount,
+    const unsigned long perfectBarcodeCount,
+    const unsigned long oneMismatchBarcodeCount)
+{
+    demultiplexing::LaneBarcodeStats ret;
+    ret.barcodeCount_ = barcodeCount;
+    ret.perfectBarcodeCount_ = perfectBarcodeCount;
+    ret.oneMismatchBarcodeCount_ = oneMismatchBarcodeCount;
+    return ret;
+}
+
+flowcell::Layout makeFlowcell(const std::string &flowcellId)
+{
+    return flowcell::Layout("", flowcell::Layout::Fastq, false, 8, std::vector<unsigned>(BARCODE_LENGTH),
+                            flowcell::ReadMetadataList(), alignment::SeedMetadataList(), flowcellId);
+}
+
+const bpt::ptree &getChild(
+    const bpt::ptree &parent,
+    const std::string &name,
+    const std::string &attribute,
+    const std::string &value)
+{
+    BOOST_FOREACH(const bpt::ptree::value_type &child, parent)
+    {
+        if (name == child.first && value == child.second.get<std::string>("<xmlattr>." + attribute, ""))
+        {
+            return child.second;
+        }
+    }
+    CPPUNIT_FAIL("Missing " + name + " " + attribute + "=" + value);
+    return parent;
+}
+
+const bpt::ptree &getBarcodeLane(
+    const bpt::ptree &flowcell,
+    const std::string &project,
+    const std::string &sample,
+    const std::string &barcode,
+    const std::string &lane)
+{
+    return getChild(getChild(getChild(getChild(flowcell,
+        "Project", "name", project), "Sample", "name", sample), "Barcode", "name", barcode), "Lane", "number", lane);
+}
+
+} // namespace
+
+void TestDemultiplexingStatsXml::setUp()
+{
+}
+
+void TestDemultiplexingStatsXml::tearDown()
+{
+}
+
+void TestDemultiplexingStatsXml::testTwoFlowcells()
+{
+    demultiplexing::DemultiplexingStatsXml statsXml;
+    // flowcells are added out of order, the same lane barcode is added twice
+    statsXml.addLaneBarcode("FC2", "P2", "S3", "GGGG", 1, makeLaneBarcodeStats(50, 45, 5));
+    statsXml.addLaneBarcode("FC1", "P1", "S1", "AAAA", 1, makeLaneBarcodeStats(100, 90, 10));
+    statsXml.addLaneBarcode("FC1", "P1", "S1", "AAAA", 2, makeLaneBarcodeStats(30, 29, 1));
+    statsXml.addLaneBarcode("FC1", "P1", "S1", "AAAA", 1, makeLaneBarcodeStats(20, 19, 1));
+    statsXml.addLaneBarcode("FC1", "P1", "S2", "CCCC", 1, makeLaneBarcodeStats(10, 10, 0));
+
+    // only the second flowcell has unknown barcodes
+    demultiplexing::LaneBarcodeStats unknownStats;
+    unknownStats.topUnknownBarcodes_.push_back(std::make_pair(demultiplexing::Kmer(0), 7UL));
+    unknownStats.topUnknownBarcodes_.push_back(std::make_pair(demultiplexing::Kmer(03333), 3UL));
+    statsXml.addFlowcellLane(makeFlowcell("FC2"), 1, unknownStats);
+
+    std::ostringstream os;
+    os << statsXml;
+    std::istringstream is(os.str());
+    bpt::ptree stats;
+    bpt::read_xml(is, stats);
+
+    const bpt::ptree &root = stats.get_child("Stats");
+    CPPUNIT_ASSERT_EQUAL(2UL, (unsigned long)root.count("Flowcell"));
+    // flowcells come out sorted
+    CPPUNIT_ASSERT_EQUAL(std::string("FC1"), root.begin()->second.get<std::string>("<xmlattr>.flowcell-id"));
+    CPPUNIT_ASSERT_EQUAL(std::string("FC2"), (++root.begin())->second.get<std::string>("<xmlattr>.flowcell-id"));
+
+    const bpt::ptree &fc1 = getChild(root, "Flowcell", "flowcell-id", "FC1");
+    CPPUNIT_ASSERT_EQUAL(1UL, (unsigned long)fc1.count("Project"));
+    CPPUNIT_ASSERT_EQUAL(0UL, (unsigned long)fc1.count("Lane"));
+    const bpt::ptree &fc1Lane1 = getBarcodeLane(fc1, "P1", "S1", "AAAA", "1");
+    CPPUNIT_ASSERT_EQUAL(120UL, fc1Lane1.get<unsigned long>("BarcodeCount"));
+    CPPUNIT_ASSERT_EQUAL(109UL, fc1Lane1.get<unsigned long>("PerfectBarcodeCount"));
+    CPPUNIT_ASSERT_EQUAL(11UL, fc1Lane1.get<unsigned long>("OneMismatchBarcodeCount"));
+    CPPUNIT_ASSERT_EQUAL(30UL, getBarcodeLane(fc1, "P1", "S1", "AAAA", "2").get<unsigned long>("BarcodeCount"));
+    CPPUNIT_ASSERT_EQUAL(10UL, getBarcodeLane(fc1, "P1", "S2", "CCCC", "1").get<unsigned long>("PerfectBarcodeCount"));
+
+    const bpt::ptree &fc2 = getChild(root, "Flowcell", "flowcell-id", "FC2");
+    CPPUNIT_ASSERT_EQUAL(1UL, (unsigned long)fc2.count("Project"));
+    CPPUNIT_ASSERT_EQUAL(50UL, getBarcodeLane(fc2, "P2", "S3", "GGGG", "1").get<unsigned long>("BarcodeCount"));
+
+    // unknown barcodes keep their order
+    const bpt::ptree &topUnknownBarcodes = getChild(fc2, "Lane", "number", "1").get_child("TopUnknownBarcodes");
+    CPPUNIT_ASSERT_EQUAL(2UL, (unsigned long)topUnknownBarcodes.count("Barcode"));
+    CPPUNIT_ASSERT_EQUAL(std::string("AAAA"), topUnknownBarcodes.begin()->second.get<std::string>("<xmlattr>.sequence"));
+    CPPUNIT_ASSERT_EQUAL(7UL, topUnknownBarcodes.begin()->second.get<unsigned long>("<xmlattr>.count"));
+    CPPUNIT_ASSERT_EQUAL(std::string("TTTT"), (++topUnknownBarcodes.begin())->second.get<std::string>("<xmlattr>.sequence"));
+    CPPUNIT_ASSERT_EQUAL(3UL, (++topUnknownBarcodes.begin())->second.get<unsigned long>("<xmlattr>.count"));
+}
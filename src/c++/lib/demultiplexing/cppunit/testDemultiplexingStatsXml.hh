@@ -0,0 +1,31 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#ifndef iSAAC_DEMULTIPLEXING_TEST_DEMULTIPLEXING_STATS_XML_HH
+#define iSAAC_DEMULTIPLEXING_TEST_DEMULTIPLEXING_STATS_XML_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class TestDemultiplexingStatsXml : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( TestDemultiplexingStatsXml );
+    CPPUNIT_TEST( testTwoFlowcells );
+    CPPUNIT_TEST_SUITE_END();
+private:
+public:
+    void setUp();
+    void tearDown();
+    void testTwoFlowcells();
+};
+
+#endif // #ifndef iSAAC_DEMULTIPLEXING_TEST_DEMULTIPLEXING_STATS_XML_HH
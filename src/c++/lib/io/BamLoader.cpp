@@ -37,7 +37,7 @@ BamLoader::BamLoader(
     const unsigned coresMax) :
     bgzfReader_(threads, coresMax),
     lastUnparsedBytes_(0),
-    decompressParseParallelizationThreads_(2),
+    decompressParseParallelizationThreads_(DECOMPRESSION_BUFFERS),
     nextDecompressorThread_(0),
     nextParserThread_(0)
 {
@@ -54,8 +54,8 @@ void BamLoader::reserveBuffers(std::size_t maxPathLength)
     // that will result in the same buffer size through the run.
     const std::size_t bufferSize = UNPARSED_BYTES_MAX + UNCOMPRESSED_BGZF_BLOCK_SIZE * BGZF_BLOCKS_PER_CLUSTER_BLOCK;
     lastPassBam_.reserve(bufferSize);
-    decompressionBuffers_[0].reserve(bufferSize);
-    decompressionBuffers_[1].reserve(bufferSize);
+    std::for_each(decompressionBuffers_.begin(), decompressionBuffers_.end(),
+                  boost::bind(&std::vector<char>::reserve, _1, bufferSize));
 }
 
 
@@ -0,0 +1,166 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#include <fstream>
+#include <string>
+
+#include "RegistryName.hh"
+#include "testMappedFile.hh"
+
+#include "io/MappedFile.hh"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( TestMappedFile, registryName("MappedFile"));
+
+using namespace isaac;
+
+namespace
+{
+
+void writeFile(const boost::filesystem::path &path, const std::string &content)
+{
+    std::ofstream os(path.c_str(), std::ios_base::binary);
+    os << content;
+    CPPUNIT_ASSERT(os);
+}
+
+std::string mappedContent(const io::MappedFile &mapping)
+{
+    return std::string(mapping.data(), mapping.end());
+}
+
+} // namespace
+
+void TestMappedFile::setUp()
+{
+    tempDirectory_ = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("testMappedFile-%%%%%%%%");
+    boost::filesystem::create_directories(tempDirectory_);
+}
+
+void TestMappedFile::tearDown()
+{
+    boost::filesystem::remove_all(tempDirectory_);
+}
+
+void TestMappedFile::testMap()
+{
+    const boost::filesystem::path filePath = tempDirectory_ / "file";
+    const std::string content("\x03\x00\x00\x00" "ACG", 7);
+    writeFile(filePath, content);
+
+    io::MappedFile mapping;
+    CPPUNIT_ASSERT(!mapping.isMapped());
+    const char *data = mapping.map(filePath, io::FileBufWithReopen::SequentialOnce);
+    CPPUNIT_ASSERT(mapping.isMapped());
+    CPPUNIT_ASSERT_EQUAL(mapping.data(), data);
+    CPPUNIT_ASSERT_EQUAL(content.size(), mapping.size());
+    CPPUNIT_ASSERT_EQUAL(content, mappedContent(mapping));
+
+    // dontneed from SequentialOnce drops the pages on unmap. The data must stay intact on disk.
+    mapping.unmap();
+    CPPUNIT_ASSERT(!mapping.isMapped());
+    CPPUNIT_ASSERT_EQUAL(static_cast<const char *>(0), mapping.data());
+    CPPUNIT_ASSERT_EQUAL(std::size_t(0), mapping.size());
+
+    mapping.map(filePath, io::FileBufWithReopen::random);
+    CPPUNIT_ASSERT_EQUAL(content, mappedContent(mapping));
+}
+
+void TestMappedFile::testRemap()
+{
+    const boost::filesystem::path firstPath = tempDirectory_ / "first";
+    const boost::filesystem::path secondPath = tempDirectory_ / "second";
+    writeFile(firstPath, "first file");
+    writeFile(secondPath, "second, longer file");
+
+    io::MappedFile mapping;
+    mapping.map(firstPath, io::FileBufWithReopen::normal);
+    CPPUNIT_ASSERT_EQUAL(std::string("first file"), mappedContent(mapping));
+
+    // mapping another file releases the previous one
+    mapping.map(secondPath, io::FileBufWithReopen::SequentialOften);
+    CPPUNIT_ASSERT_EQUAL(std::string("second, longer file"), mappedContent(mapping));
+
+    mapping.map(firstPath, io::FileBufWithReopen::normal);
+    CPPUNIT_ASSERT_EQUAL(std::string("first file"), mappedContent(mapping));
+}
+
+void TestMappedFile::testEmptyFile()
+{
+    const boost::filesystem::path filePath = tempDirectory_ / "empty";
+    writeFile(filePath, "");
+
+    io::MappedFile mapping;
+    CPPUNIT_ASSERT_EQUAL(static_cast<const char *>(0), mapping.map(filePath, io::FileBufWithReopen::SequentialOnce));
+    // the file is open even though there is nothing to map
+    CPPUNIT_ASSERT(mapping.isMapped());
+    CPPUNIT_ASSERT_EQUAL(std::size_t(0), mapping.size());
+    CPPUNIT_ASSERT_EQUAL(mapping.data(), mapping.end());
+    mapping.unmap();
+    CPPUNIT_ASSERT(!mapping.isMapped());
+}
+
+void TestMappedFile::testMissingFile()
+{
+    const boost::filesystem::path filePath = tempDirectory_ / "file";
+    writeFile(filePath, "data");
+
+    io::MappedFile mapping;
+    mapping.map(filePath, io::FileBufWithReopen::normal);
+    CPPUNIT_ASSERT_THROW(mapping.map(tempDirectory_ / "missing", io::FileBufWithReopen::normal), common::IoException);
+    // the previous mapping is released before the failed attempt
+    CPPUNIT_ASSERT(!mapping.isMapped());
+    CPPUNIT_ASSERT_EQUAL(std::size_t(0), mapping.size());
+}
+
+void TestMappedFile::testCopy()
+{
+    const boost::filesystem::path filePath = tempDirectory_ / "file";
+    writeFile(filePath, "data");
+
+    io::MappedFile mapping;
+    mapping.map(filePath, io::FileBufWithReopen::normal);
+
+    // copies are for reservation only and never share the mapping
+    const io::MappedFile copy(mapping);
+    CPPUNIT_ASSERT(!copy.isMapped());
+    CPPUNIT_ASSERT_EQUAL(std::size_t(0), copy.size());
+
+    io::MappedFile assigned;
+    assigned.map(filePath, io::FileBufWithReopen::normal);
+    assigned = mapping;
+    CPPUNIT_ASSERT(!assigned.isMapped());
+    CPPUNIT_ASSERT_EQUAL(std::string("data"), mappedContent(mapping));
+}
+
+void TestMappedFile::testAdviseFile()
+{
+    const boost::filesystem::path filePath = tempDirectory_ / "file";
+    writeFile(filePath, "data");
+
+    const int fd = open(filePath.c_str(), O_RDONLY);
+    CPPUNIT_ASSERT(-1 != fd);
+    errno = 0;
+    CPPUNIT_ASSERT_EQUAL(0, io::adviseFile(fd, 0, 0, POSIX_FADV_WILLNEED, "POSIX_FADV_WILLNEED", filePath.c_str()));
+    // the failure is in the return value, errno stays untouched
+    CPPUNIT_ASSERT_EQUAL(EINVAL, io::adviseFile(fd, 0, -1, POSIX_FADV_WILLNEED, "POSIX_FADV_WILLNEED", filePath.c_str()));
+    CPPUNIT_ASSERT_EQUAL(0, errno);
+    close(fd);
+
+    int pipeFds[2];
+    CPPUNIT_ASSERT_EQUAL(0, pipe(pipeFds));
+    CPPUNIT_ASSERT_EQUAL(ESPIPE, io::adviseFile(pipeFds[0], 0, 0, POSIX_FADV_DONTNEED, "POSIX_FADV_DONTNEED", 0));
+    close(pipeFds[0]);
+    close(pipeFds[1]);
+
+    CPPUNIT_ASSERT_EQUAL(EBADF, io::adviseFile(fd, 0, 0, POSIX_FADV_DONTNEED, "POSIX_FADV_DONTNEED", filePath.c_str()));
+}
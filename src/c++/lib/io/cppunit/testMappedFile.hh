@@ -0,0 +1,44 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#ifndef iSAAC_IO_TEST_MAPPED_FILE_HH
+#define iSAAC_IO_TEST_MAPPED_FILE_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <boost/filesystem.hpp>
+
+class TestMappedFile : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( TestMappedFile );
+    CPPUNIT_TEST( testMap );
+    CPPUNIT_TEST( testRemap );
+    CPPUNIT_TEST( testEmptyFile );
+    CPPUNIT_TEST( testMissingFile );
+    CPPUNIT_TEST( testCopy );
+    CPPUNIT_TEST( testAdviseFile );
+    CPPUNIT_TEST_SUITE_END();
+private:
+    boost::filesystem::path tempDirectory_;
+public:
+    void setUp();
+    void tearDown();
+    void testMap();
+    void testRemap();
+    void testEmptyFile();
+    void testMissingFile();
+    void testCopy();
+    void testAdviseFile();
+};
+
+#endif // #ifndef iSAAC_IO_TEST_MAPPED_FILE_HH
@@ -89,7 +89,9 @@ AlignOptions::AlignOptions()
     , cleanupIntermediary(false)
     , ignoreMissingBcls(false)
     , ignoreMissingFilters(false)
+    , memoryMapInput(false)
     , firstPassSeeds(1)
+    , seedIterations(2)
     , jobs(boost::thread::hardware_concurrency())
     , repeatThreshold(10)
     , mateDriftRange(-1)
@@ -127,6 +129,7 @@ AlignOptions::AlignOptions()
     , gapOpenScore(0)
     , gapExtendScore(0)
     , minGapExtendScore(0)
+    , fixedPointScoring(false)
     , semialignedGapLimit(100) //It was supposed to be 20000 or so, but GATK 1.6 and above fails with
                     //##### ERROR MESSAGE: Somehow the requested coordinate is not covered by the read. Too many deletions?
     , dodgyAlignmentScoreString("0")
@@ -144,6 +147,9 @@ AlignOptions::AlignOptions()
     , outputSaversMax(8)
     , realignGapsString("sample")
     , realignGaps(build::REALIGN_SAMPLE)
+    , outputFormatString("bam")
+    , outputFormat(build::OUTPUT_BAM)
+    , coverageTileSize(10000)
     , bamGzipLevel(boost::iostreams::gzip::best_speed)
     , bamPuFormat("%F:%L:%B")
     , expectedBgzfCompressionRatio(1)
@@ -151,9 +157,12 @@ AlignOptions::AlignOptions()
     , keepDuplicates(true)
     , markDuplicates(true)
     , binRegexString("all")
+    , scatterBinLength(0)
+    , tileCheckpoints(false)
     , userTemplateLengthStatistics()
     , statsImageFormatString("gif")
     , statsImageFormat(reports::AlignmentReportGenerator::gif)
+    , statsSummaryOnly(false)
     , bufferBins(true)
 	, qScoreBin(false)
     , bamExcludeTags("ZX,ZY")
@@ -226,10 +235,24 @@ AlignOptions::AlignOptions()
                 "\n  - sample          : realign against gaps found in the same sample"
                 "\n  - project         : realign against gaps found in all samples of the same project"
                 "\n  - all             : realign against gaps found in all samples")
+        ("output-format"            , bpo::value<std::string>(&outputFormatString)->default_value(outputFormatString),
+                "Format of the sorted output files."
+                "\n  - bam             : sorted.bam with .bai index"
+                "\n  - cram            : reference-based sorted.cram with .crai index. The reference used for the "
+                "alignment is required to decode the data")
         ("bam-gzip-level"           , bpo::value<int>(&bamGzipLevel)->default_value(bamGzipLevel),
-                "Gzip level to use for BAM")
+                "Gzip level to use for BAM and CRAM blocks")
         ("bam-header-tag"           , bpo::value<std::vector<std::string> >(&bamHeaderTags)->multitoken(),
                 "Additional bam entries that are copied into the header of each produced bam file. Use '\\t' to represent tab separators.")
+        ("bam-stream"               , bpo::value<std::string>(&bamStreamDestination),
+                "Write the sorted data of the sample into the specified destination instead of the file under "
+                "the Projects folder so that downstream tools can consume it without waiting for the file to complete. "
+                "Use '-' for the standard output or a path to a named pipe. Only allowed when a single sample is "
+                "produced. The index and md5 files are still stored in the sample folder.")
+        ("coverage-tile-size"       , bpo::value<unsigned>(&coverageTileSize)->default_value(coverageTileSize),
+                "Length of the reference tiles for which the mean depth is reported in "
+                "Stats/Coverage/<project>/<sample>.wig. Set to 0 to disable the coverage tiles. Coverage, insert size "
+                "and duplicate histograms are stored in Stats/BuildMetrics.xml regardless.")
         ("bam-pu-format"           , bpo::value<std::string>(&bamPuFormat)->default_value(bamPuFormat),
                 "Template string for bam header RG tag PU field. Oridnary characters are directly copied. The following placeholders are supported:"
                 "\n  - %F             : Flowcell ID"
@@ -278,11 +301,21 @@ AlignOptions::AlignOptions()
         ("first-pass-seeds"         , bpo::value<unsigned>(&firstPassSeeds)->default_value(firstPassSeeds),
                 "the number of seeds to use in the first pass of the match finder. Note that this option "
                 "is ignored when the --seeds=auto")
+        ("seed-iterations"          , bpo::value<unsigned>(&seedIterations)->default_value(seedIterations),
+                "the number of match finder passes over the seeds. The first pass uses --first-pass-seeds seeds of each "
+                "read. Each subsequent pass except the last uses one more seed of each read that has not been resolved "
+                "by the previous passes. The last pass uses all the remaining seeds and performs the neighbor search. "
+                "Each read that has more than --first-pass-seeds seeds gets at least one seed in the last pass. "
+                "Higher values reduce the number of seeds generated and sorted for high-quality data.")
         ("reference-genome,r"       , bpo::value<std::vector<bfs::path> >(&sortedReferenceMetadataList),
                 "Full path to the reference genome XML descriptor. Multiple entries allowed."
                 "Each entry applies to the corresponding --reference-name. The last --reference-genome entry "
                 "may not have a corresponding --reference-name. In this case the default name 'default' is assumed."
             )
+        ("reference-server"         , bpo::value<bfs::path>(&referenceServerSocket),
+                "Unix socket of isaac-reference-server running on this node. If specified, the reference contigs are "
+                "attached from the shared memory published by the server instead of being loaded from the fasta "
+                "files. References the server cannot provide are loaded from the fasta files.")
         ("reference-name,n"       , bpo::value<std::vector<std::string> >(&referenceNameList),
                 "Unique symbolic name of the reference. Multiple entries allowed. Each entry is associated with "
                 "the corresponding --reference-genome and will be matched against the 'reference' column "
@@ -383,6 +416,11 @@ AlignOptions::AlignOptions()
         ("ignore-missing-filters"      , bpo::value<bool>(&ignoreMissingFilters)->default_value(ignoreMissingFilters),
                 "When set, missing filter files are treated as if all clusters pass filter for the "
                 "corresponding tile. Otherwise, encountering a missing filter file causes the analysis to fail.")
+        ("memory-map-input"         , bpo::value<bool>(&memoryMapInput)->default_value(memoryMapInput),
+                "When set, uncompressed bcl, filter, locs and clocs files are memory-mapped and used directly "
+                "from the page cache instead of being copied into private buffers. Recommended when --base-calls "
+                "reside on fast local storage. bcl.bgzf files are mapped and inflated directly from the mapping. "
+                "bcl.gz files are always read and decompressed.")
         ("keep-unaligned"           , bpo::value<std::string>(&keepUnalignedString)->default_value(keepUnalignedString),
                 "Available options:"
                 "\n - discard          : discard clusters where both reads are not aligned"
@@ -414,6 +452,10 @@ AlignOptions::AlignOptions()
                 "\n     go             : gap open score"
                 "\n     ge             : gap extend score"
                 "\n     me             : min extend score (all gaps reaching this score will be treated as equal)")
+        ("fixed-point-scoring"     , bpo::value<bool>(&fixedPointScoring)->default_value(fixedPointScoring),
+                "If set, the alignment log probabilities are accumulated in fixed point and the probabilities of "
+                "the pair candidates are computed once per alignment. Faster, but the log probabilities differ from "
+                "the default computation by up to 0.00001 per base, which can change MAPQ by 1 in borderline cases.")
         ("dodgy-alignment-score"   , bpo::value<std::string>(&dodgyAlignmentScoreString)->default_value(dodgyAlignmentScoreString),
                 "Controls the behavior for templates where alignment score is impossible to assign:"
                 "\n - Unaligned        : marks template fragments as unaligned"
@@ -441,6 +483,22 @@ AlignOptions::AlignOptions()
                 "\nskip-empty             : Include only the contigs that have aligned data."
                 "\nREGEX                 : Is treated as comma-separated list of regular expressions. "
                 "Bam files will be filtered to contain only the bins that match by the name.")
+        ("scatter-bin-length"       , bpo::value<unsigned long>(&scatterBinLength)->default_value(scatterBinLength),
+                "When set, the unsorted alignments are binned by fixed genomic length instead of the distribution of "
+                "the seed matches. Runs that align different --tiles of the same data with the same "
+                "--scatter-bin-length value can be merged into one bam with --gather-temp-directory.")
+        ("gather-temp-directory"    , bpo::value<std::vector<bfs::path> >(&gatherTempDirectoryList),
+                "--temp-directory of a run that has completed MatchSelector. Multiple entries allowed. The bins, "
+                "template length statistics and tiles of all the runs are merged and the processing continues with "
+                "alignment reports and bam generation. The runs must align disjoint --tiles of the same --base-calls "
+                "with the same --scatter-bin-length.")
+        ("gather-output-directory"  , bpo::value<std::vector<bfs::path> >(&gatherOutputDirectoryList),
+                "--output-directory of the corresponding --gather-temp-directory run. The statistics in its Stats "
+                "folder are merged for the alignment reports.")
+        ("tile-checkpoints"         , bpo::value<bool>(&tileCheckpoints)->default_value(tileCheckpoints),
+                "If set, FindMatches and MatchSelector record their progress in --temp-directory after each "
+                "completed tile. A restarted run with the same --temp-directory skips the recorded tiles. "
+                "Use --start-from Last to resume an interrupted MatchSelector.")
         ("memory-control"           , bpo::value<std::string>(&memoryControlString)->default_value(memoryControlString),
                 "Define the behavior in case unexpected memory allocations are detected: "
                 "\n  - warning         : Log WARNING about the allocation."
@@ -461,6 +519,9 @@ AlignOptions::AlignOptions()
                 "\n - gif        : produce .gif type plots"
                 "\n - none       : no stat generation"
         )
+        ("stats-summary-only"       , bpo::value<bool>(&statsSummaryOnly)->default_value(statsSummaryOnly),
+                "If set, only the summary pages are generated in the html report. Per-tile mismatch pages and "
+                "their images are skipped, which saves most of the report generation time on runs with many tiles.")
         ("buffer-bins"   , bpo::value<bool>(&bufferBins)->default_value(bufferBins),
                 "If set, MatchSelector will buffer bin data before writing it out. If not set, MatchSelector will keep an open "
                 "file handle per bin and write data into corresponding bins as it appears. This option requires extra RAM, but "
@@ -611,6 +672,20 @@ build::GapRealignerMode AlignOptions::parseGapRealignment()
     return build::REALIGN_NONE;
 }
 
+build::OutputFormat AlignOptions::parseOutputFormat()
+{
+    if (outputFormatString == "cram")
+    {
+        return build::OUTPUT_CRAM;
+    }
+    else if (outputFormatString != "bam")
+    {
+        const format message = format("\n   *** The 'output-format' value is invalid %s ***\n") % outputFormatString;
+        BOOST_THROW_EXCEPTION(InvalidOptionException(message.str()));
+    }
+    return build::OUTPUT_BAM;
+}
+
 void AlignOptions::parseExecutionTargets()
 {
     const static std::vector<std::string> allowedStageStrings =
@@ -659,6 +734,59 @@ void AlignOptions::parseExecutionTargets()
                          workflow::AlignWorkflow::Last;
 }
 
+void AlignOptions::parseScatterGather()
+{
+    if (gatherTempDirectoryList.size() != gatherOutputDirectoryList.size())
+    {
+        const boost::format message = boost::format(
+            "\n   *** Each --gather-temp-directory must have a corresponding --gather-output-directory (%d vs %d) ***\n") %
+            gatherTempDirectoryList.size() % gatherOutputDirectoryList.size();
+        BOOST_THROW_EXCEPTION(common::InvalidOptionException(message.str()));
+    }
+
+    if (gatherTempDirectoryList.empty())
+    {
+        return;
+    }
+
+    if (workflow::AlignWorkflow::Start != startFrom)
+    {
+        BOOST_THROW_EXCEPTION(common::InvalidOptionException(
+            "\n   *** --gather-temp-directory can't be combined with --start-from ***\n"));
+    }
+    if (workflow::AlignWorkflow::Last != stopAt && workflow::AlignWorkflow::MatchSelectorDone >= stopAt)
+    {
+        BOOST_THROW_EXCEPTION(common::InvalidOptionException(
+            "\n   *** --stop-at must follow MatchSelector when --gather-temp-directory is used ***\n"));
+    }
+    // the gathered state replaces match finding and selection
+    startFrom = workflow::AlignWorkflow::MatchSelectorDone;
+
+    BOOST_FOREACH(bfs::path &directory, gatherTempDirectoryList)
+    {
+        directory = boost::filesystem::absolute(directory);
+        if (!exists(directory / "AlignerState.txt"))
+        {
+            const format message = format("\n   *** The 'gather-temp-directory' does not contain AlignerState.txt: %s ***\n") % directory;
+            BOOST_THROW_EXCEPTION(InvalidOptionException(message.str()));
+        }
+        if (tempDirectory == directory)
+        {
+            const format message = format("\n   *** The 'gather-temp-directory' must differ from --temp-directory: %s ***\n") % directory;
+            BOOST_THROW_EXCEPTION(InvalidOptionException(message.str()));
+        }
+    }
+    BOOST_FOREACH(bfs::path &directory, gatherOutputDirectoryList)
+    {
+        directory = boost::filesystem::absolute(directory);
+        if (!exists(directory))
+        {
+            const format message = format("\n   *** The 'gather-output-directory' does not exist: %s ***\n") % directory;
+            BOOST_THROW_EXCEPTION(InvalidOptionException(message.str()));
+        }
+    }
+}
+
 void AlignOptions::parseMemoryControl()
 {
     const std::vector<std::string> allowedMemoryControlStrings =
@@ -1112,6 +1240,37 @@ void validateSampleSheets(build::GapRealignerMode realignGaps, flowcell::Barcode
     }
 }
 
+/**
+ * \brief Only one output file can go into the --bam-stream destination. Output files are produced per
+ *        project/sample pair that has a mapped reference.
+ */
+void validateBamStream(const std::string &bamStreamDestination, const flowcell::BarcodeMetadataList &barcodes)
+{
+    if (bamStreamDestination.empty())
+    {
+        return;
+    }
+
+    std::vector<std::string> samples;
+    BOOST_FOREACH(const flowcell::BarcodeMetadata &barcode, barcodes)
+    {
+        if (!barcode.isUnmappedReference())
+        {
+            samples.push_back(barcode.getProject() + "/" + barcode.getSampleName());
+        }
+    }
+    std::sort(samples.begin(), samples.end());
+    samples.erase(std::unique(samples.begin(), samples.end()), samples.end());
+
+    if (1 != samples.size())
+    {
+        const boost::format message = boost::format("\n   *** "
+            "--bam-stream requires exactly one sample with mapped reference. The sample sheets produce %d: %s ***\n") %
+            samples.size() % boost::algorithm::join(samples, ", ");
+        BOOST_THROW_EXCEPTION(common::InvalidOptionException(message.str()));
+    }
+}
+
 inline void unescapeSlashT(std::string &str)
 {
     for (std::size_t pos = str.find("\\t"); std::string::npos != pos; pos = str.find("\\t", pos))
@@ -1298,11 +1457,21 @@ void AlignOptions::postProcess(bpo::variables_map &vm)
         BOOST_THROW_EXCEPTION(common::InvalidOptionException(message.str()));
     }
 
+    if (2 > seedIterations)
+    {
+        const boost::format message =
+            boost::format("\n   *** At least two seed iterations are required (--seed-iterations is %d) ***\n") % seedIterations;
+        BOOST_THROW_EXCEPTION(common::InvalidOptionException(message.str()));
+    }
+
     realignGaps = parseGapRealignment();
+    outputFormat = parseOutputFormat();
     std::for_each(bamHeaderTags.begin(), bamHeaderTags.end(), unescapeSlashT);
     validateSampleSheets(realignGaps, barcodeMetadataList);
+    validateBamStream(bamStreamDestination, barcodeMetadataList);
 
     parseExecutionTargets();
+    parseScatterGather();
     parseMemoryControl();
     parseGapScoring();
     parseDodgyAlignmentScore();
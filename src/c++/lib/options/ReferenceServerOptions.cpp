@@ -0,0 +1,106 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file ReferenceServerOptions.cpp
+ **
+ ** Command line options for 'isaac-reference-server'
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include <boost/foreach.hpp>
+#include <boost/format.hpp>
+#include <boost/thread.hpp>
+
+#include "common/Exceptions.hh"
+#include "options/ReferenceServerOptions.hh"
+
+namespace isaac
+{
+namespace options
+{
+
+namespace bpo = boost::program_options;
+namespace bfs = boost::filesystem;
+using common::InvalidOptionException;
+using boost::format;
+
+ReferenceServerOptions::ReferenceServerOptions()
+    : jobs_(boost::thread::hardware_concurrency())
+    , referencesMax_(4)
+    , clientTimeoutSeconds_(10)
+{
+    namedOptions_.add_options()
+        ("socket,s"                 , bpo::value<bfs::path>(&socketPath_),
+                "Path of the Unix socket to listen on. Pass the same path to isaac-align --reference-server."
+            )
+        ("reference-genome,r"       , bpo::value<std::vector<bfs::path> >(&sortedReferenceMetadataList_),
+                "Full path to the reference genome XML descriptor to load at startup. Multiple entries allowed. "
+                "Other references are loaded when the first alignment job asks for them."
+            )
+        ("jobs,j"                   , bpo::value<unsigned>(&jobs_)->default_value(jobs_),
+                "Maximum number of threads used to load the fasta files."
+            )
+        ("references-max"           , bpo::value<unsigned>(&referencesMax_)->default_value(referencesMax_),
+                "Maximum number of references kept in shared memory. Loading another one removes the least "
+                "recently requested reference. Jobs that have attached it keep using it until they finish."
+            )
+        ("client-timeout"           , bpo::value<unsigned>(&clientTimeoutSeconds_)->default_value(clientTimeoutSeconds_),
+                "Seconds a client is given to send its request before it is disconnected."
+            )
+        ;
+}
+
+void ReferenceServerOptions::postProcess(bpo::variables_map &vm)
+{
+    if(vm.count("help") ||  vm.count("version"))
+    {
+        return;
+    }
+
+    if (!vm.count("socket"))
+    {
+        BOOST_THROW_EXCEPTION(InvalidOptionException("\n   *** The 'socket' option is required ***\n"));
+    }
+    socketPath_ = bfs::absolute(socketPath_);
+
+    BOOST_FOREACH(bfs::path &sortedReferenceMetadata, sortedReferenceMetadataList_)
+    {
+        sortedReferenceMetadata = bfs::absolute(sortedReferenceMetadata);
+        if (!bfs::exists(sortedReferenceMetadata))
+        {
+            const format message = format("\n   *** The reference genome XML descriptor does not exist: %s ***\n") %
+                sortedReferenceMetadata.string();
+            BOOST_THROW_EXCEPTION(InvalidOptionException(message.str()));
+        }
+    }
+
+    if (!jobs_)
+    {
+        BOOST_THROW_EXCEPTION(InvalidOptionException("\n   *** The 'jobs' option must be greater than 0 ***\n"));
+    }
+
+    if (sortedReferenceMetadataList_.size() > referencesMax_ || !referencesMax_)
+    {
+        const format message = format("\n   *** The 'references-max' option must be greater than 0 and "
+            "not less than the number of 'reference-genome' entries (%d) ***\n") % sortedReferenceMetadataList_.size();
+        BOOST_THROW_EXCEPTION(InvalidOptionException(message.str()));
+    }
+
+    if (!clientTimeoutSeconds_)
+    {
+        BOOST_THROW_EXCEPTION(InvalidOptionException("\n   *** The 'client-timeout' option must be greater than 0 ***\n"));
+    }
+}
+
+} //namespace options
+} // namespace isaac
@@ -0,0 +1,156 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file SyntheticDataOptions.cpp
+ **
+ ** Command line options for 'generateSyntheticData'
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include <boost/assign.hpp>
+#include <boost/algorithm/string/join.hpp>
+#include <boost/foreach.hpp>
+#include <boost/format.hpp>
+
+#include "common/Exceptions.hh"
+#include "options/SyntheticDataOptions.hh"
+
+namespace isaac
+{
+namespace options
+{
+
+namespace bpo = boost::program_options;
+namespace bfs = boost::filesystem;
+using common::InvalidOptionException;
+
+// tile numbers must fit the 4-digit surface-swath-tile format
+static const unsigned TILES_MAX = 99;
+
+SyntheticDataOptions::SyntheticDataOptions() :
+    randomSeed_(1),
+    contigsCount_(4),
+    contigLength_(2000000),
+    clustersCount_(400000),
+    tilesCount_(4),
+    readLength_(100),
+    fragmentLength_(350),
+    fragmentLengthDeviation_(50),
+    errorRate_(0.005),
+    indelRate_(0.02),
+    duplicateRate_(0.05)
+{
+    outputFormats_.push_back("fasta");
+    outputFormats_.push_back("fastq");
+    outputFormats_.push_back("bam");
+    outputFormats_.push_back("bcl");
+
+    namedOptions_.add_options()
+        ("output-directory,o"       , bpo::value<bfs::path>(&outputDirectory_),
+                "Directory where the generated data is stored. genome.fa, fastq/, bam/ and bcl/ are created in it."
+            )
+        ("random-seed"              , bpo::value<unsigned>(&randomSeed_)->default_value(randomSeed_),
+                "Seed for the random number generator. Same seed and same parameters produce identical data."
+            )
+        ("contigs"                  , bpo::value<unsigned>(&contigsCount_)->default_value(contigsCount_),
+                "Number of contigs in the generated reference."
+            )
+        ("contig-length"            , bpo::value<unsigned>(&contigLength_)->default_value(contigLength_),
+                "Length of each contig in the generated reference."
+            )
+        ("clusters"                 , bpo::value<unsigned>(&clustersCount_)->default_value(clustersCount_),
+                "Total number of paired clusters to generate."
+            )
+        ("tiles"                    , bpo::value<unsigned>(&tilesCount_)->default_value(tilesCount_),
+                "Number of tiles the clusters are spread over in bcl flowcell."
+            )
+        ("read-length"              , bpo::value<unsigned>(&readLength_)->default_value(readLength_),
+                "Length of each of the two reads."
+            )
+        ("fragment-length"          , bpo::value<unsigned>(&fragmentLength_)->default_value(fragmentLength_),
+                "Mean length of the sequenced fragments."
+            )
+        ("fragment-length-deviation", bpo::value<unsigned>(&fragmentLengthDeviation_)->default_value(fragmentLengthDeviation_),
+                "Standard deviation of the sequenced fragment lengths."
+            )
+        ("error-rate"               , bpo::value<double>(&errorRate_)->default_value(errorRate_),
+                "Probability of a sequencing error at each base. Bases with errors get low quality scores."
+            )
+        ("indel-rate"               , bpo::value<double>(&indelRate_)->default_value(indelRate_),
+                "Probability of a read containing a short insertion or deletion."
+            )
+        ("duplicate-rate"           , bpo::value<double>(&duplicateRate_)->default_value(duplicateRate_),
+                "Probability of a cluster being a duplicate of a previously generated fragment."
+            )
+        ("output-format,f"          , bpo::value<std::vector<std::string> >(&outputFormats_)->multitoken()
+            ->default_value(outputFormats_, boost::join(outputFormats_, " ")),
+                "Data to produce. Any combination of:"
+                "\n  fasta : reference genome"
+                "\n  fastq : lane1_read1.fastq and lane1_read2.fastq"
+                "\n  bam   : unaligned paired bam"
+                "\n  bcl   : RunInfo.xml and bcl files of lane 1"
+            )
+        ;
+}
+
+void SyntheticDataOptions::postProcess(bpo::variables_map &vm)
+{
+    if(vm.count("help") ||  vm.count("version"))
+    {
+        return;
+    }
+
+    const std::vector<std::string> requiredOptions = boost::assign::list_of("output-directory");
+    BOOST_FOREACH(const std::string &required, requiredOptions)
+    {
+        if(!vm.count(required))
+        {
+            const boost::format message = boost::format("\n   *** The '%s' option is required ***\n") % required;
+            BOOST_THROW_EXCEPTION(InvalidOptionException(message.str()));
+        }
+    }
+
+    BOOST_FOREACH(const std::string &format, outputFormats_)
+    {
+        if ("fasta" != format && "fastq" != format && "bam" != format && "bcl" != format)
+        {
+            const boost::format message = boost::format("\n   *** Unsupported output-format: %s ***\n") % format;
+            BOOST_THROW_EXCEPTION(InvalidOptionException(message.str()));
+        }
+    }
+
+    if (!readLength_ || fragmentLength_ < readLength_ || contigLength_ < fragmentLength_ + fragmentLengthDeviation_ * 3)
+    {
+        const boost::format message = boost::format("\n   *** read-length must not exceed fragment-length and contig-length must "
+            "accommodate fragment-length plus three deviations: %d %d %d %d ***\n") %
+            readLength_ % fragmentLength_ % fragmentLengthDeviation_ % contigLength_;
+        BOOST_THROW_EXCEPTION(InvalidOptionException(message.str()));
+    }
+
+    if (!tilesCount_ || TILES_MAX < tilesCount_ || !contigsCount_)
+    {
+        const boost::format message = boost::format("\n   *** contigs must be greater than 0 and tiles must be within [1,%d] ***\n") %
+            TILES_MAX;
+        BOOST_THROW_EXCEPTION(InvalidOptionException(message.str()));
+    }
+
+    if (1.0 < errorRate_ || 1.0 < indelRate_ || 1.0 < duplicateRate_ || 0.0 > errorRate_ || 0.0 > indelRate_ || 0.0 > duplicateRate_)
+    {
+        BOOST_THROW_EXCEPTION(InvalidOptionException("\n   *** error-rate, indel-rate and duplicate-rate must be within [0,1] ***\n"));
+    }
+
+    outputDirectory_ = boost::filesystem::absolute(outputDirectory_);
+}
+
+} //namespace options
+} // namespace isaac
@@ -0,0 +1,384 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file CompressedMaskFile.cpp
+ **
+ ** Block-compressed encoding of the sorted reference mask files.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include <cerrno>
+#include <cstring>
+
+#include <boost/format.hpp>
+
+#include "reference/CompressedMaskFile.hh"
+
+namespace isaac
+{
+namespace reference
+{
+
+namespace
+{
+
+const char COMPRESSED_MASK_MAGIC[8] = {'i', 'S', 'A', 'A', 'C', 'C', 'M', 'F'};
+
+template <typename KmerT>
+KmerT getMaskBits(const unsigned maskWidth, const unsigned mask)
+{
+    return maskWidth ? KmerT(mask) << (oligo::KmerTraits<KmerT>::KMER_BITS - maskWidth) : KmerT(0);
+}
+
+template <typename KmerT>
+KmerT getStrippedMask(const unsigned maskWidth)
+{
+    return maskWidth ? (KmerT(1) << (oligo::KmerTraits<KmerT>::KMER_BITS - maskWidth)) - 1 : ~KmerT(0);
+}
+
+} // namespace
+
+const unsigned CompressedMaskIndex::FORMAT_VERSION;
+const unsigned CompressedMaskIndex::POSITION_BITS_MAX;
+
+bool CompressedMaskIndex::isCompressed(const CompressedMaskHeader &header)
+{
+    return !memcmp(header.magic_, COMPRESSED_MASK_MAGIC, sizeof(COMPRESSED_MASK_MAGIC));
+}
+
+bool CompressedMaskIndex::load(const boost::filesystem::path &maskFilePath)
+{
+    std::ifstream is(maskFilePath.c_str(), std::ios_base::binary);
+    if (!is)
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to open mask file " + maskFilePath.string()));
+    }
+    CompressedMaskHeader header;
+    if (!is.read(reinterpret_cast<char *>(&header), sizeof(header)) || !isCompressed(header))
+    {
+        // raw files can be shorter than the header
+        return false;
+    }
+    if (FORMAT_VERSION != header.formatVersion_)
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(EINVAL, (boost::format(
+            "Unsupported compressed mask file version %d, expected %d: %s") %
+            header.formatVersion_ % FORMAT_VERSION % maskFilePath.string()).str()));
+    }
+
+    std::vector<unsigned long> blockOffsets(header.blocks_ + 1);
+    if (!is.seekg(header.blockTableOffset_) ||
+        !is.read(reinterpret_cast<char *>(&blockOffsets.front()), blockOffsets.size() * sizeof(blockOffsets.front())))
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to read block offsets from " + maskFilePath.string()));
+    }
+    header_ = header;
+    blockOffsets_.swap(blockOffsets);
+    return true;
+}
+
+template <typename KmerT>
+const unsigned CompressedMaskWriter<KmerT>::BLOCK_RECORDS;
+template <typename KmerT>
+const unsigned CompressedMaskWriter<KmerT>::RECORD_BYTES_MAX;
+
+template <typename KmerT>
+CompressedMaskWriter<KmerT>::CompressedMaskWriter(
+    const boost::filesystem::path &maskFilePath,
+    const unsigned maskWidth,
+    const unsigned mask,
+    const unsigned positionBits) :
+    maskFilePath_(maskFilePath),
+    os_(maskFilePath.c_str(), std::ios_base::binary),
+    maskBits_(getMaskBits<KmerT>(maskWidth, mask)),
+    strippedMask_(getStrippedMask<KmerT>(maskWidth)),
+    block_(BLOCK_RECORDS * RECORD_BYTES_MAX),
+    blockEnd_(&block_.front()),
+    blockRecords_(0),
+    lastKmer_(0)
+{
+    ISAAC_ASSERT_MSG(CompressedMaskIndex::POSITION_BITS_MAX >= positionBits, "Too many position bits: " << positionBits);
+    if (!os_)
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to create file " + maskFilePath_.string()));
+    }
+
+    memset(&header_, 0, sizeof(header_));
+    memcpy(header_.magic_, COMPRESSED_MASK_MAGIC, sizeof(COMPRESSED_MASK_MAGIC));
+    header_.formatVersion_ = CompressedMaskIndex::FORMAT_VERSION;
+    header_.kmerBits_ = oligo::KmerTraits<KmerT>::KMER_BITS;
+    header_.maskWidth_ = maskWidth;
+    header_.mask_ = mask;
+    header_.positionBits_ = positionBits;
+    header_.blockRecords_ = BLOCK_RECORDS;
+
+    // placeholder. The final header is written by close
+    writeOrThrow(reinterpret_cast<const char *>(&header_), sizeof(header_));
+}
+
+template <typename KmerT>
+unsigned CompressedMaskWriter<KmerT>::getPositionBits(const unsigned long maxPosition)
+{
+    unsigned ret = ReferencePosition::NEIGHBORS_BITS;
+    for (unsigned long position = maxPosition; position; position >>= 1)
+    {
+        ++ret;
+    }
+    return std::min(ret, CompressedMaskIndex::POSITION_BITS_MAX);
+}
+
+template <typename KmerT>
+void CompressedMaskWriter<KmerT>::writeOrThrow(const char *data, const std::size_t bytes)
+{
+    if (!os_.write(data, bytes))
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to write into " + maskFilePath_.string()));
+    }
+}
+
+template <typename KmerT>
+void CompressedMaskWriter<KmerT>::write(const ReferenceKmer<KmerT> &referenceKmer)
+{
+    const KmerT kmer = referenceKmer.getKmer();
+    if (maskBits_ != (kmer & ~strippedMask_))
+    {
+        BOOST_THROW_EXCEPTION(common::PreConditionException(
+            (boost::format("K-mer %s does not belong to the mask %d of %s") %
+                oligo::bases(kmer) % header_.mask_ % maskFilePath_.string()).str()));
+    }
+    const KmerT stripped = kmer & strippedMask_;
+    if (blockRecords_ && lastKmer_ > stripped)
+    {
+        BOOST_THROW_EXCEPTION(common::PreConditionException(
+            "K-mers must be stored in sorted order in " + maskFilePath_.string()));
+    }
+
+    const unsigned long value = referenceKmer.getReferencePosition().getValue();
+    const unsigned long contigValue = value >> CompressedMaskIndex::POSITION_BITS_MAX;
+    const unsigned long lowBits = value & ReferencePosition::POSITION_NEIGBORS_MASK;
+    ISAAC_ASSERT_MSG(!(lowBits >> header_.positionBits_), "Position " << referenceKmer.getReferencePosition() <<
+                     " does not fit in " << header_.positionBits_ << " bits");
+
+    blockEnd_ = compressedMask::encodeVarint(stripped - lastKmer_, blockEnd_);
+    blockEnd_ = compressedMask::encodeVarint((contigValue << header_.positionBits_) | lowBits, blockEnd_);
+    lastKmer_ = stripped;
+    ++header_.records_;
+    if (BLOCK_RECORDS == ++blockRecords_)
+    {
+        flushBlock();
+    }
+}
+
+template <typename KmerT>
+void CompressedMaskWriter<KmerT>::flushBlock()
+{
+    if (blockRecords_)
+    {
+        blockOffsets_.push_back(os_.tellp());
+        writeOrThrow(&block_.front(), blockEnd_ - &block_.front());
+        ++header_.blocks_;
+        blockEnd_ = &block_.front();
+        blockRecords_ = 0;
+        lastKmer_ = 0;
+    }
+}
+
+template <typename KmerT>
+void CompressedMaskWriter<KmerT>::close()
+{
+    flushBlock();
+    header_.blockTableOffset_ = os_.tellp();
+    blockOffsets_.push_back(header_.blockTableOffset_);
+    writeOrThrow(reinterpret_cast<const char *>(&blockOffsets_.front()), blockOffsets_.size() * sizeof(blockOffsets_.front()));
+    if (!os_.seekp(0))
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to seek to the header of " + maskFilePath_.string()));
+    }
+    writeOrThrow(reinterpret_cast<const char *>(&header_), sizeof(header_));
+    os_.close();
+    if (!os_)
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to close " + maskFilePath_.string()));
+    }
+}
+
+template <typename KmerT>
+const std::size_t CompressedMaskStreamBuf<KmerT>::NO_BLOCK;
+
+template <typename KmerT>
+CompressedMaskStreamBuf<KmerT>::CompressedMaskStreamBuf() :
+    source_(0),
+    index_(0),
+    maskBits_(0),
+    positionBits_(0),
+    currentBlock_(NO_BLOCK),
+    sourceBlock_(NO_BLOCK),
+    compressed_(CompressedMaskWriter<KmerT>::BLOCK_RECORDS * CompressedMaskWriter<KmerT>::RECORD_BYTES_MAX),
+    decoded_(CompressedMaskWriter<KmerT>::BLOCK_RECORDS)
+{
+}
+
+template <typename KmerT>
+void CompressedMaskStreamBuf<KmerT>::open(std::streambuf &source, const CompressedMaskIndex &index)
+{
+    ISAAC_ASSERT_MSG(index.isLoaded(), "Compressed mask index must be loaded");
+    ISAAC_ASSERT_MSG(oligo::KmerTraits<KmerT>::KMER_BITS == index.getHeader().kmerBits_,
+                     "Mask file k-mer length mismatch. Expected " << oligo::KmerTraits<KmerT>::KMER_BITS <<
+                     " bits, got " << index.getHeader().kmerBits_);
+    ISAAC_ASSERT_MSG(decoded_.size() >= index.getBlockRecords(),
+                     "Mask file block is too large: " << index.getBlockRecords());
+    source_ = &source;
+    index_ = &index;
+    maskBits_ = getMaskBits<KmerT>(index.getHeader().maskWidth_, index.getHeader().mask_);
+    positionBits_ = index.getHeader().positionBits_;
+    currentBlock_ = NO_BLOCK;
+    sourceBlock_ = NO_BLOCK;
+    setg(decodedBegin(), decodedBegin(), decodedBegin());
+}
+
+template <typename KmerT>
+bool CompressedMaskStreamBuf<KmerT>::loadBlock(const std::size_t block)
+{
+    if (index_->getBlocks() <= block)
+    {
+        return false;
+    }
+    const unsigned long blockOffset = index_->getBlockOffset(block);
+    const std::streamsize blockBytes = index_->getBlockOffset(block + 1) - blockOffset;
+    ISAAC_ASSERT_MSG(compressed_.size() >= std::size_t(blockBytes), "Compressed block is too large: " << blockBytes);
+    if (sourceBlock_ != block &&
+        pos_type(off_type(-1)) == source_->pubseekpos(blockOffset, std::ios_base::in))
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, (boost::format(
+            "Failed to seek to block %d of the mask file") % block).str()));
+    }
+    if (blockBytes != source_->sgetn(&compressed_.front(), blockBytes))
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, (boost::format(
+            "Failed to read %d bytes of block %d of the mask file") % blockBytes % block).str()));
+    }
+    sourceBlock_ = block + 1;
+
+    const std::size_t records = std::min<unsigned long>(
+        index_->getBlockRecords(), index_->getRecords() - block * index_->getBlockRecords());
+    const unsigned long lowBitsMask = (1UL << positionBits_) - 1;
+    const char *in = &compressed_.front();
+    KmerT kmer = 0;
+    for (typename std::vector<ReferenceKmer<KmerT> >::iterator out = decoded_.begin();
+        decoded_.begin() + records != out; ++out)
+    {
+        KmerT delta;
+        in = compressedMask::decodeVarint(in, delta);
+        kmer += delta;
+        unsigned long compact;
+        in = compressedMask::decodeVarint(in, compact);
+        out->first = maskBits_ | kmer;
+        out->second = ((compact >> positionBits_) << CompressedMaskIndex::POSITION_BITS_MAX) | (compact & lowBitsMask);
+    }
+    ISAAC_ASSERT_MSG(&compressed_.front() + blockBytes == in, "Corrupt block " << block << " of the mask file");
+
+    currentBlock_ = block;
+    setg(decodedBegin(), decodedBegin(), decodedBegin() + records * sizeof(ReferenceKmer<KmerT>));
+    return true;
+}
+
+template <typename KmerT>
+typename CompressedMaskStreamBuf<KmerT>::int_type CompressedMaskStreamBuf<KmerT>::underflow()
+{
+    if (gptr() < egptr())
+    {
+        return traits_type::to_int_type(*gptr());
+    }
+    const std::size_t nextBlock = NO_BLOCK == currentBlock_ ? 0 : currentBlock_ + 1;
+    if (!loadBlock(nextBlock))
+    {
+        return traits_type::eof();
+    }
+    return traits_type::to_int_type(*gptr());
+}
+
+template <typename KmerT>
+typename CompressedMaskStreamBuf<KmerT>::pos_type CompressedMaskStreamBuf<KmerT>::seekoff(
+    off_type off, std::ios_base::seekdir way, std::ios_base::openmode which)
+{
+    off_type target = off;
+    if (std::ios_base::cur == way)
+    {
+        target += NO_BLOCK == currentBlock_ ? 0 : getBlockBytesBegin(currentBlock_) + (gptr() - eback());
+    }
+    else if (std::ios_base::end == way)
+    {
+        target += index_->getRecords() * sizeof(ReferenceKmer<KmerT>);
+    }
+    return seekpos(target, which);
+}
+
+template <typename KmerT>
+typename CompressedMaskStreamBuf<KmerT>::pos_type CompressedMaskStreamBuf<KmerT>::seekpos(
+    pos_type pos, std::ios_base::openmode which)
+{
+    const off_type target = pos;
+    if (!(which & std::ios_base::in) || 0 > target ||
+        off_type(index_->getRecords() * sizeof(ReferenceKmer<KmerT>)) < target)
+    {
+        return pos_type(off_type(-1));
+    }
+    const std::size_t block = target / sizeof(ReferenceKmer<KmerT>) / index_->getBlockRecords();
+    if (currentBlock_ != block && !loadBlock(block))
+    {
+        // seeking to the end of the file. Position at the end of the last block so that the next read hits
+        // eof and seekoff reports the correct position.
+        if (index_->getBlocks())
+        {
+            loadBlock(index_->getBlocks() - 1);
+            setg(eback(), egptr(), egptr());
+        }
+        return pos;
+    }
+    setg(eback(), eback() + (target - getBlockBytesBegin(block)), egptr());
+    return pos;
+}
+
+template <typename KmerT>
+MaskFileInputStream<KmerT>::MaskFileInputStream(const boost::filesystem::path &maskFilePath) :
+    std::istream(0)
+{
+    if (!fileBuf_.open(maskFilePath.c_str(), std::ios_base::in | std::ios_base::binary))
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to open mask file " + maskFilePath.string()));
+    }
+    if (index_.load(maskFilePath))
+    {
+        decoder_.open(fileBuf_, index_);
+        rdbuf(&decoder_);
+    }
+    else
+    {
+        rdbuf(&fileBuf_);
+    }
+}
+
+template class CompressedMaskWriter<oligo::ShortKmerType>;
+template class CompressedMaskWriter<oligo::KmerType>;
+template class CompressedMaskWriter<oligo::LongKmerType>;
+
+template class CompressedMaskStreamBuf<oligo::ShortKmerType>;
+template class CompressedMaskStreamBuf<oligo::KmerType>;
+template class CompressedMaskStreamBuf<oligo::LongKmerType>;
+
+template class MaskFileInputStream<oligo::ShortKmerType>;
+template class MaskFileInputStream<oligo::KmerType>;
+template class MaskFileInputStream<oligo::LongKmerType>;
+
+} // namespace reference
+} // namespace isaac
@@ -0,0 +1,116 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file MaskPrefixIndex.cpp
+ **
+ ** Table of record offsets in a sorted mask file.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include <cerrno>
+#include <fstream>
+#include <numeric>
+
+#include "reference/MaskPrefixIndex.hh"
+
+namespace isaac
+{
+namespace reference
+{
+
+namespace
+{
+
+struct IndexHeader
+{
+    unsigned formatVersion_;
+    unsigned kmerBits_;
+    unsigned maskWidth_;
+    unsigned prefixBits_;
+};
+
+static const unsigned INDEX_FORMAT_VERSION = 1;
+
+} // namespace
+
+const unsigned MaskPrefixIndex::PREFIX_BITS;
+
+MaskPrefixIndex::MaskPrefixIndex(const unsigned kmerBits, const unsigned maskWidth)
+{
+    setGeometry(kmerBits, maskWidth);
+    offsets_.resize((1UL << prefixBits_) + 1, 0);
+}
+
+void MaskPrefixIndex::setGeometry(const unsigned kmerBits, const unsigned maskWidth)
+{
+    ISAAC_ASSERT_MSG(maskWidth < kmerBits, "Mask width " << maskWidth << " must be less than k-mer bits " << kmerBits);
+    kmerBits_ = kmerBits;
+    maskWidth_ = maskWidth;
+    prefixBits_ = std::min(PREFIX_BITS, kmerBits - maskWidth);
+    prefixShift_ = kmerBits - maskWidth - prefixBits_;
+}
+
+void MaskPrefixIndex::save(const boost::filesystem::path &indexPath)
+{
+    ISAAC_ASSERT_MSG(isLoaded(), "Index must be constructed for the mask geometry before saving");
+    std::partial_sum(offsets_.begin(), offsets_.end(), offsets_.begin());
+
+    std::ofstream os(indexPath.c_str(), std::ios_base::binary);
+    if (!os)
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to create file " + indexPath.string()));
+    }
+    const IndexHeader header = {INDEX_FORMAT_VERSION, kmerBits_, maskWidth_, prefixBits_};
+    if (!os.write(reinterpret_cast<const char *>(&header), sizeof(header)) ||
+        !os.write(reinterpret_cast<const char *>(&offsets_.front()), offsets_.size() * sizeof(offsets_.front())))
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to write mask prefix index into " + indexPath.string()));
+    }
+}
+
+bool MaskPrefixIndex::load(const boost::filesystem::path &indexPath, const unsigned kmerBits, const unsigned maskWidth)
+{
+    offsets_.clear();
+    if (!boost::filesystem::exists(indexPath))
+    {
+        return false;
+    }
+
+    std::ifstream is(indexPath.c_str(), std::ios_base::binary);
+    IndexHeader header;
+    if (!is.read(reinterpret_cast<char *>(&header), sizeof(header)))
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to read mask prefix index header from " + indexPath.string()));
+    }
+
+    setGeometry(kmerBits, maskWidth);
+    if (INDEX_FORMAT_VERSION != header.formatVersion_ || kmerBits_ != header.kmerBits_ ||
+        maskWidth_ != header.maskWidth_ || prefixBits_ != header.prefixBits_)
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(EINVAL, (boost::format(
+            "Mask prefix index %s format %d, k-mer bits %d, mask width %d, prefix bits %d does not match "
+            "expected format %d, k-mer bits %d, mask width %d, prefix bits %d") % indexPath.string() %
+            header.formatVersion_ % header.kmerBits_ % header.maskWidth_ % header.prefixBits_ %
+            INDEX_FORMAT_VERSION % kmerBits_ % maskWidth_ % prefixBits_).str()));
+    }
+
+    offsets_.resize((1UL << prefixBits_) + 1);
+    if (!is.read(reinterpret_cast<char *>(&offsets_.front()), offsets_.size() * sizeof(offsets_.front())))
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to read mask prefix index from " + indexPath.string()));
+    }
+    return true;
+}
+
+} // namespace reference
+} // namespace isaac
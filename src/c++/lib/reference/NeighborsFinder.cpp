@@ -30,7 +30,10 @@
 
 #include "common/Debug.hh"
 #include "common/ParallelSort.hpp"
+#include "reference/CompressedMaskFile.hh"
+#include "reference/MaskPrefixIndex.hh"
 #include "reference/NeighborsFinder.hh"
+#include "reference/RepeatKmerFilter.hh"
 #include "reference/SortedReferenceXml.hh"
 #include "reference/ReferenceKmer.hh"
 #include "common/Exceptions.hh"
@@ -86,6 +89,24 @@ KmerT reverseComplement(KmerT kmer)
     return reversed;
 }
 
+/**
+ * \brief Copies the file that accompanies a mask file, if it exists. References sorted by older versions
+ *        don't have all of them.
+ */
+static void copyMaskSidecarFile(const bfs::path &oldPath, const bfs::path &newPath)
+{
+    if (exists(oldPath) && oldPath != newPath)
+    {
+        boost::system::error_code errorCode;
+        copy_file(oldPath, newPath, bfs::copy_option::overwrite_if_exists, errorCode);
+        if (errorCode)
+        {
+            const boost::format message = boost::format("Failed to copy %s to %s: %s") % oldPath % newPath % errorCode.message();
+            BOOST_THROW_EXCEPTION(common::IoException(errorCode.value(), message.str()));
+        }
+    }
+}
+
 template <typename KmerT>
 void NeighborsFinder<KmerT>::updateSortedReference(SortedReferenceMetadata::MaskFiles &maskFileList) const
 {
@@ -120,19 +141,13 @@ void NeighborsFinder<KmerT>::updateSortedReference(SortedReferenceMetadata::Mask
         }
 */
         maskFile.path = outputDirectory_ / maskFile.path.filename();
-        std::ifstream maskInput(oldMaskFile.string().c_str());
-        if (!maskInput)
-        {
-            const format message = format("Failed to open mask file %s for reading: %s") % oldMaskFile % strerror(errno);
-            BOOST_THROW_EXCEPTION(IoException(errno, message.str()));
-        }
-        std::ofstream maskOutput(maskFile.path.string().c_str());
-        if (!maskOutput)
-        {
-            const format message = format("Failed to open mask file %s for writing: %s") % maskFile.path % strerror(errno);
-            BOOST_THROW_EXCEPTION(IoException(errno, message.str()));
-        }
-        while(maskInput && maskOutput)
+        MaskFileInputStream<KmerT> maskInput(oldMaskFile);
+        // mask files produced before the compressed format get upgraded
+        CompressedMaskWriter<KmerT> maskOutput(
+            maskFile.path, maskFile.maskWidth, maskFile.mask_,
+            maskInput.isCompressed() ?
+                maskInput.getIndex().getHeader().positionBits_ : unsigned(CompressedMaskIndex::POSITION_BITS_MAX));
+        while(maskInput)
         {
             ReferenceKmer<KmerT> referenceKmer;
             if (maskInput.read(reinterpret_cast<char *>(&referenceKmer), sizeof(referenceKmer)))
@@ -149,11 +164,7 @@ void NeighborsFinder<KmerT>::updateSortedReference(SortedReferenceMetadata::Mask
 
                 referenceKmer.setNeighbors(neighbors && currentNeighbor == referenceKmer.getKmer());
 
-                if (!maskOutput.write(reinterpret_cast<const char *>(&referenceKmer), sizeof(referenceKmer)))
-                {
-                    const format message = format("Failed to write reference k-mer into %s: %s") % maskFile.path % strerror(errno);
-                    BOOST_THROW_EXCEPTION(IoException(errno, message.str()));
-                }
+                maskOutput.write(referenceKmer);
             }
         }
         if (!maskInput.eof() && !neighbors.eof())
@@ -161,6 +172,13 @@ void NeighborsFinder<KmerT>::updateSortedReference(SortedReferenceMetadata::Mask
             const format message = format("Failed to update %s with neighbors information: %s") % maskFile.path % strerror(errno);
             BOOST_THROW_EXCEPTION(IoException(errno, message.str()));
         }
+        maskOutput.close();
+
+        // the record offsets and k-mers don't change, so the prefix index and the repeat k-mers
+        // of the original file remain valid
+        copyMaskSidecarFile(MaskPrefixIndex::getIndexPath(oldMaskFile), MaskPrefixIndex::getIndexPath(maskFile.path));
+        copyMaskSidecarFile(RepeatKmerFilter<KmerT>::getFilterPath(oldMaskFile),
+                            RepeatKmerFilter<KmerT>::getFilterPath(maskFile.path));
         ISAAC_THREAD_CERR << "Adding neighbors information done in " << (clock() - start) / 1000 << " ms for " << maskFile.path << std::endl;
     }
 }
@@ -404,14 +422,7 @@ typename NeighborsFinder<KmerT>::KmerList NeighborsFinder<KmerT>::getKmerList(co
     // load all the kmers found in all the ABCD files
     BOOST_FOREACH(const SortedReferenceMetadata::MaskFile &maskFile, maskFileList)
     {
-        std::ifstream is(maskFile.path.string().c_str());
-        if (!is)
-        {
-            using boost::format;
-            using common::IoException;
-            const format message = format("Failed to open sorted reference file %s: %s") % maskFile.path % strerror(errno);
-            BOOST_THROW_EXCEPTION(IoException(errno, message.str()));
-        }
+        MaskFileInputStream<KmerT> is(maskFile.path);
         ReferenceKmer<KmerT> referenceKmer;
         while (is.read(reinterpret_cast<char*>(&referenceKmer), sizeof(referenceKmer)))
         {
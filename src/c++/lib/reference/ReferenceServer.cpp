@@ -0,0 +1,413 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file ReferenceServer.cpp
+ **
+ ** Local service that keeps the reference contigs loaded in shared memory.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <memory>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <boost/foreach.hpp>
+#include <boost/format.hpp>
+
+#include "common/Debug.hh"
+#include "common/Exceptions.hh"
+#include "reference/ReferenceServer.hh"
+#include "reference/SortedReferenceXml.hh"
+
+namespace isaac
+{
+namespace reference
+{
+
+namespace
+{
+
+const std::string ATTACH_REQUEST("ATTACH ");
+const std::string SEGMENT_RESPONSE("SEGMENT ");
+const std::string ERROR_RESPONSE("ERROR ");
+/// longest request or response line accepted
+const std::size_t LINE_LENGTH_MAX = 4096;
+
+volatile sig_atomic_t terminationRequested = 0;
+
+void requestTermination(int)
+{
+    terminationRequested = 1;
+}
+
+/// sets terminationRequested on SIGINT and SIGTERM for the lifetime of the object
+class TerminationHandler : boost::noncopyable
+{
+    struct sigaction oldIntAction_;
+    struct sigaction oldTermAction_;
+public:
+    TerminationHandler()
+    {
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        // no SA_RESTART so that accept gets interrupted
+        action.sa_handler = &requestTermination;
+        sigaction(SIGINT, &action, &oldIntAction_);
+        sigaction(SIGTERM, &action, &oldTermAction_);
+    }
+    ~TerminationHandler()
+    {
+        sigaction(SIGINT, &oldIntAction_, 0);
+        sigaction(SIGTERM, &oldTermAction_, 0);
+    }
+};
+
+sockaddr_un makeSocketAddress(const boost::filesystem::path &socketPath)
+{
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketPath.string().size() >= sizeof(address.sun_path))
+    {
+        BOOST_THROW_EXCEPTION(common::InvalidParameterException(
+            (boost::format("Socket path is too long: %s") % socketPath.string()).str()));
+    }
+    strcpy(address.sun_path, socketPath.c_str());
+    return address;
+}
+
+/// true if some process accepts connections on the socket
+bool isListening(const boost::filesystem::path &socketPath)
+{
+    const sockaddr_un address = makeSocketAddress(socketPath);
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (-1 == fd)
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to create socket: " + std::string(strerror(errno))));
+    }
+    const bool ret = !connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+    close(fd);
+    return ret;
+}
+
+/// limits the time a blocking read or write on the socket can take
+void setTimeout(const int fd, const unsigned seconds)
+{
+    timeval timeout;
+    timeout.tv_sec = seconds;
+    timeout.tv_usec = 0;
+    if (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) ||
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout)))
+    {
+        ISAAC_THREAD_CERR << "WARNING: Failed to set socket timeout: " << strerror(errno) << std::endl;
+    }
+}
+
+bool readLine(const int fd, std::string &line)
+{
+    line.clear();
+    char c = 0;
+    while (LINE_LENGTH_MAX > line.size())
+    {
+        const ssize_t got = read(fd, &c, 1);
+        if (-1 == got && EINTR == errno)
+        {
+            continue;
+        }
+        if (1 != got)
+        {
+            return false;
+        }
+        if ('\n' == c)
+        {
+            return true;
+        }
+        line.push_back(c);
+    }
+    return false;
+}
+
+bool writeLine(const int fd, const std::string &line)
+{
+    const std::string data = line + "\n";
+    std::size_t written = 0;
+    while (data.size() != written)
+    {
+        const ssize_t put = send(fd, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+        if (-1 == put && EINTR == errno)
+        {
+            continue;
+        }
+        if (0 >= put)
+        {
+            return false;
+        }
+        written += put;
+    }
+    return true;
+}
+
+} // namespace
+
+ReferenceServer::ReferenceServer(
+    const boost::filesystem::path &socketPath,
+    const std::vector<boost::filesystem::path> &preloadXmlPaths,
+    const unsigned loadThreads,
+    const unsigned referencesMax,
+    const unsigned clientTimeoutSeconds) :
+        socketPath_(socketPath),
+        loadThreads_(loadThreads),
+        referencesMax_(referencesMax),
+        clientTimeoutSeconds_(clientTimeoutSeconds),
+        segmentsCreated_(0),
+        requestsServed_(0),
+        listenFd_(-1)
+{
+    ISAAC_ASSERT_MSG(referencesMax_, "At least one reference must be allowed");
+    const sockaddr_un address = makeSocketAddress(socketPath_);
+    if (boost::filesystem::exists(socketPath_))
+    {
+        if (isListening(socketPath_) || boost::filesystem::is_regular_file(socketPath_))
+        {
+            BOOST_THROW_EXCEPTION(common::IoException(EEXIST, "Socket path is in use: " + socketPath_.string()));
+        }
+        // left behind by a server that did not terminate properly
+        boost::filesystem::remove(socketPath_);
+    }
+
+    BOOST_FOREACH(const boost::filesystem::path &xmlPath, preloadXmlPaths)
+    {
+        publish(xmlPath);
+    }
+
+    listenFd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (-1 == listenFd_)
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to create socket: " + std::string(strerror(errno))));
+    }
+    if (-1 == bind(listenFd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) ||
+        -1 == listen(listenFd_, SOMAXCONN))
+    {
+        const int error = errno;
+        close(listenFd_);
+        listenFd_ = -1;
+        BOOST_THROW_EXCEPTION(common::IoException(error, (boost::format("Failed to listen on %s: %s") %
+            socketPath_.string() % strerror(error)).str()));
+    }
+    ISAAC_THREAD_CERR << "Reference server listening on " << socketPath_ << std::endl;
+}
+
+ReferenceServer::~ReferenceServer()
+{
+    if (-1 != listenFd_)
+    {
+        close(listenFd_);
+        unlink(socketPath_.c_str());
+    }
+}
+
+const SharedContigs &ReferenceServer::publish(const boost::filesystem::path &sortedReferenceXml)
+{
+    const boost::filesystem::path xmlPath = boost::filesystem::canonical(sortedReferenceXml);
+    const std::time_t lastWriteTime = boost::filesystem::last_write_time(xmlPath);
+
+    boost::ptr_vector<PublishedReference>::iterator published = publishedReferences_.begin();
+    while (publishedReferences_.end() != published && xmlPath != published->xmlPath_)
+    {
+        ++published;
+    }
+    if (publishedReferences_.end() != published && lastWriteTime == published->lastWriteTime_ &&
+        published->contigs_.matches(published->xmlContigs_))
+    {
+        published->lastRequest_ = requestsServed_;
+        return published->contigs_;
+    }
+
+    const bool reload = publishedReferences_.end() != published;
+    if (!reload && referencesMax_ == publishedReferences_.size())
+    {
+        // make room before loading so that the memory of the evicted one can be reused
+        evictLeastRecentlyRequested();
+    }
+
+    ISAAC_THREAD_CERR << "Loading reference " << xmlPath << std::endl;
+    const SortedReferenceMetadata sortedReferenceMetadata = loadSortedReferenceXml(xmlPath);
+    std::auto_ptr<PublishedReference> reference(new PublishedReference);
+    reference->xmlPath_ = xmlPath;
+    reference->lastWriteTime_ = lastWriteTime;
+    reference->xmlContigs_ = sortedReferenceMetadata.getContigs();
+    reference->lastRequest_ = requestsServed_;
+    reference->contigs_.publish(
+        (boost::format("/isaac-reference-%d-%d") % getpid() % segmentsCreated_++).str(),
+        reference->xmlContigs_, loadThreads_);
+    ISAAC_THREAD_CERR << "Loading reference done for " << xmlPath << " published in " <<
+        reference->contigs_.getSegmentName() << std::endl;
+
+    if (reload)
+    {
+        // clients that have attached to the old segment keep their mapping, the new clients get the new one
+        publishedReferences_.replace(published, reference.release());
+        return published->contigs_;
+    }
+    publishedReferences_.push_back(reference.release());
+    return publishedReferences_.back().contigs_;
+}
+
+void ReferenceServer::evictLeastRecentlyRequested()
+{
+    boost::ptr_vector<PublishedReference>::iterator evicted = publishedReferences_.begin();
+    for (boost::ptr_vector<PublishedReference>::iterator it = publishedReferences_.begin();
+        publishedReferences_.end() != it; ++it)
+    {
+        if (it->lastRequest_ < evicted->lastRequest_)
+        {
+            evicted = it;
+        }
+    }
+    ISAAC_THREAD_CERR << "Removing reference " << evicted->xmlPath_ << " published in " <<
+        evicted->contigs_.getSegmentName() << std::endl;
+    // the jobs still attached keep their mapping
+    publishedReferences_.erase(evicted);
+}
+
+void ReferenceServer::serve(const int clientFd)
+{
+    std::string request;
+    errno = 0;
+    if (!readLine(clientFd, request))
+    {
+        if (EAGAIN == errno || EWOULDBLOCK == errno)
+        {
+            ISAAC_THREAD_CERR << "WARNING: Dropping client that sent no request within " <<
+                clientTimeoutSeconds_ << " seconds" << std::endl;
+        }
+        return;
+    }
+    ++requestsServed_;
+    if (0 != request.compare(0, ATTACH_REQUEST.size(), ATTACH_REQUEST))
+    {
+        writeLine(clientFd, ERROR_RESPONSE + "Unknown request: " + request);
+        return;
+    }
+    const boost::filesystem::path xmlPath = request.substr(ATTACH_REQUEST.size());
+
+    std::string response;
+    try
+    {
+        response = SEGMENT_RESPONSE + publish(xmlPath).getSegmentName();
+    }
+    catch (std::exception &e)
+    {
+        ISAAC_THREAD_CERR << "ERROR: Failed to publish " << xmlPath << ": " << e.what() << std::endl;
+        response = ERROR_RESPONSE + e.what();
+        // messages must fit on one line
+        std::replace(response.begin(), response.end(), '\n', ' ');
+    }
+    writeLine(clientFd, response);
+}
+
+void ReferenceServer::run()
+{
+    TerminationHandler terminationHandler;
+    terminationRequested = 0;
+    while (!terminationRequested)
+    {
+        const int clientFd = accept(listenFd_, 0, 0);
+        if (-1 == clientFd)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            BOOST_THROW_EXCEPTION(common::IoException(errno, (boost::format("Failed to accept connection on %s: %s") %
+                socketPath_.string() % strerror(errno)).str()));
+        }
+        setTimeout(clientFd, clientTimeoutSeconds_);
+        serve(clientFd);
+        close(clientFd);
+    }
+    ISAAC_THREAD_CERR << "Reference server terminating" << std::endl;
+}
+
+std::string ReferenceServer::requestSegment(
+    const boost::filesystem::path &socketPath,
+    const boost::filesystem::path &sortedReferenceXml)
+{
+    const sockaddr_un address = makeSocketAddress(socketPath);
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (-1 == fd)
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to create socket: " + std::string(strerror(errno))));
+    }
+
+    std::string response;
+    if (-1 == connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)))
+    {
+        ISAAC_THREAD_CERR << "WARNING: Reference server is not available at " << socketPath << ": " <<
+            strerror(errno) << std::endl;
+    }
+    else if (!writeLine(fd, ATTACH_REQUEST + boost::filesystem::absolute(sortedReferenceXml).string()) ||
+        !readLine(fd, response))
+    {
+        ISAAC_THREAD_CERR << "WARNING: Reference server at " << socketPath << " did not respond" << std::endl;
+        response.clear();
+    }
+    close(fd);
+
+    if (0 == response.compare(0, SEGMENT_RESPONSE.size(), SEGMENT_RESPONSE))
+    {
+        return response.substr(SEGMENT_RESPONSE.size());
+    }
+    if (!response.empty())
+    {
+        ISAAC_THREAD_CERR << "WARNING: Reference server could not provide " << sortedReferenceXml << ": " <<
+            response << std::endl;
+    }
+    return std::string();
+}
+
+void attachSharedContigs(
+    const boost::filesystem::path &serverSocket,
+    const ReferenceMetadataList &referenceMetadataList,
+    const SortedReferenceMetadataList &sortedReferenceMetadataList,
+    SharedContigsList &sharedContigsList)
+{
+    sharedContigsList.clear();
+    BOOST_FOREACH(const ReferenceMetadata &referenceMetadata, referenceMetadataList)
+    {
+        const unsigned referenceIndex = &referenceMetadata - &referenceMetadataList.front();
+        sharedContigsList.push_back(new SharedContigs);
+        const std::string segmentName = ReferenceServer::requestSegment(serverSocket, referenceMetadata.getXmlPath());
+        if (segmentName.empty() || !sharedContigsList.back().attach(segmentName))
+        {
+            continue;
+        }
+        if (!sharedContigsList.back().matches(sortedReferenceMetadataList.at(referenceIndex).getContigs()))
+        {
+            ISAAC_THREAD_CERR << "WARNING: Shared memory segment " << segmentName << " does not match " <<
+                referenceMetadata.getXmlPath() << std::endl;
+            sharedContigsList.replace(referenceIndex, new SharedContigs);
+            continue;
+        }
+        ISAAC_THREAD_CERR << "Attached " << referenceMetadata << " to shared memory segment " << segmentName << std::endl;
+    }
+}
+
+} // namespace reference
+} // namespace isaac
@@ -28,7 +28,10 @@
 #include "io/FastaReader.hh"
 #include "oligo/Nucleotides.hh"
 #include "oligo/Mask.hh"
+#include "reference/CompressedMaskFile.hh"
+#include "reference/MaskPrefixIndex.hh"
 #include "reference/ReferencePosition.hh"
+#include "reference/RepeatKmerFilter.hh"
 #include "reference/ReferenceSorter.hh"
 #include "reference/SortedReferenceXml.hh"
 
@@ -184,12 +187,10 @@ void ReferenceSorter<KmerT>::saveReference(
     std::cerr << "Saving " << reference_.size() << " " << oligo::KmerTraits<KmerT>::KMER_BASES << "-mers" << std::endl;
     const clock_t start = clock();
 
-    std::ofstream os(outputFile_.c_str());
-    if (!os)
-    {
-        BOOST_THROW_EXCEPTION(common::IoException(errno,"Failed to create file " + outputFile_.string()));
-    }
-
+    CompressedMaskWriter<KmerT> writer(
+        outputFile_, maskWidth_, mask_, CompressedMaskWriter<KmerT>::getPositionBits(genomeLength));
+    MaskPrefixIndex prefixIndex(oligo::KmerTraits<KmerT>::KMER_BITS, maskWidth_);
+    RepeatKmerFilter<KmerT> repeatFilter;
     typename std::vector<ReferenceKmer<KmerT> >::iterator current(reference_.begin());
     std::size_t neighborKmers = 0;
     std::size_t storedKmers = 0;
@@ -214,10 +215,9 @@ void ReferenceSorter<KmerT>::saveReference(
                 static const ReferencePosition tooManyMatchPosition(ReferencePosition::TooManyMatch);
                 const ReferenceKmer<KmerT> tooManyMatchKmer(sameKmerRange.first->getKmer(), tooManyMatchPosition);
                 //std::cerr << std::hex << referenceKmer.first << '\t' << referenceKmer.second << '\n';
-                if (!os.write(reinterpret_cast<const char*>(&tooManyMatchKmer), sizeof(tooManyMatchKmer)))
-                {
-                    BOOST_THROW_EXCEPTION(common::IoException(errno,"Failed to write toomanymatch reference kmer into " + outputFile_.string()));
-                }
+                writer.write(tooManyMatchKmer);
+                prefixIndex.add(tooManyMatchKmer.getKmer());
+                repeatFilter.add(tooManyMatchKmer.getKmer());
                 ++storedKmers;
             }
             else
@@ -237,10 +237,8 @@ void ReferenceSorter<KmerT>::saveReference(
                         {
                             referenceKmer.setNeighbors();
                         }
-                        if (!os.write(reinterpret_cast<const char*>(&referenceKmer), sizeof(referenceKmer)))
-                        {
-                            BOOST_THROW_EXCEPTION(common::IoException(errno,"Failed to write reference kmer into " + outputFile_.string()));
-                        }
+                        writer.write(referenceKmer);
+                        prefixIndex.add(referenceKmer.getKmer());
                         ++storedKmers;
                     }
                 }
@@ -250,8 +248,9 @@ void ReferenceSorter<KmerT>::saveReference(
 
         current = sameKmerRange.second;
     }
-    os.flush();
-    os.close();
+    writer.close();
+    prefixIndex.save(MaskPrefixIndex::getIndexPath(outputFile_));
+    repeatFilter.save(RepeatKmerFilter<KmerT>::getFilterPath(outputFile_));
     std::cerr << "Saving " << storedKmers << " " << oligo::KmerTraits<KmerT>::KMER_BASES << "-mers with " <<
         neighborKmers << " neighbors done in " << (clock() - start) / 1000 << "ms" << std::endl;
 
@@ -0,0 +1,134 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file RepeatKmerFilter.cpp
+ **
+ ** Set of the k-mers that have TooManyMatch entries in the mask files.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include <cerrno>
+#include <fstream>
+
+#include <boost/foreach.hpp>
+#include <boost/format.hpp>
+
+#include "common/Debug.hh"
+#include "common/Exceptions.hh"
+#include "reference/RepeatKmerFilter.hh"
+
+namespace isaac
+{
+namespace reference
+{
+
+namespace
+{
+
+struct FilterHeader
+{
+    unsigned formatVersion_;
+    unsigned kmerBits_;
+    unsigned long kmers_;
+};
+
+static const unsigned FILTER_FORMAT_VERSION = 1;
+
+} // namespace
+
+template <typename KmerT>
+const unsigned RepeatKmerFilter<KmerT>::BLOOM_BITS_PER_KMER;
+
+template <typename KmerT>
+void RepeatKmerFilter<KmerT>::save(const boost::filesystem::path &filterPath) const
+{
+    std::ofstream os(filterPath.c_str(), std::ios_base::binary);
+    if (!os)
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to create file " + filterPath.string()));
+    }
+    const FilterHeader header = {FILTER_FORMAT_VERSION, oligo::KmerTraits<KmerT>::KMER_BITS, kmers_.size()};
+    if (!os.write(reinterpret_cast<const char *>(&header), sizeof(header)) ||
+        (!kmers_.empty() &&
+            !os.write(reinterpret_cast<const char *>(&kmers_.front()), kmers_.size() * sizeof(kmers_.front()))))
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to write repeat k-mers into " + filterPath.string()));
+    }
+}
+
+template <typename KmerT>
+bool RepeatKmerFilter<KmerT>::load(const boost::filesystem::path &filterPath)
+{
+    if (!boost::filesystem::exists(filterPath))
+    {
+        return false;
+    }
+
+    std::ifstream is(filterPath.c_str(), std::ios_base::binary);
+    FilterHeader header;
+    if (!is.read(reinterpret_cast<char *>(&header), sizeof(header)))
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to read repeat k-mers header from " + filterPath.string()));
+    }
+    const unsigned kmerBits = oligo::KmerTraits<KmerT>::KMER_BITS;
+    if (FILTER_FORMAT_VERSION != header.formatVersion_ || kmerBits != header.kmerBits_)
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(EINVAL, (boost::format(
+            "Repeat k-mers file %s format %d, k-mer bits %d does not match expected format %d, k-mer bits %d") %
+            filterPath.string() % header.formatVersion_ % header.kmerBits_ %
+            FILTER_FORMAT_VERSION % kmerBits).str()));
+    }
+
+    const std::size_t before = kmers_.size();
+    kmers_.resize(before + header.kmers_);
+    if (header.kmers_ &&
+        !is.read(reinterpret_cast<char *>(&kmers_[before]), header.kmers_ * sizeof(kmers_.front())))
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to read repeat k-mers from " + filterPath.string()));
+    }
+    return true;
+}
+
+template <typename KmerT>
+void RepeatKmerFilter<KmerT>::buildLookup()
+{
+    std::sort(kmers_.begin(), kmers_.end());
+    kmers_.erase(std::unique(kmers_.begin(), kmers_.end()), kmers_.end());
+
+    std::vector<unsigned long>().swap(bloom_);
+    bloomWordsMask_ = 0;
+    if (kmers_.empty())
+    {
+        return;
+    }
+
+    std::size_t words = 1;
+    while (words * 64 < kmers_.size() * BLOOM_BITS_PER_KMER)
+    {
+        words <<= 1;
+    }
+    bloom_.resize(words, 0);
+    bloomWordsMask_ = words - 1;
+    BOOST_FOREACH(const KmerT kmer, kmers_)
+    {
+        const unsigned long hash = getHash(kmer);
+        bloom_[getWord(hash)] |= getProbe(hash);
+    }
+}
+
+template class RepeatKmerFilter<oligo::ShortKmerType>;
+template class RepeatKmerFilter<oligo::KmerType>;
+template class RepeatKmerFilter<oligo::LongKmerType>;
+
+} // namespace reference
+} // namespace isaac
@@ -0,0 +1,261 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file SharedContigs.cpp
+ **
+ ** Reference contigs kept decoded in a POSIX shared memory segment.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+#include <boost/format.hpp>
+
+#include "common/Debug.hh"
+#include "common/Exceptions.hh"
+#include "reference/ContigLoader.hh"
+#include "reference/SharedContigs.hh"
+
+namespace isaac
+{
+namespace reference
+{
+
+static const char SHARED_CONTIGS_MAGIC[8] = {'i', 's', 'a', 'a', 'c', 'r', 'e', 'f'};
+
+/**
+ * \brief stores modification time and size of the fasta file into record
+ *
+ * \return false if the file cannot be accessed
+ */
+static bool getFastaStamp(const boost::filesystem::path &fastaPath, SharedContigRecord &record)
+{
+    struct stat fastaStat;
+    if (-1 == stat(fastaPath.c_str(), &fastaStat))
+    {
+        return false;
+    }
+    record.fastaLastWriteTime_ = fastaStat.st_mtime;
+    record.fastaSize_ = fastaStat.st_size;
+    return true;
+}
+
+SharedContigs::SharedContigs() : owner_(false), base_(0), bytes_(0)
+{
+}
+
+SharedContigs::~SharedContigs()
+{
+    release();
+}
+
+void SharedContigs::release()
+{
+    if (base_)
+    {
+        ISAAC_ASSERT_MSG(!munmap(base_, bytes_), "munmap failed with errno: " << errno << " " << strerror(errno));
+        base_ = 0;
+        bytes_ = 0;
+    }
+    if (owner_)
+    {
+        if (shm_unlink(segmentName_.c_str()))
+        {
+            ISAAC_THREAD_CERR << "WARNING: Failed to remove shared memory segment " << segmentName_ << ": " <<
+                strerror(errno) << std::endl;
+        }
+        owner_ = false;
+    }
+    segmentName_.clear();
+}
+
+void SharedContigs::publish(
+    const std::string &segmentName,
+    const SortedReferenceMetadata::Contigs &xmlContigs,
+    common::ThreadVector &loadThreads)
+{
+    release();
+
+    std::size_t bytes = sizeof(SharedContigsHeader) + sizeof(SharedContigRecord) * xmlContigs.size();
+    BOOST_FOREACH(const SortedReferenceMetadata::Contig &xmlContig, xmlContigs)
+    {
+        bytes += xmlContig.totalBases_;
+    }
+
+    const int fd = shm_open(segmentName.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if (-1 == fd)
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, (boost::format("Failed to create shared memory segment %s: %s") %
+            segmentName % strerror(errno)).str()));
+    }
+    segmentName_ = segmentName;
+    owner_ = true;
+
+    if (-1 == ftruncate(fd, bytes))
+    {
+        const int error = errno;
+        close(fd);
+        BOOST_THROW_EXCEPTION(common::IoException(error, (boost::format("Failed to allocate %d bytes for shared memory segment %s: %s") %
+            bytes % segmentName % strerror(error)).str()));
+    }
+
+    void *address = mmap(0, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    const int error = errno;
+    close(fd);
+    if (MAP_FAILED == address)
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(error, (boost::format("Failed to map %d bytes of shared memory segment %s: %s") %
+            bytes % segmentName % strerror(error)).str()));
+    }
+    base_ = static_cast<char*>(address);
+    bytes_ = bytes;
+
+    SharedContigRecord *records = reinterpret_cast<SharedContigRecord*>(base_ + sizeof(SharedContigsHeader));
+    unsigned long offset = sizeof(SharedContigsHeader) + sizeof(SharedContigRecord) * xmlContigs.size();
+    BOOST_FOREACH(const SortedReferenceMetadata::Contig &xmlContig, xmlContigs)
+    {
+        ISAAC_ASSERT_MSG(unsigned(&xmlContig - &xmlContigs.front()) == xmlContig.index_,
+                         "Expected sequentially ordered starting with 0");
+        records[xmlContig.index_].offset_ = offset;
+        records[xmlContig.index_].length_ = xmlContig.totalBases_;
+        // stamped before loading so that a modification made while loading is noticed by matches
+        if (!getFastaStamp(xmlContig.filePath_, records[xmlContig.index_]))
+        {
+            BOOST_THROW_EXCEPTION(common::IoException(errno, (boost::format("Failed to stat %s: %s") %
+                xmlContig.filePath_.string() % strerror(errno)).str()));
+        }
+        offset += xmlContig.totalBases_;
+    }
+
+    SortedReferenceMetadata::Contigs::const_iterator nextContigToLoad = xmlContigs.begin();
+    boost::mutex mutex;
+    loadThreads.execute(boost::bind(&SharedContigs::publishParallel, this,
+                                    boost::cref(xmlContigs), boost::ref(nextContigToLoad), boost::ref(mutex)));
+
+    // the header goes last so that the incomplete segment is never accepted by attach
+    SharedContigsHeader &header = *reinterpret_cast<SharedContigsHeader*>(base_);
+    header.formatVersion_ = FORMAT_VERSION;
+    header.contigs_ = xmlContigs.size();
+    header.bytes_ = bytes;
+    __sync_synchronize();
+    std::copy(SHARED_CONTIGS_MAGIC, SHARED_CONTIGS_MAGIC + sizeof(SHARED_CONTIGS_MAGIC), header.magic_);
+}
+
+void SharedContigs::publishParallel(
+    const SortedReferenceMetadata::Contigs &xmlContigs,
+    SortedReferenceMetadata::Contigs::const_iterator &nextContigToLoad,
+    boost::mutex &mutex)
+{
+    std::vector<char> forward;
+    boost::lock_guard<boost::mutex> lock(mutex);
+    while (xmlContigs.end() != nextContigToLoad)
+    {
+        const SortedReferenceMetadata::Contig &xmlContig = *nextContigToLoad++;
+        common::unlock_guard<boost::mutex> unlock(mutex);
+        loadContig(xmlContig, forward);
+        std::copy(forward.begin(), forward.end(), base_ + getRecords()[xmlContig.index_].offset_);
+    }
+}
+
+bool SharedContigs::attach(const std::string &segmentName)
+{
+    release();
+
+    const int fd = shm_open(segmentName.c_str(), O_RDONLY, 0);
+    if (-1 == fd)
+    {
+        ISAAC_THREAD_CERR << "WARNING: Failed to open shared memory segment " << segmentName << ": " <<
+            strerror(errno) << std::endl;
+        return false;
+    }
+
+    struct stat segmentStat;
+    if (-1 == fstat(fd, &segmentStat) || sizeof(SharedContigsHeader) > std::size_t(segmentStat.st_size))
+    {
+        close(fd);
+        ISAAC_THREAD_CERR << "WARNING: Shared memory segment " << segmentName << " is not accessible or too small" << std::endl;
+        return false;
+    }
+
+    void *address = mmap(0, segmentStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    const int error = errno;
+    close(fd);
+    if (MAP_FAILED == address)
+    {
+        ISAAC_THREAD_CERR << "WARNING: Failed to map shared memory segment " << segmentName << ": " <<
+            strerror(error) << std::endl;
+        return false;
+    }
+    base_ = static_cast<char*>(address);
+    bytes_ = segmentStat.st_size;
+    segmentName_ = segmentName;
+
+    const SharedContigsHeader &header = getHeader();
+    if (!std::equal(SHARED_CONTIGS_MAGIC, SHARED_CONTIGS_MAGIC + sizeof(SHARED_CONTIGS_MAGIC), header.magic_) ||
+        FORMAT_VERSION != header.formatVersion_ || bytes_ != header.bytes_ ||
+        sizeof(SharedContigsHeader) + sizeof(SharedContigRecord) * header.contigs_ > bytes_)
+    {
+        ISAAC_THREAD_CERR << "WARNING: Shared memory segment " << segmentName << " is incomplete or has incompatible format" << std::endl;
+        release();
+        return false;
+    }
+    return true;
+}
+
+bool SharedContigs::matches(const SortedReferenceMetadata::Contigs &xmlContigs) const
+{
+    if (!isAttached() || getHeader().contigs_ != xmlContigs.size())
+    {
+        return false;
+    }
+    // contigs of the same fasta file normally follow each other. Stat each file once
+    boost::filesystem::path lastFastaPath;
+    SharedContigRecord current = {0, 0, 0, 0};
+    BOOST_FOREACH(const SortedReferenceMetadata::Contig &xmlContig, xmlContigs)
+    {
+        const SharedContigRecord &record = getRecords()[xmlContig.index_];
+        if (record.length_ != xmlContig.totalBases_ || record.offset_ + record.length_ > bytes_)
+        {
+            return false;
+        }
+        if (lastFastaPath != xmlContig.filePath_)
+        {
+            if (!getFastaStamp(xmlContig.filePath_, current))
+            {
+                return false;
+            }
+            lastFastaPath = xmlContig.filePath_;
+        }
+        if (record.fastaLastWriteTime_ != current.fastaLastWriteTime_ || record.fastaSize_ != current.fastaSize_)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void SharedContigs::copyContig(const unsigned index, std::vector<char> &forward) const
+{
+    ISAAC_ASSERT_MSG(getHeader().contigs_ > index, "Contig index " << index << " is out of range for " << segmentName_);
+    const SharedContigRecord &record = getRecords()[index];
+    forward.assign(base_ + record.offset_, base_ + record.offset_ + record.length_);
+}
+
+} // namespace reference
+} // namespace isaac
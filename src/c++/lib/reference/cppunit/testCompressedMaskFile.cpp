@@ -0,0 +1,165 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <boost/foreach.hpp>
+
+using namespace std;
+
+#include "RegistryName.hh"
+#include "testCompressedMaskFile.hh"
+
+#include "oligo/Kmer.hh"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( TestCompressedMaskFile, registryName("CompressedMaskFile"));
+
+namespace
+{
+
+typedef isaac::oligo::ShortKmerType KmerT;
+typedef isaac::reference::ReferenceKmer<KmerT> ReferenceKmerT;
+typedef isaac::reference::CompressedMaskWriter<KmerT> WriterT;
+
+static const unsigned MASK_WIDTH = 6;
+static const unsigned MASK = 5;
+static const unsigned KMER_BITS = isaac::oligo::KmerTraits<KmerT>::KMER_BITS;
+// enough records for a few blocks and a partial last one
+static const unsigned RECORDS = WriterT::BLOCK_RECORDS * 2 + 100;
+static const unsigned long MAX_POSITION = 100000;
+
+const boost::filesystem::path getTempMaskPath()
+{
+    return boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("testCompressedMaskFile-%%%%%%%%");
+}
+
+void makeRecords(std::vector<ReferenceKmerT> &records)
+{
+    KmerT suffix = 0;
+    for (unsigned i = 0; RECORDS > i; ++i)
+    {
+        // repeated k-mers produce zero deltas
+        suffix += i % 3 ? 0 : i;
+        const isaac::reference::ReferencePosition position =
+            0 == i ? isaac::reference::ReferencePosition(isaac::reference::ReferencePosition::TooManyMatch) :
+                isaac::reference::ReferencePosition(i % 7, (i * 7919UL) % MAX_POSITION, i % 2);
+        records.push_back(ReferenceKmerT((KmerT(MASK) << (KMER_BITS - MASK_WIDTH)) | suffix, position));
+    }
+}
+
+void writeCompressed(const boost::filesystem::path &path, const std::vector<ReferenceKmerT> &records)
+{
+    WriterT writer(path, MASK_WIDTH, MASK, WriterT::getPositionBits(MAX_POSITION));
+    BOOST_FOREACH(const ReferenceKmerT &record, records)
+    {
+        writer.write(record);
+    }
+    writer.close();
+    CPPUNIT_ASSERT_EQUAL(std::size_t(RECORDS), std::size_t(writer.getRecords()));
+}
+
+void checkRecord(const ReferenceKmerT &expected, const ReferenceKmerT &actual)
+{
+    CPPUNIT_ASSERT_EQUAL(expected.getKmer(), actual.getKmer());
+    CPPUNIT_ASSERT_EQUAL(expected.getReferencePosition().getValue(), actual.getReferencePosition().getValue());
+}
+
+} // namespace
+
+void TestCompressedMaskFile::setUp()
+{
+}
+
+void TestCompressedMaskFile::tearDown()
+{
+}
+
+void TestCompressedMaskFile::testRoundTrip()
+{
+    std::vector<ReferenceKmerT> records;
+    makeRecords(records);
+    const boost::filesystem::path maskPath = getTempMaskPath();
+    writeCompressed(maskPath, records);
+    // mask bits are stripped and small deltas take a byte or two
+    CPPUNIT_ASSERT(boost::filesystem::file_size(maskPath) < records.size() * sizeof(ReferenceKmerT) / 2);
+
+    isaac::reference::MaskFileInputStream<KmerT> is(maskPath);
+    CPPUNIT_ASSERT(is.isCompressed());
+    CPPUNIT_ASSERT_EQUAL(3UL, is.getIndex().getBlocks());
+    BOOST_FOREACH(const ReferenceKmerT &record, records)
+    {
+        ReferenceKmerT actual;
+        CPPUNIT_ASSERT(is.read(reinterpret_cast<char *>(&actual), sizeof(actual)));
+        checkRecord(record, actual);
+    }
+    ReferenceKmerT actual;
+    CPPUNIT_ASSERT(!is.read(reinterpret_cast<char *>(&actual), sizeof(actual)));
+    CPPUNIT_ASSERT(is.eof());
+    boost::filesystem::remove(maskPath);
+}
+
+void TestCompressedMaskFile::testSeek()
+{
+    std::vector<ReferenceKmerT> records;
+    makeRecords(records);
+    const boost::filesystem::path maskPath = getTempMaskPath();
+    writeCompressed(maskPath, records);
+
+    isaac::reference::MaskFileInputStream<KmerT> is(maskPath);
+    ReferenceKmerT actual;
+
+    // forward into another block
+    const unsigned seekTo[] = {WriterT::BLOCK_RECORDS + 5, 7, WriterT::BLOCK_RECORDS * 2 + 99, WriterT::BLOCK_RECORDS};
+    BOOST_FOREACH(const unsigned record, seekTo)
+    {
+        CPPUNIT_ASSERT(is.seekg(record * sizeof(ReferenceKmerT)));
+        CPPUNIT_ASSERT_EQUAL(std::streamoff(record * sizeof(ReferenceKmerT)), std::streamoff(is.tellg()));
+        CPPUNIT_ASSERT(is.read(reinterpret_cast<char *>(&actual), sizeof(actual)));
+        checkRecord(records.at(record), actual);
+        CPPUNIT_ASSERT_EQUAL(std::streamoff((record + 1) * sizeof(ReferenceKmerT)), std::streamoff(is.tellg()));
+    }
+
+    // relative seek within the same block
+    CPPUNIT_ASSERT(is.seekg(10 * sizeof(ReferenceKmerT), std::ios_base::cur));
+    CPPUNIT_ASSERT(is.read(reinterpret_cast<char *>(&actual), sizeof(actual)));
+    checkRecord(records.at(WriterT::BLOCK_RECORDS + 11), actual);
+
+    // end of file
+    CPPUNIT_ASSERT(is.seekg(0, std::ios_base::end));
+    CPPUNIT_ASSERT_EQUAL(std::streamoff(RECORDS * sizeof(ReferenceKmerT)), std::streamoff(is.tellg()));
+    CPPUNIT_ASSERT(!is.read(reinterpret_cast<char *>(&actual), sizeof(actual)));
+    boost::filesystem::remove(maskPath);
+}
+
+void TestCompressedMaskFile::testRawFile()
+{
+    std::vector<ReferenceKmerT> records;
+    makeRecords(records);
+    const boost::filesystem::path maskPath = getTempMaskPath();
+    {
+        std::ofstream os(maskPath.c_str(), std::ios_base::binary);
+        os.write(reinterpret_cast<const char *>(&records.front()), records.size() * sizeof(ReferenceKmerT));
+    }
+
+    isaac::reference::CompressedMaskIndex index;
+    CPPUNIT_ASSERT(!index.load(maskPath));
+    isaac::reference::MaskFileInputStream<KmerT> is(maskPath);
+    CPPUNIT_ASSERT(!is.isCompressed());
+    CPPUNIT_ASSERT(is.seekg(WriterT::BLOCK_RECORDS * sizeof(ReferenceKmerT)));
+    ReferenceKmerT actual;
+    CPPUNIT_ASSERT(is.read(reinterpret_cast<char *>(&actual), sizeof(actual)));
+    checkRecord(records.at(WriterT::BLOCK_RECORDS), actual);
+    boost::filesystem::remove(maskPath);
+}
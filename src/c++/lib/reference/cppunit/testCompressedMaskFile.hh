@@ -0,0 +1,36 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#ifndef iSAAC_REFERENCE_TEST_COMPRESSED_MASK_FILE_HH
+#define iSAAC_REFERENCE_TEST_COMPRESSED_MASK_FILE_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "reference/CompressedMaskFile.hh"
+
+class TestCompressedMaskFile : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( TestCompressedMaskFile );
+    CPPUNIT_TEST( testRoundTrip );
+    CPPUNIT_TEST( testSeek );
+    CPPUNIT_TEST( testRawFile );
+    CPPUNIT_TEST_SUITE_END();
+public:
+    void setUp();
+    void tearDown();
+    void testRoundTrip();
+    void testSeek();
+    void testRawFile();
+};
+
+#endif // #ifndef iSAAC_REFERENCE_TEST_COMPRESSED_MASK_FILE_HH
@@ -0,0 +1,135 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#include <sstream>
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <boost/foreach.hpp>
+
+using namespace std;
+
+#include "RegistryName.hh"
+#include "testMaskPrefixIndex.hh"
+
+#include "oligo/Kmer.hh"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( TestMaskPrefixIndex, registryName("MaskPrefixIndex"));
+
+namespace
+{
+
+typedef isaac::oligo::ShortKmerType KmerT;
+typedef isaac::reference::ReferenceKmer<KmerT> ReferenceKmerT;
+
+static const unsigned MASK_WIDTH = 6;
+static const unsigned KMER_BITS = isaac::oligo::KmerTraits<KmerT>::KMER_BITS;
+// bits below the prefix for 16-mers with 6-bit masks
+static const unsigned PREFIX_SHIFT = KMER_BITS - MASK_WIDTH - isaac::reference::MaskPrefixIndex::PREFIX_BITS;
+
+KmerT makeKmer(const unsigned mask, const unsigned prefix, const unsigned suffix)
+{
+    return (KmerT(mask) << (KMER_BITS - MASK_WIDTH)) | (KmerT(prefix) << PREFIX_SHIFT) | KmerT(suffix);
+}
+
+const boost::filesystem::path getTempIndexPath()
+{
+    return boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("testMaskPrefixIndex-%%%%%%%%");
+}
+
+void buildMask(std::vector<ReferenceKmerT> &records, isaac::reference::MaskPrefixIndex &index)
+{
+    records.push_back(ReferenceKmerT(makeKmer(3, 0, 1), isaac::reference::ReferencePosition(0, 10)));
+    records.push_back(ReferenceKmerT(makeKmer(3, 0, 2), isaac::reference::ReferencePosition(0, 11)));
+    records.push_back(ReferenceKmerT(makeKmer(3, 5, 0), isaac::reference::ReferencePosition(0, 12)));
+    records.push_back(ReferenceKmerT(makeKmer(3, 5, 0), isaac::reference::ReferencePosition(0, 13)));
+    records.push_back(ReferenceKmerT(makeKmer(3, 9, 7), isaac::reference::ReferencePosition(0, 14)));
+    records.push_back(ReferenceKmerT(makeKmer(3, 4095, 7), isaac::reference::ReferencePosition(0, 15)));
+    BOOST_FOREACH(const ReferenceKmerT &record, records)
+    {
+        index.add(record.getKmer());
+    }
+}
+
+} // namespace
+
+void TestMaskPrefixIndex::setUp()
+{
+}
+
+void TestMaskPrefixIndex::tearDown()
+{
+}
+
+void TestMaskPrefixIndex::testSaveLoad()
+{
+    std::vector<ReferenceKmerT> records;
+    isaac::reference::MaskPrefixIndex built(KMER_BITS, MASK_WIDTH);
+    buildMask(records, built);
+
+    const boost::filesystem::path indexPath = getTempIndexPath();
+    built.save(indexPath);
+
+    isaac::reference::MaskPrefixIndex loaded;
+    CPPUNIT_ASSERT(!loaded.isLoaded());
+    CPPUNIT_ASSERT(loaded.load(indexPath, KMER_BITS, MASK_WIDTH));
+    boost::filesystem::remove(indexPath);
+    CPPUNIT_ASSERT(loaded.isLoaded());
+
+    CPPUNIT_ASSERT_EQUAL(0UL, loaded.getPrefixBegin(makeKmer(3, 0, 0)));
+    CPPUNIT_ASSERT_EQUAL(2UL, loaded.getPrefixBegin(makeKmer(3, 1, 0)));
+    CPPUNIT_ASSERT_EQUAL(2UL, loaded.getPrefixBegin(makeKmer(3, 5, 100)));
+    CPPUNIT_ASSERT_EQUAL(4UL, loaded.getPrefixBegin(makeKmer(3, 6, 0)));
+    CPPUNIT_ASSERT_EQUAL(4UL, loaded.getPrefixBegin(makeKmer(3, 9, 0)));
+    CPPUNIT_ASSERT_EQUAL(5UL, loaded.getPrefixBegin(makeKmer(3, 10, 0)));
+    CPPUNIT_ASSERT_EQUAL(5UL, loaded.getPrefixBegin(makeKmer(3, 4095, 0)));
+
+    isaac::reference::MaskPrefixIndex missing;
+    CPPUNIT_ASSERT(!missing.load(getTempIndexPath(), KMER_BITS, MASK_WIDTH));
+    CPPUNIT_ASSERT(!missing.isLoaded());
+}
+
+void TestMaskPrefixIndex::testSkipTo()
+{
+    std::vector<ReferenceKmerT> records;
+    isaac::reference::MaskPrefixIndex index(KMER_BITS, MASK_WIDTH);
+    buildMask(records, index);
+    const boost::filesystem::path indexPath = getTempIndexPath();
+    index.save(indexPath);
+    isaac::reference::MaskPrefixIndex loaded;
+    loaded.load(indexPath, KMER_BITS, MASK_WIDTH);
+    boost::filesystem::remove(indexPath);
+
+    std::istringstream reference(std::string(reinterpret_cast<const char *>(&records.front()),
+                                             records.size() * sizeof(ReferenceKmerT)));
+    ReferenceKmerT nextReference;
+    reference.read(reinterpret_cast<char *>(&nextReference), sizeof(nextReference));
+
+    // the adjacent bucket is streamed through rather than seeked to
+    CPPUNIT_ASSERT_EQUAL(0UL, loaded.skipTo(makeKmer(3, 1, 0), reference, nextReference));
+    CPPUNIT_ASSERT_EQUAL(records[0].getKmer(), nextReference.getKmer());
+
+    CPPUNIT_ASSERT_EQUAL(2UL, loaded.skipTo(makeKmer(3, 9, 0), reference, nextReference));
+    CPPUNIT_ASSERT_EQUAL(records[4].getKmer(), nextReference.getKmer());
+    CPPUNIT_ASSERT_EQUAL(14UL, nextReference.getReferencePosition().getPosition());
+
+    // skipping into an empty bucket lands on the first record of the next non-empty one
+    CPPUNIT_ASSERT_EQUAL(0UL, loaded.skipTo(makeKmer(3, 100, 0), reference, nextReference));
+    CPPUNIT_ASSERT_EQUAL(records[5].getKmer(), nextReference.getKmer());
+    CPPUNIT_ASSERT(reference);
+
+    // skipping past the last record exhausts the stream
+    reference.read(reinterpret_cast<char *>(&nextReference), sizeof(nextReference));
+    CPPUNIT_ASSERT(!reference);
+    CPPUNIT_ASSERT_EQUAL(0UL, loaded.skipTo(makeKmer(3, 4095, 0), reference, nextReference));
+}
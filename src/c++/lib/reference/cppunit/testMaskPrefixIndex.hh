@@ -0,0 +1,34 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#ifndef iSAAC_REFERENCE_TEST_MASK_PREFIX_INDEX_HH
+#define iSAAC_REFERENCE_TEST_MASK_PREFIX_INDEX_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "reference/MaskPrefixIndex.hh"
+
+class TestMaskPrefixIndex : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( TestMaskPrefixIndex );
+    CPPUNIT_TEST( testSaveLoad );
+    CPPUNIT_TEST( testSkipTo );
+    CPPUNIT_TEST_SUITE_END();
+public:
+    void setUp();
+    void tearDown();
+    void testSaveLoad();
+    void testSkipTo();
+};
+
+#endif // #ifndef iSAAC_REFERENCE_TEST_MASK_PREFIX_INDEX_HH
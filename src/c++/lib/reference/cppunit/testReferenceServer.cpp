@@ -0,0 +1,179 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file testReferenceServer.cpp
+ **
+ ** Tests for the reference server eviction and client timeout.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include <csignal>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+#include "RegistryName.hh"
+#include "testReferenceServer.hh"
+#include "reference/ReferenceServer.hh"
+#include "reference/SortedReferenceXml.hh"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( TestReferenceServer, registryName("ReferenceServer"));
+
+using isaac::reference::ReferenceServer;
+using isaac::reference::SharedContigs;
+
+namespace
+{
+
+void writeReference(const boost::filesystem::path &xmlPath, const boost::filesystem::path &fastaPath)
+{
+    std::ofstream os(fastaPath.c_str());
+    os << ">chr1\nACGTNNacgt\nAAAA\n>chr2\nGGGG\n";
+    os.close();
+
+    isaac::reference::SortedReferenceMetadata sortedReferenceMetadata;
+    sortedReferenceMetadata.putContig(0, "chr1", fastaPath, 6, 16, 14, 12, 0, 0, "", "", "");
+    sortedReferenceMetadata.putContig(14, "chr2", fastaPath, 28, 5, 4, 4, 1, 1, "", "", "");
+    isaac::reference::saveSortedReferenceXml(xmlPath, sortedReferenceMetadata);
+}
+
+/// connects and returns the socket or -1
+int connectTo(const boost::filesystem::path &socketPath)
+{
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socketPath.c_str());
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (-1 != fd && connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)))
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * \brief runs the server on its own thread for the lifetime of the object
+ */
+class RunningServer
+{
+    ReferenceServer &server_;
+    boost::thread thread_;
+    const boost::filesystem::path socketPath_;
+public:
+    RunningServer(ReferenceServer &server, const boost::filesystem::path &socketPath) :
+        server_(server), thread_(boost::bind(&ReferenceServer::run, &server)), socketPath_(socketPath)
+    {
+    }
+
+    ~RunningServer()
+    {
+        // the signal handler is installed by run. Make sure the server has started serving.
+        close(connectTo(socketPath_));
+        pthread_kill(thread_.native_handle(), SIGTERM);
+        // wake up accept in case the signal arrived before the server got there
+        close(connectTo(socketPath_));
+        thread_.join();
+    }
+};
+
+} // namespace
+
+void TestReferenceServer::setUp()
+{
+    tempDirectory_ = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("testReferenceServer-%%%%%%%%");
+    boost::filesystem::create_directories(tempDirectory_);
+    socketPath_ = tempDirectory_ / "socket";
+    firstXml_ = tempDirectory_ / "first.xml";
+    secondXml_ = tempDirectory_ / "second.xml";
+    writeReference(firstXml_, tempDirectory_ / "first.fa");
+    writeReference(secondXml_, tempDirectory_ / "second.fa");
+}
+
+void TestReferenceServer::tearDown()
+{
+    boost::filesystem::remove_all(tempDirectory_);
+}
+
+void TestReferenceServer::testRequestSegment()
+{
+    ReferenceServer server(socketPath_, std::vector<boost::filesystem::path>(1, firstXml_), 1, 2, 10);
+    std::string first;
+    std::string second;
+    {
+        RunningServer running(server, socketPath_);
+        first = ReferenceServer::requestSegment(socketPath_, firstXml_);
+        CPPUNIT_ASSERT(!first.empty());
+        // already published
+        CPPUNIT_ASSERT_EQUAL(first, ReferenceServer::requestSegment(socketPath_, firstXml_));
+        second = ReferenceServer::requestSegment(socketPath_, secondXml_);
+        CPPUNIT_ASSERT(!second.empty());
+        CPPUNIT_ASSERT(first != second);
+        CPPUNIT_ASSERT(ReferenceServer::requestSegment(socketPath_, tempDirectory_ / "missing.xml").empty());
+    }
+    SharedContigs attached;
+    CPPUNIT_ASSERT(attached.attach(first));
+    CPPUNIT_ASSERT(attached.attach(second));
+}
+
+void TestReferenceServer::testEviction()
+{
+    ReferenceServer server(socketPath_, std::vector<boost::filesystem::path>(), 1, 1, 10);
+    RunningServer running(server, socketPath_);
+
+    const std::string first = ReferenceServer::requestSegment(socketPath_, firstXml_);
+    SharedContigs firstAttached;
+    CPPUNIT_ASSERT(firstAttached.attach(first));
+
+    // only one reference is kept. The first one goes.
+    const std::string second = ReferenceServer::requestSegment(socketPath_, secondXml_);
+    CPPUNIT_ASSERT(!second.empty());
+    SharedContigs evicted;
+    CPPUNIT_ASSERT(!evicted.attach(first));
+    // the attached client still has the data
+    std::vector<char> bases;
+    firstAttached.copyContig(1, bases);
+    CPPUNIT_ASSERT_EQUAL(std::string("GGGG"), std::string(bases.begin(), bases.end()));
+
+    // requesting the first one again loads it into a new segment and evicts the second
+    const std::string reloaded = ReferenceServer::requestSegment(socketPath_, firstXml_);
+    CPPUNIT_ASSERT(!reloaded.empty());
+    CPPUNIT_ASSERT(first != reloaded);
+    CPPUNIT_ASSERT(!evicted.attach(second));
+    CPPUNIT_ASSERT(evicted.attach(reloaded));
+}
+
+void TestReferenceServer::testIdleClient()
+{
+    ReferenceServer server(socketPath_, std::vector<boost::filesystem::path>(1, firstXml_), 1, 2, 1);
+    RunningServer running(server, socketPath_);
+
+    // a client that never sends its request must not keep the others waiting forever
+    const int idleFd = connectTo(socketPath_);
+    CPPUNIT_ASSERT(-1 != idleFd);
+    CPPUNIT_ASSERT(!ReferenceServer::requestSegment(socketPath_, firstXml_).empty());
+
+    // the server has hung up on the idle client
+    char c = 0;
+    CPPUNIT_ASSERT_EQUAL(ssize_t(0), read(idleFd, &c, 1));
+    close(idleFd);
+}
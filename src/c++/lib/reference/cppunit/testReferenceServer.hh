@@ -0,0 +1,47 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file testReferenceServer.hh
+ **
+ ** Tests for the reference server eviction and client timeout.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifndef iSAAC_REFERENCE_TEST_REFERENCE_SERVER_HH
+#define iSAAC_REFERENCE_TEST_REFERENCE_SERVER_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <boost/filesystem.hpp>
+
+class TestReferenceServer : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( TestReferenceServer );
+    CPPUNIT_TEST( testRequestSegment );
+    CPPUNIT_TEST( testEviction );
+    CPPUNIT_TEST( testIdleClient );
+    CPPUNIT_TEST_SUITE_END();
+private:
+    boost::filesystem::path tempDirectory_;
+    boost::filesystem::path socketPath_;
+    boost::filesystem::path firstXml_;
+    boost::filesystem::path secondXml_;
+public:
+    void setUp();
+    void tearDown();
+    void testRequestSegment();
+    void testEviction();
+    void testIdleClient();
+};
+
+#endif // #ifndef iSAAC_REFERENCE_TEST_REFERENCE_SERVER_HH
@@ -0,0 +1,107 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+
+using namespace std;
+
+#include "RegistryName.hh"
+#include "testRepeatKmerFilter.hh"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( TestRepeatKmerFilter, registryName("RepeatKmerFilter"));
+
+namespace
+{
+
+typedef isaac::oligo::LongKmerType KmerT;
+typedef isaac::reference::RepeatKmerFilter<KmerT> FilterT;
+
+static const unsigned REPEATS = 1000;
+
+// spreads the repeats over all the bits of the 64-mer
+KmerT makeRepeat(const unsigned i)
+{
+    return (KmerT(i * 2654435761UL) << 96) | (KmerT(i) << 40) | KmerT(i * 7);
+}
+
+const boost::filesystem::path getTempFilterPath()
+{
+    return boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("testRepeatKmerFilter-%%%%%%%%");
+}
+
+} // namespace
+
+void TestRepeatKmerFilter::setUp()
+{
+}
+
+void TestRepeatKmerFilter::tearDown()
+{
+}
+
+void TestRepeatKmerFilter::testContains()
+{
+    FilterT filter;
+    CPPUNIT_ASSERT(filter.empty());
+    filter.buildLookup();
+    CPPUNIT_ASSERT(!filter.contains(makeRepeat(1)));
+
+    // unsorted and duplicate k-mers are fine
+    for (unsigned i = REPEATS; i; --i)
+    {
+        filter.add(makeRepeat(i));
+        filter.add(makeRepeat(i));
+    }
+    filter.buildLookup();
+    CPPUNIT_ASSERT_EQUAL(std::size_t(REPEATS), filter.size());
+
+    for (unsigned i = 1; REPEATS >= i; ++i)
+    {
+        CPPUNIT_ASSERT(filter.contains(makeRepeat(i)));
+        CPPUNIT_ASSERT(!filter.contains(makeRepeat(i) + 1));
+    }
+    CPPUNIT_ASSERT(!filter.contains(makeRepeat(REPEATS + 1)));
+    CPPUNIT_ASSERT(!filter.contains(~KmerT(0)));
+}
+
+void TestRepeatKmerFilter::testSaveLoad()
+{
+    FilterT first;
+    FilterT second;
+    for (unsigned i = 1; REPEATS >= i; ++i)
+    {
+        (i % 2 ? first : second).add(makeRepeat(i));
+    }
+    const boost::filesystem::path firstPath = getTempFilterPath();
+    const boost::filesystem::path secondPath = getTempFilterPath();
+    first.save(firstPath);
+    second.save(secondPath);
+
+    // filters of several mask files are merged
+    FilterT loaded;
+    CPPUNIT_ASSERT(loaded.load(firstPath));
+    CPPUNIT_ASSERT(loaded.load(secondPath));
+    CPPUNIT_ASSERT(!loaded.load(getTempFilterPath()));
+    boost::filesystem::remove(firstPath);
+    boost::filesystem::remove(secondPath);
+    loaded.buildLookup();
+
+    CPPUNIT_ASSERT_EQUAL(std::size_t(REPEATS), loaded.size());
+    for (unsigned i = 1; REPEATS >= i; ++i)
+    {
+        CPPUNIT_ASSERT(loaded.contains(makeRepeat(i)));
+    }
+    CPPUNIT_ASSERT(!loaded.contains(makeRepeat(REPEATS + 1)));
+}
@@ -0,0 +1,34 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#ifndef iSAAC_REFERENCE_TEST_REPEAT_KMER_FILTER_HH
+#define iSAAC_REFERENCE_TEST_REPEAT_KMER_FILTER_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "reference/RepeatKmerFilter.hh"
+
+class TestRepeatKmerFilter : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( TestRepeatKmerFilter );
+    CPPUNIT_TEST( testContains );
+    CPPUNIT_TEST( testSaveLoad );
+    CPPUNIT_TEST_SUITE_END();
+public:
+    void setUp();
+    void tearDown();
+    void testContains();
+    void testSaveLoad();
+};
+
+#endif // #ifndef iSAAC_REFERENCE_TEST_REPEAT_KMER_FILTER_HH
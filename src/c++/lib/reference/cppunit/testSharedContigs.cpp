@@ -0,0 +1,115 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file testSharedContigs.cpp
+ **
+ ** Tests for the contigs published in shared memory.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#include <boost/foreach.hpp>
+#include <boost/format.hpp>
+
+using namespace std;
+
+#include "RegistryName.hh"
+#include "testSharedContigs.hh"
+#include "reference/ContigLoader.hh"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( TestSharedContigs, registryName("SharedContigs"));
+
+using isaac::reference::SharedContigs;
+using isaac::reference::SortedReferenceMetadata;
+
+void TestSharedContigs::setUp()
+{
+    fastaPath_ = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("testSharedContigs-%%%%%%%%.fa");
+    std::ofstream os(fastaPath_.c_str());
+    os << ">chr1\nACGTNNacgt\nAAAA\n>chr2\nGGGG\n";
+    os.close();
+
+    contigs_.clear();
+    contigs_.push_back(SortedReferenceMetadata::Contig(0, 0, "chr1", fastaPath_, 6, 16, 0, 14, 12, "", "", ""));
+    contigs_.push_back(SortedReferenceMetadata::Contig(1, 1, "chr2", fastaPath_, 28, 5, 14, 4, 4, "", "", ""));
+    segmentName_ = (boost::format("/isaac-testSharedContigs-%d") % getpid()).str();
+}
+
+void TestSharedContigs::tearDown()
+{
+    boost::filesystem::remove(fastaPath_);
+}
+
+void TestSharedContigs::testPublishAttach()
+{
+    isaac::common::ThreadVector threads(2);
+    {
+        SharedContigs published;
+        published.publish(segmentName_, contigs_, threads);
+
+        SharedContigs attached;
+        CPPUNIT_ASSERT(attached.attach(segmentName_));
+        CPPUNIT_ASSERT(attached.matches(contigs_));
+        BOOST_FOREACH(const SortedReferenceMetadata::Contig &contig, contigs_)
+        {
+            std::vector<char> expected;
+            isaac::reference::loadContig(contig, expected);
+            std::vector<char> actual;
+            attached.copyContig(contig.index_, actual);
+            CPPUNIT_ASSERT_EQUAL(std::string(expected.begin(), expected.end()), std::string(actual.begin(), actual.end()));
+        }
+    }
+    // the segment goes away with the publisher
+    SharedContigs attached;
+    CPPUNIT_ASSERT(!attached.attach(segmentName_));
+}
+
+void TestSharedContigs::testMismatch()
+{
+    isaac::common::ThreadVector threads(1);
+    SharedContigs published;
+    published.publish(segmentName_, contigs_, threads);
+
+    SharedContigs attached;
+    CPPUNIT_ASSERT(attached.attach(segmentName_));
+    SortedReferenceMetadata::Contigs changed = contigs_;
+    changed.back().totalBases_ = 3;
+    CPPUNIT_ASSERT(!attached.matches(changed));
+    changed.pop_back();
+    CPPUNIT_ASSERT(!attached.matches(changed));
+}
+
+void TestSharedContigs::testFastaModified()
+{
+    isaac::common::ThreadVector threads(1);
+    SharedContigs published;
+    published.publish(segmentName_, contigs_, threads);
+
+    SharedContigs attached;
+    CPPUNIT_ASSERT(attached.attach(segmentName_));
+    CPPUNIT_ASSERT(attached.matches(contigs_));
+
+    // the contigs described by the xml are unchanged but the file is not the one they were loaded from
+    {
+        std::ofstream os(fastaPath_.c_str(), std::ios_base::app);
+        os << ">chr3\nA\n";
+    }
+    CPPUNIT_ASSERT(!attached.matches(contigs_));
+
+    boost::filesystem::remove(fastaPath_);
+    CPPUNIT_ASSERT(!attached.matches(contigs_));
+}
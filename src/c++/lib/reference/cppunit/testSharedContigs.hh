@@ -0,0 +1,48 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file testSharedContigs.hh
+ **
+ ** Tests for the contigs published in shared memory.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifndef iSAAC_REFERENCE_TEST_SHARED_CONTIGS_HH
+#define iSAAC_REFERENCE_TEST_SHARED_CONTIGS_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <boost/filesystem.hpp>
+
+#include "reference/SharedContigs.hh"
+
+class TestSharedContigs : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( TestSharedContigs );
+    CPPUNIT_TEST( testPublishAttach );
+    CPPUNIT_TEST( testMismatch );
+    CPPUNIT_TEST( testFastaModified );
+    CPPUNIT_TEST_SUITE_END();
+private:
+    boost::filesystem::path fastaPath_;
+    isaac::reference::SortedReferenceMetadata::Contigs contigs_;
+    std::string segmentName_;
+public:
+    void setUp();
+    void tearDown();
+    void testPublishAttach();
+    void testMismatch();
+    void testFastaModified();
+};
+
+#endif // #ifndef iSAAC_REFERENCE_TEST_SHARED_CONTIGS_HH
@@ -17,9 +17,11 @@
  ** \author Roman Petrovski
  **/
 
+#include <boost/bind.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/foreach.hpp>
 #include <boost/format.hpp>
+#include <boost/lexical_cast.hpp>
 
 #include "config.h"
 //#include <libxml/xmlmemory.h>
@@ -39,6 +41,7 @@
 #include "common/Exceptions.hh"
 #include "common/FileSystem.hh"
 #include "common/Process.hh"
+#include "common/Threads.hpp"
 #include "flowcell/BarcodeMetadata.hh"
 #include "package/InstallationPaths.hh"
 #include "reports/AlignmentReportGenerator.hh"
@@ -50,22 +53,45 @@ namespace isaac
 namespace reports
 {
 
+/**
+ * \brief Lanes and barcodes are the units the stylesheet distributes between the partitions. Having
+ *        more partitions than that only multiplies the parsed copies of the stats xml
+ */
+static unsigned getPartitionsMax(
+    const std::vector<flowcell::Layout> &flowcellLayoutList,
+    const flowcell::BarcodeMetadataList &barcodeMetadataList)
+{
+    std::size_t ret = barcodeMetadataList.size();
+    BOOST_FOREACH(const flowcell::Layout& flowcell, flowcellLayoutList)
+    {
+        ret += flowcell.getLaneIds().size();
+    }
+    return std::max<std::size_t>(1, ret);
+}
+
 AlignmentReportGenerator::AlignmentReportGenerator(
     const std::vector<flowcell::Layout> &flowcellLayoutList,
     const flowcell::BarcodeMetadataList &barcodeMetadataList,
     const boost::filesystem::path &alignmentStatsXmlPath,
     const boost::filesystem::path &demultiplexingStatsXmlPath,
+    const boost::filesystem::path &profilingStatsXmlPath,
     const boost::filesystem::path &tempDirectory,
     const boost::filesystem::path &outputDirectory,
-    const ImageFileFormat imageFileFormat)
+    const ImageFileFormat imageFileFormat,
+    const bool summaryOnly,
+    const unsigned threads)
     :flowcellLayoutList_(flowcellLayoutList),
      alignmentStatsXmlPath_(alignmentStatsXmlPath),
      demultiplexingStatsXmlPath_(demultiplexingStatsXmlPath),
+     profilingStatsXmlPath_(profilingStatsXmlPath),
      tempDirectory_(tempDirectory),
-     gnuplotScriptPath_(tempDirectory_/"gnuplot-generate-images.dat"),
+     gnuplotScriptDirectory_(tempDirectory_/"gnuplot"),
      outputDirectoryHtml_(outputDirectory/"html"),
      outputDirectoryImages_(outputDirectory/"gif"),
-     imageFileFormat_(imageFileFormat)
+     imageFileFormat_(imageFileFormat),
+     summaryOnly_(summaryOnly),
+     threads_(threads),
+     partitions_(std::min(threads_, getPartitionsMax(flowcellLayoutList_, barcodeMetadataList)))
 
 {
     std::vector<boost::filesystem::path> createList =
@@ -109,25 +135,32 @@ AlignmentReportGenerator::AlignmentReportGenerator(
         }
     }
 
-    common::createDirectories(createList);
-
-    boost::filesystem::remove(gnuplotScriptPath_);
-    if (boost::filesystem::exists(gnuplotScriptPath_))
+    boost::filesystem::remove_all(gnuplotScriptDirectory_);
+    if (boost::filesystem::exists(gnuplotScriptDirectory_))
     {
         BOOST_THROW_EXCEPTION(
-            common::IoException(errno, "Failed to remove the following temporary file:" + gnuplotScriptPath_.string()));
+            common::IoException(errno, "Failed to remove the following temporary directory:" + gnuplotScriptDirectory_.string()));
     }
+    createList.push_back(gnuplotScriptDirectory_);
 
+    common::createDirectories(createList);
 }
 
-void AlignmentReportGenerator::run()
+void AlignmentReportGenerator::applyStylesheet(
+    const unsigned partition,
+    const xsltStylesheetPtr stylesheet,
+    const boost::filesystem::path &isaacFullDataDir) const
 {
     const char *params[] = {"OUTPUT_DIRECTORY_HTML_PARAM", "''",
                             "OUTPUT_DIRECTORY_IMAGES_PARAM", "''",
                             "TEMP_DIRECTORY_PARAM", "''",
                             "DEMULTIPLEXING_STATS_XML_PARAM", "''",
-                            "GNUPLOT_SCRIPT_PATH_PARAM", "''",
+                            "GNUPLOT_SCRIPT_DIRECTORY_PARAM", "''",
                             "iSAAC_FULL_DATADIR_PARAM", "''",
+                            "PROFILING_STATS_XML_PARAM", "''",
+                            "PARTITION_PARAM", "0",
+                            "PARTITIONS_PARAM", "1",
+                            "SUMMARY_ONLY_PARAM", "false()",
                             0};
     const std::string quotedOutputHtmlDirectory = "'" + outputDirectoryHtml_.string() + "'";
     params[1] = quotedOutputHtmlDirectory.c_str();
@@ -137,47 +170,114 @@ void AlignmentReportGenerator::run()
     params[5] = quotedTempDirectory.c_str();
     const std::string quotedDemultiplexingStatsXml= "'" + demultiplexingStatsXmlPath_.string() + "'";
     params[7] = quotedDemultiplexingStatsXml.c_str();
-    const std::string quotedGnuplotScriptPath = "'" + gnuplotScriptPath_.string() + "'";
-    params[9] = quotedGnuplotScriptPath.c_str();
+    // no point producing gnuplot scripts if they are not going to be executed
+    const std::string quotedGnuplotScriptDirectory = (summaryOnly_ || none == imageFileFormat_) ?
+        std::string("''") : "'" + gnuplotScriptDirectory_.string() + "'";
+    params[9] = quotedGnuplotScriptDirectory.c_str();
 
-    const boost::filesystem::path isaacFullDataDir = package::expandPath(iSAAC_FULL_DATADIR);
     const std::string quotedIsaacFullDataDirPath = "'" + isaacFullDataDir.string() + "'";
     params[11] = quotedIsaacFullDataDirPath.c_str();
+    const std::string quotedProfilingStatsXml= "'" + profilingStatsXmlPath_.string() + "'";
+    params[13] = quotedProfilingStatsXml.c_str();
+    const std::string partitionString = boost::lexical_cast<std::string>(partition);
+    params[15] = partitionString.c_str();
+    const std::string partitionsString = boost::lexical_cast<std::string>(partitions_);
+    params[17] = partitionsString.c_str();
+    params[19] = summaryOnly_ ? "true()" : "false()";
 
+    // these are per-thread in libxml2. Setting them in run() only affects the main thread
     xmlSubstituteEntitiesDefault(1);
     xmlLoadExtDtdDefaultValue = 1;
 
-    exsltRegisterAll();
-
-    xsltStylesheetPtr cur = xsltParseStylesheetFile((const xmlChar *)(isaacFullDataDir / "xsl" / "alignment" / "GenerateReport.xsl").c_str());
+    // Each partition parses its own copy. The transformation is not guaranteed to leave the source untouched
     xmlDocPtr doc = xmlParseFile(alignmentStatsXmlPath_.c_str());
-    xmlDocPtr res = xsltApplyStylesheet(cur, doc, params);
-//    int xsltprocRes = xsltSaveResultToFile(0, res, cur);
-
-    xsltFreeStylesheet(cur);
+    if (!doc)
+    {
+        BOOST_THROW_EXCEPTION(common::LibXsltException());
+    }
+    xmlDocPtr res = xsltApplyStylesheet(stylesheet, doc, params);
     xmlFreeDoc(res);
     xmlFreeDoc(doc);
 
-    xsltCleanupGlobals();
-    xmlCleanupParser();
     if (!res)
     {
         BOOST_THROW_EXCEPTION(common::LibXsltException());
     }
-//    if (-1 == xsltprocRes)
-//    {
-//        BOOST_THROW_EXCEPTION(common::LibXsltException());
-//    }
+}
+
+void AlignmentReportGenerator::renderImages(
+    const std::vector<boost::filesystem::path> &gnuplotScripts,
+    std::size_t &nextScript,
+    boost::mutex &mutex) const
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    while (gnuplotScripts.size() != nextScript)
+    {
+        const boost::filesystem::path &script = gnuplotScripts.at(nextScript++);
+        {
+            common::unlock_guard<boost::unique_lock<boost::mutex> > unlock(lock);
+            common::executeCommand("gnuplot " + script.string());
+        }
+    }
+}
+
+void AlignmentReportGenerator::run()
+{
+    const boost::filesystem::path isaacFullDataDir = package::expandPath(iSAAC_FULL_DATADIR);
+
+    // global libxml and libxslt state must be initialized before the threads start using it
+    xmlInitParser();
+    xmlSubstituteEntitiesDefault(1);
+    xmlLoadExtDtdDefaultValue = 1;
+
+    exsltRegisterAll();
+
+    // compiled stylesheet is not modified by the transformations and can be shared between the threads
+    xsltStylesheetPtr stylesheet = xsltParseStylesheetFile(
+        (const xmlChar *)(isaacFullDataDir / "xsl" / "alignment" / "GenerateReport.xsl").c_str());
+    if (!stylesheet)
+    {
+        xsltCleanupGlobals();
+        xmlCleanupParser();
+        BOOST_THROW_EXCEPTION(common::LibXsltException());
+    }
+
+    common::ThreadVector threads(threads_);
+    try
+    {
+        threads.execute(boost::bind(&AlignmentReportGenerator::applyStylesheet, this,
+                                    _1, stylesheet, boost::cref(isaacFullDataDir)), partitions_);
+    }
+    catch (...)
+    {
+        xsltFreeStylesheet(stylesheet);
+        xsltCleanupGlobals();
+        xmlCleanupParser();
+        throw;
+    }
+
+    xsltFreeStylesheet(stylesheet);
+    xsltCleanupGlobals();
+    xmlCleanupParser();
 
     // Only generate output plots if not turned off
-    if(none != imageFileFormat_)
+    if (none != imageFileFormat_ && !summaryOnly_)
     {
-        // And the gnuplot script path exists
-        if (boost::filesystem::exists(gnuplotScriptPath_))
+        std::vector<boost::filesystem::path> gnuplotScripts;
+        for (boost::filesystem::directory_iterator it(gnuplotScriptDirectory_);
+            boost::filesystem::directory_iterator() != it; ++it)
         {
-            std::string gnuplotCmd = "gnuplot " + gnuplotScriptPath_.string();
-            common::executeCommand(gnuplotCmd);
+            gnuplotScripts.push_back(it->path());
         }
+        std::sort(gnuplotScripts.begin(), gnuplotScripts.end());
+
+        ISAAC_THREAD_CERR << "Rendering images from " << gnuplotScripts.size() << " gnuplot scripts" << std::endl;
+        std::size_t nextScript = 0;
+        boost::mutex mutex;
+        threads.execute(boost::bind(&AlignmentReportGenerator::renderImages, this,
+                                    boost::cref(gnuplotScripts), boost::ref(nextScript), boost::ref(mutex)),
+                        std::min<std::size_t>(threads.size(), std::max<std::size_t>(1, gnuplotScripts.size())));
+        ISAAC_THREAD_CERR << "Rendering images done from " << gnuplotScripts.size() << " gnuplot scripts" << std::endl;
     }
 }
 
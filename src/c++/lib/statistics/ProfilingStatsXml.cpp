@@ -0,0 +1,119 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file ProfilingStatsXml.cpp
+ **
+ ** \brief Xml Serialization of the processing stage timings.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include <boost/foreach.hpp>
+
+#include "common/Debug.hh"
+#include "statistics/ProfilingStatsXml.hh"
+
+namespace isaac
+{
+namespace statistics
+{
+
+ProfilingStatsXml::ProfilingStatsXml(
+    const common::Profiler &profiler,
+    const flowcell::TileMetadataList &tileMetadataList) :
+    profiler_(profiler),
+    tileMetadataList_(tileMetadataList)
+{
+}
+
+void ProfilingStatsXml::dumpCounters(xml::XmlWriter &xmlWriter, const common::StageCounters &counters) const
+{
+    xmlWriter.writeElement("Calls", counters.calls_);
+    xmlWriter.writeElement("WallMs", counters.wallNs_ / 1000000);
+    xmlWriter.writeElement("CpuMs", counters.cpuNs_ / 1000000);
+    xmlWriter.writeElement("Bytes", counters.bytes_);
+    xmlWriter.writeElement("Items", counters.items_);
+}
+
+void ProfilingStatsXml::dumpSteps(xml::XmlWriter &xmlWriter) const
+{
+    BOOST_FOREACH(const common::StepUsage &step, profiler_.getSteps())
+    {
+        ISAAC_XML_WRITER_ELEMENT_BLOCK(xmlWriter, "Step")
+        {
+            xmlWriter.writeAttribute("name", step.name_);
+            xmlWriter.writeElement("WallMs", step.usage_.wallNs_ / 1000000);
+            xmlWriter.writeElement("UserCpuMs", step.usage_.userCpuNs_ / 1000000);
+            xmlWriter.writeElement("SystemCpuMs", step.usage_.systemCpuNs_ / 1000000);
+            xmlWriter.writeElement("PeakRssKb", step.usage_.peakRssKb_);
+            xmlWriter.writeElement("BytesRead", step.usage_.bytesRead_);
+            xmlWriter.writeElement("BytesWritten", step.usage_.bytesWritten_);
+        }
+    }
+}
+
+void ProfilingStatsXml::dumpUnits(xml::XmlWriter &xmlWriter, const common::Profiler::Stage stage) const
+{
+    const common::Profiler::UnitType unitType = common::Profiler::getUnitType(stage);
+    const std::vector<common::StageCounters> &units = profiler_.getStageUnits(stage);
+    for (std::vector<common::StageCounters>::const_iterator it = units.begin(); units.end() != it; ++it)
+    {
+        if (!it->calls_)
+        {
+            continue;
+        }
+        const std::size_t unit = std::distance(units.begin(), it);
+        ISAAC_XML_WRITER_ELEMENT_BLOCK(xmlWriter, common::Profiler::Tile == unitType ? "Tile" : "Bin")
+        {
+            xmlWriter.writeAttribute("index", unit);
+            if (common::Profiler::Tile == unitType && tileMetadataList_.size() > unit)
+            {
+                const flowcell::TileMetadata &tile = tileMetadataList_.at(unit);
+                xmlWriter.writeAttribute("flowcell-id", tile.getFlowcellId());
+                xmlWriter.writeAttribute("lane", tile.getLane());
+                xmlWriter.writeAttribute("tile", tile.getTile());
+            }
+            dumpCounters(xmlWriter, *it);
+        }
+    }
+}
+
+void ProfilingStatsXml::serialize(std::ostream &os) const
+{
+    ISAAC_THREAD_CERR << "Generating Profiling statistics" << std::endl;
+    xml::XmlWriter xmlWriter(os);
+    ISAAC_XML_WRITER_ELEMENT_BLOCK(xmlWriter, "Profiling")
+    {
+        dumpSteps(xmlWriter);
+        for (unsigned stageIndex = 0; common::Profiler::STAGES_COUNT != stageIndex; ++stageIndex)
+        {
+            const common::Profiler::Stage stage = common::Profiler::Stage(stageIndex);
+            const common::StageCounters total = profiler_.getStageTotal(stage);
+            if (!total.calls_)
+            {
+                // stage did not run in this process. For example, --start-from was used.
+                continue;
+            }
+            ISAAC_XML_WRITER_ELEMENT_BLOCK(xmlWriter, "Stage")
+            {
+                xmlWriter.writeAttribute("step", common::Profiler::getStepName(stage));
+                xmlWriter.writeAttribute("name", common::Profiler::getStageName(stage));
+                dumpCounters(xmlWriter, total);
+                dumpUnits(xmlWriter, stage);
+            }
+        }
+    }
+    ISAAC_THREAD_CERR << "Generating Profiling statistics done" << std::endl;
+}
+
+} //namespace statistics
+} //namespace isaac
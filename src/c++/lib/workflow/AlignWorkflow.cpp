@@ -37,9 +37,13 @@
 #include "common/Debug.hh"
 #include "common/Exceptions.hh"
 #include "common/FileSystem.hh"
+#include "common/Profiling.hh"
 #include "flowcell/Layout.hh"
 #include "flowcell/ReadMetadata.hh"
+#include "reference/ReferenceServer.hh"
 #include "reports/AlignmentReportGenerator.hh"
+#include "statistics/ProfilingStatsXml.hh"
+#include "workflow/alignWorkflow/GatherTransition.hh"
 
 namespace isaac
 {
@@ -56,9 +60,12 @@ AlignWorkflow::AlignWorkflow(
     const bool cleanupIntermediary,
     const bool ignoreMissingBcls,
     const bool ignoreMissingFilters,
+    const bool memoryMapInput,
     const unsigned firstPassSeeds,
+    const unsigned seedIterations,
     const unsigned long matchesPerBin,
     const reference::ReferenceMetadataList &referenceMetadataList,
+    const bfs::path &referenceServerSocket,
     const bfs::path &tempDirectory,
     const bfs::path &outputDirectory,
     const unsigned int maxThreadCount,
@@ -89,6 +96,7 @@ AlignWorkflow::AlignWorkflow(
     const int gapOpenScore,
     const int gapExtendScore,
     const int minGapExtendScore,
+    const bool fixedPointScoring,
     const unsigned semialignedGapLimit,
     const alignment::TemplateBuilder::DodgyAlignmentScore dodgyAlignmentScore,
     const unsigned inputLoadersMax,
@@ -104,15 +112,21 @@ AlignWorkflow::AlignWorkflow(
     const bool keepDuplicates,
     const bool markDuplicates,
     const std::string &binRegexString,
+    const unsigned long scatterBinLength,
+    const bool tileCheckpoints,
     const common::ScoopedMallocBlock::Mode memoryControl,
     const std::vector<std::size_t> &clusterIdList,
     const alignment::TemplateLengthStatistics &userTemplateLengthStatistics,
     const reports::AlignmentReportGenerator::ImageFileFormat statsImageFormat,
+    const bool statsSummaryOnly,
     const bool bufferBins,
     const bool qScoreBin,
     const boost::array<char, 256> &fullBclQScoreTable,
     const OptionalFeatures optionalFeatures,
-    const bool pessimisticMapQ)
+    const bool pessimisticMapQ,
+    const build::OutputFormat outputFormat,
+    const std::string &bamStreamDestination,
+    const unsigned coverageTileSize)
     : argv_(argv)
     , description_(description)
     , flowcellLayoutList_(flowcellLayoutList)
@@ -134,9 +148,12 @@ AlignWorkflow::AlignWorkflow(
     , cleanupIntermediary_(cleanupIntermediary)
     , ignoreMissingBcls_(ignoreMissingBcls)
     , ignoreMissingFilters_(ignoreMissingFilters)
+    , memoryMapInput_(memoryMapInput)
     , firstPassSeeds_(firstPassSeeds)
+    , seedIterations_(seedIterations)
     , matchesPerBin_(matchesPerBin)
     , availableMemory_(availableMemory)
+    , memoryGovernor_(availableMemory)
     , clustersAtATimeMax_(clustersAtATimeMax)
     , mapqThreshold_(mapqThreshold)
     , perTileTls_(perTileTls)
@@ -158,6 +175,7 @@ AlignWorkflow::AlignWorkflow(
     , gapOpenScore_(gapOpenScore)
     , gapExtendScore_(gapExtendScore)
     , minGapExtendScore_(minGapExtendScore)
+    , fixedPointScoring_(fixedPointScoring)
     , semialignedGapLimit_(semialignedGapLimit)
     , dodgyAlignmentScore_(dodgyAlignmentScore)
     , inputLoadersMax_(inputLoadersMax)
@@ -177,11 +195,18 @@ AlignWorkflow::AlignWorkflow(
     , fullBclQScoreTable_(fullBclQScoreTable)
     , optionalFeatures_(optionalFeatures)
     , pessimisticMapQ_(pessimisticMapQ)
+    , outputFormat_(outputFormat)
+    , bamStreamDestination_(bamStreamDestination)
+    , coverageTileSize_(coverageTileSize)
     , binRegexString_(binRegexString)
+    , scatterBinLength_(scatterBinLength)
+    , tileCheckpoints_(tileCheckpoints)
     , memoryControl_(memoryControl)
     , userTemplateLengthStatistics_(userTemplateLengthStatistics)
     , demultiplexingStatsXmlPath_(statsDirectory_ / "DemultiplexingStats.xml")
+    , profilingStatsXmlPath_(statsDirectory_ / "ProfilingStats.xml")
     , statsImageFormat_(statsImageFormat)
+    , statsSummaryOnly_(statsSummaryOnly)
     , sortedReferenceMetadataList_(loadSortedReferenceXml(seedLength, referenceMetadataList))
     , state_(Start)
       // dummy initialization. Will be replaced with real object once match finding is over
@@ -192,6 +217,12 @@ AlignWorkflow::AlignWorkflow(
         (tempDirectory_)(outputDirectory)(statsDirectory_)(reportsDirectory_)(projectsDirectory_);
     common::createDirectories(createList);
 
+    if (!referenceServerSocket.empty())
+    {
+        reference::attachSharedContigs(
+            referenceServerSocket, referenceMetadataList, sortedReferenceMetadataList_, sharedContigsList_);
+    }
+
     BOOST_FOREACH(const flowcell::Layout &layout, flowcellLayoutList)
     {
         ISAAC_THREAD_CERR << "Aligner: adding base-calls path " << layout.getBaseCallsPath() << std::endl;
@@ -226,8 +257,10 @@ void AlignWorkflow::findMatches(alignWorkflow::FoundMatchesMetadata &foundMatche
         allowVariableFastqLength_,
         cleanupIntermediary_,
         ignoreMissingBcls_,
+        memoryMapInput_,
         firstPassSeeds_,
-        availableMemory_,
+        seedIterations_,
+        memoryGovernor_,
         clustersAtATimeMax_,
         tempDirectory_,
         demultiplexingStatsXmlPath_,
@@ -240,7 +273,8 @@ void AlignWorkflow::findMatches(alignWorkflow::FoundMatchesMetadata &foundMatche
         tempSaversMax_,
         memoryControl_,
         clusterIdList_,
-        sortedReferenceMetadataList_);
+        sortedReferenceMetadataList_,
+        tileCheckpoints_);
 
     if (16 == seedLength_)
     {
@@ -284,19 +318,19 @@ void AlignWorkflow::selectMatches(
     workflow::alignWorkflow::SelectMatchesTransition transition(
         (bufferBins_ ? 3 : 2),
         fragmentStorage, foundMatchesMetadata_.matchDistribution_,
-        sortedReferenceMetadataList_, tempDirectory_, coresMax_,
+        sortedReferenceMetadataList_, sharedContigsList_, tempDirectory_, coresMax_,
         foundMatchesMetadata_.tileMetadataList_, barcodeMetadataList_,
         flowcellLayoutList_, repeatThreshold_, mateDriftRange_,
         allowVariableFastqLength_,
         cleanupIntermediary_,
-        ignoreMissingBcls_, ignoreMissingFilters_,
+        ignoreMissingBcls_, ignoreMissingFilters_, memoryMapInput_,
         inputLoadersMax_, tempLoadersMax_, tempSaversMax_,
         foundMatchesMetadata_.matchTally_,
         userTemplateLengthStatistics_, mapqThreshold_, perTileTls_, pfOnly_, baseQualityCutoff_,
         keepUnaligned_, clipSemialigned_, clipOverlapping_,
         scatterRepeats_, gappedMismatchesMax_, avoidSmithWaterman_,
-        gapMatchScore_, gapMismatchScore_, gapOpenScore_, gapExtendScore_, minGapExtendScore_, semialignedGapLimit_,
-        dodgyAlignmentScore_, qScoreBin_, fullBclQScoreTable_, optionalFeatures_ & BamZX);
+        gapMatchScore_, gapMismatchScore_, gapOpenScore_, gapExtendScore_, minGapExtendScore_, fixedPointScoring_, semialignedGapLimit_,
+        dodgyAlignmentScore_, qScoreBin_, fullBclQScoreTable_, optionalFeatures_ & BamZX, tileCheckpoints_);
 
     transition.selectMatches(memoryControl_, matchSelectorStatsXmlPath_, barcodeTemplateLengthStatistics);
 }
@@ -328,16 +362,36 @@ void AlignWorkflow::selectMatches(
 
     ISAAC_TRACE_STAT("AlignWorkflow::selectMatches ")
 
+    // Scatter runs see different subsets of tiles. Bin by genomic length instead of the observed match
+    // distribution to get the same bins in all of them.
+    alignment::MatchDistribution fixedLengthBins;
+    if (scatterBinLength_)
+    {
+        fixedLengthBins.initialize(sortedReferenceMetadataList_);
+        fixedLengthBins.makeUniform();
+    }
+    const alignment::MatchDistribution &binningDistribution =
+        scatterBinLength_ ? fixedLengthBins : foundMatchesMetadata_.matchDistribution_;
+    const unsigned long binLimit = scatterBinLength_ ?
+        std::max(1UL, scatterBinLength_ / fixedLengthBins.getBinSize()) : matchesPerBin;
+    const std::string binLimitDescription = scatterBinLength_ ?
+        (boost::format("%d bases per bin") % scatterBinLength_).str() :
+        (boost::format("%d matches per bin limit") % matchesPerBin).str();
+
     if (!bufferBins_)
     {
+        // staging buffers plan against what is left after the match finder
+        memoryGovernor_.measure();
         alignment::matchSelector::BinningFragmentStorage fragmentStorage(
             keepUnaligned_, preSortBins_, tempSaversMax_, coresMax_,
-            foundMatchesMetadata_.matchDistribution_, matchesPerBin, tempDirectory_,
+            binningDistribution, binLimit, tempDirectory_,
             flowcellLayoutList_, barcodeMetadataList_,
             flowcell::getMaxTileClusters(foundMatchesMetadata_.tileMetadataList_),
-            foundMatchesMetadata_.tileMetadataList_.size());
+            foundMatchesMetadata_.tileMetadataList_.size(),
+            alignment::matchSelector::BinningFragmentStorage::STAGING_BUFFER_BYTES_DEFAULT,
+            memoryGovernor_);
 
-        ISAAC_THREAD_CERR << "Selecting matches using " << matchesPerBin << " matches per bin limit" << std::endl;
+        ISAAC_THREAD_CERR << "Selecting matches using " << binLimitDescription << std::endl;
         selectMatches(fragmentStorage, barcodeTemplateLengthStatistics);
         AlignWorkflow::SelectedMatchesMetadata ret;
         fragmentStorage.close(binPaths);
@@ -346,18 +400,41 @@ void AlignWorkflow::selectMatches(
     {
         alignment::matchSelector::BufferingFragmentStorage fragmentStorage(
             keepUnaligned_, preSortBins_, tempSaversMax_, coresMax_,
-            foundMatchesMetadata_.matchDistribution_, matchesPerBin, tempDirectory_,
+            binningDistribution, binLimit, tempDirectory_,
             flowcellLayoutList_, barcodeMetadataList_,
             flowcell::getMaxTileClusters(foundMatchesMetadata_.tileMetadataList_),
             foundMatchesMetadata_.tileMetadataList_.size(),
             "skip-empty" == binRegexString_);
 
-        ISAAC_THREAD_CERR << "Selecting matches using " << matchesPerBin << " matches per bin limit" << std::endl;
+        ISAAC_THREAD_CERR << "Selecting matches using " << binLimitDescription << std::endl;
         selectMatches(fragmentStorage, barcodeTemplateLengthStatistics);
         AlignWorkflow::SelectedMatchesMetadata ret;
         fragmentStorage.close(binPaths);
     }
-    ISAAC_THREAD_CERR << "Selecting matches done using " << matchesPerBin << " matches per bin limit. Produced " << binPaths.size() << " bins." << std::endl;
+    ISAAC_THREAD_CERR << "Selecting matches done using " << binLimitDescription << ". Produced " << binPaths.size() << " bins." << std::endl;
+}
+
+void AlignWorkflow::gather(
+    const std::vector<bfs::path> &scatterTempDirectoryList,
+    const std::vector<bfs::path> &scatterOutputDirectoryList)
+{
+    ISAAC_ASSERT_MSG(Start == state_, "Gather must start from a blank state");
+    ISAAC_THREAD_CERR << "Gathering the results of " << scatterTempDirectoryList.size() << " runs" << std::endl;
+
+    alignWorkflow::FoundMatchesMetadata foundMatches(
+        tempDirectory_, barcodeMetadataList_, seedIterations_, sortedReferenceMetadataList_);
+    alignWorkflow::GatherTransition gatherTransition(
+        barcodeMetadataList_, sortedReferenceMetadataList_, seedIterations_, preSortBins_,
+        std::min(coresMax_, tempLoadersMax_ + tempSaversMax_), tempDirectory_);
+    gatherTransition.perform(
+        scatterTempDirectoryList, scatterOutputDirectoryList,
+        matchSelectorStatsXmlPath_, demultiplexingStatsXmlPath_,
+        foundMatches, selectedMatchesMetadata_, barcodeTemplateLengthStatistics_);
+    foundMatchesMetadata_.swap(foundMatches);
+
+    dumpProfilingStats();
+    state_ = MatchSelectorDone;
+    ISAAC_THREAD_CERR << "Gathering the results done of " << scatterTempDirectoryList.size() << " runs" << std::endl;
 }
 
 void AlignWorkflow::generateAlignmentReports() const
@@ -365,8 +442,9 @@ void AlignWorkflow::generateAlignmentReports() const
     ISAAC_THREAD_CERR << "Generating the match selector reports from " << matchSelectorStatsXmlPath_ << std::endl;
     reports::AlignmentReportGenerator reportGenerator(flowcellLayoutList_, barcodeMetadataList_,
                                                   matchSelectorStatsXmlPath_, demultiplexingStatsXmlPath_,
+                                                  profilingStatsXmlPath_,
                                                   tempDirectory_, reportsDirectory_,
-                                                  statsImageFormat_);
+                                                  statsImageFormat_, statsSummaryOnly_, coresMax_);
     reportGenerator.run();
     ISAAC_THREAD_CERR << "Generating the match selector reports done from " << matchSelectorStatsXmlPath_ << std::endl;
 }
@@ -382,6 +460,7 @@ const build::BarcodeBamMapping AlignWorkflow::generateBam(
                        binPaths,
                        barcodeTemplateLengthStatistics,
                        sortedReferenceMetadataList_,
+                       sharedContigsList_,
                        projectsDirectory_,
                        tempLoadersMax_, coresMax_, outputSaversMax_, realignGaps_,
                        bamGzipLevel_, bamPuFormat_, bamHeaderTags_, expectedBgzfCompressionRatio_, singleLibrarySamples_,
@@ -400,16 +479,37 @@ const build::BarcodeBamMapping AlignWorkflow::generateBam(
                            optionalFeatures_ & BamSM,
                            optionalFeatures_ & BamZX,
                            optionalFeatures_ & BamZY),
-                       pessimisticMapQ_);
+                       pessimisticMapQ_, outputFormat_, bamStreamDestination_,
+                       coverageTileSize_, memoryGovernor_);
     {
         common::ScoopedMallocBlock  mallocBlock(memoryControl_);
         build.run(mallocBlock);
     }
     build.dumpStats(statsDirectory_ / "BuildStats.xml");
+    build.dumpMetrics(statsDirectory_ / "BuildMetrics.xml", statsDirectory_ / "Coverage");
     ISAAC_THREAD_CERR << "Generating the BAM files done" << std::endl;
     return build.getBarcodeBamMapping();
 }
 
+/**
+ * \brief Stores the timings accumulated by the steps performed so far. Called after each step so that
+ *        the alignment reports can show the match finding and selection timings.
+ */
+void AlignWorkflow::dumpProfilingStats() const
+{
+    std::ofstream os(profilingStatsXmlPath_.string().c_str());
+    if (!os)
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "ERROR: Unable to open file for writing: " + profilingStatsXmlPath_.string()));
+    }
+    statistics::ProfilingStatsXml statsXml(common::Profiler::instance(), foundMatchesMetadata_.tileMetadataList_);
+    statsXml.serialize(os);
+    if (!os)
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "ERROR: failed to store profiling statistics in : " + profilingStatsXmlPath_.string()));
+    }
+}
+
 void AlignWorkflow::run()
 {
     ISAAC_ASSERT_MSG(Start == state_, "Unexpected state");
@@ -462,25 +562,44 @@ AlignWorkflow::State AlignWorkflow::step()
     {
     case Start:
     {
-        findMatches(foundMatchesMetadata_);
+        common::StepResourceMonitor stepMonitor("FindMatches");
+        ISAAC_BLOCK_WITH_CLENAUP(boost::bind(&common::StepResourceMonitor::stop, &stepMonitor, _1))
+        {
+            findMatches(foundMatchesMetadata_);
+        }
+        dumpProfilingStats();
         state_ = getNextState();
         break;
     }
     case MatchFinderDone:
     {
-        selectMatches(selectedMatchesMetadata_, barcodeTemplateLengthStatistics_);
+        common::StepResourceMonitor stepMonitor("SelectMatches");
+        ISAAC_BLOCK_WITH_CLENAUP(boost::bind(&common::StepResourceMonitor::stop, &stepMonitor, _1))
+        {
+            selectMatches(selectedMatchesMetadata_, barcodeTemplateLengthStatistics_);
+        }
+        dumpProfilingStats();
         state_ = getNextState();
         break;
     }
     case MatchSelectorDone:
     {
-        generateAlignmentReports();
+        common::StepResourceMonitor stepMonitor("AlignmentReports");
+        ISAAC_BLOCK_WITH_CLENAUP(boost::bind(&common::StepResourceMonitor::stop, &stepMonitor, _1))
+        {
+            generateAlignmentReports();
+        }
         state_ = getNextState();
         break;
     }
     case AlignmentReportsDone:
     {
-        barcodeBamMapping_ = generateBam(selectedMatchesMetadata_, barcodeTemplateLengthStatistics_);
+        common::StepResourceMonitor stepMonitor("Build");
+        ISAAC_BLOCK_WITH_CLENAUP(boost::bind(&common::StepResourceMonitor::stop, &stepMonitor, _1))
+        {
+            barcodeBamMapping_ = generateBam(selectedMatchesMetadata_, barcodeTemplateLengthStatistics_);
+        }
+        dumpProfilingStats();
         state_ = getNextState();
         break;
     }
@@ -23,6 +23,7 @@
 #include "common/Debug.hh"
 #include "common/Exceptions.hh"
 #include "io/BitsetSaver.hh"
+#include "reference/CompressedMaskFile.hh"
 #include "reference/ContigLoader.hh"
 #include "reference/ReferenceKmer.hh"
 #include "workflow/ExtractNeighborsWorkflow.hh"
@@ -88,12 +89,7 @@ void ExtractNeighborsWorkflow::scanMaskFile(
         BOOST_THROW_EXCEPTION(common::IoException(ENOENT, message.str()));
     }
 
-    std::ifstream maskInput(maskFile.path.c_str());
-    if (!maskInput)
-    {
-        const boost::format message = boost::format("Failed to open mask file %s for reading: %s") % maskFile.path % strerror(errno);
-        BOOST_THROW_EXCEPTION(common::IoException(errno, message.str()));
-    }
+    reference::MaskFileInputStream<KmerT> maskInput(maskFile.path);
 
     std::size_t scannedKmers = 0, maskNeighbors = 0, maskNonHighRepeats = 0;
     while(maskInput)
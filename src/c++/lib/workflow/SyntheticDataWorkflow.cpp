@@ -0,0 +1,461 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file SyntheticDataWorkflow.cpp
+ **
+ ** \brief see SyntheticDataWorkflow.hh
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include <algorithm>
+#include <fstream>
+
+#include <boost/foreach.hpp>
+#include <boost/format.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+#include <boost/random/uniform_real_distribution.hpp>
+
+#include "bam/Bam.hh"
+#include "bgzf/BgzfCompressor.hh"
+#include "common/Debug.hh"
+#include "common/Exceptions.hh"
+#include "workflow/SyntheticDataWorkflow.hh"
+
+namespace isaac
+{
+namespace workflow
+{
+
+namespace
+{
+
+const char BASES[] = "ACGT";
+const unsigned FASTA_LINE_LENGTH = 70;
+const unsigned LANE = 1;
+const char HIGH_QUALITY = 35;
+const char ERROR_QUALITY = 12;
+const char N_QUALITY = 2;
+// bin of the unmapped reads, see SAM specification
+const unsigned UNMAPPED_BIN = 4680;
+
+inline char complement(const char base)
+{
+    switch (base)
+    {
+    case 'A': return 'T';
+    case 'C': return 'G';
+    case 'G': return 'C';
+    case 'T': return 'A';
+    default: return 'N';
+    }
+}
+
+inline unsigned baseIndex(const char base)
+{
+    return std::find(BASES, BASES + 4, base) - BASES;
+}
+
+void openOrThrow(std::ofstream &os, const bfs::path &filePath)
+{
+    os.open(filePath.c_str(), std::ios_base::binary);
+    if (!os)
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to open file for writing: " + filePath.string()));
+    }
+}
+
+void closeOrThrow(std::ofstream &os, const bfs::path &filePath)
+{
+    os.close();
+    if (!os)
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to write into file: " + filePath.string()));
+    }
+}
+
+} // namespace
+
+SyntheticDataWorkflow::SyntheticDataWorkflow(
+    const bfs::path &outputDirectory,
+    const unsigned randomSeed,
+    const unsigned contigsCount,
+    const unsigned contigLength,
+    const unsigned clustersCount,
+    const unsigned tilesCount,
+    const unsigned readLength,
+    const unsigned fragmentLength,
+    const unsigned fragmentLengthDeviation,
+    const double errorRate,
+    const double indelRate,
+    const double duplicateRate,
+    const std::vector<std::string> &outputFormats)
+    : outputDirectory_(outputDirectory)
+    , contigsCount_(contigsCount)
+    , contigLength_(contigLength)
+    , clustersCount_(clustersCount)
+    , tilesCount_(tilesCount)
+    , readLength_(readLength)
+    , fragmentLength_(fragmentLength)
+    , fragmentLengthDeviation_(fragmentLengthDeviation)
+    , errorRate_(errorRate)
+    , indelRate_(indelRate)
+    , duplicateRate_(duplicateRate)
+    , outputFormats_(outputFormats)
+    , randomGenerator_(randomSeed)
+{
+}
+
+void SyntheticDataWorkflow::run()
+{
+    // the reference is always generated so that the reads don't depend on the requested formats
+    generateReference();
+    generateClusters();
+
+    if (isFormatRequested("fasta"))
+    {
+        storeFasta();
+    }
+    if (isFormatRequested("fastq"))
+    {
+        storeFastq();
+    }
+    if (isFormatRequested("bam"))
+    {
+        storeBam();
+    }
+    if (isFormatRequested("bcl"))
+    {
+        storeBcl();
+    }
+}
+
+bool SyntheticDataWorkflow::isFormatRequested(const std::string &format) const
+{
+    return outputFormats_.end() != std::find(outputFormats_.begin(), outputFormats_.end(), format);
+}
+
+double SyntheticDataWorkflow::randomProbability()
+{
+    return boost::random::uniform_real_distribution<double>(0.0, 1.0)(randomGenerator_);
+}
+
+unsigned SyntheticDataWorkflow::randomNumber(const unsigned max)
+{
+    ISAAC_ASSERT_MSG(max, "Empty range");
+    return boost::random::uniform_int_distribution<unsigned>(0, max - 1)(randomGenerator_);
+}
+
+char SyntheticDataWorkflow::randomBase()
+{
+    return BASES[randomNumber(4)];
+}
+
+SyntheticDataWorkflow::Fragment SyntheticDataWorkflow::randomFragment()
+{
+    Fragment ret;
+    const double length = boost::random::normal_distribution<double>(fragmentLength_, fragmentLengthDeviation_)(randomGenerator_);
+    ret.length_ = std::min<double>(contigLength_, std::max<double>(readLength_, length));
+    ret.contig_ = randomNumber(contigsCount_);
+    ret.begin_ = randomNumber(contigLength_ - ret.length_ + 1);
+    ret.reverse_ = 0.5 > randomProbability();
+    return ret;
+}
+
+void SyntheticDataWorkflow::generateReference()
+{
+    ISAAC_THREAD_CERR << "Generating " << contigsCount_ << " contigs of " << contigLength_ << " bases" << std::endl;
+    contigs_.resize(contigsCount_);
+    BOOST_FOREACH(std::string &contig, contigs_)
+    {
+        contig.reserve(contigLength_);
+        while (contig.size() < contigLength_)
+        {
+            contig.push_back(randomBase());
+        }
+    }
+}
+
+/**
+ * \brief Produces the read sequenced from one end of the fragment with at most one indel and with random
+ *        substitutions. The reads sequenced from the fragment end are reverse-complemented.
+ */
+void SyntheticDataWorkflow::generateRead(
+    const Fragment &fragment,
+    const bool fromFragmentEnd,
+    std::string &bases,
+    std::string &qualities)
+{
+    const std::string &contig = contigs_.at(fragment.contig_);
+    const long step = fromFragmentEnd ? -1 : 1;
+    long pos = fromFragmentEnd ? fragment.begin_ + fragment.length_ - 1 : fragment.begin_;
+
+    std::size_t indelOffset = readLength_;
+    // positive for insertions, negative for deletions
+    long indelLength = 0;
+    if (indelRate_ > randomProbability())
+    {
+        indelOffset = readLength_ / 4 + randomNumber(readLength_ / 2 + 1);
+        indelLength = (1 + randomNumber(3)) * (0.5 > randomProbability() ? 1 : -1);
+    }
+
+    bases.clear();
+    while (bases.size() < readLength_)
+    {
+        if (bases.size() == indelOffset)
+        {
+            for (long i = 0; indelLength > i && bases.size() < readLength_; ++i)
+            {
+                bases.push_back(randomBase());
+            }
+            if (0 > indelLength)
+            {
+                pos -= indelLength * step;
+            }
+            indelOffset = readLength_;
+            continue;
+        }
+        // deletions can push the read past the contig ends
+        const char base = (0 <= pos && contig.size() > std::size_t(pos)) ? contig[pos] : 'N';
+        bases.push_back(fromFragmentEnd ? complement(base) : base);
+        pos += step;
+    }
+
+    qualities.clear();
+    BOOST_FOREACH(char &base, bases)
+    {
+        if ('N' == base)
+        {
+            qualities.push_back(N_QUALITY);
+        }
+        else if (errorRate_ > randomProbability())
+        {
+            base = BASES[(baseIndex(base) + 1 + randomNumber(3)) % 4];
+            qualities.push_back(ERROR_QUALITY);
+        }
+        else
+        {
+            qualities.push_back(HIGH_QUALITY);
+        }
+    }
+}
+
+void SyntheticDataWorkflow::generateClusters()
+{
+    ISAAC_THREAD_CERR << "Generating " << clustersCount_ << " clusters" << std::endl;
+    clusters_.resize(clustersCount_);
+    std::vector<Fragment> fragments;
+    fragments.reserve(clustersCount_);
+    BOOST_FOREACH(Cluster &cluster, clusters_)
+    {
+        // duplicates share the fragment but get their own sequencing errors
+        const Fragment fragment = (!fragments.empty() && duplicateRate_ > randomProbability()) ?
+            fragments.at(randomNumber(fragments.size())) : randomFragment();
+        fragments.push_back(fragment);
+        generateRead(fragment, fragment.reverse_, cluster.bases_[0], cluster.qualities_[0]);
+        generateRead(fragment, !fragment.reverse_, cluster.bases_[1], cluster.qualities_[1]);
+    }
+}
+
+unsigned SyntheticDataWorkflow::getClusterTile(const std::size_t cluster) const
+{
+    // surface 1, swath 1, see rta::RunInfoXml::getTiles
+    return 1101 + cluster * tilesCount_ / clustersCount_;
+}
+
+std::string SyntheticDataWorkflow::getClusterName(const std::size_t cluster) const
+{
+    return (boost::format("SYNTHETIC:%d:%d:%d") % LANE % getClusterTile(cluster) % cluster).str();
+}
+
+void SyntheticDataWorkflow::storeFasta() const
+{
+    const bfs::path fastaPath = outputDirectory_ / "genome.fa";
+    ISAAC_THREAD_CERR << "Storing " << fastaPath << std::endl;
+    std::ofstream os;
+    openOrThrow(os, fastaPath);
+    for (std::size_t contigIndex = 0; contigs_.size() != contigIndex; ++contigIndex)
+    {
+        const std::string &contig = contigs_.at(contigIndex);
+        os << ">chr" << contigIndex + 1 << "\n";
+        for (std::size_t offset = 0; contig.size() > offset; offset += FASTA_LINE_LENGTH)
+        {
+            os << contig.substr(offset, FASTA_LINE_LENGTH) << "\n";
+        }
+    }
+    closeOrThrow(os, fastaPath);
+}
+
+void SyntheticDataWorkflow::storeFastq() const
+{
+    const bfs::path fastqDirectory = outputDirectory_ / "fastq";
+    bfs::create_directories(fastqDirectory);
+    for (unsigned read = 0; 2 != read; ++read)
+    {
+        const bfs::path fastqPath = fastqDirectory / (boost::format("lane%d_read%d.fastq") % LANE % (read + 1)).str();
+        ISAAC_THREAD_CERR << "Storing " << fastqPath << std::endl;
+        std::ofstream os;
+        openOrThrow(os, fastqPath);
+        for (std::size_t clusterIndex = 0; clusters_.size() != clusterIndex; ++clusterIndex)
+        {
+            const Cluster &cluster = clusters_.at(clusterIndex);
+            os << "@" << getClusterName(clusterIndex) << " " << read + 1 << ":N:0:\n" << cluster.bases_[read] << "\n+\n";
+            BOOST_FOREACH(const char quality, cluster.qualities_[read])
+            {
+                os << char(quality + 33);
+            }
+            os << "\n";
+        }
+        closeOrThrow(os, fastqPath);
+    }
+}
+
+void SyntheticDataWorkflow::storeBam() const
+{
+    const bfs::path bamDirectory = outputDirectory_ / "bam";
+    bfs::create_directories(bamDirectory);
+    const bfs::path bamPath = bamDirectory / "synthetic.bam";
+    ISAAC_THREAD_CERR << "Storing " << bamPath << std::endl;
+    std::ofstream os;
+    openOrThrow(os, bamPath);
+    {
+        boost::iostreams::filtering_ostream bgzfStream;
+        bgzfStream.push(bgzf::BgzfCompressor(boost::iostreams::gzip::default_compression));
+        bgzfStream.push(os);
+
+        const std::string headerText("@HD\tVN:1.0\tSO:unsorted\n");
+        bam::serialize(bgzfStream, "BAM\1", 4);
+        bam::serialize(bgzfStream, int(headerText.size()));
+        bam::serialize(bgzfStream, headerText.c_str(), headerText.size());
+        // n_ref
+        bam::serialize(bgzfStream, int(0));
+
+        std::vector<char> seq;
+        for (std::size_t clusterIndex = 0; clusters_.size() != clusterIndex; ++clusterIndex)
+        {
+            const Cluster &cluster = clusters_.at(clusterIndex);
+            const std::string name = getClusterName(clusterIndex);
+            for (unsigned read = 0; 2 != read; ++read)
+            {
+                const std::string &bases = cluster.bases_[read];
+                // 4-bit encoding: =ACMGRSVTWYHKDBN
+                seq.assign((bases.size() + 1) / 2, 0);
+                for (std::size_t i = 0; bases.size() != i; ++i)
+                {
+                    const unsigned index = baseIndex(bases[i]);
+                    const char code = 4 == index ? 15 : (1 << index);
+                    seq[i / 2] |= (i % 2) ? code : (code << 4);
+                }
+
+                // paired, unmapped, mate unmapped, first or second in pair
+                const unsigned flag = 0x1 | 0x4 | 0x8 | (read ? 0x80 : 0x40);
+                const int blockSize = 8 * sizeof(int) + name.size() + 1 + seq.size() + bases.size();
+                bam::serialize(bgzfStream, blockSize);
+                bam::serialize(bgzfStream, int(-1));
+                bam::serialize(bgzfStream, int(-1));
+                bam::serialize(bgzfStream, UNMAPPED_BIN << 16 | unsigned(name.size() + 1));
+                bam::serialize(bgzfStream, flag << 16);
+                bam::serialize(bgzfStream, int(bases.size()));
+                bam::serialize(bgzfStream, int(-1));
+                bam::serialize(bgzfStream, int(-1));
+                bam::serialize(bgzfStream, int(0));
+                bam::serialize(bgzfStream, name);
+                bam::serialize(bgzfStream, seq);
+                bam::serialize(bgzfStream, cluster.qualities_[read].c_str(), cluster.qualities_[read].size());
+            }
+        }
+        bgzfStream.strict_sync();
+    }
+    bam::serializeBgzfFooter(os);
+    closeOrThrow(os, bamPath);
+}
+
+/**
+ * \brief Stores lane 1 as RunInfo.xml flowcell. All clusters pass filter.
+ */
+void SyntheticDataWorkflow::storeBcl() const
+{
+    const bfs::path runFolder = outputDirectory_ / "bcl";
+    const bfs::path laneDirectory = runFolder / "Data" / "Intensities" / "BaseCalls" / (boost::format("L%03d") % LANE).str();
+    bfs::create_directories(laneDirectory);
+
+    const bfs::path runInfoPath = runFolder / "RunInfo.xml";
+    ISAAC_THREAD_CERR << "Storing " << runInfoPath << std::endl;
+    std::ofstream runInfo;
+    openOrThrow(runInfo, runInfoPath);
+    runInfo << "<?xml version=\"1.0\"?>\n"
+        "<RunInfo Version=\"2\">\n"
+        "  <Run Id=\"SYNTHETIC\" Number=\"1\">\n"
+        "    <Flowcell>SYNTHETIC</Flowcell>\n"
+        "    <Reads>\n"
+        "      <Read Number=\"1\" NumCycles=\"" << readLength_ << "\" IsIndexedRead=\"N\" />\n"
+        "      <Read Number=\"2\" NumCycles=\"" << readLength_ << "\" IsIndexedRead=\"N\" />\n"
+        "    </Reads>\n"
+        "    <FlowcellLayout LaneCount=\"" << LANE << "\" SurfaceCount=\"1\" SwathCount=\"1\" TileCount=\"" << tilesCount_ << "\" />\n"
+        "  </Run>\n"
+        "</RunInfo>\n";
+    closeOrThrow(runInfo, runInfoPath);
+
+    std::size_t tileBegin = 0;
+    std::vector<char> bcl;
+    for (unsigned tileIndex = 0; tilesCount_ != tileIndex; ++tileIndex)
+    {
+        const unsigned tile = 1101 + tileIndex;
+        std::size_t tileEnd = tileBegin;
+        while (clusters_.size() != tileEnd && tile == getClusterTile(tileEnd))
+        {
+            ++tileEnd;
+        }
+        const unsigned tileClusters = tileEnd - tileBegin;
+        ISAAC_THREAD_CERR << "Storing tile " << tile << " with " << tileClusters << " clusters" << std::endl;
+
+        const bfs::path filterPath = laneDirectory / (boost::format("s_%d_%04d.filter") % LANE % tile).str();
+        std::ofstream filter;
+        openOrThrow(filter, filterPath);
+        // version 3 header: zero, version, cluster count
+        const unsigned filterHeader[] = {0, 3, tileClusters};
+        filter.write(reinterpret_cast<const char *>(filterHeader), sizeof(filterHeader));
+        const std::vector<char> passed(tileClusters, 1);
+        filter.write(&passed.front(), passed.size());
+        closeOrThrow(filter, filterPath);
+
+        for (unsigned cycle = 0; readLength_ * 2 != cycle; ++cycle)
+        {
+            const unsigned read = cycle / readLength_;
+            const unsigned offset = cycle % readLength_;
+            bcl.resize(sizeof(tileClusters));
+            std::copy(reinterpret_cast<const char *>(&tileClusters),
+                      reinterpret_cast<const char *>(&tileClusters) + sizeof(tileClusters), bcl.begin());
+            for (std::size_t clusterIndex = tileBegin; tileEnd != clusterIndex; ++clusterIndex)
+            {
+                const Cluster &cluster = clusters_.at(clusterIndex);
+                const unsigned index = baseIndex(cluster.bases_[read][offset]);
+                // two lower bits are the base, the rest is quality. N is stored as 0
+                bcl.push_back(4 == index ? 0 : (cluster.qualities_[read][offset] << 2 | index));
+            }
+
+            const bfs::path cycleDirectory = laneDirectory / (boost::format("C%d.1") % (cycle + 1)).str();
+            bfs::create_directories(cycleDirectory);
+            const bfs::path bclPath = cycleDirectory / (boost::format("s_%d_%d.bcl") % LANE % tile).str();
+            std::ofstream os;
+            openOrThrow(os, bclPath);
+            os.write(&bcl.front(), bcl.size());
+            closeOrThrow(os, bclPath);
+        }
+        tileBegin = tileEnd;
+    }
+}
+
+} // namespace workflow
+} // namespace isaac
@@ -327,6 +327,12 @@ const std::vector<typename BamSeedSource<KmerT>::SeedIterator> &BamSeedSource<Km
     return seedGenerator_->getReferenceSeedBounds();
 }
 
+template <typename KmerT>
+typename BamSeedSource<KmerT>::SeedIterator BamSeedSource<KmerT>::getRepeatSeedsEnd() const
+{
+    return seedGenerator_->getRepeatSeedsEnd();
+}
+
 /////////////// BamBaseCallsSource implementation
 inline const boost::filesystem::path getLongestBamFilePath(const flowcell::FlowcellLayoutList &flowcellLayoutList)
 {
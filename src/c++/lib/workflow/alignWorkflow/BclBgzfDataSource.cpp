@@ -31,19 +31,23 @@ namespace alignWorkflow
 template <typename KmerT>
 BclBgzfSeedSource<KmerT>::BclBgzfSeedSource(
     const bool ignoreMissingBcls,
+    const bool memoryMapInput,
     const unsigned inputLoadersMax,
     const unsigned coresMax,
     const flowcell::BarcodeMetadataList &barcodeMetadataList,
     const reference::SortedReferenceMetadataList &sortedReferenceMetadataList,
     const flowcell::Layout &bclFlowcellLayout,
+    common::MemoryGovernor &memoryGovernor,
     common::ThreadVector &threads) :
         ignoreMissingBcls_(ignoreMissingBcls),
+        memoryMapInput_(memoryMapInput),
         inputLoadersMax_(inputLoadersMax),
         coresMax_(coresMax),
         barcodeMetadataList_(barcodeMetadataList),
         bclFlowcellLayout_(bclFlowcellLayout),
         threads_(threads),
         sortedReferenceMetadataList_(sortedReferenceMetadataList),
+        memoryGovernor_(memoryGovernor),
         tileBciIndexMap_(),
         flowcellTiles_(getTiles(bclFlowcellLayout_, tileBciIndexMap_)),
         maxTileClusterCount_(std::max_element(flowcellTiles_.begin(), flowcellTiles_.end(),
@@ -51,7 +55,8 @@ BclBgzfSeedSource<KmerT>::BclBgzfSeedSource(
                                               boost::bind(&flowcell::TileMetadata::getClusterCount, _2))->getClusterCount()),
         undiscoveredTiles_(flowcellTiles_.begin()),
         threadBclReaders_(inputLoadersMax_,
-            rta::BclBgzfTileReader(ignoreMissingBcls_, maxTileClusterCount_, tileBciIndexMap_, cycleBciMappers_)),
+            rta::BclBgzfTileReader(ignoreMissingBcls_, memoryMapInput_, maxTileClusterCount_,
+                                   tileBciIndexMap_, cycleBciMappers_, 0)),
         barcodeLoader_(
             threads_, inputLoadersMax_, flowcellTiles_,
             bclFlowcellLayout_,
@@ -61,6 +66,17 @@ BclBgzfSeedSource<KmerT>::BclBgzfSeedSource(
     const unsigned longestBclPath =
         bclFlowcellLayout_.getLongestAttribute<flowcell::Layout::BclBgzf, flowcell::BclFilePathAttributeTag>().string().size();
 
+    // with one core per loader, the reader inflates on the loader thread
+    const unsigned inflaterThreads = coresMax_ / inputLoadersMax_;
+    if (1 < inflaterThreads)
+    {
+        BOOST_FOREACH(rta::BclBgzfTileReader &reader, threadBclReaders_)
+        {
+            threadBlockInflaters_.push_back(new bgzf::ParallelBgzfBlockInflater(inflaterThreads));
+            reader.setBlockInflater(&threadBlockInflaters_.back());
+        }
+    }
+
     while(threadBclMappers_.size() < inputLoadersMax_)
     {
         threadBclMappers_.push_back(
@@ -141,8 +157,10 @@ void BclBgzfSeedSource<KmerT>::initBuffers(
         bclFlowcellLayout_.getReadMetadataList(), seedMetadataList);
     initCycleBciMappers(cycles, getLaneNumber(unprocessedTiles), cycleBciMappers_);
 
+    // the loader of the previous pass must not hold on to its buffers while the new one is sized
+    seedLoader_.reset();
     seedLoader_.reset(new alignment::ParallelSeedLoader<rta::BclBgzfTileReader, KmerT>(
-        ignoreMissingBcls_, threads_, threadBclMappers_,
+        ignoreMissingBcls_, threads_, threadBclMappers_, memoryGovernor_,
         inputLoadersMax_, coresMax_, barcodeMetadataList_,
         bclFlowcellLayout_,
         seedMetadataList,
@@ -165,6 +183,12 @@ const std::vector<typename BclBgzfSeedSource<KmerT>::SeedIterator> &BclBgzfSeedS
     return seedLoader_->getReferenceSeedBounds();
 }
 
+template <typename KmerT>
+typename BclBgzfSeedSource<KmerT>::SeedIterator BclBgzfSeedSource<KmerT>::getRepeatSeedsEnd() const
+{
+    return seedLoader_->getRepeatSeedsEnd();
+}
+
 template <typename KmerT>
 flowcell::TileMetadataList BclBgzfSeedSource<KmerT>::getTiles(
     const flowcell::Layout &flowcellLayout,
@@ -211,6 +235,7 @@ BclBgzfBaseCallsSource::BclBgzfBaseCallsSource(
     const flowcell::TileMetadataList &tileMetadataList,
     const bool ignoreMissingBcls,
     const bool ignoreMissingFilters,
+    const bool memoryMapInput,
     common::ThreadVector &bclLoadThreads,
     const unsigned inputLoadersMax,
     const bool extractClusterXy):
@@ -230,16 +255,19 @@ BclBgzfBaseCallsSource::BclBgzfBaseCallsSource(
     threadReaders_(
         bclLoadThreads_.size(),
         rta::BclBgzfTileReader(ignoreMissingBcls,
+                               memoryMapInput,
                                flowcell::getMaxTileClusters(tileMetadataList),
                                tileBciIndexMap_,
-                               cycleBciMappers_)),
+                               cycleBciMappers_,
+                               // cycles are already loaded in parallel
+                               0)),
     bclMapper_(ignoreMissingBcls, cycles_.size(),
            bclLoadThreads_, threadReaders_,
            inputLoadersMax, flowcell::getMaxTileClusters(tileMetadataList),
            flowcell::getLongestAttribute<flowcell::Layout::BclBgzf, flowcell::BclFilePathAttributeTag>(flowcellLayoutList_).string().size()),
-    filtersMapper_(ignoreMissingFilters),
-    clocsMapper_(),
-    locsMapper_(),
+    filtersMapper_(ignoreMissingFilters, memoryMapInput),
+    clocsMapper_(memoryMapInput),
+    locsMapper_(memoryMapInput),
     currentFlowcellIndex_(-1U),
     currentLaneNumber_(-1U)
 {
@@ -31,24 +31,29 @@ namespace alignWorkflow
 template <typename KmerT>
 BclSeedSource<KmerT>::BclSeedSource(
     const bool ignoreMissingBcls,
+    const bool memoryMapInput,
     const unsigned inputLoadersMax,
     const unsigned coresMax,
     const flowcell::BarcodeMetadataList &barcodeMetadataList,
     const reference::SortedReferenceMetadataList &sortedReferenceMetadataList,
     const flowcell::Layout &bclFlowcellLayout,
+    common::MemoryGovernor &memoryGovernor,
     common::ThreadVector &threads) :
         ignoreMissingBcls_(ignoreMissingBcls),
+        memoryMapInput_(memoryMapInput),
         inputLoadersMax_(inputLoadersMax),
         coresMax_(coresMax),
         barcodeMetadataList_(barcodeMetadataList),
         bclFlowcellLayout_(bclFlowcellLayout),
         sortedReferenceMetadataList_(sortedReferenceMetadataList),
+        memoryGovernor_(memoryGovernor),
         flowcellTiles_(getTiles(bclFlowcellLayout)),
         maxTileClusterCount_(flowcell::getMaxTileClusters(flowcellTiles_)),
         undiscoveredTiles_(flowcellTiles_.begin()),
         threadBclReaders_(inputLoadersMax_,
             rta::BclReader(
                 ignoreMissingBcls_,
+                memoryMapInput_,
                 maxTileClusterCount_)),
         threads_(threads),
         longestBclPathLength_(
@@ -99,8 +104,10 @@ void BclSeedSource<KmerT>::initBuffers(
     flowcell::TileMetadataList &unprocessedTiles,
     const alignment::SeedMetadataList &seedMetadataList)
 {
+    // the loader of the previous pass must not hold on to its buffers while the new one is sized
+    seedLoader_.reset();
     seedLoader_.reset(new alignment::ParallelSeedLoader<rta::BclReader, KmerT>(
-        ignoreMissingBcls_, threads_, threadBclMappers_,
+        ignoreMissingBcls_, threads_, threadBclMappers_, memoryGovernor_,
         inputLoadersMax_, coresMax_, barcodeMetadataList_,
         bclFlowcellLayout_,
         seedMetadataList,
@@ -123,6 +130,12 @@ const std::vector<typename BclSeedSource<KmerT>::SeedIterator> &BclSeedSource<Km
     return seedLoader_->getReferenceSeedBounds();
 }
 
+template <typename KmerT>
+typename BclSeedSource<KmerT>::SeedIterator BclSeedSource<KmerT>::getRepeatSeedsEnd() const
+{
+    return seedLoader_->getRepeatSeedsEnd();
+}
+
 template <typename KmerT>
 flowcell::TileMetadataList BclSeedSource<KmerT>::getTiles(const flowcell::Layout &flowcellLayout) const
 {
@@ -174,6 +187,7 @@ BclBaseCallsSource::BclBaseCallsSource(
     const flowcell::TileMetadataList &tileMetadataList,
     const bool ignoreMissingBcls,
     const bool ignoreMissingFilters,
+    const bool memoryMapInput,
     common::ThreadVector &bclLoadThreads,
     const unsigned inputLoadersMax,
     const bool extractClusterXy):
@@ -181,15 +195,15 @@ BclBaseCallsSource::BclBaseCallsSource(
     bclLoadThreads_(bclLoadThreads),
     filterFilePath_(flowcell::getLongestAttribute<flowcell::Layout::Bcl, flowcell::FiltersFilePathAttributeTag>(flowcellLayoutList_)),
     positionsFilePath_(flowcell::getLongestAttribute<flowcell::Layout::Bcl, flowcell::PositionsFilePathAttributeTag>(flowcellLayoutList_)),
-    threadReaders_(bclLoadThreads_.size(), rta::BclReader(ignoreMissingBcls, flowcell::getMaxTileClusters(tileMetadataList))),
+    threadReaders_(bclLoadThreads_.size(), rta::BclReader(ignoreMissingBcls, memoryMapInput, flowcell::getMaxTileClusters(tileMetadataList))),
     bclMapper_(ignoreMissingBcls,
                flowcell::getMaxTotalReadLength(flowcellLayoutList_) + flowcell::getMaxBarcodeLength(flowcellLayoutList_),
                bclLoadThreads_, threadReaders_,
                inputLoadersMax, flowcell::getMaxTileClusters(tileMetadataList),
                flowcell::getLongestAttribute<flowcell::Layout::Bcl, flowcell::BclFilePathAttributeTag>(flowcellLayoutList_).string().size()),
-    filtersMapper_(ignoreMissingFilters),
-    clocsMapper_(),
-    locsMapper_()
+    filtersMapper_(ignoreMissingFilters, memoryMapInput),
+    clocsMapper_(memoryMapInput),
+    locsMapper_(memoryMapInput)
 {
     ISAAC_TRACE_STAT("SelectMatchesTransition::SelectMatchesTransitions before filtersMapper_.reserveBuffer ")
     filtersMapper_.reserveBuffers(filterFilePath_.string().size(), flowcell::getMaxTileClusters(tileMetadataList));
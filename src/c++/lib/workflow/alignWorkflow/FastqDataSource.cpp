@@ -206,6 +206,12 @@ const std::vector<typename FastqSeedSource<KmerT>::SeedIterator> &FastqSeedSourc
     return seedGenerator_->getReferenceSeedBounds();
 }
 
+template <typename KmerT>
+typename FastqSeedSource<KmerT>::SeedIterator FastqSeedSource<KmerT>::getRepeatSeedsEnd() const
+{
+    return seedGenerator_->getRepeatSeedsEnd();
+}
+
 /////////////// FastqBaseCallsSource implementation
 inline boost::filesystem::path getLongestFastqPath(const flowcell::FlowcellLayoutList &flowcellLayoutList)
 {
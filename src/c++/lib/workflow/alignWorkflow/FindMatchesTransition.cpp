@@ -17,12 +17,17 @@
  ** \author Roman Petrovski
  **/
 
+#include <algorithm>
+
+#include <boost/bind.hpp>
+
 #include "alignment/MatchFinder.hh"
 #include "alignment/SeedLoader.hh"
 #include "alignment/SeedMemoryManager.hh"
 #include "common/Debug.hh"
 #include "common/Exceptions.hh"
 #include "common/ParallelSort.hpp"
+#include "common/Profiling.hh"
 #include "demultiplexing/DemultiplexingStatsXml.hh"
 #include "flowcell/Layout.hh"
 #include "flowcell/ReadMetadata.hh"
@@ -46,8 +51,10 @@ FindMatchesTransition::FindMatchesTransition(
     const bool allowVariableFastqLength,
     const bool cleanupIntermediary,
     const bool ignoreMissingBcls,
+    const bool memoryMapInput,
     const unsigned firstPassSeeds,
-    const unsigned long availableMemory,
+    const unsigned seedIterations,
+    common::MemoryGovernor &memoryGovernor,
     const unsigned clustersAtATimeMax,
     const bfs::path &tempDirectory,
     const bfs::path &demultiplexingStatsXmlPath,
@@ -60,7 +67,8 @@ FindMatchesTransition::FindMatchesTransition(
     const unsigned tempSaversMax,
     const common::ScoopedMallocBlock::Mode memoryControl,
     const std::vector<size_t> &clusterIdList,
-    const reference::SortedReferenceMetadataList &sortedReferenceMetadataList
+    const reference::SortedReferenceMetadataList &sortedReferenceMetadataList,
+    const bool tileCheckpoints
     )
     : flowcellLayoutList_(flowcellLayoutList)
     , tempDirectory_(tempDirectory)
@@ -72,8 +80,10 @@ FindMatchesTransition::FindMatchesTransition(
     , allowVariableFastqLength_(allowVariableFastqLength)
     , cleanupIntermediary_(cleanupIntermediary)
     , ignoreMissingBcls_(ignoreMissingBcls)
+    , memoryMapInput_(memoryMapInput)
     , firstPassSeeds_(firstPassSeeds)
-    , availableMemory_(availableMemory)
+    , seedIterations_(seedIterations)
+    , memoryGovernor_(memoryGovernor)
     , clustersAtATimeMax_(clustersAtATimeMax)
     , ignoreNeighbors_(ignoreNeighbors)
     , ignoreRepeats_(ignoreRepeats)
@@ -82,6 +92,7 @@ FindMatchesTransition::FindMatchesTransition(
     , memoryControl_(memoryControl)
     , clusterIdList_(clusterIdList)
     , sortedReferenceMetadataList_(sortedReferenceMetadataList)
+    , tileCheckpoints_(tileCheckpoints)
     // Have thread pool for the maximum number of threads we may potentially need.
     , threads_(std::max(inputLoadersMax_, std::max(coresMax_, tempSaversMax_)))
 {
@@ -89,24 +100,10 @@ FindMatchesTransition::FindMatchesTransition(
 
 std::vector<std::vector<unsigned> > FindMatchesTransition::getSeedIndexListPerIteration(const flowcell::Layout &flowcell) const
 {
-    std::vector<std::vector<unsigned> >seedIndexListPerIteration(maxIterations_); // assume two iterations
-    std::vector<unsigned> countsPerRead(flowcell.getReadMetadataList().size(), 0);
-    BOOST_FOREACH(const alignment::SeedMetadata &seedMetadata, flowcell.getSeedMetadataList())
-    {
-        assert(countsPerRead.size() > seedMetadata.getReadIndex());
-        // allocate the first seed of each read to the first iteration, and all
-        // subsequent seeds of the read to the second iteration
-        const unsigned iteration = (firstPassSeeds_ > countsPerRead[seedMetadata.getReadIndex()]) ? 0 : 1;
-        seedIndexListPerIteration[iteration].push_back(seedMetadata.getIndex());
-        ++countsPerRead[seedMetadata.getReadIndex()];
-    }
-    // trim iterations without any seeds
-    while (!seedIndexListPerIteration.empty() && seedIndexListPerIteration.back().empty())
-    {
-        seedIndexListPerIteration.resize(seedIndexListPerIteration.size() - 1);
-    }
-    return seedIndexListPerIteration;
+    return alignment::getSeedIndexListPerIteration(
+        flowcell.getReadMetadataList(), flowcell.getSeedMetadataList(), firstPassSeeds_, seedIterations_);
 }
+
 static const unsigned standardOpenFileHandlesCount(3); // cin, cout, cerr
 
 void FindMatchesTransition::resolveBarcodes(
@@ -144,7 +141,7 @@ void FindMatchesTransition::resolveBarcodes(
         while (!unprocessedTiles.empty())
         {
             currentTiles.clear();
-            if (!demultiplexing::BarcodeMemoryManager::selectTiles(unprocessedTiles, currentTiles))
+            if (!demultiplexing::BarcodeMemoryManager::selectTiles(memoryGovernor_, unprocessedTiles, currentTiles))
             {
                 BOOST_THROW_EXCEPTION(common::MemoryException("Insufficient memory to load barcodes even for just one tile: " +
                     boost::lexical_cast<std::string>(unprocessedTiles.back())));
@@ -199,7 +196,7 @@ flowcell::TileMetadataList FindMatchesTransition::findSingleSeedMatches(
 
     alignment::MatchFinder<KmerT> matchFinder(sortedReferenceMetadataList_, tempDirectory_,
                             unprocessedTiles, flowcell.getReadMetadataList(), flowcell.getSeedMetadataList(),
-                            0,
+                            0, false,
                             ignoreNeighbors_, ignoreRepeats_,
                             repeatThreshold_, neighborhoodSizeThreshold_,
                             foundMatches.matchTally_, tileClusterInfo, threads_, coresMax_, tempSaversMax_,
@@ -210,7 +207,7 @@ flowcell::TileMetadataList FindMatchesTransition::findSingleSeedMatches(
     seedSource.initBuffers(unprocessedTiles, seedMetadataList);
 
     alignment::SeedMemoryManager<KmerT> seedMemoryManager(
-        barcodeMetadataList_, flowcell.getReadMetadataList(), seedMetadataList, unprocessedTiles);
+        memoryGovernor_, barcodeMetadataList_, flowcell.getReadMetadataList(), seedMetadataList, unprocessedTiles);
 
     if (!seedMemoryManager.selectTiles(
         unprocessedTiles, tileClusterInfo, matchFinder.getMaxTileCount(), tempSaversMax_, currentTiles))
@@ -224,8 +221,13 @@ flowcell::TileMetadataList FindMatchesTransition::findSingleSeedMatches(
         seedMemoryManager.allocate(currentTiles, seeds);
 
         common::ScoopedMallocBlock  mallocBlock(memoryControl_);
-        seedSource.generateSeeds(currentTiles, tileClusterInfo, seeds, mallocBlock);
+        {
+            common::ScopedStageTimer timer(common::Profiler::FindMatchesGenerateSeeds);
+            seedSource.generateSeeds(currentTiles, tileClusterInfo, seeds, mallocBlock);
+            timer.addItems(seedSource.getReferenceSeedBounds().back() - seeds.begin());
+        }
         matchFinder.setTiles(currentTiles);
+        matchFinder.storeRepeatMatches(seedSource.getReferenceSeedBounds().back(), seedSource.getRepeatSeedsEnd());
 
         ISAAC_THREAD_CERR << "Finding Exact single-seed matches for " << seedMetadataList << "with repeat threshold: " <<
             repeatThreshold_ << std::endl;
@@ -264,32 +266,38 @@ void FindMatchesTransition::maskCompleteReadSeeds(
     SeedIterator referenceSeedsBegin = seeds.begin();
     BOOST_FOREACH(SeedIterator referenceSeedsEnd, referenceSeedBounds)
     {
-        ISAAC_THREAD_CERR << "Masking " << std::distance(referenceSeedsBegin, referenceSeedsEnd) << " seeds" << std::endl;
-        const clock_t startMask = clock();
-        unsigned long masked = 0;
-        BOOST_FOREACH(SeedT &seed, std::make_pair(referenceSeedsBegin, referenceSeedsEnd))
         {
-            if (!seed.isNSeed() &&
-                clusterInfo.isReadComplete(seed.getTile(), seed.getCluster(),
-                                           allSeedMetadataList.at(seed.getSeedIndex()).getReadIndex()))
+            ISAAC_THREAD_CERR << "Masking " << std::distance(referenceSeedsBegin, referenceSeedsEnd) << " seeds" << std::endl;
+            common::ScopedStageTimer maskTimer(common::Profiler::FindMatchesMaskSeeds);
+            maskTimer.addItems(std::distance(referenceSeedsBegin, referenceSeedsEnd));
+            unsigned long masked = 0;
+            BOOST_FOREACH(SeedT &seed, std::make_pair(referenceSeedsBegin, referenceSeedsEnd))
             {
-                // dont' set them to be lowest n-seeds as lowest n-seeds get no-matches stored for them
-                seed.makeNSeed(false);
-                ++masked;
+                if (!seed.isNSeed() &&
+                    clusterInfo.isReadComplete(seed.getTile(), seed.getCluster(),
+                                               allSeedMetadataList.at(seed.getSeedIndex()).getReadIndex()))
+                {
+                    // dont' set them to be lowest n-seeds as lowest n-seeds get no-matches stored for them
+                    seed.makeNSeed(false);
+                    ++masked;
+                }
             }
+            ISAAC_THREAD_CERR << "Masking " << std::distance(referenceSeedsBegin, referenceSeedsEnd) <<
+                " seeds done (" << masked <<
+                " masked) in " << maskTimer.getWallMs() << "ms" << std::endl;
         }
-        ISAAC_THREAD_CERR << "Masking " << std::distance(referenceSeedsBegin, referenceSeedsEnd) <<
-            " seeds done (" << masked <<
-            " masked) in " << (clock() - startMask) / 1000 << "ms" << std::endl;
 
-        ISAAC_THREAD_CERR << "Sorting " << std::distance(referenceSeedsBegin, referenceSeedsEnd) << " seeds" << std::endl;
-        const clock_t startSort = clock();
         {
-            common::ScoopedMallocBlockUnblock unblock(mallocBlock);
-            // comparing the full kmer is required to push the N-seeds off to the very end.
-            common::parallelSort(referenceSeedsBegin, referenceSeedsEnd, &alignment::orderByKmerSeedIndex<KmerT>, threads_, coresMax_);
+            ISAAC_THREAD_CERR << "Sorting " << std::distance(referenceSeedsBegin, referenceSeedsEnd) << " seeds" << std::endl;
+            common::ScopedStageTimer sortTimer(common::Profiler::FindMatchesSortSeeds);
+            sortTimer.addItems(std::distance(referenceSeedsBegin, referenceSeedsEnd));
+            {
+                common::ScoopedMallocBlockUnblock unblock(mallocBlock);
+                // comparing the full kmer is required to push the N-seeds off to the very end.
+                common::parallelSort(referenceSeedsBegin, referenceSeedsEnd, &alignment::orderByKmerSeedIndex<KmerT>, threads_, coresMax_);
+            }
+            ISAAC_THREAD_CERR << "Sorting " << std::distance(referenceSeedsBegin, referenceSeedsEnd) << " seeds done in " << sortTimer.getWallMs() << "ms" << std::endl;
         }
-        ISAAC_THREAD_CERR << "Sorting " << std::distance(referenceSeedsBegin, referenceSeedsEnd) << " seeds done in " << (clock() - startSort) / 1000 << "ms" << std::endl;
         referenceSeedsBegin = referenceSeedsEnd;
     }
 
@@ -302,6 +310,9 @@ void FindMatchesTransition::maskCompleteReadSeeds(
 /**
  * \brief Performs multiple passes If all seeds for unprocessed tiles don't fit in memory.
  *
+ * \param lastIteration    Intermediate iterations only look for exact matches and don't close the
+ *                         reads that hit repeats, so that the subsequent iterations still get to see them.
+ *                         The last iteration completes repeat reads and performs the neighbor search.
  * \param unprocessedTiles [inout] All tiles are removed from the list upon return
  * \param tileClusterInfo  [in]   Cluster reads marked as complete are skipped.
  * \param foundMatches     [inout] Updated upon return.
@@ -310,6 +321,8 @@ void FindMatchesTransition::maskCompleteReadSeeds(
 template <typename KmerT>
 void FindMatchesTransition::findMultiSeedMatches(
     const flowcell::Layout &flowcell,
+    const unsigned iteration,
+    const bool lastIteration,
     const std::vector<unsigned> &seedIndexList,
     flowcell::TileMetadataList &unprocessedTiles,
     alignment::matchFinder::TileClusterInfo &tileClusterInfo,
@@ -328,7 +341,7 @@ void FindMatchesTransition::findMultiSeedMatches(
 
     alignment::MatchFinder<KmerT> matchFinder(sortedReferenceMetadataList_, tempDirectory_,
                             unprocessedTiles, flowcell.getReadMetadataList(), flowcell.getSeedMetadataList(),
-                            1,
+                            iteration, lastIteration,
                             ignoreNeighbors_, ignoreRepeats_,
                             repeatThreshold_, neighborhoodSizeThreshold_,
                             foundMatches.matchTally_, tileClusterInfo, threads_, coresMax_, tempSaversMax_,
@@ -339,7 +352,7 @@ void FindMatchesTransition::findMultiSeedMatches(
     seedSource.initBuffers(unprocessedTiles, seedMetadataList);
 
     alignment::SeedMemoryManager<KmerT> seedMemoryManager(
-        barcodeMetadataList_, flowcell.getReadMetadataList(), seedMetadataList, unprocessedTiles);
+        memoryGovernor_, barcodeMetadataList_, flowcell.getReadMetadataList(), seedMetadataList, unprocessedTiles);
 
     while(!unprocessedTiles.empty())
     {
@@ -354,24 +367,39 @@ void FindMatchesTransition::findMultiSeedMatches(
             seedMemoryManager.allocate(currentTiles, seeds);
 
             common::ScoopedMallocBlock  mallocBlock(memoryControl_);
-            seedSource.generateSeeds(currentTiles, tileClusterInfo, seeds, mallocBlock);
+            {
+                common::ScopedStageTimer timer(common::Profiler::FindMatchesGenerateSeeds);
+                seedSource.generateSeeds(currentTiles, tileClusterInfo, seeds, mallocBlock);
+                timer.addItems(seedSource.getReferenceSeedBounds().back() - seeds.begin());
+            }
             matchFinder.setTiles(currentTiles);
+            matchFinder.storeRepeatMatches(seedSource.getReferenceSeedBounds().back(), seedSource.getRepeatSeedsEnd());
 
             ISAAC_THREAD_CERR << "Finding Exact multi-seed matches for " << seedMetadataList << " with repeat threshold: " <<
                 repeatThreshold_ << std::endl;
             foundMatches.matchDistribution_.consolidate(
-                matchFinder.findMatches(seeds.begin(), seedSource.getReferenceSeedBounds(), false, !neighborhoodSizeThreshold_));
+                matchFinder.findMatches(seeds.begin(), seedSource.getReferenceSeedBounds(), false,
+                                        lastIteration && !neighborhoodSizeThreshold_));
             ISAAC_THREAD_CERR << "Finding Exact multi-seed matches done for " << seedMetadataList << std::endl;
 
-            if (neighborhoodSizeThreshold_)
+            if (lastIteration && neighborhoodSizeThreshold_)
             {
                 ISAAC_THREAD_CERR << "Finding Neighbor multi-seed matches for " << seedMetadataList << " with repeat threshold: " <<
                     repeatThreshold_ << std::endl;
+                // the neighbor search must see the same seeds as the exact one. Put the separated repeat seeds
+                // back into the ranges of their references
+                std::vector<typename std::vector<alignment::Seed<KmerT> >::iterator> neighborSeedBounds;
+                {
+                    common::ScoopedMallocBlockUnblock unblock(mallocBlock);
+                    neighborSeedBounds = seedSource.getReferenceSeedBounds();
+                }
+                alignment::mergeRepeatSeeds<KmerT>(
+                    barcodeMetadataList_, seedSource.getRepeatSeedsEnd(), neighborSeedBounds);
                 maskCompleteReadSeeds(
                     flowcell.getSeedMetadataList(), tileClusterInfo, seeds,
-                    seedSource.getReferenceSeedBounds(), mallocBlock);
+                    neighborSeedBounds, mallocBlock);
                 foundMatches.matchDistribution_.consolidate(
-                    matchFinder.findMatches(seeds.begin(), seedSource.getReferenceSeedBounds(), true, true));
+                    matchFinder.findMatches(seeds.begin(), neighborSeedBounds, true, true));
                 ISAAC_THREAD_CERR << "Finding Neighbor multi-seed matches done for " << seedMetadataList << std::endl;
             }
             std::vector<alignment::Seed<KmerT> >().swap(seeds);
@@ -395,6 +423,7 @@ void FindMatchesTransition::findLaneMatches(
     flowcell::TileMetadataList &unprocessedTiles,
     DataSourceT &dataSource,
     demultiplexing::DemultiplexingStats &demultiplexingStats,
+    MatchFinderCheckpoint &checkpoint,
     FoundMatchesMetadata &foundMatches)
 {
     if (!unprocessedTiles.empty())
@@ -407,6 +436,19 @@ void FindMatchesTransition::findLaneMatches(
             unprocessedTiles, tileClusterInfo, demultiplexingStats);
         ISAAC_THREAD_CERR << "Resolving barcodes done for " << flowcell << " lane " << lane << std::endl;
 
+        // barcodes are resolved for all tiles to get the complete demultiplexing statistics. Matches of the
+        // checkpointed tiles are already stored.
+        const std::size_t laneTilesCount = unprocessedTiles.size();
+        unprocessedTiles.erase(
+            std::remove_if(unprocessedTiles.begin(), unprocessedTiles.end(),
+                           boost::bind(&isCheckpointedTile, boost::cref(checkpoint.completeTiles_), _1)),
+            unprocessedTiles.end());
+        if (laneTilesCount != unprocessedTiles.size())
+        {
+            ISAAC_THREAD_CERR << "Skipping " << laneTilesCount - unprocessedTiles.size() <<
+                " checkpointed tiles of " << flowcell << " lane " << lane << std::endl;
+        }
+
         const std::vector<std::vector<unsigned> > seedIndexListPerIteration = getSeedIndexListPerIteration(flowcell);
 
         while(!unprocessedTiles.empty())
@@ -416,16 +458,66 @@ void FindMatchesTransition::findLaneMatches(
                 unprocessedTiles, tileClusterInfo, dataSource, demultiplexingStats,
                 foundMatches);
 
-            if (1 != seedIndexListPerIteration.size())
+            for (unsigned iteration = 1; seedIndexListPerIteration.size() > iteration; ++iteration)
             {
-                ISAAC_ASSERT_MSG(2 == seedIndexListPerIteration.size(), "2 sets of seeds expected");
-                findMultiSeedMatches(flowcell, seedIndexListPerIteration.at(1), thisPassTiles, tileClusterInfo, dataSource, foundMatches);
-                ISAAC_ASSERT_MSG(thisPassTiles.empty(), "Expected the findMultiSeedMatches to empty the list");
+                // findMultiSeedMatches consumes the list, each iteration needs to go over the same tiles
+                flowcell::TileMetadataList iterationTiles = thisPassTiles;
+                findMultiSeedMatches(
+                    flowcell, iteration, seedIndexListPerIteration.size() == iteration + 1,
+                    seedIndexListPerIteration.at(iteration), iterationTiles, tileClusterInfo, dataSource, foundMatches);
+                ISAAC_ASSERT_MSG(iterationTiles.empty(), "Expected the findMultiSeedMatches to empty the list");
+            }
+
+            if (tileCheckpoints_)
+            {
+                saveTileCheckpoint(thisPassTiles, foundMatches, checkpoint);
             }
         }
     }
 }
 
+/**
+ * \brief Restores the matches of the tiles that have been completed by the interrupted run
+ */
+void FindMatchesTransition::resumeFromCheckpoint(
+    MatchFinderCheckpoint &checkpoint,
+    FoundMatchesMetadata &foundMatches) const
+{
+    if (!loadCheckpoint(MatchFinderCheckpoint::getPath(tempDirectory_), checkpoint))
+    {
+        return;
+    }
+
+    const alignment::MatchDistribution &matchDistribution = checkpoint.foundMatches_.matchDistribution_;
+    bool sameGeometry = foundMatches.matchDistribution_.size() == matchDistribution.size();
+    for (std::size_t contig = 0; sameGeometry && matchDistribution.size() > contig; ++contig)
+    {
+        sameGeometry = foundMatches.matchDistribution_[contig].size() == matchDistribution[contig].size();
+    }
+    if (!sameGeometry)
+    {
+        ISAAC_THREAD_CERR << "WARNING: Ignoring the match finder checkpoint made with a different reference" << std::endl;
+        checkpoint.completeTiles_.clear();
+        return;
+    }
+
+    foundMatches.matchDistribution_.consolidate(matchDistribution);
+    ISAAC_THREAD_CERR << "Resuming match finding with " << checkpoint.completeTiles_.size() << " checkpointed tiles" << std::endl;
+}
+
+void FindMatchesTransition::saveTileCheckpoint(
+    const flowcell::TileMetadataList &completeTiles,
+    const FoundMatchesMetadata &foundMatches,
+    MatchFinderCheckpoint &checkpoint) const
+{
+    checkpoint.completeTiles_.insert(checkpoint.completeTiles_.end(), completeTiles.begin(), completeTiles.end());
+    checkpoint.foundMatches_.tileMetadataList_ = foundMatches.tileMetadataList_;
+    checkpoint.foundMatches_.matchTally_ = foundMatches.matchTally_;
+    checkpoint.foundMatches_.matchDistribution_ = foundMatches.matchDistribution_;
+    saveCheckpoint(MatchFinderCheckpoint::getPath(tempDirectory_), checkpoint);
+    ISAAC_THREAD_CERR << "Checkpointed " << checkpoint.completeTiles_.size() << " tiles" << std::endl;
+}
+
 inline bool orderByFlowcellLaneTile(const flowcell::TileMetadata& left, const flowcell::TileMetadata& right)
 {
     return left.getFlowcellId() < right.getFlowcellId() ||
@@ -510,6 +602,7 @@ void FindMatchesTransition::processFlowcellTiles(
     const flowcell::Layout& flowcell,
     DataSourceT &dataSource,
     demultiplexing::DemultiplexingStats &demultiplexingStats,
+    MatchFinderCheckpoint &checkpoint,
     FoundMatchesMetadata &foundMatches)
 {
     TileSource &tileSource = dataSource;
@@ -529,8 +622,13 @@ void FindMatchesTransition::processFlowcellTiles(
                 foundMatches.addTile(tileMetadata);
                 // this fixes the tile index to be correct in the context of the global tile list.
                 tileMetadata = foundMatches.tileMetadataList_.back();
+                if (isCheckpointedTile(checkpoint.completeTiles_, tileMetadata))
+                {
+                    foundMatches.matchTally_.restoreTile(
+                        tileMetadata, checkpoint.foundMatches_.matchTally_.getFileTallyList(tileMetadata));
+                }
             }
-            findLaneMatches(flowcell, lane, laneBarcodes, laneTiles, dataSource, demultiplexingStats, foundMatches);
+            findLaneMatches(flowcell, lane, laneBarcodes, laneTiles, dataSource, demultiplexingStats, checkpoint, foundMatches);
         }
     }
 }
@@ -538,56 +636,63 @@ void FindMatchesTransition::processFlowcellTiles(
 template <typename KmerT>
 void FindMatchesTransition::perform(FoundMatchesMetadata &foundMatches)
 {
-    FoundMatchesMetadata ret(tempDirectory_, barcodeMetadataList_, maxIterations_, sortedReferenceMetadataList_);
+    FoundMatchesMetadata ret(tempDirectory_, barcodeMetadataList_, seedIterations_, sortedReferenceMetadataList_);
     demultiplexing::DemultiplexingStats demultiplexingStats(flowcellLayoutList_, barcodeMetadataList_);
+    MatchFinderCheckpoint checkpoint(tempDirectory_, barcodeMetadataList_, seedIterations_, sortedReferenceMetadataList_);
+    if (tileCheckpoints_)
+    {
+        resumeFromCheckpoint(checkpoint, ret);
+    }
 
     BOOST_FOREACH(const flowcell::Layout& flowcell, flowcellLayoutList_)
     {
+        // data sources size their cluster buffers from what is left after the previous flowcell
+        memoryGovernor_.measure();
         switch (flowcell.getFormat())
         {
             case flowcell::Layout::Bam:
             {
                 BamSeedSource<KmerT> dataSource(
                     tempDirectory_,
-                    availableMemory_,
+                    memoryGovernor_.getAvailable(),
                     clustersAtATimeMax_,
                     cleanupIntermediary_,
                     coresMax_, barcodeMetadataList_,
                     sortedReferenceMetadataList_, flowcell, threads_);
-                processFlowcellTiles(flowcell, dataSource, demultiplexingStats, ret);
+                processFlowcellTiles(flowcell, dataSource, demultiplexingStats, checkpoint, ret);
                 break;
             }
 
             case flowcell::Layout::Fastq:
             {
                 FastqSeedSource<KmerT> dataSource(
-                    availableMemory_,
+                    memoryGovernor_.getAvailable(),
                     clustersAtATimeMax_,
                     allowVariableFastqLength_,
                     coresMax_, barcodeMetadataList_,
                     sortedReferenceMetadataList_, flowcell, threads_);
-                processFlowcellTiles(flowcell, dataSource, demultiplexingStats, ret);
+                processFlowcellTiles(flowcell, dataSource, demultiplexingStats, checkpoint, ret);
                 break;
             }
 
             case flowcell::Layout::Bcl:
             {
                 BclSeedSource<KmerT> dataSource(
-                    ignoreMissingBcls_,
+                    ignoreMissingBcls_, memoryMapInput_,
                     inputLoadersMax_, coresMax_, barcodeMetadataList_,
                     sortedReferenceMetadataList_, flowcell,
-                    threads_);
-                processFlowcellTiles(flowcell, dataSource, demultiplexingStats, ret);
+                    memoryGovernor_, threads_);
+                processFlowcellTiles(flowcell, dataSource, demultiplexingStats, checkpoint, ret);
                 break;
             }
             case flowcell::Layout::BclBgzf:
             {
                 BclBgzfSeedSource<KmerT> dataSource(
-                    ignoreMissingBcls_,
+                    ignoreMissingBcls_, memoryMapInput_,
                     inputLoadersMax_, coresMax_, barcodeMetadataList_,
                     sortedReferenceMetadataList_, flowcell,
-                    threads_);
-                processFlowcellTiles(flowcell, dataSource, demultiplexingStats, ret);
+                    memoryGovernor_, threads_);
+                processFlowcellTiles(flowcell, dataSource, demultiplexingStats, checkpoint, ret);
                 break;
             }
 
@@ -601,6 +706,10 @@ void FindMatchesTransition::perform(FoundMatchesMetadata &foundMatches)
 
     dumpStats(demultiplexingStats, ret.tileMetadataList_);
     foundMatches.swap(ret);
+    if (tileCheckpoints_)
+    {
+        removeCheckpoint(MatchFinderCheckpoint::getPath(tempDirectory_));
+    }
 }
 
 void FindMatchesTransition::dumpStats(
@@ -0,0 +1,436 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file GatherTransition.cpp
+ **
+ ** \brief Merges the results of several runs that have aligned disjoint subsets of tiles.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include <cerrno>
+#include <fstream>
+#include <set>
+
+#include <boost/assign.hpp>
+#include <boost/foreach.hpp>
+#include <boost/format.hpp>
+#include <boost/property_tree/xml_parser.hpp>
+
+#include "alignment/matchSelector/BinningFragmentStorage.hh"
+#include "common/Debug.hh"
+#include "common/Exceptions.hh"
+#include "common/Threads.hpp"
+#include "io/Fragment.hh"
+#include "workflow/AlignWorkflowSerialization.hh"
+#include "workflow/alignWorkflow/GatherTransition.hh"
+
+namespace isaac
+{
+namespace workflow
+{
+namespace alignWorkflow
+{
+
+namespace bfs = boost::filesystem;
+namespace bpt = boost::property_tree;
+
+namespace
+{
+
+bool isXmlLeaf(const bpt::ptree &element)
+{
+    return element.empty() || (1 == element.size() && "<xmlattr>" == element.begin()->first);
+}
+
+/**
+ * \return attributes that identify the element. Additive attributes carry counts and don't identify anything.
+ */
+bpt::ptree getXmlIdentity(const bpt::ptree &element, const std::set<std::string> &additive)
+{
+    bpt::ptree ret;
+    const boost::optional<const bpt::ptree &> attributes = element.get_child_optional("<xmlattr>");
+    if (attributes)
+    {
+        BOOST_FOREACH(const bpt::ptree::value_type &attribute, *attributes)
+        {
+            if (!additive.count(attribute.first))
+            {
+                ret.push_back(attribute);
+            }
+        }
+    }
+    return ret;
+}
+
+/**
+ * \brief Elements that have the same name and identifying attributes are merged. Contents and attributes listed
+ *        in additive are summed up. Other leaf values are kept from the first file that has them.
+ */
+void mergeXmlElements(const bpt::ptree &from, bpt::ptree &to, const std::set<std::string> &additive)
+{
+    BOOST_FOREACH(const bpt::ptree::value_type &child, from)
+    {
+        if ("<xmlattr>" == child.first)
+        {
+            continue;
+        }
+        const bpt::ptree identity = getXmlIdentity(child.second, additive);
+        bpt::ptree::assoc_iterator match = to.not_found();
+        for (std::pair<bpt::ptree::assoc_iterator, bpt::ptree::assoc_iterator> candidates = to.equal_range(child.first);
+            candidates.second != candidates.first; ++candidates.first)
+        {
+            if (identity == getXmlIdentity(candidates.first->second, additive))
+            {
+                match = candidates.first;
+                break;
+            }
+        }
+
+        if (to.not_found() == match)
+        {
+            to.push_back(child);
+        }
+        else if (!isXmlLeaf(child.second))
+        {
+            mergeXmlElements(child.second, match->second, additive);
+        }
+        else
+        {
+            if (additive.count(child.first))
+            {
+                match->second.put_value(match->second.get_value<unsigned long>() + child.second.get_value<unsigned long>());
+            }
+            const boost::optional<const bpt::ptree &> attributes = child.second.get_child_optional("<xmlattr>");
+            if (attributes)
+            {
+                BOOST_FOREACH(const bpt::ptree::value_type &attribute, *attributes)
+                {
+                    if (additive.count(attribute.first))
+                    {
+                        const std::string path = "<xmlattr>." + attribute.first;
+                        match->second.put(path, match->second.get<unsigned long>(path) + attribute.second.get_value<unsigned long>());
+                    }
+                }
+            }
+        }
+    }
+}
+
+void mergeStatsXml(
+    const std::vector<bfs::path> &sourcePathList,
+    const bfs::path &targetPath,
+    const std::set<std::string> &additive)
+{
+    ISAAC_THREAD_CERR << "Merging statistics into " << targetPath << std::endl;
+    bpt::ptree merged;
+    BOOST_FOREACH(const bfs::path &sourcePath, sourcePathList)
+    {
+        if (!bfs::exists(sourcePath))
+        {
+            ISAAC_THREAD_CERR << "WARNING: Statistics file is missing: " << sourcePath << std::endl;
+            continue;
+        }
+        bpt::ptree tree;
+        bpt::read_xml(sourcePath.string(), tree, bpt::xml_parser::trim_whitespace);
+        mergeXmlElements(tree, merged, additive);
+    }
+
+    std::ofstream os(targetPath.string().c_str());
+    if (!os)
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to open file for writing: " + targetPath.string()));
+    }
+    bpt::write_xml(os, merged, bpt::xml_writer_make_settings(' ', 2));
+    if (!os)
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to write statistics into " + targetPath.string()));
+    }
+    ISAAC_THREAD_CERR << "Merging statistics done into " << targetPath << std::endl;
+}
+
+} // namespace
+
+GatherTransition::GatherTransition(
+    const flowcell::BarcodeMetadataList &barcodeMetadataList,
+    const reference::SortedReferenceMetadataList &sortedReferenceMetadataList,
+    const unsigned seedIterations,
+    const bool preSortBins,
+    const unsigned threads,
+    const bfs::path &tempDirectory)
+    : barcodeMetadataList_(barcodeMetadataList)
+    , sortedReferenceMetadataList_(sortedReferenceMetadataList)
+    , seedIterations_(seedIterations)
+    , preSortBins_(preSortBins)
+    , threads_(threads)
+    , tempDirectory_(tempDirectory)
+{
+}
+
+void GatherTransition::gatherTiles(
+    const boost::ptr_vector<ScatterRun> &scatterRuns,
+    FoundMatchesMetadata &foundMatches,
+    std::vector<unsigned> &tileIndexOffsets) const
+{
+    BOOST_FOREACH(const ScatterRun &scatterRun, scatterRuns)
+    {
+        tileIndexOffsets.push_back(foundMatches.tileMetadataList_.size());
+        BOOST_FOREACH(const flowcell::TileMetadata &tile, scatterRun.foundMatchesMetadata_.tileMetadataList_)
+        {
+            ISAAC_ASSERT_MSG(tile.getIndex() + tileIndexOffsets.back() == foundMatches.tileMetadataList_.size(),
+                             "Expected tile indexes to match tile positions " << tile);
+            BOOST_FOREACH(const flowcell::TileMetadata &gatheredTile, foundMatches.tileMetadataList_)
+            {
+                if (gatheredTile.getFlowcellIndex() == tile.getFlowcellIndex() &&
+                    gatheredTile.getLane() == tile.getLane() && gatheredTile.getTile() == tile.getTile())
+                {
+                    BOOST_THROW_EXCEPTION(common::PreConditionException(
+                        (boost::format("Tile is aligned by more than one of the gathered runs: %s") % tile).str()));
+                }
+            }
+            foundMatches.addTile(tile);
+        }
+
+        const alignment::MatchDistribution &matchDistribution = scatterRun.foundMatchesMetadata_.matchDistribution_;
+        bool sameGeometry = foundMatches.matchDistribution_.size() == matchDistribution.size();
+        for (std::size_t contig = 0; sameGeometry && matchDistribution.size() > contig; ++contig)
+        {
+            sameGeometry = foundMatches.matchDistribution_[contig].size() == matchDistribution[contig].size();
+        }
+        if (!sameGeometry)
+        {
+            BOOST_THROW_EXCEPTION(common::PreConditionException(
+                "The gathered runs must use the same --reference-genome as the gathering one"));
+        }
+        foundMatches.matchDistribution_.consolidate(matchDistribution);
+    }
+}
+
+/**
+ * \brief Template length statistics are not additive. For each barcode, take the ones of the run that
+ *        has stored the most fragments of the barcode.
+ */
+void GatherTransition::gatherTemplateLengthStatistics(
+    const boost::ptr_vector<ScatterRun> &scatterRuns,
+    std::vector<alignment::TemplateLengthStatistics> &barcodeTemplateLengthStatistics) const
+{
+    barcodeTemplateLengthStatistics.clear();
+    barcodeTemplateLengthStatistics.resize(barcodeMetadataList_.size());
+    BOOST_FOREACH(const flowcell::BarcodeMetadata &barcode, barcodeMetadataList_)
+    {
+        unsigned long mostElements = 0;
+        BOOST_FOREACH(const ScatterRun &scatterRun, scatterRuns)
+        {
+            unsigned long elements = 0;
+            BOOST_FOREACH(const alignment::BinMetadata &bin, scatterRun.selectedMatchesMetadata_)
+            {
+                elements += bin.getBarcodeElements(barcode.getIndex());
+            }
+            if (&scatterRun == &scatterRuns.front() || mostElements < elements)
+            {
+                mostElements = elements;
+                barcodeTemplateLengthStatistics.at(barcode.getIndex()) =
+                    scatterRun.barcodeTemplateLengthStatistics_.at(barcode.getIndex());
+            }
+        }
+    }
+}
+
+alignment::BinMetadataList GatherTransition::makeGatheredBins(
+    const boost::ptr_vector<ScatterRun> &scatterRuns,
+    const flowcell::TileMetadataList &tileMetadataList) const
+{
+    const alignment::BinMetadataList &layout = scatterRuns.front().selectedMatchesMetadata_;
+    BOOST_FOREACH(const ScatterRun &scatterRun, scatterRuns)
+    {
+        const alignment::BinMetadataList &bins = scatterRun.selectedMatchesMetadata_;
+        bool sameLayout = layout.size() == bins.size();
+        for (std::size_t i = 0; sameLayout && bins.size() > i; ++i)
+        {
+            sameLayout = layout[i].isUnalignedBin() == bins[i].isUnalignedBin() &&
+                (bins[i].isUnalignedBin() ||
+                    (layout[i].getBinStart() == bins[i].getBinStart() && layout[i].getLength() == bins[i].getLength()));
+        }
+        if (!sameLayout)
+        {
+            BOOST_THROW_EXCEPTION(common::PreConditionException(
+                "The gathered runs have different bin layouts. Make sure they all use the same --scatter-bin-length"));
+        }
+    }
+
+    const unsigned long maxTileReads =
+        flowcell::getMaxTileClusters(tileMetadataList) * alignment::matchSelector::BinningFragmentStorage::READS_MAX;
+    alignment::BinMetadataList ret;
+    ret.reserve(layout.size());
+    BOOST_FOREACH(const alignment::BinMetadata &bin, layout)
+    {
+        ret.push_back(
+            alignment::BinMetadata(
+                barcodeMetadataList_.size(),
+                bin.getIndex(),
+                bin.getBinStart(),
+                // the unaligned bin is keyed by the read number in the gathered tile list
+                bin.isUnalignedBin() ? maxTileReads * tileMetadataList.size() : bin.getLength(),
+                tempDirectory_ / bin.getPath().filename(),
+                // same chunking as the match selector uses
+                preSortBins_ ? 1024 : 0));
+    }
+    return ret;
+}
+
+void GatherTransition::gatherBin(
+    const boost::ptr_vector<ScatterRun> &scatterRuns,
+    const std::vector<unsigned> &tileIndexOffsets,
+    const unsigned long maxTileReads,
+    alignment::BinMetadata &bin) const
+{
+    std::ofstream os(bin.getPath().c_str(), std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+    if (!os)
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to open bin file " + bin.getPathString()));
+    }
+
+    std::vector<char> data;
+    for (std::size_t run = 0; scatterRuns.size() != run; ++run)
+    {
+        const ScatterRun &scatterRun = scatterRuns.at(run);
+        const unsigned tileIndexOffset = tileIndexOffsets.at(run);
+        const alignment::BinMetadata &scatterBin = scatterRun.selectedMatchesMetadata_.at(bin.getIndex());
+        if (scatterBin.isEmpty())
+        {
+            continue;
+        }
+
+        std::ifstream is(scatterBin.getPath().c_str(), std::ios_base::in | std::ios_base::binary);
+        if (!is || !is.seekg(scatterBin.getDataOffset()))
+        {
+            BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to open " + scatterBin.getPathString()));
+        }
+
+        unsigned long copied = 0;
+        while (scatterBin.getDataSize() > copied)
+        {
+            io::FragmentHeader header;
+            if (!is.read(reinterpret_cast<char*>(&header), sizeof(header)))
+            {
+                BOOST_THROW_EXCEPTION(common::IoException(
+                    errno, "Failed to read FragmentHeader bytes from " + scatterBin.getPathString()));
+            }
+            header.tile_ += tileIndexOffset;
+            data.resize(header.getDataLength());
+            if (!data.empty() && !is.read(&data.front(), data.size()))
+            {
+                BOOST_THROW_EXCEPTION(common::IoException(
+                    errno, (boost::format("Failed to read %d bytes from %s") % data.size() % scatterBin.getPathString()).str()));
+            }
+
+            alignment::matchSelector::BinningFragmentStorage::accountFragment(header, maxTileReads, bin);
+
+            if (!os.write(reinterpret_cast<const char*>(header.bytesBegin()), sizeof(header)) ||
+                (!data.empty() && !os.write(&data.front(), data.size())))
+            {
+                BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to write into " + bin.getPathString()));
+            }
+            copied += header.getTotalLength();
+        }
+
+        if (scatterBin.getDataSize() != copied)
+        {
+            BOOST_THROW_EXCEPTION(common::IoException(
+                EINVAL, "Corrupt fragment (length is broken) read from " + scatterBin.getPathString()));
+        }
+    }
+
+    os.close();
+    if (!os)
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to close " + bin.getPathString()));
+    }
+}
+
+void GatherTransition::gatherBinsThread(
+    const boost::ptr_vector<ScatterRun> &scatterRuns,
+    const std::vector<unsigned> &tileIndexOffsets,
+    const unsigned long maxTileReads,
+    std::size_t &nextBin,
+    alignment::BinMetadataList &bins) const
+{
+    for (std::size_t binIndex = __sync_fetch_and_add(&nextBin, 1); bins.size() > binIndex;
+        binIndex = __sync_fetch_and_add(&nextBin, 1))
+    {
+        gatherBin(scatterRuns, tileIndexOffsets, maxTileReads, bins.at(binIndex));
+    }
+}
+
+void GatherTransition::perform(
+    const std::vector<bfs::path> &scatterTempDirectoryList,
+    const std::vector<bfs::path> &scatterOutputDirectoryList,
+    const bfs::path &matchSelectorStatsXmlPath,
+    const bfs::path &demultiplexingStatsXmlPath,
+    FoundMatchesMetadata &foundMatches,
+    alignment::BinMetadataList &selectedMatches,
+    std::vector<alignment::TemplateLengthStatistics> &barcodeTemplateLengthStatistics) const
+{
+    ISAAC_ASSERT_MSG(!scatterTempDirectoryList.empty(), "Nothing to gather");
+    ISAAC_ASSERT_MSG(scatterTempDirectoryList.size() == scatterOutputDirectoryList.size(),
+                     "Each scatter run must have a temp and an output directory");
+
+    boost::ptr_vector<ScatterRun> scatterRuns;
+    BOOST_FOREACH(const bfs::path &scatterTempDirectory, scatterTempDirectoryList)
+    {
+        scatterRuns.push_back(new ScatterRun(
+            tempDirectory_, barcodeMetadataList_, seedIterations_, sortedReferenceMetadataList_));
+        load(scatterTempDirectory / "AlignerState.txt", scatterRuns.back());
+        if (AlignWorkflow::MatchSelectorDone > scatterRuns.back().state_)
+        {
+            BOOST_THROW_EXCEPTION(common::PreConditionException(
+                "MatchSelector is not complete for the gathered run in " + scatterTempDirectory.string()));
+        }
+        if (barcodeMetadataList_.size() != scatterRuns.back().barcodeTemplateLengthStatistics_.size())
+        {
+            BOOST_THROW_EXCEPTION(common::PreConditionException(
+                "The gathered run in " + scatterTempDirectory.string() + " uses a different set of barcodes"));
+        }
+    }
+
+    std::vector<unsigned> tileIndexOffsets;
+    gatherTiles(scatterRuns, foundMatches, tileIndexOffsets);
+    gatherTemplateLengthStatistics(scatterRuns, barcodeTemplateLengthStatistics);
+
+    selectedMatches = makeGatheredBins(scatterRuns, foundMatches.tileMetadataList_);
+    ISAAC_THREAD_CERR << "Gathering " << selectedMatches.size() << " bins from " << scatterRuns.size() << " runs" << std::endl;
+    const unsigned long maxTileReads = flowcell::getMaxTileClusters(foundMatches.tileMetadataList_) *
+        alignment::matchSelector::BinningFragmentStorage::READS_MAX;
+    std::size_t nextBin = 0;
+    common::ThreadVector threads(threads_);
+    threads.execute(boost::bind(&GatherTransition::gatherBinsThread, this,
+                                boost::cref(scatterRuns), boost::cref(tileIndexOffsets), maxTileReads,
+                                boost::ref(nextBin), boost::ref(selectedMatches)));
+    ISAAC_THREAD_CERR << "Gathering bins done" << std::endl;
+
+    std::vector<bfs::path> matchSelectorStatsXmlPathList;
+    std::vector<bfs::path> demultiplexingStatsXmlPathList;
+    BOOST_FOREACH(const bfs::path &scatterOutputDirectory, scatterOutputDirectoryList)
+    {
+        matchSelectorStatsXmlPathList.push_back(scatterOutputDirectory / "Stats" / matchSelectorStatsXmlPath.filename());
+        demultiplexingStatsXmlPathList.push_back(scatterOutputDirectory / "Stats" / demultiplexingStatsXmlPath.filename());
+    }
+    // match selector statistics are per tile. Demultiplexing statistics are per lane and lanes can be split between runs
+    mergeStatsXml(matchSelectorStatsXmlPathList, matchSelectorStatsXmlPath, std::set<std::string>());
+    const std::set<std::string> additiveDemultiplexingStats = boost::assign::list_of
+        ("BarcodeCount")("PerfectBarcodeCount")("OneMismatchBarcodeCount")("count");
+    mergeStatsXml(demultiplexingStatsXmlPathList, demultiplexingStatsXmlPath, additiveDemultiplexingStats);
+}
+
+} // namespace alignWorkflow
+} // namespace workflow
+} // namespace isaac
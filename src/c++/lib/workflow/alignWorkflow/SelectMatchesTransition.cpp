@@ -32,6 +32,7 @@
 #include "common/Exceptions.hh"
 #include "common/FastIo.hh"
 #include "common/ParallelSort.hpp"
+#include "common/Profiling.hh"
 #include "reference/Contig.hh"
 #include "reference/ContigLoader.hh"
 
@@ -72,6 +73,7 @@ SelectMatchesTransition::SelectMatchesTransition(
         alignment::matchSelector::FragmentStorage &fragmentStorage,
         const alignment::MatchDistribution &matchDistribution,
         const reference::SortedReferenceMetadataList &sortedReferenceMetadataList,
+        const reference::SharedContigsList &sharedContigsList,
         const boost::filesystem::path &tempDirectory,
         const unsigned int maxThreadCount,
         const TileMetadataList &tileMetadataList,
@@ -83,6 +85,7 @@ SelectMatchesTransition::SelectMatchesTransition(
         const bool cleanupIntermediary,
         const bool ignoreMissingBcls,
         const bool ignoreMissingFilters,
+        const bool memoryMapInput,
         const unsigned inputLoadersMax,
         const unsigned tempLoadersMax,
         const unsigned tempSaversMax,
@@ -103,11 +106,13 @@ SelectMatchesTransition::SelectMatchesTransition(
         const int gapOpenScore,
         const int gapExtendScore,
         const int minGapExtendScore,
+        const bool fixedPointScoring,
         const unsigned semialignedGapLimit,
         const alignment::TemplateBuilder::DodgyAlignmentScore dodgyAlignmentScore,
         const bool qScoreBin,
         const boost::array<char, 256> &fullBclQScoreTable,
-        const bool extractClusterXy
+        const bool extractClusterXy,
+        const bool tileCheckpoints
     )
     : matchLoadThreads_(tempLoadersMax),
       inputLoaderThreads_(inputLoadersMax),
@@ -134,6 +139,7 @@ SelectMatchesTransition::SelectMatchesTransition(
                       tileMetadataList_,
                       ignoreMissingBcls,
                       ignoreMissingFilters,
+                      memoryMapInput,
                       inputLoaderThreads_,
                       inputLoadersMax,
                       extractClusterXy)),
@@ -167,6 +173,7 @@ SelectMatchesTransition::SelectMatchesTransition(
                       tileMetadataList_,
                       ignoreMissingBcls,
                       ignoreMissingFilters,
+                      memoryMapInput,
                       inputLoaderThreads_,
                       inputLoadersMax,
                       extractClusterXy)),
@@ -174,6 +181,7 @@ SelectMatchesTransition::SelectMatchesTransition(
           fragmentStorage,
           matchDistribution,
           sortedReferenceMetadataList,
+          sharedContigsList,
         maxThreadCount,
         tileMetadataList,
         barcodeMetadataList,
@@ -196,11 +204,19 @@ SelectMatchesTransition::SelectMatchesTransition(
         gapOpenScore,
         gapExtendScore,
         minGapExtendScore,
+        fixedPointScoring,
         semialignedGapLimit,
-        dodgyAlignmentScore),
+        dodgyAlignmentScore,
+        tempDirectory),
         qScoreBin_(qScoreBin),
         fullBclQScoreTable_(fullBclQScoreTable),
-        forceTermination_(false)
+        forceTermination_(false),
+        tempDirectory_(tempDirectory),
+        tileCheckpoints_(tileCheckpoints),
+        saveCheckpoints_(tileCheckpoints),
+        checkpointedTiles_(tileMetadataList.size(), false),
+        threadTemplateLengthStatistics_(
+            ioOverlapParallelization, std::vector<alignment::TemplateLengthStatistics>(barcodeMetadataList.size()))
 {
     ISAAC_TRACE_STAT("SelectMatchesTransition::SelectMatchesTransitions constructor begin ")
 
@@ -213,6 +229,12 @@ SelectMatchesTransition::SelectMatchesTransition(
     }
     ISAAC_TRACE_STAT("SelectMatchesTransition::SelectMatchesTransitions after bclData.reserveClusters ")
 
+    common::Profiler::instance().reserveUnits(common::Profiler::SelectMatchesLoadMatches, tileMetadataList_.size());
+    common::Profiler::instance().reserveUnits(common::Profiler::SelectMatchesLoadClusters, tileMetadataList_.size());
+    common::Profiler::instance().reserveUnits(common::Profiler::SelectMatchesSortMatches, tileMetadataList_.size());
+    common::Profiler::instance().reserveUnits(common::Profiler::SelectMatchesSelectTile, tileMetadataList_.size());
+    common::Profiler::instance().reserveUnits(common::Profiler::SelectMatchesFlushTile, tileMetadataList_.size());
+
     ISAAC_TRACE_STAT("SelectMatchesTransition::SelectMatchesTransitions constructor end ")
     ISAAC_THREAD_CERR << "Constructed the SelectMatchesTransition" << std::endl;
 }
@@ -222,6 +244,11 @@ void SelectMatchesTransition::selectMatches(
     const boost::filesystem::path &matchSelectorStatsXmlPath,
     std::vector<alignment::TemplateLengthStatistics> &barcodeTemplateLengthStatistics)
 {
+    if (tileCheckpoints_)
+    {
+        resumeFromCheckpoint(barcodeTemplateLengthStatistics);
+    }
+
     {
         common::ScoopedMallocBlock  mallocBlock(memoryControl);
         nextUnprocessedTile_ = processOrderTileMetadataList_.begin();
@@ -235,7 +262,73 @@ void SelectMatchesTransition::selectMatches(
 
     matchSelector_.dumpStats(matchSelectorStatsXmlPath);
 
+    if (tileCheckpoints_)
+    {
+        removeCheckpoint(MatchSelectorCheckpoint::getPath(tempDirectory_), tempDirectory_, tileMetadataList_);
+    }
+}
+
+void SelectMatchesTransition::resumeFromCheckpoint(
+    std::vector<alignment::TemplateLengthStatistics> &barcodeTemplateLengthStatistics)
+{
+    MatchSelectorCheckpoint checkpoint;
+    if (!loadCheckpoint(MatchSelectorCheckpoint::getPath(tempDirectory_), checkpoint))
+    {
+        return;
+    }
+
+    BOOST_FOREACH(const flowcell::TileMetadata &tileMetadata, checkpoint.completeTiles_)
+    {
+        if (!isCheckpointedTile(tileMetadataList_, tileMetadata))
+        {
+            ISAAC_THREAD_CERR << "WARNING: Ignoring match selector checkpoint: " << tileMetadata <<
+                " is not part of the analysis" << std::endl;
+            return;
+        }
+    }
+
+    if (checkpoint.barcodeTemplateLengthStatistics_.size() != barcodeTemplateLengthStatistics.size())
+    {
+        ISAAC_THREAD_CERR << "WARNING: Ignoring match selector checkpoint: barcode count mismatch " <<
+            checkpoint.barcodeTemplateLengthStatistics_.size() << " vs " <<
+            barcodeTemplateLengthStatistics.size() << std::endl;
+        return;
+    }
+
+    if (!fragmentStorage_.resume(checkpoint.binMetadataList_, checkpoint.storedTiles_))
+    {
+        ISAAC_THREAD_CERR << "WARNING: Ignoring match selector checkpoint: bin layout does not match" << std::endl;
+        return;
+    }
+
+    BOOST_FOREACH(const flowcell::TileMetadata &tileMetadata, checkpoint.completeTiles_)
+    {
+        matchSelector_.loadTileStats(tileMetadata, MatchSelectorCheckpoint::getTileStatsPath(tempDirectory_, tileMetadata));
+        checkpointedTiles_.at(tileMetadata.getIndex()) = true;
+    }
+    barcodeTemplateLengthStatistics = checkpoint.barcodeTemplateLengthStatistics_;
+    checkpoint_ = checkpoint;
+
+    ISAAC_THREAD_CERR << "Resuming match selection with " << checkpoint_.completeTiles_.size() <<
+        " of " << tileMetadataList_.size() << " tiles complete" << std::endl;
+}
+
+void SelectMatchesTransition::saveTileCheckpoint(
+    const unsigned threadNumber,
+    const flowcell::TileMetadata &tileMetadata)
+{
+    if (!fragmentStorage_.checkpoint(checkpoint_.binMetadataList_, checkpoint_.storedTiles_))
+    {
+        ISAAC_THREAD_CERR << "WARNING: Tile checkpoints are not supported by the fragment storage. "
+            "Match selection will not be resumable." << std::endl;
+        saveCheckpoints_ = false;
+        return;
+    }
 
+    matchSelector_.saveTileStats(tileMetadata, MatchSelectorCheckpoint::getTileStatsPath(tempDirectory_, tileMetadata));
+    checkpoint_.completeTiles_.push_back(tileMetadata);
+    checkpoint_.barcodeTemplateLengthStatistics_ = threadTemplateLengthStatistics_.at(threadNumber);
+    saveCheckpoint(MatchSelectorCheckpoint::getPath(tempDirectory_), checkpoint_);
 }
 
 
@@ -308,12 +401,23 @@ void SelectMatchesTransition::selectTileMatches(
         }
 
         const flowcell::TileMetadata &tileMetadata = *nextUnprocessedTile_++;
+        if (checkpointedTiles_[tileMetadata.getIndex()])
+        {
+            ISAAC_THREAD_CERR << "Skipping checkpointed " << tileMetadata << std::endl;
+            releaseLoadSlot(false);
+            continue;
+        }
 
         ISAAC_BLOCK_WITH_CLENAUP(boost::bind(&SelectMatchesTransition::releaseLoadSlot, this, _1))
         {
 
             ISAAC_THREAD_CERR << "Loading matches for " << tileMetadata << std::endl;
-            matchLoader_.load(matchTally.getFileTallyList(tileMetadata), threadMatches_[threadNumber]);
+            {
+                common::ScopedStageTimer timer(common::Profiler::SelectMatchesLoadMatches, tileMetadata.getIndex());
+                matchLoader_.load(matchTally.getFileTallyList(tileMetadata), threadMatches_[threadNumber]);
+                timer.addItems(threadMatches_[threadNumber].size());
+                timer.addBytes(threadMatches_[threadNumber].size() * sizeof(alignment::Match));
+            }
             ISAAC_THREAD_CERR << "Loading matches done for " << tileMetadata << std::endl;
 
             if(threadMatches_[threadNumber].empty())
@@ -322,6 +426,8 @@ void SelectMatchesTransition::selectTileMatches(
                 continue;
             }
 
+            common::ScopedStageTimer timer(common::Profiler::SelectMatchesLoadClusters, tileMetadata.getIndex());
+            timer.addItems(tileMetadata.getClusterCount());
             loadClusters(threadNumber, tileMetadata);
         }
 
@@ -336,23 +442,40 @@ void SelectMatchesTransition::selectTileMatches(
             // sort the matches by SeedId and reference position
             ISAAC_THREAD_CERR << "Sorting matches by barcode for " << tileMetadata << std::endl;
             {
+                common::ScopedStageTimer timer(common::Profiler::SelectMatchesSortMatches, tileMetadata.getIndex());
+                timer.addItems(threadMatches_[threadNumber].size());
                 common::ScoopedMallocBlockUnblock unblock(mallocBlock);
                 common::parallelSort(threadMatches_[threadNumber], sortByTileBarcodeClusterLocation);
             }
             ISAAC_THREAD_CERR << "Sorting matches by barcode done for " << tileMetadata << std::endl;
 
-            matchSelector_.parallelSelect(matchTally, barcodeTemplateLengthStatistics, tileMetadata, threadMatches_[threadNumber], threadBclData_[threadNumber]);
+            {
+                common::ScopedStageTimer timer(common::Profiler::SelectMatchesSelectTile, tileMetadata.getIndex());
+                timer.addItems(tileMetadata.getClusterCount());
+                matchSelector_.parallelSelect(matchTally, barcodeTemplateLengthStatistics, tileMetadata, threadMatches_[threadNumber], threadBclData_[threadNumber]);
+            }
+            // the next tile can update the statistics before this one gets flushed and checkpointed
+            threadTemplateLengthStatistics_[threadNumber] = barcodeTemplateLengthStatistics;
 
             // There are only two sets of thread fragment dispatcher buffers (the one being flushed and the one we've just filled)
             // Wait for exclusive flush buffers access and swap the buffers before giving up the compute slot
             acquireFlushSlot();
             fragmentStorage_.prepareFlush();
+            matchSelector_.prepareFlushTileStats(tileMetadata);
         }
 
         ISAAC_BLOCK_WITH_CLENAUP(boost::bind(&SelectMatchesTransition::releaseFlushSlot, this, _1))
         {
             // now we can do out-of-sync flush while other thread does its compute
+            common::ScopedStageTimer timer(common::Profiler::SelectMatchesFlushTile, tileMetadata.getIndex());
             fragmentStorage_.flush();
+            common::ScoopedMallocBlockUnblock unblock(mallocBlock);
+            if (saveCheckpoints_)
+            {
+                saveTileCheckpoint(threadNumber, tileMetadata);
+            }
+            // checkpoint saves the statistics before flushTileStats finalizes them
+            matchSelector_.flushTileStats(tileMetadata);
         }
     }
 }
@@ -0,0 +1,143 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file TileCheckpoint.cpp
+ **
+ ** \brief See TileCheckpoint.hh
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include <cerrno>
+#include <fstream>
+
+#include <boost/foreach.hpp>
+#include <boost/format.hpp>
+
+#include "common/Debug.hh"
+#include "workflow/AlignWorkflowSerialization.hh"
+#include "workflow/alignWorkflow/TileCheckpoint.hh"
+
+namespace isaac
+{
+namespace workflow
+{
+namespace alignWorkflow
+{
+
+namespace
+{
+
+template <typename CheckpointT>
+void saveCheckpointFile(const boost::filesystem::path &checkpointPath, const CheckpointT &checkpoint)
+{
+    const boost::filesystem::path tmp = checkpointPath.string() + ".tmp";
+    {
+        std::ofstream ofs(tmp.string().c_str());
+        if (!ofs)
+        {
+            BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to open checkpoint file for writing: " + tmp.string()));
+        }
+        boost::archive::text_oarchive oa(ofs);
+        oa << BOOST_SERIALIZATION_NVP(checkpoint);
+    }
+    boost::filesystem::rename(tmp, checkpointPath);
+}
+
+template <typename CheckpointT>
+bool loadCheckpointFile(const boost::filesystem::path &checkpointPath, CheckpointT &checkpoint)
+{
+    if (!boost::filesystem::exists(checkpointPath))
+    {
+        return false;
+    }
+
+    ISAAC_THREAD_CERR << "Loading checkpoint from " << checkpointPath << std::endl;
+    std::ifstream ifs(checkpointPath.string().c_str());
+    try
+    {
+        boost::archive::text_iarchive ia(ifs);
+        ia >> BOOST_SERIALIZATION_NVP(checkpoint);
+    }
+    catch (const boost::archive::archive_exception &e)
+    {
+        ISAAC_THREAD_CERR << "WARNING: Ignoring unreadable checkpoint " << checkpointPath << ": " << e.what() << std::endl;
+        return false;
+    }
+    ISAAC_THREAD_CERR << "Loading checkpoint done from " << checkpointPath << std::endl;
+    return true;
+}
+
+} // namespace
+
+bool isCheckpointedTile(const flowcell::TileMetadataList &completeTiles, const flowcell::TileMetadata &tile)
+{
+    BOOST_FOREACH(const flowcell::TileMetadata &completeTile, completeTiles)
+    {
+        if (completeTile.getIndex() == tile.getIndex())
+        {
+            return completeTile.getFlowcellIndex() == tile.getFlowcellIndex() &&
+                completeTile.getLane() == tile.getLane() &&
+                completeTile.getTile() == tile.getTile() &&
+                completeTile.getClusterCount() == tile.getClusterCount();
+        }
+    }
+    return false;
+}
+
+boost::filesystem::path MatchSelectorCheckpoint::getTileStatsPath(
+    const boost::filesystem::path &tempDirectory,
+    const flowcell::TileMetadata &tile)
+{
+    return tempDirectory / (boost::format("MatchSelectorCheckpoint-%04d.stats") % tile.getIndex()).str();
+}
+
+void saveCheckpoint(const boost::filesystem::path &checkpointPath, const MatchFinderCheckpoint &checkpoint)
+{
+    saveCheckpointFile(checkpointPath, checkpoint);
+}
+
+void saveCheckpoint(const boost::filesystem::path &checkpointPath, const MatchSelectorCheckpoint &checkpoint)
+{
+    saveCheckpointFile(checkpointPath, checkpoint);
+}
+
+bool loadCheckpoint(const boost::filesystem::path &checkpointPath, MatchFinderCheckpoint &checkpoint)
+{
+    return loadCheckpointFile(checkpointPath, checkpoint);
+}
+
+bool loadCheckpoint(const boost::filesystem::path &checkpointPath, MatchSelectorCheckpoint &checkpoint)
+{
+    return loadCheckpointFile(checkpointPath, checkpoint);
+}
+
+void removeCheckpoint(const boost::filesystem::path &checkpointPath)
+{
+    boost::filesystem::remove(checkpointPath);
+}
+
+void removeCheckpoint(
+    const boost::filesystem::path &checkpointPath,
+    const boost::filesystem::path &tempDirectory,
+    const flowcell::TileMetadataList &tileMetadataList)
+{
+    boost::filesystem::remove(checkpointPath);
+    BOOST_FOREACH(const flowcell::TileMetadata &tile, tileMetadataList)
+    {
+        boost::filesystem::remove(MatchSelectorCheckpoint::getTileStatsPath(tempDirectory, tile));
+    }
+}
+
+} // namespace alignWorkflow
+} // namespace workflow
+} // namespace isaac
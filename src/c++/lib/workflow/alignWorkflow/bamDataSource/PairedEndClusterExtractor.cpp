@@ -34,6 +34,10 @@ namespace alignWorkflow
 namespace bamDataSource
 {
 
+const unsigned MateTable::EMPTY;
+const unsigned MateTable::REMOVED;
+const unsigned MateTable::NO_MATE;
+
 void TempFileClusterExtractor::open(const boost::filesystem::path &tempFilePath, std::streamsize expectedFileSize)
 {
     if (tempFilePath_ != tempFilePath.string())
@@ -132,9 +136,39 @@ void UnpairedReadsCache::storeUnpaired(
     }
 }
 
+/**
+ * \brief Forgets all the pairs and rebuilds the mate table from the records that remain in the index.
+ * \precondition All records in the index are unpaired
+ */
 void PairedEndClusterExtractor::reset()
 {
-    firstUnextracted_ = end();
+    pairs_.clear();
+    firstUnextracted_ = 0;
+    mateTable_.clear();
+    for (unsigned position = 0; size() != position; ++position)
+    {
+        ISAAC_ASSERT_MSG(MateTable::NO_MATE == mateTable_.pairOrInsert(static_cast<const BaseT&>(*this), position),
+                         "Unexpected mate for an unpaired record " << (*this)[position]);
+    }
+    firstUnpaired_ = size();
+}
+
+/**
+ * \brief Looks up mates of the records appended since the last call. Mates found produce pairs in the order
+ *        in which the second mate appears in the input.
+ */
+void PairedEndClusterExtractor::pairMates()
+{
+    for (; size() != firstUnpaired_; ++firstUnpaired_)
+    {
+        const unsigned matePosition = mateTable_.pairOrInsert(static_cast<const BaseT&>(*this), firstUnpaired_);
+        if (MateTable::NO_MATE != matePosition)
+        {
+            // put read one first so that it's simpler to extract data
+            pairs_.push_back((*this)[firstUnpaired_].getBlock().isReadOne() ?
+                MatePair(firstUnpaired_, matePosition) : MatePair(matePosition, firstUnpaired_));
+        }
+    }
 }
 
 inline bool inRange(const IndexRecord &idx, const char* rangeStart, const char* rangeEnd)
@@ -162,12 +196,6 @@ void PairedEndClusterExtractor::removeOld(
     reset();
 }
 
-void PairedEndClusterExtractor::sort()
-{
-    std::sort(begin(), end());
-    firstUnextracted_ = begin();
-}
-
 template
 unsigned PairedEndClusterExtractor::extractUnpaired<std::vector<char>::iterator, std::vector<bool>::iterator >(
     const unsigned r1Length,
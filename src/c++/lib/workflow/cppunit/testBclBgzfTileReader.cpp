@@ -0,0 +1,209 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+
+#include "RegistryName.hh"
+#include "testBclBgzfTileReader.hh"
+
+#include "flowcell/Layout.hh"
+#include "rta/BclBgzfTileReader.hh"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( TestBclBgzfTileReader, registryName("TestBclBgzfTileReader"));
+
+using namespace isaac;
+
+namespace
+{
+
+static const unsigned CYCLE = 1;
+
+void appendLittleEndian(std::vector<char> &buffer, const unsigned long value, const unsigned bytes)
+{
+    for (unsigned i = 0; bytes > i; ++i)
+    {
+        buffer.push_back(char((value >> (i * 8)) & 0xFF));
+    }
+}
+
+/// appends a complete bgzf block containing [begin, end)
+void appendBlock(std::vector<char> &buffer, const char *begin, const char *end)
+{
+    std::vector<char> cdata(compressBound(end - begin) + 16);
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    CPPUNIT_ASSERT_EQUAL(Z_OK, deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY));
+    strm.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(begin));
+    strm.avail_in = end - begin;
+    strm.next_out = reinterpret_cast<Bytef *>(&cdata.front());
+    strm.avail_out = cdata.size();
+    CPPUNIT_ASSERT_EQUAL(Z_STREAM_END, deflate(&strm, Z_FINISH));
+    cdata.resize(cdata.size() - strm.avail_out);
+    deflateEnd(&strm);
+
+    const unsigned blockSize = sizeof(bgzf::Header) + cdata.size() + sizeof(bgzf::Footer);
+    const char header[] = {31, char(139), 8, 4, 0, 0, 0, 0, 0, char(255), 6, 0, 'B', 'C', 2, 0};
+    buffer.insert(buffer.end(), header, header + sizeof(header));
+    appendLittleEndian(buffer, blockSize - 1, 2);
+    buffer.insert(buffer.end(), cdata.begin(), cdata.end());
+    appendLittleEndian(buffer, crc32(0, reinterpret_cast<const Bytef *>(begin), end - begin), 4);
+    appendLittleEndian(buffer, end - begin, 4);
+}
+
+/// appends a bci record. The 16 lower bits are the offset within the uncompressed block.
+void appendVirtualOffset(std::vector<char> &buffer, const unsigned long compressedOffset, const unsigned uncompressedOffset)
+{
+    appendLittleEndian(buffer, (compressedOffset << 16) | uncompressedOffset, 8);
+}
+
+void writeFile(const boost::filesystem::path &path, const char *begin, const char *end)
+{
+    std::ofstream os(path.c_str(), std::ios_base::binary);
+    os.write(begin, end - begin);
+    CPPUNIT_ASSERT(os);
+}
+
+flowcell::Layout makeLayout(const boost::filesystem::path &baseCallsPath)
+{
+    return flowcell::Layout(baseCallsPath, flowcell::Layout::BclBgzf, flowcell::BclFlowcellData(), 8,
+                            std::vector<unsigned>(), flowcell::ReadMetadataList(), alignment::SeedMetadataList(), "FC1");
+}
+
+} // namespace
+
+TestBclBgzfTileReader::TestBclBgzfTileReader() : truncateAt_(0)
+{
+    tileMetadataList_.push_back(flowcell::TileMetadata("FC1", 0, 1101, 1, 300, 0));
+    tileMetadataList_.push_back(flowcell::TileMetadata("FC1", 0, 1102, 1, 500, 1));
+    tileMetadataList_.push_back(flowcell::TileMetadata("FC1", 0, 1103, 1, 200, 2));
+
+    for (unsigned i = 0; 1000 > i; ++i)
+    {
+        cycleData_.push_back(char(i * 11 + i / 7));
+    }
+
+    // the second tile starts inside the first block and ends at the end of the second one. The empty block
+    // in between must be skipped.
+    const char *data = &cycleData_.front();
+    std::vector<char> bci;
+    appendLittleEndian(bci, 0, 4);
+    appendLittleEndian(bci, tileMetadataList_.size(), 4);
+    appendVirtualOffset(bci, 0, 0);
+    appendVirtualOffset(bci, 0, 300);
+    appendBlock(compressed_, data, data + 400);
+    appendBlock(compressed_, data, data);
+    truncateAt_ = compressed_.size() + 40;
+    appendBlock(compressed_, data + 400, data + 800);
+    appendVirtualOffset(bci, compressed_.size(), 0);
+    appendBlock(compressed_, data + 800, data + 1000);
+    appendBlock(compressed_, data, data);
+    bci_.assign(bci.begin(), bci.end());
+}
+
+void TestBclBgzfTileReader::setUp()
+{
+    tempDirectory_ = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("testBclBgzfTileReader-%%%%%%%%");
+    boost::filesystem::create_directories(tempDirectory_ / "L001");
+    writeFile(tempDirectory_ / "L001" / "0001.bcl.bgzf", &compressed_.front(), &compressed_.front() + compressed_.size());
+}
+
+void TestBclBgzfTileReader::tearDown()
+{
+    boost::filesystem::remove_all(tempDirectory_);
+}
+
+void TestBclBgzfTileReader::checkTiles(const bool mapBgzfBcls, const unsigned inflaterThreads)
+{
+    const flowcell::Layout layout = makeLayout(tempDirectory_);
+    std::vector<rta::CycleBciMapper> cycleBciMappers(CYCLE + 1, rta::CycleBciMapper(tileMetadataList_.size()));
+    std::istringstream bciStream(bci_);
+    cycleBciMappers.at(CYCLE).mapStream(bciStream, "test.bci");
+    std::vector<unsigned> tileBciIndexMap;
+    tileBciIndexMap.push_back(0);
+    tileBciIndexMap.push_back(1);
+    tileBciIndexMap.push_back(2);
+
+    bgzf::ParallelBgzfBlockInflater inflater(std::max(1U, inflaterThreads));
+    rta::BclBgzfTileReader reader(false, mapBgzfBcls, 500, tileBciIndexMap, cycleBciMappers,
+                                  inflaterThreads ? &inflater : 0);
+    reader.reserveBuffers(layout.getLongestAttribute<flowcell::Layout::BclBgzf, flowcell::BclFilePathAttributeTag>().string().size(), 501);
+
+    io::MappedFile mapping;
+    std::vector<char> buffer(sizeof(boost::uint32_t) + 501);
+    std::size_t tileBegin = 0;
+    BOOST_FOREACH(const flowcell::TileMetadata &tile, tileMetadataList_)
+    {
+        reader.prefetchTileCycle(layout, tile, CYCLE);
+        // bgzf data is never handed out in place
+        CPPUNIT_ASSERT_EQUAL(static_cast<const char *>(0), reader.mapTileCycle(layout, tile, CYCLE, mapping));
+
+        std::fill(buffer.begin(), buffer.end(), '#');
+        CPPUNIT_ASSERT_EQUAL(tile.getClusterCount(), reader.readTileCycle(layout, tile, CYCLE, &buffer.front(), buffer.size()));
+        CPPUNIT_ASSERT_EQUAL(tile.getClusterCount(), unsigned(reinterpret_cast<const boost::uint32_t &>(buffer.front())));
+        CPPUNIT_ASSERT(std::equal(cycleData_.begin() + tileBegin, cycleData_.begin() + tileBegin + tile.getClusterCount(),
+                                  buffer.begin() + sizeof(boost::uint32_t)));
+        // nothing is written past the tile data
+        CPPUNIT_ASSERT_EQUAL('#', buffer.at(sizeof(boost::uint32_t) + tile.getClusterCount()));
+        tileBegin += tile.getClusterCount();
+    }
+}
+
+void TestBclBgzfTileReader::testRead()
+{
+    checkTiles(false, 0);
+}
+
+void TestBclBgzfTileReader::testMapped()
+{
+    checkTiles(true, 0);
+}
+
+void TestBclBgzfTileReader::testMappedParallelInflate()
+{
+    checkTiles(true, 2);
+}
+
+void TestBclBgzfTileReader::testTruncated()
+{
+    writeFile(tempDirectory_ / "L001" / "0001.bcl.bgzf", &compressed_.front(), &compressed_.front() + truncateAt_);
+
+    const flowcell::Layout layout = makeLayout(tempDirectory_);
+    std::vector<rta::CycleBciMapper> cycleBciMappers(CYCLE + 1, rta::CycleBciMapper(tileMetadataList_.size()));
+    std::istringstream bciStream(bci_);
+    cycleBciMappers.at(CYCLE).mapStream(bciStream, "test.bci");
+    std::vector<unsigned> tileBciIndexMap;
+    tileBciIndexMap.push_back(0);
+    tileBciIndexMap.push_back(1);
+    tileBciIndexMap.push_back(2);
+
+    for (unsigned mapBgzfBcls = 0; 2 > mapBgzfBcls; ++mapBgzfBcls)
+    {
+        rta::BclBgzfTileReader reader(false, mapBgzfBcls, 500, tileBciIndexMap, cycleBciMappers, 0);
+        reader.reserveBuffers(layout.getLongestAttribute<flowcell::Layout::BclBgzf, flowcell::BclFilePathAttributeTag>().string().size(), 501);
+        std::vector<char> buffer(sizeof(boost::uint32_t) + 501);
+
+        // the first tile is complete
+        CPPUNIT_ASSERT_EQUAL(300U, reader.readTileCycle(layout, tileMetadataList_.at(0), CYCLE, &buffer.front(), buffer.size()));
+        // the second one ends in the block that is cut
+        CPPUNIT_ASSERT_THROW(reader.readTileCycle(layout, tileMetadataList_.at(1), CYCLE, &buffer.front(), buffer.size()),
+                             common::IoException);
+        // the third one starts past the end of the file
+        CPPUNIT_ASSERT_THROW(reader.readTileCycle(layout, tileMetadataList_.at(2), CYCLE, &buffer.front(), buffer.size()),
+                             common::IoException);
+    }
+}
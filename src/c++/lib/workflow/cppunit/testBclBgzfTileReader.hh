@@ -0,0 +1,54 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#ifndef iSAAC_WORKFLOW_TEST_BCL_BGZF_TILE_READER_HH
+#define iSAAC_WORKFLOW_TEST_BCL_BGZF_TILE_READER_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <boost/filesystem.hpp>
+
+#include "flowcell/TileMetadata.hh"
+
+class TestBclBgzfTileReader : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( TestBclBgzfTileReader );
+    CPPUNIT_TEST( testRead );
+    CPPUNIT_TEST( testMapped );
+    CPPUNIT_TEST( testMappedParallelInflate );
+    CPPUNIT_TEST( testTruncated );
+    CPPUNIT_TEST_SUITE_END();
+private:
+    boost::filesystem::path tempDirectory_;
+    isaac::flowcell::TileMetadataList tileMetadataList_;
+    /// uncompressed content of the cycle file, all tiles back to back
+    std::vector<char> cycleData_;
+    /// bgzf blocks of the cycle file
+    std::vector<char> compressed_;
+    /// bci of the cycle file
+    std::string bci_;
+    /// compressed size at which the cycle file is cut half way through the block the second tile ends in
+    std::size_t truncateAt_;
+
+    void checkTiles(const bool mapBgzfBcls, const unsigned inflaterThreads);
+public:
+    TestBclBgzfTileReader();
+    void setUp();
+    void tearDown();
+    void testRead();
+    void testMapped();
+    void testMappedParallelInflate();
+    void testTruncated();
+};
+
+#endif // #ifndef iSAAC_WORKFLOW_TEST_BCL_BGZF_TILE_READER_HH
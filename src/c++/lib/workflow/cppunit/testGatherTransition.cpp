@@ -0,0 +1,356 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <boost/assign.hpp>
+#include <boost/foreach.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/property_tree/xml_parser.hpp>
+
+#include "RegistryName.hh"
+#include "testGatherTransition.hh"
+
+#include "alignment/BamTemplate.hh"
+#include "alignment/Cluster.hh"
+#include "alignment/matchSelector/BinningFragmentStorage.hh"
+#include "common/MemoryGovernor.hh"
+#include "workflow/AlignWorkflowSerialization.hh"
+#include "workflow/alignWorkflow/GatherTransition.hh"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( TestGatherTransition, registryName("TestGatherTransition"));
+
+using namespace isaac;
+namespace bpt = boost::property_tree;
+
+namespace
+{
+
+static const unsigned READ_LENGTH = 50;
+static const unsigned CONTIG_LENGTH = 10000;
+static const unsigned SCATTER_RUNS = 2;
+// the second run has more data and its template length statistics are expected to be picked
+static const unsigned TILE_CLUSTERS[SCATTER_RUNS] = {200, 300};
+static const unsigned TILE_NUMBERS[SCATTER_RUNS] = {1101, 1102};
+static const unsigned TEMPLATE_LENGTH_MEDIANS[SCATTER_RUNS] = {300, 400};
+
+std::vector<char> readFile(const boost::filesystem::path &path)
+{
+    std::ifstream is(path.c_str(), std::ios_base::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+}
+
+void writeFile(const boost::filesystem::path &path, const std::string &content)
+{
+    std::ofstream os(path.c_str());
+    os << content;
+    CPPUNIT_ASSERT(os);
+}
+
+alignment::MatchDistribution makeMatchDistribution(
+    const reference::SortedReferenceMetadataList &sortedReferenceMetadataList)
+{
+    alignment::MatchDistribution ret(sortedReferenceMetadataList);
+    ret.makeUniform();
+    return ret;
+}
+
+void alignFragment(
+    alignment::FragmentMetadata &fragment,
+    alignment::Cigar &cigarBuffer,
+    const long position,
+    const bool reverse)
+{
+    fragment.reverse = reverse;
+    fragment.cigarBuffer = &cigarBuffer;
+    fragment.cigarOffset = cigarBuffer.size();
+    cigarBuffer.push_back(alignment::Cigar::encode(READ_LENGTH, alignment::Cigar::ALIGN));
+    fragment.cigarLength = cigarBuffer.size() - fragment.cigarOffset;
+    fragment.contigId = 0;
+    fragment.position = position;
+    fragment.observedLength = READ_LENGTH;
+}
+
+/**
+ * \brief Stores the pairs of the tile of the scatter run. The data only depends on the run, the tile index
+ *        is whatever the storing run has for the tile. Some pairs are unaligned, some span bins.
+ */
+void storeTile(
+    alignment::matchSelector::BinningFragmentStorage &storage,
+    const unsigned run,
+    const unsigned tileIndex)
+{
+    const std::vector<flowcell::ReadMetadata> reads = boost::assign::list_of
+        (flowcell::ReadMetadata(1, READ_LENGTH, 0, 0))
+        (flowcell::ReadMetadata(READ_LENGTH + 1, READ_LENGTH * 2, 1, READ_LENGTH));
+    const flowcell::ReadMetadataList readMetadataList(reads);
+    std::vector<char> bcl(READ_LENGTH * 2);
+    alignment::Cluster cluster(READ_LENGTH);
+    alignment::Cigar cigarBuffer;
+    alignment::BamTemplate bamTemplate(cigarBuffer);
+    for (unsigned clusterId = 0; TILE_CLUSTERS[run] != clusterId; ++clusterId)
+    {
+        for (unsigned i = 0; bcl.size() != i; ++i)
+        {
+            bcl[i] = (((clusterId * 7 + i * 13 + run) % 40 + 2) << 2) | ((clusterId + i + run) % 4);
+        }
+        cluster.init(readMetadataList, bcl.begin(), tileIndex, clusterId, alignment::ClusterXy(), true, 0);
+        bamTemplate.initialize(readMetadataList, cluster);
+        cigarBuffer.clear();
+        if ((clusterId + run) % 10)
+        {
+            const long position = (clusterId * 997 + run * 101) % (CONTIG_LENGTH - 3000);
+            const long matePosition = position + (clusterId % 3 ? 300 : 2500);
+            alignFragment(bamTemplate.getFragmentMetadata(0), cigarBuffer, position, false);
+            alignFragment(bamTemplate.getFragmentMetadata(1), cigarBuffer, matePosition, true);
+        }
+        storage.add(bamTemplate, 0, 0);
+    }
+    storage.prepareFlush();
+    storage.flush();
+}
+
+const bpt::ptree &getChild(
+    const bpt::ptree &parent,
+    const std::string &name,
+    const std::string &attribute,
+    const std::string &value)
+{
+    BOOST_FOREACH(const bpt::ptree::value_type &child, parent)
+    {
+        if (name == child.first && value == child.second.get<std::string>("<xmlattr>." + attribute, ""))
+        {
+            return child.second;
+        }
+    }
+    CPPUNIT_FAIL("Missing " + name + " " + attribute + "=" + value);
+    return parent;
+}
+
+unsigned countChildren(const bpt::ptree &parent, const std::string &name)
+{
+    return parent.count(name);
+}
+
+} // namespace
+
+TestGatherTransition::TestGatherTransition() :
+    sortedReferenceMetadataList_(1),
+    barcodeMetadataList_(1, flowcell::BarcodeMetadata("FC1", 0, 1, 0, false, flowcell::SequencingAdapterMetadataList()))
+{
+    sortedReferenceMetadataList_.front().putContig(
+        0, "chr1", "chr1.fa", 0, CONTIG_LENGTH, CONTIG_LENGTH, CONTIG_LENGTH, 0, 0, "", "", "");
+    barcodeMetadataList_.front().setIndex(0);
+}
+
+void TestGatherTransition::setUp()
+{
+    tempDirectory_ = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("testGatherTransition-%%%%%%%%");
+    for (unsigned run = 0; SCATTER_RUNS != run; ++run)
+    {
+        writeScatterRun(run);
+    }
+}
+
+void TestGatherTransition::tearDown()
+{
+    boost::filesystem::remove_all(tempDirectory_);
+}
+
+alignment::BinMetadataList TestGatherTransition::storeAllTiles()
+{
+    const boost::filesystem::path binDirectory = tempDirectory_ / "all";
+    boost::filesystem::create_directories(binDirectory);
+    common::MemoryGovernor memoryGovernor(0);
+    alignment::matchSelector::BinningFragmentStorage storage(
+        true, false, 1, 1, makeMatchDistribution(sortedReferenceMetadataList_), 1, binDirectory,
+        flowcell::FlowcellLayoutList(), barcodeMetadataList_,
+        std::max(TILE_CLUSTERS[0], TILE_CLUSTERS[1]), SCATTER_RUNS,
+        alignment::matchSelector::BinningFragmentStorage::STAGING_BUFFER_BYTES_DEFAULT, memoryGovernor);
+    for (unsigned run = 0; SCATTER_RUNS != run; ++run)
+    {
+        storeTile(storage, run, run);
+    }
+    alignment::BinMetadataList ret;
+    storage.close(ret);
+    return ret;
+}
+
+/**
+ * \brief Produces what a scatter run leaves behind: bins, AlignerState.txt and the statistics files
+ */
+void TestGatherTransition::writeScatterRun(const unsigned run)
+{
+    const boost::filesystem::path runDirectory = tempDirectory_ / ("scatter" + boost::lexical_cast<std::string>(run));
+    const boost::filesystem::path runTempDirectory = runDirectory / "Temp";
+    boost::filesystem::create_directories(runTempDirectory);
+    boost::filesystem::create_directories(runDirectory / "Output" / "Stats");
+
+    workflow::alignWorkflow::ScatterRun scatterRun(
+        runTempDirectory, barcodeMetadataList_, 1, sortedReferenceMetadataList_);
+    {
+        common::MemoryGovernor memoryGovernor(0);
+        alignment::matchSelector::BinningFragmentStorage storage(
+            true, false, 1, 1, makeMatchDistribution(sortedReferenceMetadataList_), 1, runTempDirectory,
+            flowcell::FlowcellLayoutList(), barcodeMetadataList_, TILE_CLUSTERS[run], 1,
+            alignment::matchSelector::BinningFragmentStorage::STAGING_BUFFER_BYTES_DEFAULT, memoryGovernor);
+        storeTile(storage, run, 0);
+        storage.close(scatterRun.selectedMatchesMetadata_);
+    }
+    scatterRun.state_ = workflow::AlignWorkflow::MatchSelectorDone;
+    scatterRun.foundMatchesMetadata_.addTile(flowcell::TileMetadata("FC1", 0, TILE_NUMBERS[run], 1, TILE_CLUSTERS[run], 0));
+    scatterRun.barcodeTemplateLengthStatistics_.front().setMedian(TEMPLATE_LENGTH_MEDIANS[run], -1);
+    {
+        std::ofstream ofs((runTempDirectory / "AlignerState.txt").c_str());
+        boost::archive::text_oarchive oa(ofs);
+        oa << boost::serialization::make_nvp("aligner", scatterRun);
+    }
+
+    const std::string tile = boost::lexical_cast<std::string>(TILE_NUMBERS[run]);
+    const std::string clusters = boost::lexical_cast<std::string>(TILE_CLUSTERS[run]);
+    writeFile(runDirectory / "Output" / "Stats" / "MatchSelectorStats.xml",
+        "<Stats><Flowcell flowcell-id=\"FC1\"><Lane number=\"1\">"
+        "<Tile number=\"" + tile + "\"><Raw><ClusterCount>" + clusters + "</ClusterCount></Raw></Tile>"
+        "</Lane></Flowcell></Stats>");
+    // the second run also sees an unknown barcode that the first one does not
+    writeFile(runDirectory / "Output" / "Stats" / "DemultiplexingStats.xml",
+        "<Stats><Flowcell flowcell-id=\"FC1\">"
+        "<Project name=\"default\"><Sample name=\"default\"><Barcode name=\"NoIndex\"><Lane number=\"1\">"
+        "<BarcodeCount>" + clusters + "</BarcodeCount>"
+        "<PerfectBarcodeCount>" + boost::lexical_cast<std::string>(TILE_CLUSTERS[run] - 10 - run) + "</PerfectBarcodeCount>"
+        "<OneMismatchBarcodeCount>" + boost::lexical_cast<std::string>(10 + run) + "</OneMismatchBarcodeCount>"
+        "</Lane></Barcode></Sample></Project>"
+        "<Lane number=\"1\"><TopUnknownBarcodes>"
+        "<Barcode sequence=\"ACGT\" count=\"" + boost::lexical_cast<std::string>(3 + run) + "\"/>" +
+        (run ? "<Barcode sequence=\"TTTT\" count=\"1\"/>" : "") +
+        "</TopUnknownBarcodes></Lane>"
+        "</Flowcell></Stats>");
+}
+
+void TestGatherTransition::gather(
+    workflow::alignWorkflow::FoundMatchesMetadata &foundMatches,
+    alignment::BinMetadataList &selectedMatches,
+    std::vector<alignment::TemplateLengthStatistics> &barcodeTemplateLengthStatistics)
+{
+    std::vector<boost::filesystem::path> scatterTempDirectoryList;
+    std::vector<boost::filesystem::path> scatterOutputDirectoryList;
+    for (unsigned run = 0; SCATTER_RUNS != run; ++run)
+    {
+        const boost::filesystem::path runDirectory = tempDirectory_ / ("scatter" + boost::lexical_cast<std::string>(run));
+        scatterTempDirectoryList.push_back(runDirectory / "Temp");
+        scatterOutputDirectoryList.push_back(runDirectory / "Output");
+    }
+
+    const boost::filesystem::path gatherDirectory = tempDirectory_ / "gather";
+    boost::filesystem::create_directories(gatherDirectory);
+    const workflow::alignWorkflow::GatherTransition gatherTransition(
+        barcodeMetadataList_, sortedReferenceMetadataList_, 1, false, 2, gatherDirectory);
+    gatherTransition.perform(
+        scatterTempDirectoryList, scatterOutputDirectoryList,
+        gatherDirectory / "MatchSelectorStats.xml", gatherDirectory / "DemultiplexingStats.xml",
+        foundMatches, selectedMatches, barcodeTemplateLengthStatistics);
+}
+
+void TestGatherTransition::testBins()
+{
+    workflow::alignWorkflow::FoundMatchesMetadata foundMatches(
+        tempDirectory_ / "gather", barcodeMetadataList_, 1, sortedReferenceMetadataList_);
+    alignment::BinMetadataList gathered;
+    std::vector<alignment::TemplateLengthStatistics> barcodeTemplateLengthStatistics;
+    gather(foundMatches, gathered, barcodeTemplateLengthStatistics);
+
+    CPPUNIT_ASSERT_EQUAL(std::size_t(SCATTER_RUNS), foundMatches.tileMetadataList_.size());
+    for (unsigned run = 0; SCATTER_RUNS != run; ++run)
+    {
+        CPPUNIT_ASSERT_EQUAL(run, foundMatches.tileMetadataList_.at(run).getIndex());
+        CPPUNIT_ASSERT_EQUAL(TILE_NUMBERS[run], foundMatches.tileMetadataList_.at(run).getTile());
+    }
+
+    // gathering must produce the bins a single run over both tiles would, with the tile indexes remapped
+    const alignment::BinMetadataList expected = storeAllTiles();
+    CPPUNIT_ASSERT(2 < expected.size());
+    CPPUNIT_ASSERT_EQUAL(expected.size(), gathered.size());
+    unsigned long totalElements = 0;
+    for (std::size_t bin = 0; expected.size() != bin; ++bin)
+    {
+        const alignment::BinMetadata &e = expected.at(bin);
+        const alignment::BinMetadata &g = gathered.at(bin);
+        CPPUNIT_ASSERT_EQUAL(tempDirectory_ / "gather" / e.getPath().filename(), g.getPath());
+        CPPUNIT_ASSERT_EQUAL(e.getLength(), g.getLength());
+        CPPUNIT_ASSERT_EQUAL(e.getDataSize(), g.getDataSize());
+        CPPUNIT_ASSERT_EQUAL(e.getSeIdxElements(), g.getSeIdxElements());
+        CPPUNIT_ASSERT_EQUAL(e.getRIdxElements(), g.getRIdxElements());
+        CPPUNIT_ASSERT_EQUAL(e.getFIdxElements(), g.getFIdxElements());
+        CPPUNIT_ASSERT_EQUAL(e.getNmElements(), g.getNmElements());
+        CPPUNIT_ASSERT_EQUAL(e.getTotalCigarLength(), g.getTotalCigarLength());
+        totalElements += g.getTotalElements();
+        CPPUNIT_ASSERT(readFile(e.getPath()) == readFile(g.getPath()));
+    }
+    CPPUNIT_ASSERT_EQUAL((unsigned long)(TILE_CLUSTERS[0] + TILE_CLUSTERS[1]) * 2, totalElements);
+}
+
+void TestGatherTransition::testTemplateLengthStatistics()
+{
+    workflow::alignWorkflow::FoundMatchesMetadata foundMatches(
+        tempDirectory_ / "gather", barcodeMetadataList_, 1, sortedReferenceMetadataList_);
+    alignment::BinMetadataList gathered;
+    std::vector<alignment::TemplateLengthStatistics> barcodeTemplateLengthStatistics;
+    gather(foundMatches, gathered, barcodeTemplateLengthStatistics);
+
+    CPPUNIT_ASSERT_EQUAL(barcodeMetadataList_.size(), barcodeTemplateLengthStatistics.size());
+    CPPUNIT_ASSERT_EQUAL(TEMPLATE_LENGTH_MEDIANS[1], barcodeTemplateLengthStatistics.front().getMedian());
+}
+
+void TestGatherTransition::testStatsXml()
+{
+    workflow::alignWorkflow::FoundMatchesMetadata foundMatches(
+        tempDirectory_ / "gather", barcodeMetadataList_, 1, sortedReferenceMetadataList_);
+    alignment::BinMetadataList gathered;
+    std::vector<alignment::TemplateLengthStatistics> barcodeTemplateLengthStatistics;
+    gather(foundMatches, gathered, barcodeTemplateLengthStatistics);
+
+    // match selector statistics: tiles of both runs end up under the same lane, nothing is summed up
+    bpt::ptree matchSelectorStats;
+    bpt::read_xml((tempDirectory_ / "gather" / "MatchSelectorStats.xml").string(), matchSelectorStats);
+    const bpt::ptree &matchSelectorStatsFlowcell = getChild(matchSelectorStats.get_child("Stats"), "Flowcell", "flowcell-id", "FC1");
+    CPPUNIT_ASSERT_EQUAL(1U, countChildren(matchSelectorStatsFlowcell, "Lane"));
+    const bpt::ptree &matchSelectorStatsLane = getChild(matchSelectorStatsFlowcell, "Lane", "number", "1");
+    CPPUNIT_ASSERT_EQUAL(unsigned(SCATTER_RUNS), countChildren(matchSelectorStatsLane, "Tile"));
+    for (unsigned run = 0; SCATTER_RUNS != run; ++run)
+    {
+        const bpt::ptree &tile = getChild(
+            matchSelectorStatsLane, "Tile", "number", boost::lexical_cast<std::string>(TILE_NUMBERS[run]));
+        CPPUNIT_ASSERT_EQUAL(TILE_CLUSTERS[run], tile.get<unsigned>("Raw.ClusterCount"));
+    }
+
+    // demultiplexing statistics: the counts of the lane shared by both runs are summed up
+    bpt::ptree demultiplexingStats;
+    bpt::read_xml((tempDirectory_ / "gather" / "DemultiplexingStats.xml").string(), demultiplexingStats);
+    const bpt::ptree &demultiplexingStatsFlowcell = getChild(demultiplexingStats.get_child("Stats"), "Flowcell", "flowcell-id", "FC1");
+    const bpt::ptree &lane = getChild(
+        getChild(getChild(getChild(demultiplexingStatsFlowcell, "Project", "name", "default"),
+                          "Sample", "name", "default"), "Barcode", "name", "NoIndex"), "Lane", "number", "1");
+    CPPUNIT_ASSERT_EQUAL(TILE_CLUSTERS[0] + TILE_CLUSTERS[1], lane.get<unsigned>("BarcodeCount"));
+    CPPUNIT_ASSERT_EQUAL(TILE_CLUSTERS[0] + TILE_CLUSTERS[1] - 21, lane.get<unsigned>("PerfectBarcodeCount"));
+    CPPUNIT_ASSERT_EQUAL(21U, lane.get<unsigned>("OneMismatchBarcodeCount"));
+
+    CPPUNIT_ASSERT_EQUAL(1U, countChildren(demultiplexingStatsFlowcell, "Lane"));
+    const bpt::ptree &unknownBarcodes =
+        getChild(demultiplexingStatsFlowcell, "Lane", "number", "1").get_child("TopUnknownBarcodes");
+    CPPUNIT_ASSERT_EQUAL(2U, countChildren(unknownBarcodes, "Barcode"));
+    CPPUNIT_ASSERT_EQUAL(7U, getChild(unknownBarcodes, "Barcode", "sequence", "ACGT").get<unsigned>("<xmlattr>.count"));
+    CPPUNIT_ASSERT_EQUAL(1U, getChild(unknownBarcodes, "Barcode", "sequence", "TTTT").get<unsigned>("<xmlattr>.count"));
+}
@@ -0,0 +1,55 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#ifndef iSAAC_WORKFLOW_TEST_GATHER_TRANSITION_HH
+#define iSAAC_WORKFLOW_TEST_GATHER_TRANSITION_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <boost/filesystem.hpp>
+
+#include "alignment/BinMetadata.hh"
+#include "alignment/TemplateLengthStatistics.hh"
+#include "flowcell/BarcodeMetadata.hh"
+#include "reference/SortedReferenceMetadata.hh"
+#include "workflow/alignWorkflow/FoundMatchesMetadata.hh"
+
+class TestGatherTransition : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( TestGatherTransition );
+    CPPUNIT_TEST( testBins );
+    CPPUNIT_TEST( testTemplateLengthStatistics );
+    CPPUNIT_TEST( testStatsXml );
+    CPPUNIT_TEST_SUITE_END();
+private:
+    boost::filesystem::path tempDirectory_;
+    isaac::reference::SortedReferenceMetadataList sortedReferenceMetadataList_;
+    isaac::flowcell::BarcodeMetadataList barcodeMetadataList_;
+
+    /// bins of a single run that aligns all the tiles the scatter runs have split between themselves
+    isaac::alignment::BinMetadataList storeAllTiles();
+    void writeScatterRun(const unsigned run);
+    void gather(
+        isaac::workflow::alignWorkflow::FoundMatchesMetadata &foundMatches,
+        isaac::alignment::BinMetadataList &selectedMatches,
+        std::vector<isaac::alignment::TemplateLengthStatistics> &barcodeTemplateLengthStatistics);
+public:
+    TestGatherTransition();
+    void setUp();
+    void tearDown();
+    void testBins();
+    void testTemplateLengthStatistics();
+    void testStatsXml();
+};
+
+#endif // #ifndef iSAAC_WORKFLOW_TEST_GATHER_TRANSITION_HH
@@ -0,0 +1,240 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#include <string>
+#include <vector>
+
+#include <boost/foreach.hpp>
+
+#include "RegistryName.hh"
+#include "testPairedEndClusterExtractor.hh"
+
+#include "workflow/alignWorkflow/bamDataSource/PairedEndClusterExtractor.hh"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( TestPairedEndClusterExtractor, registryName("TestPairedEndClusterExtractor"));
+
+using namespace isaac;
+using workflow::alignWorkflow::bamDataSource::IndexRecord;
+using workflow::alignWorkflow::bamDataSource::MateTable;
+using workflow::alignWorkflow::bamDataSource::PairedEndClusterExtractor;
+
+namespace
+{
+
+static const unsigned READ_LENGTH = 4;
+static const unsigned char QUALITY = 30;
+
+template <typename T>
+void appendValue(std::vector<char> &buffer, const T value)
+{
+    buffer.insert(buffer.end(), reinterpret_cast<const char*>(&value), reinterpret_cast<const char*>(&value) + sizeof(value));
+}
+
+unsigned char getBamBase(const char base)
+{
+    switch (base)
+    {
+    case 'A': return 1;
+    case 'C': return 2;
+    case 'G': return 4;
+    case 'T': return 8;
+    default: return 15;
+    }
+}
+
+/// bcl byte that extraction is expected to produce for the base
+char getBcl(const char base)
+{
+    return std::string("ACGT").find(base) | (QUALITY << 2);
+}
+
+std::vector<char> getBcl(const std::string &bases)
+{
+    std::vector<char> ret;
+    for (std::string::const_iterator it = bases.begin(); bases.end() != it; ++it)
+    {
+        ret.push_back(getBcl(*it));
+    }
+    return ret;
+}
+
+std::vector<char> getCluster(const std::string &r1Bases, const std::string &r2Bases)
+{
+    std::vector<char> ret = getBcl(r1Bases);
+    const std::vector<char> r2 = getBcl(r2Bases);
+    ret.insert(ret.end(), r2.begin(), r2.end());
+    ret.resize(READ_LENGTH * 2, 0);
+    return ret;
+}
+
+} // namespace
+
+TestPairedEndClusterExtractor::TestPairedEndClusterExtractor()
+{
+    readMetadataList_.push_back(flowcell::ReadMetadata(1, READ_LENGTH, 0, 0));
+    readMetadataList_.push_back(flowcell::ReadMetadata(READ_LENGTH + 1, READ_LENGTH * 2, 1, READ_LENGTH));
+}
+
+void TestPairedEndClusterExtractor::setUp()
+{
+    tempDirectory_ = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("testPairedEndClusterExtractor-%%%%%%%%");
+    boost::filesystem::create_directories(tempDirectory_);
+    bamBuffer_.clear();
+    recordOffsets_.clear();
+}
+
+void TestPairedEndClusterExtractor::tearDown()
+{
+    boost::filesystem::remove_all(tempDirectory_);
+}
+
+/**
+ * \brief Appends an unaligned bam record without the block_size field
+ */
+void TestPairedEndClusterExtractor::appendRecord(const std::string &name, const bool readOne, const std::string &bases)
+{
+    // block_size keeps the records 4-byte aligned in the bam buffer
+    bamBuffer_.resize((bamBuffer_.size() + 3) & ~3UL);
+    recordOffsets_.push_back(bamBuffer_.size());
+
+    appendValue(bamBuffer_, int(-1));
+    appendValue(bamBuffer_, int(-1));
+    appendValue(bamBuffer_, unsigned(name.size() + 1));
+    appendValue(bamBuffer_, unsigned(bam::BamBlockHeader::MULTI_SEGMENT |
+        (readOne ? bam::BamBlockHeader::FIRST_SEGMENT : bam::BamBlockHeader::LAST_SEGMENT)));
+    appendValue(bamBuffer_, int(bases.size()));
+    appendValue(bamBuffer_, int(-1));
+    appendValue(bamBuffer_, int(-1));
+    appendValue(bamBuffer_, int(0));
+    bamBuffer_.insert(bamBuffer_.end(), name.c_str(), name.c_str() + name.size() + 1);
+    for (std::size_t i = 0; bases.size() > i; i += 2)
+    {
+        const unsigned char high = getBamBase(bases[i]);
+        const unsigned char low = bases.size() > i + 1 ? getBamBase(bases[i + 1]) : 0;
+        bamBuffer_.push_back(char((high << 4) | low));
+    }
+    bamBuffer_.insert(bamBuffer_.end(), bases.size(), char(QUALITY));
+}
+
+void TestPairedEndClusterExtractor::testMateTable()
+{
+    appendRecord("pairA", true, "ACGT");
+    appendRecord("pairB", true, "ACGT");
+    appendRecord("pairB", false, "ACGT");
+    appendRecord("pairA", false, "ACGT");
+    // same last 8 characters, different names
+    appendRecord("X:12345678", true, "ACGT");
+    appendRecord("Y:12345678", false, "ACGT");
+    appendRecord("pairA", true, "ACGT");
+
+    std::vector<IndexRecord> index;
+    BOOST_FOREACH(const std::size_t offset, recordOffsets_)
+    {
+        index.push_back(IndexRecord(*reinterpret_cast<const bam::BamBlockHeader*>(&bamBuffer_.at(offset))));
+    }
+    CPPUNIT_ASSERT_EQUAL(index.at(4).nameHash_, index.at(5).nameHash_);
+
+    MateTable mateTable(index.size());
+    CPPUNIT_ASSERT_EQUAL(MateTable::NO_MATE, mateTable.pairOrInsert(index, 0));
+    CPPUNIT_ASSERT_EQUAL(MateTable::NO_MATE, mateTable.pairOrInsert(index, 1));
+    CPPUNIT_ASSERT_EQUAL(1U, mateTable.pairOrInsert(index, 2));
+    CPPUNIT_ASSERT_EQUAL(0U, mateTable.pairOrInsert(index, 3));
+    CPPUNIT_ASSERT_EQUAL(MateTable::NO_MATE, mateTable.pairOrInsert(index, 4));
+    CPPUNIT_ASSERT_EQUAL(MateTable::NO_MATE, mateTable.pairOrInsert(index, 5));
+    // the pair of pairA is complete. A third record with the same name waits for a mate of its own
+    CPPUNIT_ASSERT_EQUAL(MateTable::NO_MATE, mateTable.pairOrInsert(index, 6));
+    CPPUNIT_ASSERT_EQUAL(6U, mateTable.pairOrInsert(index, 3));
+
+    mateTable.clear();
+    CPPUNIT_ASSERT_EQUAL(MateTable::NO_MATE, mateTable.pairOrInsert(index, 3));
+}
+
+void TestPairedEndClusterExtractor::testOutputFullAtLastPair()
+{
+    appendRecord("pairA", true, "AACC");
+    appendRecord("pairB", true, "CCGG");
+    appendRecord("single", true, "TTTT");
+    appendRecord("pairA", false, "GGTT");
+    appendRecord("pairB", false, "TTAA");
+
+    PairedEndClusterExtractor extractor(tempDirectory_, bamBuffer_.size(), 3, READ_LENGTH * 2, true);
+    extractor.open("FC1");
+
+    // room for exactly the two pairs
+    unsigned clusterCount = 2;
+    std::vector<char> clusters(READ_LENGTH * 2 * clusterCount);
+    std::vector<bool> pf(clusterCount);
+    std::vector<char>::iterator clusterIt = clusters.begin();
+    std::vector<bool>::iterator pfIt = pf.begin();
+    bool wantMore = true;
+    BOOST_FOREACH(const std::size_t offset, recordOffsets_)
+    {
+        wantMore = extractor.append(
+            *reinterpret_cast<const bam::BamBlockHeader*>(&bamBuffer_.at(offset)), recordOffsets_.back() == offset,
+            clusterCount, readMetadataList_, clusterIt, pfIt);
+    }
+    CPPUNIT_ASSERT(!wantMore);
+    CPPUNIT_ASSERT_EQUAL(0U, clusterCount);
+    CPPUNIT_ASSERT(clusters.end() == clusterIt);
+    CPPUNIT_ASSERT(extractor.isEmpty());
+    // only the unpaired record remains
+    CPPUNIT_ASSERT_EQUAL(1UL, (unsigned long)extractor.size());
+    CPPUNIT_ASSERT(getCluster("AACC", "GGTT") == std::vector<char>(clusters.begin(), clusters.begin() + READ_LENGTH * 2));
+    CPPUNIT_ASSERT(getCluster("CCGG", "TTAA") == std::vector<char>(clusters.begin() + READ_LENGTH * 2, clusters.end()));
+
+    // the loader releases the buffer. Only the record without a mate goes to the temporary files
+    extractor.removeOld(&bamBuffer_.front(), &bamBuffer_.front() + bamBuffer_.size(), readMetadataList_);
+    CPPUNIT_ASSERT_EQUAL(0UL, (unsigned long)extractor.size());
+
+    extractor.startExtractingUnpaired();
+    clusterCount = 2;
+    clusterIt = clusters.begin();
+    pfIt = pf.begin();
+    CPPUNIT_ASSERT_EQUAL(1U, extractor.extractUnpaired(READ_LENGTH, READ_LENGTH, clusterCount, clusterIt, pfIt));
+    CPPUNIT_ASSERT(clusters.begin() + READ_LENGTH * 2 == clusterIt);
+    CPPUNIT_ASSERT(getCluster("TTTT", "") == std::vector<char>(clusters.begin(), clusterIt));
+}
+
+void TestPairedEndClusterExtractor::testResumeExtraction()
+{
+    appendRecord("pairA", true, "AACC");
+    appendRecord("pairB", true, "CCGG");
+    appendRecord("pairA", false, "GGTT");
+    appendRecord("pairB", false, "TTAA");
+
+    PairedEndClusterExtractor extractor(tempDirectory_, bamBuffer_.size(), 3, READ_LENGTH * 2, true);
+    extractor.open("FC1");
+
+    unsigned clusterCount = 1;
+    std::vector<char> clusters(READ_LENGTH * 2);
+    std::vector<bool> pf(1);
+    std::vector<char>::iterator clusterIt = clusters.begin();
+    std::vector<bool>::iterator pfIt = pf.begin();
+    BOOST_FOREACH(const std::size_t offset, recordOffsets_)
+    {
+        extractor.append(
+            *reinterpret_cast<const bam::BamBlockHeader*>(&bamBuffer_.at(offset)), recordOffsets_.back() == offset,
+            clusterCount, readMetadataList_, clusterIt, pfIt);
+    }
+    CPPUNIT_ASSERT_EQUAL(0U, clusterCount);
+    CPPUNIT_ASSERT(!extractor.isEmpty());
+    CPPUNIT_ASSERT(getCluster("AACC", "GGTT") == clusters);
+
+    // the next call picks up the pending pair and compacts the index
+    clusterIt = clusters.begin();
+    pfIt = pf.begin();
+    CPPUNIT_ASSERT_EQUAL(0U, extractor.extractPairedReads(1, clusterIt, pfIt, readMetadataList_));
+    CPPUNIT_ASSERT(getCluster("CCGG", "TTAA") == clusters);
+    CPPUNIT_ASSERT(extractor.isEmpty());
+    CPPUNIT_ASSERT_EQUAL(0UL, (unsigned long)extractor.size());
+}
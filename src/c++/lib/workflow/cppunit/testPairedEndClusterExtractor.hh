@@ -0,0 +1,46 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#ifndef iSAAC_WORKFLOW_TEST_PAIRED_END_CLUSTER_EXTRACTOR_HH
+#define iSAAC_WORKFLOW_TEST_PAIRED_END_CLUSTER_EXTRACTOR_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <boost/filesystem.hpp>
+
+#include "flowcell/ReadMetadata.hh"
+
+class TestPairedEndClusterExtractor : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( TestPairedEndClusterExtractor );
+    CPPUNIT_TEST( testMateTable );
+    CPPUNIT_TEST( testOutputFullAtLastPair );
+    CPPUNIT_TEST( testResumeExtraction );
+    CPPUNIT_TEST_SUITE_END();
+private:
+    boost::filesystem::path tempDirectory_;
+    isaac::flowcell::ReadMetadataList readMetadataList_;
+    std::vector<char> bamBuffer_;
+    std::vector<std::size_t> recordOffsets_;
+
+    void appendRecord(const std::string &name, const bool readOne, const std::string &bases);
+public:
+    TestPairedEndClusterExtractor();
+    void setUp();
+    void tearDown();
+    void testMateTable();
+    void testOutputFullAtLastPair();
+    void testResumeExtraction();
+};
+
+#endif // #ifndef iSAAC_WORKFLOW_TEST_PAIRED_END_CLUSTER_EXTRACTOR_HH
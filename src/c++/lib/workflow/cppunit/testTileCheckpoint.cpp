@@ -0,0 +1,173 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <boost/foreach.hpp>
+
+#include "RegistryName.hh"
+#include "testTileCheckpoint.hh"
+
+#include "workflow/AlignWorkflowSerialization.hh"
+#include "workflow/alignWorkflow/TileCheckpoint.hh"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( TestTileCheckpoint, registryName("TestTileCheckpoint"));
+
+using namespace isaac;
+using workflow::alignWorkflow::MatchSelectorCheckpoint;
+
+namespace
+{
+
+void writeFile(const boost::filesystem::path &path, const std::string &content)
+{
+    std::ofstream os(path.c_str());
+    os << content;
+    CPPUNIT_ASSERT(os);
+}
+
+flowcell::TileMetadataList firstTiles(const flowcell::TileMetadataList &tiles, const unsigned count)
+{
+    flowcell::TileMetadataList ret;
+    ret.insert(ret.end(), tiles.begin(), tiles.begin() + count);
+    return ret;
+}
+
+MatchSelectorCheckpoint makeCheckpoint(
+    const flowcell::TileMetadataList &completeTiles,
+    const boost::filesystem::path &binPath,
+    const unsigned long binDataSize)
+{
+    MatchSelectorCheckpoint ret;
+    ret.completeTiles_ = completeTiles;
+    ret.storedTiles_ = completeTiles.size();
+    ret.binMetadataList_.push_back(
+        alignment::BinMetadata(1, 1, reference::ReferencePosition(0, 0), 10000, binPath, 1));
+    ret.binMetadataList_.back().incrementDataSize(reference::ReferencePosition(0, 100), binDataSize);
+    ret.barcodeTemplateLengthStatistics_.push_back(
+        alignment::TemplateLengthStatistics(200, 500, 350, 30, 40,
+                                            alignment::TemplateLengthStatistics::FRp,
+                                            alignment::TemplateLengthStatistics::FRp, 0));
+    return ret;
+}
+
+} // namespace
+
+TestTileCheckpoint::TestTileCheckpoint()
+{
+    tileMetadataList_.push_back(flowcell::TileMetadata("FC1", 0, 1101, 1, 1000, 0));
+    tileMetadataList_.push_back(flowcell::TileMetadata("FC1", 0, 1102, 1, 2000, 1));
+    tileMetadataList_.push_back(flowcell::TileMetadata("FC1", 0, 1101, 2, 3000, 2));
+}
+
+void TestTileCheckpoint::setUp()
+{
+    tempDirectory_ = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("testTileCheckpoint-%%%%%%%%");
+    boost::filesystem::create_directories(tempDirectory_);
+}
+
+void TestTileCheckpoint::tearDown()
+{
+    boost::filesystem::remove_all(tempDirectory_);
+}
+
+void TestTileCheckpoint::testCheckpointedTile()
+{
+    const flowcell::TileMetadataList completeTiles = firstTiles(tileMetadataList_, 2);
+    CPPUNIT_ASSERT(workflow::alignWorkflow::isCheckpointedTile(completeTiles, tileMetadataList_.at(0)));
+    CPPUNIT_ASSERT(workflow::alignWorkflow::isCheckpointedTile(completeTiles, tileMetadataList_.at(1)));
+    // not in the checkpoint
+    CPPUNIT_ASSERT(!workflow::alignWorkflow::isCheckpointedTile(completeTiles, tileMetadataList_.at(2)));
+    // same index but the tile has changed since the checkpoint was made
+    CPPUNIT_ASSERT(!workflow::alignWorkflow::isCheckpointedTile(
+        completeTiles, flowcell::TileMetadata("FC1", 0, 1102, 1, 2001, 1)));
+    CPPUNIT_ASSERT(!workflow::alignWorkflow::isCheckpointedTile(
+        completeTiles, flowcell::TileMetadata("FC1", 0, 1101, 2, 2000, 1)));
+    CPPUNIT_ASSERT(!workflow::alignWorkflow::isCheckpointedTile(
+        flowcell::TileMetadataList(), tileMetadataList_.at(0)));
+}
+
+void TestTileCheckpoint::testMatchSelectorCheckpoint()
+{
+    const boost::filesystem::path checkpointPath = MatchSelectorCheckpoint::getPath(tempDirectory_);
+    const boost::filesystem::path binPath = tempDirectory_ / "bin-0001.dat";
+
+    // the second save replaces the first one
+    workflow::alignWorkflow::saveCheckpoint(
+        checkpointPath, makeCheckpoint(firstTiles(tileMetadataList_, 1), binPath, 100));
+    workflow::alignWorkflow::saveCheckpoint(
+        checkpointPath, makeCheckpoint(firstTiles(tileMetadataList_, 2), binPath, 300));
+    CPPUNIT_ASSERT(boost::filesystem::exists(checkpointPath));
+    CPPUNIT_ASSERT(!boost::filesystem::exists(checkpointPath.string() + ".tmp"));
+
+    MatchSelectorCheckpoint loaded;
+    CPPUNIT_ASSERT(workflow::alignWorkflow::loadCheckpoint(checkpointPath, loaded));
+
+    CPPUNIT_ASSERT_EQUAL(2UL, loaded.completeTiles_.size());
+    CPPUNIT_ASSERT_EQUAL(2U, loaded.storedTiles_);
+    for (unsigned i = 0; loaded.completeTiles_.size() != i; ++i)
+    {
+        CPPUNIT_ASSERT(workflow::alignWorkflow::isCheckpointedTile(loaded.completeTiles_, tileMetadataList_.at(i)));
+    }
+    CPPUNIT_ASSERT(!workflow::alignWorkflow::isCheckpointedTile(loaded.completeTiles_, tileMetadataList_.at(2)));
+
+    CPPUNIT_ASSERT_EQUAL(1UL, loaded.binMetadataList_.size());
+    const alignment::BinMetadata &bin = loaded.binMetadataList_.front();
+    CPPUNIT_ASSERT_EQUAL(1U, bin.getIndex());
+    CPPUNIT_ASSERT_EQUAL(binPath, bin.getPath());
+    CPPUNIT_ASSERT_EQUAL(10000UL, bin.getLength());
+    CPPUNIT_ASSERT_EQUAL(300UL, bin.getDataSize());
+
+    CPPUNIT_ASSERT_EQUAL(1UL, loaded.barcodeTemplateLengthStatistics_.size());
+    const alignment::TemplateLengthStatistics &tls = loaded.barcodeTemplateLengthStatistics_.front();
+    CPPUNIT_ASSERT_EQUAL(200U, tls.getMin());
+    CPPUNIT_ASSERT_EQUAL(500U, tls.getMax());
+    CPPUNIT_ASSERT_EQUAL(350U, tls.getMedian());
+    CPPUNIT_ASSERT_EQUAL(30U, tls.getLowStdDev());
+}
+
+void TestTileCheckpoint::testMissingCheckpoint()
+{
+    const boost::filesystem::path checkpointPath = MatchSelectorCheckpoint::getPath(tempDirectory_);
+    MatchSelectorCheckpoint checkpoint;
+    CPPUNIT_ASSERT(!workflow::alignWorkflow::loadCheckpoint(checkpointPath, checkpoint));
+
+    // a checkpoint that cannot be read is the same as no checkpoint at all
+    writeFile(checkpointPath, "not a checkpoint");
+    CPPUNIT_ASSERT(!workflow::alignWorkflow::loadCheckpoint(checkpointPath, checkpoint));
+    CPPUNIT_ASSERT(checkpoint.completeTiles_.empty());
+}
+
+void TestTileCheckpoint::testRemoveCheckpoint()
+{
+    const boost::filesystem::path checkpointPath = MatchSelectorCheckpoint::getPath(tempDirectory_);
+    workflow::alignWorkflow::saveCheckpoint(
+        checkpointPath, makeCheckpoint(tileMetadataList_, tempDirectory_ / "bin-0001.dat", 100));
+    BOOST_FOREACH(const flowcell::TileMetadata &tile, tileMetadataList_)
+    {
+        writeFile(MatchSelectorCheckpoint::getTileStatsPath(tempDirectory_, tile), "stats");
+    }
+    const boost::filesystem::path unrelatedPath = tempDirectory_ / "MatchFinderCheckpoint.txt";
+    writeFile(unrelatedPath, "unrelated");
+
+    workflow::alignWorkflow::removeCheckpoint(checkpointPath, tempDirectory_, tileMetadataList_);
+
+    CPPUNIT_ASSERT(!boost::filesystem::exists(checkpointPath));
+    BOOST_FOREACH(const flowcell::TileMetadata &tile, tileMetadataList_)
+    {
+        CPPUNIT_ASSERT(!boost::filesystem::exists(MatchSelectorCheckpoint::getTileStatsPath(tempDirectory_, tile)));
+    }
+    CPPUNIT_ASSERT(boost::filesystem::exists(unrelatedPath));
+}
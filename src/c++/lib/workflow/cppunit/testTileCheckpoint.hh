@@ -0,0 +1,44 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#ifndef iSAAC_WORKFLOW_TEST_TILE_CHECKPOINT_HH
+#define iSAAC_WORKFLOW_TEST_TILE_CHECKPOINT_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <boost/filesystem.hpp>
+
+#include "flowcell/TileMetadata.hh"
+
+class TestTileCheckpoint : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( TestTileCheckpoint );
+    CPPUNIT_TEST( testCheckpointedTile );
+    CPPUNIT_TEST( testMatchSelectorCheckpoint );
+    CPPUNIT_TEST( testMissingCheckpoint );
+    CPPUNIT_TEST( testRemoveCheckpoint );
+    CPPUNIT_TEST_SUITE_END();
+private:
+    boost::filesystem::path tempDirectory_;
+    isaac::flowcell::TileMetadataList tileMetadataList_;
+public:
+    TestTileCheckpoint();
+    void setUp();
+    void tearDown();
+    void testCheckpointedTile();
+    void testMatchSelectorCheckpoint();
+    void testMissingCheckpoint();
+    void testRemoveCheckpoint();
+};
+
+#endif // #ifndef iSAAC_WORKFLOW_TEST_TILE_CHECKPOINT_HH
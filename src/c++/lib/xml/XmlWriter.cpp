@@ -17,6 +17,8 @@
  ** \author Roman Petrovski
  **/
 
+#include <limits>
+
 #include "xml/XmlWriter.hh"
 
 
@@ -43,7 +45,7 @@ int XmlWriter::xmlOutputWriteCallback(void *context, const char *buffer, int len
     return len;
 }
 
-XmlWriter::XmlWriter(std::ostream &os) :
+XmlWriter::XmlWriter(std::ostream &os, const bool fragment) :
     os_(os),
     xmlWriter_(xmlNewTextWriter(xmlOutputBufferCreateIO(xmlOutputWriteCallback, 0, &os_, 0)))
 {
@@ -52,6 +54,11 @@ XmlWriter::XmlWriter(std::ostream &os) :
         BOOST_THROW_EXCEPTION(XmlWriterException("xmlNewTextWriter failed"));
     }
 
+    if (fragment)
+    {
+        return;
+    }
+
     int written = xmlTextWriterStartDocument(xmlWriter_, 0, 0, 0);
     if (-1 == written)
     {
@@ -83,6 +90,14 @@ void XmlWriter::close()
     }
 }
 
+void XmlWriter::flush()
+{
+    if (-1 == xmlTextWriterFlush(xmlWriter_))
+    {
+        BOOST_THROW_EXCEPTION(XmlWriterException(std::string("xmlTextWriterFlush returned -1")));
+    }
+}
+
 XmlWriter &XmlWriter::startElement(const char *name)
 {
     const int written = xmlTextWriterStartElement(xmlWriter_, BAD_CAST name);
@@ -113,6 +128,18 @@ XmlWriter &XmlWriter::writeText(const char *text)
     return *this;
 }
 
+XmlWriter &XmlWriter::writeRaw(const char *xml, const std::size_t length)
+{
+    ISAAC_ASSERT_MSG(std::size_t(std::numeric_limits<int>::max()) >= length,
+                     "Raw xml piece is too long for xmlTextWriterWriteRawLen: " << length);
+    const int written = xmlTextWriterWriteRawLen(xmlWriter_, BAD_CAST xml, int(length));
+    if (-1 == written)
+    {
+        BOOST_THROW_EXCEPTION(XmlWriterException(std::string("xmlTextWriterWriteRawLen returned -1 ")));
+    }
+    return *this;
+}
+
 
 } // namespace xml
 } // namespace isaac
@@ -0,0 +1,47 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file generateSyntheticData.cpp
+ **
+ ** The main for the synthetic benchmark data generator.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include "common/Debug.hh"
+#include "options/SyntheticDataOptions.hh"
+#include "workflow/SyntheticDataWorkflow.hh"
+
+void generateSyntheticData(const isaac::options::SyntheticDataOptions &options)
+{
+    isaac::workflow::SyntheticDataWorkflow workflow(
+        options.outputDirectory_,
+        options.randomSeed_,
+        options.contigsCount_,
+        options.contigLength_,
+        options.clustersCount_,
+        options.tilesCount_,
+        options.readLength_,
+        options.fragmentLength_,
+        options.fragmentLengthDeviation_,
+        options.errorRate_,
+        options.indelRate_,
+        options.duplicateRate_,
+        options.outputFormats_);
+
+    workflow.run();
+}
+
+int main(int argc, char *argv[])
+{
+    isaac::common::run(generateSyntheticData, argc, argv);
+}
@@ -109,7 +109,7 @@ exclude-result-prefixes="str math"
     </xsl:call-template>
     
 
-<xsl:if test="../../../@flowcell-id!='all'">
+<xsl:if test="../../../@flowcell-id!='all' and not($SUMMARY_ONLY_PARAM)">
 <p>
 Flowcell Tile Mismatch Graphs
     <xsl:element name="a"><xsl:attribute name="href">../../../../<xsl:call-template name="getFlowcellMismatchGraphsPfLocalPath"/></xsl:attribute>Pf</xsl:element>
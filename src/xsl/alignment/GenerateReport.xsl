@@ -28,6 +28,7 @@ exclude-result-prefixes="str math"
 > 
 
 <xsl:variable name="DEMULTIPLEXING_STATS_XML" select="document($DEMULTIPLEXING_STATS_XML_PARAM)"/>
+<xsl:variable name="PROFILING_STATS_XML" select="document($PROFILING_STATS_XML_PARAM)"/>
 
 <xsl:include href="../common/Utils.xsl"/>
 <xsl:include href="NameUtils.xsl"/>
@@ -36,6 +37,7 @@ exclude-result-prefixes="str math"
 <xsl:include href="LaneSummary.xsl"/>
 <xsl:include href="FlowcellSummaryPage.xsl"/>
 <xsl:include href="TileMismatchPages.xsl"/>
+<xsl:include href="ProfilingPage.xsl"/>
 
 <xsl:variable name="homeFilePath" select="concat($OUTPUT_DIRECTORY_HTML_PARAM, '/index.html')"/>
 
@@ -44,34 +46,18 @@ exclude-result-prefixes="str math"
 <xsl:variable name="inputCssFilePath" select="concat($iSAAC_FULL_DATADIR_PARAM, '/css/Report.css.xml')"/>
 
 
+<!--
+    The work is split into PARTITIONS_PARAM transforms that can run concurrently. Partition 0 produces the
+    pages that exist once per report. Barcode pages and per-lane gnuplot scripts are distributed between
+    the partitions by their position in the document.
+-->
 <xsl:template match="/"> 
 
+    <xsl:if test="0 = $PARTITION_PARAM">
     <exsl:document href="{$outputCssFilePath}" method="text">
         <xsl:value-of select="document($inputCssFilePath)/css"/>
     </exsl:document>
     
-    <exsl:document href="{$GNUPLOT_SCRIPT_PATH_PARAM}" method="text">
-        <xsl:for-each select="/Stats/Flowcell">
-            <xsl:variable name="flowcellNode" select="."/>
-            <xsl:call-template name="generateTileMismatchGraphsGnuplotScript">
-                <xsl:with-param name="flowcellNode" select="$flowcellNode"/>
-                <xsl:with-param name="pf" select="'Pf'"/>
-            </xsl:call-template>
-            <xsl:call-template name="generateTileMismatchGraphsGnuplotScript">
-                <xsl:with-param name="flowcellNode" select="$flowcellNode"/>
-                <xsl:with-param name="pf" select="'Raw'"/>
-            </xsl:call-template>
-            <xsl:call-template name="generateTileMismatchCurvesGnuplotScript">
-                <xsl:with-param name="flowcellNode" select="$flowcellNode"/>
-                <xsl:with-param name="pf" select="'Pf'"/>
-            </xsl:call-template>
-            <xsl:call-template name="generateTileMismatchCurvesGnuplotScript">
-                <xsl:with-param name="flowcellNode" select="$flowcellNode"/>
-                <xsl:with-param name="pf" select="'Raw'"/>
-            </xsl:call-template>
-        </xsl:for-each>
-    </exsl:document>
-    
     <exsl:document href="{$homeFilePath}" method="html" version="4.0" indent="yes">
 <html>
     <frameset cols="15%, 85%">
@@ -86,10 +72,66 @@ exclude-result-prefixes="str math"
 </html>
     </exsl:document>
     
+    <xsl:variable name="profilingPageFilePath"><xsl:call-template name="getProfilingGlobalPath"/></xsl:variable>
+    <exsl:document href="{$profilingPageFilePath}" method="html" version="4.0" indent="yes">
+        <xsl:call-template name="generateProfilingPage">
+            <xsl:with-param name="profilingNode" select="$PROFILING_STATS_XML/Profiling"/>
+        </xsl:call-template>
+    </exsl:document>
+    </xsl:if>
+
+    <!-- empty GNUPLOT_SCRIPT_DIRECTORY_PARAM means no images are needed -->
+    <xsl:if test="string-length($GNUPLOT_SCRIPT_DIRECTORY_PARAM)">
+        <xsl:for-each select="/Stats/Flowcell[@flowcell-id!='all']/Lane">
+            <xsl:if test="(position() - 1) mod $PARTITIONS_PARAM = $PARTITION_PARAM">
+                <xsl:call-template name="generateLaneGnuplotScripts">
+                    <xsl:with-param name="flowcellNode" select=".."/>
+                    <xsl:with-param name="laneNumber" select="@number"/>
+                </xsl:call-template>
+            </xsl:if>
+        </xsl:for-each>
+    </xsl:if>
+
     <xsl:apply-templates/>
 </xsl:template>
 
+<xsl:template name="generateLaneGnuplotScripts">
+    <xsl:param name="flowcellNode"/>
+    <xsl:param name="laneNumber"/>
+    <xsl:variable name="scriptPathPrefix" select="concat($GNUPLOT_SCRIPT_DIRECTORY_PARAM, '/', $flowcellNode/@flowcell-id, '-L', $laneNumber)"/>
+
+    <exsl:document href="{concat($scriptPathPrefix, '-mismatch-graphs-Pf.gnuplot')}" method="text">
+        <xsl:call-template name="generateTileMismatchGraphsGnuplotScript">
+            <xsl:with-param name="flowcellNode" select="$flowcellNode"/>
+            <xsl:with-param name="laneNumber" select="$laneNumber"/>
+            <xsl:with-param name="pf" select="'Pf'"/>
+        </xsl:call-template>
+    </exsl:document>
+    <exsl:document href="{concat($scriptPathPrefix, '-mismatch-graphs-Raw.gnuplot')}" method="text">
+        <xsl:call-template name="generateTileMismatchGraphsGnuplotScript">
+            <xsl:with-param name="flowcellNode" select="$flowcellNode"/>
+            <xsl:with-param name="laneNumber" select="$laneNumber"/>
+            <xsl:with-param name="pf" select="'Raw'"/>
+        </xsl:call-template>
+    </exsl:document>
+    <exsl:document href="{concat($scriptPathPrefix, '-mismatch-curves-Pf.gnuplot')}" method="text">
+        <xsl:call-template name="generateTileMismatchCurvesGnuplotScript">
+            <xsl:with-param name="flowcellNode" select="$flowcellNode"/>
+            <xsl:with-param name="laneNumber" select="$laneNumber"/>
+            <xsl:with-param name="pf" select="'Pf'"/>
+        </xsl:call-template>
+    </exsl:document>
+    <exsl:document href="{concat($scriptPathPrefix, '-mismatch-curves-Raw.gnuplot')}" method="text">
+        <xsl:call-template name="generateTileMismatchCurvesGnuplotScript">
+            <xsl:with-param name="flowcellNode" select="$flowcellNode"/>
+            <xsl:with-param name="laneNumber" select="$laneNumber"/>
+            <xsl:with-param name="pf" select="'Raw'"/>
+        </xsl:call-template>
+    </exsl:document>
+</xsl:template>
+
 <xsl:template match="/Stats">
+    <xsl:if test="0 = $PARTITION_PARAM">
     <xsl:variable name="flowcellsPageFilePath"><xsl:call-template name="getFlowcellRefsGlobalPath"/></xsl:variable>
     <exsl:document href="{$flowcellsPageFilePath}" method="html" version="4.0" indent="yes">
 
@@ -183,9 +225,22 @@ exclude-result-prefixes="str math"
                 </xsl:for-each>
             </xsl:for-each>
         </xsl:for-each>
+    <tr><td colspan="4">
+        <xsl:element name="a">
+            <xsl:attribute name="href"><xsl:call-template name="getProfilingLocalPath"/></xsl:attribute>
+            <xsl:attribute name="target">flowcellsummaryframe</xsl:attribute>
+            <xsl:value-of select="'[timing]'"/>
+        </xsl:element>
+    </td></tr>
 </table>
     </exsl:document>
-    <xsl:apply-templates/>
+    </xsl:if>
+
+    <xsl:for-each select="Flowcell/Project/Sample/Barcode">
+        <xsl:if test="(position() - 1) mod $PARTITIONS_PARAM = $PARTITION_PARAM">
+            <xsl:apply-templates select="."/>
+        </xsl:if>
+    </xsl:for-each>
 </xsl:template>
 
 <xsl:template match="/Stats/Flowcell/Project/Sample/Barcode">
@@ -211,6 +266,7 @@ exclude-result-prefixes="str math"
 </xsl:template>
 
 <xsl:template match="/Stats/Flowcell[@flowcell-id!='all']/Project[@name='all']/Sample[@name='all']/Barcode[@name='all']">
+    <xsl:if test="not($SUMMARY_ONLY_PARAM)">
     <xsl:variable name="mismatchGraphsPfFilePath"><xsl:call-template name="getFlowcellMismatchGraphsPfGlobalPath"/></xsl:variable>
     <exsl:document href="{$mismatchGraphsPfFilePath}" method="html" version="4.0" indent="yes">
         <xsl:call-template name="generateTileMismatchGraphsPfPage">
@@ -238,7 +294,8 @@ exclude-result-prefixes="str math"
             <xsl:with-param name="flowcellNode" select="../../.."/>
         </xsl:call-template>
     </exsl:document>
-    
+    </xsl:if>
+
     <xsl:variable name="flowcellSummaryPageFilePath"><xsl:call-template name="getFlowcellSampleBarcodeGlobalPath"/></xsl:variable>
     <xsl:variable name="flowcellSimpleSummaryPageFilePath"><xsl:call-template name="getFlowcellSampleBarcodeSimpleGlobalPath"/></xsl:variable>
 
@@ -68,6 +68,15 @@ xmlns:isaac="http://www.illumina.com/isaac"
     <xsl:value-of select="concat($OUTPUT_DIRECTORY_HTML_PARAM, '/', $flowcellRefsLocalPath)"/>
 </xsl:template>
 
+<xsl:template name="getProfilingLocalPath">
+    <xsl:value-of select="'timing.html'"/>
+</xsl:template>
+
+<xsl:template name="getProfilingGlobalPath">
+    <xsl:variable name="profilingLocalPath" ><xsl:call-template name="getProfilingLocalPath"/></xsl:variable>
+    <xsl:value-of select="concat($OUTPUT_DIRECTORY_HTML_PARAM, '/', $profilingLocalPath)"/>
+</xsl:template>
+
 
 <xsl:template name="getFlowcellMismatchGraphsPfLocalPath">
     <xsl:param name="flowcellId" select="../../../@flowcell-id"/>
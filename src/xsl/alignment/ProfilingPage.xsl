@@ -0,0 +1,144 @@
+<?xml version="1.0"?>
+<!--
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file ProfilingPage.xsl
+ **
+ ** \brief Wall and cpu time spent in the processing stages, as recorded in ProfilingStats.xml
+ **
+ ** \author Roman Petrovski
+ **/
+-->
+<xsl:stylesheet version="1.0" 
+xmlns:xsl="http://www.w3.org/1999/XSL/Transform" 
+xmlns:isaac="http://www.illumina.com/isaac"
+xmlns:str="http://exslt.org/strings"
+xmlns:math="http://exslt.org/math"
+exclude-result-prefixes="str math"
+> 
+
+<xsl:template name="generateProfilingCountersCells">
+    <td><xsl:value-of select="format-number(Calls, '###,###,###,###,###')"/></td>
+    <td><xsl:value-of select="format-number(WallMs div 1000, '###,###,###,##0.00')"/></td>
+    <td><xsl:value-of select="format-number(CpuMs div 1000, '###,###,###,##0.00')"/></td>
+    <td><xsl:value-of select="format-number(Bytes div 1000000, '###,###,###,##0.00')"/></td>
+    <td><xsl:value-of select="format-number(Items, '###,###,###,###,###')"/></td>
+</xsl:template>
+
+<xsl:template name="generateProfilingStepsTable">
+    <xsl:param name="profilingNode"/>
+    <xsl:if test="$profilingNode/Step">
+    <table border="1" ID="ReportTable">
+    <tr><th>Step</th><th>Wall (s)</th><th>User CPU (s)</th><th>System CPU (s)</th><th>Peak RSS (MB)</th><th>MBytes read</th><th>MBytes written</th></tr>
+    <xsl:for-each select="$profilingNode/Step">
+    <tr>
+        <td><xsl:value-of select="@name"/></td>
+        <td><xsl:value-of select="format-number(WallMs div 1000, '###,###,###,##0.00')"/></td>
+        <td><xsl:value-of select="format-number(UserCpuMs div 1000, '###,###,###,##0.00')"/></td>
+        <td><xsl:value-of select="format-number(SystemCpuMs div 1000, '###,###,###,##0.00')"/></td>
+        <td><xsl:value-of select="format-number(PeakRssKb div 1000, '###,###,###,##0.00')"/></td>
+        <td><xsl:value-of select="format-number(BytesRead div 1000000, '###,###,###,##0.00')"/></td>
+        <td><xsl:value-of select="format-number(BytesWritten div 1000000, '###,###,###,##0.00')"/></td>
+    </tr>
+    </xsl:for-each>
+    </table>
+    </xsl:if>
+</xsl:template>
+
+<xsl:template name="generateProfilingStagesTable">
+    <xsl:param name="profilingNode"/>
+    <table border="1" ID="ReportTable">
+    <tr><th>Step</th><th>Stage</th><th>Calls</th><th>Wall (s)</th><th>CPU (s)</th><th>MBytes</th><th>Items</th></tr>
+    <xsl:for-each select="$profilingNode/Stage">
+    <tr>
+        <td><xsl:value-of select="@step"/></td>
+        <td><xsl:value-of select="@name"/></td>
+        <xsl:call-template name="generateProfilingCountersCells"/>
+    </tr>
+    </xsl:for-each>
+    </table>
+</xsl:template>
+
+<xsl:template name="generateProfilingTilesTable">
+    <xsl:param name="profilingNode"/>
+    <xsl:variable name="stages" select="$profilingNode/Stage[Tile]"/>
+    <xsl:if test="$stages">
+    <h2>Match selection per tile, wall (s)</h2>
+    <table border="1" ID="ReportTable">
+    <tr><th>Flowcell</th><th>Lane</th><th>Tile</th>
+        <xsl:for-each select="$stages"><th><xsl:value-of select="@name"/></th></xsl:for-each>
+    </tr>
+    <!-- all stages are keyed by the same tile indexes, the first one lists the tiles that have been processed -->
+    <xsl:for-each select="$stages[1]/Tile">
+        <xsl:variable name="tileIndex" select="@index"/>
+    <tr>
+        <td><xsl:value-of select="@flowcell-id"/></td>
+        <td><xsl:value-of select="@lane"/></td>
+        <td><xsl:value-of select="@tile"/></td>
+        <xsl:for-each select="$stages">
+        <td><xsl:value-of select="format-number(sum(Tile[@index=$tileIndex]/WallMs) div 1000, '###,###,###,##0.00')"/></td>
+        </xsl:for-each>
+    </tr>
+    </xsl:for-each>
+    </table>
+    </xsl:if>
+</xsl:template>
+
+<xsl:template name="generateProfilingBinsTable">
+    <xsl:param name="profilingNode"/>
+    <xsl:variable name="stages" select="$profilingNode/Stage[Bin]"/>
+    <xsl:if test="$stages">
+    <h2>Bam generation per bin, wall (s)</h2>
+    <table border="1" ID="ReportTable">
+    <tr><th>Bin</th><th>MBytes</th>
+        <xsl:for-each select="$stages"><th><xsl:value-of select="@name"/></th></xsl:for-each>
+    </tr>
+    <xsl:for-each select="$stages[1]/Bin">
+        <xsl:variable name="binIndex" select="@index"/>
+    <tr>
+        <td><xsl:value-of select="$binIndex"/></td>
+        <td><xsl:value-of select="format-number(Bytes div 1000000, '###,###,###,##0.00')"/></td>
+        <xsl:for-each select="$stages">
+        <td><xsl:value-of select="format-number(sum(Bin[@index=$binIndex]/WallMs) div 1000, '###,###,###,##0.00')"/></td>
+        </xsl:for-each>
+    </tr>
+    </xsl:for-each>
+    </table>
+    </xsl:if>
+</xsl:template>
+
+<xsl:template name="generateProfilingPage">
+    <xsl:param name="profilingNode"/>
+<html>
+<link rel="stylesheet" href="{$CSS_FILE_NAME}" type="text/css"/>
+<body>
+    <h1>Processing time</h1>
+    <xsl:call-template name="generateProfilingStepsTable">
+        <xsl:with-param name="profilingNode" select="$profilingNode"/>
+    </xsl:call-template>
+    <p>Wall and CPU times are summed over all threads and can exceed the elapsed time of the run.</p>
+    <xsl:call-template name="generateProfilingStagesTable">
+        <xsl:with-param name="profilingNode" select="$profilingNode"/>
+    </xsl:call-template>
+    <xsl:call-template name="generateProfilingTilesTable">
+        <xsl:with-param name="profilingNode" select="$profilingNode"/>
+    </xsl:call-template>
+    <xsl:call-template name="generateProfilingBinsTable">
+        <xsl:with-param name="profilingNode" select="$profilingNode"/>
+    </xsl:call-template>
+<p>@iSAAC_VERSION_FULL@</p>
+</body>
+</html>
+</xsl:template>
+
+</xsl:stylesheet>
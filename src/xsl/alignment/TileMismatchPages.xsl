@@ -94,11 +94,11 @@ exclude-result-prefixes="str math"
 
 <xsl:template name="generateTileMismatchGraphsGnuplotScript">
     <xsl:param name="flowcellNode"/>
+    <xsl:param name="laneNumber"/>
     <xsl:param name="pf"/>
 
     
-    <xsl:for-each select="$flowcellNode/Lane">
-    <xsl:sort select="@number"/>
+    <xsl:for-each select="$flowcellNode/Lane[@number=$laneNumber]">
         <xsl:variable name="lane" select="@number"/>
         <xsl:for-each select="Tile">
         <xsl:sort select="@number"/>
@@ -271,11 +271,11 @@ unset multiplot
 
 <xsl:template name="generateTileMismatchCurvesGnuplotScript">
     <xsl:param name="flowcellNode"/>
+    <xsl:param name="laneNumber"/>
     <xsl:param name="pf"/>
 
     
-    <xsl:for-each select="$flowcellNode/Lane">
-    <xsl:sort select="@number"/>
+    <xsl:for-each select="$flowcellNode/Lane[@number=$laneNumber]">
         <xsl:variable name="lane" select="@number"/>
         <xsl:for-each select="Tile">
         <xsl:sort select="@number"/>
@@ -0,0 +1,37 @@
+<?xml version="1.0"?>
+<!--
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file ProfilingStatsToTsv.xsl
+ **
+ ** Converts the workflow steps of ProfilingStats.xml into the isaac-benchmark result lines
+ **
+ ** \author Roman Petrovski
+ **/
+-->
+<xsl:stylesheet version="1.0" 
+xmlns:xsl="http://www.w3.org/1999/XSL/Transform" 
+>
+
+<xsl:output method="text"/>
+
+<xsl:param name="RUN_NAME"/>
+
+<xsl:template match="/"> 
+    <xsl:for-each select="Profiling/Step">
+        <xsl:value-of select="concat($RUN_NAME, '&#9;', @name, '&#9;', WallMs, '&#9;', UserCpuMs, '&#9;', SystemCpuMs, '&#9;',
+                                     PeakRssKb, '&#9;', BytesRead, '&#9;', BytesWritten, '&#10;')"/>
+    </xsl:for-each>
+</xsl:template>
+
+</xsl:stylesheet>